@@ -0,0 +1,246 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+ * Command list recording, job validation against the hardware constraints
+ * and the software reference of the job modes, against hand computed
+ * pixels.
+ */
+
+#include <string.h>
+
+#include "hal.h"
+#include "hal_stm32_dma2d.h"
+
+#define JOBS                                4U
+
+static int fails;
+
+#define CHECK(c)                                                            \
+  do {                                                                      \
+    if (!(c)) {                                                             \
+      printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #c);                    \
+      fails++;                                                              \
+    }                                                                       \
+  } while (0)
+
+static uint32_t fb32[8 * 4];
+static uint32_t src32[8 * 4];
+static uint16_t fb16[8 * 4];
+static uint16_t src16[8 * 4];
+static uint8_t src8[8 * 4];
+
+static dma2d_job_t jobs[JOBS];
+static dma2d_cmdlist_t list;
+
+static dma2d_laycfg_t layer(void *bufferp, dma2d_pixfmt_t fmt,
+                            size_t wrap_offset) {
+  dma2d_laycfg_t l;
+
+  memset(&l, 0, sizeof(l));
+  l.bufferp = bufferp;
+  l.fmt = fmt;
+  l.wrap_offset = wrap_offset;
+  return l;
+}
+
+static void test_recording(void) {
+  const dma2d_laycfg_t out = layer(fb16, DMA2D_FMT_RGB565, 0);
+  const dma2d_laycfg_t fg = layer(src16, DMA2D_FMT_RGB565, 0);
+  const dma2d_laycfg_t fg32 = layer(src32, DMA2D_FMT_ARGB8888, 0);
+  const dma2d_laycfg_t bg = layer(fb16, DMA2D_FMT_RGB565, 0);
+
+  dma2dListObjectInit(&list, jobs, JOBS, NULL);
+  CHECK(dma2dListGetCountX(&list) == 0);
+  CHECK(dma2dListGetResultX(&list) == MSG_OK);
+
+  CHECK(dma2dListAddFill(&list, &out, 8, 4) == HAL_SUCCESS);
+  CHECK(dma2dListAddCopy(&list, &out, &fg, 8, 4) == HAL_SUCCESS);
+  CHECK(dma2dListAddConvert(&list, &out, &fg32, DMA2D_ALPHA_REPLACE,
+                            8, 4) == HAL_SUCCESS);
+  CHECK(dma2dListAddBlend(&list, &out, &fg32, DMA2D_ALPHA_MODULATE,
+                          &bg, DMA2D_ALPHA_KEEP, 8, 4) == HAL_SUCCESS);
+  CHECK(dma2dListGetCountX(&list) == JOBS);
+
+  /* The jobs are copies, in recording order.*/
+  CHECK(jobs[0].mode == DMA2D_JOB_CONST);
+  CHECK(jobs[1].mode == DMA2D_JOB_COPY);
+  CHECK(jobs[1].fg.bufferp == src16);
+  CHECK(jobs[2].mode == DMA2D_JOB_CONVERT);
+  CHECK(jobs[2].fg_amode == DMA2D_ALPHA_REPLACE);
+  CHECK(jobs[3].mode == DMA2D_JOB_BLEND);
+  CHECK((jobs[3].fg_amode == DMA2D_ALPHA_MODULATE) &&
+        (jobs[3].bg_amode == DMA2D_ALPHA_KEEP));
+  CHECK((jobs[3].width == 8) && (jobs[3].height == 4));
+  CHECK(jobs[3].bg.bufferp == fb16);
+
+  /* Full list.*/
+  CHECK(dma2dListAddFill(&list, &out, 8, 4) == HAL_FAILED);
+  CHECK(dma2dListGetCountX(&list) == JOBS);
+
+  dma2dListReset(&list);
+  CHECK(dma2dListGetCountX(&list) == 0);
+  CHECK(dma2dListAddFill(&list, &out, 8, 4) == HAL_SUCCESS);
+  CHECK(dma2dListGetCountX(&list) == 1);
+}
+
+static void test_validation(void) {
+  const dma2d_laycfg_t out = layer(fb16, DMA2D_FMT_RGB565, 0);
+  const dma2d_laycfg_t fg = layer(src16, DMA2D_FMT_RGB565, 0);
+  dma2d_laycfg_t l;
+
+  dma2dListObjectInit(&list, jobs, JOBS, NULL);
+
+  /* Area size.*/
+  CHECK(dma2dListAddFill(&list, &out, 0, 4) == HAL_FAILED);
+  CHECK(dma2dListAddFill(&list, &out, 8, 0) == HAL_FAILED);
+  CHECK(dma2dListAddFill(&list, &out, DMA2D_MAX_WIDTH + 1, 1) == HAL_FAILED);
+  CHECK(dma2dListAddFill(&list, &out, DMA2D_MAX_WIDTH, 1) == HAL_SUCCESS);
+
+  /* Buffers.*/
+  l = layer(NULL, DMA2D_FMT_RGB565, 0);
+  CHECK(dma2dListAddFill(&list, &l, 8, 4) == HAL_FAILED);
+  l = layer((uint8_t *)fb16 + 1, DMA2D_FMT_RGB565, 0);
+  CHECK(dma2dListAddFill(&list, &l, 8, 4) == HAL_FAILED);
+  l = layer((uint8_t *)fb32 + 2, DMA2D_FMT_ARGB8888, 0);
+  CHECK(dma2dListAddFill(&list, &l, 8, 4) == HAL_FAILED);
+  l = layer(fb16, DMA2D_FMT_RGB565, DMA2D_MAX_OFFSET + 1);
+  CHECK(dma2dListAddFill(&list, &l, 8, 4) == HAL_FAILED);
+  l = layer(fb16, DMA2D_MAX_PIXFMT_ID, 0);
+  CHECK(dma2dListAddFill(&list, &l, 8, 4) == HAL_FAILED);
+
+  /* Only direct color outputs.*/
+  l = layer(src8, DMA2D_FMT_L8, 0);
+  CHECK(dma2dListAddFill(&list, &l, 8, 4) == HAL_FAILED);
+  CHECK(dma2dListAddConvert(&list, &l, &fg, DMA2D_ALPHA_KEEP, 8, 4) == HAL_FAILED);
+
+  /* 4-bit lines start on a byte boundary.*/
+  l = layer(src8, DMA2D_FMT_A4, 0);
+  CHECK(dma2dListAddConvert(&list, &out, &l, DMA2D_ALPHA_KEEP, 7, 4) == HAL_FAILED);
+  l = layer(src8, DMA2D_FMT_A4, 1);
+  CHECK(dma2dListAddConvert(&list, &out, &l, DMA2D_ALPHA_KEEP, 7, 4) == HAL_SUCCESS);
+
+  /* Copies don't convert.*/
+  l = layer(src32, DMA2D_FMT_ARGB8888, 0);
+  CHECK(dma2dListAddCopy(&list, &out, &l, 8, 4) == HAL_FAILED);
+
+  /* Indexed inputs need a CLUT load, bad alpha modes.*/
+  l = layer(src8, DMA2D_FMT_L8, 0);
+  CHECK(dma2dListAddConvert(&list, &out, &l, DMA2D_ALPHA_KEEP, 8, 4) == HAL_FAILED);
+  CHECK(dma2dListAddBlend(&list, &out, &fg, DMA2D_ALPHA_KEEP,
+                          &l, DMA2D_ALPHA_KEEP, 8, 4) == HAL_FAILED);
+  CHECK(dma2dListAddConvert(&list, &out, &fg, 3 << 16, 8, 4) == HAL_FAILED);
+  CHECK(dma2dListAddBlend(&list, &out, &fg, DMA2D_ALPHA_KEEP,
+                          &fg, 3 << 16, 8, 4) == HAL_FAILED);
+
+  /* Unknown mode.*/
+  jobs[JOBS - 1] = jobs[0];
+  jobs[JOBS - 1].mode = 4 << 16;
+  CHECK(dma2dListCheckJob(&jobs[JOBS - 1]) == HAL_FAILED);
+
+  /* Only the valid jobs were recorded.*/
+  CHECK(dma2dListGetCountX(&list) == 2);
+}
+
+/* RGB-565 from ARGB-8888, truncating.*/
+static uint16_t rgb565(uint32_t c) {
+
+  return (uint16_t)((((c >> 19) & 0x1F) << 11) | (((c >> 10) & 0x3F) << 5) |
+                    ((c >> 3) & 0x1F));
+}
+
+static void test_software(void) {
+  dma2d_laycfg_t out, fg, bg;
+  unsigned x, y;
+
+  /* Fill of a 6x2 area in an 8 pixels wide RGB-565 buffer.*/
+  memset(fb16, 0, sizeof(fb16));
+  dma2dListObjectInit(&list, jobs, JOBS, NULL);
+  out = layer(&fb16[8 + 1], DMA2D_FMT_RGB565, 2);
+  out.def_color = 0xF81F;
+  CHECK(dma2dListAddFill(&list, &out, 6, 2) == HAL_SUCCESS);
+  dma2dListRunSoftware(&list);
+  for (y = 0; y < 4; y++) {
+    for (x = 0; x < 8; x++) {
+      const bool in = (y >= 1) && (y <= 2) && (x >= 1) && (x <= 6);
+      CHECK(fb16[y * 8 + x] == (in ? 0xF81F : 0));
+    }
+  }
+
+  /* Copy, raw.*/
+  for (x = 0; x < 8 * 4; x++)
+    src16[x] = (uint16_t)(0x1000 + x);
+  dma2dListReset(&list);
+  out = layer(fb16, DMA2D_FMT_RGB565, 0);
+  fg = layer(src16, DMA2D_FMT_RGB565, 0);
+  CHECK(dma2dListAddCopy(&list, &out, &fg, 8, 4) == HAL_SUCCESS);
+  dma2dListRunSoftware(&list);
+  CHECK(memcmp(fb16, src16, sizeof(fb16)) == 0);
+
+  /* Conversion to RGB-565.*/
+  for (x = 0; x < 8 * 4; x++)
+    src32[x] = 0xFF000000 | (x * 0x070503);
+  dma2dListReset(&list);
+  fg = layer(src32, DMA2D_FMT_ARGB8888, 0);
+  CHECK(dma2dListAddConvert(&list, &out, &fg, DMA2D_ALPHA_KEEP, 8, 4) == HAL_SUCCESS);
+  dma2dListRunSoftware(&list);
+  for (x = 0; x < 8 * 4; x++)
+    CHECK(fb16[x] == rgb565(src32[x]));
+
+  /* A-8 takes its color from the layer, the alpha is modulated.*/
+  for (x = 0; x < 8; x++)
+    src8[x] = (uint8_t)(x * 32);
+  memset(fb32, 0, sizeof(fb32));
+  dma2dListReset(&list);
+  out = layer(fb32, DMA2D_FMT_ARGB8888, 0);
+  fg = layer(src8, DMA2D_FMT_A8, 0);
+  fg.def_color = 0x00123456;
+  fg.const_alpha = 0x80;
+  CHECK(dma2dListAddConvert(&list, &out, &fg, DMA2D_ALPHA_MODULATE, 8, 1) == HAL_SUCCESS);
+  dma2dListRunSoftware(&list);
+  for (x = 0; x < 8; x++)
+    CHECK(fb32[x] == ((((x * 32) * 0x80 / 255) << 24) | 0x123456));
+
+  /* Blend of a half transparent red over opaque blue, then of the same
+     foreground with its alpha replaced by 0: the jobs run in order on the
+     same buffer, the second one leaves it unchanged.*/
+  for (x = 0; x < 8; x++) {
+    src32[x] = 0x80FF0000;
+    fb32[x] = 0xFF0000FF;
+  }
+  dma2dListReset(&list);
+  out = layer(fb32, DMA2D_FMT_ARGB8888, 0);
+  fg = layer(src32, DMA2D_FMT_ARGB8888, 0);
+  bg = layer(fb32, DMA2D_FMT_ARGB8888, 0);
+  CHECK(dma2dListAddBlend(&list, &out, &fg, DMA2D_ALPHA_KEEP,
+                          &bg, DMA2D_ALPHA_KEEP, 4, 1) == HAL_SUCCESS);
+  CHECK(dma2dListAddBlend(&list, &out, &fg, DMA2D_ALPHA_REPLACE,
+                          &bg, DMA2D_ALPHA_KEEP, 4, 1) == HAL_SUCCESS);
+  dma2dListRunSoftware(&list);
+  for (x = 0; x < 4; x++)
+    CHECK(fb32[x] == 0xFF80007F);
+  for (x = 4; x < 8; x++)
+    CHECK(fb32[x] == 0xFF0000FF);
+}
+
+int main(void) {
+
+  test_recording();
+  test_validation();
+  test_software();
+  printf("%s\n", fails ? "FAILED" : "PASSED");
+  return fails != 0;
+}
@@ -0,0 +1,52 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/* HAL reduced to what the DMA2D register free code needs.*/
+
+#ifndef HAL_H
+#define HAL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TRUE                                1
+#define FALSE                               0
+
+#define HAL_SUCCESS                         false
+#define HAL_FAILED                          true
+
+typedef int32_t msg_t;
+typedef struct thread thread_t;
+
+#define MSG_OK                              ((msg_t)0)
+#define MSG_RESET                           ((msg_t)-2)
+
+#define STM32_HAS_DMA2D                     TRUE
+#define STM32_DMA2D_USE_DMA2D               TRUE
+#define DMA2D_USE_WAIT                      FALSE
+#define DMA2D_USE_MUTUAL_EXCLUSION          FALSE
+#define DMA2D_USE_SOFTWARE_CONVERSIONS      TRUE
+#define DMA2D_USE_COMMAND_LISTS             TRUE
+
+#define osalDbgCheck(c)                                                     \
+  do { if (!(c)) { printf("check %s:%d\n", __FILE__, __LINE__); abort(); } } while (0)
+#define osalDbgAssert(c, m)                                                 \
+  do { if (!(c)) { printf("assert %s:%d %s\n", __FILE__, __LINE__, m); abort(); } } while (0)
+
+#endif /* HAL_H */
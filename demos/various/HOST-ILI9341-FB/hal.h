@@ -0,0 +1,50 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/* HAL reduced to what the ILI9341 framebuffer needs, the SPI bus and the
+   D/!C pad are recorded by the panel model of trace.c.*/
+
+#ifndef HAL_H
+#define HAL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TRUE                                1
+#define FALSE                               0
+
+#define SPI_USE_WAIT                        TRUE
+#define ILI9341_USE_MUTUAL_EXCLUSION        FALSE
+
+typedef struct {
+  int                   dummy;
+} SPIDriver;
+
+typedef void *ioportid_t;
+
+void palSetPad(ioportid_t port, uint16_t pad);
+void palClearPad(ioportid_t port, uint16_t pad);
+uint8_t spiPolledExchange(SPIDriver *spip, uint8_t frame);
+void spiSend(SPIDriver *spip, size_t n, const void *txbuf);
+
+#define osalDbgCheck(c)                                                     \
+  do { if (!(c)) { printf("check %s:%d\n", __FILE__, __LINE__); abort(); } } while (0)
+
+#endif /* HAL_H */
@@ -0,0 +1,413 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+ * Replays UI update traces through the ILI9341 framebuffer: every area is
+ * drawn with ili9341FbFillRect(), which feeds ili9341DirtyAdd(), and each
+ * frame ends with ili9341FbFlush() into a panel model decoding the SPI
+ * stream. Checked on every step:
+ * - the dirty list stays within ILI9341_FB_MAX_RECTS and the screen,
+ * - every pixel drawn since the last flush is covered by a rectangle,
+ * - no two rectangles are left that ILI9341_FB_MERGE_COST would merge,
+ * - after a flush the panel memory equals the framebuffer and exactly the
+ *   area of the rectangles has been sent.
+ * The flush time is modeled from the bytes and bursts on the bus.
+ */
+
+#include "ch.h"
+#include "hal.h"
+#include "ili9341_fb.h"
+
+#define CHECK(c)                                                            \
+  do {                                                                      \
+    if (!(c)) {                                                             \
+      printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #c);                    \
+      exit(1);                                                              \
+    }                                                                       \
+  } while (0)
+
+#define W                                   240
+#define H                                   320
+
+/* Bus timing model, SPI5 of the STM32F429 Discovery.*/
+#define SPI_NS_PER_BYTE                     400     /* 20MHz clock */
+#define POLLED_NS                           300     /* per polled byte */
+#define BURST_NS                            5000    /* DMA set up, IRQ,
+                                                       thread wake up */
+#define ENCODE_NS                           200     /* 11 byte window,
+                                                       ~35 cycles @168MHz */
+
+/*===========================================================================*/
+/* Panel model.                                                              */
+/*===========================================================================*/
+
+static uint8_t fb_buffer[W * H * 2];
+static uint8_t panel[W * H * 2];
+static ili9341_fb_t fb;
+static ILI9341Config cfg;
+static ILI9341Driver drv;
+static SPIDriver spi;
+
+static bool selected, dcx;
+static uint8_t cmd;
+static unsigned nparam;
+static uint16_t params[4];
+static uint16_t xs, xe, ys, ye, cx, cy;
+static unsigned half;
+
+static unsigned long polled, bursts, burst_bytes, windows, pixels_sent;
+
+void ili9341Select(ILI9341Driver *driverp) {
+
+  CHECK(driverp == &drv && !selected);
+  selected = true;
+}
+
+void ili9341Unselect(ILI9341Driver *driverp) {
+
+  CHECK(driverp == &drv && selected);
+  selected = false;
+}
+
+void palSetPad(ioportid_t port, uint16_t pad) {
+
+  (void)port; (void)pad;
+  dcx = true;
+}
+
+void palClearPad(ioportid_t port, uint16_t pad) {
+
+  (void)port; (void)pad;
+  dcx = false;
+}
+
+static void panel_write(uint8_t b) {
+
+  if (!dcx) {
+    cmd = b;
+    nparam = 0;
+    if (cmd == ILI9341_SET_MEM) {
+      CHECK(xs <= xe && xe < W && ys <= ye && ye < H);
+      cx = xs;
+      cy = ys;
+      half = 0;
+      windows++;
+    }
+    return;
+  }
+
+  switch (cmd) {
+  case ILI9341_SET_COL_ADDR:
+  case ILI9341_SET_PAGE_ADDR:
+    CHECK(nparam < 4);
+    params[nparam++] = b;
+    if (nparam == 4) {
+      uint16_t s = (uint16_t)((params[0] << 8) | params[1]);
+      uint16_t e = (uint16_t)((params[2] << 8) | params[3]);
+      if (cmd == ILI9341_SET_COL_ADDR) {
+        xs = s;
+        xe = e;
+      }
+      else {
+        ys = s;
+        ye = e;
+      }
+    }
+    break;
+  case ILI9341_SET_MEM:
+    CHECK(cy <= ye);
+    panel[((size_t)cy * W + cx) * 2 + half] = b;
+    if (++half == 2) {
+      half = 0;
+      pixels_sent++;
+      if (++cx > xe) {
+        cx = xs;
+        cy++;
+      }
+    }
+    break;
+  default:
+    CHECK(false);
+  }
+}
+
+uint8_t spiPolledExchange(SPIDriver *spip, uint8_t frame) {
+
+  CHECK(spip == &spi && selected);
+  polled++;
+  panel_write(frame);
+  return 0xFF;
+}
+
+void spiSend(SPIDriver *spip, size_t n, const void *txbuf) {
+  const uint8_t *p = txbuf;
+
+  CHECK(spip == &spi && selected && dcx && cmd == ILI9341_SET_MEM);
+  CHECK(n > 0 && n <= ILI9341_FB_MAX_BURST);
+  bursts++;
+  burst_bytes += n;
+  while (n-- > 0) {
+    panel_write(*p++);
+  }
+}
+
+/*===========================================================================*/
+/* Checks.                                                                   */
+/*===========================================================================*/
+
+/* Pixels drawn since the last flush.*/
+static uint8_t touched[W * H];
+static unsigned long touched_px;
+
+static uint32_t area(const ili9341_rect_t *r) {
+
+  return ((uint32_t)r->x2 - r->x1 + 1) * ((uint32_t)r->y2 - r->y1 + 1);
+}
+
+static int32_t growth(const ili9341_rect_t *a, const ili9341_rect_t *b) {
+  ili9341_rect_t u;
+
+  u.x1 = a->x1 < b->x1 ? a->x1 : b->x1;
+  u.y1 = a->y1 < b->y1 ? a->y1 : b->y1;
+  u.x2 = a->x2 > b->x2 ? a->x2 : b->x2;
+  u.y2 = a->y2 > b->y2 ? a->y2 : b->y2;
+  return (int32_t)area(&u) - (int32_t)area(a) - (int32_t)area(b);
+}
+
+static bool covered(unsigned x, unsigned y) {
+  size_t i;
+
+  for (i = 0; i < fb.dirty.count; i++) {
+    const ili9341_rect_t *r = &fb.dirty.rects[i];
+    if (x >= r->x1 && x <= r->x2 && y >= r->y1 && y <= r->y2) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void check_list(void) {
+  size_t i, j;
+
+  CHECK(fb.dirty.count >= 1 && fb.dirty.count <= ILI9341_FB_MAX_RECTS);
+  for (i = 0; i < fb.dirty.count; i++) {
+    const ili9341_rect_t *r = &fb.dirty.rects[i];
+    CHECK(r->x1 <= r->x2 && r->x2 < W && r->y1 <= r->y2 && r->y2 < H);
+    for (j = i + 1; j < fb.dirty.count; j++) {
+      CHECK(growth(r, &fb.dirty.rects[j]) > ILI9341_FB_MERGE_COST);
+    }
+  }
+}
+
+static void check_coverage(void) {
+  unsigned x, y;
+
+  for (y = 0; y < H; y++) {
+    for (x = 0; x < W; x++) {
+      if (touched[y * W + x]) {
+        CHECK(covered(x, y));
+      }
+    }
+  }
+}
+
+/*===========================================================================*/
+/* Replay.                                                                   */
+/*===========================================================================*/
+
+typedef struct {
+  const char *name;
+  unsigned frames;
+  void (*frame)(unsigned n);
+} trace_t;
+
+static unsigned long draws;
+static uint16_t color;
+
+static void draw(int x, int y, int w, int h) {
+  int i, j;
+
+  color = (uint16_t)(color * 31421U + 6927U);
+  ili9341FbFillRect(&fb, (uint16_t)x, (uint16_t)y, (uint16_t)w, (uint16_t)h,
+                    color);
+  draws++;
+
+  for (j = y; j < y + h && j < H; j++) {
+    for (i = x; i < x + w && i < W; i++) {
+      if (!touched[j * W + i]) {
+        touched[j * W + i] = 1;
+        touched_px++;
+      }
+      CHECK(covered((unsigned)i, (unsigned)j));
+    }
+  }
+  if (fb.dirty.count > 0) {
+    check_list();
+  }
+}
+
+/* Status bar clock, the changed digits of hh:mm:ss each second.*/
+static void clock_frame(unsigned n) {
+  unsigned s = n, d;
+
+  for (d = 0; d < 6; d++) {
+    draw(160 + (int)(d * 12) + (int)(d / 2) * 4, 4, 10, 16);
+    if ((s % 10) != 9 && d < 5) {
+      break;
+    }
+    s /= 10;
+  }
+  draw(4, 4, 24, 16);                       /* Signal bars.*/
+}
+
+/* List scrolled by 8 rows, visible rows redrawn, scroll bar moved.*/
+static void list_frame(unsigned n) {
+  int row;
+
+  for (row = 0; row < 8; row++) {
+    draw(0, 32 + row * 34, 232, 32);
+  }
+  draw(234, 32 + (int)(n % 24) * 10, 6, 40);
+  draw(234, 32 + (int)((n + 23) % 24) * 10, 6, 40);
+}
+
+/* Scrolling chart, a new sample column, the value label and a cursor.*/
+static void chart_frame(unsigned n) {
+  int x = 10 + (int)(n % 220);
+  int v = 80 + (int)((n * 37) % 120);
+
+  draw(x, 100, 2, 160);
+  draw(x + 2, 100, 1, 160);                 /* Erase bar.*/
+  draw(180, 70, 50, 14);                    /* Value.*/
+  draw(x, 100 + 160 - v, 2, 2);
+}
+
+/* Touch feedback, a growing ripple around a button and a text caret.*/
+static void ripple_frame(unsigned n) {
+  int r = 4 + (int)(n % 12) * 3;
+  int cx = 60 + (int)((n / 12) % 3) * 60, cy = 250;
+
+  draw(cx - r, cy - r, 2 * r, 2);
+  draw(cx - r, cy + r - 2, 2 * r, 2);
+  draw(cx - r, cy - r, 2, 2 * r);
+  draw(cx + r - 2, cy - r, 2, 2 * r);
+  draw(20 + (int)(n % 40) * 5, 200, 2, 16);
+}
+
+/* Widgets spread over the screen, several dozens per frame.*/
+static void scatter_frame(unsigned n) {
+  static uint32_t seed = 12345;
+  unsigned i, k = 5 + n % 40;
+
+  for (i = 0; i < k; i++) {
+    seed = seed * 1103515245U + 12345U;
+    draw((int)((seed >> 8) % W), (int)((seed >> 16) % H),
+         1 + (int)((seed >> 4) % 48), 1 + (int)((seed >> 12) % 48));
+  }
+}
+
+/* Page transitions, the whole screen.*/
+static void page_frame(unsigned n) {
+
+  draw(0, 0, W, H);
+  draw(0, 0, W, 24 + (int)(n % 2));
+}
+
+static const trace_t traces[] = {
+  {"clock",   600, clock_frame},
+  {"list",    100, list_frame},
+  {"chart",   440, chart_frame},
+  {"ripple",  360, ripple_frame},
+  {"scatter", 200, scatter_frame},
+  {"page",     20, page_frame},
+};
+
+static double flush_us(unsigned long p, unsigned long b, unsigned long bb) {
+
+  return (p * (double)(SPI_NS_PER_BYTE + POLLED_NS) +
+          bb * (double)SPI_NS_PER_BYTE + b * (double)BURST_NS) / 1000.0;
+}
+
+static void replay(const trace_t *tp) {
+  unsigned long flushes = 0, all_windows = 0, all_bursts = 0;
+  unsigned long all_touched = 0, all_sent = 0;
+  double us = 0.0;
+  unsigned n;
+
+  draws = 0;
+  for (n = 0; n < tp->frames; n++) {
+    unsigned long expected = 0;
+    size_t i;
+
+    tp->frame(n);
+    if (fb.dirty.count == 0) {
+      continue;
+    }
+    check_coverage();
+    for (i = 0; i < fb.dirty.count; i++) {
+      expected += area(&fb.dirty.rects[i]);
+    }
+
+    polled = bursts = burst_bytes = windows = pixels_sent = 0;
+    ili9341FbFlush(&fb);
+    CHECK(!selected && fb.dirty.count == 0);
+    CHECK(polled == windows * ILI9341_FB_WINDOW_SIZE);
+    CHECK(pixels_sent == expected && burst_bytes == expected * 2);
+    CHECK(memcmp(panel, fb_buffer, sizeof panel) == 0);
+
+    flushes++;
+    all_windows += windows;
+    all_bursts += bursts;
+    all_touched += touched_px;
+    all_sent += pixels_sent;
+    us += flush_us(polled, bursts, burst_bytes);
+
+    /* Overlapping the window encoding with the pixel DMA could save at
+       most ENCODE_NS per window, it must not matter.*/
+    CHECK(windows * (double)ENCODE_NS / 1000.0 <
+          0.01 * flush_us(polled, bursts, burst_bytes));
+
+    memset(touched, 0, sizeof touched);
+    touched_px = 0;
+  }
+
+  printf("%-8s %5lu flushes, %5.1f draws, %4.2f windows, %6.1f bursts, "
+         "%5.1f%% overdraw, %8.1f us per flush, encode overlap <= %.2f us\n",
+         tp->name, flushes, (double)draws / flushes,
+         (double)all_windows / flushes, (double)all_bursts / flushes,
+         100.0 * ((double)all_sent - all_touched) / all_touched,
+         us / flushes, (double)all_windows / flushes * ENCODE_NS / 1000.0);
+}
+
+int main(void) {
+  size_t i;
+
+  cfg.spi = &spi;
+  drv.config = &cfg;
+  ili9341FbObjectInit(&fb, &drv, fb_buffer, W, H);
+
+  for (i = 0; i < sizeof traces / sizeof traces[0]; i++) {
+    replay(&traces[i]);
+  }
+
+  /* Full frame reference.*/
+  printf("full     refresh %8.1f us\n",
+         flush_us(ILI9341_FB_WINDOW_SIZE,
+                  (W * H * 2 + ILI9341_FB_MAX_BURST - 1) / ILI9341_FB_MAX_BURST,
+                  W * H * 2));
+
+  return 0;
+}
@@ -0,0 +1,184 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+ * Bandwidth model against hand computed demands. The panel has a 600x300
+ * pixels total frame around its 480x272 active area, at 9MHz it refreshes
+ * at 50Hz.
+ */
+
+#include "hal.h"
+#include "hal_stm32_ltdc.h"
+
+#define PIXCLK                              9000000U
+
+static int fails;
+
+#define CHECK(c)                                                            \
+  do {                                                                      \
+    if (!(c)) {                                                             \
+      printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #c);                    \
+      fails++;                                                              \
+    }                                                                       \
+  } while (0)
+
+/* Format sizes from the reference manual, the driver table lives with the
+   register code.*/
+size_t ltdcBitsPerPixel(ltdc_pixfmt_t fmt) {
+  static const uint8_t bpp[] = {32, 24, 16, 16, 16, 8, 8, 16};
+
+  osalDbgAssert(fmt < sizeof bpp, "invalid format");
+  return bpp[fmt];
+}
+
+static const ltdc_window_t full = {0, 479, 0, 271};
+static const ltdc_window_t left = {0, 239, 0, 271};
+static const ltdc_window_t right = {240, 479, 0, 271};
+static const ltdc_window_t touching = {239, 479, 0, 271};
+static const ltdc_window_t box = {100, 199, 50, 149};
+
+static ltdc_frame_t bg_frame, fg_frame;
+static ltdc_laycfg_t bg, fg;
+static LTDCConfig cfg = {
+  .screen_width = 480, .screen_height = 272,
+  .hsync_width = 40, .vsync_height = 10,
+  .hbp_width = 40, .vbp_height = 10,
+  .hfp_width = 40, .vfp_height = 8,
+};
+
+static void layers(ltdc_pixfmt_t bg_fmt, const ltdc_window_t *bg_win,
+                   ltdc_pixfmt_t fg_fmt, const ltdc_window_t *fg_win) {
+
+  bg_frame.fmt = bg_fmt;
+  bg.frame = &bg_frame;
+  bg.window = bg_win;
+  bg.flags = LTDC_LEF_ENABLE;
+  fg_frame.fmt = fg_fmt;
+  fg.frame = &fg_frame;
+  fg.window = fg_win;
+  fg.flags = LTDC_LEF_ENABLE;
+  cfg.bg_laycfg = (bg_win != NULL) ? &bg : NULL;
+  cfg.fg_laycfg = (fg_win != NULL) ? &fg : NULL;
+}
+
+static ltdc_bandwidth_t bw(void) {
+  ltdc_bandwidth_t b;
+
+  ltdcComputeBandwidth(&cfg, PIXCLK, &b);
+  return b;
+}
+
+static void test_single(void) {
+  ltdc_bandwidth_t b;
+
+  layers(LTDC_FMT_ARGB8888, &full, 0, NULL);
+  b = bw();
+  CHECK(b.bytes_per_clock == 4U);
+  CHECK(b.peak == 36000000U);
+  CHECK(b.average == 480U * 272U * 4U * 50U);
+
+  layers(LTDC_FMT_RGB888, &full, 0, NULL);
+  b = bw();
+  CHECK(b.bytes_per_clock == 3U && b.average == 480U * 272U * 3U * 50U);
+
+  /* Palette lookups are internal.*/
+  layers(LTDC_FMT_L8, &full, 0, NULL);
+  bg.flags |= LTDC_LEF_PALETTE;
+  b = bw();
+  CHECK(b.bytes_per_clock == 1U && b.peak == PIXCLK);
+
+  /* Only the foreground layer.*/
+  layers(0, NULL, LTDC_FMT_RGB565, &box);
+  b = bw();
+  CHECK(b.bytes_per_clock == 2U);
+  CHECK(b.average == 100U * 100U * 2U * 50U);
+  printf("single ok\n");
+}
+
+static void test_overlap(void) {
+  ltdc_bandwidth_t b;
+
+  layers(LTDC_FMT_RGB565, &full, LTDC_FMT_ARGB8888, &box);
+  b = bw();
+  CHECK(b.bytes_per_clock == 6U);
+  CHECK(b.peak == 54000000U);
+  CHECK(b.average == (480U * 272U * 2U + 100U * 100U * 4U) * 50U);
+
+  /* Side by side windows never fetch together.*/
+  layers(LTDC_FMT_RGB565, &left, LTDC_FMT_ARGB8888, &right);
+  b = bw();
+  CHECK(b.bytes_per_clock == 4U);
+  CHECK(b.average == (240U * 272U * 2U + 240U * 272U * 4U) * 50U);
+
+  /* Window coordinates are inclusive, one shared column overlaps.*/
+  layers(LTDC_FMT_RGB565, &left, LTDC_FMT_ARGB8888, &touching);
+  CHECK(bw().bytes_per_clock == 6U);
+  layers(LTDC_FMT_ARGB8888, &touching, LTDC_FMT_RGB565, &left);
+  CHECK(bw().bytes_per_clock == 6U);
+  printf("overlap ok\n");
+}
+
+static void test_inactive(void) {
+  ltdc_bandwidth_t b;
+
+  layers(LTDC_FMT_RGB565, &full, LTDC_FMT_ARGB8888, &box);
+  fg.flags = LTDC_LEF_KEYING;
+  b = bw();
+  CHECK(b.bytes_per_clock == 2U && b.average == 480U * 272U * 2U * 50U);
+
+  layers(LTDC_FMT_RGB565, &full, LTDC_FMT_ARGB8888, &box);
+  fg.frame = NULL;
+  CHECK(bw().bytes_per_clock == 2U);
+
+  layers(0, NULL, 0, NULL);
+  b = bw();
+  CHECK(b.bytes_per_clock == 0U && b.peak == 0U && b.average == 0U);
+  CHECK(ltdcCheckBandwidth(&cfg, PIXCLK, 0U));
+  CHECK(ltdcMaxPixelClock(&cfg, 1000U) == 0xFFFFFFFFU);
+  printf("inactive ok\n");
+}
+
+static void test_budget(void) {
+  ltdc_bandwidth_t b;
+  uint32_t clk;
+
+  layers(LTDC_FMT_RGB565, &full, LTDC_FMT_ARGB8888, &box);
+  CHECK(ltdcCheckBandwidth(&cfg, PIXCLK, 54000000U));
+  CHECK(!ltdcCheckBandwidth(&cfg, PIXCLK, 53999999U));
+
+  clk = ltdcMaxPixelClock(&cfg, 100000000U);
+  CHECK(clk == 16666666U);
+  CHECK(ltdcCheckBandwidth(&cfg, clk, 100000000U));
+  CHECK(!ltdcCheckBandwidth(&cfg, clk + 1U, 100000000U));
+
+  /* Rates beyond 32 bits saturate.*/
+  layers(LTDC_FMT_ARGB8888, &full, LTDC_FMT_ARGB8888, &full);
+  ltdcComputeBandwidth(&cfg, 0xFFFFFFFFU, &b);
+  CHECK(b.peak == 0xFFFFFFFFU);
+  CHECK(b.average == 0xFFFFFFFFU);
+  CHECK(!ltdcCheckBandwidth(&cfg, 0xFFFFFFFFU, 0xFFFFFFFEU));
+  printf("budget ok\n");
+}
+
+int main(void) {
+
+  test_single();
+  test_overlap();
+  test_inactive();
+  test_budget();
+  printf("%s\n", fails ? "FAILED" : "PASSED");
+  return fails != 0;
+}
@@ -0,0 +1,134 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+ * Latency benchmark. The cost of the mailbox calls is timed in a single
+ * thread, then the producer publishes its clock at a fixed pace and a
+ * polling consumer measures the delay until the fetch. Figures depend on
+ * the host, nothing is checked.
+ */
+
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+
+#include "osal.h"
+#include "nbuf.h"
+
+#define BUFFERS                             3U
+#define OPS                                 10000000U
+#define SAMPLES                             200000U
+#define PERIOD_NS                           2000U
+
+pthread_mutex_t osal_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint32_t data[BUFFERS];
+static void * const buffers[BUFFERS] = {&data[0], &data[1], &data[2]};
+static nbuf_meta_t meta[BUFFERS];
+static nbuf_t nb;
+static volatile bool done;
+static uint32_t latency[SAMPLES];
+
+static uint32_t now_ns(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)((uint64_t)ts.tv_sec * 1000000000U + (uint64_t)ts.tv_nsec);
+}
+
+static void bench_ops(void) {
+  uint32_t t0, t1, idx, i;
+
+  nbufObjectInit(&nb, buffers, meta, BUFFERS);
+  t0 = now_ns();
+  for (i = 0; i < OPS; i++) {
+    (void)nbufPublish(&nb, i, 4);
+    idx = nbufFetch(&nb, NULL);
+    nbufRelease(&nb, idx);
+  }
+  t1 = now_ns();
+  printf("bench: publish + fetch + release %.1f ns\n",
+         (double)(t1 - t0) / OPS);
+}
+
+static void *producer(void *arg) {
+  uint32_t next = now_ns();
+  unsigned i;
+
+  (void)arg;
+  for (i = 0; i < SAMPLES * 4U && !done; i++) {
+    while ((int32_t)(now_ns() - next) < 0)
+      sched_yield();
+    next += PERIOD_NS;
+    (void)nbufPublish(&nb, now_ns(), 4);
+  }
+  done = true;
+  return NULL;
+}
+
+static void *consumer(void *arg) {
+  unsigned n = 0;
+  uint32_t idx;
+
+  (void)arg;
+  while ((n < SAMPLES) && !done) {
+    if (!nbufIsReady(&nb)) {
+      sched_yield();
+      continue;
+    }
+    idx = nbufFetch(&nb, NULL);
+    if (idx == NBUF_NONE)
+      continue;
+    latency[n++] = now_ns() - nbufGetMeta(&nb, idx)->timestamp;
+    nbufRelease(&nb, idx);
+  }
+  done = true;
+  return NULL;
+}
+
+static int cmp(const void *a, const void *b) {
+  uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+
+  return (x > y) - (x < y);
+}
+
+static void bench_latency(void) {
+  pthread_t pt, ct;
+  unsigned n;
+
+  nbufObjectInit(&nb, buffers, meta, BUFFERS);
+  memset(latency, 0, sizeof latency);
+  pthread_create(&ct, NULL, consumer, NULL);
+  pthread_create(&pt, NULL, producer, NULL);
+  pthread_join(pt, NULL);
+  pthread_join(ct, NULL);
+
+  for (n = 0; (n < SAMPLES) && (latency[n] != 0); n++)
+    ;
+  if (n == 0)
+    return;
+  qsort(latency, n, sizeof latency[0], cmp);
+  printf("bench: publish to fetch, %u samples, min %u ns, median %u ns, "
+         "99%% %u ns, max %u ns\n", n, latency[0], latency[n / 2],
+         latency[n - n / 100 - 1], latency[n - 1]);
+}
+
+int main(void) {
+
+  bench_ops();
+  bench_latency();
+  return 0;
+}
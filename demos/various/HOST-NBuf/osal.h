@@ -0,0 +1,43 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/* OSAL reduced to what nbuf.c needs, the lock is a process wide mutex.*/
+
+#ifndef OSAL_H
+#define OSAL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#define TRUE                                1
+#define FALSE                               0
+
+typedef int syssts_t;
+
+extern pthread_mutex_t osal_lock;
+
+#define osalDbgCheck(c)                                                     \
+  do { if (!(c)) { printf("check %s:%d\n", __FILE__, __LINE__); abort(); } } while (0)
+#define osalDbgAssert(c, m)                                                 \
+  do { if (!(c)) { printf("assert %s:%d %s\n", __FILE__, __LINE__, m); abort(); } } while (0)
+#define osalSysGetStatusAndLockX()          (pthread_mutex_lock(&osal_lock), 0)
+#define osalSysRestoreStatusX(sts)          ((void)(sts), pthread_mutex_unlock(&osal_lock))
+
+#endif /* OSAL_H */
@@ -0,0 +1,154 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+ * Producer and consumer threads hammering a mailbox. The producer stamps
+ * every word of its buffer with the publication number, the consumer
+ * checks that a fetched buffer is never written while it holds it, that
+ * the numbers only grow and that fetched plus missed buffers account for
+ * all the published ones.
+ */
+
+#include <string.h>
+#include <sched.h>
+
+#include "osal.h"
+#include "nbuf.h"
+
+#define BUFFERS                             5U
+#define WORDS                               64U
+#define PUBLISHES                           2000000U
+
+pthread_mutex_t osal_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint32_t data[BUFFERS][WORDS];
+static void * const buffers[BUFFERS] = {
+  data[0], data[1], data[2], data[3], data[4]
+};
+static nbuf_meta_t meta[BUFFERS];
+static nbuf_t nb;
+static volatile bool done;
+
+#define CHECK(c)                                                            \
+  do {                                                                      \
+    if (!(c)) {                                                             \
+      printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #c);                    \
+      exit(1);                                                              \
+    }                                                                       \
+  } while (0)
+
+static unsigned rnd(unsigned *state) {
+
+  *state = *state * 1103515245U + 12345U;
+  return (*state >> 8) & 0xFFFFFF;
+}
+
+static void *producer(void *arg) {
+  uint32_t idx = nbufGetBack(&nb), seq, i;
+  unsigned state = 1;
+
+  (void)arg;
+  for (seq = 1; seq <= PUBLISHES; seq++) {
+    uint32_t *p = nbufGetBuffer(&nb, idx);
+
+    for (i = 0; i < WORDS; i++)
+      p[i] = seq;
+    if ((rnd(&state) & 63) == 0)
+      sched_yield();
+    idx = nbufPublish(&nb, seq, WORDS * 4);
+  }
+  done = true;
+  return NULL;
+}
+
+/* Buffers held by the consumer, up to n - 2.*/
+static uint32_t held[BUFFERS], held_seq[BUFFERS];
+static unsigned nheld;
+
+static void check_held(void) {
+  unsigned h, i;
+
+  for (h = 0; h < nheld; h++) {
+    const uint32_t *p = nbufGetBuffer(&nb, held[h]);
+
+    for (i = 0; i < WORDS; i++)
+      CHECK(p[i] == held_seq[h]);
+  }
+}
+
+static void *consumer(void *arg) {
+  unsigned long fetched = 0, missed_total = 0, putbacks = 0, empty = 0;
+  uint32_t idx, missed, last = 0;
+  unsigned state = 2;
+
+  (void)arg;
+  for (;;) {
+    bool finished = done;
+
+    idx = nbufFetch(&nb, &missed);
+    if (idx == NBUF_NONE) {
+      if (finished)
+        break;
+      empty++;
+      check_held();
+      sched_yield();
+      continue;
+    }
+    CHECK(nbufGetMeta(&nb, idx)->seq == last + missed + 1);
+    CHECK(nbufGetMeta(&nb, idx)->size == WORDS * 4);
+
+    if ((rnd(&state) & 15) == 0) {
+      /* Given back unused, counted again by the next fetch.*/
+      nbufPutBack(&nb, idx);
+      putbacks++;
+      continue;
+    }
+    last = nbufGetMeta(&nb, idx)->seq;
+    fetched++;
+    missed_total += missed;
+
+    held[nheld] = idx;
+    held_seq[nheld] = last;
+    nheld++;
+    check_held();
+
+    /* Keeps between 1 and n - 2 buffers.*/
+    while ((nheld == BUFFERS - 2) || ((nheld > 1) && (rnd(&state) & 1))) {
+      unsigned h = rnd(&state) % nheld;
+
+      check_held();
+      nbufRelease(&nb, held[h]);
+      held[h] = held[--nheld];
+      held_seq[h] = held_seq[nheld];
+    }
+  }
+  printf("stress: %u published, %lu fetched, %lu missed, %lu put back, "
+         "%lu empty polls\n", PUBLISHES, fetched, missed_total, putbacks, empty);
+  CHECK(last == PUBLISHES);
+  CHECK(fetched + missed_total == PUBLISHES);
+  return NULL;
+}
+
+int main(void) {
+  pthread_t pt, ct;
+
+  nbufObjectInit(&nb, buffers, meta, BUFFERS);
+  CHECK(pthread_create(&ct, NULL, consumer, NULL) == 0);
+  CHECK(pthread_create(&pt, NULL, producer, NULL) == 0);
+  pthread_join(pt, NULL);
+  pthread_join(ct, NULL);
+  return 0;
+}
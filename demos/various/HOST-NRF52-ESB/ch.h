@@ -0,0 +1,82 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/* Kernel reduced to lock checks, the driver thread is not run.*/
+
+#ifndef CH_H
+#define CH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TRUE                                1
+#define FALSE                               0
+#define NORMALPRIO                          128
+
+typedef int32_t msg_t;
+typedef uint32_t eventflags_t;
+typedef uint32_t rtcnt_t;
+typedef struct { int sig; } binary_semaphore_t;
+typedef struct { eventflags_t flags; } event_source_t;
+typedef struct { int dummy; } thread_t;
+
+extern int sim_locked, sim_in_isr;
+extern rtcnt_t sim_cycles;
+extern thread_t sim_thread;
+
+#define SIM_FAIL(m)                         do { puts(m); abort(); } while (0)
+
+#define chSysLock()                                                         \
+  do { if (sim_locked++) SIM_FAIL("nested lock"); } while (0)
+#define chSysUnlock()                                                       \
+  do { if (--sim_locked) SIM_FAIL("bad unlock"); } while (0)
+#define chSysLockFromISR()                  chSysLock()
+#define chSysUnlockFromISR()                chSysUnlock()
+#define chSysGetRealtimeCounterX()          (sim_cycles)
+
+#define chBSemObjectInit(s, t)              ((s)->sig = !(t))
+#define chBSemSignalI(s)                                                    \
+  do {                                                                      \
+    if (!sim_locked) SIM_FAIL("chBSemSignalI() unlocked");                  \
+    (s)->sig = 1;                                                           \
+  } while (0)
+#define chBSemSignal(s)                                                     \
+  do {                                                                      \
+    if (sim_in_isr) SIM_FAIL("chBSemSignal() in ISR");                      \
+    (s)->sig = 1;                                                           \
+  } while (0)
+#define chBSemWait(s)                       ((s)->sig = 0)
+
+#define chEvtObjectInit(e)                  ((e)->flags = 0)
+#define chEvtBroadcastFlags(e, f)           ((e)->flags |= (f))
+
+#define THD_WORKING_AREA(n, s)              char n[s]
+#define THD_FUNCTION(n, a)                  void n(void *a)
+#define chRegSetThreadName(n)               (void)(n)
+#define chThdShouldTerminateX()             true
+#define chThdExit(m)                        (void)(m)
+#define chThdCreateStatic(w, s, p, f, a)                                    \
+  ((void)(w), (void)(s), (void)(f), &sim_thread)
+#define chThdTerminate(t)                   (void)(t)
+#define chThdWait(t)                        (void)(t)
+
+#define RTC2US(freq, n)                     ((((n) - 1UL) / ((freq) / 1000000UL)) + 1UL)
+#define osalDbgAssert(c, m)                 do { if (!(c)) SIM_FAIL(m); } while (0)
+
+#endif /* CH_H */
@@ -0,0 +1,47 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/* CMSIS core definitions needed by nrf52.h.*/
+
+#ifndef CORE_CM4_H
+#define CORE_CM4_H
+
+#include <stdint.h>
+
+#define __I                                 volatile const
+#define __O                                 volatile
+#define __IO                                volatile
+#define __IM                                volatile const
+#define __OM                                volatile
+#define __IOM                               volatile
+
+static inline uint32_t __REV(uint32_t v) {
+
+  return __builtin_bswap32(v);
+}
+
+static inline uint32_t __RBIT(uint32_t v) {
+  uint32_t r = 0;
+  int i;
+
+  for (i = 0; i < 32; i++) {
+    if (v & (1U << i))
+      r |= 1U << (31 - i);
+  }
+  return r;
+}
+
+#endif /* CORE_CM4_H */
@@ -0,0 +1,353 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+ * ESB state machine against a RADIO moved to memory. The radio is run by
+ * radio_run(): each transmission ends with a DISABLED interrupt, the
+ * DISABLED->TXEN and DISABLED->RXEN shortcuts and the PPI retransmit
+ * channel are followed as the hardware would.
+ */
+
+#include <string.h>
+
+#include "hal.h"
+#include "nrf52_radio.h"
+
+int sim_locked, sim_in_isr, sim_irq_enabled;
+rtcnt_t sim_cycles;
+thread_t sim_thread;
+NRF_RADIO_Type sim_radio;
+NRF_TIMER_Type sim_timer;
+NRF_PPI_Type sim_ppi;
+
+void Vector44(void);
+
+/* Writes to read only registers.*/
+#define W(r)                                (*(uint32_t *)&sim_radio.r)
+
+static int fails;
+
+#define CHECK(c)                                                            \
+  do {                                                                      \
+    if (!(c)) {                                                             \
+      printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #c);                    \
+      fails++;                                                              \
+    }                                                                       \
+  } while (0)
+
+/* Packets seen on air.*/
+typedef struct {
+  uint8_t   pipe;
+  uint8_t   len;
+  uint8_t   pid;
+  uint8_t   noack;
+  uint8_t   data[NRF52_MAX_PAYLOAD_LENGTH];
+} air_t;
+
+static air_t air[256];
+static int nair, sw_starts, chained_starts;
+
+/* Ack loss pattern, one entry per attempt, 1 when lost.*/
+static const uint8_t *loss;
+static int nloss, iloss;
+static void (*before_disabled)(void);
+
+void sim_disable_wait(void) {
+
+  sim_radio.TASKS_DISABLE   = 0;
+  sim_radio.EVENTS_DISABLED = 1;
+}
+
+static void isr_disabled(void) {
+
+  sim_radio.EVENTS_DISABLED = 1;
+  sim_cycles += 64 * 50;
+  Vector44();
+}
+
+static void on_air(void) {
+  const uint8_t *p = (const uint8_t *)(uintptr_t)sim_radio.PACKETPTR;
+  air_t *a = &air[nair++];
+
+  a->pipe  = (uint8_t)sim_radio.TXADDRESS;
+  a->len   = p[0];
+  a->pid   = p[1] >> 1;
+  a->noack = p[1] & 1;
+  memcpy(a->data, &p[2], a->len);
+  sim_cycles += 64 * 200;
+}
+
+static bool take_txen(void) {
+
+  if (sim_radio.TASKS_TXEN) {
+    sim_radio.TASKS_TXEN = 0;
+    sw_starts++;
+    return true;
+  }
+  return false;
+}
+
+/* Runs the radio until it stays disabled.*/
+static void radio_run(void) {
+  uint32_t shorts;
+  uint8_t *rx;
+  bool tx, lost;
+
+  tx = take_txen();
+  while (tx) {
+    tx = false;
+    on_air();
+    shorts = sim_radio.SHORTS;
+    if (before_disabled != NULL) {
+      before_disabled();
+      before_disabled = NULL;
+    }
+    sim_ppi.CHENSET = 0;
+    isr_disabled();
+    if (sim_radio.TASKS_DISABLE) {
+      /* Aborted, the shortcut does not fire.*/
+      sim_radio.TASKS_DISABLE = 0;
+      isr_disabled();
+      continue;
+    }
+    if (shorts & RADIO_SHORTS_DISABLED_TXEN_Msk) {
+      chained_starts++;
+      tx = true;
+      continue;
+    }
+    if (shorts & RADIO_SHORTS_DISABLED_RXEN_Msk) {
+      /* Ack window.*/
+      rx = (uint8_t *)(uintptr_t)sim_radio.PACKETPTR;
+      lost = (iloss < nloss) ? loss[iloss] : false;
+      iloss++;
+      sim_ppi.CHENSET = 0;
+      if (!lost) {
+        rx[0] = 0;
+        rx[1] = 0;
+        sim_radio.EVENTS_END = 1;
+        W(CRCSTATUS) = 1;
+      }
+      else {
+        sim_radio.EVENTS_END = 0;
+        W(CRCSTATUS) = 0;
+      }
+      isr_disabled();
+      sim_radio.EVENTS_END = 0;
+      tx = take_txen();
+      if (!tx && (sim_ppi.CHENSET & (1U << NRF52_RADIO_PPI_TX_START)))
+        tx = true;                          /* Retransmitted by PPI.*/
+    }
+    else
+      tx = take_txen();
+  }
+}
+
+static nrf52_config_t cfg = {
+  .protocol           = NRF52_PROTOCOL_ESB_DPL,
+  .mode               = NRF52_MODE_PTX,
+  .bitrate            = NRF52_BITRATE_2MBPS,
+  .crc                = NRF52_CRC_16BIT,
+  .tx_power           = NRF52_TX_POWER_0DBM,
+  .tx_mode            = NRF52_TXMODE_MANUAL_START,
+  .selective_auto_ack = true,
+  .retransmit         = {.delay = 600, .count = 3},
+  .payload_length     = 8,
+  .address            = {
+    .base_addr_p0     = {1, 2, 3, 4},
+    .base_addr_p1     = {5, 6, 7, 8},
+    .pipe_prefixes    = {0xE7, 0xC2, 0xC3, 0, 0, 0, 0, 0},
+    .num_pipes        = 3,
+    .addr_length      = 5,
+    .rx_pipes         = 7,
+    .rf_channel       = 10
+  }
+};
+
+static void reset(nrf52_mode_t mode, uint16_t retries) {
+
+  memset(&sim_radio, 0, sizeof sim_radio);
+  cfg.mode = mode;
+  cfg.retransmit.count = retries;
+  CHECK(radio_init(&cfg) == NRF52_SUCCESS);
+  sim_radio.TASKS_DISABLE = 0;
+  nair = sw_starts = chained_starts = 0;
+  loss = NULL;
+  nloss = iloss = 0;
+}
+
+static void queue(uint8_t pipe, uint8_t noack, uint8_t tag, int n) {
+  nrf52_payload_t p;
+  int i;
+
+  for (i = 0; i < n; i++) {
+    memset(&p, 0, sizeof p);
+    p.length  = 4;
+    p.pipe    = pipe;
+    p.noack   = noack;
+    p.data[0] = tag;
+    p.data[1] = (uint8_t)i;
+    p.data[2] = 0xA5;
+    p.data[3] = 0x5A;
+    CHECK(radio_write_payload(&p) == NRF52_SUCCESS);
+  }
+}
+
+static bool tx_empty(void) {
+
+  return radio_start_tx() == NRF52_ERROR_INVALID_LENGTH;
+}
+
+static void test_burst(void) {
+  nrf52_pipe_stats_t st;
+  int i;
+
+  reset(NRF52_MODE_PTX, 3);
+  queue(1, 1, 0x10, 6);
+  CHECK(radio_start_tx() == NRF52_SUCCESS);
+  radio_run();
+  CHECK((nair == 6) && (sw_starts == 1) && (chained_starts == 5));
+  for (i = 0; i < nair; i++) {
+    CHECK((air[i].pipe == 1) && air[i].noack && (air[i].data[0] == 0x10) &&
+          (air[i].data[1] == i) && (air[i].pid == (uint8_t)((i + 1) % 4)));
+  }
+  CHECK((RFD1.state == NRF52_STATE_IDLE) && tx_empty());
+  CHECK(!(sim_radio.SHORTS & RADIO_SHORTS_DISABLED_TXEN_Msk));
+  CHECK(radio_get_pipe_stats(1, &st) == NRF52_SUCCESS);
+  CHECK((st.tx_packets == 6) && (st.tx_bytes == 24) && (st.acks == 0));
+
+  /* Chains break on a pipe change and on a payload needing an ack.*/
+  reset(NRF52_MODE_PTX, 3);
+  queue(1, 1, 0x20, 2);
+  queue(2, 1, 0x21, 2);
+  queue(2, 0, 0x22, 1);
+  queue(2, 1, 0x23, 2);
+  CHECK(radio_start_tx() == NRF52_SUCCESS);
+  radio_run();
+  CHECK((nair == 7) && tx_empty());
+  CHECK((sw_starts == 4) && (chained_starts == 3));
+  CHECK((air[4].data[0] == 0x22) && !air[4].noack);
+  for (i = 0; i < nair; i++) {
+    CHECK(air[i].data[0] == (i < 2 ? 0x20 : i < 4 ? 0x21 : i < 5 ? 0x22 : 0x23));
+  }
+}
+
+static void flush_now(void) {
+
+  CHECK(radio_flush_tx() == NRF52_SUCCESS);
+}
+
+static void test_flush(void) {
+
+  reset(NRF52_MODE_PTX, 3);
+  queue(1, 1, 0x30, 3);
+  CHECK(radio_start_tx() == NRF52_SUCCESS);
+  before_disabled = flush_now;
+  radio_run();
+  CHECK((nair == 1) && (RFD1.state == NRF52_STATE_IDLE));
+  CHECK(!(sim_radio.SHORTS & RADIO_SHORTS_DISABLED_TXEN_Msk));
+}
+
+static void test_retransmit(void) {
+  static const uint8_t pattern[] = {1, 1, 0, 0, 1, 0, 0};
+  static const uint8_t always[] = {1, 1, 1, 1, 1, 1};
+  nrf52_pipe_stats_t st;
+
+  reset(NRF52_MODE_PTX, 3);
+  loss = pattern;
+  nloss = sizeof pattern;
+  queue(0, 0, 0x40, 4);
+  CHECK(radio_start_tx() == NRF52_SUCCESS);
+  radio_run();
+  CHECK((nair == 7) && tx_empty() && (RFD1.state == NRF52_STATE_IDLE));
+  CHECK((air[0].pid == air[1].pid) && (air[1].pid == air[2].pid) &&
+        (air[3].pid != air[2].pid));
+  CHECK((air[4].pid == air[5].pid) && (air[4].data[1] == 2));
+  CHECK(radio_get_pipe_stats(0, &st) == NRF52_SUCCESS);
+  CHECK((st.tx_packets == 4) && (st.acks == 4) && (st.retransmits == 3) &&
+        (st.tx_failed == 0));
+  CHECK(st.ack_latency_max > st.ack_latency_sum / 4);
+  CHECK(RFD1.flags & NRF52_INT_TX_SUCCESS_MSK);
+
+  /* Retransmits exhausted, the payload stays queued.*/
+  reset(NRF52_MODE_PTX, 2);
+  loss = always;
+  nloss = sizeof always;
+  queue(0, 0, 0x41, 1);
+  CHECK(radio_start_tx() == NRF52_SUCCESS);
+  radio_run();
+  CHECK((nair == 3) && (RFD1.state == NRF52_STATE_IDLE));
+  CHECK(RFD1.flags & NRF52_INT_TX_FAILED_MSK);
+  CHECK(radio_get_pipe_stats(0, &st) == NRF52_SUCCESS);
+  CHECK((st.tx_failed == 1) && (st.retransmits == 2) && (st.tx_packets == 0));
+  CHECK(!tx_empty());
+}
+
+static void rx_packet(uint8_t pipe, uint8_t pid, uint8_t tag, uint32_t crc) {
+  uint8_t *rx = (uint8_t *)(uintptr_t)sim_radio.PACKETPTR;
+
+  rx[0] = 3;
+  rx[1] = (uint8_t)(pid << 1) | 1;          /* No ack requested.*/
+  rx[2] = tag;
+  rx[3] = pid;
+  rx[4] = pipe;
+  W(CRCSTATUS) = 1;
+  W(RXMATCH)   = pipe;
+  W(RXCRC)     = crc;
+  isr_disabled();
+  CHECK(RFD1.state == NRF52_STATE_PRX);
+}
+
+static void test_rx(void) {
+  nrf52_payload_t out[16];
+  nrf52_pipe_stats_t st;
+  uint8_t n;
+  int i;
+
+  reset(NRF52_MODE_PRX, 3);
+  CHECK(radio_start_rx() == NRF52_SUCCESS);
+  rx_packet(0, 1, 0x50, 100);
+  rx_packet(0, 1, 0x50, 100);               /* Retransmitted copy.*/
+  rx_packet(0, 2, 0x51, 101);
+  rx_packet(1, 1, 0x52, 102);
+  for (i = 0; i < NRF52_RX_FIFO_SIZE; i++)
+    rx_packet(2, (uint8_t)(i & 3), 0x60, 200 + i);
+  CHECK(radio_read_rx_payloads(out, 16, &n) == NRF52_SUCCESS);
+  CHECK(n == NRF52_RX_FIFO_SIZE);
+  CHECK((out[0].data[0] == 0x50) && (out[1].data[0] == 0x51) &&
+        (out[2].data[0] == 0x52) && (out[2].pipe == 1));
+  CHECK((out[3].pipe == 2) && (out[3].length == 3));
+  CHECK((radio_read_rx_payloads(out, 16, &n) == NRF52_ERROR_INVALID_LENGTH) &&
+        (n == 0));
+  radio_get_pipe_stats(0, &st);
+  CHECK((st.rx_packets == 2) && (st.rx_bytes == 6) && (st.rx_overflows == 0));
+  radio_get_pipe_stats(2, &st);
+  CHECK((st.rx_packets == NRF52_RX_FIFO_SIZE - 3) && (st.rx_overflows == 3));
+  CHECK(radio_reset_stats() == NRF52_SUCCESS);
+  radio_get_pipe_stats(2, &st);
+  CHECK((st.rx_packets == 0) && (st.rx_overflows == 0));
+}
+
+int main(void) {
+
+  test_burst();
+  test_flush();
+  test_retransmit();
+  test_rx();
+  CHECK(sim_locked == 0);
+  printf("esb: burst, flush, retransmit and receive %s\n",
+         fails ? "FAILED" : "ok");
+  return fails != 0;
+}
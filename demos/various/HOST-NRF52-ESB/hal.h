@@ -0,0 +1,51 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/* RADIO, TIMER1 and PPI moved to memory, interrupts called directly.*/
+
+#ifndef HAL_H
+#define HAL_H
+
+#include "ch.h"
+#include "nrf52.h"
+#include "nrf52_bitfields.h"
+
+extern NRF_RADIO_Type sim_radio;
+extern NRF_TIMER_Type sim_timer;
+extern NRF_PPI_Type sim_ppi;
+extern int sim_irq_enabled;
+
+#undef NRF_RADIO
+#undef NRF_TIMER1
+#undef NRF_PPI
+#define NRF_RADIO                           (&sim_radio)
+#define NRF_TIMER1                          (&sim_timer)
+#define NRF_PPI                             (&sim_ppi)
+
+#define NRF5_HFCLK_FREQUENCY                64000000
+
+#define OSAL_IRQ_HANDLER(id)                void id(void)
+#define OSAL_IRQ_PROLOGUE()                 (sim_in_isr = 1)
+#define OSAL_IRQ_EPILOGUE()                 (sim_in_isr = 0)
+
+#define nvicEnableVector(n, p)              ((void)(n), sim_irq_enabled = 1)
+#define nvicDisableVector(n)                ((void)(n), sim_irq_enabled = 0)
+#define nvicClearPending(n)                 (void)(n)
+
+/* Replaces the busy waits on EVENTS_DISABLED in the driver build copy.*/
+void sim_disable_wait(void);
+
+#endif /* HAL_H */
@@ -0,0 +1,46 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/* C models of the ARMv7E-M SIMD intrinsics used by pixops.c, so that its
+   SIMD path builds and runs on the build host.*/
+
+#ifndef ARM_ACLE_H
+#define ARM_ACLE_H
+
+#include <stdint.h>
+
+static inline uint32_t __ror(uint32_t x, uint32_t n) {
+
+  n &= 31U;
+  return (n == 0U) ? x : ((x >> n) | (x << (32U - n)));
+}
+
+/* Zero extends bytes 0 and 2 into the two halfwords.*/
+static inline uint32_t __uxtb16(uint32_t x) {
+
+  return x & 0x00FF00FFU;
+}
+
+/* Adds bytes 0 and 2 of b to the two halfwords of a, no carry between the
+   halfwords.*/
+static inline uint32_t __uxtab16(uint32_t a, uint32_t b) {
+  uint32_t lo = (a + (b & 0xFFU)) & 0xFFFFU;
+  uint32_t hi = ((a >> 16) + ((b >> 16) & 0xFFU)) & 0xFFFFU;
+
+  return lo | (hi << 16);
+}
+
+#endif /* ARM_ACLE_H */
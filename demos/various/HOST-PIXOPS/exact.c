@@ -0,0 +1,347 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+ * pixops.c is built three times: with the word-at-a-time fast paths, with
+ * the fast paths and the SIMD instructions (C models in arm_acle.h), and
+ * with the per-pixel generic code only, the reference. Random fills,
+ * copies, conversions and blends over all the format combinations, line
+ * gaps, misaligned buffers and in place blending must give the same
+ * bytes, guard bytes around the output area included. The reference is
+ * checked against hand computed pixels. Then the fast paths and the
+ * reference are timed on a 240x320 frame.
+ */
+
+#include <string.h>
+#include <time.h>
+
+#include "hal.h"
+#include "pixops.h"
+
+#define CHECK(c)                                                            \
+  do { if (!(c)) { printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #c);      \
+                   exit(1); } } while (0)
+
+#define PIXOPS_DECLARE(p)                                                   \
+  void p##Fill(const pixops_layer_t *outp,                                  \
+               uint16_t width, uint16_t height, pixops_color_t color);      \
+  void p##Copy(const pixops_layer_t *outp, const pixops_layer_t *fgp,       \
+               uint16_t width, uint16_t height);                            \
+  void p##Convert(const pixops_layer_t *outp, const pixops_layer_t *fgp,    \
+                  uint16_t width, uint16_t height);                         \
+  void p##Blend(const pixops_layer_t *outp, const pixops_layer_t *fgp,      \
+                const pixops_layer_t *bgp,                                  \
+                uint16_t width, uint16_t height)
+
+PIXOPS_DECLARE(ref);
+PIXOPS_DECLARE(simd);
+
+typedef struct {
+  const char *name;
+  void (*fill)(const pixops_layer_t *, uint16_t, uint16_t, pixops_color_t);
+  void (*copy)(const pixops_layer_t *, const pixops_layer_t *,
+               uint16_t, uint16_t);
+  void (*convert)(const pixops_layer_t *, const pixops_layer_t *,
+                  uint16_t, uint16_t);
+  void (*blend)(const pixops_layer_t *, const pixops_layer_t *,
+                const pixops_layer_t *, uint16_t, uint16_t);
+} impl_t;
+
+static const impl_t impls[] = {
+  {"reference", refFill, refCopy, refConvert, refBlend},
+  {"fast", pixopsFill, pixopsCopy, pixopsConvert, pixopsBlend},
+  {"simd", simdFill, simdCopy, simdConvert, simdBlend}
+};
+
+#define IMPLS                   (sizeof impls / sizeof impls[0])
+
+static const pixops_fmt_t fmts[] = {
+  PIXOPS_FMT_ARGB8888, PIXOPS_FMT_RGB888, PIXOPS_FMT_RGB565,
+  PIXOPS_FMT_ARGB4444, PIXOPS_FMT_L8
+};
+
+#define FMTS                    (sizeof fmts / sizeof fmts[0])
+#define OUT_FMTS                (FMTS - 1U)   /* L8 is input only.*/
+
+/*===========================================================================*/
+/* Hand computed pixels.                                                     */
+/*===========================================================================*/
+
+static void test_reference(void) {
+  uint32_t out[2], fg[2], bg[2];
+  pixops_layer_t o = {out, 0, PIXOPS_FMT_ARGB8888, NULL, 0, 0};
+  pixops_layer_t f = {fg, 0, PIXOPS_FMT_ARGB8888, NULL,
+                      PIXOPS_ALPHA_KEEP, 0};
+  pixops_layer_t b = {bg, 0, PIXOPS_FMT_ARGB8888, NULL,
+                      PIXOPS_ALPHA_KEEP, 0};
+  uint16_t px[2];
+  unsigned i;
+
+  for (i = 0; i < IMPLS; i++) {
+    /* Half transparent red over opaque blue, transparent over opaque.*/
+    fg[0] = 0x80FF0000U; bg[0] = 0xFF0000FFU;
+    fg[1] = 0x00123456U; bg[1] = 0xFF654321U;
+    impls[i].blend(&o, &f, &b, 2, 1);
+    CHECK(out[0] == 0xFF80007FU);
+    CHECK(out[1] == 0xFF654321U);
+
+    /* Two half transparent pixels, nothing over nothing.*/
+    fg[0] = 0x80FF0000U; bg[0] = 0x800000FFU;
+    fg[1] = 0x00FFFFFFU; bg[1] = 0x00FFFFFFU;
+    impls[i].blend(&o, &f, &b, 2, 1);
+    CHECK(out[0] == 0xC0AA0055U);
+    CHECK(out[1] == 0x00000000U);
+
+    /* Channel expansion and truncation.*/
+    px[0] = 0xF800U; px[1] = 0x07FFU;
+    f.bufferp = px;
+    f.fmt = PIXOPS_FMT_RGB565;
+    impls[i].convert(&o, &f, 2, 1);
+    CHECK(out[0] == 0xFFFF0000U);
+    CHECK(out[1] == 0xFF00FFFFU);
+    f.bufferp = fg;
+    f.fmt = PIXOPS_FMT_ARGB8888;
+
+    o.bufferp = px;
+    o.fmt = PIXOPS_FMT_RGB565;
+    impls[i].fill(&o, 2, 1, 0xFF123456U);
+    CHECK((px[0] == 0x11AAU) && (px[1] == 0x11AAU));
+    o.fmt = PIXOPS_FMT_ARGB4444;
+    fg[0] = 0x11223344U; fg[1] = 0xFFEEDDCCU;
+    f.amode = PIXOPS_ALPHA_MODULATE;
+    f.alpha = 0x80U;
+    impls[i].convert(&o, &f, 2, 1);
+    CHECK((px[0] == 0x0234U) && (px[1] == 0x8EDCU));
+    f.amode = PIXOPS_ALPHA_KEEP;
+    o.bufferp = out;
+    o.fmt = PIXOPS_FMT_ARGB8888;
+  }
+}
+
+/*===========================================================================*/
+/* Random operations.                                                        */
+/*===========================================================================*/
+
+#define CASES                   20000U
+#define MAX_WIDTH               40U
+#define MAX_HEIGHT              8U
+#define MAX_WRAP                5U
+#define BUF_SIZE                ((MAX_WIDTH + MAX_WRAP) * MAX_HEIGHT * 4U + 8U)
+
+static uint32_t seed = 0x12345678U;
+
+static uint32_t rnd(void) {
+
+  seed ^= seed << 13;
+  seed ^= seed >> 17;
+  seed ^= seed << 5;
+  return seed;
+}
+
+static uint32_t rnd_below(uint32_t n) {
+
+  return rnd() % n;
+}
+
+/* Alpha values biased towards the special cases of the fast paths.*/
+static uint8_t rnd_alpha(void) {
+
+  switch (rnd_below(4)) {
+  case 0:
+    return 0x00U;
+  case 1:
+  case 2:
+    return 0xFFU;
+  default:
+    return (uint8_t)rnd();
+  }
+}
+
+static void rnd_fill(uint8_t *p, size_t n) {
+
+  while (n-- > 0U)
+    *p++ = (uint8_t)rnd();
+}
+
+/* Random layer over a random buffer, alpha biased for ARGB8888.*/
+static void rnd_layer(pixops_layer_t *lp, uint8_t *buf, pixops_fmt_t fmt,
+                      const pixops_color_t *clutp) {
+  size_t i;
+
+  rnd_fill(buf, BUF_SIZE);
+  if (fmt == PIXOPS_FMT_ARGB8888) {
+    for (i = 3; i < BUF_SIZE; i += 4)
+      buf[i] = rnd_alpha();
+  }
+  lp->bufferp = buf + rnd_below(4);
+  lp->wrap_offset = rnd_below(2) ? 0U : rnd_below(MAX_WRAP + 1U);
+  lp->fmt = fmt;
+  lp->clutp = clutp;
+  lp->amode = rnd_below(3);
+  lp->alpha = rnd_alpha();
+}
+
+static void test_random(void) {
+  static uint8_t fgbuf[BUF_SIZE], bgbuf[BUF_SIZE];
+  static uint8_t outbuf[IMPLS][BUF_SIZE], outinit[BUF_SIZE];
+  static uint8_t fgcopy[BUF_SIZE], bgcopy[BUF_SIZE];
+  pixops_color_t clut[256];
+  pixops_layer_t out, fg, bg;
+  unsigned n, i, counts[4] = {0, 0, 0, 0};
+
+  for (i = 0; i < 256U; i++)
+    clut[i] = ((uint32_t)rnd_alpha() << 24) | (rnd() & 0x00FFFFFFU);
+
+  for (n = 0; n < CASES; n++) {
+    const unsigned op = rnd_below(4);
+    const uint16_t width = (uint16_t)(1U + rnd_below(MAX_WIDTH));
+    const uint16_t height = (uint16_t)(1U + rnd_below(MAX_HEIGHT));
+    const pixops_color_t color = ((uint32_t)rnd_alpha() << 24) |
+                                 (rnd() & 0x00FFFFFFU);
+    const bool in_place = (op == 3U) && (rnd_below(4) == 0U);
+    size_t offset;
+
+    rnd_layer(&out, outinit, fmts[rnd_below(OUT_FMTS)], NULL);
+    rnd_layer(&fg, fgbuf, fmts[rnd_below(FMTS)], clut);
+    rnd_layer(&bg, bgbuf, fmts[rnd_below(FMTS)], clut);
+    if (op == 1U) {
+      /* Copies are between layers of the same format, L8 included.*/
+      fg.fmt = fmts[rnd_below(FMTS)];
+      out.fmt = fg.fmt;
+    }
+    if (in_place) {
+      bg.fmt = out.fmt;
+      bg.wrap_offset = out.wrap_offset;
+    }
+    memcpy(fgcopy, fgbuf, BUF_SIZE);
+    memcpy(bgcopy, bgbuf, BUF_SIZE);
+    offset = (size_t)((uint8_t *)out.bufferp - outinit);
+
+    for (i = 0; i < IMPLS; i++) {
+      pixops_layer_t o = out, b = bg;
+
+      memcpy(outbuf[i], outinit, BUF_SIZE);
+      o.bufferp = outbuf[i] + offset;
+      if (in_place)
+        b.bufferp = o.bufferp;
+      switch (op) {
+      case 0:
+        impls[i].fill(&o, width, height, color);
+        break;
+      case 1:
+        impls[i].copy(&o, &fg, width, height);
+        break;
+      case 2:
+        impls[i].convert(&o, &fg, width, height);
+        break;
+      default:
+        impls[i].blend(&o, &fg, &b, width, height);
+        break;
+      }
+      if (memcmp(outbuf[i], outbuf[0], BUF_SIZE) != 0) {
+        printf("case %u: %s differs, op %u %ux%u out %u/%u fg %u/%u/%u "
+               "bg %u/%u/%u%s\n", n, impls[i].name, op, width, height,
+               (unsigned)out.fmt, (unsigned)out.wrap_offset,
+               (unsigned)fg.fmt, (unsigned)fg.wrap_offset,
+               (unsigned)fg.amode, (unsigned)bg.fmt,
+               (unsigned)bg.wrap_offset, (unsigned)bg.amode,
+               in_place ? " in place" : "");
+        exit(1);
+      }
+      CHECK(memcmp(fgbuf, fgcopy, BUF_SIZE) == 0);
+      CHECK(memcmp(bgbuf, bgcopy, BUF_SIZE) == 0);
+    }
+    counts[op]++;
+  }
+  CHECK(counts[0] && counts[1] && counts[2] && counts[3]);
+}
+
+/*===========================================================================*/
+/* Timings.                                                                  */
+/*===========================================================================*/
+
+#define FRAME_W                 240U
+#define FRAME_H                 320U
+#define FRAME_RUNS              50U
+
+static double now_us(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e6 + (double)ts.tv_nsec / 1e3;
+}
+
+/* Microseconds per frame of an operation, with an implementation.*/
+static double frame_us(const impl_t *ip, unsigned op) {
+  static uint32_t argb[FRAME_W * FRAME_H];
+  static uint16_t rgb565[FRAME_W * FRAME_H];
+  pixops_layer_t l565 = {rgb565, 0, PIXOPS_FMT_RGB565, NULL, 0, 0};
+  pixops_layer_t l8888 = {argb, 0, PIXOPS_FMT_ARGB8888, NULL,
+                          PIXOPS_ALPHA_KEEP, 0};
+  double start;
+  unsigned n;
+  size_t i;
+
+  for (i = 0; i < FRAME_W * FRAME_H; i++) {
+    argb[i] = ((uint32_t)rnd_alpha() << 24) | (rnd() & 0x00FFFFFFU);
+    rgb565[i] = (uint16_t)rnd();
+  }
+
+  start = now_us();
+  for (n = 0; n < FRAME_RUNS; n++) {
+    switch (op) {
+    case 0:
+      ip->fill(&l565, FRAME_W, FRAME_H, 0xFF000000U | n);
+      break;
+    case 1:
+      ip->convert(&l565, &l8888, FRAME_W, FRAME_H);
+      break;
+    case 2:
+      ip->convert(&l8888, &l565, FRAME_W, FRAME_H);
+      break;
+    default:
+      ip->blend(&l565, &l8888, &l565, FRAME_W, FRAME_H);
+      break;
+    }
+  }
+  return (now_us() - start) / FRAME_RUNS;
+}
+
+static void bench(void) {
+  static const char *const ops[] = {
+    "fill RGB565", "convert ARGB8888 to RGB565",
+    "convert RGB565 to ARGB8888", "blend ARGB8888 over RGB565"
+  };
+  unsigned op;
+
+  for (op = 0; op < 4U; op++) {
+    double ref = frame_us(&impls[0], op);
+    double fast = frame_us(&impls[1], op);
+
+    printf("exact: %ux%u %s, reference %.0fus, fast %.0fus (%.1fx)\n",
+           FRAME_W, FRAME_H, ops[op], ref, fast, ref / fast);
+  }
+}
+
+int main(void) {
+
+  test_reference();
+  test_random();
+  printf("exact: %u random cases, fast and simd paths match the reference\n",
+         CASES);
+  bench();
+  return 0;
+}
@@ -0,0 +1,147 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+ * Frame pacing simulation. A 60Hz display calls presentVblankI() every
+ * 1000 time units, a renderer submits numbered frames at its own rate.
+ * The flip hook checks that the newest submitted frame is shown and that
+ * the renderer never draws into it, the statistics are compared with the
+ * counts expected for each rate and swap interval.
+ */
+
+#include <string.h>
+
+#include "osal.h"
+#include "present.h"
+
+#define VBLANK_PERIOD                       1000U
+#define VBLANKS                             600U
+
+int sim_locked;
+
+typedef struct {
+  const char            *name;
+  uint32_t              period;     /* Renderer frame period.*/
+  uint32_t              offset;     /* First frame submission time.*/
+  uint32_t              interval;   /* Swap interval.*/
+  uint32_t              refuse;     /* Every n-th flip refused, 0 = never.*/
+  uint32_t              frames;
+  uint32_t              presented;
+  uint32_t              skipped;
+  uint32_t              late;
+} scenario_t;
+
+static const scenario_t scenarios[] = {
+  {"120fps",           500U, 100U, 1U, 0U, 1200U, 600U, 600U,   0U},
+  {"60fps",           1000U, 500U, 1U, 0U,  600U, 600U,   0U,   0U},
+  {"40fps",           1500U, 250U, 1U, 0U,  400U, 400U,   0U, 199U},
+  {"30fps",           2000U, 500U, 1U, 0U,  300U, 300U,   0U, 299U},
+  {"30fps interval 2",2000U, 500U, 2U, 0U,  300U, 300U,   0U,   0U},
+  {"120fps interval 2",500U, 100U, 2U, 0U, 1200U, 300U, 900U,   0U},
+  {"60fps busy",      1000U, 500U, 1U, 7U,  600U, 514U,  86U,  86U},
+};
+
+static uint32_t fb[3];
+static present_t present;
+static const scenario_t *sc;
+static uint32_t *back, submitted, shown, flips;
+static uint32_t vblank, last_flip, gaps_late;
+static int fails;
+
+#define CHECK(c)                                                            \
+  do {                                                                      \
+    if (!(c)) {                                                             \
+      printf("FAIL %s:%d %s: %s\n", __FILE__, __LINE__, sc->name, #c);      \
+      fails++;                                                              \
+    }                                                                       \
+  } while (0)
+
+static bool flip(void *arg, void *frontp) {
+  uint32_t frame = *(uint32_t *)frontp;
+
+  (void)arg;
+
+  if ((sc->refuse > 0U) && ((flips++ % sc->refuse) == 3U)) {
+    return false;
+  }
+  CHECK(frontp != back);
+  CHECK(frame == submitted);
+  CHECK(frame > shown);
+  shown = frame;
+  if ((last_flip > 0U) && (vblank - last_flip > sc->interval)) {
+    gaps_late++;
+  }
+  last_flip = vblank;
+  return true;
+}
+
+static void run(const scenario_t *s) {
+  present_stats_t st;
+  uint32_t t, next_frame;
+
+  sc = s;
+  memset(fb, 0, sizeof fb);
+  submitted = shown = flips = vblank = last_flip = gaps_late = 0U;
+  presentObjectInit(&present, flip, NULL, &fb[0], &fb[1], &fb[2]);
+  presentSetInterval(&present, s->interval);
+  back = presentGetBack(&present);
+
+  /* Events in time order, a blanking preempts a submission at the same
+     time.*/
+  next_frame = s->offset;
+  for (t = 1U; t <= VBLANKS * VBLANK_PERIOD; t++) {
+    if ((t % VBLANK_PERIOD) == 0U) {
+      vblank++;
+      osalSysLock();
+      presentVblankI(&present);
+      osalSysUnlock();
+    }
+    if (t == next_frame) {
+      CHECK(back != presentGetFrontI(&present));
+      *back = ++submitted;
+      back = presentSwap(&present);
+      next_frame += s->period;
+    }
+  }
+
+  presentGetStats(&present, &st);
+  CHECK(sim_locked == 0);
+  CHECK(st.vblanks == VBLANKS);
+  CHECK(submitted == s->frames);
+  CHECK(st.presented == s->presented);
+  CHECK(st.skipped == s->skipped);
+  CHECK(st.late == s->late);
+  CHECK(st.late == gaps_late);
+  CHECK(st.presented + st.skipped +
+        (nbufIsReady(&present.nbuf) ? 1U : 0U) == submitted);
+  printf("%-18s vblanks %u presented %u skipped %u late %u\n",
+         s->name, st.vblanks, st.presented, st.skipped, st.late);
+
+  presentResetStats(&present);
+  presentGetStats(&present, &st);
+  CHECK((st.vblanks == 0U) && (st.presented == 0U) &&
+        (st.skipped == 0U) && (st.late == 0U));
+}
+
+int main(void) {
+  size_t i;
+
+  for (i = 0U; i < sizeof scenarios / sizeof scenarios[0]; i++) {
+    run(&scenarios[i]);
+  }
+  printf("%s\n", fails ? "FAILED" : "PASSED");
+  return fails != 0;
+}
@@ -0,0 +1,116 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+ * DPSRAM allocation: endpoint buffers are aligned, inside the data area
+ * and never overlap; re-initializing endpoints and changing configuration
+ * reclaims their buffers instead of running out of DPSRAM.
+ */
+
+#include "sim_rpusb.h"
+
+#define EPS                                 (USB_MAX_ENDPOINTS - 1U)
+
+static USBInEndpointState in_states[USB_MAX_ENDPOINTS];
+static USBOutEndpointState out_states[USB_MAX_ENDPOINTS];
+static USBEndpointConfig configs[USB_MAX_ENDPOINTS];
+static const USBConfig config = {NULL, NULL, NULL, NULL};
+
+typedef struct {
+  uintptr_t start, end;
+} area_t;
+
+static unsigned collect(area_t *areas) {
+  const uintptr_t data = (uintptr_t)USB_DPSRAM->DATA;
+  unsigned n = 0, ep;
+
+  for (ep = 1; ep <= EPS; ep++) {
+    const USBEndpointConfig *epcp = USBD1.epc[ep];
+
+    if (epcp == NULL)
+      continue;
+    if (epcp->in_state != NULL) {
+      areas[n].start = (uintptr_t)epcp->in_state->hw_buf;
+      areas[n].end = areas[n].start + 2U * epcp->in_state->buf_size;
+      n++;
+    }
+    if (epcp->out_state != NULL) {
+      areas[n].start = (uintptr_t)epcp->out_state->hw_buf;
+      areas[n].end = areas[n].start + epcp->out_state->buf_size;
+      n++;
+    }
+  }
+  for (unsigned i = 0; i < n; i++) {
+    CHECK((areas[i].start - (uintptr_t)USB_DPSRAM) % 64U == 0U);
+    CHECK((areas[i].start >= data) &&
+          (areas[i].end <= data + sizeof(USB_DPSRAM->DATA)));
+    for (unsigned j = 0; j < i; j++)
+      CHECK((areas[i].end <= areas[j].start) ||
+            (areas[j].end <= areas[i].start));
+  }
+  return n;
+}
+
+static void configure(usbep_t ep, uint32_t mode, uint16_t in_size,
+                      uint16_t out_size) {
+  USBEndpointConfig *epcp = &configs[ep];
+
+  epcp->ep_mode     = mode;
+  epcp->in_maxsize  = in_size;
+  epcp->out_maxsize = out_size;
+  epcp->in_state    = (in_size > 0U) ? &in_states[ep] : NULL;
+  epcp->out_state   = (out_size > 0U) ? &out_states[ep] : NULL;
+  USBD1.epc[ep]     = epcp;
+  usb_lld_init_endpoint(&USBD1, ep);
+}
+
+int main(void) {
+  area_t areas[2U * USB_MAX_ENDPOINTS];
+  unsigned ep, round;
+
+  sim_start(&config);
+
+  /* All the bulk endpoints, then re-initialized many times.*/
+  for (ep = 1; ep <= EPS; ep++)
+    configure(ep, USB_EP_MODE_TYPE_BULK, 64, 64);
+  CHECK(collect(areas) == 2U * EPS);
+  for (round = 0; round < 100U; round++) {
+    ep = 1U + round % EPS;
+    configure(ep, USB_EP_MODE_TYPE_BULK, 64, 64);
+    CHECK(collect(areas) == 2U * EPS);
+  }
+
+  /* New configuration: two 1023 bytes isochronous endpoints need all of
+     the DPSRAM released by the previous one.*/
+  usb_lld_disable_endpoints(&USBD1);
+  for (ep = 1; ep <= EPS; ep++)
+    USBD1.epc[ep] = NULL;
+  configure(1, USB_EP_MODE_TYPE_ISOC, 1023, 0);
+  configure(2, USB_EP_MODE_TYPE_ISOC, 0, 1023);
+  configure(3, USB_EP_MODE_TYPE_BULK, 64, 64);
+  CHECK(collect(areas) == 4U);
+  CHECK(in_states[1].buf_size == 1024U);
+  CHECK(out_states[2].buf_size == 1024U);
+
+  /* Bus reset, then the first configuration again.*/
+  usb_lld_reset(&USBD1);
+  for (ep = 1; ep <= EPS; ep++)
+    configure(ep, USB_EP_MODE_TYPE_BULK, 64, 64);
+  CHECK(collect(areas) == 2U * EPS);
+
+  printf("dpsram: %u endpoints, reconfiguration and reset ok\n", EPS);
+  return 0;
+}
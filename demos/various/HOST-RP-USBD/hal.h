@@ -0,0 +1,157 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+ * Host build of the RP USB device low level driver: the controller
+ * registers and the DPSRAM are plain memory driven by a host model
+ * (sim_rpusb.c), the OSAL and the high level driver are reduced to what
+ * the low level driver uses.
+ */
+
+#ifndef HAL_H
+#define HAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TRUE                                1
+#define FALSE                               0
+
+#define HAL_USE_USB                         TRUE
+#define USB_USE_WAIT                        FALSE
+
+#include "mcuconf.h"
+
+#define __IO                                volatile
+
+#define osalDbgCheck(c)                                                     \
+  do { if (!(c)) { printf("check %s:%d\n", __FILE__, __LINE__); abort(); } } while (0)
+#define osalDbgAssert(c, m)                                                 \
+  do { if (!(c)) { printf("assert %s:%d %s\n", __FILE__, __LINE__, m); abort(); } } while (0)
+#define osalSysHalt(m)                      abort()
+
+#define OSAL_IRQ_HANDLER(id)                void id(void)
+#define OSAL_IRQ_PROLOGUE()
+#define OSAL_IRQ_EPILOGUE()
+#define RP_USBCTRL_IRQ_HANDLER              sim_usb_isr
+#define RP_USBCTRL_IRQ_NUMBER               5
+#define nvicEnableVector(n, p)              ((void)(n), (void)(p))
+#define nvicDisableVector(n)                (void)(n)
+#define RESETS_ALLREG_USBCTRL               (1U << 24)
+#define hal_lld_peripheral_reset(m)         (void)(m)
+#define hal_lld_peripheral_unreset(m)       (void)(m)
+
+/* Controller registers, the SET and CLR aliases are applied by the model
+   after each access sequence.*/
+#define SIM_USB_REGS                                                        \
+  __IO uint32_t DEVADDRCTRL;                                                \
+  __IO uint32_t SOFRD;                                                      \
+  __IO uint32_t MAINCTRL;                                                   \
+  __IO uint32_t SIECTRL;                                                    \
+  __IO uint32_t SIESTATUS;                                                  \
+  __IO uint32_t EPSTALLARM;                                                 \
+  __IO uint32_t BUFSTATUS;                                                  \
+  __IO uint32_t MUXING;                                                     \
+  __IO uint32_t PWR;                                                        \
+  __IO uint32_t INTE;                                                       \
+  __IO uint32_t INTS;
+
+typedef struct {
+  SIM_USB_REGS
+} sim_usb_alias_t;
+
+typedef struct {
+  SIM_USB_REGS
+  sim_usb_alias_t       XOR;
+  sim_usb_alias_t       SET;
+  sim_usb_alias_t       CLR;
+} USB_TypeDef;
+
+extern USB_TypeDef sim_usb;
+#define USB                                 (&sim_usb)
+
+/* High level driver subset.*/
+typedef struct USBDriver USBDriver;
+typedef uint8_t usbep_t;
+
+typedef enum {
+  USB_UNINIT = 0, USB_STOP = 1, USB_READY = 2, USB_SELECTED = 3,
+  USB_ACTIVE = 4, USB_SUSPENDED = 5
+} usbstate_t;
+
+typedef enum {
+  EP_STATUS_DISABLED = 0, EP_STATUS_STALLED = 1, EP_STATUS_ACTIVE = 2
+} usbepstatus_t;
+
+typedef enum {
+  USB_EP0_STP_WAITING = 0
+} usbep0state_t;
+
+#define USB_EP_MODE_TYPE_CTRL               0x0000U
+#define USB_EP_MODE_TYPE_ISOC               0x0001U
+#define USB_EP_MODE_TYPE_BULK               0x0002U
+#define USB_EP_MODE_TYPE_INTR               0x0003U
+
+#define USB_EP0_STATUS_STAGE_SW             0
+#define USB_SET_ADDRESS_ACK_SW              0
+#define USB_LATE_SET_ADDRESS                1
+
+typedef void (*usbcallback_t)(USBDriver *usbp);
+typedef void (*usbepcallback_t)(USBDriver *usbp, usbep_t ep);
+typedef void (*usbeventcb_t)(USBDriver *usbp, int event);
+typedef const void *(*usbgetdescriptor_t)(USBDriver *usbp, uint8_t dtype,
+                                          uint8_t dindex, uint16_t lang);
+typedef bool (*usbreqhandler_t)(USBDriver *usbp);
+
+#include "hal_usb_lld.h"
+
+void _usb_ep0setup(USBDriver *usbp, usbep_t ep);
+void _usb_ep0in(USBDriver *usbp, usbep_t ep);
+void _usb_ep0out(USBDriver *usbp, usbep_t ep);
+void _usb_reset(USBDriver *usbp);
+void _usb_suspend(USBDriver *usbp);
+void _usb_wakeup(USBDriver *usbp);
+
+static inline void usbObjectInit(USBDriver *usbp) {
+
+  usbp->state  = USB_STOP;
+  usbp->config = NULL;
+}
+
+#define _usb_isr_invoke_setup_cb(usbp, ep)                                  \
+  (usbp)->epc[ep]->setup_cb(usbp, ep)
+#define _usb_isr_invoke_in_cb(usbp, ep)                                     \
+  do {                                                                      \
+    (usbp)->transmitting &= ~(1U << (ep));                                  \
+    if ((usbp)->epc[ep]->in_cb != NULL)                                     \
+      (usbp)->epc[ep]->in_cb(usbp, ep);                                     \
+  } while (0)
+#define _usb_isr_invoke_out_cb(usbp, ep)                                    \
+  do {                                                                      \
+    (usbp)->receiving &= ~(1U << (ep));                                     \
+    if ((usbp)->epc[ep]->out_cb != NULL)                                    \
+      (usbp)->epc[ep]->out_cb(usbp, ep);                                    \
+  } while (0)
+#define _usb_isr_invoke_sof_cb(usbp)                                        \
+  do {                                                                      \
+    if ((usbp)->config->sof_cb != NULL)                                     \
+      (usbp)->config->sof_cb(usbp);                                         \
+  } while (0)
+
+#endif /* HAL_H */
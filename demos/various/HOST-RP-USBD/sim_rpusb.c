@@ -0,0 +1,154 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+ * Host model of the RP USB device controller, non control endpoints only.
+ * A packet goes to the buffer selected by the controller if the driver has
+ * made it available, otherwise it is NAKed. Double buffered endpoints
+ * alternate between the buffers, starting from the first one after a write
+ * with the reset bit.
+ */
+
+#include <string.h>
+#include <sys/mman.h>
+
+#include "sim_rpusb.h"
+
+USB_TypeDef sim_usb;
+unsigned long sim_isrs;
+unsigned long sim_naks;
+unsigned long sim_pid_errors;
+
+void sim_usb_isr(void);
+
+/* Buffer selected by the controller and host data toggle, per direction.*/
+static uint8_t ctrl_buf[USB_MAX_ENDPOINTS + 1][2];
+static uint8_t host_pid[USB_MAX_ENDPOINTS + 1][2];
+
+void _usb_ep0setup(USBDriver *usbp, usbep_t ep) { (void)usbp; (void)ep; }
+void _usb_ep0in(USBDriver *usbp, usbep_t ep) { (void)usbp; (void)ep; }
+void _usb_ep0out(USBDriver *usbp, usbep_t ep) { (void)usbp; (void)ep; }
+void _usb_reset(USBDriver *usbp) { (void)usbp; }
+void _usb_suspend(USBDriver *usbp) { (void)usbp; }
+void _usb_wakeup(USBDriver *usbp) { (void)usbp; }
+
+void sim_start(const USBConfig *config) {
+  void *p;
+
+  p = mmap(USB_DPSRAM, 4096, PROT_READ | PROT_WRITE,
+           MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+  CHECK(p == (void *)USB_DPSRAM);
+  usb_lld_init();
+  USBD1.config = config;
+  usb_lld_start(&USBD1);
+  USBD1.state = USB_ACTIVE;
+}
+
+/* Selects the buffer the controller uses next, NULL if none is available.*/
+static volatile uint16_t *select_buf(usbep_t ep, bool is_in, unsigned *idx) {
+  volatile uint32_t *ctrl = is_in ? &USB_DPSRAM->BUFCTRL[ep].IN
+                                  : &USB_DPSRAM->BUFCTRL[ep].OUT;
+  const uint32_t ep_ctrl = is_in ? USB_DPSRAM->EPCTRL[ep - 1].IN
+                                 : USB_DPSRAM->EPCTRL[ep - 1].OUT;
+  volatile uint16_t *half;
+
+  if (!(ep_ctrl & USB_EP_EN) || (*ctrl & USB_BUFFER_STALL))
+    return NULL;
+  if (*ctrl & USB_BUFFER_RESET_BUFFER) {
+    *ctrl &= ~USB_BUFFER_RESET_BUFFER;
+    ctrl_buf[ep][is_in] = 0;
+  }
+  if (!(ep_ctrl & USB_EP_BUFFER_DOUBLE))
+    ctrl_buf[ep][is_in] = 0;
+  *idx = ctrl_buf[ep][is_in];
+  half = &((volatile uint16_t *)ctrl)[*idx];
+  if (!(*half & USB_BUFFER_BUFFER0_AVAILABLE))
+    return NULL;
+  return half;
+}
+
+static uint8_t *buf_addr(usbep_t ep, bool is_in, unsigned idx) {
+  const uint32_t ep_ctrl = is_in ? USB_DPSRAM->EPCTRL[ep - 1].IN
+                                 : USB_DPSRAM->EPCTRL[ep - 1].OUT;
+
+  return (uint8_t *)USB_DPSRAM + (ep_ctrl & 0xFFC0U) + idx * 64U;
+}
+
+static void buf_done(usbep_t ep, bool is_in, volatile uint16_t *half,
+                     uint16_t len) {
+  const uint32_t ep_ctrl = is_in ? USB_DPSRAM->EPCTRL[ep - 1].IN
+                                 : USB_DPSRAM->EPCTRL[ep - 1].OUT;
+  uint16_t v = *half;
+
+  if (((v & USB_BUFFER_BUFFER0_DATA_PID) != 0) != host_pid[ep][is_in])
+    sim_pid_errors++;
+  host_pid[ep][is_in] ^= 1U;
+  v &= ~(USB_BUFFER_BUFFER0_AVAILABLE | USB_BUFFER_BUFFER0_TRANS_LENGTH_Msk);
+  v = is_in ? (v & ~USB_BUFFER_BUFFER0_FULL) : (v | USB_BUFFER_BUFFER0_FULL);
+  *half = v | len;
+  if (ep_ctrl & USB_EP_BUFFER_DOUBLE)
+    ctrl_buf[ep][is_in] ^= 1U;
+  USB->BUFSTATUS |= 1U << (ep * 2U + (is_in ? 0U : 1U));
+  USB->INTS |= USB_INTS_BUFF_STATUS;
+}
+
+bool sim_host_out(usbep_t ep, const uint8_t *data, uint16_t len) {
+  volatile uint16_t *half;
+  unsigned idx;
+
+  half = select_buf(ep, false, &idx);
+  if (half == NULL) {
+    sim_naks++;
+    return false;
+  }
+  /* A packet longer than the buffer is a babble error of the device.*/
+  CHECK(len <= (*half & USB_BUFFER_BUFFER0_TRANS_LENGTH_Msk));
+  memcpy(buf_addr(ep, false, idx), data, len);
+  buf_done(ep, false, half, len);
+  return true;
+}
+
+int sim_host_in(usbep_t ep, uint8_t *data) {
+  volatile uint16_t *half;
+  unsigned idx;
+  uint16_t len;
+
+  half = select_buf(ep, true, &idx);
+  if (half == NULL) {
+    sim_naks++;
+    return -1;
+  }
+  CHECK(*half & USB_BUFFER_BUFFER0_FULL);
+  len = *half & USB_BUFFER_BUFFER0_TRANS_LENGTH_Msk;
+  memcpy(data, buf_addr(ep, true, idx), len);
+  buf_done(ep, true, half, len);
+  return len;
+}
+
+void sim_irq(void) {
+  uint32_t status;
+
+  if (!(USB->INTS & USB->INTE))
+    return;
+  sim_isrs++;
+  status = USB->BUFSTATUS;
+  sim_usb_isr();
+  USB->BUFSTATUS &= ~status;
+  memset(&USB->CLR, 0, sizeof(USB->CLR));
+  memset(&USB->SET, 0, sizeof(USB->SET));
+  if (USB->BUFSTATUS == 0U)
+    USB->INTS &= ~USB_INTS_BUFF_STATUS;
+}
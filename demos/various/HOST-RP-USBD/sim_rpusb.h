@@ -0,0 +1,49 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/* Host model of the RP USB device controller.*/
+
+#ifndef SIM_RPUSB_H
+#define SIM_RPUSB_H
+
+#include "hal.h"
+
+#define CHECK(c)                                                            \
+  do {                                                                      \
+    if (!(c)) {                                                             \
+      printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #c);                    \
+      exit(1);                                                              \
+    }                                                                       \
+  } while (0)
+
+/* Counters.*/
+extern unsigned long sim_isrs;
+extern unsigned long sim_naks;
+extern unsigned long sim_pid_errors;
+
+/* Maps the DPSRAM at its address, starts the driver.*/
+void sim_start(const USBConfig *config);
+
+/* The host sends an OUT packet, returns false if it was NAKed.*/
+bool sim_host_out(usbep_t ep, const uint8_t *data, uint16_t len);
+
+/* The host reads an IN packet, returns its length or -1 if NAKed.*/
+int sim_host_in(usbep_t ep, uint8_t *data);
+
+/* Raises the controller interrupt if there is a pending event.*/
+void sim_irq(void);
+
+#endif /* SIM_RPUSB_H */
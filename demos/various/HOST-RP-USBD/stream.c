@@ -0,0 +1,195 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+ * Bulk streams through the host model. The host sends OUT transfers of
+ * random lengths, each ended by a short packet, while the device receives
+ * with random sizes; the interrupt is served late, after up to two more
+ * packets have been tried by the host. The same is done with IN transfers.
+ * The bytes received must be the bytes sent, in order.
+ */
+
+#include <string.h>
+
+#include "sim_rpusb.h"
+
+#define EP_OUT                              1U
+#define EP_IN                               2U
+#define STREAM_SIZE                         (256U * 1024U)
+
+static uint8_t tx_stream[STREAM_SIZE];
+static uint8_t rx_stream[STREAM_SIZE + 1024U];
+static uint32_t seed = 12345U;
+
+static uint32_t rnd(uint32_t n) {
+
+  seed = seed * 1103515245U + 12345U;
+  return (seed >> 8) % n;
+}
+
+static bool out_done, in_done;
+
+static void out_cb(USBDriver *usbp, usbep_t ep) { (void)usbp; (void)ep; out_done = true; }
+static void in_cb(USBDriver *usbp, usbep_t ep) { (void)usbp; (void)ep; in_done = true; }
+
+static USBInEndpointState ep_in_state;
+static USBOutEndpointState ep_out_state;
+
+static const USBEndpointConfig ep_out_config = {
+  USB_EP_MODE_TYPE_BULK, NULL, NULL, out_cb, 0, 64, NULL, &ep_out_state
+};
+static const USBEndpointConfig ep_in_config = {
+  USB_EP_MODE_TYPE_BULK, NULL, in_cb, NULL, 64, 0, &ep_in_state, NULL
+};
+static const USBConfig config = {NULL, NULL, NULL, NULL};
+
+static void start_receive(uint8_t *buf, size_t n) {
+
+  ep_out_state.rxbuf  = buf;
+  ep_out_state.rxsize = n;
+  ep_out_state.rxcnt  = 0;
+  USBD1.receiving |= 1U << EP_OUT;
+  usb_lld_start_out(&USBD1, EP_OUT);
+}
+
+static void start_transmit(const uint8_t *buf, size_t n) {
+
+  ep_in_state.txbuf  = buf;
+  ep_in_state.txsize = n;
+  ep_in_state.txcnt  = 0;
+  USBD1.transmitting |= 1U << EP_IN;
+  usb_lld_start_in(&USBD1, EP_IN);
+}
+
+/* Serves the interrupt after 0 to 2 host attempts.*/
+static void late_irq(void) {
+  static unsigned pending;
+
+  if (pending == 0U)
+    pending = 1U + rnd(3);
+  if (--pending == 0U)
+    sim_irq();
+}
+
+static void test_out(void) {
+  size_t sent = 0, received = 0, xfer_left = 0, progress = 0;
+  unsigned long packets = 0, isrs = sim_isrs, naks = sim_naks;
+  unsigned delay = 0, idle = 0;
+
+  start_receive(rx_stream, 64U * (1U + rnd(8)));
+  while (received < STREAM_SIZE) {
+    /* Host side: next packet of the current transfer, short at its end.*/
+    if (sent < STREAM_SIZE) {
+      uint16_t len;
+
+      if (xfer_left == 0U) {
+        xfer_left = 1U + rnd(300);
+        if (xfer_left > STREAM_SIZE - sent)
+          xfer_left = STREAM_SIZE - sent;
+      }
+      len = xfer_left < 64U ? (uint16_t)xfer_left : 64U;
+      if (sim_host_out(EP_OUT, &tx_stream[sent], len)) {
+        packets++;
+        sent += len;
+        xfer_left -= len;
+      }
+    }
+    late_irq();
+
+    /* Device side: the application restarts the receive a bit later.*/
+    if (out_done) {
+      if (delay == 0U)
+        delay = 1U + rnd(3);
+      if (--delay == 0U) {
+        out_done = false;
+        received += ep_out_state.rxcnt;
+        start_receive(&rx_stream[received], 64U * (1U + rnd(8)));
+      }
+    }
+    CHECK(sent >= received);
+    /* Lost packets stall the stream.*/
+    idle = (sent + received != progress) ? 0U : idle + 1U;
+    progress = sent + received;
+    CHECK(idle < 1000U);
+  }
+  CHECK(received == STREAM_SIZE);
+  CHECK(memcmp(tx_stream, rx_stream, STREAM_SIZE) == 0);
+  CHECK(sim_pid_errors == 0);
+  printf("stream: OUT %u bytes, %lu packets, %.2f interrupts and %.2f NAKs "
+         "per packet\n", STREAM_SIZE, packets,
+         (double)(sim_isrs - isrs) / packets,
+         (double)(sim_naks - naks) / packets);
+}
+
+static void test_in(void) {
+  size_t queued = 0, received = 0;
+  unsigned long packets = 0, isrs = sim_isrs, naks = sim_naks;
+  unsigned delay = 0, idle = 0;
+  size_t n;
+
+  n = 1U + rnd(600);
+  start_transmit(tx_stream, n);
+  queued = n;
+  while (received < STREAM_SIZE) {
+    int len = sim_host_in(EP_IN, &rx_stream[received]);
+
+    if (len >= 0) {
+      packets++;
+      received += (size_t)len;
+      CHECK(received <= queued);
+    }
+    idle = (len > 0) ? 0U : idle + 1U;
+    CHECK(idle < 1000U);
+    late_irq();
+
+    if (in_done && (queued < STREAM_SIZE)) {
+      if (delay == 0U)
+        delay = 1U + rnd(3);
+      if (--delay == 0U) {
+        in_done = false;
+        CHECK(ep_in_state.txcnt == n);
+        n = 1U + rnd(600);
+        if (n > STREAM_SIZE - queued)
+          n = STREAM_SIZE - queued;
+        start_transmit(&tx_stream[queued], n);
+        queued += n;
+      }
+    }
+  }
+  CHECK(memcmp(tx_stream, rx_stream, STREAM_SIZE) == 0);
+  CHECK(sim_pid_errors == 0);
+  printf("stream: IN  %u bytes, %lu packets, %.2f interrupts and %.2f NAKs "
+         "per packet\n", STREAM_SIZE, packets,
+         (double)(sim_isrs - isrs) / packets,
+         (double)(sim_naks - naks) / packets);
+}
+
+int main(void) {
+  unsigned i;
+
+  for (i = 0; i < STREAM_SIZE; i++)
+    tx_stream[i] = (uint8_t)rnd(256);
+
+  sim_start(&config);
+  USBD1.epc[EP_OUT] = &ep_out_config;
+  USBD1.epc[EP_IN]  = &ep_in_config;
+  usb_lld_init_endpoint(&USBD1, EP_OUT);
+  usb_lld_init_endpoint(&USBD1, EP_IN);
+
+  test_out();
+  test_in();
+  return 0;
+}
@@ -0,0 +1,69 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+ * Host build of the STM32 OTG host driver: the kernel is the simulation of
+ * HOST-USBH (osal.h), the OTG core is a register level model (sim_otg.h).
+ */
+
+#ifndef HAL_H
+#define HAL_H
+
+#include "osal.h"
+
+#define HAL_USE_USBH                        TRUE
+#define USBH_DEBUG_ENABLE                   FALSE
+#define USBH_DEBUG_MULTI_HOST               FALSE
+#define USBH_DEBUG_ENABLE_TRACE             FALSE
+#define USBH_DEBUG_ENABLE_INFO              FALSE
+#define USBH_DEBUG_ENABLE_WARNINGS          FALSE
+#define USBH_DEBUG_ENABLE_ERRORS            FALSE
+#define USBH_DEBUG_BUFFER                   256
+#define USBH_LLD_DEBUG_ENABLE_TRACE         FALSE
+#define USBH_LLD_DEBUG_ENABLE_INFO          FALSE
+#define USBH_LLD_DEBUG_ENABLE_WARNINGS      FALSE
+#define USBH_LLD_DEBUG_ENABLE_ERRORS        FALSE
+
+#define HAL_USBH_PORT_DEBOUNCE_TIME         200
+#define HAL_USBH_PORT_RESET_TIMEOUT         500
+#define HAL_USBH_DEVICE_ADDRESS_STABILIZATION 20
+#define HAL_USBH_CONTROL_REQUEST_DEFAULT_TIMEOUT OSAL_MS2I(1000)
+
+/* mcuconf.h settings of the STM32F4 testhal.*/
+#define STM32_USBH_USE_OTG1                 TRUE
+#define STM32_USBH_USE_OTG2                 FALSE
+#define STM32_USB_OTG1_IRQ_PRIORITY         14
+#define STM32_USBH_MIN_QSPACE               4
+#define STM32_USBH_CHANNELS_NP              4
+#define STM32_OTG_STEPPING                  1
+
+/* Platform stubs.*/
+#define STM32_OTG1_NUMBER                   67
+#define STM32_OTG1_HANDLER                  sim_otg_isr
+#define OSAL_IRQ_HANDLER(id)                void id(void)
+#define OSAL_IRQ_PROLOGUE()
+#define OSAL_IRQ_EPILOGUE()
+#define osalSysPolledDelayX(c)              ((void)(c))
+#define nvicEnableVector(n, p)              ((void)(n), (void)(p))
+#define nvicDisableVector(n)                ((void)(n))
+#define rccEnableOTG_FS(lp)                 ((void)(lp))
+#define rccDisableOTG_FS()
+#define rccResetOTG_FS()
+
+#include "stm32_otg.h"
+#include "hal_usbh.h"
+
+#endif /* HAL_H */
@@ -0,0 +1,235 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+ * Bulk IN NAK handling of the STM32 OTG host driver: the back-off of idle
+ * endpoints, the wake up latency when data shows up, the sharing of the
+ * non periodic channels between more Bulk IN endpoints than channels and
+ * the per-endpoint counters.
+ *
+ * Built twice: naks with the default settings, naks_flood with a NAK
+ * limit and back-off that never engage, to show the interrupt rate the
+ * back-off saves.
+ */
+
+#include <string.h>
+
+#include "sim_otg.h"
+
+#define FRAMES                              4096U
+#define SHARED                              (STM32_USBH_CHANNELS_NP + 2)
+
+static usbh_ep_t eps[SHARED + 1];
+static usbh_urb_t urbs[SHARED + 1];
+USBH_DEFINE_BUFFER(static uint8_t buffers[SHARED + 1][64]);
+
+/* Device: packets ready per endpoint, or the odds of one being ready.*/
+static unsigned avail[16];
+static unsigned odds[16];
+static unsigned long tokens[16], naks[16];
+static unsigned long done[SHARED + 1], errors;
+static uint32_t seed = 1;
+
+static int device(uint8_t addr, uint8_t ep, uint16_t mps) {
+
+  CHECK(addr == 1);
+  tokens[ep]++;
+  if (avail[ep] > 0) {
+    avail[ep]--;
+    return 10;                              /* short packet, URB done */
+  }
+  if (odds[ep] > 0) {
+    seed = seed * 1103515245U + 12345U;
+    if (((seed >> 16) % odds[ep]) == 0)
+      return mps;
+  }
+  naks[ep]++;
+  return SIM_NAK;
+}
+
+/* Resubmits the URB, as the class drivers reading bulk IN streams do.*/
+static void read_cb(usbh_urb_t *urb) {
+  const unsigned i = (unsigned)(urb - urbs);
+
+  if (urb->status == USBH_URBSTATUS_DISCONNECTED)
+    return;
+  if (urb->status == USBH_URBSTATUS_OK)
+    done[i]++;
+  else if (urb->status != USBH_URBSTATUS_TIMEOUT)     /* INT IN NAK */
+    errors++;
+  usbhURBObjectResetI(urb);
+  usbhURBSubmitI(urb);
+}
+
+static void open_ep(unsigned i, usbh_device_t *dev, uint8_t n, uint8_t type,
+                    uint16_t mps) {
+  const usbh_endpoint_descriptor_t d = {7, 5, (uint8_t)(0x80U | n), type, mps,
+                                        (uint8_t)(type == USBH_EPTYPE_INT)};
+
+  usbhEPObjectInit(&eps[i], dev, &d);
+  CHECK(usbhEPOpen(&eps[i]) == HAL_SUCCESS);
+  usbhURBObjectInit(&urbs[i], &eps[i], read_cb, NULL, buffers[i], mps);
+  osalSysLock();
+  usbhURBSubmitI(&urbs[i]);
+  osalSysUnlock();
+}
+
+static void reset_stats(void) {
+
+  memset(tokens, 0, sizeof(tokens));
+  memset(naks, 0, sizeof(naks));
+  memset(done, 0, sizeof(done));
+  sim_otg_reset_counters();
+}
+
+static void close_all(void) {
+  unsigned i;
+
+  for (i = 0; i <= SHARED; i++) {
+    if (eps[i].status == USBH_EPSTATUS_OPEN)
+      usbhEPClose(&eps[i]);
+  }
+  memset(avail, 0, sizeof(avail));
+  memset(odds, 0, sizeof(odds));
+}
+
+/* An idle Bulk IN endpoint, the device NAKs every token.*/
+static void test_idle(usbh_device_t *dev) {
+  double irqs;
+
+  open_ep(0, dev, 1, USBH_EPTYPE_BULK, 64);
+  sim_run(64);
+  reset_stats();
+  sim_run(FRAMES);
+  irqs = (double)sim_otg_irqs / FRAMES;
+
+  CHECK(errors == 0 && done[0] == 0);
+  CHECK(eps[0].nak_count >= naks[1]);
+#if STM32_USBH_BULK_NAK_BACKOFF_MAX > 1
+  /* Sleeping costs no SOF interrupts, a burst of NAKs per back-off period.*/
+  CHECK(sim_otg_sofs == 0);
+  CHECK(!(sim_otg.GINTMSK & GINTMSK_SOFM));
+  CHECK(tokens[1] <= (FRAMES / STM32_USBH_BULK_NAK_BACKOFF_MAX + 1)
+                     * STM32_USBH_BULK_NAK_LIMIT);
+  CHECK(irqs < 2.0 * STM32_USBH_BULK_NAK_LIMIT / STM32_USBH_BULK_NAK_BACKOFF_MAX);
+#endif
+
+  printf("naks: idle Bulk IN, NAK limit %d, back-off %d: per frame %.2f NAKs, "
+         "%.2f ISR calls, %.2f SOF IRQs, %.0f ns in the ISR (host)\n",
+         STM32_USBH_BULK_NAK_LIMIT, STM32_USBH_BULK_NAK_BACKOFF_MAX,
+         (double)naks[1] / FRAMES, irqs, (double)sim_otg_sofs / FRAMES,
+         (double)sim_otg_isr_ns / FRAMES);
+  close_all();
+}
+
+/* Data shows up on an endpoint sleeping at the longest back-off.*/
+static void test_wake(usbh_device_t *dev) {
+  unsigned i, worst = 0;
+
+  open_ep(0, dev, 1, USBH_EPTYPE_BULK, 64);
+  for (i = 0; i < 64; i++) {
+    unsigned frames = 0;
+
+    sim_run(64 + i % 7);
+    CHECK(eps[0].nak_backoff == STM32_USBH_BULK_NAK_BACKOFF_MAX);
+    done[0] = 0;
+    avail[1] = 1;
+    while (done[0] == 0) {
+      sim_run(1);
+      frames++;
+      CHECK(frames <= STM32_USBH_BULK_NAK_BACKOFF_MAX + 1);
+    }
+    /* data restarts the back-off */
+    CHECK(eps[0].nak_backoff == 0 || eps[0].nak_backoff == 1);
+    if (frames > worst)
+      worst = frames;
+  }
+  CHECK(errors == 0);
+
+  printf("naks: data on a sleeping endpoint received within %u frames\n", worst);
+  close_all();
+}
+
+/* More Bulk IN endpoints than non periodic channels, a packet ready on
+   one token in four.*/
+static void test_share(usbh_device_t *dev) {
+  unsigned long min = ~0UL, max = 0;
+  unsigned i;
+
+  for (i = 0; i < SHARED; i++) {
+    odds[i + 1] = 4;
+    open_ep(i, dev, (uint8_t)(i + 1), USBH_EPTYPE_BULK, 64);
+  }
+  sim_run(64);
+  reset_stats();
+  sim_run(FRAMES);
+
+  CHECK(errors == 0);
+  for (i = 0; i < SHARED; i++) {
+    if (done[i] < min)
+      min = done[i];
+    if (done[i] > max)
+      max = done[i];
+  }
+  CHECK(min > 0);
+  CHECK(min * 10 >= max * 8);
+
+  printf("naks: %u Bulk IN endpoints on %u channels: %.1f to %.1f packets "
+         "per frame each, %.2f ISR calls per frame\n",
+         SHARED, STM32_USBH_CHANNELS_NP, (double)min / FRAMES,
+         (double)max / FRAMES, (double)sim_otg_irqs / FRAMES);
+  close_all();
+}
+
+/* NAKs are counted on the Bulk endpoint, not on the polled INT one.*/
+static void test_counters(usbh_device_t *dev) {
+
+  reset_stats();
+  open_ep(0, dev, 1, USBH_EPTYPE_BULK, 64);
+  open_ep(1, dev, 2, USBH_EPTYPE_INT, 8);
+  odds[1] = 8;
+  sim_run(FRAMES);
+
+  CHECK(errors == 0);
+  CHECK(naks[2] > FRAMES / 2);
+  CHECK(eps[1].nak_count == 0);
+  CHECK(eps[1].int_count >= tokens[2]);
+  CHECK(eps[0].nak_count == naks[1]);
+  CHECK(eps[0].int_count >= eps[0].nak_count + done[0]);
+
+  printf("naks: counters, Bulk IN %lu NAKs %lu interrupts, INT IN %lu NAKs "
+         "(not counted) %lu interrupts\n",
+         (unsigned long)eps[0].nak_count, (unsigned long)eps[0].int_count,
+         naks[2], (unsigned long)eps[1].int_count);
+  close_all();
+}
+
+int main(void) {
+  usbh_device_t *dev;
+
+  usbhInit();
+  usbhStart(&USBHD1);
+  sim_otg_connect();
+  CHECK(USBHD1.rootport.lld_status & USBH_PORTSTATUS_ENABLE);
+  dev = sim_otg_device(USBH_DEVSPEED_FULL);
+  sim_otg_in = device;
+
+  test_idle(dev);
+  test_wake(dev);
+  test_share(dev);
+  test_counters(dev);
+  return 0;
+}
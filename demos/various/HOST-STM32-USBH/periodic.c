@@ -0,0 +1,209 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+ * Periodic schedule of the STM32 OTG host driver: polling periods of an
+ * endpoint mix, bus time budgeting at full and high speed, and the CPU cost
+ * of the schedule per frame.
+ */
+
+#include <string.h>
+
+#include "sim_otg.h"
+
+#define FRAMES                              4096U
+
+typedef struct {
+  uint8_t               ep;
+  uint8_t               type;
+  uint16_t              mps;
+  uint8_t               bInterval;
+  uint8_t               period;             /* expected, in frames */
+  unsigned              data_every;         /* 0: always NAK */
+} ep_spec_t;
+
+/* A hub, a keyboard, a mouse, a gamepad and a camera status endpoint.*/
+static const ep_spec_t mix[] = {
+  {1, USBH_EPTYPE_INT,  1, 12,  8, 0},
+  {2, USBH_EPTYPE_INT,  8, 10,  8, 5},
+  {3, USBH_EPTYPE_INT,  4,  1,  1, 2},
+  {4, USBH_EPTYPE_INT, 64,  4,  4, 3},
+  {5, USBH_EPTYPE_INT, 16, 16, 16, 0},
+};
+#define MIX_SIZE                            (sizeof(mix) / sizeof(mix[0]))
+
+static usbh_ep_t eps[32];
+static usbh_urb_t urbs[MIX_SIZE];
+USBH_DEFINE_BUFFER(static uint8_t buffers[MIX_SIZE][64]);
+static unsigned long tokens[16];
+static unsigned long reports[MIX_SIZE];
+static unsigned long errors;
+
+static int device(uint8_t addr, uint8_t ep, uint16_t mps) {
+  unsigned i;
+
+  CHECK(addr == 1);
+  tokens[ep]++;
+  for (i = 0; i < MIX_SIZE; i++) {
+    if ((mix[i].ep == ep) && mix[i].data_every
+        && ((tokens[ep] % mix[i].data_every) == 0))
+      return mps;
+  }
+  return SIM_NAK;
+}
+
+/* Resubmits the report URB, as the HID driver does.*/
+static void report_cb(usbh_urb_t *urb) {
+  const unsigned i = (unsigned)(urb - urbs);
+
+  if (urb->status == USBH_URBSTATUS_OK)
+    reports[i]++;
+  else if (urb->status != USBH_URBSTATUS_TIMEOUT)
+    errors++;
+  if (urb->status == USBH_URBSTATUS_DISCONNECTED)
+    return;
+  usbhURBObjectResetI(urb);
+  usbhURBSubmitI(urb);
+}
+
+static usbh_endpoint_descriptor_t desc(uint8_t ep, uint8_t type,
+                                       uint16_t mps, uint8_t bInterval) {
+  usbh_endpoint_descriptor_t d = {7, 5, (uint8_t)(0x80U | ep), type, mps, bInterval};
+  return d;
+}
+
+static bool open_ep(usbh_ep_t *ep, usbh_device_t *dev, uint8_t n,
+                    uint8_t type, uint16_t mps, uint8_t bInterval) {
+  const usbh_endpoint_descriptor_t d = desc(n, type, mps, bInterval);
+
+  usbhEPObjectInit(ep, dev, &d);
+  return usbhEPOpen(ep);
+}
+
+static void close_all(void) {
+  unsigned i;
+
+  for (i = 0; i < 32; i++) {
+    if (eps[i].status == USBH_EPSTATUS_OPEN)
+      usbhEPClose(&eps[i]);
+  }
+  for (i = 0; i < STM32_USBH_PERIODIC_FRAMES; i++)
+    CHECK(USBHD1.p_load[i] == 0);
+}
+
+/* Fills the schedule with endpoints of the same size until one is refused.*/
+static unsigned fill(usbh_device_t *dev, uint8_t type, uint16_t mps,
+                     uint8_t bInterval) {
+  unsigned n;
+
+  for (n = 0; n < 32; n++) {
+    if (open_ep(&eps[n], dev, 1, type, mps, bInterval) != HAL_SUCCESS) {
+      CHECK(eps[n].status == USBH_EPSTATUS_CLOSED);
+      break;
+    }
+    CHECK(eps[n].status == USBH_EPSTATUS_OPEN);
+  }
+  close_all();
+  return n;
+}
+
+static void test_budget(usbh_device_t *dev) {
+  unsigned fs_iso, fs_int, hs_iso, hs_int;
+
+  /* 1000 byte ISO every 8 frames: one per phase.*/
+  dev->speed = USBH_DEVSPEED_FULL;
+  fs_iso = fill(dev, USBH_EPTYPE_ISO, 1000, 4);
+  CHECK(fs_iso == 8);
+  /* 64 byte INT every frame: 1350 / (64 + 13).*/
+  fs_int = fill(dev, USBH_EPTYPE_INT, 64, 1);
+  CHECK(fs_int == 1350 / 77);
+
+  /* High speed microframes: 6000 / (1024 + 38), 6000 / (512 + 55).*/
+  dev->speed = USBH_DEVSPEED_HIGH;
+  hs_iso = fill(dev, USBH_EPTYPE_ISO, 1024, 1);
+  CHECK(hs_iso == 6000 / 1062);
+  hs_int = fill(dev, USBH_EPTYPE_INT, 512, 1);
+  CHECK(hs_int == 6000 / 567);
+  dev->speed = USBH_DEVSPEED_FULL;
+
+  printf("periodic: endpoints admitted, FS: %u ISO 1000B/8ms, %u INT 64B/1ms; "
+         "HS: %u ISO 1024B/125us, %u INT 512B/125us\n",
+         fs_iso, fs_int, hs_iso, hs_int);
+}
+
+static void test_mix(usbh_device_t *dev) {
+  unsigned long sofs, idle, activations;
+  unsigned i;
+
+  for (i = 0; i < MIX_SIZE; i++) {
+    CHECK(open_ep(&eps[i], dev, mix[i].ep, mix[i].type, mix[i].mps,
+                  mix[i].bInterval) == HAL_SUCCESS);
+    usbhURBObjectInit(&urbs[i], &eps[i], report_cb, NULL, buffers[i], mix[i].mps);
+    osalSysLock();
+    usbhURBSubmitI(&urbs[i]);
+    osalSysUnlock();
+  }
+
+  /* warm up, then measure */
+  sim_run(64);
+  memset(tokens, 0, sizeof(tokens));
+  memset(reports, 0, sizeof(reports));
+  sim_otg_reset_counters();
+  sofs = USBHD1.p_sof_count;
+  idle = USBHD1.p_sof_idle;
+  activations = USBHD1.p_activations;
+  sim_run(FRAMES);
+  sofs = USBHD1.p_sof_count - sofs;
+  idle = USBHD1.p_sof_idle - idle;
+  activations = USBHD1.p_activations - activations;
+
+  CHECK(errors == 0);
+  for (i = 0; i < MIX_SIZE; i++) {
+    const unsigned long expected = FRAMES / mix[i].period;
+    CHECK((tokens[mix[i].ep] + 1 >= expected) && (tokens[mix[i].ep] <= expected + 1));
+    if (mix[i].data_every)
+      CHECK(reports[i] + 1 >= expected / mix[i].data_every);
+  }
+  CHECK(sim_otg_sofs == sofs);
+  CHECK(activations == sim_otg_tokens);
+
+  printf("periodic: %u INT endpoints, periods 1-16 frames, all polled on time\n",
+         (unsigned)MIX_SIZE);
+  printf("periodic: per frame: %.2f ISR calls, %.2f SOF IRQs (%.2f with nothing "
+         "due), %.2f transfers started, %.0f ns in the ISR (host)\n",
+         (double)sim_otg_irqs / FRAMES, (double)sofs / FRAMES,
+         (double)idle / FRAMES, (double)activations / FRAMES,
+         (double)sim_otg_isr_ns / FRAMES);
+
+  for (i = 0; i < MIX_SIZE; i++)
+    usbhEPClose(&eps[i]);
+  close_all();
+}
+
+int main(void) {
+  usbh_device_t *dev;
+
+  usbhInit();
+  usbhStart(&USBHD1);
+  sim_otg_connect();
+  CHECK(USBHD1.rootport.lld_status & USBH_PORTSTATUS_ENABLE);
+  dev = sim_otg_device(USBH_DEVSPEED_FULL);
+  sim_otg_in = device;
+
+  test_budget(dev);
+  test_mix(dev);
+  return 0;
+}
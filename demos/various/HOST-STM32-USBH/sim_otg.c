@@ -0,0 +1,312 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+ * Register level model of the OTG core in host mode, slave (FIFO) mode,
+ * full speed. Only IN transfers are modelled. Each IN request queued by
+ * setting CHENA sends one token; the driver sets CHENA again to continue
+ * after a NAK or a data packet. Periodic channels send one token in the
+ * frame selected by ODDFRM, non periodic channels share the rest of the
+ * frame. The interrupts are served, one ISR invocation at a time, after
+ * each round of tokens.
+ */
+
+#include <string.h>
+#include <time.h>
+
+#include "sim_otg.h"
+
+/* Full speed frame length and transaction overhead, in byte times.*/
+#define SIM_FRAME_BYTES                     1500
+#define SIM_TOKEN_BYTES                     13
+
+#define SIM_CHANNELS                        STM32_OTG_FS_CHANNELS_NUMBER
+#define SIM_RXQ_SIZE                        64U
+#define SIM_MAX_IRQS                        10000U
+
+#define HPRT_CHANGES        (HPRT_PCDET | HPRT_PENCHNG | HPRT_POCCHNG)
+
+stm32_otg_t sim_otg;
+sim_otg_in_t sim_otg_in;
+unsigned long sim_otg_irqs;
+unsigned long sim_otg_sofs;
+unsigned long sim_otg_tokens;
+unsigned long long sim_otg_isr_ns;
+
+void sim_otg_isr(void);
+
+static struct {
+  bool                  active;     /* channel enabled by the driver */
+  uint32_t              pending;    /* HCINT */
+  uint32_t              frame;      /* last frame of a periodic token */
+} chn[SIM_CHANNELS];
+
+static uint32_t events;             /* GINTSTS SOF, DISCINT */
+static uint32_t hprt;
+static uint16_t frnum;
+static uint32_t rxq[SIM_RXQ_SIZE];
+static unsigned rxq_rd, rxq_cnt;
+
+/*===========================================================================*/
+/* Registers with side effects.                                              */
+/*===========================================================================*/
+
+uint32_t sim_otg_grstctl(void) {
+
+  /* Resets and flushes complete at once.*/
+  sim_otg.GRSTCTL_[0] = (sim_otg.GRSTCTL_[0]
+      & ~(GRSTCTL_CSRST | GRSTCTL_RXFFLSH | GRSTCTL_TXFFLSH)) | GRSTCTL_AHBIDL;
+  return 0;
+}
+
+uint32_t sim_otg_rxpop(void) {
+
+  osalDbgAssert(rxq_cnt > 0, "RX FIFO empty");
+  sim_otg.GRXSTSP_[0] = rxq[rxq_rd];
+  rxq_rd = (rxq_rd + 1) % SIM_RXQ_SIZE;
+  if (--rxq_cnt == 0)
+    sim_otg.GINTSTS &= ~GINTSTS_RXFLVL;
+  return 0;
+}
+
+static void rxq_push(uint32_t sts) {
+
+  osalDbgAssert(rxq_cnt < SIM_RXQ_SIZE, "RX FIFO full");
+  rxq[(rxq_rd + rxq_cnt) % SIM_RXQ_SIZE] = sts;
+  rxq_cnt++;
+}
+
+/*===========================================================================*/
+/* Core.                                                                     */
+/*===========================================================================*/
+
+static bool is_periodic(uint32_t hcchar) {
+  const uint32_t type = (hcchar >> 18) & 3U;
+
+  return (type == USBH_EPTYPE_ISO) || (type == USBH_EPTYPE_INT);
+}
+
+/* Picks up what the driver wrote to the channel registers.*/
+static void sync(void) {
+  unsigned i;
+
+  for (i = 0; i < SIM_CHANNELS; i++) {
+    stm32_otg_host_chn_t *const hc = &sim_otg.hc[i];
+    const uint32_t hcchar = hc->HCCHAR;
+
+    if (hcchar & HCCHAR_CHDIS) {
+      /* halting also works on an idle channel */
+      hc->HCCHAR = hcchar & ~(HCCHAR_CHENA | HCCHAR_CHDIS);
+      chn[i].active = false;
+      chn[i].pending |= HCINTMSK_CHHM;
+    } else if ((hcchar & HCCHAR_CHENA) && !chn[i].active) {
+      /* new transfer; the driver cleared HCINT */
+      osalDbgAssert(hcchar & HCCHAR_EPDIR, "OUT transfers not modelled");
+      chn[i].active = true;
+      chn[i].pending = 0;
+      chn[i].frame = 0xFFFFFFFFU;
+    }
+  }
+}
+
+/* Runs the ISR until no enabled interrupt is pending.*/
+static void serve(void) {
+  unsigned n, i;
+
+  for (n = 0; ; n++) {
+    uint32_t gintsts, haint = 0, delivered[SIM_CHANNELS];
+    struct timespec t0, t1;
+
+    osalDbgAssert(n < SIM_MAX_IRQS, "interrupt storm");
+    for (i = 0; i < SIM_CHANNELS; i++) {
+      if (chn[i].pending & sim_otg.hc[i].HCINTMSK)
+        haint |= 1U << i;
+    }
+    osalDbgAssert(!(sim_otg.GINTMSK & (GINTMSK_NPTXFEM | GINTMSK_PTXFEM)),
+                  "OUT transfers not modelled");
+    gintsts = GINTSTS_CMOD | events;
+    if (rxq_cnt > 0)
+      gintsts |= GINTSTS_RXFLVL;
+    if (haint & sim_otg.HAINTMSK)
+      gintsts |= GINTSTS_HCINT;
+    if (hprt & HPRT_CHANGES)
+      gintsts |= GINTSTS_HPRTINT;
+    if (!(sim_otg.GAHBCFG & GAHBCFG_GINTMSK) || !(gintsts & sim_otg.GINTMSK))
+      return;
+
+    sim_otg.GINTSTS = gintsts;
+    sim_otg.HAINT = haint;
+    sim_otg.HPRT = hprt;
+    for (i = 0; i < SIM_CHANNELS; i++) {
+      sim_otg.hc[i].HCINT = chn[i].pending;
+      delivered[i] = 0;
+      if ((gintsts & sim_otg.GINTMSK & GINTSTS_HCINT)
+          && (haint & sim_otg.HAINTMSK & (1U << i)))
+        delivered[i] = chn[i].pending & sim_otg.hc[i].HCINTMSK;
+    }
+    gintsts &= sim_otg.GINTMSK;
+    events &= ~gintsts;
+    if (gintsts & GINTSTS_SOF)
+      sim_otg_sofs++;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    sim_otg_isr();
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    sim_otg_isr_ns += (unsigned long long)(t1.tv_sec - t0.tv_sec) * 1000000000ULL
+        + (unsigned long long)t1.tv_nsec - (unsigned long long)t0.tv_nsec;
+    sim_otg_irqs++;
+
+    for (i = 0; i < SIM_CHANNELS; i++)
+      chn[i].pending &= ~delivered[i];
+    if (sim_otg.HPRT != hprt)
+      hprt &= ~(sim_otg.HPRT & HPRT_CHANGES);
+    sim_otg.HPRT = hprt;
+    sync();
+  }
+}
+
+/* One IN token of channel i, returns the bus time used.*/
+static unsigned token(unsigned i) {
+  stm32_otg_host_chn_t *const hc = &sim_otg.hc[i];
+  const uint32_t hcchar = hc->HCCHAR;
+  const uint16_t mps = hcchar & 0x7FFU;
+  uint32_t hctsiz = hc->HCTSIZ;
+  uint32_t pktcnt = (hctsiz & HCTSIZ_PKTCNT_MASK) >> 19;
+  uint32_t xfrsiz = hctsiz & HCTSIZ_XFRSIZ_MASK;
+  int len;
+
+  hc->HCCHAR = hcchar & ~HCCHAR_CHENA;
+  chn[i].frame = frnum;
+  sim_otg_tokens++;
+  len = sim_otg_in((hcchar >> 22) & 0x7FU, (hcchar >> 11) & 0xFU, mps);
+  if (len == SIM_NAK) {
+    osalDbgAssert(((hcchar >> 18) & 3U) != USBH_EPTYPE_ISO, "NAK on ISO");
+    chn[i].pending |= HCINTMSK_NAKM;
+    return SIM_TOKEN_BYTES;
+  }
+  if (len == SIM_STALL) {
+    chn[i].pending |= HCINTMSK_STALLM;
+    return SIM_TOKEN_BYTES;
+  }
+
+  osalDbgAssert((len >= 0) && (len <= mps) && (pktcnt > 0), "babble");
+  if ((uint32_t)len > xfrsiz)
+    len = (int)xfrsiz;
+  rxq_push(GRXSTSP_PKTSTS(2) | ((uint32_t)len << GRXSTSP_BCNT_OFF) | i);
+  pktcnt--;
+  xfrsiz -= (uint32_t)len;
+  hctsiz = (hctsiz ^ HCTSIZ_DPID_DATA1) & ~(HCTSIZ_PKTCNT_MASK | HCTSIZ_XFRSIZ_MASK);
+  hc->HCTSIZ = hctsiz | HCTSIZ_PKTCNT(pktcnt) | HCTSIZ_XFRSIZ(xfrsiz);
+  if ((len < mps) || (pktcnt == 0)) {
+    rxq_push(GRXSTSP_PKTSTS(3) | i);
+    chn[i].active = false;
+    chn[i].pending |= HCINTMSK_XFRCM;
+  }
+  return (unsigned)len + SIM_TOKEN_BYTES;
+}
+
+/* A channel can send a token now.*/
+static bool ready(unsigned i) {
+  const uint32_t hcchar = sim_otg.hc[i].HCCHAR;
+
+  if (!chn[i].active || !(hcchar & HCCHAR_CHENA))
+    return false;
+  if (is_periodic(hcchar)) {
+    return (chn[i].frame != frnum)
+        && (((hcchar & HCCHAR_ODDFRM) != 0) == ((frnum & 1U) != 0));
+  }
+  return true;
+}
+
+void sim_bus_frame(void) {
+  unsigned left = SIM_FRAME_BYTES;
+  unsigned i;
+
+  sync();
+  frnum = (frnum + 1U) & 0x3FFFU;
+  sim_otg.HFNUM = frnum | (48000U << 16);
+  events |= GINTSTS_SOF;
+  serve();
+
+  for (;;) {
+    bool sent = false;
+
+    /* periodic channels first, one token each */
+    for (i = 0; i < SIM_CHANNELS; i++) {
+      if (ready(i) && is_periodic(sim_otg.hc[i].HCCHAR)) {
+        osalDbgAssert(left >= SIM_TOKEN_BYTES + (sim_otg.hc[i].HCCHAR & 0x7FFU),
+                      "periodic budget exceeded");
+        left -= token(i);
+        sent = true;
+      }
+    }
+    for (i = 0; i < SIM_CHANNELS; i++) {
+      const uint32_t hcchar = sim_otg.hc[i].HCCHAR;
+      if (ready(i) && !is_periodic(hcchar)
+          && (left >= SIM_TOKEN_BYTES + (hcchar & 0x7FFU))) {
+        left -= token(i);
+        sent = true;
+      }
+    }
+    serve();
+    if (!sent)
+      break;
+  }
+
+  /* periodic transfers that missed their frame */
+  for (i = 0; i < SIM_CHANNELS; i++) {
+    if (ready(i) && is_periodic(sim_otg.hc[i].HCCHAR)) {
+      sim_otg.hc[i].HCCHAR &= ~HCCHAR_CHENA;
+      chn[i].pending |= HCINTMSK_FRMORM;
+    }
+  }
+  serve();
+}
+
+/*===========================================================================*/
+/* Test helpers.                                                             */
+/*===========================================================================*/
+
+void sim_otg_connect(void) {
+
+  /* queues and FIFOs always have room */
+  sim_otg.HNPTXSTS = (8U << 16) | 0x100U;
+  sim_otg.HPTXSTS = (8U << 16) | 0x100U;
+  hprt = HPRT_PCSTS | HPRT_PCDET | HPRT_PENA | HPRT_PENCHNG
+      | HPRT_PPWR | HPRT_PSPD_FS;
+  sim_run(1);
+}
+
+usbh_device_t *sim_otg_device(usbh_devspeed_t speed) {
+  usbh_port_t *const port = &USBHD1.rootport;
+  usbh_device_t *const dev = &port->device;
+
+  osalSysLock();
+  port->status = port->lld_status;
+  osalSysUnlock();
+  dev->speed = speed;
+  dev->address = 1;
+  dev->status = USBH_DEVSTATUS_ADDRESS;
+  return dev;
+}
+
+void sim_otg_reset_counters(void) {
+
+  sim_otg_irqs = 0;
+  sim_otg_sofs = 0;
+  sim_otg_tokens = 0;
+  sim_otg_isr_ns = 0;
+}
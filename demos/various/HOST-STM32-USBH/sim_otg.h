@@ -0,0 +1,58 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/* OTG core model and device model of the STM32 USB host driver tests.*/
+
+#ifndef SIM_OTG_H
+#define SIM_OTG_H
+
+#include "hal.h"
+#include "usbh/internal.h"
+
+#define CHECK(c)                                                            \
+  do {                                                                      \
+    if (!(c)) {                                                             \
+      printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #c);                    \
+      exit(1);                                                              \
+    }                                                                       \
+  } while (0)
+
+/* Device answers to an IN token, besides a packet length.*/
+#define SIM_NAK                             -1
+#define SIM_STALL                           -2
+
+/*
+ * Called for each IN token the core sends. Returns the length of the data
+ * packet, SIM_NAK or SIM_STALL.
+ */
+typedef int (*sim_otg_in_t)(uint8_t addr, uint8_t ep, uint16_t mps);
+extern sim_otg_in_t sim_otg_in;
+
+/* Counters.*/
+extern unsigned long sim_otg_irqs;          /* ISR invocations */
+extern unsigned long sim_otg_sofs;          /* ...serving a SOF */
+extern unsigned long sim_otg_tokens;        /* IN tokens on the bus */
+extern unsigned long long sim_otg_isr_ns;   /* host time in the ISR */
+
+/* Connects a full speed device to the root port and enables the port.*/
+void sim_otg_connect(void);
+
+/* Makes the root port device addressable without enumerating it.*/
+usbh_device_t *sim_otg_device(usbh_devspeed_t speed);
+
+void sim_otg_reset_counters(void);
+
+#endif /* SIM_OTG_H */
@@ -0,0 +1,177 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+ * Register block of the simulated OTG core (sim_otg.c). The layout is not
+ * the real one, only the registers used by the host driver are present.
+ * Plain memory can't model the read side effects of GRXSTSP (FIFO pop) and
+ * of GRSTCTL (self clearing bits): these two are arrays indexed by a model
+ * call, which updates the register before the driver reads it. The write
+ * one to clear registers are settled by the model after each interrupt.
+ */
+
+#ifndef STM32_OTG_H
+#define STM32_OTG_H
+
+#include <stdint.h>
+
+#define STM32_OTG_FS_CHANNELS_NUMBER        8
+#define STM32_OTG_HS_CHANNELS_NUMBER        12
+
+typedef struct {
+  volatile uint32_t     HCCHAR;
+  volatile uint32_t     HCINT;
+  volatile uint32_t     HCINTMSK;
+  volatile uint32_t     HCTSIZ;
+} stm32_otg_host_chn_t;
+
+typedef struct {
+  volatile uint32_t     GOTGINT;
+  volatile uint32_t     GAHBCFG;
+  volatile uint32_t     GUSBCFG;
+  volatile uint32_t     GRSTCTL_[1];
+  volatile uint32_t     GINTSTS;
+  volatile uint32_t     GINTMSK;
+  volatile uint32_t     GRXSTSP_[1];
+  volatile uint32_t     GRXFSIZ;
+  volatile uint32_t     DIEPTXF0;
+  volatile uint32_t     HNPTXSTS;
+  volatile uint32_t     GCCFG;
+  volatile uint32_t     HPTXFSIZ;
+  volatile uint32_t     HCFG;
+  volatile uint32_t     HFIR;
+  volatile uint32_t     HFNUM;
+  volatile uint32_t     HPTXSTS;
+  volatile uint32_t     HAINT;
+  volatile uint32_t     HAINTMSK;
+  volatile uint32_t     HPRT;
+  volatile uint32_t     PCGCCTL;
+  stm32_otg_host_chn_t  hc[16];
+  volatile uint32_t     FIFO[16][1024];
+} stm32_otg_t;
+
+uint32_t sim_otg_grstctl(void);
+uint32_t sim_otg_rxpop(void);
+#define GRSTCTL                             GRSTCTL_[sim_otg_grstctl()]
+#define GRXSTSP                             GRXSTSP_[sim_otg_rxpop()]
+
+extern stm32_otg_t sim_otg;
+#define OTG_FS                              (&sim_otg)
+
+#define GAHBCFG_GINTMSK                     (1U << 0)
+
+#define GUSBCFG_FHMOD                       (1U << 29)
+#define GUSBCFG_TRDT(n)                     ((n) << 10)
+#define GUSBCFG_HNPCAP                      (1U << 9)
+#define GUSBCFG_SRPCAP                      (1U << 8)
+#define GUSBCFG_PHYSEL                      (1U << 6)
+
+#define GRSTCTL_AHBIDL                      (1U << 31)
+#define GRSTCTL_TXFNUM(n)                   ((n) << 6)
+#define GRSTCTL_TXFFLSH                     (1U << 5)
+#define GRSTCTL_RXFFLSH                     (1U << 4)
+#define GRSTCTL_CSRST                       (1U << 0)
+
+#define GINTSTS_DISCINT                     (1U << 29)
+#define GINTSTS_PTXFE                       (1U << 26)
+#define GINTSTS_HCINT                       (1U << 25)
+#define GINTSTS_HPRTINT                     (1U << 24)
+#define GINTSTS_IPXFR                       (1U << 21)
+#define GINTSTS_NPTXFE                      (1U << 5)
+#define GINTSTS_RXFLVL                      (1U << 4)
+#define GINTSTS_SOF                         (1U << 3)
+#define GINTSTS_MMIS                        (1U << 1)
+#define GINTSTS_CMOD                        (1U << 0)
+
+#define GINTMSK_DISCM                       GINTSTS_DISCINT
+#define GINTMSK_PTXFEM                      GINTSTS_PTXFE
+#define GINTMSK_HCM                         GINTSTS_HCINT
+#define GINTMSK_HPRTM                       GINTSTS_HPRTINT
+#define GINTMSK_NPTXFEM                     GINTSTS_NPTXFE
+#define GINTMSK_RXFLVLM                     GINTSTS_RXFLVL
+#define GINTMSK_SOFM                        GINTSTS_SOF
+#define GINTMSK_MMISM                       GINTSTS_MMIS
+
+#define GRXSTSP_PKTSTS_MASK                 (15U << 17)
+#define GRXSTSP_PKTSTS(n)                   ((n) << 17)
+#define GRXSTSP_BCNT_MASK                   (0x7FFU << 4)
+#define GRXSTSP_BCNT_OFF                    4
+#define GRXSTSP_CHNUM_MASK                  (15U << 0)
+
+#define GRXFSIZ_RXFD(n)                     ((n) << 0)
+
+#define HPTXFSIZ_PTXFD(n)                   ((n) << 16)
+#define HPTXFSIZ_PTXSA(n)                   ((n) << 0)
+
+#define HPTXSTS_PTXQSAV_MASK                (0xFFU << 16)
+#define HPTXSTS_PTXFSAVL_MASK               (0xFFFFU << 0)
+
+#define GCCFG_VBDEN                         (1U << 21)
+#define GCCFG_NOVBUSSENS                    (1U << 21)
+#define GCCFG_PWRDWN                        (1U << 16)
+
+#define HCFG_FSLSS                          (1U << 2)
+#define HCFG_FSLSPCS_MASK                   (3U << 0)
+#define HCFG_FSLSPCS_48                     (1U << 0)
+#define HCFG_FSLSPCS_6                      (2U << 0)
+
+#define HPRT_PSPD_MASK                      (3U << 17)
+#define HPRT_PSPD_FS                        (1U << 17)
+#define HPRT_PSPD_LS                        (2U << 17)
+#define HPRT_PPWR                           (1U << 12)
+#define HPRT_PLSTS_MASK                     (3U << 10)
+#define HPRT_PLSTS_DM                       (1U << 11)
+#define HPRT_PRST                           (1U << 8)
+#define HPRT_PSUSP                          (1U << 7)
+#define HPRT_POCCHNG                        (1U << 5)
+#define HPRT_POCA                           (1U << 4)
+#define HPRT_PENCHNG                        (1U << 3)
+#define HPRT_PENA                           (1U << 2)
+#define HPRT_PCDET                          (1U << 1)
+#define HPRT_PCSTS                          (1U << 0)
+
+#define HCCHAR_CHENA                        (1U << 31)
+#define HCCHAR_CHDIS                        (1U << 30)
+#define HCCHAR_ODDFRM                       (1U << 29)
+#define HCCHAR_DAD(n)                       ((n) << 22)
+#define HCCHAR_MCNT(n)                      ((n) << 20)
+#define HCCHAR_EPTYP(n)                     ((n) << 18)
+#define HCCHAR_LSDEV                        (1U << 17)
+#define HCCHAR_EPDIR                        (1U << 15)
+#define HCCHAR_EPNUM(n)                     ((n) << 11)
+#define HCCHAR_MPS(n)                       ((n) << 0)
+
+#define HCINTMSK_DTERRM                     (1U << 10)
+#define HCINTMSK_FRMORM                     (1U << 9)
+#define HCINTMSK_BBERRM                     (1U << 8)
+#define HCINTMSK_TRERRM                     (1U << 7)
+#define HCINTMSK_ACKM                       (1U << 5)
+#define HCINTMSK_NAKM                       (1U << 4)
+#define HCINTMSK_STALLM                     (1U << 3)
+#define HCINTMSK_AHBERRM                    (1U << 2)
+#define HCINTMSK_CHHM                       (1U << 1)
+#define HCINTMSK_XFRCM                      (1U << 0)
+
+#define HCTSIZ_DPID_MASK                    (3U << 29)
+#define HCTSIZ_DPID_SETUP                   (3U << 29)
+#define HCTSIZ_DPID_DATA1                   (2U << 29)
+#define HCTSIZ_DPID_DATA0                   (0U << 29)
+#define HCTSIZ_PKTCNT_MASK                  (0x3FFU << 19)
+#define HCTSIZ_PKTCNT(n)                    ((n) << 19)
+#define HCTSIZ_XFRSIZ_MASK                  (0x7FFFFU << 0)
+#define HCTSIZ_XFRSIZ(n)                    ((n) << 0)
+
+#endif /* STM32_OTG_H */
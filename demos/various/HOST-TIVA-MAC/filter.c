@@ -0,0 +1,227 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+ * Multicast hash filter and checksum offload. The hash indexes are the
+ * upper six bits of the bit reversed CRC32 of the address.
+ */
+
+#include <string.h>
+
+#include "hal.h"
+#include "sim_emac.h"
+
+#define FRAMEFLTR_HMC                       (1U << 2)
+#define CFG_IPC                             (1U << 10)
+
+#if TIVA_MAC_USE_SCATTER_GATHER
+static uint32_t pool[64][128];
+static int pool_next;
+
+static void *pool_alloc(MACDriver *macp) {
+
+  (void)macp;
+  return pool[pool_next++ % 64];
+}
+
+static void pool_free(MACDriver *macp, void *buf) {
+
+  (void)macp;
+  (void)buf;
+}
+#endif
+
+static const MACConfig config = {
+  .mac_address    = NULL,
+#if TIVA_MAC_USE_SCATTER_GATHER
+  .rx_alloc       = pool_alloc,
+  .rx_free        = pool_free,
+  .rx_buffer_size = 512,
+  .tx_done        = NULL
+#endif
+};
+
+static const struct {
+  uint8_t   addr[6];
+  unsigned  index;
+} vectors[] = {
+  {{0x01, 0x00, 0x5e, 0x00, 0x00, 0x01}, 32},
+  {{0x01, 0x00, 0x5e, 0x00, 0x00, 0xfb}, 48},
+  {{0x33, 0x33, 0x00, 0x00, 0x00, 0x01},  1},
+  {{0x33, 0x33, 0xff, 0x12, 0x34, 0x56}, 61},
+  {{0x01, 0x80, 0xc2, 0x00, 0x00, 0x0e}, 30},
+  {{0xff, 0xff, 0xff, 0xff, 0xff, 0xff},  0},
+  {{0x01, 0x00, 0x5e, 0x7f, 0xff, 0xfa}, 20}
+};
+
+static void test_hash(void) {
+  unsigned i;
+
+  for (i = 0; i < sizeof vectors / sizeof vectors[0]; i++)
+    CHECK(tivaMacHashIndex(vectors[i].addr) == vectors[i].index);
+
+  CHECK((SIM_REG(EMAC_O_HASHTBLH) == 0) && (SIM_REG(EMAC_O_HASHTBLL) == 0));
+  CHECK((SIM_REG(EMAC_O_FRAMEFLTR) & FRAMEFLTR_HMC) == 0);
+  tivaMacAddMulticastAddress(&ETHD1, vectors[0].addr);
+  tivaMacAddMulticastAddress(&ETHD1, vectors[2].addr);
+  CHECK((SIM_REG(EMAC_O_HASHTBLH) == 1) && (SIM_REG(EMAC_O_HASHTBLL) == 2));
+  CHECK((SIM_REG(EMAC_O_FRAMEFLTR) & FRAMEFLTR_HMC) != 0);
+
+  /* Bins are reference counted.*/
+  tivaMacAddMulticastAddress(&ETHD1, vectors[0].addr);
+  tivaMacRemoveMulticastAddress(&ETHD1, vectors[0].addr);
+  CHECK(SIM_REG(EMAC_O_HASHTBLH) == 1);
+  tivaMacRemoveMulticastAddress(&ETHD1, vectors[0].addr);
+  CHECK((SIM_REG(EMAC_O_HASHTBLH) == 0) && (SIM_REG(EMAC_O_HASHTBLL) == 2));
+
+  /* Changes while stopped are loaded by the next start.*/
+  mac_lld_stop(&ETHD1);
+  ETHD1.state = MAC_STOP;
+  tivaMacAddMulticastAddress(&ETHD1, vectors[3].addr);
+  CHECK(SIM_REG(EMAC_O_HASHTBLH) == 0);
+  mac_lld_start(&ETHD1);
+  ETHD1.state = MAC_ACTIVE;
+  CHECK((SIM_REG(EMAC_O_HASHTBLH) == (1U << 29)) &&
+        (SIM_REG(EMAC_O_HASHTBLL) == 2));
+  CHECK((SIM_REG(EMAC_O_FRAMEFLTR) & FRAMEFLTR_HMC) != 0);
+  tivaMacRemoveMulticastAddress(&ETHD1, vectors[3].addr);
+  tivaMacRemoveMulticastAddress(&ETHD1, vectors[2].addr);
+  CHECK((SIM_REG(EMAC_O_FRAMEFLTR) & FRAMEFLTR_HMC) == 0);
+}
+
+#define NEXT_TD(tdes) ((tiva_eth_tx_descriptor_t *)(uintptr_t)(tdes)->tdes3)
+#define NEXT_RD(rdes) ((tiva_eth_rx_descriptor_t *)(uintptr_t)(rdes)->rdes3)
+
+static void test_tx(void) {
+  MACTransmitDescriptor td;
+  tiva_eth_tx_descriptor_t *tdes;
+  unsigned mode;
+
+  for (mode = 0; mode < 4; mode++) {
+    CHECK(mac_lld_get_transmit_descriptor(&ETHD1, &td) == MSG_OK);
+    CHECK(td.csum == (tiva_mac_csum_t)TIVA_MAC_IP_CHECKSUM_OFFLOAD);
+    tivaMacSetTransmitChecksum(&td, (tiva_mac_csum_t)mode);
+    td.offset = 60;
+    tdes = td.physdesc;
+    mac_lld_release_transmit_descriptor(&td);
+    CHECK((tdes->tdes0 & TIVA_TDES0_CIC_MASK) == TIVA_TDES0_CIC(mode));
+    tdes->tdes0 &= ~TIVA_TDES0_OWN;
+  }
+#if TIVA_MAC_USE_SCATTER_GATHER
+  {
+    static uint8_t a[40], b[40], c[40];
+    tiva_mac_segment_t segs[3] = {{a, 40}, {b, 40}, {c, 40}};
+
+    /* Only the first descriptor of a frame carries the mode.*/
+    (void)tivaMacReclaimTransmit(&ETHD1);
+    tdes = ETHD1.txptr;
+    CHECK(tivaMacTransmitFrame(&ETHD1, segs, 3, TIVA_MAC_CSUM_IP_PAYLOAD,
+                               NULL) == MSG_OK);
+    CHECK((tdes->tdes0 & TIVA_TDES0_CIC_MASK) == TIVA_TDES0_CIC(2U));
+    CHECK((NEXT_TD(tdes)->tdes0 & TIVA_TDES0_CIC_MASK) == 0);
+    CHECK((NEXT_TD(NEXT_TD(tdes))->tdes0 & TIVA_TDES0_CIC_MASK) == 0);
+  }
+#endif
+}
+
+/* Receive status bits and the expected result, -1 when dropped.*/
+static const struct {
+  uint32_t  bits;
+  int       csum;
+} rxcases[] = {
+  {0,                                       TIVA_MAC_RX_CSUM_NONE},
+  {TIVA_RDES0_FT,                           TIVA_MAC_RX_CSUM_OK},
+  {TIVA_RDES0_FT | TIVA_RDES0_PCE,          -1},
+  {TIVA_RDES0_FT | TIVA_RDES0_IPHCE,        -1},
+  {TIVA_RDES0_FT | TIVA_RDES0_IPHCE |
+   TIVA_RDES0_PCE,                          -1},
+  {TIVA_RDES0_PCE,                          TIVA_MAC_RX_CSUM_IP},
+  {TIVA_RDES0_IPHCE | TIVA_RDES0_PCE,       TIVA_MAC_RX_CSUM_NONE},
+  {TIVA_RDES0_IPHCE,                        TIVA_MAC_RX_CSUM_NONE}
+};
+
+static void test_rx(void) {
+  tiva_eth_rx_descriptor_t *rdes;
+  unsigned i, errors = 0;
+  int csum;
+
+  rdes = (tiva_eth_rx_descriptor_t *)(uintptr_t)SIM_REG(EMAC_O_RXDLADDR);
+  for (i = 0; i < sizeof rxcases / sizeof rxcases[0]; i++) {
+    csum = TIVA_MAC_IP_CHECKSUM_OFFLOAD ? rxcases[i].csum :
+                                          TIVA_MAC_RX_CSUM_NONE;
+
+    /* The tested frame followed by a marker frame.*/
+    rdes->rdes0 = TIVA_RDES0_FS | TIVA_RDES0_LS | TIVA_RDES0_FL(64 + 4) |
+                  rxcases[i].bits;
+    rdes = NEXT_RD(rdes);
+    rdes->rdes0 = TIVA_RDES0_FS | TIVA_RDES0_LS | TIVA_RDES0_FL(99 + 4);
+    rdes = NEXT_RD(rdes);
+#if TIVA_MAC_USE_SCATTER_GATHER
+    {
+      tiva_mac_segment_t segs[4];
+      tiva_mac_rx_csum_t cs;
+      size_t n = 4;
+
+      CHECK(tivaMacReceiveFrame(&ETHD1, segs, &n, &cs) == MSG_OK);
+      if (csum >= 0) {
+        CHECK((segs[0].size == 64) && ((int)cs == csum));
+        n = 4;
+        CHECK(tivaMacReceiveFrame(&ETHD1, segs, &n, &cs) == MSG_OK);
+      }
+      else
+        errors++;
+      CHECK((segs[0].size == 99) && (cs == TIVA_MAC_RX_CSUM_NONE));
+    }
+#else
+    {
+      MACReceiveDescriptor rd;
+
+      CHECK(mac_lld_get_receive_descriptor(&ETHD1, &rd) == MSG_OK);
+      if (csum >= 0) {
+        CHECK((rd.size == 64) && ((int)tivaMacGetReceiveChecksum(&rd) == csum));
+        mac_lld_release_receive_descriptor(&rd);
+        CHECK(mac_lld_get_receive_descriptor(&ETHD1, &rd) == MSG_OK);
+      }
+      else
+        errors++;
+      CHECK((rd.size == 99) &&
+            (tivaMacGetReceiveChecksum(&rd) == TIVA_MAC_RX_CSUM_NONE));
+      mac_lld_release_receive_descriptor(&rd);
+    }
+#endif
+  }
+#if TIVA_MAC_USE_RX_STATISTICS
+  {
+    tiva_mac_rx_stats_t stats;
+
+    tivaMacGetRxStatistics(&ETHD1, &stats);
+    CHECK(stats.csum_errors == errors);
+  }
+#endif
+}
+
+int main(void) {
+
+  sim_mac_start(&config);
+  CHECK(((SIM_REG(EMAC_O_CFG) & CFG_IPC) != 0) ==
+        (TIVA_MAC_IP_CHECKSUM_OFFLOAD != 0));
+  test_hash();
+  test_tx();
+  test_rx();
+  printf("filter: %s, hash filter and checksum offload ok\n",
+         TIVA_MAC_USE_SCATTER_GATHER ? "scatter-gather" : "copy");
+  return 0;
+}
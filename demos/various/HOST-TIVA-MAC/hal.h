@@ -0,0 +1,103 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+ * Host build of the TIVA MAC low level driver: the EMAC registers are
+ * plain memory, the OSAL is reduced to lock checks.
+ */
+
+#ifndef HAL_H
+#define HAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "hw_memmap.h"
+#include "hw_emac.h"
+#include "hw_sysctl.h"
+
+#define TRUE                                1
+#define FALSE                               0
+
+#define HAL_USE_MAC                         TRUE
+#if !defined(MAC_USE_ZERO_COPY)
+#define MAC_USE_ZERO_COPY                   TRUE
+#endif
+#if !defined(MAC_USE_EVENTS)
+#define MAC_USE_EVENTS                      FALSE
+#endif
+#define HAL_IMPLEMENTS_COUNTERS             FALSE
+
+#define TIVA_SYSCLK                         120000000
+#define BOARD_PHY_ADDRESS                   0
+#define BOARD_PHY_RMII                      FALSE
+
+typedef int32_t msg_t;
+#define MSG_OK                              0
+#define MSG_TIMEOUT                         -1
+#define MSG_RESET                           -2
+
+typedef enum { MAC_UNINIT, MAC_STOP, MAC_ACTIVE } macstate_t;
+typedef struct { int dummy; } threads_queue_t;
+typedef struct MACDriver MACDriver;
+
+/* Lock nesting, checked by the tests.*/
+extern int sim_locked;
+/* Receiving threads woken by the driver.*/
+extern unsigned long sim_wakeups;
+/* Register access, provided by the tests.*/
+volatile uint32_t *sim_reg(uint32_t addr);
+
+#define osalSysLock()                                                       \
+  do { if (sim_locked++) { puts("nested lock"); abort(); } } while (0)
+#define osalSysUnlock()                                                     \
+  do { if (--sim_locked) { puts("bad unlock"); abort(); } } while (0)
+#define osalSysLockFromISR()                osalSysLock()
+#define osalSysUnlockFromISR()              osalSysUnlock()
+#define osalDbgCheck(c)                                                     \
+  do { if (!(c)) { printf("check %s:%d\n", __FILE__, __LINE__); abort(); } } while (0)
+#define osalDbgAssert(c, m)                                                 \
+  do { if (!(c)) { printf("assert %s:%d %s\n", __FILE__, __LINE__, m); abort(); } } while (0)
+#define osalSysHalt(m)                      abort()
+#define osalThreadDequeueAllI(q, m)         ((void)(q), sim_wakeups++)
+#define osalEventBroadcastFlagsI(e, f)      ((void)(e))
+#define osalOsRescheduleS()
+#define chSysPolledDelayX(x)                (void)(x)
+
+#define OSAL_IRQ_IS_VALID_PRIORITY(p)       1
+#define CH_IRQ_HANDLER(x)                   void x(void)
+#define CH_IRQ_PROLOGUE()
+#define CH_IRQ_EPILOGUE()
+#define TIVA_MAC_HANDLER                    mac_isr
+#define TIVA_MAC_NUMBER                     40
+#define nvicEnableVector(n, p)              (void)(n)
+#define nvicDisableVector(n)                (void)(n)
+
+#undef HWREG
+#define HWREG(x)                            (*sim_reg((uint32_t)(x)))
+
+#include "hal_mac_lld.h"
+
+static inline void macObjectInit(MACDriver *macp) {
+
+  macp->state  = MAC_STOP;
+  macp->config = NULL;
+}
+
+#endif /* HAL_H */
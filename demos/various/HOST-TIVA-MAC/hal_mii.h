@@ -0,0 +1,41 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/* MII definitions used by the driver, normally from the HAL.*/
+
+#ifndef HAL_MII_H
+#define HAL_MII_H
+
+#define MII_BMCR                            0x00
+#define MII_BMSR                            0x01
+#define MII_LPA                             0x05
+
+#define BMCR_RESET                          0x8000
+#define BMCR_PDOWN                          0x0800
+#define BMCR_ANENABLE                       0x1000
+#define BMCR_SPEED100                       0x2000
+#define BMCR_FULLDPLX                       0x0100
+
+#define BMSR_LSTATUS                        0x0004
+#define BMSR_RFAULT                         0x0010
+#define BMSR_ANEGCOMPLETE                   0x0020
+
+#define LPA_10FULL                          0x0040
+#define LPA_100HALF                         0x0080
+#define LPA_100FULL                         0x0100
+#define LPA_100BASE4                        0x0200
+
+#endif /* HAL_MII_H */
@@ -0,0 +1,132 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+ * Scatter-gather receive ring, frames held by the caller. Held descriptors
+ * must not be given back to the DMA while the frame is being read, whatever
+ * happens meanwhile: new frames, purged frames, refills and the release of
+ * other frames.
+ */
+
+#include <string.h>
+
+#include "hal.h"
+#include "sim_emac.h"
+
+#define BUFFER_SIZE                         256
+#define POOL_SIZE                           (TIVA_MAC_RECEIVE_DESCRIPTORS + 4)
+#define MAX_HELD                            3
+#define STEPS                               200000
+
+static uint32_t pool[POOL_SIZE][BUFFER_SIZE / 4];
+static int pool_next, pool_limit;
+
+static void *pool_alloc(MACDriver *macp) {
+
+  (void)macp;
+  return (pool_next < pool_limit) ? pool[pool_next++] : NULL;
+}
+
+static void pool_free(MACDriver *macp, void *buf) {
+
+  (void)macp;
+  (void)buf;
+}
+
+static const MACConfig config = {
+  .mac_address    = NULL,
+  .rx_alloc       = pool_alloc,
+  .rx_free        = pool_free,
+  .rx_buffer_size = BUFFER_SIZE,
+  .tx_done        = NULL
+};
+
+/* DMA model, frames not fitting the owned descriptors are dropped.*/
+static tiva_eth_rx_descriptor_t *dma_rd;
+static unsigned long injected, dropped;
+
+#define NEXT(rdes) ((tiva_eth_rx_descriptor_t *)(uintptr_t)(rdes)->rdes3)
+
+static void dma_receive(size_t len, unsigned seq, bool error) {
+  uint8_t frame[1600];
+  tiva_eth_rx_descriptor_t *rdes = dma_rd;
+  size_t total = len + 4, done = 0, n;
+  uint32_t rdes0;
+
+  sim_make_frame(frame, len, seq);
+  injected++;
+  for (n = (total + BUFFER_SIZE - 1) / BUFFER_SIZE; n > 0; n--) {
+    if (!(rdes->rdes0 & TIVA_RDES0_OWN)) {
+      dropped++;
+      return;
+    }
+    rdes = NEXT(rdes);
+  }
+  while (done < total) {
+    n = (total - done < BUFFER_SIZE) ? total - done : BUFFER_SIZE;
+    rdes0 = (done == 0) ? TIVA_RDES0_FS : 0;
+    memcpy((uint8_t *)(uintptr_t)dma_rd->rdes2, frame + done, n);
+    done += n;
+    if (done == total)
+      rdes0 |= TIVA_RDES0_LS | TIVA_RDES0_FL(total) |
+               (error ? TIVA_RDES0_ES : 0);
+    dma_rd->rdes0 = rdes0;
+    dma_rd = NEXT(dma_rd);
+  }
+}
+
+int main(void) {
+  MACReceiveDescriptor held[MAX_HELD];
+  uint8_t buf[1600];
+  unsigned nheld = 0, seq = 0, verified = 0, step, r;
+  size_t n;
+
+  /* The pool starts short of buffers, empty descriptors are refilled.*/
+  pool_limit = TIVA_MAC_RECEIVE_DESCRIPTORS - 2;
+  sim_mac_start(&config);
+  dma_rd = (tiva_eth_rx_descriptor_t *)(uintptr_t)SIM_REG(EMAC_O_RXDLADDR);
+
+  for (step = 0; step < STEPS; step++) {
+    if (step == 1000)
+      pool_limit = POOL_SIZE;
+    r = sim_rnd() % 16;
+    if (r < 7) {
+      n = (sim_rnd() % 4 == 0) ? 60 + sim_rnd() % 700 : 60 + sim_rnd() % 180;
+      dma_receive(n, seq++, sim_rnd() % 6 == 0);
+    }
+    else if ((r < 11) && (nheld < MAX_HELD)) {
+      if (mac_lld_get_receive_descriptor(&ETHD1, &held[nheld]) == MSG_OK)
+        nheld++;
+    }
+    else if ((r < 14) && (nheld > 0)) {
+      /* The oldest frame is read and released.*/
+      n = mac_lld_read_receive_descriptor(&held[0], buf, sizeof buf);
+      CHECK(n == held[0].size);
+      CHECK(sim_check_frame(buf, n));
+      mac_lld_release_receive_descriptor(&held[0]);
+      memmove(&held[0], &held[1], sizeof held[0] * --nheld);
+      verified++;
+    }
+    else if (r == 14)
+      (void)tivaMacRefillReceive(&ETHD1);
+    CHECK(sim_locked == 0);
+  }
+
+  printf("rx_hold: %u frames verified, %lu received, %lu dropped by the DMA\n",
+         verified, injected, dropped);
+  CHECK(verified > STEPS / 20);
+  return 0;
+}
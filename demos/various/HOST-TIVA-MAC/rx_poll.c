@@ -0,0 +1,235 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+ * Polled receive and interrupt coalescing. The receiving thread is modeled
+ * as in the MAC API: it polls until no frame is returned then waits, it is
+ * woken only by a dequeue done while it is waiting.
+ */
+
+#include <string.h>
+
+#include "hal.h"
+#include "sim_emac.h"
+
+#define DMARIS_RI                           (1U << 6)
+#define DMARIS_RU                           (1U << 7)
+#define TICKS                               400000
+
+/* Frames received in a tick at the peak of a burst.*/
+#define PEAK_FRAMES                         2U
+
+/* While the thread waits the ring is empty, the DMA fills it during the
+   watchdog delay at most at the peak rate. Within this bound no frame is
+   lost because the interrupt is held back.*/
+#if TIVA_MAC_RX_WATCHDOG * PEAK_FRAMES > TIVA_MAC_RECEIVE_BUFFERS
+#error "TIVA_MAC_RX_WATCHDOG too long for the receive ring"
+#endif
+
+void mac_isr(void);
+
+static const MACConfig config = {
+  .mac_address = NULL
+};
+
+/* DMA model, one frame per descriptor.*/
+static tiva_eth_rx_descriptor_t *dma_rd;
+static int watchdog = -1;
+static unsigned long sent, dropped, waiting_dropped, isr_calls;
+
+/* Receiving thread state.*/
+static bool waiting = true;
+
+/* Receiver at the same rate woken by the first frame, the drops of the
+   traffic itself.*/
+static unsigned ideal_queued;
+static unsigned long ideal_dropped;
+
+/* Ticks the wake ups are held back after the first frame received while
+   the thread waits.*/
+static unsigned long tick, wait_start, held_ticks;
+static bool held;
+
+static void dma_receive(unsigned seq) {
+  uint8_t *p;
+
+  sent++;
+  if (ideal_queued < TIVA_MAC_RECEIVE_BUFFERS)
+    ideal_queued++;
+  else
+    ideal_dropped++;
+  if (waiting && !held) {
+    held = true;
+    wait_start = tick;
+  }
+  SIM_REG(EMAC_O_RXPOLLD) = 0;
+  if (!(dma_rd->rdes0 & TIVA_RDES0_OWN)) {
+    dropped++;
+    if (waiting)
+      waiting_dropped++;
+    SIM_REG(EMAC_O_MFBOC)++;
+    sim_dmaris |= DMARIS_RU;
+    return;
+  }
+  p = (uint8_t *)(uintptr_t)dma_rd->rdes2;
+  p[0] = (uint8_t)seq;
+  p[1] = (uint8_t)(seq >> 8);
+  dma_rd->rdes0 = TIVA_RDES0_FS | TIVA_RDES0_LS | TIVA_RDES0_FL(64 + 4);
+  if (dma_rd->rdes1 & TIVA_RDES1_DIC) {
+    if (watchdog < 0)
+      watchdog = (int)SIM_REG(EMAC_O_RXINTWDT);
+  }
+  else
+    sim_dmaris |= DMARIS_RI;
+  dma_rd = (tiva_eth_rx_descriptor_t *)(uintptr_t)dma_rd->rdes3;
+}
+
+static void watchdog_tick(void) {
+
+  if (watchdog > 0)
+    watchdog--;
+  if (watchdog == 0) {
+    sim_dmaris |= DMARIS_RI;
+    watchdog = -1;
+  }
+}
+
+static void irq(void) {
+
+  if (!sim_locked && sim_irq_pending(DMARIS_RI)) {
+    isr_calls++;
+    mac_isr();
+  }
+}
+
+/* Receiving thread.*/
+static unsigned long woken_at, received, thread_runs;
+static unsigned expect;
+
+static void thread_step(void) {
+  MACReceiveDescriptor rd;
+  uint8_t b[2];
+  unsigned seq;
+
+  if (waiting) {
+    if (sim_wakeups == woken_at)
+      return;
+    waiting = false;
+    thread_runs++;
+    if (held) {
+      held = false;
+      held_ticks += tick - wait_start;
+    }
+  }
+  if (mac_lld_get_receive_descriptor(&ETHD1, &rd) == MSG_OK) {
+    mac_lld_read_receive_descriptor(&rd, b, 2);
+    seq = b[0] | (b[1] << 8);
+    /* In order, frames dropped by the DMA leave holes.*/
+    CHECK((uint16_t)(seq - expect) < 0x8000U);
+    expect = seq + 1;
+    mac_lld_release_receive_descriptor(&rd);
+    received++;
+  }
+  else {
+    /* Wake ups sent during the call are lost, the thread wasn't queued.*/
+    woken_at = sim_wakeups;
+    waiting = true;
+  }
+  irq();
+}
+
+static void ideal_step(void) {
+
+  if (ideal_queued > 0)
+    ideal_queued--;
+  tick++;
+}
+
+/* A burst larger than the budget, then silence: the ring must drain.*/
+static void test_drain(void) {
+  unsigned i, t;
+
+  for (i = 0; i < TIVA_MAC_RX_BUDGET + 3; i++)
+    dma_receive(expect + i);
+  for (t = 0; t < 1000; t++) {
+    watchdog_tick();
+    irq();
+    thread_step();
+    ideal_step();
+  }
+  CHECK(received == TIVA_MAC_RX_BUDGET + 3);
+}
+
+/* Bursty traffic, at times twice the thread rate.*/
+static void test_bursts(void) {
+  unsigned long t, sent0 = sent, received0 = received, dropped0 = dropped;
+  unsigned long ideal0 = ideal_dropped, held0 = held_ticks;
+  unsigned seq = expect, burst = 0, k;
+  tiva_mac_rx_stats_t stats;
+
+  for (t = 0; t < TICKS + 2000; t++) {
+    if (t < TICKS) {
+      if ((burst == 0) && (sim_rnd() % 200 == 0))
+        burst = 10 + sim_rnd() % 60;
+      if (burst > 0) {
+        for (k = 0; (k < 1U + (sim_rnd() % 4 == 0) * (PEAK_FRAMES - 1U)) &&
+                    (burst > 0); k++, burst--)
+          dma_receive(seq++);
+      }
+      else if (sim_rnd() % 50 == 0)
+        dma_receive(seq++);
+    }
+    watchdog_tick();
+    irq();
+    thread_step();
+    ideal_step();
+    CHECK(sim_locked == 0);
+    /* The polled mode and the interrupt mask must agree.*/
+    CHECK(ETHD1.rxpolling == ((SIM_REG(EMAC_O_DMAIM) & DMARIS_RI) == 0));
+    CHECK(ETHD1.rxbudget <= TIVA_MAC_RX_BUDGET);
+  }
+
+  tivaMacGetRxStatistics(&ETHD1, &stats);
+  printf("rx_poll: budget %d watchdog %d, %lu frames, %lu dropped "
+         "(%lu by an ideal receiver), %lu interrupts, %lu thread wake ups, "
+         "max batch %u\n",
+         TIVA_MAC_RX_BUDGET, TIVA_MAC_RX_WATCHDOG, sent - sent0,
+         dropped - dropped0, ideal_dropped - ideal0,
+         (unsigned long)stats.interrupts, thread_runs,
+         (unsigned)stats.max_batch);
+  CHECK(received - received0 + dropped - dropped0 == sent - sent0);
+  /* Nothing is lost while the interrupt is held back, each tick a wake up
+     is held back costs at most one frame later on.*/
+  CHECK(waiting_dropped == 0);
+  CHECK(dropped - dropped0 <= ideal_dropped - ideal0 + held_ticks - held0);
+#if TIVA_MAC_RX_WATCHDOG == 0
+  CHECK(held_ticks == 0);
+#endif
+  CHECK(stats.missed == dropped);
+  CHECK(stats.frames == received);
+  CHECK(stats.interrupts == isr_calls);
+}
+
+int main(void) {
+
+  sim_mac_start(&config);
+  dma_rd = (tiva_eth_rx_descriptor_t *)(uintptr_t)SIM_REG(EMAC_O_RXDLADDR);
+  woken_at = sim_wakeups;
+
+  test_drain();
+  test_bursts();
+  return 0;
+}
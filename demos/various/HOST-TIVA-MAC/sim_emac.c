@@ -0,0 +1,108 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+ * EMAC register file emulation. Self clearing bits complete at once,
+ * DMARIS is write one to clear and MFBOC is cleared on read.
+ */
+
+#include <string.h>
+
+#include "hal.h"
+#include "sim_emac.h"
+
+int sim_locked;
+unsigned long sim_wakeups;
+uint32_t sim_emac[0x1000 / 4];
+uint32_t sim_dmaris;
+
+#define DMARIS_MARK                         (1U << 30)
+
+static uint32_t dmaris_scratch = DMARIS_MARK;
+
+/* A write to the scratch copy clears the written bits.*/
+static void sync_dmaris(void) {
+
+  if (!(dmaris_scratch & DMARIS_MARK))
+    sim_dmaris &= ~(dmaris_scratch & 0x1FFFFU);
+  dmaris_scratch = sim_dmaris | DMARIS_MARK;
+}
+
+volatile uint32_t *sim_reg(uint32_t addr) {
+  static uint32_t one, scratch;
+
+  sync_dmaris();
+  if (addr == EMAC0_BASE + EMAC_O_DMARIS)
+    return &dmaris_scratch;
+  if (addr == EMAC0_BASE + EMAC_O_MFBOC) {
+    scratch = sim_emac[EMAC_O_MFBOC / 4];
+    sim_emac[EMAC_O_MFBOC / 4] = 0;
+    return &scratch;
+  }
+  if ((addr >= EMAC0_BASE) && (addr < EMAC0_BASE + 0x1000)) {
+    sim_emac[EMAC_O_DMABUSMOD / 4] &= ~1U;
+    sim_emac[EMAC_O_DMAOPMODE / 4] &= ~(1U << 20);
+    sim_emac[EMAC_O_MIIADDR / 4]   &= ~1U;
+    sim_emac[EMAC_O_MIIDATA / 4]   &= ~0x8000U;
+    return &sim_emac[(addr - EMAC0_BASE) / 4];
+  }
+  if ((addr == SYSCTL_PREMAC) || (addr == SYSCTL_PREPHY)) {
+    one = 1;
+    return &one;
+  }
+  scratch = 0;
+  return &scratch;
+}
+
+bool sim_irq_pending(uint32_t mask) {
+
+  sync_dmaris();
+  return (sim_dmaris & sim_emac[EMAC_O_DMAIM / 4] & mask) != 0;
+}
+
+void sim_mac_start(const MACConfig *config) {
+
+  mac_lld_init();
+  ETHD1.config = config;
+  mac_lld_start(&ETHD1);
+  ETHD1.state   = MAC_ACTIVE;
+  ETHD1.link_up = true;
+}
+
+unsigned sim_rnd(void) {
+  static unsigned state = 4242;
+
+  state = state * 1103515245U + 12345U;
+  return (state >> 8) & 0xFFFFFF;
+}
+
+void sim_make_frame(uint8_t *p, size_t len, unsigned seq) {
+  size_t i;
+
+  for (i = 0; i < len; i++)
+    p[i] = (uint8_t)(seq * 7 + i * 13);
+  p[0] = (uint8_t)seq;
+  p[1] = (uint8_t)(seq >> 8);
+}
+
+bool sim_check_frame(const uint8_t *p, size_t len) {
+  uint8_t ref[2048];
+
+  if ((len < 2) || (len > sizeof ref))
+    return false;
+  sim_make_frame(ref, len, p[0] | (p[1] << 8));
+  return memcmp(ref, p, len) == 0;
+}
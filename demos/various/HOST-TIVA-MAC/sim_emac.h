@@ -0,0 +1,42 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/* EMAC register file emulation and test helpers.*/
+
+#ifndef SIM_EMAC_H
+#define SIM_EMAC_H
+
+/* Register file, DMARIS kept apart.*/
+extern uint32_t sim_emac[0x1000 / 4];
+extern uint32_t sim_dmaris;
+
+#define SIM_REG(off)                        sim_emac[(off) / 4]
+
+#define CHECK(c)                                                            \
+  do {                                                                      \
+    if (!(c)) {                                                             \
+      printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #c);                    \
+      exit(1);                                                              \
+    }                                                                       \
+  } while (0)
+
+bool sim_irq_pending(uint32_t mask);
+void sim_mac_start(const MACConfig *config);
+unsigned sim_rnd(void);
+void sim_make_frame(uint8_t *p, size_t len, unsigned seq);
+bool sim_check_frame(const uint8_t *p, size_t len);
+
+#endif /* SIM_EMAC_H */
@@ -0,0 +1,312 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+ * Packet memory allocator: the LLD layouts (KINETIS, HT32, SN32) and random
+ * allocation sequences against a model, buffers are aligned, disjoint and
+ * inside the packet memory, an allocation that does not fit fails and
+ * allocates nothing, a rewind keeps the endpoint zero buffers. Ping-pong
+ * slots against a model of the hardware consuming them in alternation.
+ * Packet copies against memcpy() at every alignment.
+ */
+
+#include <string.h>
+
+#include "hal.h"
+#include "usb_epbuf.h"
+
+#define CHECK(c)                                                            \
+  do { if (!(c)) { printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #c);      \
+                   exit(1); } } while (0)
+
+static uint32_t seed = 0x2468ACE1U;
+
+static uint32_t rnd(void) {
+
+  seed ^= seed << 13;
+  seed ^= seed >> 17;
+  seed ^= seed << 5;
+  return seed;
+}
+
+/*===========================================================================*/
+/* Allocator.                                                                */
+/*===========================================================================*/
+
+#define MAX_BUFS                64U
+
+typedef struct {
+  size_t        offset;
+  size_t        size;
+} buf_t;
+
+/* Live buffers, in allocation order.*/
+static buf_t bufs[MAX_BUFS];
+static unsigned nbufs;
+
+/* Allocates and checks the result against the model.*/
+static size_t alloc(usb_epbuf_pool_t *pp, size_t size) {
+  const size_t next = pp->next, avail = usbEpbufPoolGetFreeX(pp);
+  size_t offset;
+  unsigned i;
+
+  CHECK(avail <= pp->limit - pp->base);
+  offset = usbEpbufPoolAlloc(pp, size);
+  if (size > avail) {
+    CHECK(offset == USB_EPBUF_INVALID);
+    CHECK(pp->next == next);
+    return offset;
+  }
+  CHECK(offset == next);
+  CHECK((offset & (pp->align - 1U)) == 0U);
+  CHECK((offset >= pp->base) && (offset + size <= pp->limit));
+  CHECK(pp->next >= offset + size);
+  CHECK(pp->next - (offset + size) < pp->align);
+  for (i = 0; i < nbufs; i++)
+    CHECK((offset >= bufs[i].offset + bufs[i].size) ||
+          (offset + size <= bufs[i].offset));
+  CHECK(nbufs < MAX_BUFS);
+  bufs[nbufs].offset = offset;
+  bufs[nbufs].size = size;
+  nbufs++;
+  return offset;
+}
+
+static void layout(size_t base, size_t limit, size_t align, size_t ep0,
+                   const size_t *sizes, unsigned n) {
+  usb_epbuf_pool_t pool;
+  size_t first, offset;
+  unsigned i, kept;
+
+  usbEpbufPoolInit(&pool, base, limit, align);
+  nbufs = 0;
+  CHECK(usbEpbufPoolGetFreeX(&pool) == limit - base);
+
+  /* Endpoint zero, then the mark.*/
+  CHECK(alloc(&pool, ep0) == base);
+  CHECK(alloc(&pool, ep0) != USB_EPBUF_INVALID);
+  usbEpbufPoolSetMarkX(&pool);
+  kept = nbufs;
+
+  /* Two configurations in a row, each one after a rewind.*/
+  for (i = 0; i < n; i++)
+    CHECK(alloc(&pool, sizes[i]) != USB_EPBUF_INVALID);
+  first = bufs[kept].offset;
+  while (alloc(&pool, ep0) != USB_EPBUF_INVALID)
+    ;
+  CHECK(usbEpbufPoolGetFreeX(&pool) < ep0);
+  usbEpbufPoolRewindX(&pool);
+  nbufs = kept;
+  for (i = 0; i < n; i++) {
+    offset = alloc(&pool, sizes[i]);
+    CHECK(offset != USB_EPBUF_INVALID);
+    if (i == 0U)
+      CHECK(offset == first);
+  }
+
+  /* Bus reset.*/
+  usbEpbufPoolReset(&pool);
+  nbufs = 0;
+  CHECK(usbEpbufPoolGetFreeX(&pool) == limit - base);
+  CHECK(alloc(&pool, ep0) == base);
+}
+
+static void test_layouts(void) {
+  /* KINETIS: BDT buffers, two slots per direction.*/
+  static const size_t kinetis[] = {64, 64, 64, 64, 8, 8, 512, 512};
+  /* HT32: EPSRAM after the 8 bytes of the setup data.*/
+  static const size_t ht32[] = {64, 64, 8, 64, 64};
+  /* SN32: PMA after the 64 bytes of the descriptors table.*/
+  static const size_t sn32[] = {8, 64, 64, 1};
+
+  layout(0, 4096, 4, 64, kinetis, sizeof kinetis / sizeof kinetis[0]);
+  layout(8, 0x400, 4, 64, ht32, sizeof ht32 / sizeof ht32[0]);
+  layout(64, 256, 2, 8, sn32, sizeof sn32 / sizeof sn32[0]);
+}
+
+static void test_exhaustion(void) {
+  usb_epbuf_pool_t pool;
+
+  /* An allocation that does not fit takes nothing.*/
+  usbEpbufPoolInit(&pool, 0, 100, 8);
+  nbufs = 0;
+  CHECK(alloc(&pool, 64) == 0U);
+  CHECK(alloc(&pool, 64) == USB_EPBUF_INVALID);
+  CHECK(usbEpbufPoolGetFreeX(&pool) == 36U);
+  CHECK(alloc(&pool, 36) == 64U);
+
+  /* The last buffer rounded past an unaligned limit leaves nothing.*/
+  usbEpbufPoolInit(&pool, 0, 100, 8);
+  nbufs = 0;
+  CHECK(alloc(&pool, 64) == 0U);
+  CHECK(alloc(&pool, 35) == 64U);
+  CHECK(usbEpbufPoolGetFreeX(&pool) == 0U);
+  CHECK(alloc(&pool, 1) == USB_EPBUF_INVALID);
+
+  /* Sizes that would wrap the offsets.*/
+  usbEpbufPoolInit(&pool, 16, 1024, 4);
+  nbufs = 0;
+  CHECK(alloc(&pool, (size_t)-8) == USB_EPBUF_INVALID);
+  CHECK(alloc(&pool, 1008) == 16U);
+  CHECK(alloc(&pool, (size_t)-1) == USB_EPBUF_INVALID);
+}
+
+static void test_random_allocs(void) {
+  static const size_t aligns[] = {1, 2, 4, 8, 32};
+  usb_epbuf_pool_t pool;
+  unsigned n, i, ok = 0, failed = 0;
+
+  for (n = 0; n < 2000U; n++) {
+    const size_t align = aligns[rnd() % 5U];
+    const size_t base = (rnd() % 16U) * align;
+    const size_t limit = base + rnd() % 2048U;
+    unsigned kept = 0;
+
+    usbEpbufPoolInit(&pool, base, limit, align);
+    nbufs = 0;
+    for (i = 0; i < 48U; i++) {
+      switch (rnd() % 16U) {
+      case 0:
+        usbEpbufPoolSetMarkX(&pool);
+        kept = nbufs;
+        break;
+      case 1:
+        usbEpbufPoolRewindX(&pool);
+        nbufs = kept;
+        break;
+      default:
+        if (alloc(&pool, 1U + rnd() % 160U) != USB_EPBUF_INVALID)
+          ok++;
+        else
+          failed++;
+        break;
+      }
+    }
+  }
+  CHECK((ok > 1000U) && (failed > 1000U));
+}
+
+/*===========================================================================*/
+/* Ping-pong.                                                                */
+/*===========================================================================*/
+
+static void test_pingpong(void) {
+  usb_pingpong_t pp;
+  unsigned hw_next, n, queue[2], queued = 0;
+
+  /* The hardware consumes the slots in alternation from the first one,
+     the armed slots must be the ones it is going to consume, in order.*/
+  for (hw_next = 0; hw_next < 2U; hw_next++) {
+    unsigned first = hw_next;
+
+    usbPingPongResetX(&pp, first);
+    queued = 0;
+    CHECK(usbPingPongIsEmptyX(&pp) && (usbPingPongArmedX(&pp) == 0U));
+    for (n = 0; n < 10000U; n++) {
+      switch (rnd() % 8U) {
+      case 0:
+      case 1:
+      case 2:
+        if (!usbPingPongIsFullX(&pp)) {
+          queue[queued++] = usbPingPongArmX(&pp);
+          CHECK(queue[queued - 1U] == ((hw_next + queued - 1U) & 1U));
+        }
+        break;
+      case 3:
+      case 4:
+      case 5:
+        if (queued > 0U) {
+          CHECK(queue[0] == hw_next);
+          usbPingPongCompleteX(&pp, hw_next);
+          hw_next ^= 1U;
+          queue[0] = queue[1];
+          queued--;
+        }
+        break;
+      case 6:
+        /* A SETUP reclaims the slots not sent, the hardware still expects
+           the slot after the last one completed.*/
+        usbPingPongFlushX(&pp);
+        queued = 0;
+        break;
+      default:
+        break;
+      }
+      CHECK(usbPingPongArmedX(&pp) == queued);
+      CHECK(usbPingPongIsEmptyX(&pp) == (queued == 0U));
+      CHECK(usbPingPongIsFullX(&pp) == (queued == USB_EPBUF_SLOTS));
+    }
+    hw_next = first;
+  }
+}
+
+/*===========================================================================*/
+/* Copies.                                                                   */
+/*===========================================================================*/
+
+#define COPY_MAX                70U
+
+static void test_copies(void) {
+  uint8_t src[COPY_MAX + 8U], ref[COPY_MAX + 16U], dst[COPY_MAX + 16U];
+  uint32_t words[COPY_MAX / 4U + 4U], wref[COPY_MAX / 4U + 4U];
+  unsigned so, doff, n, i;
+
+  for (i = 0; i < sizeof src; i++)
+    src[i] = (uint8_t)rnd();
+
+  for (so = 0; so < 4U; so++) {
+    for (n = 0; n <= COPY_MAX; n++) {
+      const uint8_t *s = &src[so];
+
+      /* Memory to memory.*/
+      for (doff = 0; doff < 4U; doff++) {
+        memset(ref, 0xA5, sizeof ref);
+        memset(dst, 0xA5, sizeof dst);
+        memcpy(&ref[doff + 4U], s, n);
+        usbEpbufCopy(&dst[doff + 4U], s, n);
+        CHECK(memcmp(dst, ref, sizeof dst) == 0);
+      }
+
+      /* To a word-only memory, the last word zero padded.*/
+      memset(wref, 0xA5, sizeof wref);
+      memset(wref, 0x00, (n + 3U) / 4U * 4U);
+      memcpy(wref, s, n);
+      memset(words, 0xA5, sizeof words);
+      usbEpbufWriteWords(words, s, n);
+      CHECK(memcmp(words, wref, sizeof words) == 0);
+
+      /* From a word-only memory.*/
+      for (doff = 0; doff < 4U; doff++) {
+        memset(ref, 0xA5, sizeof ref);
+        memset(dst, 0xA5, sizeof dst);
+        memcpy(&ref[doff + 4U], wref, n);
+        usbEpbufReadWords(&dst[doff + 4U], words, n);
+        CHECK(memcmp(dst, ref, sizeof dst) == 0);
+      }
+    }
+  }
+}
+
+int main(void) {
+
+  test_layouts();
+  test_exhaustion();
+  test_random_allocs();
+  test_pingpong();
+  test_copies();
+  printf("epbuf: allocator, ping-pong and copies ok\n");
+  return 0;
+}
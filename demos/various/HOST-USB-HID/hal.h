@@ -0,0 +1,120 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+
+/*
+ * Host build of the USB device HID class driver: the kernel is the
+ * simulation of HOST-USBH (osal.h), the USB device driver is reduced to
+ * the endpoint state the class driver uses and served by a host polling
+ * model (sim_usbd.c), the buffers queues are a model of the HAL ones
+ * (hal_buffers.h).
+ */
+
+#ifndef HAL_H
+#define HAL_H
+
+#include <string.h>
+
+#include "osal.h"
+
+#define HAL_USE_USB                         TRUE
+#define HAL_USE_USB_HID                     TRUE
+
+#define USB_HID_BUFFERS_SIZE                64
+#define USB_HID_BUFFERS_NUMBER              2
+#define USB_HID_USE_COALESCING              TRUE
+#define USB_HID_USE_BATCHING                TRUE
+#define SERIAL_USB_BUFFERS_SIZE             USB_HID_BUFFERS_SIZE
+
+#define USB_MAX_ENDPOINTS                   4
+
+#define USB_RTYPE_DIR_MASK                  0x80U
+#define USB_RTYPE_DIR_DEV2HOST              0x80U
+#define USB_RTYPE_TYPE_MASK                 0x60U
+#define USB_RTYPE_TYPE_CLASS                0x20U
+#define USB_RTYPE_RECIPIENT_MASK            0x1FU
+#define USB_RTYPE_RECIPIENT_INTERFACE       0x01U
+#define USB_REQ_GET_DESCRIPTOR              6U
+
+typedef uint8_t usbep_t;
+
+typedef enum {
+  USB_UNINIT = 0,
+  USB_STOP = 1,
+  USB_READY = 2,
+  USB_SELECTED = 3,
+  USB_ACTIVE = 4,
+  USB_SUSPENDED = 5
+} usbstate_t;
+
+typedef struct {
+  size_t                ud_size;
+  const uint8_t         *ud_string;
+} USBDescriptor;
+
+typedef struct USBDriver USBDriver;
+
+typedef void (*usbcallback_t)(USBDriver *usbp);
+
+typedef struct {
+  size_t                txsize;
+} USBInEndpointState;
+
+typedef struct {
+  size_t                rxsize;
+} USBOutEndpointState;
+
+typedef struct {
+  uint16_t              in_maxsize;
+  uint16_t              out_maxsize;
+  USBInEndpointState    *in_state;
+  USBOutEndpointState   *out_state;
+} USBEndpointConfig;
+
+typedef struct {
+  const USBDescriptor * (*get_descriptor_cb)(USBDriver *usbp, uint8_t dtype,
+                                             uint8_t dindex, uint16_t lang);
+} USBConfig;
+
+struct USBDriver {
+  usbstate_t            state;
+  const USBConfig       *config;
+  const USBEndpointConfig *epc[USB_MAX_ENDPOINTS + 1];
+  void                  *in_params[USB_MAX_ENDPOINTS];
+  void                  *out_params[USB_MAX_ENDPOINTS];
+  uint16_t              transmitting;
+  uint16_t              receiving;
+  uint8_t               setup[8];
+  /* Transfers started on the IN endpoints.*/
+  const uint8_t         *txbuf[USB_MAX_ENDPOINTS + 1];
+};
+
+#define usbGetDriverStateI(usbp)            ((usbp)->state)
+#define usbGetTransmitStatusI(usbp, ep)     (((usbp)->transmitting & (1U << (ep))) != 0U)
+#define usbGetReceiveStatusI(usbp, ep)      (((usbp)->receiving & (1U << (ep))) != 0U)
+#define usbGetReceiveTransactionSizeX(usbp, ep)                             \
+  ((usbp)->epc[ep]->out_state->rxsize)
+#define usbSetupTransfer(usbp, buf, n, endcb)                               \
+  ((void)(usbp), (void)(buf), (void)(n), (void)(endcb))
+
+void usbStartTransmitI(USBDriver *usbp, usbep_t ep, const uint8_t *buf, size_t n);
+void usbStartReceiveI(USBDriver *usbp, usbep_t ep, uint8_t *buf, size_t n);
+
+#include "hal_channels.h"
+#include "hal_buffers.h"
+#include "hal_usb_hid.h"
+
+#endif /* HAL_H */
@@ -0,0 +1,87 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+
+/*
+ * Model of the HAL I/O buffers queues, same layout and semantics: each
+ * buffer is a size field followed by the data, the output queue fills
+ * one buffer at a time and posts it full or flushed.
+ */
+
+#ifndef HAL_BUFFERS_H
+#define HAL_BUFFERS_H
+
+#include "osal.h"
+
+typedef struct io_buffers_queue io_buffers_queue_t;
+
+typedef void (*bqnotify_t)(io_buffers_queue_t *bqp);
+
+struct io_buffers_queue {
+  threads_queue_t       waiting;
+  bool                  suspended;
+  size_t                bcounter;
+  uint8_t               *bwrptr;
+  uint8_t               *brdptr;
+  uint8_t               *btop;
+  size_t                bsize;
+  size_t                bn;
+  uint8_t               *buffers;
+  uint8_t               *ptr;
+  uint8_t               *top;
+  bqnotify_t            notify;
+  void                  *link;
+};
+
+typedef io_buffers_queue_t input_buffers_queue_t;
+typedef io_buffers_queue_t output_buffers_queue_t;
+
+#define BQ_BUFFER_SIZE(n, size)                                             \
+  (((size_t)(size) + sizeof (size_t)) * (size_t)(n))
+
+#define bqSizeX(bqp)                        ((bqp)->bn)
+#define bqSpaceI(bqp)                       ((bqp)->bcounter)
+#define bqGetLinkX(bqp)                     ((bqp)->link)
+#define ibqIsEmptyI(ibqp)                   ((bool)(bqSpaceI(ibqp) == 0U))
+#define ibqIsFullI(ibqp)                                                    \
+  ((bool)(((ibqp)->bwrptr == (ibqp)->brdptr) && ((ibqp)->bcounter != 0U)))
+#define obqIsEmptyI(obqp)                                                   \
+  ((bool)(((obqp)->bwrptr == (obqp)->brdptr) && ((obqp)->bcounter != 0U)))
+#define obqIsFullI(obqp)                    ((bool)(bqSpaceI(obqp) == 0U))
+
+void ibqObjectInit(input_buffers_queue_t *ibqp, bool suspended, uint8_t *bp,
+                   size_t size, size_t n, bqnotify_t infy, void *link);
+void ibqResetI(input_buffers_queue_t *ibqp);
+uint8_t *ibqGetEmptyBufferI(input_buffers_queue_t *ibqp);
+void ibqPostFullBufferI(input_buffers_queue_t *ibqp, size_t size);
+msg_t ibqGetTimeout(input_buffers_queue_t *ibqp, sysinterval_t timeout);
+size_t ibqReadTimeout(input_buffers_queue_t *ibqp, uint8_t *bp,
+                      size_t n, sysinterval_t timeout);
+void obqObjectInit(output_buffers_queue_t *obqp, bool suspended, uint8_t *bp,
+                   size_t size, size_t n, bqnotify_t onfy, void *link);
+void obqResetI(output_buffers_queue_t *obqp);
+uint8_t *obqGetFullBufferI(output_buffers_queue_t *obqp, size_t *sizep);
+void obqReleaseEmptyBufferI(output_buffers_queue_t *obqp);
+msg_t obqGetEmptyBufferTimeoutS(output_buffers_queue_t *obqp,
+                                sysinterval_t timeout);
+void obqPostFullBufferS(output_buffers_queue_t *obqp, size_t size);
+msg_t obqPutTimeout(output_buffers_queue_t *obqp, uint8_t b,
+                    sysinterval_t timeout);
+size_t obqWriteTimeout(output_buffers_queue_t *obqp, const uint8_t *bp,
+                       size_t n, sysinterval_t timeout);
+void obqFlush(output_buffers_queue_t *obqp);
+
+#endif /* HAL_BUFFERS_H */
@@ -0,0 +1,246 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+ * HID reports against a host polling the interrupt IN endpoint: queued
+ * reports arrive in order one per transfer, batched reports arrive in
+ * order packed in transfers of up to the packet size, the writer of a
+ * full batch waits for the next poll, latest-value reports replace the
+ * ones the host has not read yet. A disconnection wakes a waiting writer
+ * and the lost reports are counted.
+ */
+
+#include <unistd.h>
+
+#include "sim_usbd.h"
+
+#define REPORT                              8U
+
+/* Host side log of the received reports.*/
+static uint32_t rx_next;                    /* Expected sequence number.*/
+static uint32_t rx_last;                    /* Last sequence number.*/
+static unsigned long rx_reports;
+static size_t rx_max;                       /* Largest transfer.*/
+static bool rx_latest;                      /* Gaps are allowed.*/
+
+static void report_make(uint8_t *p, uint32_t seq) {
+
+  memset(p, (int)(seq & 0xFFU), REPORT);
+  p[0] = (uint8_t)seq;
+  p[1] = (uint8_t)(seq >> 8);
+  p[2] = (uint8_t)(seq >> 16);
+  p[3] = (uint8_t)(seq >> 24);
+}
+
+static void host_in(const uint8_t *data, size_t n) {
+  size_t i;
+
+  /* Zero length packets after full ones carry nothing.*/
+  if (n == 0U)
+    return;
+  CHECK((n % REPORT) == 0U);
+  CHECK(n <= SIM_EP_SIZE);
+  if (n > rx_max)
+    rx_max = n;
+  for (i = 0; i < n; i += REPORT) {
+    const uint8_t *const p = &data[i];
+    const uint32_t seq = (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+                         ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+
+    CHECK(p[REPORT - 1U] == (uint8_t)seq);
+    if (rx_latest)
+      CHECK(seq >= rx_next);
+    else
+      CHECK(seq == rx_next);
+    rx_next = seq + 1U;
+    rx_last = seq;
+    rx_reports++;
+  }
+}
+
+static void setup(unsigned interval, bool latest) {
+
+  sim_hid_setup(interval);
+  sim_in_hook = host_in;
+  sim_frame_hook = NULL;
+  rx_next = 0;
+  rx_reports = 0;
+  rx_max = 0;
+  rx_latest = latest;
+}
+
+/* Frames until the host has read all the reports.*/
+static void drain(void) {
+  unsigned n;
+
+  for (n = 0; (n < 1000U) && (usbGetTransmitStatusI(&USBD1, SIM_EP_IN) ||
+                              (UHD1.batch_n > 0U)); n++)
+    sim_run(1);
+  CHECK(n < 1000U);
+}
+
+static void test_queue(void) {
+  uint8_t report[REPORT];
+  uint32_t seq;
+
+  setup(1, false);
+  for (seq = 0; seq < 20U; seq++) {
+    report_make(report, seq);
+    CHECK(hidWriteReport(&UHD1, report, REPORT) == REPORT);
+  }
+  drain();
+  CHECK(rx_reports == 20U);
+  CHECK(rx_max == REPORT);
+  CHECK(hidGetStatsX(&UHD1)->sent == 20U);
+  CHECK(hidGetStatsX(&UHD1)->dropped == 0U);
+}
+
+static void test_batch_paced(void) {
+  uint8_t report[REPORT];
+  uint32_t seq;
+
+  /* One report per frame, one poll every 4 frames.*/
+  setup(4, false);
+  for (seq = 0; seq < 64U; seq++) {
+    report_make(report, seq);
+    CHECK(hidWriteReportBatch(&UHD1, report, REPORT, TIME_INFINITE) == REPORT);
+    osalThreadSleep(1);
+  }
+  drain();
+  CHECK(rx_reports == 64U);
+  CHECK(sim_host.transfers <= 64U / 4U + 2U);
+  CHECK(hidGetStatsX(&UHD1)->batched == 64U);
+  CHECK(hidGetStatsX(&UHD1)->dropped == 0U);
+}
+
+static void test_batch_burst(void) {
+  uint8_t report[REPORT];
+  uint32_t seq, tries;
+
+  /* Back to back, the writer waits for the polls.*/
+  setup(8, false);
+  for (seq = 0; seq < 40U; seq++) {
+    report_make(report, seq);
+    CHECK(hidWriteReportBatch(&UHD1, report, REPORT, TIME_INFINITE) == REPORT);
+  }
+  drain();
+  CHECK(rx_reports == 40U);
+  CHECK(rx_max == SIM_EP_SIZE);
+
+  /* Without waiting the reports beyond the batch are dropped.*/
+  for (tries = 0; tries < 40U; tries++) {
+    report_make(report, seq);
+    if (hidWriteReportBatch(&UHD1, report, REPORT, TIME_IMMEDIATE) == REPORT)
+      seq++;
+  }
+  CHECK(seq - 40U <= 1U + SIM_EP_SIZE / REPORT);
+  CHECK(hidGetStatsX(&UHD1)->dropped == tries - (seq - 40U));
+  drain();
+  CHECK(rx_reports == seq);
+}
+
+static void test_latest(void) {
+  uint8_t report[REPORT];
+  uint32_t seq;
+
+  /* A report per frame, the host reads every 8 frames.*/
+  setup(8, true);
+  for (seq = 0; seq < 80U; seq++) {
+    report_make(report, seq);
+    CHECK(hidWriteReportLatest(&UHD1, report, REPORT) == REPORT);
+    osalThreadSleep(1);
+  }
+  drain();
+  CHECK(rx_last == 79U);
+  CHECK(rx_reports <= 80U / 8U + 2U);
+  CHECK(hidGetStatsX(&UHD1)->coalesced + rx_reports == 80U);
+}
+
+static unsigned disconnect_at;
+
+static void disconnect(void) {
+
+  if (sim_now == disconnect_at) {
+    USBD1.state = USB_READY;
+    hidDisconnectI(&UHD1);
+  }
+}
+
+static void test_disconnect(void) {
+  uint8_t report[REPORT];
+  uint32_t seq;
+
+  /* Nobody polls: the first report takes the endpoint, the next ones fill
+     the batch, the one after waits until the disconnection.*/
+  setup(0, false);
+  for (seq = 0; seq < 1U + SIM_EP_SIZE / REPORT; seq++) {
+    report_make(report, seq);
+    CHECK(hidWriteReportBatch(&UHD1, report, REPORT, TIME_INFINITE) == REPORT);
+  }
+  disconnect_at = sim_now + 5U;
+  sim_frame_hook = disconnect;
+  CHECK(hidWriteReportBatch(&UHD1, report, REPORT, TIME_INFINITE) == 0U);
+  CHECK(sim_now == disconnect_at);
+  CHECK(UHD1.batch_n == 0U);
+  CHECK(hidGetStatsX(&UHD1)->dropped == 1U);
+
+  /* Writes on an inactive device are counted too.*/
+  CHECK(hidWriteReport(&UHD1, report, REPORT) == 0U);
+  CHECK(hidWriteReportt(&UHD1, report, REPORT, TIME_IMMEDIATE) == 0U);
+  CHECK(hidGetStatsX(&UHD1)->dropped == 3U);
+  sim_frame_hook = NULL;
+}
+
+/* Frames to deliver n reports written as fast as possible.*/
+static unsigned long bench(bool batch, unsigned n) {
+  const systime_t start = sim_now;
+  uint8_t report[REPORT];
+  uint32_t seq;
+
+  setup(1, false);
+  for (seq = 0; seq < n; seq++) {
+    report_make(report, seq);
+    if (batch)
+      CHECK(hidWriteReportBatch(&UHD1, report, REPORT, TIME_INFINITE) == REPORT);
+    else
+      CHECK(hidWriteReport(&UHD1, report, REPORT) == REPORT);
+  }
+  drain();
+  CHECK(rx_reports == n);
+  return sim_now - start;
+}
+
+int main(void) {
+  unsigned long queue_frames, batch_frames;
+
+  /* A writer that is never woken fails instead of hanging.*/
+  alarm(30);
+
+  test_queue();
+  test_batch_paced();
+  test_batch_burst();
+  test_latest();
+  test_disconnect();
+
+  queue_frames = bench(false, 800);
+  batch_frames = bench(true, 800);
+  CHECK(batch_frames * 4U < queue_frames);
+
+  printf("poll: queued, batched and latest-value reports ok\n");
+  printf("poll: 800 %u byte reports polled every frame, queued %lu frames, "
+         "batched %lu frames\n", REPORT, queue_frames, batch_frames);
+  return 0;
+}
@@ -0,0 +1,280 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/* Model of the HAL I/O buffers queues.*/
+
+#include <string.h>
+
+#include "hal.h"
+
+static void bq_init(io_buffers_queue_t *bqp, bool suspended, uint8_t *bp,
+                    size_t size, size_t n, bqnotify_t nfy, void *link) {
+
+  osalDbgCheck((bp != NULL) && (size >= 2U) && (n >= 2U));
+  chThdQueueObjectInit(&bqp->waiting);
+  bqp->suspended = suspended;
+  bqp->bwrptr    = bp;
+  bqp->brdptr    = bp;
+  bqp->btop      = bp + ((size + sizeof (size_t)) * n);
+  bqp->bsize     = size + sizeof (size_t);
+  bqp->bn        = n;
+  bqp->buffers   = bp;
+  bqp->ptr       = NULL;
+  bqp->top       = NULL;
+  bqp->notify    = nfy;
+  bqp->link      = link;
+}
+
+static uint8_t *bq_next(io_buffers_queue_t *bqp, uint8_t *p) {
+
+  p += bqp->bsize;
+  return (p >= bqp->btop) ? bqp->buffers : p;
+}
+
+/*===========================================================================*/
+/* Input queues.                                                             */
+/*===========================================================================*/
+
+void ibqObjectInit(input_buffers_queue_t *ibqp, bool suspended, uint8_t *bp,
+                   size_t size, size_t n, bqnotify_t infy, void *link) {
+
+  bq_init(ibqp, suspended, bp, size, n, infy, link);
+  ibqp->bcounter = 0;
+}
+
+void ibqResetI(input_buffers_queue_t *ibqp) {
+
+  osalDbgCheckClassI();
+  ibqp->bcounter = 0;
+  ibqp->brdptr   = ibqp->buffers;
+  ibqp->bwrptr   = ibqp->buffers;
+  ibqp->ptr      = NULL;
+  ibqp->top      = NULL;
+  osalThreadDequeueAllI(&ibqp->waiting, MSG_RESET);
+}
+
+uint8_t *ibqGetEmptyBufferI(input_buffers_queue_t *ibqp) {
+
+  osalDbgCheckClassI();
+  if (ibqIsFullI(ibqp))
+    return NULL;
+  return ibqp->bwrptr + sizeof (size_t);
+}
+
+void ibqPostFullBufferI(input_buffers_queue_t *ibqp, size_t size) {
+
+  osalDbgCheckClassI();
+  osalDbgCheck((size > 0U) && (size <= ibqp->bsize - sizeof (size_t)));
+  osalDbgAssert(!ibqIsFullI(ibqp), "buffers queue full");
+  *((size_t *)ibqp->bwrptr) = size;
+  ibqp->bcounter++;
+  ibqp->bwrptr = bq_next(ibqp, ibqp->bwrptr);
+  osalThreadDequeueNextI(&ibqp->waiting, MSG_OK);
+}
+
+static msg_t ibq_get_full_bufferS(input_buffers_queue_t *ibqp,
+                                  sysinterval_t timeout) {
+
+  while (ibqIsEmptyI(ibqp)) {
+    msg_t msg;
+
+    if (ibqp->suspended)
+      return MSG_RESET;
+    msg = osalThreadEnqueueTimeoutS(&ibqp->waiting, timeout);
+    if (msg < MSG_OK)
+      return msg;
+  }
+  ibqp->ptr = ibqp->brdptr + sizeof (size_t);
+  ibqp->top = ibqp->ptr + *((size_t *)ibqp->brdptr);
+  return MSG_OK;
+}
+
+static void ibq_release_empty_bufferS(input_buffers_queue_t *ibqp) {
+
+  ibqp->bcounter--;
+  ibqp->brdptr = bq_next(ibqp, ibqp->brdptr);
+  ibqp->ptr = NULL;
+  ibqp->top = NULL;
+  if (ibqp->notify != NULL)
+    ibqp->notify(ibqp);
+}
+
+msg_t ibqGetTimeout(input_buffers_queue_t *ibqp, sysinterval_t timeout) {
+  msg_t msg;
+
+  osalSysLock();
+  if (ibqp->ptr == NULL) {
+    msg = ibq_get_full_bufferS(ibqp, timeout);
+    if (msg != MSG_OK) {
+      osalSysUnlock();
+      return msg;
+    }
+  }
+  msg = (msg_t)*ibqp->ptr++;
+  if (ibqp->ptr >= ibqp->top)
+    ibq_release_empty_bufferS(ibqp);
+  osalSysUnlock();
+  return msg;
+}
+
+size_t ibqReadTimeout(input_buffers_queue_t *ibqp, uint8_t *bp,
+                      size_t n, sysinterval_t timeout) {
+  size_t r = 0;
+
+  osalSysLock();
+  while (r < n) {
+    size_t size;
+
+    if (ibqp->ptr == NULL) {
+      if (ibq_get_full_bufferS(ibqp, timeout) != MSG_OK)
+        break;
+    }
+    size = (size_t)(ibqp->top - ibqp->ptr);
+    if (size > n - r)
+      size = n - r;
+    memcpy(bp, ibqp->ptr, size);
+    bp += size;
+    ibqp->ptr += size;
+    r += size;
+    if (ibqp->ptr >= ibqp->top)
+      ibq_release_empty_bufferS(ibqp);
+  }
+  osalSysUnlock();
+  return r;
+}
+
+/*===========================================================================*/
+/* Output queues.                                                            */
+/*===========================================================================*/
+
+void obqObjectInit(output_buffers_queue_t *obqp, bool suspended, uint8_t *bp,
+                   size_t size, size_t n, bqnotify_t onfy, void *link) {
+
+  bq_init(obqp, suspended, bp, size, n, onfy, link);
+  obqp->bcounter = n;
+}
+
+void obqResetI(output_buffers_queue_t *obqp) {
+
+  osalDbgCheckClassI();
+  obqp->bcounter = bqSizeX(obqp);
+  obqp->brdptr   = obqp->buffers;
+  obqp->bwrptr   = obqp->buffers;
+  obqp->ptr      = NULL;
+  obqp->top      = NULL;
+  osalThreadDequeueAllI(&obqp->waiting, MSG_RESET);
+}
+
+uint8_t *obqGetFullBufferI(output_buffers_queue_t *obqp, size_t *sizep) {
+
+  osalDbgCheckClassI();
+  if (obqIsEmptyI(obqp))
+    return NULL;
+  *sizep = *((size_t *)obqp->brdptr);
+  return obqp->brdptr + sizeof (size_t);
+}
+
+void obqReleaseEmptyBufferI(output_buffers_queue_t *obqp) {
+
+  osalDbgCheckClassI();
+  osalDbgAssert(!obqIsEmptyI(obqp), "buffers queue empty");
+  obqp->bcounter++;
+  obqp->brdptr = bq_next(obqp, obqp->brdptr);
+  osalThreadDequeueNextI(&obqp->waiting, MSG_OK);
+}
+
+msg_t obqGetEmptyBufferTimeoutS(output_buffers_queue_t *obqp,
+                                sysinterval_t timeout) {
+
+  osalDbgCheckClassS();
+  while (obqIsFullI(obqp)) {
+    msg_t msg = osalThreadEnqueueTimeoutS(&obqp->waiting, timeout);
+    if (msg < MSG_OK)
+      return msg;
+  }
+  obqp->ptr = obqp->bwrptr + sizeof (size_t);
+  obqp->top = obqp->bwrptr + obqp->bsize;
+  return MSG_OK;
+}
+
+void obqPostFullBufferS(output_buffers_queue_t *obqp, size_t size) {
+
+  osalDbgCheckClassS();
+  osalDbgCheck((size > 0U) && (size <= obqp->bsize - sizeof (size_t)));
+  osalDbgAssert(!obqIsFullI(obqp), "buffers queue full");
+  *((size_t *)obqp->bwrptr) = size;
+  obqp->bcounter--;
+  obqp->bwrptr = bq_next(obqp, obqp->bwrptr);
+  obqp->ptr = NULL;
+  obqp->top = NULL;
+  if (obqp->notify != NULL)
+    obqp->notify(obqp);
+}
+
+msg_t obqPutTimeout(output_buffers_queue_t *obqp, uint8_t b,
+                    sysinterval_t timeout) {
+
+  osalSysLock();
+  if (obqp->ptr == NULL) {
+    msg_t msg = obqGetEmptyBufferTimeoutS(obqp, timeout);
+    if (msg != MSG_OK) {
+      osalSysUnlock();
+      return msg;
+    }
+  }
+  *obqp->ptr++ = b;
+  if (obqp->ptr >= obqp->top)
+    obqPostFullBufferS(obqp, obqp->bsize - sizeof (size_t));
+  osalSysUnlock();
+  return MSG_OK;
+}
+
+size_t obqWriteTimeout(output_buffers_queue_t *obqp, const uint8_t *bp,
+                       size_t n, sysinterval_t timeout) {
+  size_t w = 0;
+
+  osalSysLock();
+  while (w < n) {
+    size_t size;
+
+    if (obqp->ptr == NULL) {
+      if (obqGetEmptyBufferTimeoutS(obqp, timeout) != MSG_OK)
+        break;
+    }
+    size = (size_t)(obqp->top - obqp->ptr);
+    if (size > n - w)
+      size = n - w;
+    memcpy(obqp->ptr, bp, size);
+    bp += size;
+    obqp->ptr += size;
+    w += size;
+    if (obqp->ptr >= obqp->top)
+      obqPostFullBufferS(obqp, obqp->bsize - sizeof (size_t));
+  }
+  osalSysUnlock();
+  return w;
+}
+
+void obqFlush(output_buffers_queue_t *obqp) {
+
+  osalSysLock();
+  if (obqp->ptr != NULL) {
+    size_t size = (size_t)(obqp->ptr - (obqp->bwrptr + sizeof (size_t)));
+    if (size > 0U)
+      obqPostFullBufferS(obqp, size);
+  }
+  osalSysUnlock();
+}
@@ -0,0 +1,92 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/* Host polling model of the HID tests.*/
+
+#include "sim_usbd.h"
+
+sim_host_t sim_host;
+void (*sim_in_hook)(const uint8_t *data, size_t n);
+
+USBDriver USBD1;
+USBHIDDriver UHD1;
+
+static USBInEndpointState in_state;
+static USBOutEndpointState out_state;
+
+static const USBEndpointConfig ep_in_config = {
+  SIM_EP_SIZE, 0, &in_state, NULL
+};
+
+static const USBEndpointConfig ep_out_config = {
+  0, SIM_EP_SIZE, NULL, &out_state
+};
+
+static const USBHIDConfig hid_config = {
+  &USBD1, SIM_EP_IN, SIM_EP_OUT
+};
+
+void usbStartTransmitI(USBDriver *usbp, usbep_t ep, const uint8_t *buf, size_t n) {
+
+  osalDbgCheckClassI();
+  osalDbgAssert(!usbGetTransmitStatusI(usbp, ep), "endpoint busy");
+  usbp->transmitting |= (uint16_t)(1U << ep);
+  usbp->txbuf[ep] = buf;
+  usbp->epc[ep]->in_state->txsize = n;
+}
+
+void usbStartReceiveI(USBDriver *usbp, usbep_t ep, uint8_t *buf, size_t n) {
+
+  osalDbgCheckClassI();
+  (void)buf;
+  (void)n;
+  usbp->receiving |= (uint16_t)(1U << ep);
+}
+
+void sim_bus_frame(void) {
+  USBDriver *const usbp = &USBD1;
+  size_t n;
+
+  if ((sim_host.interval == 0U) || ((sim_now % sim_host.interval) != 0U))
+    return;
+  sim_host.polls++;
+  if ((usbp->state != USB_ACTIVE) || !usbGetTransmitStatusI(usbp, SIM_EP_IN)) {
+    sim_host.naks++;
+    return;
+  }
+  n = usbp->epc[SIM_EP_IN]->in_state->txsize;
+  sim_host.transfers++;
+  sim_host.bytes += n;
+  if (sim_in_hook != NULL)
+    sim_in_hook(usbp->txbuf[SIM_EP_IN], n);
+  usbp->transmitting &= (uint16_t)~(1U << SIM_EP_IN);
+  hidDataTransmitted(usbp, SIM_EP_IN);
+}
+
+void sim_hid_setup(unsigned interval) {
+
+  memset(&USBD1, 0, sizeof (USBD1));
+  memset(&sim_host, 0, sizeof (sim_host));
+  USBD1.epc[SIM_EP_IN] = &ep_in_config;
+  USBD1.epc[SIM_EP_OUT] = &ep_out_config;
+  USBD1.state = USB_ACTIVE;
+  hidObjectInit(&UHD1);
+  hidStart(&UHD1, &hid_config);
+  osalSysLock();
+  hidConfigureHookI(&UHD1);
+  osalSysUnlock();
+  sim_host.interval = interval;
+}
@@ -0,0 +1,59 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/* Host polling model of the HID tests.*/
+
+#ifndef SIM_USBD_H
+#define SIM_USBD_H
+
+#include "hal.h"
+
+#define CHECK(c)                                                            \
+  do {                                                                      \
+    if (!(c)) {                                                             \
+      printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #c);                    \
+      exit(1);                                                              \
+    }                                                                       \
+  } while (0)
+
+#define SIM_EP_IN                           1U
+#define SIM_EP_OUT                          2U
+#define SIM_EP_SIZE                         64U
+
+/*
+ * The host polls the interrupt IN endpoint every interval frames: a
+ * transfer started by the driver is taken, handed to the hook and
+ * completed with hidDataTransmitted(), otherwise the poll is NAKed.
+ */
+typedef struct {
+  unsigned              interval;
+  unsigned long         polls;
+  unsigned long         naks;
+  unsigned long         transfers;
+  unsigned long         bytes;
+} sim_host_t;
+
+extern sim_host_t sim_host;
+extern void (*sim_in_hook)(const uint8_t *data, size_t n);
+
+extern USBDriver USBD1;
+extern USBHIDDriver UHD1;
+
+/* Configures the device and starts the driver, the host polls every
+   interval frames.*/
+void sim_hid_setup(unsigned interval);
+
+#endif /* SIM_USBD_H */
@@ -0,0 +1,321 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+ * AOA packet API: IN packets are delivered in order and empty ones are
+ * skipped, OUT packets reach the phone in order while the producer waits
+ * for a free one. A STALL of the IN endpoint stops the IN packets instead
+ * of resubmitting them. The stream functions and the packet API reject a
+ * channel started by the other.
+ */
+
+#include <string.h>
+#include <unistd.h>
+
+#include "sim_usbh.h"
+#include "usbh/dev/aoa.h"
+
+#define PACKET                              HAL_USBHAOA_PACKET_SIZE
+#define LOG_SIZE                            32U
+#define BENCH_BYTES                         (256U * 1024U)
+
+static const uint8_t config[] = {
+  /* Accessory interface, two bulk endpoints.*/
+  USBH_DT_INTERFACE_SIZE, USBH_DT_INTERFACE, 0, 0, 2, 0xff, 0xff, 0x00, 0,
+  USBH_DT_ENDPOINT_SIZE, USBH_DT_ENDPOINT, 0x81, USBH_EPTYPE_BULK,
+  (uint8_t)PACKET, (uint8_t)(PACKET >> 8), 0,
+  USBH_DT_ENDPOINT_SIZE, USBH_DT_ENDPOINT, 0x01, USBH_EPTYPE_BULK,
+  (uint8_t)PACKET, (uint8_t)(PACKET >> 8), 0,
+};
+
+static USBHAOADriver *aoap;
+
+/* Phone behaviour, IN side: a script of packet lengths, then either NAKs
+   or a continuous stream of counting bytes.*/
+static const uint16_t *in_script;
+static unsigned in_script_n;
+static unsigned in_sent;
+static bool in_stream;
+static uint8_t in_byte;
+static unsigned in_stall_after;             /* Packets before a STALL, 0 none.*/
+static unsigned in_stalls;
+
+/* OUT side: one packet accepted per frame, logged in arrival order.*/
+static systime_t out_last;
+static uint8_t out_seq[LOG_SIZE];
+static uint16_t out_len[LOG_SIZE];
+static unsigned out_n;
+
+static usbh_urbstatus_t device(usbh_urb_t *urb) {
+  uint8_t buf[PACKET];
+
+  if (urb->ep->in) {
+    if ((in_stall_after != 0U) && (in_sent >= in_stall_after)) {
+      /* Each packet in flight STALLs once, none is resubmitted.*/
+      CHECK(++in_stalls <= HAL_USBHAOA_IN_PACKETS);
+      return USBH_URBSTATUS_STALL;
+    }
+    if (in_sent < in_script_n) {
+      memset(buf, (int)in_sent, sizeof(buf));
+      sim_urb_in(urb, buf, in_script[in_sent]);
+    } else if (in_stream) {
+      uint32_t i;
+      for (i = 0; i < urb->requestedLength; i++)
+        buf[i] = in_byte++;
+      sim_urb_in(urb, buf, urb->requestedLength);
+    } else {
+      return USBH_URBSTATUS_PENDING;
+    }
+    in_sent++;
+    return USBH_URBSTATUS_OK;
+  }
+
+  if (out_last == sim_now)
+    return USBH_URBSTATUS_PENDING;
+  out_last = sim_now;
+  CHECK(out_n < LOG_SIZE);
+  out_len[out_n] = (uint16_t)sim_urb_out(urb, buf, urb->requestedLength);
+  out_seq[out_n] = buf[0];
+  out_n++;
+  return USBH_URBSTATUS_OK;
+}
+
+static void device_reset(void) {
+
+  in_script = NULL;
+  in_script_n = 0;
+  in_sent = 0;
+  in_stream = false;
+  in_stall_after = 0;
+  in_stalls = 0;
+  out_n = 0;
+}
+
+static void restart(bool packets) {
+
+  usbhaoaChannelStop(aoap);
+  /* The mock LLD aborts the URBs of a closed endpoint as disconnected,
+     the device is still there.*/
+  aoap->state = USBHAOA_STATE_READY;
+  aoap->channel.state = USBHAOA_CHANNEL_STATE_ACTIVE;
+  device_reset();
+  if (packets)
+    usbhaoaPacketStart(aoap);
+  else
+    usbhaoaChannelStart(aoap);
+}
+
+static void test_packets_in(void) {
+  static const uint16_t lengths[] = {PACKET, 100, 0, PACKET, 7, 0, 0, 64};
+  const uint8_t *p;
+  size_t len;
+  unsigned i, n = 0;
+
+  device_reset();
+  in_script = lengths;
+  in_script_n = sizeof(lengths) / sizeof(lengths[0]);
+  for (i = 0; i < in_script_n; i++) {
+    if (lengths[i] == 0U)
+      continue;
+    p = usbhaoaPacketReceive(aoap, &len, OSAL_MS2I(100));
+    CHECK(p != NULL);
+    CHECK(len == lengths[i]);
+    CHECK((p[0] == i) && (p[len - 1] == i));
+    usbhaoaPacketRelease(aoap);
+    n++;
+  }
+  CHECK(usbhaoaPacketReceive(aoap, &len, OSAL_MS2I(10)) == NULL);
+  CHECK(usbhaoaGetPacketStats(aoap)->in_packets == n);
+  CHECK(usbhaoaGetPacketStats(aoap)->in_errors == 0);
+  CHECK(usbhaoaPacketGetInStatus(aoap) == USBH_URBSTATUS_OK);
+}
+
+static void test_packets_out(void) {
+  const unsigned count = 2U * HAL_USBHAOA_OUT_PACKETS + 3U;
+  unsigned i;
+
+  device_reset();
+  for (i = 0; i < count; i++) {
+    uint8_t *const buff = usbhaoaPacketAcquire(aoap, OSAL_MS2I(100));
+    CHECK(buff != NULL);
+    memset(buff, (int)i, PACKET);
+    CHECK(usbhaoaPacketSubmit(aoap, PACKET - i) == HAL_SUCCESS);
+  }
+  sim_run(count + 2U);
+  CHECK(usbhaoaPacketsInFlight(aoap) == 0);
+  CHECK(out_n == count);
+  for (i = 0; i < count; i++)
+    CHECK((out_seq[i] == i) && (out_len[i] == PACKET - i));
+  /* The phone takes one packet per frame: the producer waited.*/
+  CHECK(usbhaoaGetPacketStats(aoap)->out_waits > 0);
+  CHECK(usbhaoaGetPacketStats(aoap)->out_packets == count);
+}
+
+static void test_stream_rejected(void) {
+  const unsigned long submits = sim_submits;
+  uint8_t buf[4] = {1, 2, 3, 4};
+  USBHAOAChannel *const chp = &aoap->channel;
+
+  /* The stream URBs are not initialized in packet mode.*/
+  CHECK(chnWriteTimeout(chp, buf, sizeof(buf), OSAL_MS2I(10)) == 0);
+  CHECK(chnPutTimeout(chp, 0x55, OSAL_MS2I(10)) == Q_RESET);
+  CHECK(chnReadTimeout(chp, buf, sizeof(buf), OSAL_MS2I(10)) == 0);
+  CHECK(chnGetTimeout(chp, OSAL_MS2I(10)) == Q_RESET);
+  sim_run(40);
+  CHECK(sim_submits == submits);
+}
+
+static void test_in_stall(void) {
+  static const uint16_t lengths[] = {PACKET, PACKET};
+  const uint8_t *p;
+  size_t len;
+  unsigned stalls;
+
+  restart(true);
+  in_script = lengths;
+  in_script_n = 2;
+  in_stall_after = 2;
+
+  /* The packets received before the STALL are delivered.*/
+  p = usbhaoaPacketReceive(aoap, &len, OSAL_MS2I(100));
+  CHECK((p != NULL) && (p[0] == 0));
+  usbhaoaPacketRelease(aoap);
+  p = usbhaoaPacketReceive(aoap, &len, OSAL_MS2I(100));
+  CHECK((p != NULL) && (p[0] == 1));
+  usbhaoaPacketRelease(aoap);
+
+  /* Then the IN packets stop, with the error.*/
+  CHECK(usbhaoaPacketReceive(aoap, &len, OSAL_MS2I(100)) == NULL);
+  CHECK(usbhaoaPacketGetInStatus(aoap) == USBH_URBSTATUS_STALL);
+  CHECK(usbhaoaGetPacketStats(aoap)->in_errors > 0);
+
+  /* Nothing is resubmitted to the halted endpoint.*/
+  stalls = in_stalls;
+  usbhaoaPacketRelease(aoap);
+  CHECK(usbhaoaPacketReceive(aoap, &len, OSAL_MS2I(100)) == NULL);
+  sim_run(100);
+  CHECK(in_stalls == stalls);
+
+  /* OUT packets are not affected.*/
+  CHECK(usbhaoaPacketAcquire(aoap, OSAL_MS2I(10)) != NULL);
+  CHECK(usbhaoaPacketSubmit(aoap, 16) == HAL_SUCCESS);
+  sim_run(3);
+  CHECK(out_n == 1);
+
+  /* A restart clears the error.*/
+  restart(true);
+  CHECK(usbhaoaPacketGetInStatus(aoap) == USBH_URBSTATUS_OK);
+}
+
+static void test_packets_rejected(void) {
+  size_t len;
+  uint8_t b;
+
+  restart(false);
+  CHECK(usbhaoaPacketAcquire(aoap, OSAL_MS2I(10)) == NULL);
+  CHECK(usbhaoaPacketSubmit(aoap, 16) == HAL_FAILED);
+  CHECK(usbhaoaPacketReceive(aoap, &len, OSAL_MS2I(10)) == NULL);
+
+  /* The stream works.*/
+  in_stream = true;
+  in_byte = 0x40;
+  CHECK(chnReadTimeout(&aoap->channel, &b, 1, OSAL_MS2I(100)) == 1);
+  CHECK(b == 0x40);
+}
+
+/* Frames and wakeups of the reading thread to receive BENCH_BYTES.*/
+static unsigned long bench(bool packets, unsigned long *wakeups) {
+  static uint8_t buf[4096];
+  const unsigned long frames0 = sim_frames;
+  const unsigned long wakeups0 = sim_wakeups;
+  uint8_t expected = 0;
+  unsigned done = 0;
+
+  restart(packets);
+  in_stream = true;
+  in_byte = 0;
+  while (done < BENCH_BYTES) {
+    const uint8_t *p;
+    size_t len, i;
+
+    if (packets) {
+      p = usbhaoaPacketReceive(aoap, &len, TIME_INFINITE);
+      CHECK(p != NULL);
+    } else {
+      len = chnReadTimeout(&aoap->channel, buf, sizeof(buf), TIME_INFINITE);
+      CHECK(len == sizeof(buf));
+      p = buf;
+    }
+    for (i = 0; i < len; i++)
+      CHECK(p[i] == expected++);
+    if (packets)
+      usbhaoaPacketRelease(aoap);
+    done += len;
+  }
+  *wakeups = sim_wakeups - wakeups0;
+  return sim_frames - frames0;
+}
+
+int main(void) {
+  static const usbh_endpoint_descriptor_t ep0_desc = {
+    .bLength          = USBH_DT_ENDPOINT_SIZE,
+    .bDescriptorType  = USBH_DT_ENDPOINT,
+    .bEndpointAddress = 0,
+    .bmAttributes     = USBH_EPTYPE_CTRL,
+    .wMaxPacketSize   = 64,
+    .bInterval        = 0
+  };
+  unsigned long stream_frames, packet_frames, stream_wakeups, packet_wakeups;
+  usbh_device_t *dev;
+
+  /* A receive resubmitting packets to the halted endpoint never returns,
+     the URBs fail as they are submitted.*/
+  alarm(30);
+
+  usbhInit();
+  usbhStart(&USBHD1);
+  dev = sim_device_setup(USBH_DEVSPEED_HIGH);
+  dev->devDesc.idVendor = 0x18D1;
+  dev->devDesc.idProduct = 0x2D00;
+  usbhEPObjectInit(&dev->ctrl, dev, &ep0_desc);
+  usbhEPOpen(&dev->ctrl);
+  sim_transfer = device;
+
+  CHECK(_usbh_classdriver_load(dev, config, sizeof(config)) == HAL_SUCCESS);
+  aoap = &USBHAOAD[0];
+  CHECK(dev->drivers == (usbh_baseclassdriver_t *)aoap);
+  CHECK(usbhaoaGetState(aoap) == USBHAOA_STATE_READY);
+
+  device_reset();
+  usbhaoaPacketStart(aoap);
+  test_packets_in();
+  test_packets_out();
+  test_stream_rejected();
+  test_in_stall();
+  test_packets_rejected();
+
+  stream_frames = bench(false, &stream_wakeups);
+  packet_frames = bench(true, &packet_wakeups);
+  CHECK(packet_frames < stream_frames);
+  usbhaoaChannelStop(aoap);
+
+  printf("aoa: packet order, IN STALL and mode checks ok\n");
+  printf("aoa: %u KB IN, stream %lu frames %lu wakeups, "
+         "packets %lu frames %lu wakeups (%u x %u bytes)\n",
+         BENCH_BYTES / 1024U, stream_frames, stream_wakeups,
+         packet_frames, packet_wakeups, HAL_USBHAOA_IN_PACKETS, PACKET);
+  return 0;
+}
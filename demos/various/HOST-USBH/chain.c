@@ -0,0 +1,243 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+ * URB chains: a chain completes back to back with a single wakeup, stops
+ * at the first URB that fails to submit or completes with an error, and
+ * leaves no link behind once its URBs have completed.
+ */
+
+#include <string.h>
+
+#include "sim_usbh.h"
+
+#define URB_SIZE                            4096U
+#define CHAIN                               8U
+#define BENCH_BYTES                         (1024U * 1024U)
+
+static const usbh_endpoint_descriptor_t bulk_in_desc = {
+  .bLength          = USBH_DT_ENDPOINT_SIZE,
+  .bDescriptorType  = USBH_DT_ENDPOINT,
+  .bEndpointAddress = 0x81,
+  .bmAttributes     = USBH_EPTYPE_BULK,
+  .wMaxPacketSize   = 512,
+  .bInterval        = 0
+};
+
+static usbh_ep_t ep;
+static usbh_urb_t urbs[CHAIN];
+static uint8_t buffers[CHAIN][URB_SIZE];
+static uint8_t pattern[URB_SIZE];
+
+/* Device behaviour.*/
+static unsigned stall_at;                   /* 1-based URB to STALL, 0 none.*/
+static bool nak_all;
+static unsigned served;
+static unsigned disable_after;              /* Port drop after n submits.*/
+
+static usbh_urbstatus_t device(usbh_urb_t *urb) {
+
+  if (nak_all)
+    return USBH_URBSTATUS_PENDING;
+  if (++served == stall_at)
+    return USBH_URBSTATUS_STALL;
+  sim_urb_in(urb, pattern, urb->requestedLength);
+  return USBH_URBSTATUS_OK;
+}
+
+static void port_drop(usbh_urb_t *urb) {
+
+  (void)urb;
+  if (--disable_after == 0)
+    USBHD1.rootport.status &= ~USBH_PORTSTATUS_ENABLE;
+}
+
+static void reset(void) {
+  unsigned i;
+
+  usbh_lld_ep_reset(&ep);
+  USBHD1.rootport.status |= USBH_PORTSTATUS_ENABLE;
+  for (i = 0; i < CHAIN; i++)
+    usbhURBObjectInit(&urbs[i], &ep, NULL, NULL, buffers[i], URB_SIZE);
+  stall_at = 0;
+  nak_all = false;
+  served = 0;
+  sim_submit_hook = NULL;
+  sim_wakeups = 0;
+}
+
+static void check_idle(unsigned n) {
+  unsigned i;
+
+  for (i = 0; i < n; i++) {
+    CHECK(!usbhURBIsBusy(&urbs[i]));
+    CHECK(urbs[i].next == NULL);
+    CHECK(urbs[i].queued == FALSE);
+  }
+  CHECK(list_empty(&ep.urb_list));
+}
+
+static void test_chain_ok(void) {
+  msg_t msg;
+  unsigned i;
+
+  reset();
+  osalSysLock();
+  msg = usbhURBChainSubmitAndWaitS(urbs, CHAIN, TIME_INFINITE);
+  osalSysUnlock();
+  CHECK(msg == MSG_OK);
+  for (i = 0; i < CHAIN; i++) {
+    CHECK(urbs[i].status == USBH_URBSTATUS_OK);
+    CHECK(urbs[i].actualLength == URB_SIZE);
+    CHECK(memcmp(buffers[i], pattern, URB_SIZE) == 0);
+  }
+  CHECK(sim_wakeups == 1);
+  check_idle(CHAIN);
+}
+
+static void test_chain_submit_failure(void) {
+  const unsigned long completions = sim_completions;
+  unsigned i;
+
+  /* The port drops while the third URB is being queued: the first three
+     are queued, the fourth fails to submit.*/
+  reset();
+  disable_after = 3;
+  sim_submit_hook = port_drop;
+  osalSysLock();
+  usbhURBChainSubmitI(urbs, CHAIN);
+  osalSysUnlock();
+  for (i = 0; i < CHAIN; i++)
+    CHECK(urbs[i].status == USBH_URBSTATUS_DISCONNECTED);
+  check_idle(CHAIN);
+
+  /* Nothing of the chain is left for the bus.*/
+  sim_run(10);
+  CHECK(sim_completions == completions);
+  CHECK(served == 0);
+}
+
+static void test_chain_error(void) {
+  msg_t msg;
+  unsigned i;
+
+  /* The third URB STALLs, the rest of the chain is aborted with it.*/
+  reset();
+  stall_at = 3;
+  osalSysLock();
+  msg = usbhURBChainSubmitAndWaitS(urbs, CHAIN, TIME_INFINITE);
+  osalSysUnlock();
+  CHECK(msg != MSG_OK);
+  CHECK((urbs[0].status == USBH_URBSTATUS_OK) &&
+        (urbs[1].status == USBH_URBSTATUS_OK));
+  for (i = 2; i < CHAIN; i++)
+    CHECK(urbs[i].status == USBH_URBSTATUS_STALL);
+  CHECK(served == 3);
+  check_idle(CHAIN);
+}
+
+static void test_chain_timeout(void) {
+  msg_t msg;
+  unsigned i;
+
+  reset();
+  nak_all = true;
+  osalSysLock();
+  msg = usbhURBChainSubmitAndWaitS(urbs, CHAIN, OSAL_MS2I(50));
+  osalSysUnlock();
+  CHECK(msg == MSG_TIMEOUT);
+  for (i = 0; i < CHAIN; i++)
+    CHECK(urbs[i].status == USBH_URBSTATUS_TIMEOUT);
+  check_idle(CHAIN);
+}
+
+static void test_stale_link(void) {
+  msg_t msg;
+
+  /* After the chain completes its URBs are reused on their own: a STALL
+     of the former head must not abort the former second URB.*/
+  reset();
+  osalSysLock();
+  msg = usbhURBChainSubmitAndWaitS(urbs, 2, TIME_INFINITE);
+  CHECK(msg == MSG_OK);
+  CHECK((urbs[0].next == NULL) && (urbs[1].next == NULL));
+
+  stall_at = served + 1;
+  usbhURBObjectResetI(&urbs[0]);
+  usbhURBObjectResetI(&urbs[1]);
+  usbhURBSubmitI(&urbs[0]);
+  usbhURBSubmitI(&urbs[1]);
+  msg = usbhURBWaitTimeoutS(&urbs[1], TIME_INFINITE);
+  osalSysUnlock();
+  CHECK(msg == MSG_OK);
+  CHECK(urbs[0].status == USBH_URBSTATUS_STALL);
+  CHECK(urbs[1].status == USBH_URBSTATUS_OK);
+  check_idle(2);
+}
+
+/* Wakeups of the reading thread to move BENCH_BYTES.*/
+static unsigned long bench(unsigned chain, unsigned long *frames) {
+  const unsigned long frames0 = sim_frames;
+  unsigned done;
+
+  reset();
+  for (done = 0; done < BENCH_BYTES; done += chain * URB_SIZE) {
+    unsigned i;
+
+    for (i = 0; i < chain; i++)
+      usbhURBObjectInit(&urbs[i], &ep, NULL, NULL, buffers[i], URB_SIZE);
+    osalSysLock();
+    if (chain == 1)
+      CHECK(usbhURBSubmitAndWaitS(&urbs[0], TIME_INFINITE) == MSG_OK);
+    else
+      CHECK(usbhURBChainSubmitAndWaitS(urbs, chain, TIME_INFINITE) == MSG_OK);
+    osalSysUnlock();
+  }
+  *frames = sim_frames - frames0;
+  return sim_wakeups;
+}
+
+int main(void) {
+  unsigned long single, chained, single_frames, chained_frames;
+  unsigned i;
+  usbh_device_t *dev;
+
+  for (i = 0; i < URB_SIZE; i++)
+    pattern[i] = (uint8_t)(i * 7U + 1U);
+
+  usbhInit();
+  usbhStart(&USBHD1);
+  dev = sim_device_setup(USBH_DEVSPEED_HIGH);
+  usbhEPObjectInit(&ep, dev, &bulk_in_desc);
+  usbhEPOpen(&ep);
+  sim_transfer = device;
+
+  test_chain_ok();
+  test_chain_submit_failure();
+  test_chain_error();
+  test_chain_timeout();
+  test_stale_link();
+
+  single = bench(1, &single_frames);
+  chained = bench(CHAIN, &chained_frames);
+  CHECK(single == BENCH_BYTES / URB_SIZE);
+  CHECK(chained == single / CHAIN);
+  printf("chain: submit failure, error, timeout and links ok\n");
+  printf("chain: %u byte URBs, wakeups per MB: %lu single, %lu chained "
+         "(x%u), frames per MB: %lu single, %lu chained\n",
+         URB_SIZE, single, chained, CHAIN, single_frames, chained_frames);
+  return 0;
+}
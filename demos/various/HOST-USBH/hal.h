@@ -0,0 +1,55 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+ * Host build of the USB host stack: the kernel is simulated (osal.h), the
+ * low level driver is a mock serving URBs from a device model (sim_usbh.h).
+ * The class drivers are selected by the tests with -D options.
+ */
+
+#ifndef HAL_H
+#define HAL_H
+
+#include "osal.h"
+
+#define HAL_USE_USBH                        TRUE
+#define USBH_DEBUG_ENABLE                   FALSE
+#define USBH_DEBUG_MULTI_HOST               FALSE
+#define USBH_DEBUG_ENABLE_TRACE             FALSE
+#define USBH_DEBUG_ENABLE_INFO              FALSE
+#define USBH_DEBUG_ENABLE_WARNINGS          FALSE
+#define USBH_DEBUG_ENABLE_ERRORS            FALSE
+#define USBH_DEBUG_BUFFER                   256
+
+#define HAL_USBH_PORT_DEBOUNCE_TIME         200
+#define HAL_USBH_PORT_RESET_TIMEOUT         500
+#define HAL_USBH_DEVICE_ADDRESS_STABILIZATION 20
+#define HAL_USBH_CONTROL_REQUEST_DEFAULT_TIMEOUT OSAL_MS2I(1000)
+
+/* Class drivers, enabled by the tests with -D options.*/
+#define HAL_USBHHID_MAX_INSTANCES           1
+#define HAL_USBHHUB_MAX_INSTANCES           1
+#define HAL_USBHHUB_MAX_PORTS               4
+#define HAL_USBHAOA_MAX_INSTANCES           1
+#define USBHAOA_DEBUG_ENABLE_TRACE          FALSE
+#define USBHAOA_DEBUG_ENABLE_INFO           FALSE
+#define USBHAOA_DEBUG_ENABLE_WARNINGS       FALSE
+#define USBHAOA_DEBUG_ENABLE_ERRORS         FALSE
+
+#include "hal_channels.h"
+#include "hal_usbh.h"
+
+#endif /* HAL_H */
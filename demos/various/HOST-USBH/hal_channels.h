@@ -0,0 +1,56 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/* Asynchronous channel subset used by the class drivers.*/
+
+#ifndef HAL_CHANNELS_H
+#define HAL_CHANNELS_H
+
+#include "osal.h"
+
+#define CHN_NO_ERROR                        (eventflags_t)0
+#define CHN_CONNECTED                       (eventflags_t)1
+#define CHN_DISCONNECTED                    (eventflags_t)2
+#define CHN_INPUT_AVAILABLE                 (eventflags_t)4
+#define CHN_OUTPUT_EMPTY                    (eventflags_t)8
+#define CHN_TRANSMISSION_END                (eventflags_t)16
+
+#define _base_asynchronous_channel_methods                                  \
+  size_t instance_offset;                                                   \
+  size_t (*write)(void *instance, const uint8_t *bp, size_t n);             \
+  size_t (*read)(void *instance, uint8_t *bp, size_t n);                    \
+  msg_t (*put)(void *instance, uint8_t b);                                  \
+  msg_t (*get)(void *instance);                                             \
+  msg_t (*putt)(void *instance, uint8_t b, sysinterval_t time);             \
+  msg_t (*gett)(void *instance, sysinterval_t time);                        \
+  size_t (*writet)(void *instance, const uint8_t *bp, size_t n,             \
+                   sysinterval_t time);                                     \
+  size_t (*readt)(void *instance, uint8_t *bp, size_t n,                    \
+                  sysinterval_t time);                                      \
+  msg_t (*ctl)(void *instance, unsigned int operation, void *arg);
+
+#define _base_asynchronous_channel_data                                     \
+  event_source_t event;
+
+#define chnAddFlagsI(ip, flags)                                             \
+  osalEventBroadcastFlagsI(&(ip)->event, flags)
+
+#define chnPutTimeout(ip, b, time)          ((ip)->vmt->putt(ip, b, time))
+#define chnGetTimeout(ip, time)             ((ip)->vmt->gett(ip, time))
+#define chnWriteTimeout(ip, bp, n, time)    ((ip)->vmt->writet(ip, bp, n, time))
+#define chnReadTimeout(ip, bp, n, time)     ((ip)->vmt->readt(ip, bp, n, time))
+
+#endif /* HAL_CHANNELS_H */
@@ -0,0 +1,75 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+ * Mock USB host low level driver. Every frame the URBs at the head of the
+ * open endpoints are offered to the device model of the test (sim_usbh.h),
+ * which answers with data, a NAK or an error. The root port is a plain
+ * status word driven by the tests.
+ */
+
+#ifndef HAL_USBH_LLD_H
+#define HAL_USBH_LLD_H
+
+#include "hal.h"
+
+#if HAL_USE_USBH
+
+#include "osal.h"
+
+#define _usbhdriver_ll_data                                                 \
+  struct list_head ep_list;         /* open endpoints */
+
+#define _usbh_ep_ll_data                                                    \
+  struct list_head urb_list;        /* queued URBs */                       \
+  struct list_head node;            /* in the open endpoints list */
+
+#define _usbh_port_ll_data                                                  \
+  uint16_t lld_c_status;                                                    \
+  uint16_t lld_status;
+
+#define _usbh_device_ll_data
+#define _usbh_hub_ll_data
+
+#define _usbh_urb_ll_data                                                   \
+  struct list_head node;            /* in the endpoint queue */             \
+  bool queued;
+
+#define usbh_lld_urb_object_init(urb)   ((urb)->queued = FALSE)
+#define usbh_lld_urb_object_reset(urb)                                      \
+  osalDbgAssert((urb)->queued == FALSE, "wrong state")
+
+void usbh_lld_init(void);
+void usbh_lld_start(USBHDriver *usbh);
+void usbh_lld_stop(USBHDriver *usbh);
+void usbh_lld_ep_object_init(usbh_ep_t *ep);
+bool usbh_lld_ep_open(usbh_ep_t *ep);
+void usbh_lld_ep_close(usbh_ep_t *ep);
+bool usbh_lld_ep_reset(usbh_ep_t *ep);
+void usbh_lld_urb_submit(usbh_urb_t *urb);
+bool usbh_lld_urb_abort(usbh_urb_t *urb, usbh_urbstatus_t status);
+usbh_urbstatus_t usbh_lld_root_hub_request(USBHDriver *usbh, uint8_t bmRequestType, uint8_t bRequest,
+		uint16_t wvalue, uint16_t windex, uint16_t wlength, uint8_t *buf);
+uint8_t usbh_lld_roothub_get_statuschange_bitmap(USBHDriver *usbh);
+
+#define USBH_LLD_DEFINE_BUFFER(var) var __attribute__((aligned(4)))
+#define USBH_LLD_DECLARE_STRUCT_MEMBER(member) member __attribute__((aligned(4)))
+
+extern USBHDriver USBHD1;
+
+#endif
+
+#endif /* HAL_USBH_LLD_H */
@@ -0,0 +1,241 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+ * HID report queue: received reports are queued in order and the ones
+ * arriving on a full queue are counted, cb_report is not called. Output
+ * reports sent with usbhhidSetReport() and the ones queued on the
+ * interrupt OUT endpoint reach the device in the order they were issued.
+ */
+
+#include <string.h>
+
+#include "sim_usbh.h"
+#include "usbh/dev/hid.h"
+
+#define REPORT_SIZE                         8U
+#define LOG_SIZE                            32U
+
+#define HID_REQ_SET_REPORT                  0x09
+
+static const uint8_t config[] = {
+  /* Interface 0, HID, two endpoints.*/
+  USBH_DT_INTERFACE_SIZE, USBH_DT_INTERFACE, 0, 0, 2, 0x03, 0x00, 0x00, 0,
+  /* HID descriptor, no report descriptor.*/
+  9, 0x21, 0x11, 0x01, 0, 1, 0x22, 0, 0,
+  USBH_DT_ENDPOINT_SIZE, USBH_DT_ENDPOINT, 0x81, USBH_EPTYPE_INT,
+  REPORT_SIZE, 0, 1,
+  USBH_DT_ENDPOINT_SIZE, USBH_DT_ENDPOINT, 0x02, USBH_EPTYPE_INT,
+  REPORT_SIZE, 0, 1,
+};
+
+static USBHHIDDriver *hidp;
+
+/* Device behaviour.*/
+static unsigned in_left;                    /* Reports still to send.*/
+static uint8_t in_seq;
+static systime_t in_last;
+static unsigned out_naks;                   /* Interrupt OUT NAKs left.*/
+static unsigned ctrl_naks;                  /* SET_REPORT NAKs left.*/
+
+/* Output reports in arrival order: 'C' control, 'I' interrupt, and the
+   first byte of the report.*/
+static char log_pipe[LOG_SIZE];
+static uint8_t log_id[LOG_SIZE];
+static unsigned log_n;
+
+static unsigned cb_calls;
+
+static void log_put(char pipe, uint8_t id) {
+
+  CHECK(log_n < LOG_SIZE);
+  log_pipe[log_n] = pipe;
+  log_id[log_n] = id;
+  log_n++;
+}
+
+static usbh_urbstatus_t device(usbh_urb_t *urb) {
+  usbh_ep_t *const ep = urb->ep;
+  uint8_t report[REPORT_SIZE];
+
+  if (ep->type == USBH_EPTYPE_CTRL) {
+    const usbh_control_request_t *const req = urb->setup_buff;
+    if (req->bRequest == HID_REQ_SET_REPORT) {
+      if (ctrl_naks > 0U) {
+        ctrl_naks--;
+        return USBH_URBSTATUS_PENDING;
+      }
+      CHECK(sim_urb_out(urb, report, req->wLength) == req->wLength);
+      log_put('C', report[0]);
+    }
+    return USBH_URBSTATUS_OK;
+  }
+
+  if (ep->in) {
+    /* One report per frame.*/
+    if ((in_left == 0U) || (in_last == sim_now))
+      return USBH_URBSTATUS_PENDING;
+    in_last = sim_now;
+    in_left--;
+    memset(report, in_seq++, sizeof(report));
+    sim_urb_in(urb, report, sizeof(report));
+    return USBH_URBSTATUS_OK;
+  }
+
+  if (out_naks > 0U) {
+    out_naks--;
+    return USBH_URBSTATUS_PENDING;
+  }
+  CHECK(sim_urb_out(urb, report, REPORT_SIZE) == REPORT_SIZE);
+  log_put('I', report[0]);
+  return USBH_URBSTATUS_OK;
+}
+
+static void report_cb(USBHHIDDriver *drv, uint16_t len) {
+
+  (void)drv;
+  (void)len;
+  cb_calls++;
+}
+
+static const USBHHIDConfig hidcfg = {
+  report_cb,
+  NULL,
+  0,
+  USBHHID_PROTOCOL_REPORT
+};
+
+static bool queue_out(uint8_t id) {
+  uint8_t report[REPORT_SIZE];
+
+  memset(report, id, sizeof(report));
+  return usbhhidQueueOutputReport(hidp, report, sizeof(report));
+}
+
+static usbh_urbstatus_t set_report(usbhhid_reporttype_t type, uint8_t id) {
+  uint8_t report[REPORT_SIZE];
+
+  memset(report, id, sizeof(report));
+  return usbhhidSetReport(hidp, 0, type, report, sizeof(report));
+}
+
+static void check_log(const char *pipes, const uint8_t *ids) {
+  unsigned i;
+
+  CHECK(log_n == strlen(pipes));
+  for (i = 0; i < log_n; i++) {
+    CHECK(log_pipe[i] == pipes[i]);
+    CHECK(log_id[i] == ids[i]);
+  }
+}
+
+static void test_in_queue(void) {
+  uint8_t report[REPORT_SIZE];
+  uint8_t i;
+
+  /* 20 reports while nobody reads: the queue keeps the first ones.*/
+  in_left = 20;
+  sim_run(40);
+  CHECK(in_left == 0U);
+  CHECK(usbhhidGetOverruns(hidp) == 20U - HAL_USBHHID_REPORT_QUEUE_SIZE);
+  for (i = 0; i < HAL_USBHHID_REPORT_QUEUE_SIZE; i++) {
+    CHECK(usbhhidReadReport(hidp, report, sizeof(report), TIME_IMMEDIATE) == REPORT_SIZE);
+    CHECK(report[0] == i);
+  }
+  CHECK(usbhhidReadReport(hidp, report, sizeof(report), TIME_IMMEDIATE) == 0U);
+
+  /* A blocked reader gets the next ones as they arrive.*/
+  in_left = 5;
+  for (i = 0; i < 5U; i++) {
+    CHECK(usbhhidReadReport(hidp, report, sizeof(report), OSAL_MS2I(10)) == REPORT_SIZE);
+    CHECK(report[0] == 20U + i);
+  }
+  CHECK(usbhhidReadReport(hidp, report, sizeof(report), OSAL_MS2I(10)) == 0U);
+
+  /* The reports are read from the queue only.*/
+  CHECK(cb_calls == 0U);
+}
+
+static void queue_during_control(usbh_urb_t *urb) {
+
+  if (urb->ep->type != USBH_EPTYPE_CTRL)
+    return;
+  sim_submit_hook = NULL;
+  CHECK(queue_out(5) == HAL_SUCCESS);
+}
+
+static void test_out_order(void) {
+  static const uint8_t ids[] = {1, 2, 3, 4, 5};
+
+  /* Three reports wait on the NAKing interrupt OUT endpoint, a fifth one
+     is queued while the control transfer of the fourth is running.*/
+  log_n = 0;
+  out_naks = 10;
+  ctrl_naks = 3;
+  CHECK(queue_out(1) == HAL_SUCCESS);
+  CHECK(queue_out(2) == HAL_SUCCESS);
+  CHECK(queue_out(3) == HAL_SUCCESS);
+  sim_submit_hook = queue_during_control;
+  CHECK(set_report(USBHHID_REPORTTYPE_OUTPUT, 4) == USBH_URBSTATUS_OK);
+  CHECK(sim_submit_hook == NULL);
+  sim_run(5);
+  check_log("IIICI", ids);
+}
+
+static void test_feature_no_wait(void) {
+  static const uint8_t ids[] = {7, 6};
+
+  /* Feature reports don't go through the interrupt OUT endpoint.*/
+  log_n = 0;
+  out_naks = 10;
+  CHECK(queue_out(6) == HAL_SUCCESS);
+  CHECK(set_report(USBHHID_REPORTTYPE_FEATURE, 7) == USBH_URBSTATUS_OK);
+  sim_run(15);
+  check_log("CI", ids);
+}
+
+int main(void) {
+  static const usbh_endpoint_descriptor_t ep0_desc = {
+    .bLength          = USBH_DT_ENDPOINT_SIZE,
+    .bDescriptorType  = USBH_DT_ENDPOINT,
+    .bEndpointAddress = 0,
+    .bmAttributes     = USBH_EPTYPE_CTRL,
+    .wMaxPacketSize   = 64,
+    .bInterval        = 0
+  };
+  usbh_device_t *dev;
+
+  usbhInit();
+  usbhStart(&USBHD1);
+  dev = sim_device_setup(USBH_DEVSPEED_FULL);
+  usbhEPObjectInit(&dev->ctrl, dev, &ep0_desc);
+  usbhEPOpen(&dev->ctrl);
+  sim_transfer = device;
+
+  CHECK(_usbh_classdriver_load(dev, config, sizeof(config)) == HAL_SUCCESS);
+  hidp = &USBHHIDD[0];
+  CHECK(dev->drivers == (usbh_baseclassdriver_t *)hidp);
+  CHECK(usbhhidStart(hidp, &hidcfg) == HAL_SUCCESS);
+
+  test_in_queue();
+  test_out_order();
+  test_feature_no_wait();
+
+  usbhhidStop(hidp);
+  CHECK(usbhhidGetState(hidp) == USBHHID_STATE_ACTIVE);
+  printf("hid: report queue, overruns and output report order ok\n");
+  return 0;
+}
@@ -0,0 +1,264 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+ * HID report descriptor parser: a corpus of report descriptors of common
+ * devices is compiled into field tables, then reports are decoded with
+ * usbhhidGetFields(). Truncated reports, unknown report IDs and a short
+ * values buffer fail with the count of the values of the whole fields
+ * decoded before. Malformed descriptors and a full field table fail with an
+ * empty table.
+ */
+
+#include <string.h>
+
+#include "sim_usbh.h"
+#include "usbh/dev/hid.h"
+
+#define MAX_VALUES                          32U
+
+typedef struct {
+  uint8_t type;
+  uint8_t len;
+  uint8_t data[8];
+  bool ok;
+  uint16_t count;
+  int32_t values[MAX_VALUES];
+} report_t;
+
+typedef struct {
+  const char *name;
+  const uint8_t *desc;
+  uint16_t len;
+  bool ok;
+  uint16_t fields;
+  const report_t *reports;
+  unsigned reports_count;
+} corpus_t;
+
+#define IN                                  USBHHID_REPORTTYPE_INPUT
+#define OUT                                 USBHHID_REPORTTYPE_OUTPUT
+
+/* Boot keyboard: modifiers bitmap, reserved byte, LEDs, 6 key array.*/
+static const uint8_t keyboard[] = {
+  0x05, 0x01, 0x09, 0x06, 0xa1, 0x01, 0x05, 0x07, 0x19, 0xe0, 0x29, 0xe7,
+  0x15, 0x00, 0x25, 0x01, 0x75, 0x01, 0x95, 0x08, 0x81, 0x02, 0x95, 0x01,
+  0x75, 0x08, 0x81, 0x01, 0x95, 0x05, 0x75, 0x01, 0x05, 0x08, 0x19, 0x01,
+  0x29, 0x05, 0x91, 0x02, 0x95, 0x01, 0x75, 0x03, 0x91, 0x01, 0x95, 0x06,
+  0x75, 0x08, 0x15, 0x00, 0x25, 0x65, 0x05, 0x07, 0x19, 0x00, 0x29, 0x65,
+  0x81, 0x00, 0xc0
+};
+
+static const report_t keyboard_reports[] = {
+  {IN, 8, {0x02, 0x00, 0x04, 0x05, 0x00, 0x00, 0x00, 0x00}, true, 14,
+   {0, 1, 0, 0, 0, 0, 0, 0, 4, 5, 0, 0, 0, 0}},
+  {OUT, 1, {0x05}, true, 5, {1, 0, 1, 0, 0}},
+  /* The key array doesn't fit.*/
+  {IN, 5, {0x01, 0x00, 0x04, 0x00, 0x00}, false, 8,
+   {1, 0, 0, 0, 0, 0, 0, 0}},
+};
+
+/* Mouse: 3 buttons, padding, X, Y and wheel (not consecutive usages).*/
+static const uint8_t mouse[] = {
+  0x05, 0x01, 0x09, 0x02, 0xa1, 0x01, 0x09, 0x01, 0xa1, 0x00, 0x05, 0x09,
+  0x19, 0x01, 0x29, 0x03, 0x15, 0x00, 0x25, 0x01, 0x95, 0x03, 0x75, 0x01,
+  0x81, 0x02, 0x95, 0x01, 0x75, 0x05, 0x81, 0x01, 0x05, 0x01, 0x09, 0x30,
+  0x09, 0x31, 0x09, 0x38, 0x15, 0x81, 0x25, 0x7f, 0x75, 0x08, 0x95, 0x03,
+  0x81, 0x06, 0xc0, 0xc0
+};
+
+static const report_t mouse_reports[] = {
+  {IN, 4, {0x01, 0xfe, 0x05, 0xff}, true, 6, {1, 0, 0, -2, 5, -1}},
+  /* No output reports.*/
+  {OUT, 1, {0x00}, false, 0, {0}},
+};
+
+/* Mouse (ID 1) with 16 bit axes and consumer control (ID 2).*/
+static const uint8_t composite[] = {
+  0x05, 0x01, 0x09, 0x02, 0xa1, 0x01, 0x85, 0x01, 0x09, 0x01, 0xa1, 0x00,
+  0x05, 0x09, 0x19, 0x01, 0x29, 0x02, 0x15, 0x00, 0x25, 0x01, 0x95, 0x02,
+  0x75, 0x01, 0x81, 0x02, 0x95, 0x06, 0x81, 0x01, 0x05, 0x01, 0x09, 0x30,
+  0x09, 0x31, 0x16, 0x01, 0x80, 0x26, 0xff, 0x7f, 0x75, 0x10, 0x95, 0x02,
+  0x81, 0x06, 0xc0, 0xc0, 0x05, 0x0c, 0x09, 0x01, 0xa1, 0x01, 0x85, 0x02,
+  0x15, 0x00, 0x26, 0xff, 0x03, 0x19, 0x00, 0x2a, 0xff, 0x03, 0x75, 0x10,
+  0x95, 0x01, 0x81, 0x00, 0xc0
+};
+
+static const report_t composite_reports[] = {
+  {IN, 6, {0x01, 0x01, 0x10, 0x00, 0xf0, 0xff}, true, 4, {1, 0, 16, -16}},
+  {IN, 3, {0x02, 0xe9, 0x00}, true, 1, {0xe9}},
+  /* Unknown report ID.*/
+  {IN, 3, {0x03, 0xe9, 0x00}, false, 0, {0}},
+  /* Y doesn't fit.*/
+  {IN, 4, {0x01, 0x01, 0x10, 0x00}, false, 2, {1, 0}},
+};
+
+/* Gamepad: 16 buttons, hat switch with a null state, X Y Z and Rz.*/
+static const uint8_t gamepad[] = {
+  0x05, 0x01, 0x09, 0x05, 0xa1, 0x01, 0x15, 0x00, 0x25, 0x01, 0x35, 0x00,
+  0x45, 0x01, 0x75, 0x01, 0x95, 0x10, 0x05, 0x09, 0x19, 0x01, 0x29, 0x10,
+  0x81, 0x02, 0x25, 0x07, 0x46, 0x3b, 0x01, 0x75, 0x04, 0x95, 0x01, 0x65,
+  0x14, 0x05, 0x01, 0x09, 0x39, 0x81, 0x42, 0x65, 0x00, 0x95, 0x01, 0x81,
+  0x01, 0x26, 0xff, 0x00, 0x46, 0xff, 0x00, 0x09, 0x30, 0x09, 0x31, 0x09,
+  0x32, 0x09, 0x35, 0x75, 0x08, 0x95, 0x04, 0x81, 0x02, 0xc0
+};
+
+static const report_t gamepad_reports[] = {
+  {IN, 7, {0x01, 0x80, 0x08, 0x00, 0x80, 0xff, 0x7f}, true, 21,
+   {1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 8, 0, 128, 255, 127}},
+};
+
+/* A long item is skipped.*/
+static const uint8_t long_item[] = {
+  0xfe, 0x02, 0x10, 0xaa, 0xbb, 0x05, 0x01, 0x09, 0x30, 0x15, 0x00, 0x25,
+  0x7f, 0x75, 0x08, 0x95, 0x01, 0x81, 0x02
+};
+
+static const report_t long_item_reports[] = {
+  {IN, 1, {0x42}, true, 1, {0x42}},
+};
+
+/* Malformed: data cut short, POP without PUSH, too many PUSHes.*/
+static const uint8_t truncated[] = {
+  0x05, 0x01, 0x09, 0x06, 0xa1, 0x01, 0x75, 0x08, 0x95, 0x01, 0x81, 0x02,
+  0x26, 0xff
+};
+
+static const uint8_t pop[] = {
+  0x05, 0x01, 0x75, 0x08, 0x95, 0x01, 0x09, 0x30, 0x81, 0x02, 0xb4
+};
+
+static const uint8_t push[] = {
+  0x05, 0x01, 0xa4, 0xa4, 0xa4, 0x75, 0x08, 0x95, 0x01, 0x09, 0x30, 0x81, 0x02
+};
+
+static uint8_t many_fields[10 + 4 * (HAL_USBHHID_MAX_FIELDS + 1)];
+
+static const corpus_t corpus[] = {
+  {"keyboard", keyboard, sizeof(keyboard), true, 3,
+   keyboard_reports, sizeof(keyboard_reports) / sizeof(report_t)},
+  {"mouse", mouse, sizeof(mouse), true, 3,
+   mouse_reports, sizeof(mouse_reports) / sizeof(report_t)},
+  {"composite", composite, sizeof(composite), true, 3,
+   composite_reports, sizeof(composite_reports) / sizeof(report_t)},
+  {"gamepad", gamepad, sizeof(gamepad), true, 4,
+   gamepad_reports, sizeof(gamepad_reports) / sizeof(report_t)},
+  {"long item", long_item, sizeof(long_item), true, 1,
+   long_item_reports, sizeof(long_item_reports) / sizeof(report_t)},
+  {"truncated", truncated, sizeof(truncated), false, 0, NULL, 0},
+  {"pop", pop, sizeof(pop), false, 0, NULL, 0},
+  {"push", push, sizeof(push), false, 0, NULL, 0},
+  {"many fields", many_fields, sizeof(many_fields), false, 0, NULL, 0},
+};
+
+static USBHHIDDriver *const hidp = &USBHHIDD[0];
+
+static void setup_many_fields(void) {
+  static const uint8_t head[] = {
+    0x05, 0x01, 0x15, 0x00, 0x25, 0x01, 0x75, 0x01, 0x95, 0x01
+  };
+  unsigned i;
+
+  /* One field per usage, not consecutive.*/
+  memcpy(many_fields, head, sizeof(head));
+  for (i = 0; i <= HAL_USBHHID_MAX_FIELDS; i++) {
+    uint8_t *const item = &many_fields[sizeof(head) + 4U * i];
+    item[0] = 0x09;
+    item[1] = (uint8_t)(2U * i);
+    item[2] = 0x81;
+    item[3] = 0x02;
+  }
+}
+
+static void test_corpus(void) {
+  int32_t values[MAX_VALUES];
+  uint16_t count;
+  unsigned i, j, k;
+
+  for (i = 0; i < sizeof(corpus) / sizeof(corpus[0]); i++) {
+    const corpus_t *const c = &corpus[i];
+
+    CHECK(usbhhidParseReportDescriptor(hidp, c->desc, c->len) ==
+          (c->ok ? HAL_SUCCESS : HAL_FAILED));
+    CHECK(usbhhidGetFieldsCount(hidp) == c->fields);
+
+    for (j = 0; j < c->reports_count; j++) {
+      const report_t *const r = &c->reports[j];
+
+      memset(values, 0x55, sizeof(values));
+      CHECK(usbhhidGetFields(hidp, (usbhhid_reporttype_t)r->type, r->data,
+                             r->len, values, MAX_VALUES, &count) ==
+            (r->ok ? HAL_SUCCESS : HAL_FAILED));
+      CHECK(count == r->count);
+      for (k = 0; k < count; k++)
+        CHECK(values[k] == r->values[k]);
+    }
+  }
+}
+
+static void test_fields(void) {
+  static const uint8_t report[] = {0x01, 0x01, 0x10, 0x00, 0xf0, 0xff};
+  const usbhhid_field_t *f;
+  int32_t values[MAX_VALUES];
+  uint16_t count;
+  uint8_t index;
+
+  /* Keyboard: the modifiers bitmap is one field, keys are an array.*/
+  CHECK(usbhhidParseReportDescriptor(hidp, keyboard, sizeof(keyboard)) == HAL_SUCCESS);
+  f = usbhhidFindField(hidp, IN, 0x07, 0xe1, &index);
+  CHECK((f != NULL) && (index == 1U));
+  CHECK((f->bit_offset == 0U) && (f->bit_size == 1U) && (f->count == 8U));
+  CHECK((f->usage == 0xe0) && (f->usage_max == 0xe7));
+  f = usbhhidFindField(hidp, IN, 0x07, 0x04, &index);
+  CHECK((f != NULL) && (index == 0U));
+  CHECK(!(f->flags & USBHHID_FIELD_VARIABLE));
+  CHECK((f->bit_offset == 16U) && (f->bit_size == 8U) && (f->count == 6U));
+  f = usbhhidFindField(hidp, OUT, 0x08, 0x03, &index);
+  CHECK((f != NULL) && (index == 2U) && (f->bit_offset == 0U));
+
+  /* Gamepad: the hat switch has a null state.*/
+  CHECK(usbhhidParseReportDescriptor(hidp, gamepad, sizeof(gamepad)) == HAL_SUCCESS);
+  f = usbhhidFindField(hidp, IN, 0x01, 0x39, &index);
+  CHECK((f != NULL) && (f->flags & USBHHID_FIELD_NULLSTATE));
+  CHECK((f->logical_min == 0) && (f->logical_max == 7) && (f->bit_offset == 16U));
+  f = usbhhidFindField(hidp, IN, 0x01, 0x35, &index);
+  CHECK((f != NULL) && (f->logical_max == 255) && (f->bit_offset == 48U));
+
+  /* Composite: fields after the report ID, signed 16 bit axes.*/
+  CHECK(usbhhidParseReportDescriptor(hidp, composite, sizeof(composite)) == HAL_SUCCESS);
+  f = usbhhidFindField(hidp, IN, 0x01, 0x31, &index);
+  CHECK((f != NULL) && (f->report_id == 1U) && (f->bit_offset == 16U));
+  CHECK((f->logical_min == -32767) && (f->logical_max == 32767));
+
+  /* A values buffer too short for a field.*/
+  CHECK(usbhhidGetFields(hidp, IN, report, sizeof(report), values, 3, &count) == HAL_FAILED);
+  CHECK(count == 2U);
+  CHECK(usbhhidGetFields(hidp, IN, report, sizeof(report), values, 4, &count) == HAL_SUCCESS);
+  CHECK(count == 4U);
+}
+
+int main(void) {
+
+  usbhInit();
+  setup_many_fields();
+
+  test_corpus();
+  test_fields();
+
+  printf("hidparse: %u report descriptors, fields and report decoding ok\n",
+         (unsigned)(sizeof(corpus) / sizeof(corpus[0])));
+  return 0;
+}
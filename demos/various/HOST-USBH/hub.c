@@ -0,0 +1,407 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+ * Hub port de-bounce: a hub is enumerated on the root port, then devices
+ * are plugged on all its ports at once. The ports de-bounce concurrently,
+ * on their own timers, while the resets and the enumerations are done one
+ * port at a time: the bus model fails the test if two devices answer at
+ * the same address. A connection bounce restarts the de-bounce of its
+ * port only.
+ */
+
+#include <string.h>
+
+#include "sim_usbh.h"
+#include "usbh/dev/hub.h"
+
+#define PORTS                               4U
+#define POLL_MS                             10U
+#define RESET_FRAMES                        10U
+#define DEBOUNCE                            HAL_USBH_PORT_DEBOUNCE_TIME
+
+#define REQ(type, req)                      (((type) << 8) | (req))
+#define STD_IN                              USBH_REQTYPE_DIR_IN
+#define STD_OUT                             USBH_REQTYPE_DIR_OUT
+#define HUB_IN                              (USBH_REQTYPE_DIR_IN | USBH_REQTYPE_TYPE_CLASS)
+#define HUB_OUT                             (USBH_REQTYPE_DIR_OUT | USBH_REQTYPE_TYPE_CLASS)
+#define PORT_IN                             (HUB_IN | USBH_REQTYPE_RECIP_OTHER)
+#define PORT_OUT                            (HUB_OUT | USBH_REQTYPE_RECIP_OTHER)
+
+/* Device model: descriptors and the state the host can change.*/
+typedef struct {
+  const uint8_t         *devdesc;
+  const uint8_t         *cfgdesc;
+  uint16_t              cfglen;
+  uint8_t               address;
+  uint8_t               config;
+} sim_dev_t;
+
+/* Downstream port of the hub model.*/
+typedef struct {
+  uint16_t              status;
+  uint16_t              c_status;
+  unsigned              reset_left;         /* Frames to the end of reset.*/
+  systime_t             reset_at;           /* Start of the first reset.*/
+  unsigned              resets;
+  sim_dev_t             dev;
+} sim_port_t;
+
+static const uint8_t hub_devdesc[USBH_DT_DEVICE_SIZE] = {
+  USBH_DT_DEVICE_SIZE, USBH_DT_DEVICE, 0x00, 0x02, 0x09, 0x00, 0x00, 64,
+  0x34, 0x12, 0x01, 0x00, 0x00, 0x01, 0, 0, 0, 1
+};
+
+static const uint8_t hub_cfgdesc[] = {
+  USBH_DT_CONFIG_SIZE, USBH_DT_CONFIG, 25, 0, 1, 1, 0, 0xe0, 0,
+  USBH_DT_INTERFACE_SIZE, USBH_DT_INTERFACE, 0, 0, 1, 0x09, 0x00, 0x00, 0,
+  USBH_DT_ENDPOINT_SIZE, USBH_DT_ENDPOINT, 0x81, USBH_EPTYPE_INT, 1, 0, 255
+};
+
+static const uint8_t hub_desc[] = {
+  9, USBH_DT_HUB, PORTS, 0x00, 0x00, 0, 0, 0x00, 0xff
+};
+
+static const uint8_t fn_devdesc[USBH_DT_DEVICE_SIZE] = {
+  USBH_DT_DEVICE_SIZE, USBH_DT_DEVICE, 0x00, 0x02, 0x00, 0x00, 0x00, 64,
+  0x34, 0x12, 0x02, 0x00, 0x00, 0x01, 0, 0, 0, 1
+};
+
+static const uint8_t fn_cfgdesc[] = {
+  USBH_DT_CONFIG_SIZE, USBH_DT_CONFIG, 18, 0, 1, 1, 0, 0x80, 50,
+  USBH_DT_INTERFACE_SIZE, USBH_DT_INTERFACE, 0, 0, 0, 0xff, 0x00, 0x00, 0
+};
+
+static sim_dev_t hub = {hub_devdesc, hub_cfgdesc, sizeof(hub_cfgdesc), 0, 0};
+static sim_port_t ports[PORTS];
+
+/*===========================================================================*/
+/* Bus model.                                                                */
+/*===========================================================================*/
+
+static bool hub_reachable(void) {
+
+  return (USBHD1.rootport.lld_status & USBH_PORTSTATUS_ENABLE) != 0U;
+}
+
+static bool port_reachable(const sim_port_t *p) {
+
+  return hub_reachable() && (hub.config != 0U) &&
+         ((p->status & USBH_PORTSTATUS_ENABLE) != 0U);
+}
+
+/* The device answering at an address, two of them is a clash.*/
+static sim_dev_t *route(uint8_t address) {
+  sim_dev_t *dev = NULL;
+  unsigned i, n = 0;
+
+  if (hub_reachable() && (hub.address == address)) {
+    dev = &hub;
+    n++;
+  }
+  for (i = 0; i < PORTS; i++) {
+    if (port_reachable(&ports[i]) && (ports[i].dev.address == address)) {
+      dev = &ports[i].dev;
+      n++;
+    }
+  }
+  CHECK(n <= 1U);
+  return dev;
+}
+
+static usbh_urbstatus_t answer(usbh_urb_t *urb, const void *data, uint32_t len) {
+
+  sim_urb_in(urb, data, len);
+  return USBH_URBSTATUS_OK;
+}
+
+static usbh_urbstatus_t hub_request(usbh_urb_t *urb, const usbh_control_request_t *req) {
+  sim_port_t *p = NULL;
+  uint8_t stat[4];
+
+  if ((req->bmRequestType & USBH_REQTYPE_RECIP_OTHER) != 0U) {
+    if ((req->wIndex < 1U) || (req->wIndex > PORTS))
+      return USBH_URBSTATUS_STALL;
+    p = &ports[req->wIndex - 1U];
+  }
+
+  switch (REQ(req->bmRequestType, req->bRequest)) {
+  case REQ(HUB_IN, USBH_REQ_GET_DESCRIPTOR):
+    return answer(urb, hub_desc, sizeof(hub_desc));
+  case REQ(HUB_IN, USBH_REQ_GET_STATUS):
+    memset(stat, 0, sizeof(stat));
+    return answer(urb, stat, sizeof(stat));
+  case REQ(PORT_IN, USBH_REQ_GET_STATUS):
+    stat[0] = (uint8_t)p->status;
+    stat[1] = (uint8_t)(p->status >> 8);
+    stat[2] = (uint8_t)p->c_status;
+    stat[3] = (uint8_t)(p->c_status >> 8);
+    return answer(urb, stat, sizeof(stat));
+  case REQ(PORT_OUT, USBH_REQ_SET_FEATURE):
+    if (req->wValue == USBH_PORT_FEAT_POWER) {
+      p->status |= USBH_PORTSTATUS_POWER;
+    } else if (req->wValue == USBH_PORT_FEAT_RESET) {
+      unsigned i;
+
+      /* Resets are serialized: no other port is resetting or has a
+         device left at the default address.*/
+      for (i = 0; i < PORTS; i++) {
+        const sim_port_t *const q = &ports[i];
+        if (q == p)
+          continue;
+        CHECK(q->reset_left == 0U);
+        CHECK(!port_reachable(q) || (q->dev.address != 0U));
+      }
+      if (p->resets++ == 0U)
+        p->reset_at = sim_now;
+      p->status |= USBH_PORTSTATUS_RESET;
+      p->status &= ~USBH_PORTSTATUS_ENABLE;
+      p->reset_left = RESET_FRAMES;
+    }
+    return USBH_URBSTATUS_OK;
+  case REQ(PORT_OUT, USBH_REQ_CLEAR_FEATURE):
+    if (req->wValue >= USBH_PORT_FEAT_C_CONNECTION)
+      p->c_status &= ~(1U << (req->wValue - USBH_PORT_FEAT_C_CONNECTION));
+    else if (req->wValue == USBH_PORT_FEAT_ENABLE)
+      p->status &= ~USBH_PORTSTATUS_ENABLE;
+    return USBH_URBSTATUS_OK;
+  default:
+    return USBH_URBSTATUS_STALL;
+  }
+}
+
+static usbh_urbstatus_t std_request(usbh_urb_t *urb, sim_dev_t *dev,
+                                    const usbh_control_request_t *req) {
+
+  switch (REQ(req->bmRequestType, req->bRequest)) {
+  case REQ(STD_IN, USBH_REQ_GET_DESCRIPTOR):
+    if ((req->wValue >> 8) == USBH_DT_DEVICE)
+      return answer(urb, dev->devdesc, USBH_DT_DEVICE_SIZE);
+    if ((req->wValue >> 8) == USBH_DT_CONFIG)
+      return answer(urb, dev->cfgdesc, dev->cfglen);
+    return USBH_URBSTATUS_STALL;
+  case REQ(STD_OUT, USBH_REQ_SET_ADDRESS):
+    dev->address = (uint8_t)req->wValue;
+    return USBH_URBSTATUS_OK;
+  case REQ(STD_OUT, USBH_REQ_SET_CONFIGURATION):
+    dev->config = (uint8_t)req->wValue;
+    return USBH_URBSTATUS_OK;
+  default:
+    return USBH_URBSTATUS_STALL;
+  }
+}
+
+static usbh_urbstatus_t bus(usbh_urb_t *urb) {
+  sim_dev_t *const dev = route(urb->ep->device->address);
+
+  CHECK(dev != NULL);
+  if (urb->ep->type == USBH_EPTYPE_CTRL) {
+    const usbh_control_request_t *const req = urb->setup_buff;
+    if ((req->bmRequestType & USBH_REQTYPE_TYPE_CLASS) != 0U) {
+      CHECK(dev == &hub);
+      return hub_request(urb, req);
+    }
+    return std_request(urb, dev, req);
+  }
+
+  /* Status change endpoint of the hub, NAKs while nothing changed.*/
+  {
+    uint8_t bitmap = 0;
+    unsigned i;
+
+    CHECK(dev == &hub);
+    for (i = 0; i < PORTS; i++) {
+      if (ports[i].c_status != 0U)
+        bitmap |= (uint8_t)(1U << (i + 1U));
+    }
+    if (bitmap == 0U)
+      return USBH_URBSTATUS_PENDING;
+    return answer(urb, &bitmap, 1);
+  }
+}
+
+/* Ends the port resets, once per frame.*/
+static void hub_frame(void) {
+  unsigned i;
+
+  for (i = 0; i < PORTS; i++) {
+    sim_port_t *const p = &ports[i];
+    if ((p->reset_left == 0U) || (--p->reset_left != 0U))
+      continue;
+    p->status &= ~USBH_PORTSTATUS_RESET;
+    p->c_status |= USBH_PORTSTATUS_C_RESET;
+    if (p->status & USBH_PORTSTATUS_CONNECTION) {
+      p->status |= USBH_PORTSTATUS_ENABLE;
+      p->dev.address = 0;
+      p->dev.config = 0;
+    }
+  }
+}
+
+static void plug(unsigned i) {
+  sim_port_t *const p = &ports[i];
+
+  osalSysLock();
+  p->status |= USBH_PORTSTATUS_CONNECTION;
+  p->c_status |= USBH_PORTSTATUS_C_CONNECTION;
+  p->dev.address = 0;
+  p->dev.config = 0;
+  osalSysUnlock();
+}
+
+static void unplug(unsigned i) {
+  sim_port_t *const p = &ports[i];
+
+  osalSysLock();
+  p->status &= ~(USBH_PORTSTATUS_CONNECTION | USBH_PORTSTATUS_ENABLE);
+  p->c_status |= USBH_PORTSTATUS_C_CONNECTION;
+  osalSysUnlock();
+}
+
+/*===========================================================================*/
+/* Host.                                                                     */
+/*===========================================================================*/
+
+static usbh_port_t *host_port(unsigned i) {
+  USBHHubDriver *const hubp = list_first_entry(&USBHD1.hubs, USBHHubDriver, node);
+  usbh_port_t *port = hubp->ports;
+
+  while (port->number != i + 1U)
+    port = port->next;
+  return port;
+}
+
+/* Runs usbhMainLoop every POLL_MS, like an application thread would.*/
+static void run_until(systime_t t) {
+
+  while ((systime_t)(t - sim_now) < 0x80000000U) {
+    usbhMainLoop(&USBHD1);
+    osalThreadSleepMilliseconds(POLL_MS);
+  }
+}
+
+static bool configured(unsigned i) {
+
+  return host_port(i)->device.status == USBH_DEVSTATUS_CONFIGURED;
+}
+
+static void test_hub_enumeration(void) {
+
+  sim_root_connect(USBH_DEVSPEED_FULL);
+  run_until(sim_now + 2U * DEBOUNCE + 500U);
+  CHECK(!list_empty(&USBHD1.hubs));
+  CHECK(hub.config == 1U);
+}
+
+static void test_concurrent_debounce(void) {
+  systime_t t0, end = 0, last = 0;
+  unsigned i;
+
+  /* The timers de-bounce all the ports without the main loop.*/
+  t0 = sim_now;
+  for (i = 0; i < PORTS; i++)
+    plug(i);
+  sim_run(1);
+  usbhMainLoop(&USBHD1);
+  for (i = 0; i < PORTS; i++) {
+    const usbh_port_t *const port = host_port(i);
+    CHECK(port->device.status == USBH_DEVSTATUS_ATTACHED);
+    CHECK(port->attachTime - t0 <= POLL_MS);
+    if (port->attachTime + DEBOUNCE > end)
+      end = port->attachTime + DEBOUNCE;
+  }
+  while (sim_now != end) {
+    sim_run(1);
+    for (i = 0; i < PORTS; i++) {
+      const usbh_port_t *const port = host_port(i);
+      CHECK(port->debounced == (sim_now - port->attachTime >= DEBOUNCE));
+    }
+  }
+
+  run_until(t0 + 4U * DEBOUNCE);
+  for (i = 0; i < PORTS; i++) {
+    CHECK(configured(i));
+    CHECK(ports[i].resets == 1U);
+    CHECK(ports[i].dev.address != 0U);
+    if (ports[i].reset_at > last)
+      last = ports[i].reset_at;
+  }
+
+  /* The first reset follows the de-bounce, the others only wait for the
+     enumeration of the previous ports.*/
+  CHECK(ports[0].reset_at - t0 >= DEBOUNCE);
+  CHECK(ports[0].reset_at - t0 <= DEBOUNCE + 2U * POLL_MS);
+  for (i = 1; i < PORTS; i++)
+    CHECK(ports[i].reset_at - ports[i - 1U].reset_at < DEBOUNCE);
+  printf("hub: %u ports de-bounced in %u ms, last reset after %u ms "
+         "(%u ms with serial de-bounce)\n",
+         PORTS, DEBOUNCE, (unsigned)(last - t0),
+         (unsigned)(last - t0) + (PORTS - 1U) * DEBOUNCE);
+}
+
+static void test_bounce(void) {
+  unsigned i;
+  systime_t t1;
+
+  /* Port 2 is unplugged and plugged back with a bounce 50ms later: its
+     de-bounce restarts from the last connection.*/
+  unplug(1);
+  run_until(sim_now + POLL_MS * 3U);
+  CHECK(host_port(1)->device.status == USBH_DEVSTATUS_DISCONNECTED);
+  ports[1].resets = 0;
+
+  plug(1);
+  run_until(sim_now + 50U);
+  CHECK(host_port(1)->device.status == USBH_DEVSTATUS_ATTACHED);
+  unplug(1);
+  run_until(sim_now + 50U);
+  CHECK(host_port(1)->device.status == USBH_DEVSTATUS_DISCONNECTED);
+  t1 = sim_now;
+  plug(1);
+  run_until(t1 + DEBOUNCE - POLL_MS);
+  CHECK(!host_port(1)->debounced);
+  CHECK(ports[1].resets == 0U);
+  run_until(t1 + 2U * DEBOUNCE);
+  CHECK(configured(1));
+  CHECK(ports[1].resets == 1U);
+  CHECK(ports[1].reset_at - t1 >= DEBOUNCE);
+  CHECK(ports[1].reset_at - t1 <= DEBOUNCE + 2U * POLL_MS);
+
+  /* The other ports were left alone.*/
+  for (i = 0; i < PORTS; i++)
+    CHECK(configured(i));
+}
+
+int main(void) {
+  unsigned i;
+
+  for (i = 0; i < PORTS; i++) {
+    ports[i].dev.devdesc = fn_devdesc;
+    ports[i].dev.cfgdesc = fn_cfgdesc;
+    ports[i].dev.cfglen = sizeof(fn_cfgdesc);
+  }
+
+  usbhInit();
+  usbhStart(&USBHD1);
+  sim_transfer = bus;
+  sim_frame_hook = hub_frame;
+
+  test_hub_enumeration();
+  test_concurrent_debounce();
+  test_bounce();
+  printf("hub: concurrent de-bounce, serialized resets and bounce ok\n");
+  return 0;
+}
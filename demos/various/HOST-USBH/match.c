@@ -0,0 +1,428 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+ * Class driver matching: with about 80 registered drivers, a corpus of
+ * device, interface and IAD descriptors is offered through the match index.
+ * Each descriptor must reach the same drivers, in the same order, as a
+ * linear walk of the match tables in order of precedence, with the parsed
+ * descriptor and the selecting table entry passed to load(). Also reports
+ * the cost of both per descriptor.
+ */
+
+#include <string.h>
+#include <time.h>
+
+#include "sim_usbh.h"
+
+#define VENDOR_DRIVERS                      40U
+#define CLASS_DRIVERS                       24U
+#define IAD_DRIVERS                         8U
+#define DEVICE_DRIVERS                      5U
+#define DRIVERS                             (VENDOR_DRIVERS + CLASS_DRIVERS + \
+                                             IAD_DRIVERS + DEVICE_DRIVERS + 1U)
+#define MAX_IDS                             4U
+
+#define CORPUS_DEVICES                      64U
+#define DESCS_PER_DEVICE                    8U
+#define LOG_SIZE                            8U
+#define BENCH_ROUNDS                        2000U
+
+typedef struct {
+  usbh_classdriverinfo_t info;
+  usbh_classdriver_node_t node;
+  usbh_classdriver_id_t ids[MAX_IDS];
+  usbh_baseclassdriver_t obj;
+} driver_t;
+
+typedef struct {
+  usbh_device_descriptor_t dev;
+  uint8_t desc[DESCS_PER_DEVICE][USBH_DT_DEVICE_SIZE];
+} corpus_t;
+
+static driver_t drivers[DRIVERS];
+static driver_t late;
+static corpus_t corpus[CORPUS_DEVICES];
+static usbh_device_t device;
+
+/* Drivers offered the descriptor, in order.*/
+static const driver_t *log_drv[LOG_SIZE];
+static unsigned log_n;
+static const uint8_t *offered;
+static const driver_t *accept;
+static unsigned long loads;
+
+static const driver_t *driver_of(const usbh_classdriver_id_t *id) {
+  unsigned i;
+
+  if ((id >= late.ids) && (id < &late.ids[MAX_IDS]))
+    return &late;
+  for (i = 0; i < DRIVERS; i++) {
+    if ((id >= drivers[i].ids) && (id < &drivers[i].ids[MAX_IDS]))
+      return &drivers[i];
+  }
+  return NULL;
+}
+
+static void get_class(const uint8_t *desc, uint8_t *cls, uint8_t *sub,
+                      uint8_t *proto);
+static bool ref_match(const driver_t *d, const usbh_device_t *dev,
+                      const uint8_t *desc, const usbh_classdriver_id_t **idp);
+
+static usbh_baseclassdriver_t *load(usbh_device_t *dev,
+                                    const uint8_t *descriptor, uint16_t rem,
+                                    const usbh_classdriver_match_t *match) {
+  const driver_t *d = driver_of(match->id);
+  const usbh_classdriver_id_t *id;
+  uint8_t cls, sub, proto;
+
+  loads++;
+  if (offered != NULL) {
+    /* The parse result and the selecting entry are the expected ones.*/
+    CHECK(descriptor == offered);
+    CHECK(d != NULL);
+    CHECK(ref_match(d, dev, descriptor, &id));
+    CHECK(match->id == id);
+    get_class(descriptor, &cls, &sub, &proto);
+    CHECK(match->bDescriptorType == descriptor[1]);
+    CHECK((match->bClass == cls) && (match->bSubClass == sub)
+          && (match->bProtocol == proto));
+    CHECK(log_n < LOG_SIZE);
+    log_drv[log_n++] = d;
+  }
+  return (d == accept) ? (usbh_baseclassdriver_t *)&d->obj : NULL;
+}
+
+static usbh_baseclassdriver_t *load_any(usbh_device_t *dev,
+                                        const uint8_t *descriptor, uint16_t rem,
+                                        const usbh_classdriver_match_t *match) {
+  const driver_t *d = &drivers[DRIVERS - 1U];
+
+  loads++;
+  if (offered != NULL) {
+    CHECK(descriptor == offered);
+    CHECK(match->id == NULL);
+    CHECK(match->bDescriptorType == descriptor[1]);
+    CHECK(log_n < LOG_SIZE);
+    log_drv[log_n++] = d;
+  }
+  return (d == accept) ? (usbh_baseclassdriver_t *)&d->obj : NULL;
+}
+
+static const usbh_classdriver_vmt_t vmt = {NULL, load, NULL};
+static const usbh_classdriver_vmt_t vmt_any = {NULL, load_any, NULL};
+
+static void get_class(const uint8_t *desc, uint8_t *cls, uint8_t *sub,
+                      uint8_t *proto) {
+  const unsigned ofs = (desc[1] == USBH_DT_INTERFACE) ? 5U : 4U;
+
+  *cls = desc[ofs];
+  *sub = desc[ofs + 1U];
+  *proto = desc[ofs + 2U];
+}
+
+/* The linear walk: first matching entry of the table.*/
+static bool ref_match(const driver_t *d, const usbh_device_t *dev,
+                      const uint8_t *desc, const usbh_classdriver_id_t **idp) {
+  uint8_t cls, sub, proto;
+  unsigned i;
+
+  if (d->info.ids == NULL) {
+    *idp = NULL;
+    return true;
+  }
+  get_class(desc, &cls, &sub, &proto);
+  for (i = 0; i < d->info.ids_count; i++) {
+    const usbh_classdriver_id_t *const id = &d->info.ids[i];
+    if ((id->bDescriptorType != desc[1])
+        || ((id->match & USBH_MATCH_VENDOR) && (id->idVendor != dev->devDesc.idVendor))
+        || ((id->match & USBH_MATCH_PRODUCT) && (id->idProduct != dev->devDesc.idProduct))
+        || ((id->match & USBH_MATCH_CLASS) && (id->bClass != cls))
+        || ((id->match & USBH_MATCH_SUBCLASS) && (id->bSubClass != sub))
+        || ((id->match & USBH_MATCH_PROTOCOL) && (id->bProtocol != proto)))
+      continue;
+    *idp = id;
+    return true;
+  }
+  return false;
+}
+
+/* Registered drivers, the last registered first.*/
+static unsigned ref_offer(const uint8_t *desc, const driver_t **out) {
+  usbh_classdriver_match_t match;
+  unsigned n = 0;
+  unsigned i;
+
+  match.bDescriptorType = desc[1];
+  get_class(desc, &match.bClass, &match.bSubClass, &match.bProtocol);
+  for (i = DRIVERS; i-- > 0U;) {
+    const driver_t *const d = &drivers[i];
+    if (!ref_match(d, &device, desc, &match.id))
+      continue;
+    if (out != NULL)
+      out[n] = d;
+    n++;
+    if (d->info.vmt->load(&device, desc, desc[0], &match) != NULL)
+      break;
+  }
+  return n;
+}
+
+static void add_driver(driver_t *d, const char *name,
+                       const usbh_classdriver_vmt_t *v, unsigned ids) {
+
+  d->info.name = name;
+  d->info.vmt = v;
+  d->info.ids = (ids > 0U) ? d->ids : NULL;
+  d->info.ids_count = (uint8_t)ids;
+  d->obj.info = &d->info;
+  usbhClassDriverRegister(&d->node, &d->info);
+}
+
+static void setup_drivers(void) {
+  static const usbh_classdriver_id_t aoa_like =
+    {USBH_MATCH_CLASS, USBH_DT_DEVICE, 0, 0, 0x00, 0, 0};
+  driver_t *d = drivers;
+  unsigned i, j;
+
+  /* FTDI like: vendor interfaces of a few products.*/
+  for (i = 0; i < VENDOR_DRIVERS; i++, d++) {
+    for (j = 0; j < MAX_IDS; j++) {
+      const usbh_classdriver_id_t id = {
+        USBH_MATCH_VENDOR | USBH_MATCH_PRODUCT | USBH_MATCH_CLASS
+          | USBH_MATCH_SUBCLASS | USBH_MATCH_PROTOCOL,
+        USBH_DT_INTERFACE, (uint16_t)(0x1000U + i), (uint16_t)(0x6000U + j),
+        0xff, 0xff, 0xff
+      };
+      d->ids[j] = id;
+    }
+    add_driver(d, "VENDOR", &vmt, MAX_IDS);
+  }
+
+  /* Interface classes, two drivers per class.*/
+  for (i = 0; i < CLASS_DRIVERS; i++, d++) {
+    const usbh_classdriver_id_t id =
+      USBH_CLASSDRIVER_ID_CLASS(USBH_DT_INTERFACE, 0x10U + i / 2U, i % 2U, 0);
+    d->ids[0] = id;
+    add_driver(d, "CLASS", &vmt, 1);
+  }
+
+  for (i = 0; i < IAD_DRIVERS; i++, d++) {
+    const usbh_classdriver_id_t id =
+      USBH_CLASSDRIVER_ID_CLASS(USBH_DT_INTERFACE_ASSOCIATION, 0x20U + i, 0, 0);
+    d->ids[0] = id;
+    add_driver(d, "IAD", &vmt, 1);
+  }
+
+  /* Device classes, and a composite device prober (like AOA).*/
+  for (i = 0; i < DEVICE_DRIVERS - 1U; i++, d++) {
+    const usbh_classdriver_id_t id =
+      USBH_CLASSDRIVER_ID_CLASS(USBH_DT_DEVICE, 0x30U + i, 0, 0);
+    d->ids[0] = id;
+    add_driver(d, "DEVICE", &vmt, 1);
+  }
+  d->ids[0] = aoa_like;
+  add_driver(d++, "COMPOSITE", &vmt, 1);
+
+  /* No match table: offered everything.*/
+  add_driver(d, "ANY", &vmt_any, 0);
+}
+
+static uint32_t rnd_state = 0x12345678U;
+
+static uint32_t rnd(uint32_t n) {
+
+  rnd_state = rnd_state * 1103515245U + 12345U;
+  return (rnd_state >> 8) % n;
+}
+
+static void setup_corpus(void) {
+  unsigned i, j;
+
+  for (i = 0; i < CORPUS_DEVICES; i++) {
+    corpus_t *const c = &corpus[i];
+    uint8_t *desc = c->desc[0];
+
+    /* Half of the devices are from the vendors with a driver.*/
+    c->dev.bLength = USBH_DT_DEVICE_SIZE;
+    c->dev.bDescriptorType = USBH_DT_DEVICE;
+    c->dev.idVendor = (uint16_t)((i % 2U) ? 0x1000U + rnd(VENDOR_DRIVERS) : 0x2000U + i);
+    c->dev.idProduct = (uint16_t)(0x6000U + rnd(MAX_IDS + 1U));
+    c->dev.bDeviceClass = (uint8_t)((i % 3U) ? 0x00 : 0x30U + rnd(DEVICE_DRIVERS));
+    memcpy(desc, &c->dev, USBH_DT_DEVICE_SIZE);
+
+    for (j = 1; j < DESCS_PER_DEVICE; j++) {
+      desc = c->desc[j];
+      if (j == 1U) {
+        desc[0] = USBH_DT_INTERFACE_ASSOCIATION_SIZE;
+        desc[1] = USBH_DT_INTERFACE_ASSOCIATION;
+        desc[2] = 0;
+        desc[3] = 2;
+        desc[4] = (uint8_t)(0x20U + rnd(IAD_DRIVERS + 2U));
+        desc[5] = 0;
+        desc[6] = 0;
+        desc[7] = 0;
+        continue;
+      }
+      desc[0] = USBH_DT_INTERFACE_SIZE;
+      desc[1] = USBH_DT_INTERFACE;
+      desc[2] = (uint8_t)j;
+      desc[3] = 0;
+      /* No endpoints: the built-in HID driver declines.*/
+      desc[4] = 0;
+      switch (rnd(4)) {
+      case 0:
+        desc[5] = 0xff;
+        desc[6] = 0xff;
+        desc[7] = 0xff;
+        break;
+      case 1:
+        desc[5] = 0x03;
+        desc[6] = 0;
+        desc[7] = 0;
+        break;
+      default:
+        desc[5] = (uint8_t)(0x10U + rnd(CLASS_DRIVERS / 2U + 2U));
+        desc[6] = (uint8_t)rnd(3);
+        desc[7] = 0;
+        break;
+      }
+      desc[8] = 0;
+    }
+  }
+}
+
+static void set_device(const corpus_t *c) {
+
+  memcpy(&device.devDesc, &c->dev, sizeof(device.devDesc));
+}
+
+static void test_same_drivers(void) {
+  const driver_t *expected[LOG_SIZE];
+  unsigned i, j, k, n;
+  unsigned long offers = 0;
+
+  for (i = 0; i < CORPUS_DEVICES; i++) {
+    set_device(&corpus[i]);
+    for (j = 0; j < DESCS_PER_DEVICE; j++) {
+      const uint8_t *const desc = corpus[i].desc[j];
+
+      n = ref_offer(desc, expected);
+      CHECK(n <= LOG_SIZE);
+      log_n = 0;
+      offered = desc;
+      CHECK(_usbh_classdriver_load(&device, desc, desc[0]) == HAL_FAILED);
+      offered = NULL;
+      CHECK(log_n == n);
+      for (k = 0; k < n; k++)
+        CHECK(log_drv[k] == expected[k]);
+      offers += n;
+    }
+  }
+  /* The corpus hits more than the table-less driver.*/
+  CHECK(offers > CORPUS_DEVICES * DESCS_PER_DEVICE);
+}
+
+static void test_precedence(void) {
+  const uint8_t *const desc = corpus[0].desc[2];
+  unsigned k;
+
+  /* A driver registered last is offered the descriptor first, the ones
+     after an accepting driver are not.*/
+  set_device(&corpus[0]);
+  late.ids[0] = (usbh_classdriver_id_t)
+    USBH_CLASSDRIVER_ID_CLASS(USBH_DT_INTERFACE, desc[5], desc[6], desc[7]);
+  add_driver(&late, "LATE", &vmt, 1);
+  log_n = 0;
+  offered = desc;
+  accept = &late;
+  device.drivers = NULL;
+  CHECK(_usbh_classdriver_load(&device, desc, desc[0]) == HAL_SUCCESS);
+  CHECK(log_n == 1U);
+  CHECK(log_drv[0] == &late);
+  CHECK(device.drivers == &late.obj);
+  CHECK(late.obj.dev == &device);
+
+  /* Once unregistered it is not offered anything.*/
+  usbhClassDriverUnregister(&late.node);
+  log_n = 0;
+  CHECK(_usbh_classdriver_load(&device, desc, desc[0]) == HAL_FAILED);
+  for (k = 0; k < log_n; k++)
+    CHECK(log_drv[k] != &late);
+  offered = NULL;
+  accept = NULL;
+  device.drivers = NULL;
+}
+
+static double now_ns(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static void bench(void) {
+  const unsigned long total = (unsigned long)BENCH_ROUNDS * CORPUS_DEVICES * DESCS_PER_DEVICE;
+  unsigned long index_loads, linear_loads;
+  double t0, t_index, t_linear;
+  unsigned r, i, j;
+
+  loads = 0;
+  t0 = now_ns();
+  for (r = 0; r < BENCH_ROUNDS; r++) {
+    for (i = 0; i < CORPUS_DEVICES; i++) {
+      set_device(&corpus[i]);
+      for (j = 0; j < DESCS_PER_DEVICE; j++)
+        (void)_usbh_classdriver_load(&device, corpus[i].desc[j], corpus[i].desc[j][0]);
+    }
+  }
+  t_index = now_ns() - t0;
+  index_loads = loads;
+
+  loads = 0;
+  t0 = now_ns();
+  for (r = 0; r < BENCH_ROUNDS; r++) {
+    for (i = 0; i < CORPUS_DEVICES; i++) {
+      set_device(&corpus[i]);
+      for (j = 0; j < DESCS_PER_DEVICE; j++)
+        (void)ref_offer(corpus[i].desc[j], NULL);
+    }
+  }
+  t_linear = now_ns() - t0;
+  linear_loads = loads;
+
+  /* The built-in HID driver is not counted by the linear walk.*/
+  CHECK(index_loads == linear_loads);
+  printf("match: %u drivers, %.1f loads/descriptor, "
+         "index %.0f ns/descriptor, linear walk %.0f ns/descriptor\n",
+         DRIVERS, (double)index_loads / (double)total,
+         t_index / (double)total, t_linear / (double)total);
+  CHECK(t_index < t_linear);
+}
+
+int main(void) {
+
+  usbhInit();
+  setup_drivers();
+  setup_corpus();
+
+  test_same_drivers();
+  test_precedence();
+  bench();
+
+  printf("match: same drivers and order as the linear walk, precedence ok\n");
+  return 0;
+}
@@ -0,0 +1,242 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/*
+ * OSAL and kernel subset used by the USB host stack, on a discrete event
+ * simulation. There is one application thread, blocking calls run the
+ * simulated bus and the virtual timers one frame (1ms) at a time until
+ * the thread is woken or its timeout expires.
+ */
+
+#ifndef OSAL_H
+#define OSAL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define TRUE                                1
+#define __PACKED_STRUCT                     struct __attribute__((packed))
+#define __REV(x)                            __builtin_bswap32(x)
+#define FALSE                               0
+
+#define HAL_SUCCESS                         false
+#define HAL_FAILED                          true
+
+#define CH_KERNEL_VERSION                   "sim"
+
+#define OSAL_ST_FREQUENCY                   1000
+#define OSAL_MS2I(ms)                       ((sysinterval_t)(ms))
+#define TIME_MS2I(ms)                       OSAL_MS2I(ms)
+#define TIME_IMMEDIATE                      ((sysinterval_t)0)
+#define TIME_INFINITE                       ((sysinterval_t)-1)
+
+#define MSG_OK                              0
+#define MSG_TIMEOUT                         -1
+#define MSG_RESET                           -2
+#define Q_OK                                MSG_OK
+#define Q_TIMEOUT                           MSG_TIMEOUT
+#define Q_RESET                             MSG_RESET
+#define Q_EMPTY                             -3
+#define Q_FULL                              -4
+
+typedef uint32_t systime_t;
+typedef uint32_t sysinterval_t;
+typedef int32_t msg_t;
+typedef uint32_t eventflags_t;
+typedef int syssts_t;
+
+typedef struct sim_thread {
+  const char            *name;
+  bool                  suspended;
+  msg_t                 msg;
+} thread_t;
+typedef thread_t *thread_reference_t;
+
+typedef struct {
+  thread_t              *waiting;
+} threads_queue_t;
+
+typedef struct {
+  int32_t               cnt;
+  thread_t              *waiting;
+} semaphore_t;
+
+typedef struct {
+  int                   locked;
+} mutex_t;
+
+typedef struct {
+  eventflags_t          flags;
+  uint32_t              broadcasts;
+} event_source_t;
+
+typedef void (*vtfunc_t)(void *p);
+typedef struct virtual_timer {
+  struct virtual_timer  *next;
+  systime_t             when;
+  vtfunc_t              func;
+  void                  *par;
+  bool                  armed;
+} virtual_timer_t;
+
+typedef struct {
+  size_t                size;
+  size_t                used;
+} memory_heap_t;
+
+typedef struct {
+  void                  *next;
+  size_t                object_size;
+} memory_pool_t;
+
+typedef struct {
+  msg_t                 *buffer;
+  size_t                size;
+  size_t                rd, wr, cnt;
+  bool                  reset;
+  thread_t              *waiting;
+} mailbox_t;
+
+/* Simulation state, see sim_kernel.c.*/
+extern int sim_locked;
+extern int sim_isr;
+extern systime_t sim_now;
+extern thread_t sim_thread;
+extern unsigned long sim_wakeups;
+extern unsigned long sim_frames;
+
+/* Called once per frame, after the bus and the timers, can be NULL.*/
+extern void (*sim_frame_hook)(void);
+
+msg_t sim_suspend(thread_t **trp, sysinterval_t timeout);
+void sim_resume(thread_t **trp, msg_t msg);
+
+/* Runs the simulation for a number of frames, outside of any wait.*/
+void sim_run(unsigned frames);
+
+/* Bus model, run once per frame by the kernel with the lock held.*/
+void sim_bus_frame(void);
+
+#define osalDbgCheck(c)                                                     \
+  do { if (!(c)) { printf("check %s:%d\n", __FILE__, __LINE__); abort(); } } while (0)
+#define osalDbgAssert(c, m)                                                 \
+  do { if (!(c)) { printf("assert %s:%d %s\n", __FILE__, __LINE__, m); abort(); } } while (0)
+#define osalDbgCheckClassI()                osalDbgAssert(sim_locked > 0, "not locked")
+#define osalDbgCheckClassS()                                                \
+  osalDbgAssert((sim_locked > 0) && !sim_isr, "not thread locked")
+#define osalSysHalt(m)                                                      \
+  do { printf("halt %s\n", m); abort(); } while (0)
+#define chDbgCheck(c)                       osalDbgCheck(c)
+#define chDbgAssert(c, m)                   osalDbgAssert(c, m)
+
+#define osalSysLock()                       (sim_locked++)
+#define osalSysUnlock()                                                     \
+  do { osalDbgAssert(sim_locked > 0, "not locked"); sim_locked--; } while (0)
+#define osalSysLockFromISR()                osalSysLock()
+#define osalSysUnlockFromISR()              osalSysUnlock()
+#define osalSysGetStatusAndLockX()          (sim_locked++)
+#define osalSysRestoreStatusX(sts)          ((void)(sts), sim_locked--)
+#define chSysLock()                         osalSysLock()
+#define chSysUnlock()                       osalSysUnlock()
+#define chSysLockFromISR()                  osalSysLock()
+#define chSysUnlockFromISR()                osalSysUnlock()
+#define chSysGetStatusAndLockX()            osalSysGetStatusAndLockX()
+#define chSysRestoreStatusX(sts)            osalSysRestoreStatusX(sts)
+#define osalOsRescheduleS()
+#define chSchRescheduleS()
+#define osalOsGetSystemTimeX()              (sim_now)
+#define chVTGetSystemTimeX()                (sim_now)
+#define chVTGetSystemTime()                 (sim_now)
+#define osalTimeDiffX(s, e)                 ((sysinterval_t)((e) - (s)))
+#define chTimeDiffX(s, e)                   osalTimeDiffX(s, e)
+#define chRegSetThreadName(n)               (sim_thread.name = (n))
+
+#define osalThreadSuspendS(trp)             sim_suspend(trp, TIME_INFINITE)
+#define osalThreadSuspendTimeoutS(trp, t)   sim_suspend(trp, t)
+#define osalThreadResumeI(trp, m)           sim_resume(trp, m)
+#define osalThreadResumeS(trp, m)           sim_resume(trp, m)
+#define chThdSuspendS(trp)                  sim_suspend(trp, TIME_INFINITE)
+#define chThdSuspendTimeoutS(trp, t)        sim_suspend(trp, t)
+#define chThdResumeI(trp, m)                sim_resume(trp, m)
+void osalThreadSleepS(sysinterval_t time);
+void osalThreadSleep(sysinterval_t time);
+#define osalThreadSleepMilliseconds(ms)     osalThreadSleep(OSAL_MS2I(ms))
+#define chThdSleepMilliseconds(ms)          osalThreadSleep(OSAL_MS2I(ms))
+
+#define chThdQueueObjectInit(tqp)           ((tqp)->waiting = NULL)
+#define osalThreadQueueObjectInit(tqp)      chThdQueueObjectInit(tqp)
+msg_t chThdEnqueueTimeoutS(threads_queue_t *tqp, sysinterval_t timeout);
+void chThdDequeueNextI(threads_queue_t *tqp, msg_t msg);
+#define chThdDequeueAllI(tqp, m)            chThdDequeueNextI(tqp, m)
+#define osalThreadEnqueueTimeoutS(tqp, t)   chThdEnqueueTimeoutS(tqp, t)
+#define osalThreadDequeueNextI(tqp, m)      chThdDequeueNextI(tqp, m)
+#define osalThreadDequeueAllI(tqp, m)       chThdDequeueNextI(tqp, m)
+
+void chSemObjectInit(semaphore_t *sp, int32_t n);
+msg_t chSemWaitTimeoutS(semaphore_t *sp, sysinterval_t timeout);
+msg_t chSemWait(semaphore_t *sp);
+void chSemSignalI(semaphore_t *sp);
+void chSemSignal(semaphore_t *sp);
+void chSemResetI(semaphore_t *sp, int32_t n);
+#define chSemGetCounterI(sp)                ((sp)->cnt)
+
+#define osalMutexObjectInit(mp)             ((mp)->locked = 0)
+#define chMtxObjectInit(mp)                 osalMutexObjectInit(mp)
+#define osalMutexLock(mp)                                                   \
+  do { osalDbgAssert(!(mp)->locked, "deadlock"); (mp)->locked = 1; } while (0)
+#define osalMutexUnlock(mp)                                                 \
+  do { osalDbgAssert((mp)->locked, "not owned"); (mp)->locked = 0; } while (0)
+#define chMtxLockS(mp)                      osalMutexLock(mp)
+#define chMtxUnlockS(mp)                    osalMutexUnlock(mp)
+
+#define osalEventObjectInit(esp)            ((esp)->flags = 0, (esp)->broadcasts = 0)
+#define osalEventBroadcastFlagsI(esp, f)    ((esp)->flags |= (f), (esp)->broadcasts++)
+#define osalEventBroadcastFlags(esp, f)     osalEventBroadcastFlagsI(esp, f)
+#define chEvtBroadcastFlagsI(esp, f)        osalEventBroadcastFlagsI(esp, f)
+
+void chVTObjectInit(virtual_timer_t *vtp);
+void chVTSetI(virtual_timer_t *vtp, sysinterval_t delay, vtfunc_t vtfunc, void *par);
+void chVTResetI(virtual_timer_t *vtp);
+#define chVTSet(vtp, d, f, p)               chVTSetI(vtp, d, f, p)
+#define chVTReset(vtp)                      chVTResetI(vtp)
+#define chVTIsArmedI(vtp)                   ((vtp)->armed)
+#define chVTIsArmed(vtp)                    ((vtp)->armed)
+
+#define CH_HEAP_AREA(name, size)            uint8_t name[size]
+void chHeapObjectInit(memory_heap_t *heapp, void *buf, size_t size);
+void *chHeapAlloc(memory_heap_t *heapp, size_t size);
+void chHeapFree(void *p);
+
+void chPoolObjectInit(memory_pool_t *mp, size_t size, void *provider);
+void chPoolFreeI(memory_pool_t *mp, void *objp);
+void *chPoolAllocI(memory_pool_t *mp);
+#define chPoolFree(mp, o)                   chPoolFreeI(mp, o)
+#define chPoolAlloc(mp)                     chPoolAllocI(mp)
+#define chPoolAdd(mp, o)                    chPoolFreeI(mp, o)
+#define chPoolAddI(mp, o)                   chPoolFreeI(mp, o)
+
+void chMBObjectInit(mailbox_t *mbp, msg_t *buf, size_t n);
+msg_t chMBPostI(mailbox_t *mbp, msg_t msg);
+msg_t chMBFetchTimeoutS(mailbox_t *mbp, msg_t *msgp, sysinterval_t timeout);
+msg_t chMBFetchTimeout(mailbox_t *mbp, msg_t *msgp, sysinterval_t timeout);
+void chMBResetI(mailbox_t *mbp);
+#define chMBResumeX(mbp)                    ((mbp)->reset = false)
+#define chMBGetUsedCountI(mbp)              ((mbp)->cnt)
+
+#endif /* OSAL_H */
@@ -0,0 +1,334 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/* Simulated kernel of the USB host tests, see osal.h.*/
+
+#include "osal.h"
+
+/* A wait longer than this is a deadlock of the test.*/
+#define SIM_MAX_WAIT                        600000U
+
+int sim_locked;
+int sim_isr;
+systime_t sim_now;
+thread_t sim_thread = {"main", false, MSG_OK};
+unsigned long sim_wakeups;
+unsigned long sim_frames;
+void (*sim_frame_hook)(void);
+
+static virtual_timer_t *vt_list;
+
+/*===========================================================================*/
+/* Frames.                                                                   */
+/*===========================================================================*/
+
+static void sim_frame(void) {
+  virtual_timer_t **vtpp;
+
+  sim_locked++;
+  sim_isr++;
+  sim_now++;
+  sim_frames++;
+
+  sim_bus_frame();
+
+  vtpp = &vt_list;
+  while (*vtpp != NULL) {
+    virtual_timer_t *const vtp = *vtpp;
+    if ((sysinterval_t)(sim_now - vtp->when) < (sysinterval_t)0x80000000U) {
+      *vtpp = vtp->next;
+      vtp->armed = false;
+      vtp->func(vtp->par);
+      vtpp = &vt_list;
+      continue;
+    }
+    vtpp = &vtp->next;
+  }
+
+  if (sim_frame_hook != NULL)
+    sim_frame_hook();
+
+  sim_isr--;
+  sim_locked--;
+}
+
+void sim_run(unsigned frames) {
+
+  osalDbgAssert(sim_locked == 0, "locked");
+  while (frames--)
+    sim_frame();
+}
+
+/*===========================================================================*/
+/* Threads.                                                                  */
+/*===========================================================================*/
+
+msg_t sim_suspend(thread_t **trp, sysinterval_t timeout) {
+  const systime_t start = sim_now;
+
+  osalDbgCheckClassS();
+  if (timeout == TIME_IMMEDIATE)
+    return MSG_TIMEOUT;
+
+  *trp = &sim_thread;
+  sim_thread.suspended = true;
+  while (sim_thread.suspended) {
+    const sysinterval_t elapsed = sim_now - start;
+    if ((timeout != TIME_INFINITE) && (elapsed >= timeout)) {
+      *trp = NULL;
+      sim_thread.suspended = false;
+      return MSG_TIMEOUT;
+    }
+    osalDbgAssert(elapsed < SIM_MAX_WAIT, "deadlock");
+    sim_isr++;
+    sim_frame();
+    sim_isr--;
+  }
+  return sim_thread.msg;
+}
+
+void sim_resume(thread_t **trp, msg_t msg) {
+  thread_t *const tp = *trp;
+
+  osalDbgCheckClassI();
+  if (tp == NULL)
+    return;
+  *trp = NULL;
+  tp->msg = msg;
+  tp->suspended = false;
+  sim_wakeups++;
+}
+
+void osalThreadSleepS(sysinterval_t time) {
+  thread_t *tr = NULL;
+
+  (void)sim_suspend(&tr, time);
+}
+
+void osalThreadSleep(sysinterval_t time) {
+
+  osalSysLock();
+  osalThreadSleepS(time);
+  osalSysUnlock();
+}
+
+msg_t chThdEnqueueTimeoutS(threads_queue_t *tqp, sysinterval_t timeout) {
+
+  osalDbgAssert(tqp->waiting == NULL, "one thread only");
+  return sim_suspend(&tqp->waiting, timeout);
+}
+
+void chThdDequeueNextI(threads_queue_t *tqp, msg_t msg) {
+
+  sim_resume(&tqp->waiting, msg);
+}
+
+/*===========================================================================*/
+/* Semaphores.                                                               */
+/*===========================================================================*/
+
+void chSemObjectInit(semaphore_t *sp, int32_t n) {
+
+  sp->cnt = n;
+  sp->waiting = NULL;
+}
+
+msg_t chSemWaitTimeoutS(semaphore_t *sp, sysinterval_t timeout) {
+  msg_t msg;
+
+  if (--sp->cnt >= 0)
+    return MSG_OK;
+  msg = sim_suspend(&sp->waiting, timeout);
+  if (msg == MSG_TIMEOUT)
+    sp->cnt++;
+  return msg;
+}
+
+msg_t chSemWait(semaphore_t *sp) {
+  msg_t msg;
+
+  osalSysLock();
+  msg = chSemWaitTimeoutS(sp, TIME_INFINITE);
+  osalSysUnlock();
+  return msg;
+}
+
+void chSemSignalI(semaphore_t *sp) {
+
+  if (++sp->cnt <= 0)
+    sim_resume(&sp->waiting, MSG_OK);
+}
+
+void chSemSignal(semaphore_t *sp) {
+
+  osalSysLock();
+  chSemSignalI(sp);
+  osalSysUnlock();
+}
+
+void chSemResetI(semaphore_t *sp, int32_t n) {
+
+  sp->cnt = n;
+  sim_resume(&sp->waiting, MSG_RESET);
+}
+
+/*===========================================================================*/
+/* Virtual timers.                                                           */
+/*===========================================================================*/
+
+void chVTObjectInit(virtual_timer_t *vtp) {
+
+  vtp->armed = false;
+  vtp->next = NULL;
+}
+
+void chVTSetI(virtual_timer_t *vtp, sysinterval_t delay, vtfunc_t vtfunc, void *par) {
+
+  chVTResetI(vtp);
+  vtp->when = sim_now + ((delay > 0U) ? delay : 1U);
+  vtp->func = vtfunc;
+  vtp->par = par;
+  vtp->armed = true;
+  vtp->next = vt_list;
+  vt_list = vtp;
+}
+
+void chVTResetI(virtual_timer_t *vtp) {
+  virtual_timer_t **vtpp;
+
+  if (!vtp->armed)
+    return;
+  for (vtpp = &vt_list; *vtpp != vtp; vtpp = &(*vtpp)->next)
+    ;
+  *vtpp = vtp->next;
+  vtp->armed = false;
+}
+
+/*===========================================================================*/
+/* Memory.                                                                   */
+/*===========================================================================*/
+
+typedef union {
+  struct {
+    memory_heap_t       *heap;
+    size_t              size;
+  } h;
+  max_align_t           align;
+} heap_header_t;
+
+void chHeapObjectInit(memory_heap_t *heapp, void *buf, size_t size) {
+
+  (void)buf;
+  heapp->size = size;
+  heapp->used = 0;
+}
+
+void *chHeapAlloc(memory_heap_t *heapp, size_t size) {
+  heap_header_t *hp;
+
+  if ((heapp != NULL) && (heapp->used + size > heapp->size))
+    return NULL;
+  hp = malloc(sizeof(*hp) + size);
+  osalDbgAssert(hp != NULL, "out of memory");
+  hp->h.heap = heapp;
+  hp->h.size = size;
+  if (heapp != NULL)
+    heapp->used += size;
+  return hp + 1;
+}
+
+void chHeapFree(void *p) {
+  heap_header_t *const hp = (heap_header_t *)p - 1;
+
+  if (hp->h.heap != NULL)
+    hp->h.heap->used -= hp->h.size;
+  free(hp);
+}
+
+void chPoolObjectInit(memory_pool_t *mp, size_t size, void *provider) {
+
+  osalDbgCheck((size >= sizeof(void *)) && (provider == NULL));
+  mp->next = NULL;
+  mp->object_size = size;
+}
+
+void chPoolFreeI(memory_pool_t *mp, void *objp) {
+
+  *(void **)objp = mp->next;
+  mp->next = objp;
+}
+
+void *chPoolAllocI(memory_pool_t *mp) {
+  void *objp = mp->next;
+
+  if (objp != NULL)
+    mp->next = *(void **)objp;
+  return objp;
+}
+
+void chMBObjectInit(mailbox_t *mbp, msg_t *buf, size_t n) {
+
+  mbp->buffer = buf;
+  mbp->size = n;
+  mbp->rd = mbp->wr = mbp->cnt = 0;
+  mbp->reset = false;
+  mbp->waiting = NULL;
+}
+
+msg_t chMBPostI(mailbox_t *mbp, msg_t msg) {
+
+  if (mbp->reset)
+    return MSG_RESET;
+  if (mbp->cnt == mbp->size)
+    return MSG_TIMEOUT;
+  mbp->buffer[mbp->wr] = msg;
+  mbp->wr = (mbp->wr + 1) % mbp->size;
+  mbp->cnt++;
+  sim_resume(&mbp->waiting, MSG_OK);
+  return MSG_OK;
+}
+
+msg_t chMBFetchTimeoutS(mailbox_t *mbp, msg_t *msgp, sysinterval_t timeout) {
+
+  while (mbp->cnt == 0) {
+    msg_t msg;
+    if (mbp->reset)
+      return MSG_RESET;
+    msg = sim_suspend(&mbp->waiting, timeout);
+    if (msg != MSG_OK)
+      return msg;
+  }
+  *msgp = mbp->buffer[mbp->rd];
+  mbp->rd = (mbp->rd + 1) % mbp->size;
+  mbp->cnt--;
+  return MSG_OK;
+}
+
+msg_t chMBFetchTimeout(mailbox_t *mbp, msg_t *msgp, sysinterval_t timeout) {
+  msg_t msg;
+
+  osalSysLock();
+  msg = chMBFetchTimeoutS(mbp, msgp, timeout);
+  osalSysUnlock();
+  return msg;
+}
+
+void chMBResetI(mailbox_t *mbp) {
+
+  mbp->rd = mbp->wr = mbp->cnt = 0;
+  mbp->reset = true;
+  sim_resume(&mbp->waiting, MSG_RESET);
+}
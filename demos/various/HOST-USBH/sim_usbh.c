@@ -0,0 +1,242 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/* Mock low level driver of the USB host tests.*/
+
+#include <string.h>
+
+#include "sim_usbh.h"
+
+unsigned long sim_submits;
+unsigned long sim_completions;
+sim_transfer_t sim_transfer;
+void (*sim_submit_hook)(usbh_urb_t *urb);
+
+USBHDriver USBHD1;
+
+/*===========================================================================*/
+/* Frames.                                                                   */
+/*===========================================================================*/
+
+static void serve_ep(usbh_ep_t *ep) {
+  unsigned n;
+
+  /* Back to back URBs of an endpoint complete in the same frame.*/
+  for (n = 0; (n < 16U) && !list_empty(&ep->urb_list); n++) {
+    usbh_urb_t *const urb = list_first_entry(&ep->urb_list, usbh_urb_t, node);
+    usbh_urbstatus_t status;
+
+    status = (sim_transfer != NULL) ? sim_transfer(urb) : USBH_URBSTATUS_PENDING;
+    if (status == USBH_URBSTATUS_PENDING)
+      break;
+    list_del_init(&urb->node);
+    urb->queued = FALSE;
+    if ((status == USBH_URBSTATUS_STALL) && (ep->type != USBH_EPTYPE_CTRL))
+      ep->status = USBH_EPSTATUS_HALTED;
+    sim_completions++;
+    _usbh_urb_completeI(urb, status);
+  }
+}
+
+void sim_bus_frame(void) {
+  usbh_ep_t *ep, *tmp;
+
+  list_for_each_entry_safe(ep, usbh_ep_t, tmp, &USBHD1.ep_list, node) {
+    serve_ep(ep);
+  }
+}
+
+/*===========================================================================*/
+/* Low level driver.                                                         */
+/*===========================================================================*/
+
+void usbh_lld_init(void) {
+
+  usbhObjectInit(&USBHD1);
+  INIT_LIST_HEAD(&USBHD1.ep_list);
+}
+
+void usbh_lld_start(USBHDriver *usbh) {
+
+  usbh->rootport.lld_status = USBH_PORTSTATUS_POWER;
+  usbh->rootport.lld_c_status = 0;
+}
+
+void usbh_lld_stop(USBHDriver *usbh) {
+
+  usbh->rootport.lld_status = 0;
+}
+
+void usbh_lld_ep_object_init(usbh_ep_t *ep) {
+
+  INIT_LIST_HEAD(&ep->urb_list);
+  INIT_LIST_HEAD(&ep->node);
+}
+
+bool usbh_lld_ep_open(usbh_ep_t *ep) {
+
+  list_add_tail(&ep->node, &ep->device->host->ep_list);
+  ep->status = USBH_EPSTATUS_OPEN;
+  return HAL_SUCCESS;
+}
+
+void usbh_lld_ep_close(usbh_ep_t *ep) {
+
+  while (!list_empty(&ep->urb_list)) {
+    usbh_urb_t *const urb = list_first_entry(&ep->urb_list, usbh_urb_t, node);
+    _usbh_urb_abort_and_waitS(urb, USBH_URBSTATUS_DISCONNECTED);
+  }
+  list_del_init(&ep->node);
+  ep->status = USBH_EPSTATUS_CLOSED;
+}
+
+bool usbh_lld_ep_reset(usbh_ep_t *ep) {
+
+  ep->status = USBH_EPSTATUS_OPEN;
+  return TRUE;
+}
+
+void usbh_lld_urb_submit(usbh_urb_t *urb) {
+
+  sim_submits++;
+  urb->queued = TRUE;
+  list_add_tail(&urb->node, &urb->ep->urb_list);
+  if (sim_submit_hook != NULL)
+    sim_submit_hook(urb);
+}
+
+bool usbh_lld_urb_abort(usbh_urb_t *urb, usbh_urbstatus_t status) {
+
+  osalDbgCheck(usbhURBIsBusy(urb));
+  list_del_init(&urb->node);
+  urb->queued = FALSE;
+  _usbh_urb_completeI(urb, status);
+  return TRUE;
+}
+
+usbh_urbstatus_t usbh_lld_root_hub_request(USBHDriver *host, uint8_t bmRequestType, uint8_t bRequest,
+		uint16_t wvalue, uint16_t windex, uint16_t wlength, uint8_t *buf) {
+  usbh_port_t *const port = &host->rootport;
+  const uint16_t typereq = (bmRequestType << 8) | bRequest;
+
+  (void)windex;
+  osalSysLock();
+  switch (typereq) {
+  case ClearPortFeature:
+    if (wvalue >= USBH_PORT_FEAT_C_CONNECTION)
+      port->lld_c_status &= ~(1U << (wvalue - USBH_PORT_FEAT_C_CONNECTION));
+    else if (wvalue == USBH_PORT_FEAT_ENABLE)
+      port->lld_status &= ~USBH_PORTSTATUS_ENABLE;
+    break;
+  case GetHubStatus:
+    osalDbgCheck(wlength >= 4);
+    memset(buf, 0, 4);
+    break;
+  case GetPortStatus:
+    osalDbgCheck(wlength >= 4);
+    buf[0] = (uint8_t)port->lld_status;
+    buf[1] = (uint8_t)(port->lld_status >> 8);
+    buf[2] = (uint8_t)port->lld_c_status;
+    buf[3] = (uint8_t)(port->lld_c_status >> 8);
+    break;
+  case SetPortFeature:
+    if ((wvalue == USBH_PORT_FEAT_RESET) && (port->lld_status & USBH_PORTSTATUS_CONNECTION)) {
+      port->lld_status |= USBH_PORTSTATUS_ENABLE;
+      port->lld_c_status |= USBH_PORTSTATUS_C_RESET;
+    }
+    break;
+  default:
+    break;
+  }
+  osalSysUnlock();
+  return USBH_URBSTATUS_OK;
+}
+
+uint8_t usbh_lld_roothub_get_statuschange_bitmap(USBHDriver *host) {
+
+  return host->rootport.lld_c_status ? (1 << 1) : 0;
+}
+
+/*===========================================================================*/
+/* Device model helpers.                                                     */
+/*===========================================================================*/
+
+uint32_t sim_urb_in(usbh_urb_t *urb, const void *data, uint32_t len) {
+  const uint8_t *src = data;
+  uint32_t done = 0;
+
+  while ((done < len) && (urb->actualLength < urb->requestedLength)) {
+    uint32_t seg, n;
+    uint8_t *const dst = _usbh_urb_buffer(urb, &seg);
+    n = (len - done < seg) ? len - done : seg;
+    memcpy(dst, src + done, n);
+    urb->actualLength += n;
+    done += n;
+  }
+  return done;
+}
+
+uint32_t sim_urb_out(usbh_urb_t *urb, void *data, uint32_t len) {
+  uint8_t *dst = data;
+  uint32_t done = 0;
+
+  while ((done < len) && (urb->actualLength < urb->requestedLength)) {
+    uint32_t seg, n;
+    const uint8_t *const src = _usbh_urb_buffer(urb, &seg);
+    n = (len - done < seg) ? len - done : seg;
+    memcpy(dst + done, src, n);
+    urb->actualLength += n;
+    done += n;
+  }
+  return done;
+}
+
+void sim_root_connect(usbh_devspeed_t speed) {
+  usbh_port_t *const port = &USBHD1.rootport;
+
+  osalSysLock();
+  port->lld_status |= USBH_PORTSTATUS_CONNECTION;
+  port->lld_status &= ~(USBH_PORTSTATUS_LOW_SPEED | USBH_PORTSTATUS_HIGH_SPEED);
+  if (speed == USBH_DEVSPEED_LOW)
+    port->lld_status |= USBH_PORTSTATUS_LOW_SPEED;
+  else if (speed == USBH_DEVSPEED_HIGH)
+    port->lld_status |= USBH_PORTSTATUS_HIGH_SPEED;
+  port->lld_c_status |= USBH_PORTSTATUS_C_CONNECTION;
+  osalSysUnlock();
+}
+
+void sim_root_disconnect(void) {
+  usbh_port_t *const port = &USBHD1.rootport;
+
+  osalSysLock();
+  port->lld_status &= ~(USBH_PORTSTATUS_CONNECTION | USBH_PORTSTATUS_ENABLE);
+  port->lld_c_status |= USBH_PORTSTATUS_C_CONNECTION;
+  osalSysUnlock();
+}
+
+usbh_device_t *sim_device_setup(usbh_devspeed_t speed) {
+  usbh_port_t *const port = &USBHD1.rootport;
+  usbh_device_t *const dev = &port->device;
+
+  osalSysLock();
+  port->lld_status |= USBH_PORTSTATUS_CONNECTION | USBH_PORTSTATUS_ENABLE;
+  port->status = port->lld_status;
+  osalSysUnlock();
+  dev->speed = speed;
+  dev->address = 1;
+  dev->status = USBH_DEVSTATUS_ADDRESS;
+  return dev;
+}
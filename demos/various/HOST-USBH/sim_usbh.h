@@ -0,0 +1,61 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/* Device model and simulation controls of the USB host tests.*/
+
+#ifndef SIM_USBH_H
+#define SIM_USBH_H
+
+#include "hal.h"
+#include "usbh/internal.h"
+
+#define CHECK(c)                                                            \
+  do {                                                                      \
+    if (!(c)) {                                                             \
+      printf("FAIL %s:%d %s\n", __FILE__, __LINE__, #c);                    \
+      exit(1);                                                              \
+    }                                                                       \
+  } while (0)
+
+/*
+ * Called once per frame for the URB at the head of each endpoint queue,
+ * again for the next one if it completes. Returns USBH_URBSTATUS_PENDING
+ * to NAK, the completion status otherwise; the data is moved with
+ * sim_urb_in() and sim_urb_out().
+ */
+typedef usbh_urbstatus_t (*sim_transfer_t)(usbh_urb_t *urb);
+extern sim_transfer_t sim_transfer;
+
+/* Called by the LLD when an URB is queued, can be NULL.*/
+extern void (*sim_submit_hook)(usbh_urb_t *urb);
+
+/* Counters.*/
+extern unsigned long sim_submits;
+extern unsigned long sim_completions;
+
+/* Copies device data into the URB buffer, through its segments.*/
+uint32_t sim_urb_in(usbh_urb_t *urb, const void *data, uint32_t len);
+/* Copies the URB data out, returns the length copied.*/
+uint32_t sim_urb_out(usbh_urb_t *urb, void *data, uint32_t len);
+
+/* Root port.*/
+void sim_root_connect(usbh_devspeed_t speed);
+void sim_root_disconnect(void);
+
+/* Makes the root port device addressable without enumerating it.*/
+usbh_device_t *sim_device_setup(usbh_devspeed_t speed);
+
+#endif /* SIM_USBH_H */
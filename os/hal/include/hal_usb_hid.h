@@ -435,6 +435,35 @@
 #if !defined(USB_HID_BUFFERS_NUMBER) || defined(__DOXYGEN__)
 #define USB_HID_BUFFERS_NUMBER      2
 #endif
+
+/**
+ * @brief   Enables the latest-value reports API.
+ * @details When enabled @p hidWriteReportLatest() keeps a single report
+ *          slot beside the output queue, a report written while the
+ *          previous one is still waiting for the host replaces it.
+ * @note    The default is @p FALSE.
+ */
+#if !defined(USB_HID_USE_COALESCING) || defined(__DOXYGEN__)
+#define USB_HID_USE_COALESCING      FALSE
+#endif
+
+/**
+ * @brief   Enables the batched reports API.
+ * @details When enabled @p hidWriteReportBatch() packs whole reports into
+ *          a single transfer of up to the IN endpoint maximum packet size.
+ * @note    The default is @p FALSE.
+ */
+#if !defined(USB_HID_USE_BATCHING) || defined(__DOXYGEN__)
+#define USB_HID_USE_BATCHING        FALSE
+#endif
+
+/**
+ * @brief   Maximum size of a latest-value report.
+ * @note    The default is 64 bytes, the full speed interrupt packet size.
+ */
+#if !defined(USB_HID_REPORT_MAX_SIZE) || defined(__DOXYGEN__)
+#define USB_HID_REPORT_MAX_SIZE     64
+#endif
 /** @} */
 
 /*===========================================================================*/
@@ -445,6 +474,10 @@
 #error "USB HID Driver requires HAL_USE_USB"
 #endif
 
+#if (USB_HID_USE_COALESCING == TRUE) && (USB_HID_REPORT_MAX_SIZE <= 0)
+#error "invalid USB_HID_REPORT_MAX_SIZE value"
+#endif
+
 /*===========================================================================*/
 /* Driver data structures and types.                                         */
 /*===========================================================================*/
@@ -483,6 +516,60 @@ typedef struct {
   usbep_t                   int_out;
 } USBHIDConfig;
 
+/**
+ * @brief   USB HID interface statistics.
+ */
+typedef struct {
+  /**
+   * @brief   IN transfers completed on the interrupt endpoint.
+   */
+  uint32_t                  sent;
+  /**
+   * @brief   Latest-value reports replaced before reaching the host.
+   */
+  uint32_t                  coalesced;
+  /**
+   * @brief   Reports not queued because of a timeout or a reset.
+   */
+  uint32_t                  dropped;
+  /**
+   * @brief   Reports written through the batch API.
+   */
+  uint32_t                  batched;
+} hidstats_t;
+
+#if (USB_HID_USE_COALESCING == TRUE) || defined(__DOXYGEN__)
+#define _usb_hid_driver_latest_data                                         \
+  /* Latest report written by the application.*/                            \
+  uint8_t                   latest[USB_HID_REPORT_MAX_SIZE];                \
+  /* Latest report being transmitted.*/                                     \
+  uint8_t                   latest_tx[USB_HID_REPORT_MAX_SIZE];             \
+  /* Size of the latest report.*/                                           \
+  size_t                    latest_n;                                       \
+  /* A latest report is waiting for the endpoint.*/                         \
+  bool                      latest_pending;                                 \
+  /* The endpoint is transmitting @p latest_tx.*/                           \
+  bool                      latest_busy;
+#else
+#define _usb_hid_driver_latest_data
+#endif
+
+#if (USB_HID_USE_BATCHING == TRUE) || defined(__DOXYGEN__)
+#define _usb_hid_driver_batch_data                                          \
+  /* Reports batched by the application.*/                                  \
+  uint8_t                   batch[USB_HID_BUFFERS_SIZE];                    \
+  /* Batch being transmitted.*/                                             \
+  uint8_t                   batch_tx[USB_HID_BUFFERS_SIZE];                 \
+  /* Size of the reports batched so far.*/                                  \
+  size_t                    batch_n;                                        \
+  /* The endpoint is transmitting @p batch_tx.*/                            \
+  bool                      batch_busy;                                     \
+  /* Threads waiting for room in the batch.*/                               \
+  threads_queue_t           batch_waiting;
+#else
+#define _usb_hid_driver_batch_data
+#endif
+
 /**
  * @brief   @p USBHIDDriver specific data.
  */
@@ -502,7 +589,11 @@ typedef struct {
                                               USB_HID_BUFFERS_SIZE)];       \
   /* End of the mandatory fields.*/                                         \
   /* Current configuration data.*/                                          \
-  const USBHIDConfig        *config;
+  const USBHIDConfig        *config;                                        \
+  /* Interface statistics.*/                                                \
+  hidstats_t                stats;                                          \
+  _usb_hid_driver_latest_data                                               \
+  _usb_hid_driver_batch_data
 
 /**
  * @brief   @p USBHIDDriver specific methods.
@@ -541,6 +632,16 @@ struct USBHIDDriver {
 /* Driver macros.                                                            */
 /*===========================================================================*/
 
+/**
+ * @brief   Returns the interface statistics.
+ *
+ * @param[in] uhdp      pointer to the @p USBHIDDriver object
+ * @return              Pointer to the @p hidstats_t structure.
+ *
+ * @xclass
+ */
+#define hidGetStatsX(uhdp) (&(uhdp)->stats)
+
 /*===========================================================================*/
 /* External declarations.                                                    */
 /*===========================================================================*/
@@ -560,6 +661,14 @@ extern "C" {
   size_t hidWriteReportt(USBHIDDriver *uhdp, uint8_t *bp, size_t n, systime_t timeout);
   size_t hidReadReport(USBHIDDriver *uhdp, uint8_t *bp, size_t n);
   size_t hidReadReportt(USBHIDDriver *uhdp, uint8_t *bp, size_t n, systime_t timeout);
+  void hidResetStats(USBHIDDriver *uhdp);
+#if USB_HID_USE_COALESCING == TRUE
+  size_t hidWriteReportLatest(USBHIDDriver *uhdp, const uint8_t *bp, size_t n);
+#endif
+#if USB_HID_USE_BATCHING == TRUE
+  size_t hidWriteReportBatch(USBHIDDriver *uhdp, const uint8_t *bp, size_t n,
+                             systime_t timeout);
+#endif
 #ifdef __cplusplus
 }
 #endif
@@ -56,6 +56,32 @@
 #define HAL_USBH_USE_IAD     HAL_USBH_USE_UVC
 #endif
 
+/* Configuration descriptor cache, keyed by VID/PID/bcdDevice/serial number/speed;
+ * devices without a serial number are not cached */
+#ifndef HAL_USBH_USE_CFGDESC_CACHE
+#define HAL_USBH_USE_CFGDESC_CACHE	FALSE
+#endif
+
+#ifndef HAL_USBH_CFGDESC_CACHE_ENTRIES
+#define HAL_USBH_CFGDESC_CACHE_ENTRIES	4
+#endif
+
+/* Memory reserved for the cached descriptors, in bytes */
+#ifndef HAL_USBH_CFGDESC_CACHE_SIZE
+#define HAL_USBH_CFGDESC_CACHE_SIZE	2048
+#endif
+
+/* Entries of the class driver match index: one per match table entry of the
+ * built-in and registered drivers, three for drivers without a table */
+#ifndef HAL_USBH_CLASSDRIVER_INDEX_SIZE
+#define HAL_USBH_CLASSDRIVER_INDEX_SIZE	32
+#endif
+
+/* Per-phase enumeration timing */
+#ifndef HAL_USBH_USE_ENUMERATION_TIMING
+#define HAL_USBH_USE_ENUMERATION_TIMING	FALSE
+#endif
+
 #if (HAL_USE_USBH == TRUE) || defined(__DOXYGEN__)
 
 #include "osal.h"
@@ -94,6 +120,18 @@ enum usbh_devspeed {
 	USBH_DEVSPEED_HIGH,
 };
 
+#if HAL_USBH_USE_ENUMERATION_TIMING
+enum usbh_enumphase {
+	USBH_ENUMPHASE_DEBOUNCE = 0,
+	USBH_ENUMPHASE_RESET,
+	USBH_ENUMPHASE_ADDRESS,
+	USBH_ENUMPHASE_LANGID,
+	USBH_ENUMPHASE_CONFIGURE,
+	USBH_ENUMPHASE_DRIVERS,
+	USBH_ENUMPHASE_COUNT
+};
+#endif
+
 enum usbh_epdir {
 	USBH_EPDIR_IN		= 0x80,
 	USBH_EPDIR_OUT		= 0
@@ -159,6 +197,13 @@ typedef void (*usbh_completion_cb)(usbh_urb_t *);
 #define USBH_DEFINE_BUFFER(var)	USBH_LLD_DEFINE_BUFFER(var)
 #define USBH_DECLARE_STRUCT_MEMBER(member) USBH_LLD_DECLARE_STRUCT_MEMBER(member)
 
+/* Scatter-gather segment. All the segments of an URB, except the last one,
+ * must be a multiple of the endpoint's wMaxPacketSize. */
+typedef struct usbh_urb_segment {
+	void *buff;
+	uint32_t len;
+} usbh_urb_segment_t;
+
 struct usbh_urb {
 	usbh_ep_t *ep;
 
@@ -170,6 +215,14 @@ struct usbh_urb {
 	uint32_t requestedLength;
 	uint32_t actualLength;
 
+	/* scatter-gather list (buff is not used if not NULL) */
+	const usbh_urb_segment_t *segments;
+	uint8_t segments_count;
+
+	/* next URB of a chain; it is aborted if this one fails. Cleared when
+	 * this one completes or is aborted */
+	usbh_urb_t *next;
+
 	usbh_urbstatus_t status;
 
 	thread_reference_t waitingThread;
@@ -215,6 +268,12 @@ struct usbh_device {
 
 	uint8_t *fullConfigurationDescriptor;
 	uint8_t keepFullCfgDesc;
+#if HAL_USBH_USE_CFGDESC_CACHE
+	uint8_t cfgDescCached;
+#endif
+#if HAL_USBH_USE_ENUMERATION_TIMING
+	systime_t enumTime[USBH_ENUMPHASE_COUNT];
+#endif
 
 	uint8_t address;
 	uint8_t bConfiguration;
@@ -232,6 +291,11 @@ struct usbh_port {
 	usbh_portstatus_t status;
 	usbh_portcstatus_t c_status;
 
+	/* de-bounce: started at attachTime, the timer sets debounced */
+	systime_t attachTime;
+	virtual_timer_t debounce_vt;
+	bool debounced;
+
 	usbh_port_t *next;
 
 	uint8_t number;
@@ -307,6 +371,9 @@ extern "C" {
 	/* Main functions */
 	void usbhObjectInit(USBHDriver *usbh);
 	void usbhInit(void);
+#if HAL_USBH_USE_CFGDESC_CACHE
+	void usbhCfgDescCacheFlush(void);
+#endif
 	void usbhStart(USBHDriver *usbh);
 	void usbhStop(USBHDriver *usbh);
 	void usbhSuspend(USBHDriver *usbh);
@@ -333,6 +400,12 @@ extern "C" {
 			uint32_t *actual_len,
 			systime_t timeout);
 
+	usbh_urbstatus_t usbhSynchronousTransferSG(usbh_ep_t *ep,
+			const usbh_urb_segment_t *segments,
+			uint8_t count,
+			uint32_t *actual_len,
+			systime_t timeout);
+
 	static inline usbh_urbstatus_t usbhBulkTransfer(usbh_ep_t *ep,
 			void *data,
 			uint32_t len,
@@ -378,14 +451,20 @@ extern "C" {
 
 	/* Endpoint/pipe management */
 	void usbhEPObjectInit(usbh_ep_t *ep, usbh_device_t *dev, const usbh_endpoint_descriptor_t *desc);
-	static inline void usbhEPOpen(usbh_ep_t *ep) {
+	/* Fails, leaving the endpoint closed, if the LLD can't reserve the
+	 * periodic bus time the endpoint needs. */
+	static inline bool usbhEPOpen(usbh_ep_t *ep) {
 		osalDbgCheck(ep != 0);
 		osalSysLock();
 		osalDbgAssert(ep->status == USBH_EPSTATUS_CLOSED, "invalid state");
-		usbh_lld_ep_open(ep);
+		if (usbh_lld_ep_open(ep) != HAL_SUCCESS) {
+			osalSysUnlock();
+			return HAL_FAILED;
+		}
 		ep->next = ep->device->endpoints;
 		ep->device->endpoints = ep;
 		osalSysUnlock();
+		return HAL_SUCCESS;
 	}
 	static inline void usbhEPCloseS(usbh_ep_t *ep) {
 		osalDbgCheck(ep != 0);
@@ -416,12 +495,16 @@ extern "C" {
 	/* URB management */
 	void usbhURBObjectInit(usbh_urb_t *urb, usbh_ep_t *ep, usbh_completion_cb callback,
 			void *user, void *buff, uint32_t len);
+	void usbhURBObjectInitSG(usbh_urb_t *urb, usbh_ep_t *ep, usbh_completion_cb callback,
+			void *user, const usbh_urb_segment_t *segments, uint8_t count);
 	void usbhURBObjectResetI(usbh_urb_t *urb);
 	void usbhURBSubmitI(usbh_urb_t *urb);
 	bool usbhURBCancelI(usbh_urb_t *urb);
 	msg_t usbhURBSubmitAndWaitS(usbh_urb_t *urb, systime_t timeout);
 	void usbhURBCancelAndWaitS(usbh_urb_t *urb);
 	msg_t usbhURBWaitTimeoutS(usbh_urb_t *urb, systime_t timeout);
+	void usbhURBChainSubmitI(usbh_urb_t *urbs, uint8_t n);
+	msg_t usbhURBChainSubmitAndWaitS(usbh_urb_t *urbs, uint8_t n, systime_t timeout);
 
 	static inline void usbhURBSubmit(usbh_urb_t *urb) {
 		osalSysLock();
@@ -451,19 +534,70 @@ extern "C" {
 /* Class driver definitions and API.                                         */
 /*===========================================================================*/
 
+typedef struct usbh_classdriver_id usbh_classdriver_id_t;
+
+/* What the core parsed from the descriptor offered to load(): its type and
+ * class triple (device, interface or IAD fields), and the match table entry
+ * that selected the driver (NULL for drivers without a table) */
+typedef struct usbh_classdriver_match {
+	const usbh_classdriver_id_t *id;
+	uint8_t bDescriptorType;
+	uint8_t bClass;
+	uint8_t bSubClass;
+	uint8_t bProtocol;
+} usbh_classdriver_match_t;
+
 typedef struct usbh_classdriver_vmt usbh_classdriver_vmt_t;
 struct usbh_classdriver_vmt {
 	void (*init)(void);
-	usbh_baseclassdriver_t *(*load)(usbh_device_t *dev,	const uint8_t *descriptor, uint16_t rem);
+	usbh_baseclassdriver_t *(*load)(usbh_device_t *dev,	const uint8_t *descriptor, uint16_t rem,
+			const usbh_classdriver_match_t *match);
 	void (*unload)(usbh_baseclassdriver_t *drv);
 	/* TODO: add power control, suspend, etc */
 };
 
+/* Match flags for usbh_classdriver_id_t */
+#define USBH_MATCH_VENDOR		0x01
+#define USBH_MATCH_PRODUCT		0x02
+#define USBH_MATCH_CLASS		0x04
+#define USBH_MATCH_SUBCLASS		0x08
+#define USBH_MATCH_PROTOCOL		0x10
+
+/* Match entry; bClass/bSubClass/bProtocol are compared against the fields of
+ * the descriptor being offered to the driver (device, interface or IAD),
+ * idVendor/idProduct against the device descriptor. */
+struct usbh_classdriver_id {
+	uint8_t match;
+	uint8_t bDescriptorType;
+	uint16_t idVendor;
+	uint16_t idProduct;
+	uint8_t bClass;
+	uint8_t bSubClass;
+	uint8_t bProtocol;
+};
+
+#define USBH_CLASSDRIVER_ID_CLASS(type, cls, sub, proto)				\
+	{ USBH_MATCH_CLASS | USBH_MATCH_SUBCLASS | USBH_MATCH_PROTOCOL,	\
+		(type), 0, 0, (cls), (sub), (proto) }
+
+#define USBH_CLASSDRIVER_ID_VID_PID(type, vid, pid)					\
+	{ USBH_MATCH_VENDOR | USBH_MATCH_PRODUCT, (type), (vid), (pid), 0, 0, 0 }
+
 struct usbh_classdriverinfo {
 	const char *name;
 	const usbh_classdriver_vmt_t *vmt;
+	/* optional match table; if NULL, load() is offered every device,
+	 * interface and IAD descriptor */
+	const usbh_classdriver_id_t *ids;
+	uint8_t ids_count;
 };
 
+/* Node for the runtime class driver registry */
+typedef struct usbh_classdriver_node {
+	const usbh_classdriverinfo_t *info;
+	uint16_t order;		/* precedence; lower is offered the descriptor first */
+} usbh_classdriver_node_t;
+
 #define _usbh_base_classdriver_data		\
 	const usbh_classdriverinfo_t *info;	\
 	usbh_device_t *dev;					\
@@ -473,6 +607,17 @@ struct usbh_baseclassdriver {
 	_usbh_base_classdriver_data
 };
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+	/* Class driver registry */
+	void usbhClassDriverRegister(usbh_classdriver_node_t *node,
+			const usbh_classdriverinfo_t *info);
+	void usbhClassDriverUnregister(usbh_classdriver_node_t *node);
+#ifdef __cplusplus
+}
+#endif
+
 #endif
 
 #endif /* HAL_USBH_H_ */
@@ -26,10 +26,38 @@
 /* Driver pre-compile time settings.                                         */
 /*===========================================================================*/
 
+/* Packet (zero-copy) API, as an alternative to the byte stream channel */
+#if !defined(HAL_USBHAOA_USE_PACKET_API)
+#define HAL_USBHAOA_USE_PACKET_API			FALSE
+#endif
+
+/* Must be a multiple of the bulk endpoints' wMaxPacketSize */
+#if !defined(HAL_USBHAOA_PACKET_SIZE)
+#define HAL_USBHAOA_PACKET_SIZE				512
+#endif
+
+#if !defined(HAL_USBHAOA_OUT_PACKETS)
+#define HAL_USBHAOA_OUT_PACKETS				4
+#endif
+
+#if !defined(HAL_USBHAOA_IN_PACKETS)
+#define HAL_USBHAOA_IN_PACKETS				4
+#endif
+
 /*===========================================================================*/
 /* Derived constants and error checks.                                       */
 /*===========================================================================*/
 
+#if HAL_USBHAOA_USE_PACKET_API
+#if (HAL_USBHAOA_PACKET_SIZE % 64) != 0
+#error "HAL_USBHAOA_PACKET_SIZE must be a multiple of 64"
+#endif
+#if (HAL_USBHAOA_OUT_PACKETS < 1) || (HAL_USBHAOA_OUT_PACKETS > 255) \
+		|| (HAL_USBHAOA_IN_PACKETS < 1) || (HAL_USBHAOA_IN_PACKETS > 255)
+#error "HAL_USBHAOA_OUT_PACKETS / HAL_USBHAOA_IN_PACKETS out of range"
+#endif
+#endif
+
 /*===========================================================================*/
 /* Driver data structures and types.                                         */
 /*===========================================================================*/
@@ -79,6 +107,25 @@ struct AOADriverVMT {
 typedef struct USBHAOAChannel USBHAOAChannel;
 typedef struct USBHAOADriver USBHAOADriver;
 
+#if HAL_USBHAOA_USE_PACKET_API
+typedef struct {
+	usbh_urb_t urb;
+	USBH_DECLARE_STRUCT_MEMBER(uint8_t buff[HAL_USBHAOA_PACKET_SIZE]);
+} usbhaoa_packet_t;
+
+typedef struct {
+	uint32_t out_packets;
+	uint32_t out_bytes;
+	uint32_t out_errors;
+	uint32_t out_waits;			/* acquires that found all the packets in flight */
+	systime_t out_wait_time;	/* total time spent waiting for a free packet */
+	uint32_t in_packets;
+	uint32_t in_bytes;
+	uint32_t in_errors;
+	uint32_t in_full;			/* times all the IN packets were held by the application */
+} usbhaoa_packet_stats_t;
+#endif
+
 struct USBHAOAChannel {
 	/* inherited from abstract asyncrhonous channel driver */
 	const struct AOADriverVMT *vmt;
@@ -100,6 +147,18 @@ struct USBHAOAChannel {
 
 	virtual_timer_t vt;
 
+#if HAL_USBHAOA_USE_PACKET_API
+	usbhaoa_packet_t out_packets[HAL_USBHAOA_OUT_PACKETS];
+	uint8_t op_next;			/* next packet to be acquired */
+	uint8_t op_free;
+	usbhaoa_packet_t in_packets[HAL_USBHAOA_IN_PACKETS];
+	uint8_t ip_next;			/* oldest received packet */
+	uint8_t ip_ready;
+	usbh_urbstatus_t ip_status;	/* OK, or the error that stopped the IN packets */
+	usbhaoa_packet_stats_t stats;
+	bool packet_mode;			/* started with usbhaoaPacketStart */
+#endif
+
 	usbhaoa_channel_state_t state;
 };
 
@@ -132,6 +191,12 @@ typedef bool (*usbhaoa_filter_callback_t)(usbh_device_t *dev, const uint8_t *des
 #define usbhaoaGetChannelState(aoap) ((aoap)->channel.state)
 #define usbhaoaGetHost(aoap) ((aoap)->dev->host)
 
+#if HAL_USBHAOA_USE_PACKET_API
+#define usbhaoaPacketsInFlight(aoap) (HAL_USBHAOA_OUT_PACKETS - (aoap)->channel.op_free)
+#define usbhaoaGetPacketStats(aoap) (&(aoap)->channel.stats)
+#define usbhaoaPacketGetInStatus(aoap) ((aoap)->channel.ip_status)
+#endif
+
 /*===========================================================================*/
 /* External declarations.                                                    */
 /*===========================================================================*/
@@ -143,6 +208,14 @@ extern "C" {
 	/* AOA device driver */
 	void usbhaoaChannelStart(USBHAOADriver *aoap);
 	void usbhaoaChannelStop(USBHAOADriver *aoap);
+#if HAL_USBHAOA_USE_PACKET_API
+	/* Packet API, instead of the stream channel; usbhaoaChannelStop stops it */
+	void usbhaoaPacketStart(USBHAOADriver *aoap);
+	uint8_t *usbhaoaPacketAcquire(USBHAOADriver *aoap, systime_t timeout);
+	bool usbhaoaPacketSubmit(USBHAOADriver *aoap, size_t len);
+	const uint8_t *usbhaoaPacketReceive(USBHAOADriver *aoap, size_t *len, systime_t timeout);
+	void usbhaoaPacketRelease(USBHAOADriver *aoap);
+#endif
 #ifdef __cplusplus
 }
 #endif
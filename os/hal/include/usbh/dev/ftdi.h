@@ -25,10 +25,36 @@
 /*===========================================================================*/
 /* Driver pre-compile time settings.                                         */
 /*===========================================================================*/
+#if !defined(HAL_USBHFTDI_IN_URBS)
+#define HAL_USBHFTDI_IN_URBS						2
+#endif
+
+#if !defined(HAL_USBHFTDI_OUT_URBS)
+#define HAL_USBHFTDI_OUT_URBS						2
+#endif
+
+/* Size of each URB buffer; must be at least the bulk IN wMaxPacketSize
+ * (64 for full-speed chips, 512 for the H chips on a high-speed host),
+ * ports with bigger packets are not allocated. */
+#if !defined(HAL_USBHFTDI_BUFFER_SIZE)
+#define HAL_USBHFTDI_BUFFER_SIZE					64
+#endif
+
+#if !defined(HAL_USBHFTDI_DEFAULT_LATENCY)
+#define HAL_USBHFTDI_DEFAULT_LATENCY				16
+#endif
 
 /*===========================================================================*/
 /* Derived constants and error checks.                                       */
 /*===========================================================================*/
+#if (HAL_USBHFTDI_IN_URBS < 1) || (HAL_USBHFTDI_OUT_URBS < 1)
+#error "HAL_USBHFTDI_IN_URBS and HAL_USBHFTDI_OUT_URBS must be at least 1"
+#endif
+
+#if (HAL_USBHFTDI_BUFFER_SIZE < 64) || (HAL_USBHFTDI_BUFFER_SIZE % 64)
+#error "HAL_USBHFTDI_BUFFER_SIZE must be a non-zero multiple of 64"
+#endif
+
 #define USBHFTDI_FRAMING_DATABITS_7    (0x7 << 0)
 #define USBHFTDI_FRAMING_DATABITS_8    (0x8 << 0)
 #define USBHFTDI_FRAMING_PARITY_NONE   (0x0 << 8)
@@ -57,6 +83,8 @@ typedef struct {
   uint8_t   handshake;
   uint8_t   xon_character;
   uint8_t	xoff_character;
+  /* latency timer in ms (1..255); 0 selects HAL_USBHFTDI_DEFAULT_LATENCY */
+  uint8_t	latency;
 } USBHFTDIPortConfig;
 
 typedef enum {
@@ -93,21 +121,27 @@ struct USBHFTDIPortDriver {
 	usbhftdip_state_t state;
 
 	usbh_ep_t epin;
-	usbh_urb_t iq_urb;
+	usbh_urb_t iq_urb[HAL_USBHFTDI_IN_URBS];
 	threads_queue_t	iq_waiting;
-	uint32_t iq_counter;
-	USBH_DECLARE_STRUCT_MEMBER(uint8_t iq_buff[64]);
+	uint8_t iq_head;		/* oldest IN URB, the one being read from */
+	uint32_t iq_counter;	/* payload bytes left in the head URB */
+	USBH_DECLARE_STRUCT_MEMBER(uint8_t iq_buff[HAL_USBHFTDI_IN_URBS][HAL_USBHFTDI_BUFFER_SIZE]);
 	uint8_t *iq_ptr;
+	uint8_t modem_status;
+	uint8_t line_status;
 
 
 	usbh_ep_t epout;
-	usbh_urb_t oq_urb;
+	usbh_urb_t oq_urb[HAL_USBHFTDI_OUT_URBS];
 	threads_queue_t	oq_waiting;
-	uint32_t oq_counter;
-	USBH_DECLARE_STRUCT_MEMBER(uint8_t oq_buff[64]);
+	uint8_t oq_head;		/* OUT URB being filled */
+	bool oq_writing;		/* a writer is copying into the head URB */
+	uint32_t oq_counter;	/* free bytes left in the head URB */
+	USBH_DECLARE_STRUCT_MEMBER(uint8_t oq_buff[HAL_USBHFTDI_OUT_URBS][HAL_USBHFTDI_BUFFER_SIZE]);
 	uint8_t *oq_ptr;
 
 	virtual_timer_t vt;
+	systime_t latency;
 	uint8_t ifnum;
 
 	USBHFTDIPortDriver *next;
@@ -128,6 +162,8 @@ struct USBHFTDIDriver {
 /*===========================================================================*/
 #define usbhftdipGetState(ftdipp) ((ftdipp)->state)
 #define usbhftdipGetHost(ftdipp) ((ftdipp)->ftdip->dev->host)
+#define usbhftdipGetModemStatusX(ftdipp) ((ftdipp)->modem_status)
+#define usbhftdipGetLineStatusX(ftdipp) ((ftdipp)->line_status)
 
 /*===========================================================================*/
 /* External declarations.                                                    */
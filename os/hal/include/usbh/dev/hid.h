@@ -34,6 +34,38 @@
 #define HAL_USBHHID_USE_INTERRUPT_OUT 				FALSE
 #endif
 
+/* Compile the report descriptor into a field table when the device loads */
+#if !defined(HAL_USBHHID_USE_REPORT_PARSER)
+#define HAL_USBHHID_USE_REPORT_PARSER 				FALSE
+#endif
+
+/* One entry per array, or per run of variables with consecutive usages */
+#if !defined(HAL_USBHHID_MAX_FIELDS)
+#define HAL_USBHHID_MAX_FIELDS 						32
+#endif
+
+#if !defined(HAL_USBHHID_REPORT_DESC_MAX_SIZE)
+#define HAL_USBHHID_REPORT_DESC_MAX_SIZE 			512
+#endif
+
+/* Queue the received reports (read with usbhhidReadReport) and keep two
+ * IN URBs armed; output reports are queued on the interrupt OUT endpoint */
+#if !defined(HAL_USBHHID_USE_REPORT_QUEUE)
+#define HAL_USBHHID_USE_REPORT_QUEUE 				FALSE
+#endif
+
+#if !defined(HAL_USBHHID_REPORT_QUEUE_SIZE)
+#define HAL_USBHHID_REPORT_QUEUE_SIZE 				8
+#endif
+
+#if !defined(HAL_USBHHID_OUT_QUEUE_SIZE)
+#define HAL_USBHHID_OUT_QUEUE_SIZE 					4
+#endif
+
+#if !defined(HAL_USBHHID_MAX_REPORT_SIZE)
+#define HAL_USBHHID_MAX_REPORT_SIZE 				64
+#endif
+
 /*===========================================================================*/
 /* Derived constants and error checks.                                       */
 /*===========================================================================*/
@@ -67,12 +99,41 @@ typedef enum {
 	USBHHID_PROTOCOL_REPORT = 1,
 } usbhhid_protocol_t;
 
+#if HAL_USBHHID_USE_REPORT_PARSER
+/* field flags, as in the Input/Output/Feature main items */
+#define USBHHID_FIELD_CONSTANT		(1 << 0)
+#define USBHHID_FIELD_VARIABLE		(1 << 1)
+#define USBHHID_FIELD_RELATIVE		(1 << 2)
+#define USBHHID_FIELD_WRAP			(1 << 3)
+#define USBHHID_FIELD_NONLINEAR		(1 << 4)
+#define USBHHID_FIELD_NOPREFERRED	(1 << 5)
+#define USBHHID_FIELD_NULLSTATE		(1 << 6)
+
+/* Variables with consecutive usages share a field: value i has the usage
+ * min(usage + i, usage_max), so a keyboard bitmap takes a single entry */
+typedef struct {
+	uint16_t usage_page;
+	uint16_t usage;				/* for arrays, the usage of the value 0 */
+	uint16_t usage_max;
+	uint16_t bit_offset;		/* from the start of the report, including the ID */
+	uint8_t bit_size;
+	uint8_t count;				/* number of values, the array size for arrays */
+	uint8_t report_id;
+	uint8_t type;				/* usbhhid_reporttype_t */
+	uint8_t flags;
+	int32_t logical_min;
+	int32_t logical_max;
+} usbhhid_field_t;
+#endif
+
 typedef struct USBHHIDDriver USBHHIDDriver;
 typedef struct USBHHIDConfig USBHHIDConfig;
 
 typedef void (*usbhhid_report_callback)(USBHHIDDriver *hidp, uint16_t len);
 
 struct USBHHIDConfig {
+	/* cb_report and report_buffer are not used with
+	 * HAL_USBHHID_USE_REPORT_QUEUE, see usbhhidReadReport */
 	usbhhid_report_callback cb_report;
 	void *report_buffer;
 	uint16_t report_len;
@@ -96,6 +157,37 @@ struct USBHHIDDriver {
 
 	const USBHHIDConfig *config;
 
+#if HAL_USBHHID_USE_REPORT_QUEUE
+	usbh_urb_t in_urb2;
+	USBH_DECLARE_STRUCT_MEMBER(uint8_t in_buff[2][HAL_USBHHID_MAX_REPORT_SIZE]);
+
+	/* received reports */
+	uint8_t rq_buff[HAL_USBHHID_REPORT_QUEUE_SIZE][HAL_USBHHID_MAX_REPORT_SIZE];
+	uint16_t rq_len[HAL_USBHHID_REPORT_QUEUE_SIZE];
+	uint8_t rq_head;
+	uint8_t rq_count;
+	uint32_t rq_overruns;
+	threads_queue_t rq_waiting;
+
+#if HAL_USBHHID_USE_INTERRUPT_OUT
+	/* output reports */
+	usbh_urb_t out_urb;
+	USBH_DECLARE_STRUCT_MEMBER(uint8_t oq_buff[HAL_USBHHID_OUT_QUEUE_SIZE][HAL_USBHHID_MAX_REPORT_SIZE]);
+	uint16_t oq_len[HAL_USBHHID_OUT_QUEUE_SIZE];
+	uint8_t oq_head;
+	uint8_t oq_count;
+	uint32_t oq_errors;
+	uint8_t oq_sync;
+	threads_queue_t oq_waiting;
+#endif
+#endif
+
+#if HAL_USBHHID_USE_REPORT_PARSER
+	uint16_t report_desc_len;
+	uint16_t fields_count;
+	usbhhid_field_t fields[HAL_USBHHID_MAX_FIELDS];
+#endif
+
 	semaphore_t sem;
 };
 
@@ -134,7 +226,38 @@ extern "C" {
 		return hidp->state;
 	}
 
-	void usbhhidStart(USBHHIDDriver *hidp, const USBHHIDConfig *cfg);
+	bool usbhhidStart(USBHHIDDriver *hidp, const USBHHIDConfig *cfg);
+	void usbhhidStop(USBHHIDDriver *hidp);
+
+#if HAL_USBHHID_USE_REPORT_QUEUE
+	uint16_t usbhhidReadReport(USBHHIDDriver *hidp, void *buff, uint16_t size, systime_t timeout);
+	static inline uint32_t usbhhidGetOverruns(USBHHIDDriver *hidp) {
+		return hidp->rq_overruns;
+	}
+#if HAL_USBHHID_USE_INTERRUPT_OUT
+	bool usbhhidQueueOutputReport(USBHHIDDriver *hidp, const void *data, uint16_t len);
+#endif
+#endif
+
+#if HAL_USBHHID_USE_REPORT_PARSER
+	/* Report descriptor parser / field extraction */
+	bool usbhhidParseReportDescriptor(USBHHIDDriver *hidp, const uint8_t *desc, uint16_t len);
+	const usbhhid_field_t *usbhhidFindField(USBHHIDDriver *hidp, usbhhid_reporttype_t type,
+			uint16_t usage_page, uint16_t usage, uint8_t *index);
+	bool usbhhidGetField(const usbhhid_field_t *field, const uint8_t *report, uint16_t len,
+			uint8_t index, int32_t *value);
+	bool usbhhidGetFields(USBHHIDDriver *hidp, usbhhid_reporttype_t type,
+			const uint8_t *report, uint16_t len, int32_t *values, uint16_t max,
+			uint16_t *count);
+
+	static inline uint16_t usbhhidGetFieldsCount(USBHHIDDriver *hidp) {
+		return hidp->fields_count;
+	}
+
+	static inline const usbhhid_field_t *usbhhidGetFieldTable(USBHHIDDriver *hidp) {
+		return hidp->fields;
+	}
+#endif
 #ifdef __cplusplus
 }
 #endif
@@ -27,12 +27,22 @@
 /*===========================================================================*/
 /* Driver pre-compile time settings.                                         */
 /*===========================================================================*/
+/* Reassemble the video payloads into whole frames inside the driver
+ * (see usbhuvcSetFrameBuffers) instead of posting every packet. */
+#if !defined(HAL_USBHUVC_USE_FRAME_ASSEMBLER)
+#define HAL_USBHUVC_USE_FRAME_ASSEMBLER			FALSE
+#endif
 
+/* Number of URBs kept queued on a bulk VS endpoint */
+#if !defined(HAL_USBHUVC_BULK_URBS)
+#define HAL_USBHUVC_BULK_URBS					2
+#endif
 
 /*===========================================================================*/
 /* Derived constants and error checks.                                       */
 /*===========================================================================*/
 #define USBHUVC_MAX_STATUS_PACKET_SZ	16
+#define USBHUVC_FRAME_BUFFERS			3
 
 
 /*===========================================================================*/
@@ -313,10 +323,14 @@ typedef struct USBHUVCDriver USBHUVCDriver;
 #define USBHUVC_MESSAGETYPE_STATUS	1
 #define USBHUVC_MESSAGETYPE_DATA	2
 
+/* usbhuvcStreamStart() min_ep_sz: size the stream from the committed
+ * dwMaxPayloadTransferSize */
+#define USBHUVC_MIN_EP_SZ_COMMITTED	0xffff
+
 
 #define _usbhuvc_message_base_data				\
 		uint16_t type;							\
-		uint16_t length;						\
+		uint32_t length;						\
 		systime_t timestamp;
 
 typedef struct {
@@ -334,6 +348,30 @@ typedef struct {
 } usbhuvc_message_status_t;
 
 
+#if HAL_USBHUVC_USE_FRAME_ASSEMBLER
+#define USBHUVC_FRAME_FLAG_PTS		(1 << 0)	/* pts holds dwPresentationTime */
+#define USBHUVC_FRAME_FLAG_STILL	(1 << 1)	/* still image frame */
+
+typedef struct {
+	/* set by the caller */
+	uint8_t *buf;
+	uint32_t size;
+
+	/* filled by the driver */
+	uint32_t length;
+	systime_t timestamp;		/* system time of the frame's first payload */
+	uint32_t pts;
+	uint32_t sequence;
+	uint8_t flags;
+} usbhuvc_frame_t;
+
+typedef struct {
+	uint32_t completed;
+	uint32_t dropped;			/* overwritten before being acquired */
+	uint32_t corrupt;			/* ERR bit, lost packet or buffer overflow */
+} usbhuvc_frame_stats_t;
+#endif
+
 typedef enum {
 	USBHUVC_STATE_UNINITIALIZED = 0,	//must call usbhuvcObjectInit
 	USBHUVC_STATE_STOP	 		= 1,	//the device is disconnected
@@ -351,11 +389,16 @@ struct USBHUVCDriver {
 	usbhuvc_state_t state;
 
 	usbh_ep_t ep_int;
-	usbh_ep_t ep_iso;
+	usbh_ep_t ep_vs;			/* isochronous or bulk VS data endpoint */
+	bool vs_bulk;
 
-	usbh_urb_t urb_iso;
+	usbh_urb_t urb_vs[HAL_USBHUVC_BULK_URBS];
 	usbh_urb_t urb_int;
 
+	/* payload bytes received since vs_bw_start */
+	uint32_t vs_bytes;
+	systime_t vs_bw_start;
+
 	if_iterator_t ivc;
 	if_iterator_t ivs;
 
@@ -372,6 +415,21 @@ struct USBHUVCDriver {
 	memory_pool_t mp_status;
 	usbhuvc_message_status_t mp_status_buffer[HAL_USBHUVC_STATUS_PACKETS_COUNT];
 
+#if HAL_USBHUVC_USE_FRAME_ASSEMBLER
+	/* triple buffer, tribuf style: the ISO callback fills fr_back, the
+	 * application owns fr_front and fr_orphan holds the latest frame */
+	usbhuvc_frame_t *fr_front;
+	usbhuvc_frame_t *fr_back;
+	usbhuvc_frame_t *fr_orphan;
+	semaphore_t fr_ready;
+	uint32_t fr_sequence;
+	uint8_t fr_fid;
+	bool fr_sync;
+	bool fr_started;
+	bool fr_error;
+	usbhuvc_frame_stats_t fr_stats;
+#endif
+
 	mutex_t mtx;
 };
 
@@ -425,8 +483,15 @@ extern "C" {
 		return &uvcdp->pc;
 	}
 
+	/* min_ep_sz = 0 selects the alternate setting 0 (bulk streaming),
+	 * USBHUVC_MIN_EP_SZ_COMMITTED the smallest alternate setting that fits
+	 * the committed dwMaxPayloadTransferSize */
 	bool usbhuvcStreamStart(USBHUVCDriver *uvcdp, uint16_t min_ep_sz);
 	bool usbhuvcStreamStop(USBHUVCDriver *uvcdp);
+	uint32_t usbhuvcGetBandwidth(USBHUVCDriver *uvcdp);
+	static inline bool usbhuvcIsBulkStream(USBHUVCDriver *uvcdp) {
+		return uvcdp->vs_bulk;
+	}
 
 	static inline msg_t usbhuvcLockAndFetchS(USBHUVCDriver *uvcdp, msg_t *msg, systime_t timeout) {
 		chMtxLockS(&uvcdp->mtx);
@@ -450,6 +515,14 @@ extern "C" {
 	static inline void usbhuvcFreeStatusMessage(USBHUVCDriver *uvcdp, usbhuvc_message_status_t *msg) {
 		chPoolFree(&uvcdp->mp_status, msg);
 	}
+
+#if HAL_USBHUVC_USE_FRAME_ASSEMBLER
+	void usbhuvcSetFrameBuffers(USBHUVCDriver *uvcdp, usbhuvc_frame_t *frames);
+	usbhuvc_frame_t *usbhuvcFrameAcquire(USBHUVCDriver *uvcdp, systime_t timeout);
+	static inline const usbhuvc_frame_stats_t *usbhuvcGetFrameStats(USBHUVCDriver *uvcdp) {
+		return &uvcdp->fr_stats;
+	}
+#endif
 #ifdef __cplusplus
 }
 #endif
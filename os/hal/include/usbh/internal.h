@@ -53,10 +53,12 @@ void _usbh_port_disconnected(usbh_port_t *port);
 void _usbh_urb_completeI(usbh_urb_t *urb, usbh_urbstatus_t status);
 bool _usbh_urb_abortI(usbh_urb_t *urb, usbh_urbstatus_t status);
 void _usbh_urb_abort_and_waitS(usbh_urb_t *urb, usbh_urbstatus_t status);
+uint8_t *_usbh_urb_buffer(usbh_urb_t *urb, uint32_t *len);
 
 bool _usbh_match_vid_pid(usbh_device_t *dev, int32_t vid, int32_t pid);
 bool _usbh_match_descriptor(const uint8_t *descriptor, uint16_t rem,
 		int16_t type, int16_t _class, int16_t subclass, int16_t protocol);
+bool _usbh_classdriver_load(usbh_device_t *dev, const uint8_t *descriptor, uint16_t rem);
 
 #define USBH_REQTYPE_CLASSIN(type)	\
 	(USBH_REQTYPE_DIR_IN | type | USBH_REQTYPE_TYPE_CLASS)
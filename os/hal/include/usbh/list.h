@@ -193,6 +193,48 @@ static inline int list_empty(const struct list_head *head)
              &pos->member != (head);                                    \
              pos = n, n = list_next_entry(n, type, member))
 
+/**
+ * list_move - delete from one list and add as another's head
+ * @list: the entry to move
+ * @head: the head that will precede our entry
+ */
+static inline void list_move(struct list_head *list, struct list_head *head)
+{
+        __list_del_entry(list);
+        list_add(list, head);
+}
+
+static inline void __list_splice(const struct list_head *list,
+                                 struct list_head *prev,
+                                 struct list_head *next)
+{
+        struct list_head *first = list->next;
+        struct list_head *last = list->prev;
+
+        first->prev = prev;
+        prev->next = first;
+
+        last->next = next;
+        next->prev = last;
+}
+
+/**
+ * list_splice_tail_init - join two lists and reinitialise the emptied list
+ * @list: the new list to add.
+ * @head: the place to add it in the first list.
+ *
+ * Each of the lists is a queue.
+ * The list at @list is reinitialised
+ */
+static inline void list_splice_tail_init(struct list_head *list,
+                                         struct list_head *head)
+{
+        if (!list_empty(list)) {
+                __list_splice(list, head->prev, head);
+                INIT_LIST_HEAD(list);
+        }
+}
+
 #if 0
 
 /**
@@ -263,17 +305,6 @@ static inline int list_empty(const struct list_head *head)
         (!list_empty(ptr) ? list_first_entry(ptr, type, member) : NULL)
 
 
-/**
- * list_move - delete from one list and add as another's head
- * @list: the entry to move
- * @head: the head that will precede our entry
- */
-static inline void list_move(struct list_head *list, struct list_head *head)
-{
-        __list_del_entry(list);
-        list_add(list, head);
-}
-
 /**
  * list_is_last - tests whether @list is the last entry in list @head
  * @list: the entry to test
@@ -367,20 +398,6 @@ static inline void list_cut_position(struct list_head *list,
                 __list_cut_position(list, head, entry);
 }
 
-static inline void __list_splice(const struct list_head *list,
-                                 struct list_head *prev,
-                                 struct list_head *next)
-{
-        struct list_head *first = list->next;
-        struct list_head *last = list->prev;
-
-        first->prev = prev;
-        prev->next = first;
-
-        last->next = next;
-        next->prev = last;
-}
-
 /**
  * list_splice - join two lists, this is designed for stacks
  * @list: the new list to add.
@@ -421,23 +438,6 @@ static inline void list_splice_init(struct list_head *list,
         }
 }
 
-/**
- * list_splice_tail_init - join two lists and reinitialise the emptied list
- * @list: the new list to add.
- * @head: the place to add it in the first list.
- *
- * Each of the lists is a queue.
- * The list at @list is reinitialised
- */
-static inline void list_splice_tail_init(struct list_head *list,
-                                         struct list_head *head)
-{
-        if (!list_empty(list)) {
-                __list_splice(list, head->prev, head);
-                INIT_LIST_HEAD(list);
-        }
-}
-
 /**
  * list_replace - replace old entry by new one
  * @old : the element to be replaced
@@ -1,9 +1,12 @@
 ifeq ($(USE_SMART_BUILD),yes)
 ifneq ($(findstring HAL_USE_USB TRUE,$(HALCONF)),)
-PLATFORMSRC += $(CHIBIOS_CONTRIB)/os/hal/ports/HT32/LLD/USBv1/hal_usb_lld.c
+PLATFORMSRC += $(CHIBIOS_CONTRIB)/os/hal/ports/HT32/LLD/USBv1/hal_usb_lld.c \
+               $(CHIBIOS_CONTRIB)/os/hal/ports/common/USB-EPBUF/usb_epbuf.c
 endif
 else
-PLATFORMSRC += $(CHIBIOS_CONTRIB)/os/hal/ports/HT32/LLD/USBv1/hal_usb_lld.c
+PLATFORMSRC += $(CHIBIOS_CONTRIB)/os/hal/ports/HT32/LLD/USBv1/hal_usb_lld.c \
+               $(CHIBIOS_CONTRIB)/os/hal/ports/common/USB-EPBUF/usb_epbuf.c
 endif
 
-PLATFORMINC += $(CHIBIOS_CONTRIB)/os/hal/ports/HT32/LLD/USBv1
+PLATFORMINC += $(CHIBIOS_CONTRIB)/os/hal/ports/HT32/LLD/USBv1 \
+               $(CHIBIOS_CONTRIB)/os/hal/ports/common/USB-EPBUF
@@ -106,10 +106,10 @@ static void usb_clear_ep_int_flags(int ep, uint32_t flags){
 }
 
 static size_t usb_epmem_alloc(USBDriver *usbp, size_t size) {
-    const size_t epmo = usbp->epmem_next;
+    const size_t epmo = usbEpbufPoolAlloc(&usbp->epmem, size);
 
-    usbp->epmem_next = roundup2(epmo + size, 4);
-    osalDbgAssert(usbp->epmem_next <= 0x400, "EPSRAM exhausted");
+    if (epmo == USB_EPBUF_INVALID)
+        osalSysHalt("EPSRAM exhausted");
     return epmo;
 }
 
@@ -124,18 +124,7 @@ static void usb_packet_transmit(USBDriver *usbp, usbep_t ep, size_t n)
     if ((USB->EP[ep].TCR & 0xffffU) == 0) {
         const uint32_t cfgr = USB->EP[ep].CFGR;
         volatile uint32_t * const EPSRAM = (void *)(USB_SRAM_BASE + (cfgr & 0x3ff));
-        for (size_t i = 0; i < n; i += 4) {
-            uint32_t word = 0;
-            if (i + 0 < n)
-                word |= (uint32_t)isp->txbuf[i+0]<<0;
-            if (i + 1 < n)
-                word |= (uint32_t)isp->txbuf[i+1]<<8;
-            if (i + 2 < n)
-                word |= (uint32_t)isp->txbuf[i+2]<<16;
-            if (i + 3 < n)
-                word |= (uint32_t)isp->txbuf[i+3]<<24;
-            EPSRAM[i/4] = word;
-        }
+        usbEpbufWriteWords(EPSRAM, isp->txbuf, n);
 
         USB->EP[ep].TCR = n;
         isp->txlastpktlen = n;
@@ -149,19 +138,8 @@ static size_t usb_packet_receive(USBDriver *usbp, usbep_t ep) {
     const uint32_t cfgr = USB->EP[ep].CFGR;
     volatile uint32_t *const EPSRAM = (void *)(USB_SRAM_BASE + (cfgr & 0x3ff) + ((ep == 0) ? ((cfgr >> 10) & 0x7f) : 0));
 
-    for (size_t i = 0; i < n; i += 4) {
-        if(!osp->rxbuf)
-            break;
-        const uint32_t word = EPSRAM[i/4];
-        if (i + 0 < n)
-            osp->rxbuf[i + 0] = word >> 0;
-        if (i + 1 < n)
-            osp->rxbuf[i + 1] = word >> 8;
-        if (i + 2 < n)
-            osp->rxbuf[i + 2] = word >> 16;
-        if (i + 3 < n)
-            osp->rxbuf[i + 3] = word >> 24;
-    }
+    if (osp->rxbuf)
+        usbEpbufReadWords(osp->rxbuf, EPSRAM, n);
 
     osp->rxbuf += n;
     osp->rxcnt += n;
@@ -443,12 +421,13 @@ void usb_lld_reset(USBDriver *usbp) {
     // Clear CSR, except for DP pull up
     USB->CSR &= USBCSR_DPPUEN;
 
-    /* Post reset initialization.*/
-    usbp->epmem_next = 8;
+    /* Post reset initialization, the first 8 bytes hold the SETUP packet.*/
+    usbEpbufPoolInit(&usbp->epmem, 8, 0x400, 4);
 
     /* EP0 initialization.*/
     usbp->epc[0] = &ep0config;
     usb_lld_init_endpoint(usbp, 0);
+    usbEpbufPoolSetMarkX(&usbp->epmem);
 
     USB->IER = USBIER_UGIE | USBIER_SOFIE |
         USBIER_URSTIE | USBIER_RSMIE | USBIER_SUSPIE |
@@ -532,8 +511,8 @@ void usb_lld_disable_endpoints(USBDriver *usbp) {
         USB->IER &= ~(USBIER_EP0IE << i);
     }
 
-    const uint32_t cfgr = USB->EP[0].CFGR;
-    usbp->epmem_next = (cfgr & 0x3ff) + ((cfgr >> 10) & 0x7f);
+    /* EP0 buffers, IN and OUT, are kept.*/
+    usbEpbufPoolRewindX(&usbp->epmem);
 }
 
 /**
@@ -28,6 +28,8 @@
 
 #if (HAL_USE_USB == TRUE) || defined(__DOXYGEN__)
 
+#include "usb_epbuf.h"
+
 /*===========================================================================*/
 /* Driver constants.                                                         */
 /*===========================================================================*/
@@ -303,7 +305,10 @@ struct USBDriver {
   USB_DRIVER_EXT_FIELDS
 #endif
   /* End of the mandatory fields.*/
-  uint16_t                      epmem_next;
+  /**
+   * @brief   EPSRAM allocator.
+   */
+  usb_epbuf_pool_t              epmem;
 };
 
 /*===========================================================================*/
@@ -132,46 +132,55 @@ typedef struct {
  */
 static volatile bd_t _bdt[(KINETIS_USB_ENDPOINTS)*2*2] __attribute__((aligned(512)));
 
-/* FIXME later with dyn alloc
- * 16 EP
- *  2 directions per EP
- *  2 buffer per direction
- * => 64 buffers
+/*
+ * 2 directions per EP
+ * 2 buffer per direction, allocated by size from a shared area
  */
-static uint8_t _usbb[KINETIS_USB_ENDPOINTS*4][64] __attribute__((aligned(4)));
-static volatile uint8_t _usbbn=0;
-uint8_t* usb_alloc(uint8_t size)
+static uint8_t _usbb[KINETIS_USB_PACKET_MEMORY_SIZE] __attribute__((aligned(4)));
+static usb_epbuf_pool_t _usbpool;
+
+static uint8_t *usb_alloc(size_t size)
 {
-  (void)size;
-  if(_usbbn < (KINETIS_USB_ENDPOINTS)*4)
-    return _usbb[_usbbn++];
-  while(1); /* Should not happen, ever */
+  size_t offset = usbEpbufPoolAlloc(&_usbpool, size);
+
+  if(offset == USB_EPBUF_INVALID)
+    osalSysHalt("USB packet memory exhausted");
+  return &_usbb[offset];
 }
 /*===========================================================================*/
 /* Driver local functions.                                                   */
 /*===========================================================================*/
 
-/* Called from locked ISR. */
-void usb_packet_transmit(USBDriver *usbp, usbep_t ep, size_t n)
+/* Called from locked ISR.
+ * Hands the pending packets to the free TX buffers. Bulk endpoints keep
+ * both EVEN and ODD buffers busy so the next packet is already in the BDT
+ * when the host polls again, the other endpoints keep one packet in flight.
+ */
+void usb_packet_transmit(USBDriver *usbp, usbep_t ep)
 {
   const USBEndpointConfig *epc = usbp->epc[ep];
   USBInEndpointState *isp = epc->in_state;
-
-  bd_t *bd = (bd_t *)&_bdt[BDT_INDEX(ep, TX, isp->odd_even)];
-
-  if (n > (size_t)epc->in_maxsize)
-    n = (size_t)epc->in_maxsize;
-
-  /* Copy from buf to _usbb[] */
-  size_t i=0;
-  for(i=0;i<n;i++)
-    bd->addr[i] = isp->txbuf[i];
-
-  /* Update the Buffer status */
-  bd->desc = BDT_DESC(n, isp->data_bank);
-  /* Toggle the odd and data bits for next TX */
-  isp->data_bank ^= DATA1;
-  isp->odd_even ^= ODD;
+  const bool dbl = (epc->ep_mode & USB_EP_MODE_TYPE) == USB_EP_MODE_TYPE_BULK;
+
+  while ((isp->txpkts > 0) &&
+         (dbl ? !usbPingPongIsFullX(&isp->txpp) :
+                usbPingPongIsEmptyX(&isp->txpp))) {
+    size_t n = isp->txsize - isp->txqueued;
+    if (n > (size_t)epc->in_maxsize)
+      n = (size_t)epc->in_maxsize;
+
+    bd_t *bd = (bd_t *)&_bdt[BDT_INDEX(ep, TX, usbPingPongArmX(&isp->txpp))];
+
+    /* Copy from buf to _usbb[] */
+    usbEpbufCopy(bd->addr, isp->txbuf + isp->txqueued, n);
+
+    /* Update the Buffer status */
+    bd->desc = BDT_DESC(n, isp->data_bank);
+    /* Toggle the data bit for next TX */
+    isp->data_bank ^= DATA1;
+    isp->txqueued += n;
+    isp->txpkts--;
+  }
 }
 
 /* Called from locked ISR. */
@@ -186,9 +195,7 @@ void usb_packet_receive(USBDriver *usbp, usbep_t ep, size_t n)
     n = (size_t)epc->out_maxsize;
 
   /* Copy from _usbb[] to buf  */
-  size_t i=0;
-  for(i=0;i<n;i++)
-    osp->rxbuf[i] = bd->addr[i];
+  usbEpbufCopy(osp->rxbuf, bd->addr, n);
 
   /* Update the Buffer status
    * Set current buffer to same DATA bank and then toggle.
@@ -268,15 +275,15 @@ OSAL_IRQ_HANDLER(KINETIS_USB_IRQ_VECTOR) {
           usbp->state = USB_SELECTED;
         }
         uint16_t txed = BDT_BC(bd->desc);
+        usbPingPongCompleteX(&epc->in_state->txpp, odd_even);
         epc->in_state->txcnt += txed;
-        if(epc->in_state->txcnt < epc->in_state->txsize)
+        if(epc->in_state->txpkts > 0)
         {
-          epc->in_state->txbuf += txed;
           osalSysLockFromISR();
-          usb_packet_transmit(usbp,ep,epc->in_state->txsize - epc->in_state->txcnt);
+          usb_packet_transmit(usbp,ep);
           osalSysUnlockFromISR();
         }
-        else
+        else if(usbPingPongIsEmptyX(&epc->in_state->txpp))
         {
           _usb_isr_invoke_in_cb(usbp,ep);
         }
@@ -549,8 +556,7 @@ void usb_lld_stop(USBDriver *usbp) {
  * @notapi
  */
 void usb_lld_reset(USBDriver *usbp) {
-  // FIXME, dyn alloc
-  _usbbn = 0;
+  usbEpbufPoolInit(&_usbpool, 0, sizeof(_usbb), 4);
 
 #if KINETIS_USB_USE_USB0
 
@@ -560,6 +566,7 @@ void usb_lld_reset(USBDriver *usbp) {
   /* EP0 initialization.*/
   usbp->epc[0] = &ep0config;
   usb_lld_init_endpoint(usbp, 0);
+  usbEpbufPoolSetMarkX(&_usbpool);
 
   /* Clear all pending interrupts */
   USB0->ERRSTAT = 0xFF;
@@ -630,7 +637,8 @@ void usb_lld_init_endpoint(USBDriver *usbp, usbep_t ep) {
   if(epc->in_state != NULL)
   {
     /* IN Endpoint */
-    epc->in_state->odd_even = EVEN;
+    usbPingPongResetX(&epc->in_state->txpp, EVEN);
+    epc->in_state->txpkts = 0;
     epc->in_state->data_bank = DATA0;
     /* TXe, not used yet */
     _bdt[BDT_INDEX(ep, TX, EVEN)].desc = 0;
@@ -668,6 +676,8 @@ void usb_lld_disable_endpoints(USBDriver *usbp) {
   for(i=1;i<KINETIS_USB_ENDPOINTS;i++)
     USB0->ENDPT[i].V = 0;
 #endif /* KINETIS_USB_USE_USB0 */
+  /* Buffers of the disabled endpoints are given back, EP0 keeps its own.*/
+  usbEpbufPoolRewindX(&_usbpool);
 }
 
 /**
@@ -760,8 +770,19 @@ void usb_lld_read_setup(USBDriver *usbp, usbep_t ep, uint8_t *buf) {
     bd_t *bd_next = (bd_t*)&_bdt[BDT_INDEX(ep, RX, os->odd_even^ODD)];
     bd_next->desc = BDT_DESC(usbp->epc[ep]->out_maxsize,DATA1);
   }
+  /* A SETUP aborts the IN data stage, the buffers not sent yet are
+   * reclaimed and the next one armed is the one the SIE expects.
+   */
+  USBInEndpointState *isp = usbp->epc[ep]->in_state;
+  if (!usbPingPongIsEmptyX(&isp->txpp))
+  {
+    _bdt[BDT_INDEX(ep, TX, EVEN)].desc = 0;
+    _bdt[BDT_INDEX(ep, TX,  ODD)].desc = 0;
+    usbPingPongFlushX(&isp->txpp);
+  }
+  isp->txpkts = 0;
   /* After a SETUP, both in and out are always DATA1 */
-  usbp->epc[ep]->in_state->data_bank = DATA1;
+  isp->data_bank = DATA1;
   os->data_bank = DATA1;
 }
 
@@ -809,7 +830,14 @@ void usb_lld_start_in(USBDriver *usbp, usbep_t ep) {
     bd_next->desc = BDT_DESC(usbp->epc[ep]->out_maxsize,DATA0);
     epc->out_state->data_bank = DATA0;
   }
-  usb_packet_transmit(usbp,ep,usbp->epc[ep]->in_state->txsize);
+  USBInEndpointState *isp = usbp->epc[ep]->in_state;
+  isp->txqueued = 0;
+  if (isp->txsize == 0)         /* Special case for zero sized packets.*/
+    isp->txpkts = 1;
+  else
+    isp->txpkts = (uint16_t)((isp->txsize + usbp->epc[ep]->in_maxsize - 1) /
+                             usbp->epc[ep]->in_maxsize);
+  usb_packet_transmit(usbp,ep);
 }
 
 /**
@@ -28,6 +28,8 @@
 
 #if HAL_USE_USB || defined(__DOXYGEN__)
 
+#include "usb_epbuf.h"
+
 /*===========================================================================*/
 /* Driver constants.                                                         */
 /*===========================================================================*/
@@ -76,6 +78,18 @@
   #define KINETIS_USB_ENDPOINTS USB_MAX_ENDPOINTS+1
 #endif
 
+/**
+ * @brief   Size of the packet buffers area.
+ * @details Each enabled endpoint direction takes two buffers of its
+ *          maximum packet size, EVEN and ODD.
+ * @note    The default fits 64 bytes buffers for both directions of all
+ *          the @p KINETIS_USB_ENDPOINTS endpoints, it can be lowered to
+ *          what the application configurations actually use.
+ */
+#if !defined(KINETIS_USB_PACKET_MEMORY_SIZE) || defined(__DOXYGEN__)
+#define KINETIS_USB_PACKET_MEMORY_SIZE      ((KINETIS_USB_ENDPOINTS) * 2 * 2 * 64)
+#endif
+
 /**
  * @brief   Host wake-up procedure duration.
  */
@@ -135,8 +149,18 @@ typedef struct {
   thread_reference_t            thread;
 #endif
   /* End of the mandatory fields.*/
-  /* */
-  bool                          odd_even;  /* ODD / EVEN */
+  /**
+   * @brief   Bytes handed to the BDT so far.
+   */
+  size_t                        txqueued;
+  /**
+   * @brief   Number of packets still to be handed to the BDT.
+   */
+  uint16_t                      txpkts;
+  /**
+   * @brief   EVEN/ODD TX buffers state.
+   */
+  usb_pingpong_t                txpp;
   /* */
   bool                          data_bank; /* DATA0 / DATA1 */
 } USBInEndpointState;
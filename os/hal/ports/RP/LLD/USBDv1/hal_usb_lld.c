@@ -44,6 +44,24 @@
  * @brief   Get buffer control register for endpoint.
  */
 #define BUF_CTRL(ep)      (USB_DPSRAM->BUFCTRL[ep])
+/**
+ * @brief   Access one half of a buffer control register.
+ * @note    The halves are accessed with 16 bits accesses so that the other
+ *          buffer, which may be in use by the controller, is not touched.
+ */
+#define BUF_CTRL_HALF(reg, n) (((volatile uint16_t *)&(reg))[n])
+/**
+ * @brief   Endpoint is isochronous.
+ */
+#define EP_IS_ISOC(epcp)  ((epcp)->ep_mode == USB_EP_MODE_TYPE_ISOC)
+/**
+ * @brief   DPSRAM allocation unit, also the required buffer alignment.
+ */
+#define DPSRAM_BLOCK_SIZE 64U
+/**
+ * @brief   Number of allocation units in the DPSRAM data area.
+ */
+#define DPSRAM_BLOCKS     (sizeof(((USB_DPSRAM_TypeDef *)0)->DATA) / DPSRAM_BLOCK_SIZE)
 
 /*===========================================================================*/
 /* Driver exported variables.                                                */
@@ -130,15 +148,55 @@ static uint16_t usb_isochronous_buffer_size(uint16_t max_size) {
 }
 
 /**
- * @brief   Calculate next offset for buffer data, 64 bytes aligned.
+ * @brief   Allocates a DPSRAM area, first fit.
+ *
+ * @param[in] usbp      pointer to the @p USBDriver object
+ * @param[in] size      size of the area in bytes
+ * @return              The first allocated block or -1 if there is no space.
  */
-static uint16_t usb_buffer_next_offset(USBDriver *usbp, uint16_t size, bool is_double) {
-  uint32_t offset;
+static int32_t usb_dpsram_alloc(USBDriver *usbp, uint16_t size) {
+  uint32_t count = (size + DPSRAM_BLOCK_SIZE - 1U) / DPSRAM_BLOCK_SIZE;
+  uint64_t mask = (1ULL << count) - 1U;
+
+  for (uint32_t first = 0; first + count <= DPSRAM_BLOCKS; first++) {
+    if ((usbp->dpsram_map & (mask << first)) == 0U) {
+      usbp->dpsram_map |= mask << first;
+      return (int32_t)first;
+    }
+  }
+
+  return -1;
+}
+
+/**
+ * @brief   Releases all the endpoint buffers.
+ */
+static void usb_dpsram_reset(USBDriver *usbp) {
+  usbp->dpsram_map = 0U;
+  memset(usbp->dpsram_ep, 0, sizeof(usbp->dpsram_ep));
+}
+
+/**
+ * @brief   Allocates the hardware buffers of an endpoint direction.
+ * @details The area previously owned by the endpoint, if any, is reclaimed
+ *          first, so re-initializing an endpoint does not leak DPSRAM.
+ */
+static uint8_t *usb_buffer_alloc(USBDriver *usbp, usbep_t ep, bool is_in, uint16_t size) {
+  usb_dpsram_area_t *areap = &usbp->dpsram_ep[ep - 1][is_in ? 0 : 1];
+  int32_t first;
+
+  if (areap->count > 0U) {
+    usbp->dpsram_map &= ~(((1ULL << areap->count) - 1U) << areap->first);
+    areap->count = 0U;
+  }
+
+  first = usb_dpsram_alloc(usbp, size);
+  osalDbgAssert(first >= 0, "DPSRAM exhausted");
 
-  offset = usbp->noffset;
-  usbp->noffset += is_double ? size * 2 : size;
+  areap->first = (uint8_t)first;
+  areap->count = (uint8_t)((size + DPSRAM_BLOCK_SIZE - 1U) / DPSRAM_BLOCK_SIZE);
 
-  return offset;
+  return (uint8_t *)&USB_DPSRAM->DATA[first * DPSRAM_BLOCK_SIZE];
 }
 
 /**
@@ -152,33 +210,35 @@ static void reset_ep0(USBDriver *usbp) {
 /**
  * @brief   Prepare buffer for receiving data.
  */
-uint32_t usb_prepare_out_ep_buffer(USBDriver *usbp, usbep_t ep, uint8_t buffer_index) {
+static uint32_t usb_prepare_out_ep_buffer(USBDriver *usbp, usbep_t ep) {
     uint32_t buf_ctrl = 0;
     const USBEndpointConfig *epcp = usbp->epc[ep];
     USBOutEndpointState *oesp = usbp->epc[ep]->out_state;
 
-    /* PID */
+    /* PID, isochronous endpoints always use DATA0 */
     buf_ctrl |= oesp->next_pid ? USB_BUFFER_BUFFER0_DATA_PID : 0;
-    oesp->next_pid ^= 1U;
+    if (!EP_IS_ISOC(epcp)) {
+      oesp->next_pid ^= 1U;
+    }
 
     uint16_t buf_len = oesp->rxsize < epcp->out_maxsize ? oesp->rxsize : epcp->out_maxsize;
     buf_ctrl |= USB_BUFFER_BUFFER0_AVAILABLE | buf_len;
-    buf_ctrl &= ~USB_BUFFER_BUFFER0_FULL;
 
-    if (oesp->rxcnt + buf_len >= oesp->rxsize) {
+    if (oesp->rxpkts == 1U) {
         /* Last buffer */
         buf_ctrl |= USB_BUFFER_BUFFER0_LAST;
     }
 
-    if (buffer_index) {
-      buf_ctrl = buf_ctrl << 16;
-    }
+    oesp->armed = 1U;
 
     return buf_ctrl;
 }
 
 /**
  * @brief   Prepare for receiving data from host.
+ * @details OUT endpoints are single buffered: with a second buffer armed,
+ *          the first packet of the next transfer could be acknowledged
+ *          after a short packet, before the current transfer ends.
  */
 static void usb_prepare_out_ep(USBDriver *usbp, usbep_t ep) {
   uint32_t buf_ctrl;
@@ -191,9 +251,8 @@ static void usb_prepare_out_ep(USBDriver *usbp, usbep_t ep) {
   }
 
   /* Fill first buffer */
-  buf_ctrl = usb_prepare_out_ep_buffer(usbp, ep, 0);
+  buf_ctrl = usb_prepare_out_ep_buffer(usbp, ep);
 
-  /* To avoid short packet, we use single buffered here. */
   /* Single buffered */
   ep_ctrl &= ~(USB_EP_BUFFER_DOUBLE | USB_EP_BUFFER_IRQ_DOUBLE_EN);
   ep_ctrl |= USB_EP_BUFFER_IRQ_EN;
@@ -209,11 +268,12 @@ static void usb_prepare_out_ep(USBDriver *usbp, usbep_t ep) {
 
 /**
  * @brief   Prepare buffer for sending data.
+ * @return              The buffer control register half for the buffer.
  */
-static uint32_t usb_prepare_in_ep_buffer(USBDriver *usbp, usbep_t ep, uint8_t buffer_index) {
+static uint16_t usb_prepare_in_ep_buffer(USBDriver *usbp, usbep_t ep, uint8_t buffer_index) {
     uint8_t *buff;
     uint16_t buf_len;
-    uint32_t buf_ctrl = 0;
+    uint16_t buf_ctrl = 0;
     const USBEndpointConfig *epcp = usbp->epc[ep];
     USBInEndpointState *iesp = usbp->epc[ep]->in_state;
 
@@ -229,9 +289,11 @@ static uint32_t usb_prepare_in_ep_buffer(USBDriver *usbp, usbep_t ep, uint8_t bu
       buf_ctrl |= USB_BUFFER_BUFFER0_LAST;
     }
 
-    /* PID */
+    /* PID, isochronous endpoints always use DATA0 */
     buf_ctrl |= iesp->next_pid ? USB_BUFFER_BUFFER0_DATA_PID : 0;
-    iesp->next_pid ^= 1U;
+    if (!EP_IS_ISOC(epcp)) {
+      iesp->next_pid ^= 1U;
+    }
 
     /* Copy data into hardware buffer */
     buff = (uint8_t*)iesp->hw_buf + (buffer_index == 0 ? 0 : iesp->buf_size);
@@ -242,21 +304,29 @@ static uint32_t usb_prepare_in_ep_buffer(USBDriver *usbp, usbep_t ep, uint8_t bu
                 USB_BUFFER_BUFFER0_AVAILABLE |
                 buf_len;
 
-    if (buffer_index) {
-      buf_ctrl = buf_ctrl << 16;
+    if (buffer_index && EP_IS_ISOC(epcp)) {
+      buf_ctrl |= usb_isochronous_buffer_mode(iesp->buf_size) <<
+                  (USB_BUFFER_DOUBLE_BUFFER_OFFSET_Pos - 16U);
     }
 
+    iesp->armed++;
+
     return buf_ctrl;
 }
 
 /**
  * @brief   Prepare endpoint for sending data.
+ * @details Transfers of two or more packets use both buffers, each one is
+ *          filled again as soon as its packet has been sent.
  */
 static void usb_prepare_in_ep(USBDriver *usbp, usbep_t ep) {
   uint32_t buf_ctrl;
   uint32_t ep_ctrl;
   USBInEndpointState *iesp = usbp->epc[ep]->in_state;
 
+  iesp->armed    = 0U;
+  iesp->next_buf = 0U;
+
   if (ep == 0) {
     ep_ctrl = USB->SIECTRL;
   } else {
@@ -266,20 +336,14 @@ static void usb_prepare_in_ep(USBDriver *usbp, usbep_t ep) {
   /* Fill first buffer */
   buf_ctrl = usb_prepare_in_ep_buffer(usbp, ep, 0);
 
-  /* Second buffer if required */
+  ep_ctrl &= ~(USB_EP_BUFFER_DOUBLE | USB_EP_BUFFER_IRQ_DOUBLE_EN);
+  ep_ctrl |= USB_EP_BUFFER_IRQ_EN;
   /* iesp->txsize - iesp->txlast gives size even not in buffer */
-  if (iesp->txsize - iesp->txlast > 0) {
-    buf_ctrl |= usb_prepare_in_ep_buffer(usbp, ep, 1);
-  }
-
-  if (buf_ctrl & USB_BUFFER_BUFFER1_AVAILABLE) {
-    /* Double buffered */
-    ep_ctrl &= ~USB_EP_BUFFER_IRQ_EN;
-    ep_ctrl |= USB_EP_BUFFER_DOUBLE | USB_EP_BUFFER_IRQ_DOUBLE_EN;
-  } else {
-    /* Single buffered */
-    ep_ctrl &= ~(USB_EP_BUFFER_DOUBLE | USB_EP_BUFFER_IRQ_DOUBLE_EN);
-    ep_ctrl |= USB_EP_BUFFER_IRQ_EN;
+  if ((ep != 0) && (iesp->txsize - iesp->txlast > 0)) {
+    /* Double buffered, an interrupt per buffer */
+    buf_ctrl |= (uint32_t)usb_prepare_in_ep_buffer(usbp, ep, 1) << 16;
+    buf_ctrl |= USB_BUFFER_RESET_BUFFER;
+    ep_ctrl |= USB_EP_BUFFER_DOUBLE;
   }
 
   if (ep == 0) {
@@ -293,35 +357,71 @@ static void usb_prepare_in_ep(USBDriver *usbp, usbep_t ep) {
 
 /**
  * @brief   Work on an endpoint after transfer.
+ * @details The controller uses the buffers of a double buffered endpoint
+ *          alternately. A single status bit may cover both buffers, so all
+ *          the buffers released by the controller are served here.
  */
 static void usb_serve_endpoint(USBDriver *usbp, usbep_t ep, bool is_in) {
   const USBEndpointConfig *epcp = usbp->epc[ep];
   USBOutEndpointState *oesp;
   USBInEndpointState *iesp;
+  uint16_t buf_ctrl;
+  uint8_t idx;
+  bool is_double;
   uint16_t n;
 
   if (is_in) {
     /* IN endpoint */
     iesp = usbp->epc[ep]->in_state;
+    is_double = (ep != 0) && ((EP_CTRL(ep).IN & USB_EP_BUFFER_DOUBLE) != 0U);
+
+    while (iesp->armed > 0U) {
+      idx = iesp->next_buf;
+      buf_ctrl = BUF_CTRL_HALF(BUF_CTRL(ep).IN, idx);
+      if (buf_ctrl & USB_BUFFER_BUFFER0_AVAILABLE) {
+        /* Still owned by the controller */
+        break;
+      }
+      iesp->armed--;
+      iesp->txcnt += buf_ctrl & USB_BUFFER_BUFFER0_TRANS_LENGTH_Msk;
+
+      if (is_double) {
+        iesp->next_buf ^= 1U;
+        if (iesp->txsize - iesp->txlast > 0) {
+          /* More packets to send, refill the released buffer. */
+          BUF_CTRL_HALF(BUF_CTRL(ep).IN, idx) = usb_prepare_in_ep_buffer(usbp, ep, idx);
+        }
+      }
 
-    /* txlast is size sent + size of last buffer */
-    iesp->txcnt = iesp->txlast;
-    n = iesp->txsize - iesp->txcnt;
-    if (n > 0) {
-      /* Transfer not completed, there are more packets to send. */
-      usb_prepare_in_ep(usbp, ep);
-    } else {
-      /* Transfer complete */
-      _usb_isr_invoke_in_cb(usbp, ep);
+      if (iesp->armed == 0U) {
+        if (iesp->txsize - iesp->txcnt > 0) {
+          /* Transfer not completed, there are more packets to send. */
+          usb_prepare_in_ep(usbp, ep);
+        } else {
+          /* Transfer complete */
+          _usb_isr_invoke_in_cb(usbp, ep);
+        }
+        return;
+      }
     }
   } else {
     /* OUT endpoint */
     oesp = usbp->epc[ep]->out_state;
 
+    buf_ctrl = BUF_CTRL(ep).OUT;
+    if ((oesp->armed == 0U) || (buf_ctrl & USB_BUFFER_BUFFER0_AVAILABLE)) {
+      /* Spurious or still owned by the controller */
+      return;
+    }
+    oesp->armed = 0U;
+
     /* Length received */
-    n = BUF_CTRL(ep).OUT & USB_BUFFER_BUFFER0_TRANS_LENGTH_Msk;
+    n = buf_ctrl & USB_BUFFER_BUFFER0_TRANS_LENGTH_Msk;
 
     /* Copy received data into user buffer */
+    if (n > oesp->rxsize) {
+      n = oesp->rxsize;
+    }
     memcpy((void *)oesp->rxbuf, (void *)oesp->hw_buf, n);
     oesp->rxbuf += n;
     oesp->rxcnt += n;
@@ -446,8 +546,8 @@ void usb_lld_init(void) {
   /* Driver initialization.*/
   usbObjectInit(&USBD1);
 
-  /* Reset buffer offset. */
-  USBD1.noffset = 0;
+  /* No endpoint buffers allocated. */
+  usb_dpsram_reset(&USBD1);
 #endif
 }
 
@@ -556,7 +656,7 @@ void usb_lld_reset(USBDriver *usbp) {
     USB->DEVADDRCTRL = 0U;
 
     /* Reset USB memory */
-    usbp->noffset = 0U;
+    usb_dpsram_reset(usbp);
 
     /* Clear all non control endpoint registers */
     for (int ep = 1; ep < USB_MAX_ENDPOINTS; ep++) {
@@ -589,7 +689,6 @@ void usb_lld_set_address(USBDriver *usbp) {
  */
 void usb_lld_init_endpoint(USBDriver *usbp, usbep_t ep) {
     uint16_t                 buf_size;
-    uint16_t                 buf_offset;
     uint32_t                 buf_ctrl;
     const USBEndpointConfig *epcp = usbp->epc[ep];
 
@@ -597,9 +696,11 @@ void usb_lld_init_endpoint(USBDriver *usbp, usbep_t ep) {
         epcp->in_state->hw_buf    = (uint8_t *)&USB_DPSRAM->EP0BUF0;
         epcp->in_state->buf_size  = 64;
         epcp->in_state->next_pid  = 0U;
+        epcp->in_state->armed     = 0U;
         epcp->out_state->hw_buf   = (uint8_t *)&USB_DPSRAM->EP0BUF0;
         epcp->out_state->buf_size = 64;
         epcp->out_state->next_pid = 0U;
+        epcp->out_state->armed    = 0U;
         USB->SET.SIECTRL          = USB_EP_BUFFER_IRQ_EN;
         return;
     }
@@ -608,15 +709,16 @@ void usb_lld_init_endpoint(USBDriver *usbp, usbep_t ep) {
         buf_ctrl                 = 0U;
         BUF_CTRL(ep).IN          = buf_ctrl;
         epcp->in_state->next_pid = 0U;
+        epcp->in_state->armed    = 0U;
 
-        if (epcp->ep_mode == USB_EP_MODE_TYPE_ISOC) {
+        if (EP_IS_ISOC(epcp)) {
             buf_size = usb_isochronous_buffer_size(epcp->in_maxsize);
             buf_ctrl |= usb_isochronous_buffer_mode(buf_size) << USB_BUFFER_DOUBLE_BUFFER_OFFSET_Pos;
         } else {
             buf_size = 64;
         }
-        buf_offset               = usb_buffer_next_offset(usbp, buf_size, true);
-        epcp->in_state->hw_buf   = (uint8_t *)&USB_DPSRAM->DATA[buf_offset];
+        /* Space for both buffers */
+        epcp->in_state->hw_buf   = usb_buffer_alloc(usbp, ep, true, buf_size * 2U);
         epcp->in_state->buf_size = buf_size;
 
         EP_CTRL(ep).IN  = USB_EP_EN | (epcp->ep_mode << USB_EP_TYPE_Pos) | ((uint8_t *)epcp->in_state->hw_buf - (uint8_t *)USB_DPSRAM);
@@ -627,15 +729,16 @@ void usb_lld_init_endpoint(USBDriver *usbp, usbep_t ep) {
         buf_ctrl                  = 0U;
         BUF_CTRL(ep).OUT          = buf_ctrl;
         epcp->out_state->next_pid = 0U;
+        epcp->out_state->armed    = 0U;
 
-        if (epcp->ep_mode == USB_EP_MODE_TYPE_ISOC) {
-            buf_size = usb_isochronous_buffer_size(epcp->in_maxsize);
+        if (EP_IS_ISOC(epcp)) {
+            buf_size = usb_isochronous_buffer_size(epcp->out_maxsize);
             buf_ctrl |= usb_isochronous_buffer_mode(buf_size) << USB_BUFFER_DOUBLE_BUFFER_OFFSET_Pos;
         } else {
             buf_size = 64;
         }
-        buf_offset                = usb_buffer_next_offset(usbp, buf_size, false);
-        epcp->out_state->hw_buf   = (uint8_t *)&USB_DPSRAM->DATA[buf_offset];
+        /* Single buffered, see usb_prepare_out_ep() */
+        epcp->out_state->hw_buf   = usb_buffer_alloc(usbp, ep, false, buf_size);
         epcp->out_state->buf_size = buf_size;
 
         EP_CTRL(ep).OUT  = USB_EP_EN | (epcp->ep_mode << USB_EP_TYPE_Pos) | ((uint8_t *)epcp->out_state->hw_buf - (uint8_t *)USB_DPSRAM);
@@ -655,6 +758,9 @@ void usb_lld_disable_endpoints(USBDriver *usbp) {
     EP_CTRL(ep).IN &= ~USB_EP_EN;
     EP_CTRL(ep).OUT &= ~USB_EP_EN;
   }
+
+  /* The buffers are reclaimed, the next configuration allocates again. */
+  usb_dpsram_reset(usbp);
 }
 
 /**
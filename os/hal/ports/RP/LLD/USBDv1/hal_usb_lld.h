@@ -143,6 +143,14 @@ typedef struct {
    * @brief   Buffer size.
    */
   uint16_t                      buf_size;
+  /**
+   * @brief   Buffers handed to the controller.
+   */
+  uint8_t                       armed;
+  /**
+   * @brief   Buffer the controller releases next.
+   */
+  uint8_t                       next_buf;
 } USBInEndpointState;
 
 /**
@@ -184,8 +192,26 @@ typedef struct {
    * @brief   Buffer size.
    */
   uint16_t                      buf_size;
+  /**
+   * @brief   Buffers handed to the controller.
+   */
+  uint8_t                       armed;
 } USBOutEndpointState;
 
+/**
+ * @brief   DPSRAM area owned by an endpoint direction.
+ */
+typedef struct {
+  /**
+   * @brief   First 64 bytes block.
+   */
+  uint8_t                       first;
+  /**
+   * @brief   Number of blocks, zero if none.
+   */
+  uint8_t                       count;
+} usb_dpsram_area_t;
+
 /**
  * @brief   Type of an USB endpoint configuration structure.
  * @note    Platform specific restrictions may apply to endpoints.
@@ -347,9 +373,13 @@ struct USBDriver {
 #endif
   /* End of the mandatory fields.*/
   /**
-   * @brief   Next offset of buffer.
+   * @brief   DPSRAM allocation map, a bit per 64 bytes block.
+   */
+  uint64_t                      dpsram_map;
+  /**
+   * @brief   DPSRAM areas of the endpoints, IN and OUT.
    */
-  uint16_t                      noffset;
+  usb_dpsram_area_t             dpsram_ep[USB_MAX_ENDPOINTS][2];
 };
 
 /*===========================================================================*/
@@ -1,3 +1,5 @@
-PLATFORMSRC += $(CHIBIOS_CONTRIB)/os/hal/ports/SN32/LLD/SN32F2xx/USB/hal_usb_lld.c
+PLATFORMSRC += $(CHIBIOS_CONTRIB)/os/hal/ports/SN32/LLD/SN32F2xx/USB/hal_usb_lld.c \
+               $(CHIBIOS_CONTRIB)/os/hal/ports/common/USB-EPBUF/usb_epbuf.c
 
-PLATFORMINC += $(CHIBIOS_CONTRIB)/os/hal/ports/SN32/LLD/SN32F2xx/USB
+PLATFORMINC += $(CHIBIOS_CONTRIB)/os/hal/ports/SN32/LLD/SN32F2xx/USB \
+               $(CHIBIOS_CONTRIB)/os/hal/ports/common/USB-EPBUF
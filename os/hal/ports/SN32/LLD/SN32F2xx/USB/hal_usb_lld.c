@@ -100,7 +100,7 @@ static void usb_pm_reset(USBDriver *usbp) {
 
   /* The first 64 bytes are reserved for the descriptors table. The effective
      available RAM for endpoint buffers is just 192/448 bytes.*/
-  usbp->pmnext = 64;
+  usbEpbufPoolInit(&usbp->pm, 64, SN32_USB_PMA_SIZE, 2);
 }
 
 /**
@@ -111,12 +111,13 @@ static void usb_pm_reset(USBDriver *usbp) {
  * @return              The packet buffer address.
  */
 static uint32_t usb_pm_alloc(USBDriver *usbp, size_t size) {
-  uint32_t next;
+  size_t next;
 
-  next = usbp->pmnext;
-  usbp->pmnext += (size + 1) & ~1;
-  osalDbgAssert(usbp->pmnext <= SN32_USB_PMA_SIZE, "PMA overflow");
-  return next;
+  next = usbEpbufPoolAlloc(&usbp->pm, size);
+  if (next == USB_EPBUF_INVALID) {
+    osalSysHalt("PMA overflow");
+  }
+  return (uint32_t)next;
 }
 
 static void sn32_usb_read_fifo(usbep_t ep, uint8_t *buf, size_t sz, bool intr) {
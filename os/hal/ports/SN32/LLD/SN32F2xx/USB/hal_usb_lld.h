@@ -27,6 +27,8 @@
 
 #if (HAL_USE_USB == TRUE) || defined(__DOXYGEN__)
 
+#include "usb_epbuf.h"
+
 #include "sn32_usb.h"
 
 /*===========================================================================*/
@@ -332,9 +334,9 @@ struct USBDriver {
 #endif
   /* End of the mandatory fields.*/
   /**
-   * @brief   Pointer to the next address in the packet memory.
+   * @brief   Packet memory allocator.
    */
-  uint32_t                      pmnext;
+  usb_epbuf_pool_t              pm;
 };
 
 /*===========================================================================*/
@@ -50,27 +50,64 @@ DMA2DDriver DMA2DD1;
 /* Driver local variables and types.                                         */
 /*===========================================================================*/
 
-/**
- * @brief   Bits per pixel lookup table.
- */
-static const uint8_t dma2d_bpp[DMA2D_MAX_PIXFMT_ID + 1] = {
-  32,  /* DMA2D_FMT_ARGB8888 */
-  24,  /* DMA2D_FMT_RGB888 */
-  16,  /* DMA2D_FMT_RGB565 */
-  16,  /* DMA2D_FMT_ARGB1555 */
-  16,  /* DMA2D_FMT_ARGB4444 */
-   8,  /* DMA2D_FMT_L8 */
-   8,  /* DMA2D_FMT_AL44 */
-  16,  /* DMA2D_FMT_AL88 */
-   4,  /* DMA2D_FMT_L4 */
-   8,  /* DMA2D_FMT_A8 */
-   4   /* DMA2D_FMT_A4 */
-};
-
 /*===========================================================================*/
 /* Driver local functions.                                                   */
 /*===========================================================================*/
 
+#if DMA2D_USE_COMMAND_LISTS || defined(__DOXYGEN__)
+
+/**
+ * @brief   Programs the registers of a recorded job.
+ * @note    The job must have been validated when recorded.
+ *
+ * @param[in] jobp      pointer to the @p dma2d_job_t object
+ *
+ * @notapi
+ */
+static void dma2d_job_program(const dma2d_job_t *jobp) {
+
+  DMA2D->CR = ((DMA2D->CR & ~DMA2D_CR_MODE) |
+               ((uint32_t)jobp->mode & DMA2D_CR_MODE));
+  DMA2D->NLR = ((((uint32_t)jobp->width << 16) & DMA2D_NLR_PL) |
+                ((uint32_t)jobp->height & DMA2D_NLR_NL));
+
+  DMA2D->OMAR = (uint32_t)jobp->out.bufferp;
+  DMA2D->OOR = (uint32_t)jobp->out.wrap_offset & DMA2D_OOR_LO;
+  DMA2D->OPFCCR = ((DMA2D->OPFCCR & ~DMA2D_OPFCCR_CM) |
+                   ((uint32_t)jobp->out.fmt & DMA2D_OPFCCR_CM));
+
+  if (jobp->mode == DMA2D_JOB_CONST) {
+    /* The fill color is the raw output format value, alpha included.*/
+    DMA2D->OCOLR = (uint32_t)jobp->out.def_color;
+    return;
+  }
+
+  DMA2D->FGMAR = (uint32_t)jobp->fg.bufferp;
+  DMA2D->FGOR = (uint32_t)jobp->fg.wrap_offset & DMA2D_FGOR_LO;
+  DMA2D->FGPFCCR = ((DMA2D->FGPFCCR & ~(DMA2D_FGPFCCR_CM | DMA2D_FGPFCCR_AM |
+                                        DMA2D_FGPFCCR_ALPHA)) |
+                    ((uint32_t)jobp->fg.fmt & DMA2D_FGPFCCR_CM) |
+                    ((uint32_t)jobp->fg_amode & DMA2D_FGPFCCR_AM) |
+                    (((uint32_t)jobp->fg.const_alpha << 24) &
+                     DMA2D_FGPFCCR_ALPHA));
+  DMA2D->FGCOLR = (uint32_t)jobp->fg.def_color & 0x00FFFFFF;
+
+  if (jobp->mode == DMA2D_JOB_BLEND) {
+    DMA2D->BGMAR = (uint32_t)jobp->bg.bufferp;
+    DMA2D->BGOR = (uint32_t)jobp->bg.wrap_offset & DMA2D_BGOR_LO;
+    DMA2D->BGPFCCR = ((DMA2D->BGPFCCR & ~(DMA2D_BGPFCCR_CM |
+                                          DMA2D_BGPFCCR_AM |
+                                          DMA2D_BGPFCCR_ALPHA)) |
+                      ((uint32_t)jobp->bg.fmt & DMA2D_BGPFCCR_CM) |
+                      ((uint32_t)jobp->bg_amode & DMA2D_BGPFCCR_AM) |
+                      (((uint32_t)jobp->bg.const_alpha << 24) &
+                       DMA2D_BGPFCCR_ALPHA));
+    DMA2D->BGCOLR = (uint32_t)jobp->bg.def_color & 0x00FFFFFF;
+  }
+}
+
+#endif  /* DMA2D_USE_COMMAND_LISTS */
+
 /*===========================================================================*/
 /* Driver exported functions.                                                */
 /*===========================================================================*/
@@ -90,6 +127,10 @@ OSAL_IRQ_HANDLER(STM32_DMA2D_HANDLER) {
   DMA2DDriver *const dma2dp = &DMA2DD1;
   bool job_done = false;
   thread_t *tp = NULL;
+#if DMA2D_USE_COMMAND_LISTS
+  bool job_error = false;
+  dma2d_cmdlist_t *listp;
+#endif  /* DMA2D_USE_COMMAND_LISTS */
 
   OSAL_IRQ_PROLOGUE();
 
@@ -98,6 +139,9 @@ OSAL_IRQ_HANDLER(STM32_DMA2D_HANDLER) {
     if (dma2dp->config->cfgerr_isr != NULL)
       dma2dp->config->cfgerr_isr(dma2dp);
     job_done = true;
+#if DMA2D_USE_COMMAND_LISTS
+    job_error = true;
+#endif  /* DMA2D_USE_COMMAND_LISTS */
     DMA2D->IFCR |= DMA2D_IFSR_CCEIF;
   }
 
@@ -114,6 +158,9 @@ OSAL_IRQ_HANDLER(STM32_DMA2D_HANDLER) {
     if (dma2dp->config->palacserr_isr != NULL)
       dma2dp->config->palacserr_isr(dma2dp);
     job_done = true;
+#if DMA2D_USE_COMMAND_LISTS
+    job_error = true;
+#endif  /* DMA2D_USE_COMMAND_LISTS */
     DMA2D->IFCR |= DMA2D_IFSR_CCAEIF;
   }
 
@@ -137,13 +184,37 @@ OSAL_IRQ_HANDLER(STM32_DMA2D_HANDLER) {
     if (dma2dp->config->trferr_isr != NULL)
       dma2dp->config->trferr_isr(dma2dp);
     job_done = true;
+#if DMA2D_USE_COMMAND_LISTS
+    job_error = true;
+#endif  /* DMA2D_USE_COMMAND_LISTS */
     DMA2D->IFCR |= DMA2D_IFSR_CTEIF;
   }
 
+#if DMA2D_USE_COMMAND_LISTS
+  if (job_done && !job_error) {
+    osalSysLockFromISR();
+    listp = dma2dp->listp;
+    if ((listp != NULL) && (++listp->index < listp->count)) {
+      /* Chaining the next job of the list, the driver stays active.*/
+      dma2d_job_program(&listp->jobsp[listp->index]);
+      DMA2D->CR |= DMA2D_CR_START;
+      job_done = false;
+    }
+    osalSysUnlockFromISR();
+  }
+#endif  /* DMA2D_USE_COMMAND_LISTS */
+
   if (job_done) {
     osalSysLockFromISR();
     osalDbgAssert(dma2dp->state == DMA2D_ACTIVE, "invalid state");
 
+  #if DMA2D_USE_COMMAND_LISTS
+    listp = dma2dp->listp;
+    dma2dp->listp = NULL;
+    if ((listp != NULL) && job_error)
+      listp->result = MSG_RESET;
+  #endif  /* DMA2D_USE_COMMAND_LISTS */
+
   #if DMA2D_USE_WAIT
     /* Wake the waiting thread up.*/
     if (dma2dp->thread != NULL) {
@@ -155,6 +226,12 @@ OSAL_IRQ_HANDLER(STM32_DMA2D_HANDLER) {
   #endif  /* DMA2D_USE_WAIT */
 
     dma2dp->state = DMA2D_READY;
+
+  #if DMA2D_USE_COMMAND_LISTS
+    /* Last, so that the callback can start another list.*/
+    if ((listp != NULL) && (listp->end_cb != NULL))
+      listp->end_cb(dma2dp, listp);
+  #endif  /* DMA2D_USE_COMMAND_LISTS */
     osalSysUnlockFromISR();
   }
 
@@ -211,6 +288,9 @@ void dma2dObjectInit(DMA2DDriver *dma2dp) {
   chSemObjectInit(&dma2dp->lock, 1);
 #endif
 #endif  /* (TRUE == DMA2D_USE_MUTUAL_EXCLUSION) */
+#if DMA2D_USE_COMMAND_LISTS
+  dma2dp->listp = NULL;
+#endif  /* DMA2D_USE_COMMAND_LISTS */
 }
 
 /**
@@ -1132,6 +1212,13 @@ void dma2dJobAbortI(DMA2DDriver *dma2dp) {
   osalDbgCheck((DMA2D->CR & DMA2D_CR_SUSP) == 0);
   osalDbgAssert(dma2dp->state >= DMA2D_READY, "invalid state");
 
+#if DMA2D_USE_COMMAND_LISTS
+  /* The remaining jobs of a running list are dropped.*/
+  if (dma2dp->listp != NULL) {
+    dma2dp->listp->result = MSG_RESET;
+    dma2dp->listp = NULL;
+  }
+#endif  /* DMA2D_USE_COMMAND_LISTS */
   dma2dp->state = DMA2D_READY;
   DMA2D->CR |= DMA2D_CR_ABORT;
 }
@@ -2876,254 +2963,123 @@ void dma2dOutSetConfig(DMA2DDriver *dma2dp, const dma2d_laycfg_t *cfgp) {
 
 /** @} */
 
+#if DMA2D_USE_COMMAND_LISTS || defined(__DOXYGEN__)
+
 /**
- * @name    DMA2D helper functions
+ * @name    DMA2D command list methods
  * @{
  */
 
 /**
- * @brief   Compute pixel address.
- * @details Computes the buffer address of a pixel, given the buffer
- *          specifications.
- *
- * @param[in] originp   buffer origin address
- * @param[in] pitch     buffer pitch, in bytes
- * @param[in] fmt       buffer pixel format
- * @param[in] x         horizontal pixel coordinate
- * @param[in] y         vertical pixel coordinate
- *
- * @return              pixel address, constant data
- *
- * @api
- */
-const void *dma2dComputeAddressConst(const void *originp, size_t pitch,
-                                     dma2d_pixfmt_t fmt,
-                                     uint16_t x, uint16_t y) {
-
-  osalDbgCheck(pitch > 0);
-
-  switch (fmt) {
-  case DMA2D_FMT_ARGB8888:
-    return (const void *)((uintptr_t)originp +
-                          (uintptr_t)y * pitch + (uintptr_t)x * 4);
-  case DMA2D_FMT_RGB888:
-    return (const void *)((uintptr_t)originp +
-                          (uintptr_t)y * pitch + (uintptr_t)x * 3);
-  case DMA2D_FMT_RGB565:
-  case DMA2D_FMT_ARGB1555:
-  case DMA2D_FMT_ARGB4444:
-  case DMA2D_FMT_AL88:
-    return (const void *)((uintptr_t)originp +
-                          (uintptr_t)y * pitch + (uintptr_t)x * 2);
-  case DMA2D_FMT_L8:
-  case DMA2D_FMT_AL44:
-  case DMA2D_FMT_A8:
-    return (const void *)((uintptr_t)originp +
-                          (uintptr_t)y * pitch + (uintptr_t)x);
-  case DMA2D_FMT_L4:
-  case DMA2D_FMT_A4:
-    osalDbgAssert((x & 1) == 0, "not aligned");
-    return (const void *)((uintptr_t)originp +
-                          (uintptr_t)y * pitch + (uintptr_t)x / 2);
-  default:
-    osalDbgAssert(false, "invalid format");
-    return NULL;
-  }
-}
-
-/**
- * @brief   Address is aligned.
- * @details Tells whether the address is aligned with the provided pixel format.
+ * @brief   Start command list.
+ * @details Programs and starts the first job of the list, the following jobs
+ *          are chained by the transfer complete interrupt. The list end
+ *          callback is invoked when the last job completes or when a job
+ *          fails.
+ * @note    The list and its jobs buffer must not be modified until the
+ *          execution ends.
+ * @pre     DMA2D is ready.
  *
- * @param[in] bufferp   address
- * @param[in] fmt       pixel format
+ * @param[in] dma2dp    pointer to the @p DMA2DDriver object
+ * @param[in] listp     pointer to the @p dma2d_cmdlist_t object
  *
- * @return              address is aligned
- *
- * @api
- */
-bool dma2dIsAligned(const void *bufferp, dma2d_pixfmt_t fmt) {
-
-  switch (fmt) {
-  case DMA2D_FMT_ARGB8888:
-  case DMA2D_FMT_RGB888:
-    return ((uintptr_t)bufferp & 3) == 0;   /* 32-bit alignment.*/
-  case DMA2D_FMT_RGB565:
-  case DMA2D_FMT_ARGB1555:
-  case DMA2D_FMT_ARGB4444:
-  case DMA2D_FMT_AL88:
-    return ((uintptr_t)bufferp & 1) == 0;   /* 16-bit alignment.*/
-  case DMA2D_FMT_L8:
-  case DMA2D_FMT_AL44:
-  case DMA2D_FMT_L4:
-  case DMA2D_FMT_A8:
-  case DMA2D_FMT_A4:
-    return true;                            /* 8-bit alignment.*/
-  default:
-    osalDbgAssert(false, "invalid format");
-    return false;
-  }
+ * @iclass
+ */
+void dma2dListStartI(DMA2DDriver *dma2dp, dma2d_cmdlist_t *listp) {
+
+  osalDbgCheckClassI();
+  osalDbgCheck(dma2dp == &DMA2DD1);
+  osalDbgCheck((listp != NULL) && (listp->count > 0));
+  osalDbgAssert(dma2dp->state == DMA2D_READY, "not ready");
+
+  listp->index = 0;
+  listp->result = MSG_OK;
+  dma2dp->listp = listp;
+  dma2d_job_program(&listp->jobsp[0]);
+  dma2dp->state = DMA2D_ACTIVE;
+  DMA2D->CR |= DMA2D_CR_START;
 }
 
 /**
- * @brief   Compute bits per pixel.
- * @details Computes the bits per pixel for the specified pixel format.
- *
- * @param[in] fmt       pixel format
+ * @brief   Start command list.
+ * @details Programs and starts the first job of the list, the following jobs
+ *          are chained by the transfer complete interrupt. The list end
+ *          callback is invoked when the last job completes or when a job
+ *          fails.
+ * @note    The list and its jobs buffer must not be modified until the
+ *          execution ends.
+ * @pre     DMA2D is ready.
  *
- * @retuen              bits per pixel
+ * @param[in] dma2dp    pointer to the @p DMA2DDriver object
+ * @param[in] listp     pointer to the @p dma2d_cmdlist_t object
  *
  * @api
  */
-size_t dma2dBitsPerPixel(dma2d_pixfmt_t fmt) {
-
-  osalDbgAssert(fmt < DMA2D_MAX_PIXFMT_ID, "invalid format");
+void dma2dListStart(DMA2DDriver *dma2dp, dma2d_cmdlist_t *listp) {
 
-  return (size_t)dma2d_bpp[(unsigned)fmt];
+  chSysLock();
+  dma2dListStartI(dma2dp, listp);
+  chSysUnlock();
 }
 
-#if DMA2D_USE_SOFTWARE_CONVERSIONS || defined(__DOXYGEN__)
-
 /**
- * @brief   Convert from ARGB-8888.
- * @details Converts an ARGB-8888 color to the specified pixel format.
+ * @brief   Execute command list.
+ * @details Starts the list and waits for the completion of all its jobs,
+ *          synchronously.
+ * @pre     DMA2D is ready.
  *
- * @param[in] c         color, ARGB-8888
- * @param[in] fmt       target pixel format
+ * @param[in] dma2dp    pointer to the @p DMA2DDriver object
+ * @param[in] listp     pointer to the @p dma2d_cmdlist_t object
  *
- * @return              raw color value for the target pixel format, left
- *                      padded with zeros.
+ * @return              The list execution result.
+ * @retval MSG_OK       if all the jobs completed.
+ * @retval MSG_RESET    if a job failed or the list was aborted.
  *
- * @api
+ * @sclass
  */
-dma2d_color_t dma2dFromARGB8888(dma2d_color_t c, dma2d_pixfmt_t fmt) {
+msg_t dma2dListExecuteS(DMA2DDriver *dma2dp, dma2d_cmdlist_t *listp) {
 
-  switch (fmt) {
-  case DMA2D_FMT_ARGB8888: {
-    return c;
-  }
-  case DMA2D_FMT_RGB888: {
-    return (c & 0x00FFFFFF);
-  }
-  case DMA2D_FMT_RGB565: {
-    return (((c & 0x000000F8) >> ( 8 -  5)) |
-            ((c & 0x0000FC00) >> (16 - 11)) |
-            ((c & 0x00F80000) >> (24 - 16)));
-  }
-  case DMA2D_FMT_ARGB1555: {
-    return (((c & 0x000000F8) >> ( 8 -  5)) |
-            ((c & 0x0000F800) >> (16 - 10)) |
-            ((c & 0x00F80000) >> (24 - 15)) |
-            ((c & 0x80000000) >> (32 - 16)));
-  }
-  case DMA2D_FMT_ARGB4444: {
-    return (((c & 0x000000F0) >> ( 8 -  4)) |
-            ((c & 0x0000F000) >> (16 -  8)) |
-            ((c & 0x00F00000) >> (24 - 12)) |
-            ((c & 0xF0000000) >> (32 - 16)));
-  }
-  case DMA2D_FMT_L8: {
-    return (c & 0x000000FF);
-  }
-  case DMA2D_FMT_AL44: {
-    return (((c & 0x000000F0) >> ( 8 - 4)) |
-            ((c & 0xF0000000) >> (32 - 8)));
-  }
-  case DMA2D_FMT_AL88: {
-    return (((c & 0x000000FF) >> ( 8 -  8)) |
-            ((c & 0xFF000000) >> (32 - 16)));
-  }
-  case DMA2D_FMT_L4: {
-    return (c & 0x0000000F);
-  }
-  case DMA2D_FMT_A8: {
-    return ((c & 0xFF000000) >> (32 - 8));
-  }
-  case DMA2D_FMT_A4: {
-    return ((c & 0xF0000000) >> (32 - 4));
-  }
-  default:
-    osalDbgAssert(false, "invalid format");
-    return 0;
-  }
+  osalDbgCheckClassS();
+
+  dma2dListStartI(dma2dp, listp);
+#if DMA2D_USE_WAIT
+  dma2dp->thread = chThdGetSelfX();
+  chSchGoSleepS(CH_STATE_SUSPENDED);
+#else
+  while (dma2dp->listp == listp)
+    chSchDoYieldS();
+#endif
+  return listp->result;
 }
 
 /**
- * @brief   Convert to ARGB-8888.
- * @details Converts color of the specified pixel format to an ARGB-8888 color.
+ * @brief   Execute command list.
+ * @details Starts the list and waits for the completion of all its jobs,
+ *          synchronously.
+ * @pre     DMA2D is ready.
  *
- * @param[in] c         color for the source pixel format, left padded with
- *                      zeros.
- * @param[in] fmt       source pixel format
+ * @param[in] dma2dp    pointer to the @p DMA2DDriver object
+ * @param[in] listp     pointer to the @p dma2d_cmdlist_t object
  *
- * @return              color in ARGB-8888 format
+ * @return              The list execution result.
+ * @retval MSG_OK       if all the jobs completed.
+ * @retval MSG_RESET    if a job failed or the list was aborted.
  *
  * @api
  */
-dma2d_color_t dma2dToARGB8888(dma2d_color_t c, dma2d_pixfmt_t fmt) {
+msg_t dma2dListExecute(DMA2DDriver *dma2dp, dma2d_cmdlist_t *listp) {
 
-  switch (fmt) {
-  case DMA2D_FMT_ARGB8888: {
-    return c;
-  }
-  case DMA2D_FMT_RGB888: {
-    return ((c & 0x00FFFFFF) | 0xFF000000);
-  }
-  case DMA2D_FMT_RGB565: {
-    register dma2d_color_t output = 0xFF000000;
-    if (c & 0x001F) output |= (((c & 0x001F) << ( 8 -  5)) | 0x00000007);
-    if (c & 0x07E0) output |= (((c & 0x07E0) << (16 - 11)) | 0x00000300);
-    if (c & 0xF800) output |= (((c & 0xF800) << (24 - 16)) | 0x00070000);
-    return output;
-  }
-  case DMA2D_FMT_ARGB1555: {
-    register dma2d_color_t output = 0x00000000;
-    if (c & 0x001F) output |= (((c & 0x001F) << ( 8 -  5)) | 0x00000007);
-    if (c & 0x03E0) output |= (((c & 0x03E0) << (16 - 10)) | 0x00000700);
-    if (c & 0x7C00) output |= (((c & 0x7C00) << (24 - 15)) | 0x00070000);
-    if (c & 0x8000) output |= 0xFF000000;
-    return output;
-  }
-  case DMA2D_FMT_ARGB4444: {
-    register dma2d_color_t output = 0x00000000;
-    if (c & 0x000F) output |= (((c & 0x000F) << ( 8 -  4)) | 0x0000000F);
-    if (c & 0x00F0) output |= (((c & 0x00F0) << (16 -  8)) | 0x00000F00);
-    if (c & 0x0F00) output |= (((c & 0x0F00) << (24 - 12)) | 0x000F0000);
-    if (c & 0xF000) output |= (((c & 0xF000) << (32 - 16)) | 0x0F000000);
-    return output;
-  }
-  case DMA2D_FMT_L8: {
-    return (c & 0xFF) | 0xFF000000;
-  }
-  case DMA2D_FMT_AL44: {
-    register dma2d_color_t output = 0x00000000;
-    if (c & 0x0F) output |= (((c & 0x0F) << ( 8 - 4)) | 0x0000000F);
-    if (c & 0xF0) output |= (((c & 0xF0) << (32 - 8)) | 0x0F000000);
-    return output;
-  }
-  case DMA2D_FMT_AL88: {
-    return (((c & 0x00FF) << ( 8 -  8)) |
-            ((c & 0xFF00) << (32 - 16)));
-  }
-  case DMA2D_FMT_L4: {
-    return ((c & 0x0F) | 0xFF000000);
-  }
-  case DMA2D_FMT_A8: {
-    return ((c & 0xFF) << (32 - 8));
-  }
-  case DMA2D_FMT_A4: {
-    return ((c & 0x0F) << (32 - 4));
-  }
-  default:
-    osalDbgAssert(false, "invalid format");
-    return 0;
-  }
+  msg_t msg;
+  chSysLock();
+  msg = dma2dListExecuteS(dma2dp, listp);
+  chSysUnlock();
+  return msg;
 }
 
-#endif  /* DMA2D_NEED_CONVERSIONS */
-
 /** @} */
 
+#endif  /* DMA2D_USE_COMMAND_LISTS */
+
 /** @} */
 
 #endif  /* STM32_DMA2D_USE_DMA2D */
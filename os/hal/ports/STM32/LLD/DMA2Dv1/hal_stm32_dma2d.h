@@ -216,6 +216,16 @@
 #define DMA2D_USE_CHECKS                    (TRUE)
 #endif
 
+/**
+ * @brief   Enables the command lists APIs.
+ * @details Jobs recorded into a list are chained by the transfer complete
+ *          interrupt without thread intervention.
+ * @note    Disabling this option saves both code and data space.
+ */
+#if !defined(DMA2D_USE_COMMAND_LISTS) || defined(__DOXYGEN__)
+#define DMA2D_USE_COMMAND_LISTS             (FALSE)
+#endif
+
 /** @} */
 
 /*===========================================================================*/
@@ -247,6 +257,8 @@ typedef struct dma2d_laycfg_t dma2d_layercfg_t;
 typedef struct DMA2DConfig DMA2DConfig;
 typedef enum dma2d_state_t dma2d_state_t;
 typedef struct DMA2DDriver DMA2DDriver;
+typedef struct dma2d_job_t dma2d_job_t;
+typedef struct dma2d_cmdlist_t dma2d_cmdlist_t;
 
 /**
  * @name    DMA2D Data types
@@ -382,6 +394,40 @@ typedef struct dma2d_layercfg_t {
   const dma2d_palcfg_t  *palettep;    /**< Palette specs, or @p NULL.*/
 } dma2d_laycfg_t;
 
+/**
+ * @brief   DMA2D command list end callback.
+ */
+typedef void (*dma2d_listcb_t)(DMA2DDriver *dma2dp, dma2d_cmdlist_t *listp);
+
+/**
+ * @brief   DMA2D recorded job.
+ * @details Self-contained description of a job, as programmed by the
+ *          command list executor.
+ */
+typedef struct dma2d_job_t {
+  dma2d_jobmode_t   mode;             /**< Job mode.*/
+  uint16_t          width;            /**< Area width, in pixels.*/
+  uint16_t          height;           /**< Area height, in pixels.*/
+  dma2d_laycfg_t    out;              /**< Output layer, color for fills.*/
+  dma2d_laycfg_t    fg;               /**< Foreground layer.*/
+  dma2d_laycfg_t    bg;               /**< Background layer.*/
+  dma2d_amode_t     fg_amode;         /**< Foreground alpha mode.*/
+  dma2d_amode_t     bg_amode;         /**< Background alpha mode.*/
+} dma2d_job_t;
+
+/**
+ * @brief   DMA2D command list.
+ * @details Jobs are stored into a caller provided buffer.
+ */
+typedef struct dma2d_cmdlist_t {
+  dma2d_job_t       *jobsp;           /**< Jobs buffer.*/
+  size_t            size;             /**< Jobs buffer capacity.*/
+  size_t            count;            /**< Number of recorded jobs.*/
+  size_t            index;            /**< Job being executed.*/
+  dma2d_listcb_t    end_cb;           /**< List end callback, or @p NULL.*/
+  msg_t             result;           /**< Last execution result.*/
+} dma2d_cmdlist_t;
+
 /**
  * @brief   DMA2D driver configuration.
  */
@@ -424,6 +470,9 @@ typedef struct DMA2DDriver {
   semaphore_t       lock;           /**< Multithreading lock.*/
 #endif
 #endif  /* DMA2D_USE_MUTUAL_EXCLUSION */
+#if (TRUE == DMA2D_USE_COMMAND_LISTS) || defined(__DOXYGEN__)
+  dma2d_cmdlist_t   *listp;         /**< Executing list, or @p NULL.*/
+#endif  /* DMA2D_USE_COMMAND_LISTS */
 } DMA2DDriver;
 
 /** @} */
@@ -482,6 +531,29 @@ typedef struct DMA2DDriver {
 #define dma2dComputeAddress(originp, pitch, fmt, x, y) \
   ((void *)dma2dComputeAddressConst(originp, pitch, fmt, x, y))
 
+/**
+ * @brief   Number of jobs recorded into a command list.
+ *
+ * @param[in] listp     pointer to the @p dma2d_cmdlist_t object
+ *
+ * @return              number of jobs
+ *
+ * @xclass
+ */
+#define dma2dListGetCountX(listp) ((listp)->count)
+
+/**
+ * @brief   Result of the last command list execution.
+ *
+ * @param[in] listp     pointer to the @p dma2d_cmdlist_t object
+ *
+ * @return              @p MSG_OK, or @p MSG_RESET if a job failed or the
+ *                      list was aborted
+ *
+ * @xclass
+ */
+#define dma2dListGetResultX(listp) ((listp)->result)
+
 /*===========================================================================*/
 /* External declarations.                                                    */
 /*===========================================================================*/
@@ -653,6 +725,35 @@ extern "C" {
   dma2d_color_t dma2dToARGB8888(dma2d_color_t c, dma2d_pixfmt_t fmt);
 #endif  /* DMA2D_USE_SOFTWARE_CONVERSIONS */
 
+#if (TRUE == DMA2D_USE_COMMAND_LISTS) || defined(__DOXYGEN__)
+  /* Command list methods.*/
+  void dma2dListObjectInit(dma2d_cmdlist_t *listp, dma2d_job_t *jobsp,
+                           size_t size, dma2d_listcb_t end_cb);
+  void dma2dListReset(dma2d_cmdlist_t *listp);
+  bool dma2dListCheckJob(const dma2d_job_t *jobp);
+  bool dma2dListAddJob(dma2d_cmdlist_t *listp, const dma2d_job_t *jobp);
+  bool dma2dListAddFill(dma2d_cmdlist_t *listp, const dma2d_laycfg_t *outp,
+                        uint16_t width, uint16_t height);
+  bool dma2dListAddCopy(dma2d_cmdlist_t *listp, const dma2d_laycfg_t *outp,
+                        const dma2d_laycfg_t *fgp,
+                        uint16_t width, uint16_t height);
+  bool dma2dListAddConvert(dma2d_cmdlist_t *listp, const dma2d_laycfg_t *outp,
+                           const dma2d_laycfg_t *fgp, dma2d_amode_t fg_amode,
+                           uint16_t width, uint16_t height);
+  bool dma2dListAddBlend(dma2d_cmdlist_t *listp, const dma2d_laycfg_t *outp,
+                         const dma2d_laycfg_t *fgp, dma2d_amode_t fg_amode,
+                         const dma2d_laycfg_t *bgp, dma2d_amode_t bg_amode,
+                         uint16_t width, uint16_t height);
+#if (TRUE == DMA2D_USE_SOFTWARE_CONVERSIONS) || defined(__DOXYGEN__)
+  void dma2dJobRunSoftware(const dma2d_job_t *jobp);
+  void dma2dListRunSoftware(const dma2d_cmdlist_t *listp);
+#endif  /* DMA2D_USE_SOFTWARE_CONVERSIONS */
+  void dma2dListStartI(DMA2DDriver *dma2dp, dma2d_cmdlist_t *listp);
+  void dma2dListStart(DMA2DDriver *dma2dp, dma2d_cmdlist_t *listp);
+  msg_t dma2dListExecuteS(DMA2DDriver *dma2dp, dma2d_cmdlist_t *listp);
+  msg_t dma2dListExecute(DMA2DDriver *dma2dp, dma2d_cmdlist_t *listp);
+#endif  /* DMA2D_USE_COMMAND_LISTS */
+
 #ifdef __cplusplus
 }
 #endif
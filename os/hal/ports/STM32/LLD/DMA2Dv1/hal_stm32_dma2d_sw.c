@@ -0,0 +1,836 @@
+/*
+    Copyright (C) 2013-2015 Andrea Zoppi
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/**
+ * @file    hal_stm32_dma2d_sw.c
+ * @brief   DMA2D/Chrom-ART driver, hardware independent code.
+ * @details Pixel format helpers, command lists recording and validation, and
+ *          the software reference of the job modes. Nothing in this module
+ *          accesses the DMA2D registers.
+ */
+
+#include <string.h>
+
+#include "hal.h"
+
+#include "hal_stm32_dma2d.h"
+
+#if STM32_DMA2D_USE_DMA2D || defined(__DOXYGEN__)
+
+/* Ignore annoying warning messages for actually safe code.*/
+#if defined(__GNUC__) && !defined(__DOXYGEN__)
+#pragma GCC diagnostic ignored "-Wtype-limits"
+#endif
+
+/**
+ * @addtogroup dma2d
+ * @{
+ */
+
+/*===========================================================================*/
+/* Driver local definitions.                                                 */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver exported variables.                                                */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver local variables and types.                                         */
+/*===========================================================================*/
+
+/**
+ * @brief   Bits per pixel lookup table.
+ */
+static const uint8_t dma2d_bpp[DMA2D_MAX_PIXFMT_ID + 1] = {
+  32,  /* DMA2D_FMT_ARGB8888 */
+  24,  /* DMA2D_FMT_RGB888 */
+  16,  /* DMA2D_FMT_RGB565 */
+  16,  /* DMA2D_FMT_ARGB1555 */
+  16,  /* DMA2D_FMT_ARGB4444 */
+   8,  /* DMA2D_FMT_L8 */
+   8,  /* DMA2D_FMT_AL44 */
+  16,  /* DMA2D_FMT_AL88 */
+   4,  /* DMA2D_FMT_L4 */
+   8,  /* DMA2D_FMT_A8 */
+   4   /* DMA2D_FMT_A4 */
+};
+
+/*===========================================================================*/
+/* Driver local functions.                                                   */
+/*===========================================================================*/
+
+#if DMA2D_USE_COMMAND_LISTS || defined(__DOXYGEN__)
+
+/**
+ * @brief   Direct color input format.
+ * @details Indexed formats need a CLUT load, which is not part of a job.
+ */
+static bool dma2d_is_direct(dma2d_pixfmt_t fmt) {
+
+  switch (fmt) {
+  case DMA2D_FMT_ARGB8888:
+  case DMA2D_FMT_RGB888:
+  case DMA2D_FMT_RGB565:
+  case DMA2D_FMT_ARGB1555:
+  case DMA2D_FMT_ARGB4444:
+  case DMA2D_FMT_A8:
+  case DMA2D_FMT_A4:
+    return true;
+  default:
+    return false;
+  }
+}
+
+/**
+ * @brief   Checks a job layer.
+ *
+ * @return              The check result.
+ * @retval HAL_SUCCESS  if the layer can be used by the job.
+ * @retval HAL_FAILED   otherwise.
+ */
+static bool dma2d_check_layer(const dma2d_laycfg_t *lp, uint16_t width) {
+
+  if ((lp->bufferp == NULL) || (lp->fmt >= DMA2D_MAX_PIXFMT_ID) ||
+      (lp->wrap_offset > DMA2D_MAX_OFFSET) ||
+      !dma2dIsAligned(lp->bufferp, lp->fmt))
+    return HAL_FAILED;
+
+  /* 4-bit lines must start on a byte boundary.*/
+  if ((dma2dBitsPerPixel(lp->fmt) == 4) &&
+      ((((size_t)width + lp->wrap_offset) & 1) != 0))
+    return HAL_FAILED;
+
+  return HAL_SUCCESS;
+}
+
+/**
+ * @brief   Checks an alpha mode.
+ */
+static bool dma2d_check_amode(dma2d_amode_t mode) {
+
+  return (mode == DMA2D_ALPHA_KEEP) || (mode == DMA2D_ALPHA_REPLACE) ||
+         (mode == DMA2D_ALPHA_MODULATE);
+}
+
+/**
+ * @brief   Fills the common fields of a job.
+ */
+static void dma2d_job_setup(dma2d_job_t *jobp, dma2d_jobmode_t mode,
+                            const dma2d_laycfg_t *outp,
+                            uint16_t width, uint16_t height) {
+
+  memset(jobp, 0, sizeof (dma2d_job_t));
+  jobp->mode = mode;
+  jobp->width = width;
+  jobp->height = height;
+  jobp->out = *outp;
+  jobp->fg_amode = DMA2D_ALPHA_KEEP;
+  jobp->bg_amode = DMA2D_ALPHA_KEEP;
+}
+
+#if DMA2D_USE_SOFTWARE_CONVERSIONS || defined(__DOXYGEN__)
+
+/**
+ * @brief   Address of a layer line.
+ */
+static uint8_t *dma2d_line(const dma2d_laycfg_t *lp, uint16_t width,
+                           uint16_t y) {
+
+  size_t pitch = (((size_t)width + lp->wrap_offset) *
+                  dma2dBitsPerPixel(lp->fmt)) / 8;
+
+  return (uint8_t *)lp->bufferp + (size_t)y * pitch;
+}
+
+/**
+ * @brief   Reads a raw pixel, little endian, low nibble first.
+ */
+static dma2d_color_t dma2d_load(const uint8_t *linep, dma2d_pixfmt_t fmt,
+                                uint16_t x) {
+
+  switch (dma2dBitsPerPixel(fmt)) {
+  case 32:
+    linep += (size_t)x * 4;
+    return ((dma2d_color_t)linep[0] | ((dma2d_color_t)linep[1] << 8) |
+            ((dma2d_color_t)linep[2] << 16) |
+            ((dma2d_color_t)linep[3] << 24));
+  case 24:
+    linep += (size_t)x * 3;
+    return ((dma2d_color_t)linep[0] | ((dma2d_color_t)linep[1] << 8) |
+            ((dma2d_color_t)linep[2] << 16));
+  case 16:
+    linep += (size_t)x * 2;
+    return ((dma2d_color_t)linep[0] | ((dma2d_color_t)linep[1] << 8));
+  case 8:
+    return (dma2d_color_t)linep[x];
+  default:
+    return (dma2d_color_t)((linep[x >> 1] >> ((x & 1) * 4)) & 0x0F);
+  }
+}
+
+/**
+ * @brief   Writes a raw pixel, little endian.
+ * @note    Output formats are 16 bits or larger.
+ */
+static void dma2d_store(uint8_t *linep, dma2d_pixfmt_t fmt, uint16_t x,
+                        dma2d_color_t c) {
+  size_t n = dma2dBytesPerPixel(fmt);
+
+  linep += (size_t)x * n;
+  while (n-- > 0) {
+    *linep++ = (uint8_t)c;
+    c >>= 8;
+  }
+}
+
+/**
+ * @brief   Pixel fetch and conversion to ARGB-8888, as done by the PFC.
+ */
+static dma2d_color_t dma2d_fetch(const dma2d_laycfg_t *lp,
+                                 dma2d_amode_t amode, dma2d_color_t raw) {
+  dma2d_color_t c = dma2dToARGB8888(raw, lp->fmt);
+  uint32_t a;
+
+  /* Alpha only formats take the color from the layer default color.*/
+  if ((lp->fmt == DMA2D_FMT_A8) || (lp->fmt == DMA2D_FMT_A4))
+    c = (c & 0xFF000000) | (lp->def_color & 0x00FFFFFF);
+
+  a = c >> 24;
+  if (amode == DMA2D_ALPHA_REPLACE)
+    a = lp->const_alpha;
+  else if (amode == DMA2D_ALPHA_MODULATE)
+    a = (a * lp->const_alpha) / 255;
+
+  return (c & 0x00FFFFFF) | ((dma2d_color_t)a << 24);
+}
+
+/**
+ * @brief   Blends two ARGB-8888 pixels, as done by the blender.
+ */
+static dma2d_color_t dma2d_blend(dma2d_color_t fg, dma2d_color_t bg) {
+  uint32_t afg = fg >> 24;
+  uint32_t abg = bg >> 24;
+  uint32_t mult = (afg * abg) / 255;
+  uint32_t aout = afg + abg - mult;
+  dma2d_color_t out;
+  unsigned shift;
+
+  if (aout == 0)
+    return 0;
+
+  out = (dma2d_color_t)aout << 24;
+  for (shift = 0; shift < 24; shift += 8) {
+    uint32_t cfg = (fg >> shift) & 0xFF;
+    uint32_t cbg = (bg >> shift) & 0xFF;
+
+    out |= (((cfg * afg) + (cbg * abg) - (cbg * mult)) / aout) << shift;
+  }
+  return out;
+}
+
+#endif  /* DMA2D_USE_SOFTWARE_CONVERSIONS */
+
+#endif  /* DMA2D_USE_COMMAND_LISTS */
+
+/*===========================================================================*/
+/* Driver exported functions.                                                */
+/*===========================================================================*/
+
+/**
+ * @name    DMA2D helper functions
+ * @{
+ */
+
+/**
+ * @brief   Compute pixel address.
+ * @details Computes the buffer address of a pixel, given the buffer
+ *          specifications.
+ *
+ * @param[in] originp   buffer origin address
+ * @param[in] pitch     buffer pitch, in bytes
+ * @param[in] fmt       buffer pixel format
+ * @param[in] x         horizontal pixel coordinate
+ * @param[in] y         vertical pixel coordinate
+ *
+ * @return              pixel address, constant data
+ *
+ * @api
+ */
+const void *dma2dComputeAddressConst(const void *originp, size_t pitch,
+                                     dma2d_pixfmt_t fmt,
+                                     uint16_t x, uint16_t y) {
+
+  osalDbgCheck(pitch > 0);
+
+  switch (fmt) {
+  case DMA2D_FMT_ARGB8888:
+    return (const void *)((uintptr_t)originp +
+                          (uintptr_t)y * pitch + (uintptr_t)x * 4);
+  case DMA2D_FMT_RGB888:
+    return (const void *)((uintptr_t)originp +
+                          (uintptr_t)y * pitch + (uintptr_t)x * 3);
+  case DMA2D_FMT_RGB565:
+  case DMA2D_FMT_ARGB1555:
+  case DMA2D_FMT_ARGB4444:
+  case DMA2D_FMT_AL88:
+    return (const void *)((uintptr_t)originp +
+                          (uintptr_t)y * pitch + (uintptr_t)x * 2);
+  case DMA2D_FMT_L8:
+  case DMA2D_FMT_AL44:
+  case DMA2D_FMT_A8:
+    return (const void *)((uintptr_t)originp +
+                          (uintptr_t)y * pitch + (uintptr_t)x);
+  case DMA2D_FMT_L4:
+  case DMA2D_FMT_A4:
+    osalDbgAssert((x & 1) == 0, "not aligned");
+    return (const void *)((uintptr_t)originp +
+                          (uintptr_t)y * pitch + (uintptr_t)x / 2);
+  default:
+    osalDbgAssert(false, "invalid format");
+    return NULL;
+  }
+}
+
+/**
+ * @brief   Address is aligned.
+ * @details Tells whether the address is aligned with the provided pixel format.
+ *
+ * @param[in] bufferp   address
+ * @param[in] fmt       pixel format
+ *
+ * @return              address is aligned
+ *
+ * @api
+ */
+bool dma2dIsAligned(const void *bufferp, dma2d_pixfmt_t fmt) {
+
+  switch (fmt) {
+  case DMA2D_FMT_ARGB8888:
+  case DMA2D_FMT_RGB888:
+    return ((uintptr_t)bufferp & 3) == 0;   /* 32-bit alignment.*/
+  case DMA2D_FMT_RGB565:
+  case DMA2D_FMT_ARGB1555:
+  case DMA2D_FMT_ARGB4444:
+  case DMA2D_FMT_AL88:
+    return ((uintptr_t)bufferp & 1) == 0;   /* 16-bit alignment.*/
+  case DMA2D_FMT_L8:
+  case DMA2D_FMT_AL44:
+  case DMA2D_FMT_L4:
+  case DMA2D_FMT_A8:
+  case DMA2D_FMT_A4:
+    return true;                            /* 8-bit alignment.*/
+  default:
+    osalDbgAssert(false, "invalid format");
+    return false;
+  }
+}
+
+/**
+ * @brief   Compute bits per pixel.
+ * @details Computes the bits per pixel for the specified pixel format.
+ *
+ * @param[in] fmt       pixel format
+ *
+ * @retuen              bits per pixel
+ *
+ * @api
+ */
+size_t dma2dBitsPerPixel(dma2d_pixfmt_t fmt) {
+
+  osalDbgAssert(fmt < DMA2D_MAX_PIXFMT_ID, "invalid format");
+
+  return (size_t)dma2d_bpp[(unsigned)fmt];
+}
+
+#if DMA2D_USE_SOFTWARE_CONVERSIONS || defined(__DOXYGEN__)
+
+/**
+ * @brief   Convert from ARGB-8888.
+ * @details Converts an ARGB-8888 color to the specified pixel format.
+ *
+ * @param[in] c         color, ARGB-8888
+ * @param[in] fmt       target pixel format
+ *
+ * @return              raw color value for the target pixel format, left
+ *                      padded with zeros.
+ *
+ * @api
+ */
+dma2d_color_t dma2dFromARGB8888(dma2d_color_t c, dma2d_pixfmt_t fmt) {
+
+  switch (fmt) {
+  case DMA2D_FMT_ARGB8888: {
+    return c;
+  }
+  case DMA2D_FMT_RGB888: {
+    return (c & 0x00FFFFFF);
+  }
+  case DMA2D_FMT_RGB565: {
+    return (((c & 0x000000F8) >> ( 8 -  5)) |
+            ((c & 0x0000FC00) >> (16 - 11)) |
+            ((c & 0x00F80000) >> (24 - 16)));
+  }
+  case DMA2D_FMT_ARGB1555: {
+    return (((c & 0x000000F8) >> ( 8 -  5)) |
+            ((c & 0x0000F800) >> (16 - 10)) |
+            ((c & 0x00F80000) >> (24 - 15)) |
+            ((c & 0x80000000) >> (32 - 16)));
+  }
+  case DMA2D_FMT_ARGB4444: {
+    return (((c & 0x000000F0) >> ( 8 -  4)) |
+            ((c & 0x0000F000) >> (16 -  8)) |
+            ((c & 0x00F00000) >> (24 - 12)) |
+            ((c & 0xF0000000) >> (32 - 16)));
+  }
+  case DMA2D_FMT_L8: {
+    return (c & 0x000000FF);
+  }
+  case DMA2D_FMT_AL44: {
+    return (((c & 0x000000F0) >> ( 8 - 4)) |
+            ((c & 0xF0000000) >> (32 - 8)));
+  }
+  case DMA2D_FMT_AL88: {
+    return (((c & 0x000000FF) >> ( 8 -  8)) |
+            ((c & 0xFF000000) >> (32 - 16)));
+  }
+  case DMA2D_FMT_L4: {
+    return (c & 0x0000000F);
+  }
+  case DMA2D_FMT_A8: {
+    return ((c & 0xFF000000) >> (32 - 8));
+  }
+  case DMA2D_FMT_A4: {
+    return ((c & 0xF0000000) >> (32 - 4));
+  }
+  default:
+    osalDbgAssert(false, "invalid format");
+    return 0;
+  }
+}
+
+/**
+ * @brief   Convert to ARGB-8888.
+ * @details Converts color of the specified pixel format to an ARGB-8888 color.
+ *
+ * @param[in] c         color for the source pixel format, left padded with
+ *                      zeros.
+ * @param[in] fmt       source pixel format
+ *
+ * @return              color in ARGB-8888 format
+ *
+ * @api
+ */
+dma2d_color_t dma2dToARGB8888(dma2d_color_t c, dma2d_pixfmt_t fmt) {
+
+  switch (fmt) {
+  case DMA2D_FMT_ARGB8888: {
+    return c;
+  }
+  case DMA2D_FMT_RGB888: {
+    return ((c & 0x00FFFFFF) | 0xFF000000);
+  }
+  case DMA2D_FMT_RGB565: {
+    register dma2d_color_t output = 0xFF000000;
+    if (c & 0x001F) output |= (((c & 0x001F) << ( 8 -  5)) | 0x00000007);
+    if (c & 0x07E0) output |= (((c & 0x07E0) << (16 - 11)) | 0x00000300);
+    if (c & 0xF800) output |= (((c & 0xF800) << (24 - 16)) | 0x00070000);
+    return output;
+  }
+  case DMA2D_FMT_ARGB1555: {
+    register dma2d_color_t output = 0x00000000;
+    if (c & 0x001F) output |= (((c & 0x001F) << ( 8 -  5)) | 0x00000007);
+    if (c & 0x03E0) output |= (((c & 0x03E0) << (16 - 10)) | 0x00000700);
+    if (c & 0x7C00) output |= (((c & 0x7C00) << (24 - 15)) | 0x00070000);
+    if (c & 0x8000) output |= 0xFF000000;
+    return output;
+  }
+  case DMA2D_FMT_ARGB4444: {
+    register dma2d_color_t output = 0x00000000;
+    if (c & 0x000F) output |= (((c & 0x000F) << ( 8 -  4)) | 0x0000000F);
+    if (c & 0x00F0) output |= (((c & 0x00F0) << (16 -  8)) | 0x00000F00);
+    if (c & 0x0F00) output |= (((c & 0x0F00) << (24 - 12)) | 0x000F0000);
+    if (c & 0xF000) output |= (((c & 0xF000) << (32 - 16)) | 0x0F000000);
+    return output;
+  }
+  case DMA2D_FMT_L8: {
+    return (c & 0xFF) | 0xFF000000;
+  }
+  case DMA2D_FMT_AL44: {
+    register dma2d_color_t output = 0x00000000;
+    if (c & 0x0F) output |= (((c & 0x0F) << ( 8 - 4)) | 0x0000000F);
+    if (c & 0xF0) output |= (((c & 0xF0) << (32 - 8)) | 0x0F000000);
+    return output;
+  }
+  case DMA2D_FMT_AL88: {
+    return (((c & 0x00FF) << ( 8 -  8)) |
+            ((c & 0xFF00) << (32 - 16)));
+  }
+  case DMA2D_FMT_L4: {
+    return ((c & 0x0F) | 0xFF000000);
+  }
+  case DMA2D_FMT_A8: {
+    return ((c & 0xFF) << (32 - 8));
+  }
+  case DMA2D_FMT_A4: {
+    return ((c & 0x0F) << (32 - 4));
+  }
+  default:
+    osalDbgAssert(false, "invalid format");
+    return 0;
+  }
+}
+
+#endif  /* DMA2D_NEED_CONVERSIONS */
+
+/** @} */
+
+#if DMA2D_USE_COMMAND_LISTS || defined(__DOXYGEN__)
+
+/**
+ * @name    DMA2D command list recording
+ * @{
+ */
+
+/**
+ * @brief   Initializes a command list.
+ *
+ * @param[out] listp    pointer to the @p dma2d_cmdlist_t object
+ * @param[in] jobsp     jobs buffer
+ * @param[in] size      jobs buffer capacity
+ * @param[in] end_cb    list end callback, invoked from the DMA2D ISR with the
+ *                      kernel locked, or @p NULL
+ *
+ * @init
+ */
+void dma2dListObjectInit(dma2d_cmdlist_t *listp, dma2d_job_t *jobsp,
+                         size_t size, dma2d_listcb_t end_cb) {
+
+  osalDbgCheck((listp != NULL) && (jobsp != NULL) && (size > 0));
+
+  listp->jobsp = jobsp;
+  listp->size = size;
+  listp->end_cb = end_cb;
+  dma2dListReset(listp);
+}
+
+/**
+ * @brief   Removes all the jobs from a command list.
+ * @pre     The list is not executing.
+ *
+ * @param[in] listp     pointer to the @p dma2d_cmdlist_t object
+ *
+ * @xclass
+ */
+void dma2dListReset(dma2d_cmdlist_t *listp) {
+
+  osalDbgCheck(listp != NULL);
+
+  listp->count = 0;
+  listp->index = 0;
+  listp->result = MSG_OK;
+}
+
+/**
+ * @brief   Checks a job.
+ * @details Verifies the job against the hardware constraints: area size,
+ *          wrap offsets, buffers alignment, pixel formats and alpha modes.
+ *          Input layers of converting and blending jobs must be direct color
+ *          or alpha only, indexed formats need a CLUT load which is not
+ *          chained.
+ *
+ * @param[in] jobp      pointer to the @p dma2d_job_t object
+ *
+ * @return              The check result.
+ * @retval HAL_SUCCESS  if the job can be recorded.
+ * @retval HAL_FAILED   otherwise.
+ *
+ * @xclass
+ */
+bool dma2dListCheckJob(const dma2d_job_t *jobp) {
+
+  osalDbgCheck(jobp != NULL);
+
+  if ((jobp->width == 0) || (jobp->width > DMA2D_MAX_WIDTH) ||
+      (jobp->height == 0) || (jobp->height > DMA2D_MAX_HEIGHT))
+    return HAL_FAILED;
+
+  if (dma2d_check_layer(&jobp->out, jobp->width) != HAL_SUCCESS)
+    return HAL_FAILED;
+
+  switch (jobp->mode) {
+  case DMA2D_JOB_CONST:
+    return (jobp->out.fmt <= DMA2D_MAX_OUTPIXFMT_ID) ? HAL_SUCCESS
+                                                      : HAL_FAILED;
+  case DMA2D_JOB_COPY:
+    /* Raw copy, no conversion takes place.*/
+    if ((dma2d_check_layer(&jobp->fg, jobp->width) != HAL_SUCCESS) ||
+        (jobp->fg.fmt != jobp->out.fmt))
+      return HAL_FAILED;
+    return HAL_SUCCESS;
+  case DMA2D_JOB_CONVERT:
+    if ((jobp->out.fmt > DMA2D_MAX_OUTPIXFMT_ID) ||
+        (dma2d_check_layer(&jobp->fg, jobp->width) != HAL_SUCCESS) ||
+        !dma2d_is_direct(jobp->fg.fmt) ||
+        !dma2d_check_amode(jobp->fg_amode))
+      return HAL_FAILED;
+    return HAL_SUCCESS;
+  case DMA2D_JOB_BLEND:
+    if ((jobp->out.fmt > DMA2D_MAX_OUTPIXFMT_ID) ||
+        (dma2d_check_layer(&jobp->fg, jobp->width) != HAL_SUCCESS) ||
+        !dma2d_is_direct(jobp->fg.fmt) ||
+        !dma2d_check_amode(jobp->fg_amode) ||
+        (dma2d_check_layer(&jobp->bg, jobp->width) != HAL_SUCCESS) ||
+        !dma2d_is_direct(jobp->bg.fmt) ||
+        !dma2d_check_amode(jobp->bg_amode))
+      return HAL_FAILED;
+    return HAL_SUCCESS;
+  default:
+    return HAL_FAILED;
+  }
+}
+
+/**
+ * @brief   Appends a job to a command list.
+ * @details The job is validated and copied into the list.
+ * @pre     The list is not executing.
+ *
+ * @param[in] listp     pointer to the @p dma2d_cmdlist_t object
+ * @param[in] jobp      pointer to the @p dma2d_job_t object
+ *
+ * @return              The operation result.
+ * @retval HAL_SUCCESS  if the job has been recorded.
+ * @retval HAL_FAILED   if the list is full or the job is invalid.
+ *
+ * @xclass
+ */
+bool dma2dListAddJob(dma2d_cmdlist_t *listp, const dma2d_job_t *jobp) {
+
+  osalDbgCheck((listp != NULL) && (jobp != NULL));
+
+  if ((listp->count >= listp->size) ||
+      (dma2dListCheckJob(jobp) != HAL_SUCCESS))
+    return HAL_FAILED;
+
+  listp->jobsp[listp->count++] = *jobp;
+  return HAL_SUCCESS;
+}
+
+/**
+ * @brief   Appends a fill job to a command list.
+ * @details The area is filled with the output layer default color, as a raw
+ *          output format value.
+ *
+ * @param[in] listp     pointer to the @p dma2d_cmdlist_t object
+ * @param[in] outp      output layer specifications
+ * @param[in] width     area width, in pixels
+ * @param[in] height    area height, in pixels
+ *
+ * @return              The operation result.
+ * @retval HAL_SUCCESS  if the job has been recorded.
+ * @retval HAL_FAILED   if the list is full or the job is invalid.
+ *
+ * @xclass
+ */
+bool dma2dListAddFill(dma2d_cmdlist_t *listp, const dma2d_laycfg_t *outp,
+                      uint16_t width, uint16_t height) {
+  dma2d_job_t job;
+
+  osalDbgCheck(outp != NULL);
+
+  dma2d_job_setup(&job, DMA2D_JOB_CONST, outp, width, height);
+  return dma2dListAddJob(listp, &job);
+}
+
+/**
+ * @brief   Appends a copy job to a command list.
+ * @details The foreground area is copied as is, both layers must have the
+ *          same pixel format.
+ *
+ * @param[in] listp     pointer to the @p dma2d_cmdlist_t object
+ * @param[in] outp      output layer specifications
+ * @param[in] fgp       foreground layer specifications
+ * @param[in] width     area width, in pixels
+ * @param[in] height    area height, in pixels
+ *
+ * @return              The operation result.
+ * @retval HAL_SUCCESS  if the job has been recorded.
+ * @retval HAL_FAILED   if the list is full or the job is invalid.
+ *
+ * @xclass
+ */
+bool dma2dListAddCopy(dma2d_cmdlist_t *listp, const dma2d_laycfg_t *outp,
+                      const dma2d_laycfg_t *fgp,
+                      uint16_t width, uint16_t height) {
+  dma2d_job_t job;
+
+  osalDbgCheck((outp != NULL) && (fgp != NULL));
+
+  dma2d_job_setup(&job, DMA2D_JOB_COPY, outp, width, height);
+  job.fg = *fgp;
+  return dma2dListAddJob(listp, &job);
+}
+
+/**
+ * @brief   Appends a conversion job to a command list.
+ *
+ * @param[in] listp     pointer to the @p dma2d_cmdlist_t object
+ * @param[in] outp      output layer specifications
+ * @param[in] fgp       foreground layer specifications
+ * @param[in] fg_amode  foreground alpha mode
+ * @param[in] width     area width, in pixels
+ * @param[in] height    area height, in pixels
+ *
+ * @return              The operation result.
+ * @retval HAL_SUCCESS  if the job has been recorded.
+ * @retval HAL_FAILED   if the list is full or the job is invalid.
+ *
+ * @xclass
+ */
+bool dma2dListAddConvert(dma2d_cmdlist_t *listp, const dma2d_laycfg_t *outp,
+                         const dma2d_laycfg_t *fgp, dma2d_amode_t fg_amode,
+                         uint16_t width, uint16_t height) {
+  dma2d_job_t job;
+
+  osalDbgCheck((outp != NULL) && (fgp != NULL));
+
+  dma2d_job_setup(&job, DMA2D_JOB_CONVERT, outp, width, height);
+  job.fg = *fgp;
+  job.fg_amode = fg_amode;
+  return dma2dListAddJob(listp, &job);
+}
+
+/**
+ * @brief   Appends a blending job to a command list.
+ *
+ * @param[in] listp     pointer to the @p dma2d_cmdlist_t object
+ * @param[in] outp      output layer specifications
+ * @param[in] fgp       foreground layer specifications
+ * @param[in] fg_amode  foreground alpha mode
+ * @param[in] bgp       background layer specifications
+ * @param[in] bg_amode  background alpha mode
+ * @param[in] width     area width, in pixels
+ * @param[in] height    area height, in pixels
+ *
+ * @return              The operation result.
+ * @retval HAL_SUCCESS  if the job has been recorded.
+ * @retval HAL_FAILED   if the list is full or the job is invalid.
+ *
+ * @xclass
+ */
+bool dma2dListAddBlend(dma2d_cmdlist_t *listp, const dma2d_laycfg_t *outp,
+                       const dma2d_laycfg_t *fgp, dma2d_amode_t fg_amode,
+                       const dma2d_laycfg_t *bgp, dma2d_amode_t bg_amode,
+                       uint16_t width, uint16_t height) {
+  dma2d_job_t job;
+
+  osalDbgCheck((outp != NULL) && (fgp != NULL) && (bgp != NULL));
+
+  dma2d_job_setup(&job, DMA2D_JOB_BLEND, outp, width, height);
+  job.fg = *fgp;
+  job.fg_amode = fg_amode;
+  job.bg = *bgp;
+  job.bg_amode = bg_amode;
+  return dma2dListAddJob(listp, &job);
+}
+
+#if DMA2D_USE_SOFTWARE_CONVERSIONS || defined(__DOXYGEN__)
+
+/**
+ * @brief   Executes a job in software.
+ * @details Reference implementation of the job modes, used to check the
+ *          hardware results and as a fallback. Blending follows the formulas
+ *          of the reference manual, results may differ from the hardware
+ *          by one unit of rounding.
+ * @pre     The job has been validated.
+ *
+ * @param[in] jobp      pointer to the @p dma2d_job_t object
+ *
+ * @xclass
+ */
+void dma2dJobRunSoftware(const dma2d_job_t *jobp) {
+  uint16_t x, y;
+
+  osalDbgCheck(jobp != NULL);
+  osalDbgAssert(dma2dListCheckJob(jobp) == HAL_SUCCESS, "invalid job");
+
+  for (y = 0; y < jobp->height; y++) {
+    uint8_t *outp = dma2d_line(&jobp->out, jobp->width, y);
+    const uint8_t *fgp = NULL;
+    const uint8_t *bgp = NULL;
+
+    if (jobp->mode != DMA2D_JOB_CONST)
+      fgp = dma2d_line(&jobp->fg, jobp->width, y);
+    if (jobp->mode == DMA2D_JOB_BLEND)
+      bgp = dma2d_line(&jobp->bg, jobp->width, y);
+
+    switch (jobp->mode) {
+    case DMA2D_JOB_CONST:
+      for (x = 0; x < jobp->width; x++)
+        dma2d_store(outp, jobp->out.fmt, x, jobp->out.def_color);
+      break;
+    case DMA2D_JOB_COPY:
+      memcpy(outp, fgp,
+             ((size_t)jobp->width * dma2dBitsPerPixel(jobp->fg.fmt) + 7) / 8);
+      break;
+    case DMA2D_JOB_CONVERT:
+      for (x = 0; x < jobp->width; x++) {
+        dma2d_color_t c = dma2d_fetch(&jobp->fg, jobp->fg_amode,
+                                      dma2d_load(fgp, jobp->fg.fmt, x));
+        dma2d_store(outp, jobp->out.fmt, x,
+                    dma2dFromARGB8888(c, jobp->out.fmt));
+      }
+      break;
+    default:
+      for (x = 0; x < jobp->width; x++) {
+        dma2d_color_t c = dma2d_blend(
+            dma2d_fetch(&jobp->fg, jobp->fg_amode,
+                        dma2d_load(fgp, jobp->fg.fmt, x)),
+            dma2d_fetch(&jobp->bg, jobp->bg_amode,
+                        dma2d_load(bgp, jobp->bg.fmt, x)));
+        dma2d_store(outp, jobp->out.fmt, x,
+                    dma2dFromARGB8888(c, jobp->out.fmt));
+      }
+      break;
+    }
+  }
+}
+
+/**
+ * @brief   Executes a command list in software.
+ *
+ * @param[in] listp     pointer to the @p dma2d_cmdlist_t object
+ *
+ * @xclass
+ */
+void dma2dListRunSoftware(const dma2d_cmdlist_t *listp) {
+  size_t i;
+
+  osalDbgCheck(listp != NULL);
+
+  for (i = 0; i < listp->count; i++)
+    dma2dJobRunSoftware(&listp->jobsp[i]);
+}
+
+#endif  /* DMA2D_USE_SOFTWARE_CONVERSIONS */
+
+/** @} */
+
+#endif  /* DMA2D_USE_COMMAND_LISTS */
+
+/** @} */
+
+#endif  /* STM32_DMA2D_USE_DMA2D */
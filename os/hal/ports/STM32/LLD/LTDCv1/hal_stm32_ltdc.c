@@ -198,15 +198,27 @@ OSAL_IRQ_HANDLER(STM32_LTDC_ER_HANDLER) {
 
   /* Handle FIFO Underrun ISR.*/
   if ((LTDC->ISR & LTDC_ISR_FUIF) && (LTDC->IER & LTDC_IER_FUIE)) {
+#if (TRUE == LTDC_USE_ERROR_COUNTERS)
+    ltdcp->underruns++;
+    if (ltdcp->config->fuerr_isr != NULL)
+      ltdcp->config->fuerr_isr(ltdcp);
+#else
     osalDbgAssert(ltdcp->config->fuerr_isr != NULL, "invalid state");
     ltdcp->config->fuerr_isr(ltdcp);
+#endif  /* LTDC_USE_ERROR_COUNTERS */
     LTDC->ICR |= LTDC_ICR_CFUIF;
   }
 
   /* Handle Transfer Error ISR.*/
   if ((LTDC->ISR & LTDC_ISR_TERRIF) && (LTDC->IER & LTDC_IER_TERRIE)) {
+#if (TRUE == LTDC_USE_ERROR_COUNTERS)
+    ltdcp->transfer_errors++;
+    if (ltdcp->config->terr_isr != NULL)
+      ltdcp->config->terr_isr(ltdcp);
+#else
     osalDbgAssert(ltdcp->config->terr_isr != NULL, "invalid state");
     ltdcp->config->terr_isr(ltdcp);
+#endif  /* LTDC_USE_ERROR_COUNTERS */
     LTDC->ICR |= LTDC_ICR_CTERRIF;
   }
 
@@ -255,6 +267,10 @@ void ltdcObjectInit(LTDCDriver *ltdcp) {
   ltdcp->state = LTDC_UNINIT;
   ltdcp->config = NULL;
   ltdcp->active_window = ltdc_invalid_window;
+#if (TRUE == LTDC_USE_ERROR_COUNTERS)
+  ltdcp->underruns = 0;
+  ltdcp->transfer_errors = 0;
+#endif  /* LTDC_USE_ERROR_COUNTERS */
 #if (TRUE == LTDC_USE_WAIT)
   ltdcp->thread = NULL;
 #endif  /* LTDC_USE_WAIT */
@@ -413,10 +429,14 @@ void ltdcStart(LTDCDriver *ltdcp, const LTDCConfig *configp) {
   flags = LTDC_IER_RRIE;
   if (configp->line_isr != NULL)
     flags |= LTDC_IER_LIE;
+#if (TRUE == LTDC_USE_ERROR_COUNTERS)
+  flags |= LTDC_IER_FUIE | LTDC_IER_TERRIE;
+#else
   if (configp->fuerr_isr != NULL)
     flags |= LTDC_IER_FUIE;
   if (configp->terr_isr != NULL)
     flags |= LTDC_IER_TERRIE;
+#endif  /* LTDC_USE_ERROR_COUNTERS */
   LTDC->IER = flags;
 
   /* Apply settings.*/
@@ -1100,6 +1120,42 @@ void ltdcDisableLineInterrupt(LTDCDriver *ltdcp) {
   osalSysUnlock();
 }
 
+#if (TRUE == LTDC_USE_ERROR_COUNTERS) || defined(__DOXYGEN__)
+
+/**
+ * @brief   Reset error counters.
+ * @details Clears the FIFO underrun and transfer error counters.
+ *
+ * @param[in] ltdcp     pointer to the @p LTDCDriver object
+ *
+ * @iclass
+ */
+void ltdcResetErrorCountsI(LTDCDriver *ltdcp) {
+
+  osalDbgCheckClassI();
+  osalDbgCheck(ltdcp == &LTDCD1);
+
+  ltdcp->underruns = 0;
+  ltdcp->transfer_errors = 0;
+}
+
+/**
+ * @brief   Reset error counters.
+ * @details Clears the FIFO underrun and transfer error counters.
+ *
+ * @param[in] ltdcp     pointer to the @p LTDCDriver object
+ *
+ * @api
+ */
+void ltdcResetErrorCounts(LTDCDriver *ltdcp) {
+
+  osalSysLock();
+  ltdcResetErrorCountsI(ltdcp);
+  osalSysUnlock();
+}
+
+#endif  /* LTDC_USE_ERROR_COUNTERS */
+
 /**
  * @brief   Get current position.
  * @details Gets the current position.
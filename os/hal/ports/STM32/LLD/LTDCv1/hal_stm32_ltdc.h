@@ -255,6 +255,15 @@
 #define LTDC_USE_CHECKS                     (TRUE)
 #endif
 
+/**
+ * @brief   Counts FIFO underrun and transfer error interrupts.
+ * @note    When enabled the error interrupts are always active, their
+ *          callbacks become optional.
+ */
+#if !defined(LTDC_USE_ERROR_COUNTERS) || defined(__DOXYGEN__)
+#define LTDC_USE_ERROR_COUNTERS             (FALSE)
+#endif
+
 /** @} */
 
 /*===========================================================================*/
@@ -427,6 +436,15 @@ typedef struct ltdc_laycfg_t {
   ltdc_flags_t        flags;        /**< Layer configuration flags.*/
 } ltdc_laycfg_t;
 
+/**
+ * @brief   LTDC memory bandwidth demand.
+ */
+typedef struct ltdc_bandwidth_t {
+  uint32_t      peak;               /**< While all layers are read, B/s.*/
+  uint32_t      average;            /**< Over the whole frame, B/s.*/
+  uint32_t      bytes_per_clock;    /**< Peak bytes per pixel clock.*/
+} ltdc_bandwidth_t;
+
 /**
  * @brief   LTDC driver configuration.
  */
@@ -474,6 +492,12 @@ typedef struct LTDCDriver {
   /* Handy computations.*/
   ltdc_window_t     active_window;  /**< Active window coordinates.*/
 
+#if (TRUE == LTDC_USE_ERROR_COUNTERS) || defined(__DOXYGEN__)
+  /* Performance counters.*/
+  uint32_t          underruns;      /**< FIFO underrun interrupts.*/
+  uint32_t          transfer_errors;/**< Transfer error interrupts.*/
+#endif  /* LTDC_USE_ERROR_COUNTERS */
+
   /* Multithreading stuff.*/
 #if (TRUE == LTDC_USE_WAIT) || defined(__DOXYGEN__)
   thread_t          *thread;        /**< Waiting thread.*/
@@ -525,6 +549,26 @@ typedef struct LTDCDriver {
 #define ltdcBytesPerPixel(fmt) \
   ((ltdcBitsPerPixel(fmt) + 7) >> 3)
 
+#if (TRUE == LTDC_USE_ERROR_COUNTERS) || defined(__DOXYGEN__)
+/**
+ * @brief   FIFO underruns counted since the last reset.
+ *
+ * @param[in] ltdcp     pointer to the @p LTDCDriver object
+ *
+ * @xclass
+ */
+#define ltdcGetUnderrunCountX(ltdcp) ((ltdcp)->underruns)
+
+/**
+ * @brief   Transfer errors counted since the last reset.
+ *
+ * @param[in] ltdcp     pointer to the @p LTDCDriver object
+ *
+ * @xclass
+ */
+#define ltdcGetTransferErrorCountX(ltdcp) ((ltdcp)->transfer_errors)
+#endif  /* LTDC_USE_ERROR_COUNTERS */
+
 /*===========================================================================*/
 /* External declarations.                                                    */
 /*===========================================================================*/
@@ -579,6 +623,10 @@ extern "C" {
   void ltdcEnableLineInterrupt(LTDCDriver *ltdcp);
   void ltdcDisableLineInterruptI(LTDCDriver *ltdcp);
   void ltdcDisableLineInterrupt(LTDCDriver *ltdcp);
+#if (TRUE == LTDC_USE_ERROR_COUNTERS) || defined(__DOXYGEN__)
+  void ltdcResetErrorCountsI(LTDCDriver *ltdcp);
+  void ltdcResetErrorCounts(LTDCDriver *ltdcp);
+#endif  /* LTDC_USE_ERROR_COUNTERS */
   void ltdcGetCurrentPosI(LTDCDriver *ltdcp, uint16_t *xp, uint16_t *yp);
   void ltdcGetCurrentPos(LTDCDriver *ltdcp, uint16_t *xp, uint16_t *yp);
 
@@ -725,6 +773,13 @@ extern "C" {
   ltdc_color_t ltdcToARGB8888(ltdc_color_t c, ltdc_pixfmt_t fmt);
 #endif  /* LTDC_USE_SOFTWARE_CONVERSIONS */
 
+  /* Bandwidth model.*/
+  void ltdcComputeBandwidth(const LTDCConfig *configp, uint32_t pixclk,
+                            ltdc_bandwidth_t *bwp);
+  bool ltdcCheckBandwidth(const LTDCConfig *configp, uint32_t pixclk,
+                          uint32_t budget);
+  uint32_t ltdcMaxPixelClock(const LTDCConfig *configp, uint32_t budget);
+
 #ifdef __cplusplus
 }
 #endif
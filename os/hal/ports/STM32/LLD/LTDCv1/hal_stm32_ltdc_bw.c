@@ -0,0 +1,208 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/**
+ * @file    hal_stm32_ltdc_bw.c
+ * @brief   LCD-TFT Controller Driver, memory bandwidth model.
+ * @note    No hardware access, the model only depends on the configuration.
+ */
+
+#include "hal.h"
+
+#include "hal_stm32_ltdc.h"
+
+#if (TRUE == STM32_LTDC_USE_LTDC) || defined(__DOXYGEN__)
+
+/**
+ * @addtogroup ltdc
+ * @{
+ */
+
+/*===========================================================================*/
+/* Driver local definitions.                                                 */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver exported variables.                                                */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver local variables and types.                                         */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver local functions.                                                   */
+/*===========================================================================*/
+
+/**
+ * @brief   Checks if a layer configuration fetches pixels.
+ */
+static bool ltdc_layer_active(const ltdc_laycfg_t *cfgp) {
+
+  return (cfgp != NULL) && (cfgp->frame != NULL) && (cfgp->window != NULL) &&
+         ((cfgp->flags & LTDC_LEF_ENABLE) != 0);
+}
+
+/**
+ * @brief   Bytes fetched per layer pixel, 0 for inactive layers.
+ * @note    Palette lookups are internal, L-8 layers fetch one byte.
+ */
+static uint32_t ltdc_layer_bpp(const ltdc_laycfg_t *cfgp) {
+
+  if (!ltdc_layer_active(cfgp))
+    return 0;
+  return (uint32_t)ltdcBytesPerPixel(cfgp->frame->fmt);
+}
+
+/**
+ * @brief   Bytes fetched per layer frame, 0 for inactive layers.
+ */
+static uint64_t ltdc_layer_frame_bytes(const ltdc_laycfg_t *cfgp) {
+
+  const ltdc_window_t *wp;
+
+  if (!ltdc_layer_active(cfgp))
+    return 0;
+  wp = cfgp->window;
+  return (uint64_t)((uint32_t)wp->hstop - wp->hstart + 1) *
+         (uint64_t)((uint32_t)wp->vstop - wp->vstart + 1) *
+         ltdc_layer_bpp(cfgp);
+}
+
+/**
+ * @brief   Checks if the windows of both layers share pixels.
+ */
+static bool ltdc_layers_overlap(const ltdc_laycfg_t *bgp,
+                                const ltdc_laycfg_t *fgp) {
+
+  const ltdc_window_t *a, *b;
+
+  if (!ltdc_layer_active(bgp) || !ltdc_layer_active(fgp))
+    return false;
+  a = bgp->window;
+  b = fgp->window;
+  return (a->hstart <= b->hstop) && (b->hstart <= a->hstop) &&
+         (a->vstart <= b->vstop) && (b->vstart <= a->vstop);
+}
+
+/**
+ * @brief   Saturates a rate to 32 bits.
+ */
+static uint32_t ltdc_saturate(uint64_t rate) {
+
+  return (rate > 0xFFFFFFFFU) ? 0xFFFFFFFFU : (uint32_t)rate;
+}
+
+/*===========================================================================*/
+/* Driver exported functions.                                                */
+/*===========================================================================*/
+
+/**
+ * @name    LTDC bandwidth model
+ * @{
+ */
+
+/**
+ * @brief   Compute memory bandwidth demand.
+ * @details Computes the memory bandwidth needed by the layers of a
+ *          configuration at the given pixel clock. The per-layer FIFOs are
+ *          too small to smooth out a line, the peak rate must be sustained
+ *          by the memory while the layers overlap on screen.
+ *
+ * @param[in] configp   pointer to the @p LTDCConfig object
+ * @param[in] pixclk    pixel clock, in Hz
+ * @param[out] bwp      pointer to the @p ltdc_bandwidth_t result
+ *
+ * @api
+ */
+void ltdcComputeBandwidth(const LTDCConfig *configp, uint32_t pixclk,
+                          ltdc_bandwidth_t *bwp) {
+
+  uint32_t bg_bpp, fg_bpp, htotal, vtotal;
+  uint64_t frame_bytes;
+
+  osalDbgCheck((configp != NULL) && (bwp != NULL));
+
+  htotal = (uint32_t)configp->hsync_width + configp->hbp_width +
+           configp->screen_width + configp->hfp_width;
+  vtotal = (uint32_t)configp->vsync_height + configp->vbp_height +
+           configp->screen_height + configp->vfp_height;
+  osalDbgCheck((htotal > 0) && (vtotal > 0));
+
+  bg_bpp = ltdc_layer_bpp(configp->bg_laycfg);
+  fg_bpp = ltdc_layer_bpp(configp->fg_laycfg);
+  if (ltdc_layers_overlap(configp->bg_laycfg, configp->fg_laycfg))
+    bwp->bytes_per_clock = bg_bpp + fg_bpp;
+  else
+    bwp->bytes_per_clock = (bg_bpp > fg_bpp) ? bg_bpp : fg_bpp;
+  bwp->peak = ltdc_saturate((uint64_t)pixclk * bwp->bytes_per_clock);
+
+  frame_bytes = ltdc_layer_frame_bytes(configp->bg_laycfg) +
+                ltdc_layer_frame_bytes(configp->fg_laycfg);
+  bwp->average = ltdc_saturate((frame_bytes * pixclk) /
+                               ((uint64_t)htotal * vtotal));
+}
+
+/**
+ * @brief   Check memory bandwidth demand.
+ * @details Checks a configuration against a memory bandwidth budget, to be
+ *          used before @p ltdcStart() or a layer reconfiguration.
+ *
+ * @param[in] configp   pointer to the @p LTDCConfig object
+ * @param[in] pixclk    pixel clock, in Hz
+ * @param[in] budget    memory bandwidth available to the LTDC, in B/s
+ *
+ * @return              @p true if the peak demand fits the budget.
+ *
+ * @api
+ */
+bool ltdcCheckBandwidth(const LTDCConfig *configp, uint32_t pixclk,
+                        uint32_t budget) {
+
+  ltdc_bandwidth_t bw;
+
+  ltdcComputeBandwidth(configp, pixclk, &bw);
+  return bw.peak <= budget;
+}
+
+/**
+ * @brief   Maximum pixel clock within a budget.
+ * @details Computes the highest pixel clock at which the peak demand of a
+ *          configuration fits a memory bandwidth budget, the refresh rate
+ *          is lowered instead of underrunning.
+ *
+ * @param[in] configp   pointer to the @p LTDCConfig object
+ * @param[in] budget    memory bandwidth available to the LTDC, in B/s
+ *
+ * @return              pixel clock, in Hz.
+ *
+ * @api
+ */
+uint32_t ltdcMaxPixelClock(const LTDCConfig *configp, uint32_t budget) {
+
+  ltdc_bandwidth_t bw;
+
+  ltdcComputeBandwidth(configp, 1, &bw);
+  if (bw.bytes_per_clock == 0)
+    return 0xFFFFFFFFU;
+  return budget / bw.bytes_per_clock;
+}
+
+/** @} */
+
+/** @} */
+
+#endif  /* STM32_LTDC_USE_LTDC */
@@ -146,6 +146,7 @@
 
 static void _transfer_completedI(usbh_ep_t *ep, usbh_urb_t *urb, usbh_urbstatus_t status);
 static void _try_commit_np(USBHDriver *host);
+static void _p_schedule(USBHDriver *host, usbh_ep_t *ep);
 static void otg_rxfifo_flush(USBHDriver *usbp);
 static void otg_txfifo_flush(USBHDriver *usbp, uint32_t fifo);
 
@@ -160,7 +161,20 @@ USBHDriver USBHD2;
 /* Little helper functions.                                                  */
 /*===========================================================================*/
 static inline void _move_to_pending_queue(usbh_ep_t *ep) {
-	list_move_tail(&ep->node, ep->pending_list);
+	if (usbhEPIsPeriodic(ep)) {
+		_p_schedule(ep->device->host, ep);
+	} else {
+		list_move_tail(&ep->node, ep->pending_list);
+	}
+}
+
+/* SOF is needed while periodic transfers are pending */
+static inline void _update_sof_mask(USBHDriver *host) {
+	if (host->p_sched_map == 0) {
+		host->otg->GINTMSK &= ~GINTMSK_SOFM;
+	} else {
+		host->otg->GINTMSK |= GINTMSK_SOFM;
+	}
 }
 
 static inline usbh_urb_t *_active_urb(usbh_ep_t *ep) {
@@ -290,10 +304,10 @@ static bool _activate_ep(USBHDriver *host, usbh_ep_t *ep) {
 			ep->in = FALSE;
 			ep->xfer.u.ctrl_phase = USBH_LLD_CTRLPHASE_SETUP;
 		} else {
-			xfer_len = urb->requestedLength;
-			ep->xfer.buf = urb->buff;
+			ep->xfer.buf = _usbh_urb_buffer(urb, &xfer_len);
 		}
 		ep->xfer.error_count = 0;
+		ep->xfer.naks = 0;
 	} else {
 		osalDbgCheck(urb->requestedLength >= urb->actualLength);
 
@@ -321,8 +335,7 @@ static bool _activate_ep(USBHDriver *host, usbh_ep_t *ep) {
 				hcchar |= HCCHAR_EPDIR;
 			}
 		} else {
-			xfer_len = urb->requestedLength - urb->actualLength;
-			ep->xfer.buf = (uint8_t *) urb->buff + urb->actualLength;
+			ep->xfer.buf = _usbh_urb_buffer(urb, &xfer_len);
 		}
 
 		if (ep->xfer.error_count)
@@ -465,33 +478,249 @@ static void _try_commit_np(USBHDriver *host) {
 	}
 }
 
-static void _try_commit_p(USBHDriver *host, bool sof) {
-	usbh_ep_t *item, *tmp;
+/*===========================================================================*/
+/* Periodic schedule.                                                        */
+/*===========================================================================*/
 
-	list_for_each_entry_safe(item, usbh_ep_t, tmp, &host->ep_pending_lists[USBH_EPTYPE_ISO], node) {
-		if (!_activate_ep(host, item))
-			return;
+#define _P_MASK		(STM32_USBH_PERIODIC_FRAMES - 1)
+
+static inline uint8_t _p_current(USBHDriver *host) {
+	return (uint8_t)(host->otg->HFNUM & _P_MASK);
+}
+
+/* Approximate bus time of one transaction, in byte times of the bus speed
+ * (USB 2.0 spec, 5.6.3, 5.7.3 and 5.8.4). There is no split transaction
+ * support, so the device speed is also the speed of the root port. */
+static uint16_t _p_bus_time(usbh_ep_t *ep) {
+	uint16_t t;
+	if (ep->device->speed == USBH_DEVSPEED_HIGH) {
+		t = ep->wMaxPacketSize + ((ep->type == USBH_EPTYPE_ISO) ? 38 : 55);
+	} else {
+		t = ep->wMaxPacketSize + ((ep->type == USBH_EPTYPE_ISO) ? 9 : 13);
+		if (ep->device->speed == USBH_DEVSPEED_LOW)
+			t *= 8;
 	}
+	return t;
+}
 
-	list_for_each_entry_safe(item, usbh_ep_t, tmp, &host->ep_pending_lists[USBH_EPTYPE_INT], node) {
-		osalDbgCheck(item);
-		/* TODO: improve this */
-		if (sof && item->xfer.u.frame_counter)
-			--item->xfer.u.frame_counter;
+/* Periodic bus time available in each (micro)frame */
+static uint16_t _p_budget(usbh_ep_t *ep) {
+	if (ep->device->speed == USBH_DEVSPEED_HIGH)
+		return STM32_USBH_PERIODIC_BUDGET_HS;
+	return STM32_USBH_PERIODIC_BUDGET_FS;
+}
 
-		if (item->xfer.u.frame_counter == 0) {
-			if (!_activate_ep(host, item))
-				return;
-			item->xfer.u.frame_counter = item->bInterval;
+/* Polling period in (micro)frames, rounded down to a power of 2 */
+static uint8_t _p_period(usbh_ep_t *ep) {
+	uint32_t interval;
+	uint8_t period;
+
+	if ((ep->type == USBH_EPTYPE_ISO) || (ep->device->speed == USBH_DEVSPEED_HIGH)) {
+		/* 2^(bInterval-1) */
+		if ((ep->bInterval == 0) || (ep->bInterval > 16)) {
+			interval = 1;
+		} else {
+			interval = 1U << (ep->bInterval - 1);
 		}
+	} else {
+		interval = ep->bInterval ? ep->bInterval : 1;
 	}
 
-	if (list_empty(&host->ep_pending_lists[USBH_EPTYPE_ISO])
-		&& list_empty(&host->ep_pending_lists[USBH_EPTYPE_INT])) {
-		host->otg->GINTMSK &= ~GINTMSK_SOFM;
+	for (period = 1; (period < STM32_USBH_PERIODIC_FRAMES) && ((uint32_t)period * 2 <= interval); period *= 2)
+		;
+	return period;
+}
+
+/* Reserve bus time for a periodic endpoint, choosing the least loaded phase */
+static bool _p_reserve(USBHDriver *host, usbh_ep_t *ep) {
+	const uint16_t t = _p_bus_time(ep);
+	const uint8_t period = _p_period(ep);
+	uint16_t best_load = 0xffff;
+	uint8_t best_phase = 0;
+	uint8_t phase, i;
+
+	for (phase = 0; phase < period; phase++) {
+		uint16_t load = 0;
+		for (i = phase; i < STM32_USBH_PERIODIC_FRAMES; i += period) {
+			if (host->p_load[i] > load)
+				load = host->p_load[i];
+		}
+		if (load < best_load) {
+			best_load = load;
+			best_phase = phase;
+		}
+	}
+
+	if (best_load + t > _p_budget(ep)) {
+		uepwarnf("Periodic budget exceeded (load=%d, need=%d)", best_load, t);
+		ep->p_period = 0;
+		return FALSE;
+	}
+
+	for (i = best_phase; i < STM32_USBH_PERIODIC_FRAMES; i += period) {
+		host->p_load[i] += t;
+	}
+	ep->p_load = t;
+	ep->p_period = period;
+	ep->p_phase = best_phase;
+	uepdbgf("Periodic: period=%d, phase=%d, load=%d", period, best_phase, best_load + t);
+	return TRUE;
+}
+
+static void _p_release(USBHDriver *host, usbh_ep_t *ep) {
+	uint8_t i;
+
+	if (ep->p_period == 0)
+		return;
+
+	for (i = ep->p_phase; i < STM32_USBH_PERIODIC_FRAMES; i += ep->p_period) {
+		host->p_load[i] -= ep->p_load;
+	}
+	ep->p_period = 0;
+}
+
+/* Put a pending periodic endpoint in the bucket of the first frame,
+ * starting from the current one, that matches its phase. */
+static void _p_schedule(USBHDriver *host, usbh_ep_t *ep) {
+	const uint8_t now = _p_current(host);
+	uint8_t due = (now & ~(ep->p_period - 1)) | ep->p_phase;
+
+	osalDbgCheck(ep->p_period != 0);
+
+	if (due < now)
+		due += ep->p_period;
+	due &= _P_MASK;
+
+	if (host->p_sched_map == 0) {
+		/* schedule was idle: resume serving from the current frame */
+		host->p_frame = (now - 1) & _P_MASK;
+	}
+
+	/* ISO endpoints go first */
+	if (ep->type == USBH_EPTYPE_ISO) {
+		list_move(&ep->node, &host->p_sched[due]);
 	} else {
-		host->otg->GINTMSK |= GINTMSK_SOFM;
+		list_move_tail(&ep->node, &host->p_sched[due]);
 	}
+	host->p_sched_map |= 1U << due;
+	host->otg->GINTMSK |= GINTMSK_SOFM;
+}
+
+static bool _p_serve(USBHDriver *host, uint8_t idx) {
+	struct list_head *const bucket = &host->p_sched[idx];
+	usbh_ep_t *item, *tmp;
+
+	list_for_each_entry_safe(item, usbh_ep_t, tmp, bucket, node) {
+		if (!_activate_ep(host, item)) {
+			/* no channels or queue space; retry on the next frame */
+			const uint8_t next = (idx + 1) & _P_MASK;
+			list_splice_tail_init(bucket, &host->p_sched[next]);
+			host->p_sched_map = (host->p_sched_map & ~(1U << idx)) | (1U << next);
+			return FALSE;
+		}
+		++host->p_activations;
+	}
+
+	host->p_sched_map &= ~(1U << idx);
+	return TRUE;
+}
+
+static void _try_commit_p(USBHDriver *host, bool sof) {
+	const uint8_t now = _p_current(host);
+
+	if (sof) {
+		++host->p_sof_count;
+		if (!(host->p_sched_map & (1U << now)))
+			++host->p_sof_idle;
+	}
+
+	/* serve the due buckets, including frames we may have missed */
+	while (host->p_sched_map) {
+		if ((host->p_sched_map & (1U << host->p_frame))
+				&& !_p_serve(host, host->p_frame))
+			break;
+		if (host->p_frame == now)
+			break;
+		host->p_frame = (host->p_frame + 1) & _P_MASK;
+	}
+
+	_update_sof_mask(host);
+}
+
+/*===========================================================================*/
+/* Bulk IN NAK back-off.                                                     */
+/*===========================================================================*/
+
+#define _FRNUM_MASK		0x3FFFU
+
+static void _np_wake_vt(void *p);
+
+/* Arm the wake up timer for the first sleeping endpoint due. A virtual timer
+ * is used rather than SOF, which would interrupt every frame of the sleep.
+ * The root port runs at full or low speed: frames are milliseconds. */
+static void _np_arm(USBHDriver *host) {
+	const uint16_t now = (uint16_t)(host->otg->HFNUM & _FRNUM_MASK);
+	uint16_t delay = _FRNUM_MASK;
+	usbh_ep_t *item;
+
+	if (list_empty(&host->ep_backoff_list)) {
+		chVTResetI(&host->nak_vt);
+		return;
+	}
+
+	list_for_each_entry(item, usbh_ep_t, &host->ep_backoff_list, node) {
+		uint16_t d = (uint16_t)((item->nak_wake - now) & _FRNUM_MASK);
+		if (d >= (_FRNUM_MASK / 2))
+			d = 0;	/* overdue */
+		if (d < delay)
+			delay = d;
+	}
+	if (delay == 0)
+		delay = 1;
+	chVTSetI(&host->nak_vt, OSAL_MS2I(delay), _np_wake_vt, host);
+}
+
+/* Put a Bulk IN endpoint that keeps NAKing to sleep for a while, so that
+ * an idle device doesn't flood us with NAK interrupts. */
+static void _np_sleep(USBHDriver *host, usbh_ep_t *ep) {
+	if (ep->nak_backoff == 0) {
+		ep->nak_backoff = 1;
+	} else if (ep->nak_backoff < STM32_USBH_BULK_NAK_BACKOFF_MAX) {
+		ep->nak_backoff *= 2;
+		if (ep->nak_backoff > STM32_USBH_BULK_NAK_BACKOFF_MAX)
+			ep->nak_backoff = STM32_USBH_BULK_NAK_BACKOFF_MAX;
+	}
+	ep->nak_wake = (uint16_t)((host->otg->HFNUM + ep->nak_backoff) & _FRNUM_MASK);
+	list_move_tail(&ep->node, &host->ep_backoff_list);
+	_np_arm(host);
+	uepdbgf("Sleep %d frames", ep->nak_backoff);
+}
+
+/* Move the endpoints whose sleep time has elapsed back to the pending queue */
+static void _np_wake(USBHDriver *host) {
+	const uint16_t now = (uint16_t)(host->otg->HFNUM & _FRNUM_MASK);
+	usbh_ep_t *item, *tmp;
+	bool woken = FALSE;
+
+	list_for_each_entry_safe(item, usbh_ep_t, tmp, &host->ep_backoff_list, node) {
+		if (((now - item->nak_wake) & _FRNUM_MASK) < (_FRNUM_MASK / 2)) {
+			/* a new burst of NAKs is tolerated, the back-off is kept */
+			item->xfer.naks = 0;
+			list_move_tail(&item->node, item->pending_list);
+			woken = TRUE;
+		}
+	}
+
+	_np_arm(host);
+	if (woken)
+		_try_commit_np(host);
+}
+
+static void _np_wake_vt(void *p) {
+	USBHDriver *const host = (USBHDriver *)p;
+	osalSysLockFromISR();
+	_np_wake(host);
+	osalSysUnlockFromISR();
 }
 
 static void _purge_queue(USBHDriver *host, struct list_head *list) {
@@ -517,10 +746,17 @@ static void _purge_active(USBHDriver *host) {
 }
 
 static void _purge_pending(USBHDriver *host) {
+	uint8_t i;
 	_purge_queue(host, &host->ep_pending_lists[0]);
 	_purge_queue(host, &host->ep_pending_lists[1]);
 	_purge_queue(host, &host->ep_pending_lists[2]);
 	_purge_queue(host, &host->ep_pending_lists[3]);
+	for (i = 0; i < STM32_USBH_PERIODIC_FRAMES; i++) {
+		_purge_queue(host, &host->p_sched[i]);
+	}
+	host->p_sched_map = 0;
+	_purge_queue(host, &host->ep_backoff_list);
+	chVTResetI(&host->nak_vt);
 }
 
 static uint32_t _write_packet(struct list_head *list, uint32_t space_available) {
@@ -608,7 +844,6 @@ void usbh_lld_ep_object_init(usbh_ep_t *ep) {
 		if (ep->in) {
 			hcintmsk |= HCINTMSK_DTERRM | HCINTMSK_BBERRM;
 		}
-		ep->xfer.u.frame_counter = 1;
 		break;
 	case USBH_EPTYPE_CTRL:
 		hcintmsk |= HCINTMSK_TRERRM | HCINTMSK_STALLM | HCINTMSK_NAKM;
@@ -626,6 +861,10 @@ void usbh_lld_ep_object_init(usbh_ep_t *ep) {
 	ep->pending_list = &host->ep_pending_lists[ep->type];
 	INIT_LIST_HEAD(&ep->urb_list);
 	INIT_LIST_HEAD(&ep->node);
+	ep->p_period = 0;
+	ep->nak_backoff = 0;
+	ep->nak_count = 0;
+	ep->int_count = 0;
 
 	ep->hcintmsk = hcintmsk;
 	ep->hcchar = HCCHAR_CHENA
@@ -638,9 +877,14 @@ void usbh_lld_ep_object_init(usbh_ep_t *ep) {
 			| HCCHAR_MPS(ep->wMaxPacketSize);
 }
 
-void usbh_lld_ep_open(usbh_ep_t *ep) {
+bool usbh_lld_ep_open(usbh_ep_t *ep) {
 	uepinfof("Open EP");
+	if (usbhEPIsPeriodic(ep) && !_p_reserve(ep->device->host, ep)) {
+		/* not enough periodic bandwidth; the endpoint stays closed */
+		return HAL_FAILED;
+	}
 	ep->status = USBH_EPSTATUS_OPEN;
+	return HAL_SUCCESS;
 }
 
 void usbh_lld_ep_close(usbh_ep_t *ep) {
@@ -651,6 +895,9 @@ void usbh_lld_ep_close(usbh_ep_t *ep) {
 		uepinfof("Abort URB, USBH_URBSTATUS_DISCONNECTED");
 		_usbh_urb_abort_and_waitS(urb, USBH_URBSTATUS_DISCONNECTED);
 	}
+	if (usbhEPIsPeriodic(ep)) {
+		_p_release(ep->device->host, ep);
+	}
 	uepinfof("Closed");
 	ep->status = USBH_EPSTATUS_CLOSED;
 }
@@ -670,6 +917,12 @@ void usbh_lld_urb_submit(usbh_urb_t *urb) {
 		return;
 	}
 
+	if (usbhEPIsPeriodic(ep) && (ep->p_period == 0)) {
+		uepwarnf("Can't submit URB, no periodic bandwidth reserved");
+		_usbh_urb_completeI(urb, USBH_URBSTATUS_ERROR);
+		return;
+	}
+
 	/* add the URB to the EP's queue */
 	list_add_tail(&urb->node, &ep->urb_list);
 
@@ -680,7 +933,8 @@ void usbh_lld_urb_submit(usbh_urb_t *urb) {
 		_move_to_pending_queue(ep);
 
 		if (usbhEPIsPeriodic(ep)) {
-			host->otg->GINTMSK |= GINTMSK_SOFM;
+			/* start it now if it is due in this frame */
+			_try_commit_p(host, FALSE);
 		} else {
 			/* try to queue non-periodic transfers */
 			_try_commit_np(ep->device->host);
@@ -732,6 +986,7 @@ static inline void _ack_int(USBHDriver *host, stm32_hc_management_t *hcm, stm32_
 	usbh_ep_t *const ep = hcm->ep;
 	osalDbgAssert(ep->type != USBH_EPTYPE_ISO, "ACK should not happen in ISO endpoints");
 	ep->xfer.error_count = 0;
+	ep->xfer.naks = 0;
 	hc->HCINTMSK &= ~HCINTMSK_ACKM;
 	uepdbgf("ACK");
 }
@@ -793,9 +1048,23 @@ static inline void _frmor_int(USBHDriver *host, stm32_hc_management_t *hcm, stm3
 static inline void _nak_int(USBHDriver *host, stm32_hc_management_t *hcm, stm32_otg_host_chn_t *hc) {
 	usbh_ep_t *const ep = hcm->ep;
 	osalDbgAssert(hcm->ep->type != USBH_EPTYPE_ISO, "NAK should not happen in ISO endpoints");
+	if ((ep->type == USBH_EPTYPE_BULK) || (ep->type == USBH_EPTYPE_CTRL)) {
+		/* an INT endpoint NAKs on each idle poll, that's not worth counting */
+		++ep->nak_count;
+		/* kept across channel releases, cleared by data, ACK or a new URB */
+		if (ep->xfer.naks < STM32_USBH_BULK_NAK_LIMIT)
+			++ep->xfer.naks;
+	}
 	if (!ep->in || (ep->type == USBH_EPTYPE_INT)) {
 		hc->HCINTMSK &= ~HCINTMSK_NAKM;
 		_halt_channel(host, hcm, USBH_LLD_HALTREASON_NAK);
+	} else if ((ep->type == USBH_EPTYPE_BULK)
+			&& ((ep->xfer.naks >= STM32_USBH_BULK_NAK_LIMIT)
+				|| !list_empty(&host->ep_pending_lists[USBH_EPTYPE_CTRL])
+				|| !list_empty(&host->ep_pending_lists[USBH_EPTYPE_BULK]))) {
+		/* release the channel: the endpoint is idle, or others are waiting */
+		hc->HCINTMSK &= ~HCINTMSK_NAKM;
+		_halt_channel(host, hcm, USBH_LLD_HALTREASON_NAK);
 	} else {
 		/* restart directly, no need to halt it in this case */
 		ep->xfer.error_count = 0;
@@ -820,12 +1089,15 @@ static inline void _stall_int(USBHDriver *host, stm32_hc_management_t *hcm, stm3
 static void _complete_bulk_int(USBHDriver *host, stm32_hc_management_t *hcm, usbh_ep_t *ep, usbh_urb_t *urb, uint32_t hctsiz) {
 	_release_channel(host, hcm);
 	_save_dt_mask(ep, hctsiz);
+	ep->nak_backoff = 0;
+	ep->xfer.naks = 0;
 	if (_update_urb(ep, hctsiz, urb, TRUE)) {
 		uepdbgf("done");
 		_transfer_completedI(ep, urb, USBH_URBSTATUS_OK);
 	} else {
-		osalDbgCheck(urb->requestedLength > 0x7FFFF);
-		uepwarnf("incomplete");
+		/* long transfer, or end of a scatter-gather segment */
+		osalDbgCheck((urb->requestedLength > 0x7FFFF) || (urb->segments != NULL));
+		uepdbgf("incomplete");
 		_move_to_pending_queue(ep);
 	}
 	if (usbhEPIsPeriodic(ep)) {
@@ -965,6 +1237,20 @@ static inline void _chh_int(USBHDriver *host, stm32_hc_management_t *hcm, stm32_
 		case USBH_LLD_HALTREASON_NAK:
 			if ((ep->type == USBH_EPTYPE_INT) && ep->in) {
 				_transfer_completedI(ep, urb, USBH_URBSTATUS_TIMEOUT);
+			} else if ((ep->type == USBH_EPTYPE_BULK) && ep->in) {
+				if (ep->xfer.packets != ((hctsiz & HCTSIZ_PKTCNT_MASK) >> 19)) {
+					/* got some data before the NAKs */
+					ep->nak_backoff = 0;
+					ep->xfer.naks = 0;
+				}
+				if (done) {
+					_transfer_completedI(ep, urb, USBH_URBSTATUS_OK);
+				} else if (ep->xfer.naks >= STM32_USBH_BULK_NAK_LIMIT) {
+					_np_sleep(host, ep);
+				} else {
+					/* yield the channel; go to the back of the queue */
+					_move_to_pending_queue(ep);
+				}
 			} else {
 				ep->xfer.error_count = 0;
 				_move_to_pending_queue(ep);
@@ -1020,6 +1306,7 @@ static void _hcint_n_int(USBHDriver *host, uint8_t chn) {
 
 	osalDbgCheck((hcint & HCINTMSK_AHBERRM) == 0);
 	osalDbgCheck(hcm->ep);
+	++hcm->ep->int_count;
 
 	if (hcint & HCINTMSK_STALLM)
 		_stall_int(host, hcm, hc);
@@ -1524,6 +1811,11 @@ static void _init(USBHDriver *host) {
 		INIT_LIST_HEAD(&host->ep_active_lists[i]);
 		INIT_LIST_HEAD(&host->ep_pending_lists[i]);
 	}
+	for (i = 0; i < STM32_USBH_PERIODIC_FRAMES; i++) {
+		INIT_LIST_HEAD(&host->p_sched[i]);
+	}
+	INIT_LIST_HEAD(&host->ep_backoff_list);
+	chVTObjectInit(&host->nak_vt);
 }
 
 void usbh_lld_init(void) {
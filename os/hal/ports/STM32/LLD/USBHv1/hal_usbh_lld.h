@@ -25,6 +25,56 @@
 #include "osal.h"
 #include "stm32_otg.h"
 
+/*===========================================================================*/
+/* Driver pre-compile time settings.                                         */
+/*===========================================================================*/
+
+/* Length of the periodic schedule, in (micro)frames. Must be a power of 2,
+ * at most 32. Longer polling intervals are clamped to this value. */
+#if !defined(STM32_USBH_PERIODIC_FRAMES)
+#define STM32_USBH_PERIODIC_FRAMES			32
+#endif
+
+/* Bus time reserved for periodic transfers in each full speed frame, in
+ * full speed byte times (default: 90% of a 1ms frame). */
+#if !defined(STM32_USBH_PERIODIC_BUDGET_FS)
+#define STM32_USBH_PERIODIC_BUDGET_FS		1350
+#endif
+
+/* Bus time reserved for periodic transfers in each high speed microframe,
+ * in high speed byte times (default: 80% of a 125us microframe). */
+#if !defined(STM32_USBH_PERIODIC_BUDGET_HS)
+#define STM32_USBH_PERIODIC_BUDGET_HS		6000
+#endif
+
+/* Consecutive NAKs tolerated on a Bulk IN endpoint before it is put to
+ * sleep. Bulk IN endpoints also give up their channel on the first NAK when
+ * other non-periodic endpoints are waiting; the NAKs are counted across
+ * these releases until data is received. */
+#if !defined(STM32_USBH_BULK_NAK_LIMIT)
+#define STM32_USBH_BULK_NAK_LIMIT			16
+#endif
+
+/* Maximum sleep time of a NAKing Bulk IN endpoint, in frames. The
+ * sleep time doubles each time the endpoint hits the NAK limit without
+ * receiving data. */
+#if !defined(STM32_USBH_BULK_NAK_BACKOFF_MAX)
+#define STM32_USBH_BULK_NAK_BACKOFF_MAX		8
+#endif
+
+#if (STM32_USBH_BULK_NAK_LIMIT < 1) || (STM32_USBH_BULK_NAK_LIMIT > 255)
+#error "STM32_USBH_BULK_NAK_LIMIT must be between 1 and 255"
+#endif
+
+#if (STM32_USBH_PERIODIC_BUDGET_FS > 1500) || (STM32_USBH_PERIODIC_BUDGET_HS > 7500)
+#error "STM32_USBH_PERIODIC_BUDGET_FS/HS exceed the (micro)frame length"
+#endif
+
+#if (STM32_USBH_PERIODIC_FRAMES > 32) \
+		|| (STM32_USBH_PERIODIC_FRAMES & (STM32_USBH_PERIODIC_FRAMES - 1))
+#error "STM32_USBH_PERIODIC_FRAMES must be a power of 2, not greater than 32"
+#endif
+
 /* TODO:
  *
  * - Implement ISO/INT OUT and test
@@ -72,7 +122,19 @@ typedef struct stm32_hc_management {
 	/* Enpoints being processed */									\
 	struct list_head ep_active_lists[4];							\
 	/* Pending endpoints */											\
-	struct list_head ep_pending_lists[4];
+	struct list_head ep_pending_lists[4];							\
+	/* Periodic schedule: pending ISO/INT endpoints, by due frame */	\
+	struct list_head p_sched[STM32_USBH_PERIODIC_FRAMES];			\
+	uint32_t p_sched_map;			/* non-empty buckets */			\
+	uint8_t p_frame;				/* last bucket served */		\
+	uint16_t p_load[STM32_USBH_PERIODIC_FRAMES];	/* bus time */	\
+	/* Periodic schedule statistics */								\
+	uint32_t p_sof_count;			/* SOF interrupts served */		\
+	uint32_t p_sof_idle;			/* ...with nothing due */		\
+	uint32_t p_activations;			/* periodic transfers started */	\
+	/* Bulk IN endpoints sleeping after a NAK burst */				\
+	struct list_head ep_backoff_list;								\
+	virtual_timer_t nak_vt;			/* wakes them up */
 
 
 #define _usbh_ep_ll_data																\
@@ -84,6 +146,16 @@ typedef struct stm32_hc_management {
 		uint32_t			hcchar;														\
 		uint32_t 			dt_mask;			/* data-toggle mask */					\
 		int32_t				trace_level;		/* enable tracing */					\
+		/* periodic schedule */															\
+		uint16_t			p_load;				/* reserved bus time */					\
+		uint8_t				p_period;			/* 0: no reservation */					\
+		uint8_t				p_phase;													\
+		/* Bulk IN NAK back-off */														\
+		uint16_t			nak_backoff;		/* current sleep time */				\
+		uint16_t			nak_wake;			/* frame number to wake up at */		\
+		/* statistics */																\
+		uint32_t			nak_count;			/* NAKs received (BULK, CTRL) */		\
+		uint32_t			int_count;			/* channel interrupts served */			\
 		/* current transfer */															\
 		struct {																		\
 			stm32_hc_management_t *hcm;				/* assigned channel */				\
@@ -92,10 +164,10 @@ typedef struct stm32_hc_management {
 			uint32_t			partial;			/* this transfer's partial length */\
 			uint16_t			packets;			/* packets allocated */				\
 			union {																		\
-				uint32_t			frame_counter;		/* frame counter (for INT) */	\
 				usbh_lld_ctrlphase_t	ctrl_phase;		/* control phase (for CTRL) */	\
 			} u;																		\
 			uint8_t				error_count;		/* error count */					\
+			uint8_t				naks;				/* consecutive NAKs */				\
 		} xfer;
 
 
@@ -134,7 +206,7 @@ void usbh_lld_init(void);
 void usbh_lld_start(USBHDriver *usbh);
 void usbh_lld_stop(USBHDriver *usbh);
 void usbh_lld_ep_object_init(usbh_ep_t *ep);
-void usbh_lld_ep_open(usbh_ep_t *ep);
+bool usbh_lld_ep_open(usbh_ep_t *ep);
 void usbh_lld_ep_close(usbh_ep_t *ep);
 bool usbh_lld_ep_reset(usbh_ep_t *ep);
 void usbh_lld_urb_submit(usbh_urb_t *urb);
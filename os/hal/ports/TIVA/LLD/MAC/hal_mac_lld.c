@@ -52,6 +52,25 @@
 #define EMAC_MIIADDR_MIIW       0x00000002  /* MII Write */
 #define EMAC_MIIADDR_MIIB       0x00000001  /* MII Busy */
 
+/* Transmit descriptor software states, scatter-gather mode.*/
+#define TXD_FREE                0           /* Available.                */
+#define TXD_RESERVED            1           /* Being filled.             */
+#define TXD_QUEUED              2           /* Given to the DMA.         */
+
+/* Receive completion interrupts are left to the watchdog when coalescing.*/
+#if TIVA_MAC_RX_WATCHDOG > 0
+#define RDES1_DIC               TIVA_RDES1_DIC
+#else
+#define RDES1_DIC               0
+#endif
+
+/* Received frames are accounted.*/
+#define RX_ACCOUNTING           ((TIVA_MAC_RX_BUDGET > 0) ||                \
+                                 TIVA_MAC_USE_RX_STATISTICS)
+
+#define NEXT_RD(rdes)           ((tiva_eth_rx_descriptor_t *)(rdes)->rdes3)
+#define NEXT_TD(tdes)           ((tiva_eth_tx_descriptor_t *)(tdes)->tdes3)
+
 /*===========================================================================*/
 /* Driver exported variables.                                                */
 /*===========================================================================*/
@@ -68,10 +87,12 @@ MACDriver ETHD1;
 static const uint8_t default_mac_address[] = {0xAA, 0x55, 0x13,
                                               0x37, 0x01, 0x10};
 
-static tiva_eth_rx_descriptor_t rd[TIVA_MAC_RECEIVE_BUFFERS];
-static tiva_eth_tx_descriptor_t td[TIVA_MAC_TRANSMIT_BUFFERS];
+static tiva_eth_rx_descriptor_t rd[TIVA_MAC_RECEIVE_DESCRIPTORS];
+static tiva_eth_tx_descriptor_t td[TIVA_MAC_TRANSMIT_DESCRIPTORS];
 
+#if !TIVA_MAC_USE_SCATTER_GATHER
 static uint32_t rb[TIVA_MAC_RECEIVE_BUFFERS][BUFFER_SIZE];
+#endif
 static uint32_t tb[TIVA_MAC_TRANSMIT_BUFFERS][BUFFER_SIZE];
 
 /*===========================================================================*/
@@ -195,7 +216,7 @@ static void mii_find_phy(MACDriver *macp)
 static void mac_lld_set_address(const uint8_t *p)
 {
   /* MAC address configuration, only a single address comparator is used,
-     hash table not used.*/
+     hash table cleared.*/
   HWREG(EMAC0_BASE + EMAC_O_ADDR0H)   = ((uint32_t)p[5] << 8) |
                   ((uint32_t)p[4] << 0);
   HWREG(EMAC0_BASE + EMAC_O_ADDR0L)   = ((uint32_t)p[3] << 24) |
@@ -212,6 +233,345 @@ static void mac_lld_set_address(const uint8_t *p)
   HWREG(EMAC0_BASE + EMAC_O_HASHTBLL) = 0;
 }
 
+/**
+ * @brief   Restarts the transmit DMA.
+ * @note    A poll demand is ignored by a running DMA, it is issued without
+ *          checking the state so that no lock is needed against a suspension
+ *          in progress.
+ */
+static void mac_lld_tx_resume(void)
+{
+  HWREG(EMAC0_BASE + EMAC_O_DMARIS)  = (1 << 2);
+  HWREG(EMAC0_BASE + EMAC_O_TXPOLLD) = 1; /* Any value is OK.*/
+}
+
+/**
+ * @brief   Restarts the receive DMA.
+ * @note    A poll demand is ignored by a running DMA, it is issued without
+ *          checking the state so that no lock is needed against a suspension
+ *          in progress.
+ */
+static void mac_lld_rx_resume(void)
+{
+  HWREG(EMAC0_BASE + EMAC_O_DMARIS)  = (1 << 7);
+  HWREG(EMAC0_BASE + EMAC_O_RXPOLLD) = 1; /* Any value is OK.*/
+}
+
+/**
+ * @brief   Decodes the checksum status of a received frame.
+ *
+ * @param[in] rdes0     first word of the last descriptor of the frame
+ * @return              The checksum status.
+ *
+ * @notapi
+ */
+static tiva_mac_rx_csum_t mac_lld_rx_csum(uint32_t rdes0)
+{
+#if TIVA_MAC_IP_CHECKSUM_OFFLOAD
+  switch (rdes0 & (TIVA_RDES0_FT | TIVA_RDES0_IPHCE | TIVA_RDES0_PCE)) {
+  case TIVA_RDES0_FT:
+    /* IPv4 or IPv6 frame, no error.*/
+    return TIVA_MAC_RX_CSUM_OK;
+  case TIVA_RDES0_PCE:
+    /* IPv4 or IPv6 frame, payload not supported.*/
+    return TIVA_MAC_RX_CSUM_IP;
+  case TIVA_RDES0_FT | TIVA_RDES0_PCE:
+  case TIVA_RDES0_FT | TIVA_RDES0_IPHCE:
+  case TIVA_RDES0_FT | TIVA_RDES0_IPHCE | TIVA_RDES0_PCE:
+    return TIVA_MAC_RX_CSUM_ERROR;
+  default:
+    /* Length frame, not an IP frame or reserved encoding.*/
+    return TIVA_MAC_RX_CSUM_NONE;
+  }
+#else
+  (void)rdes0;
+  return TIVA_MAC_RX_CSUM_NONE;
+#endif
+}
+
+/**
+ * @brief   Checks a received frame for checksum errors.
+ *
+ * @param[in] macp      pointer to the @p MACDriver object
+ * @param[in] rdes0     first word of the last descriptor of the frame
+ * @return              @p true if the frame has to be discarded.
+ *
+ * @notapi
+ */
+static bool mac_lld_rx_csum_error(MACDriver *macp, uint32_t rdes0)
+{
+  if (mac_lld_rx_csum(rdes0) != TIVA_MAC_RX_CSUM_ERROR)
+    return false;
+#if TIVA_MAC_USE_RX_STATISTICS
+  macp->rxstats.csum_errors++;
+#else
+  (void)macp;
+#endif
+  return true;
+}
+
+#if TIVA_MAC_USE_MULTICAST_HASH || defined(__DOXYGEN__)
+/**
+ * @brief   Loads the multicast hash table.
+ * @details Hash filtering of the multicast frames is enabled as long as an
+ *          address is in the table.
+ *
+ * @param[in] macp      pointer to the @p MACDriver object
+ *
+ * @notapi
+ */
+static void mac_lld_set_hash(MACDriver *macp)
+{
+  uint32_t table[2] = {0, 0};
+  unsigned i;
+
+  for (i = 0; i < 64; i++) {
+    if (macp->hashrefs[i] > 0)
+      table[i >> 5] |= 1U << (i & 31);
+  }
+  HWREG(EMAC0_BASE + EMAC_O_HASHTBLH) = table[1];
+  HWREG(EMAC0_BASE + EMAC_O_HASHTBLL) = table[0];
+  if ((table[0] | table[1]) != 0)
+    HWREG(EMAC0_BASE + EMAC_O_FRAMEFLTR) |= (1 << 2);
+  else
+    HWREG(EMAC0_BASE + EMAC_O_FRAMEFLTR) &= ~(1 << 2);
+}
+#endif /* TIVA_MAC_USE_MULTICAST_HASH */
+
+#if TIVA_MAC_USE_SCATTER_GATHER || defined(__DOXYGEN__)
+/**
+ * @brief   Returns the bounce buffer of a transmit descriptor.
+ *
+ * @return              The bounce buffer index, -1 for a caller buffer.
+ *
+ * @notapi
+ */
+static int sg_tx_bounce(tiva_eth_tx_descriptor_t *tdes)
+{
+  if ((tdes->tdes2 >= (uint32_t)tb[0]) &&
+      (tdes->tdes2 < (uint32_t)tb[0] + sizeof (tb)))
+    return (int)((tdes->tdes2 - (uint32_t)tb[0]) / sizeof (tb[0]));
+  return -1;
+}
+
+/**
+ * @brief   Gives a buffer to the next empty receive descriptor.
+ * @details The empty descriptors follow the filled ones in the ring, a
+ *          buffer is always re-armed in the order the DMA will reach it.
+ *
+ * @notapi
+ */
+static void sg_rx_recycle(MACDriver *macp, uint32_t buf)
+{
+  tiva_eth_rx_descriptor_t *rdes = macp->rxfill;
+
+  rdes->rdes2  = buf;
+  rdes->rdes0  = TIVA_RDES0_OWN;
+  macp->rxfill = NEXT_RD(rdes);
+  macp->rxempty--;
+}
+
+/**
+ * @brief   Discards the first @p n filled receive descriptors.
+ * @details While frames are held by the caller the descriptors join the
+ *          held ones, marked by a zero status, and are re-armed with them.
+ *
+ * @notapi
+ */
+static void sg_rx_purge(MACDriver *macp, size_t n)
+{
+  tiva_eth_rx_descriptor_t *rdes;
+  uint32_t buf;
+
+  while (n-- > 0) {
+    rdes = macp->rxptr;
+    macp->rxptr = NEXT_RD(rdes);
+    if (macp->rxheld > 0) {
+      rdes->rdes0 = 0;
+      macp->rxheld++;
+      continue;
+    }
+    buf  = rdes->rdes2;
+    rdes->rdes2 = 0;
+    macp->rxempty++;
+    sg_rx_recycle(macp, buf);
+  }
+  mac_lld_rx_resume();
+}
+
+/**
+ * @brief   Number of receive descriptors given to the DMA or filled.
+ *
+ * @notapi
+ */
+static size_t sg_rx_inflight(MACDriver *macp)
+{
+  return TIVA_MAC_RECEIVE_DESCRIPTORS - macp->rxempty - macp->rxheld;
+}
+
+/**
+ * @brief   Finds the next complete received frame.
+ * @details The frame starts at @p rxptr. Frames with errors, including
+ *          checksum errors, truncated frames and frames spanning more than
+ *          @p maxdesc descriptors are purged.
+ *
+ * @param[in] macp      pointer to the @p MACDriver object
+ * @param[in] maxdesc   maximum number of descriptors of the frame
+ * @param[out] np       number of descriptors of the frame
+ * @return              The last descriptor of the frame.
+ * @retval NULL         if no complete frame is available.
+ *
+ * @notapi
+ */
+static tiva_eth_rx_descriptor_t *sg_rx_find(MACDriver *macp, size_t maxdesc,
+                                           size_t *np)
+{
+  tiva_eth_rx_descriptor_t *rdes = macp->rxptr;
+  uint32_t rdes0;
+  size_t n = 0;
+
+  while (n < sg_rx_inflight(macp)) {
+    rdes0 = rdes->rdes0;
+    if (rdes0 & TIVA_RDES0_OWN)
+      return NULL;
+    if ((n == 0) != ((rdes0 & TIVA_RDES0_FS) != 0)) {
+      /* Stray descriptor or last descriptor lost, purging.*/
+      sg_rx_purge(macp, (n == 0) ? 1 : n);
+      rdes = macp->rxptr;
+      n = 0;
+      continue;
+    }
+    n++;
+    if (rdes0 & TIVA_RDES0_LS) {
+      if (!(rdes0 & (TIVA_RDES0_AFM | TIVA_RDES0_ES)) && (n <= maxdesc) &&
+          !mac_lld_rx_csum_error(macp, rdes0)) {
+        *np = n;
+        return rdes;
+      }
+      /* Invalid frame found, purging.*/
+      sg_rx_purge(macp, n);
+      rdes = macp->rxptr;
+      n = 0;
+      continue;
+    }
+    rdes = NEXT_RD(rdes);
+  }
+
+  /* A frame larger than the whole ring can never complete.*/
+  if (n == TIVA_MAC_RECEIVE_DESCRIPTORS)
+    sg_rx_purge(macp, n);
+  return NULL;
+}
+
+/**
+ * @brief   Locates the current read offset of a received frame.
+ *
+ * @param[in] rdp       pointer to a @p MACReceiveDescriptor structure
+ * @param[out] posp     offset of the byte within the descriptor buffer
+ * @return              The receive descriptor holding the byte.
+ *
+ * @notapi
+ */
+static tiva_eth_rx_descriptor_t *sg_rx_locate(MACReceiveDescriptor *rdp,
+                                             size_t *posp)
+{
+  tiva_eth_rx_descriptor_t *rdes = rdp->physdesc;
+  size_t bufsize = ETHD1.config->rx_buffer_size;
+  size_t pos = rdp->offset;
+
+  while (pos >= bufsize) {
+    pos -= bufsize;
+    rdes = NEXT_RD(rdes);
+  }
+  *posp = pos;
+  return rdes;
+}
+#endif /* TIVA_MAC_USE_SCATTER_GATHER */
+
+#if (TIVA_MAC_RX_BUDGET > 0) || defined(__DOXYGEN__)
+/**
+ * @brief   Leaves the polled receive mode.
+ * @details The receive interrupt is enabled again, frames already received
+ *          wake the receiving threads as the interrupt would have done.
+ *
+ * @param[in] macp      pointer to the @p MACDriver object
+ *
+ * @notapi
+ */
+static void mac_lld_rx_poll_exit(MACDriver *macp)
+{
+  macp->rxpolling = false;
+  HWREG(EMAC0_BASE + EMAC_O_DMARIS) = (1 << 6);
+  HWREG(EMAC0_BASE + EMAC_O_DMAIM) |= (1 << 6);
+
+  /* Checked after clearing the status, a frame completed later raises the
+     interrupt.*/
+#if TIVA_MAC_USE_SCATTER_GATHER
+  if (sg_rx_inflight(macp) == 0)
+    return;
+#endif
+  if (!(macp->rxptr->rdes0 & TIVA_RDES0_OWN)) {
+    osalThreadDequeueAllI(&macp->rdqueue, MSG_RESET);
+#if MAC_USE_EVENTS
+    osalEventBroadcastFlagsI(&macp->rdevent, 0);
+#endif
+    osalOsRescheduleS();
+  }
+}
+#endif /* TIVA_MAC_RX_BUDGET > 0 */
+
+#if RX_ACCOUNTING || defined(__DOXYGEN__)
+/**
+ * @brief   Starts a receive attempt.
+ * @details The polled mode is left when its budget is exhausted, the frames
+ *          still in the ring are returned anyway: the receive interrupt is
+ *          raised only by frames completed later, a caller failing now
+ *          would wait for them.
+ *
+ * @param[in] macp      pointer to the @p MACDriver object
+ *
+ * @notapi
+ */
+static void mac_lld_rx_begin(MACDriver *macp)
+{
+#if TIVA_MAC_RX_BUDGET > 0
+  if (macp->rxpolling && (macp->rxbudget == 0))
+    mac_lld_rx_poll_exit(macp);
+#else
+  (void)macp;
+#endif
+}
+
+/**
+ * @brief   Ends a receive attempt.
+ * @details The polled mode is left when the ring is empty.
+ *
+ * @param[in] macp      pointer to the @p MACDriver object
+ * @param[in] frame     a frame has been returned
+ *
+ * @notapi
+ */
+static void mac_lld_rx_end(MACDriver *macp, bool frame)
+{
+  if (frame) {
+#if TIVA_MAC_USE_RX_STATISTICS
+    macp->rxstats.frames++;
+    if (++macp->rxbatch > macp->rxstats.max_batch)
+      macp->rxstats.max_batch = macp->rxbatch;
+#endif
+#if TIVA_MAC_RX_BUDGET > 0
+    if (macp->rxpolling)
+      macp->rxbudget--;
+#endif
+  }
+#if TIVA_MAC_RX_BUDGET > 0
+  else if (macp->rxpolling) {
+    mac_lld_rx_poll_exit(macp);
+  }
+#endif
+}
+#endif /* RX_ACCOUNTING */
+
 /*===========================================================================*/
 /* Driver interrupt handlers.                                                */
 /*===========================================================================*/
@@ -225,9 +585,19 @@ CH_IRQ_HANDLER(TIVA_MAC_HANDLER)
   dmaris = HWREG(EMAC0_BASE + EMAC_O_DMARIS);
   HWREG(EMAC0_BASE + EMAC_O_DMARIS) = dmaris & 0x0001FFFF; /* Clear status bits.*/
 
-  if (dmaris & (1 << 6)) {
+  if ((dmaris & (1 << 6)) && (HWREG(EMAC0_BASE + EMAC_O_DMAIM) & (1 << 6))) {
     /* Data Received.*/
     osalSysLockFromISR();
+#if TIVA_MAC_RX_BUDGET > 0
+    /* Polled mode, the receiving thread enables the interrupt again.*/
+    HWREG(EMAC0_BASE + EMAC_O_DMAIM) &= ~(1 << 6);
+    ETHD1.rxpolling = true;
+    ETHD1.rxbudget  = TIVA_MAC_RX_BUDGET;
+#endif
+#if TIVA_MAC_USE_RX_STATISTICS
+    ETHD1.rxstats.interrupts++;
+    ETHD1.rxbatch = 0;
+#endif
     osalThreadDequeueAllI(&ETHD1.rdqueue, MSG_RESET);
 #if MAC_USE_EVENTS
     osalEventBroadcastFlagsI(&ETHD1.rdevent, 0);
@@ -256,22 +626,36 @@ CH_IRQ_HANDLER(TIVA_MAC_HANDLER)
  */
 void mac_lld_init(void)
 {
-  uint8_t i;
+  unsigned i;
 
   macObjectInit(&ETHD1);
   ETHD1.link_up = false;
+#if TIVA_MAC_USE_MULTICAST_HASH
+  for (i = 0; i < 64; i++)
+    ETHD1.hashrefs[i] = 0;
+#endif
 
   /* Descriptor tables are initialized in chained mode, note that the first
      word is not initialized here but in mac_lld_start().*/
-  for (i = 0; i < TIVA_MAC_RECEIVE_BUFFERS; i++) {
-    rd[i].rdes1 = TIVA_RDES1_RCH | TIVA_RDES1_RBS1(TIVA_MAC_BUFFERS_SIZE);
+  for (i = 0; i < TIVA_MAC_RECEIVE_DESCRIPTORS; i++) {
+#if TIVA_MAC_USE_SCATTER_GATHER
+    /* Buffers and sizes come from the configuration.*/
+    rd[i].rdes2 = 0;
+#else
+    rd[i].rdes1 = RDES1_DIC | TIVA_RDES1_RCH |
+                  TIVA_RDES1_RBS1(TIVA_MAC_BUFFERS_SIZE);
     rd[i].rdes2 = (uint32_t)rb[i];
-    rd[i].rdes3 = (uint32_t)&rd[(i + 1) % TIVA_MAC_RECEIVE_BUFFERS];
+#endif
+    rd[i].rdes3 = (uint32_t)&rd[(i + 1) % TIVA_MAC_RECEIVE_DESCRIPTORS];
   }
-  for (i = 0; i < TIVA_MAC_TRANSMIT_BUFFERS; i++) {
+  for (i = 0; i < TIVA_MAC_TRANSMIT_DESCRIPTORS; i++) {
     td[i].tdes1 = 0;
+#if TIVA_MAC_USE_SCATTER_GATHER
+    td[i].tdes2 = 0;
+#else
     td[i].tdes2 = (uint32_t)tb[i];
-    td[i].tdes3 = (uint32_t)&td[(i + 1) % TIVA_MAC_TRANSMIT_BUFFERS];
+#endif
+    td[i].tdes3 = (uint32_t)&td[(i + 1) % TIVA_MAC_TRANSMIT_DESCRIPTORS];
   }
 
   /* Enable MAC clock */
@@ -359,8 +743,36 @@ void mac_lld_init(void)
  */
 void mac_lld_start(MACDriver *macp)
 {
-  uint8_t i;
-
+  unsigned i;
+
+#if TIVA_MAC_USE_SCATTER_GATHER
+  osalDbgCheck((macp->config->rx_alloc != NULL) &&
+               (macp->config->rx_buffer_size > 0) &&
+               ((macp->config->rx_buffer_size & 3) == 0) &&
+               (macp->config->rx_buffer_size <= TIVA_RDES1_RBS1_MASK));
+
+  /* Resets the state of all descriptors, the receive ring is filled from
+     the pool once the DMA is running.*/
+  for (i = 0; i < TIVA_MAC_RECEIVE_DESCRIPTORS; i++) {
+    rd[i].rdes0 = 0;
+    rd[i].rdes1 = RDES1_DIC | TIVA_RDES1_RCH |
+                  TIVA_RDES1_RBS1(macp->config->rx_buffer_size);
+  }
+  macp->rxptr   = (tiva_eth_rx_descriptor_t *)rd;
+  macp->rxfill  = (tiva_eth_rx_descriptor_t *)rd;
+  macp->rxempty = TIVA_MAC_RECEIVE_DESCRIPTORS;
+  macp->rxheld  = 0;
+
+  for (i = 0; i < TIVA_MAC_TRANSMIT_DESCRIPTORS; i++) {
+    td[i].tdes0  = TIVA_TDES0_TCH;
+    td[i].tdes2  = 0;
+    td[i].locked = TXD_FREE;
+    td[i].cookie = NULL;
+  }
+  macp->txptr    = (tiva_eth_tx_descriptor_t *)td;
+  macp->txtail   = (tiva_eth_tx_descriptor_t *)td;
+  macp->txbounce = 0xFFFFFFFFU >> (32 - TIVA_MAC_TRANSMIT_BUFFERS);
+#else
   /* Resets the state of all descriptors.*/
   for (i = 0; i < TIVA_MAC_RECEIVE_BUFFERS; i++) {
     rd[i].rdes0 = TIVA_RDES0_OWN;
@@ -372,6 +784,7 @@ void mac_lld_start(MACDriver *macp)
     td[i].locked = 0;
   }
   macp->txptr = (tiva_eth_tx_descriptor_t *)td;
+#endif
 
   /* Enable MAC clock */
   HWREG(SYSCTL_RCGCEMAC) = 1;
@@ -401,6 +814,9 @@ void mac_lld_start(MACDriver *macp)
     mac_lld_set_address(default_mac_address);
   else
     mac_lld_set_address(macp->config->mac_address);
+#if TIVA_MAC_USE_MULTICAST_HASH
+  mac_lld_set_hash(macp);
+#endif
 
   /* Transmitter and receiver enabled.
      Note that the complete setup of the MAC is performed when the link
@@ -416,6 +832,13 @@ void mac_lld_start(MACDriver *macp)
   HWREG(EMAC0_BASE + EMAC_O_RXDLADDR) = (uint32_t)rd;
   HWREG(EMAC0_BASE + EMAC_O_TXDLADDR) = (uint32_t)td;
 
+#if TIVA_MAC_RX_BUDGET > 0
+  macp->rxpolling = false;
+#endif
+
+  /* Receive interrupt coalescing.*/
+  HWREG(EMAC0_BASE + EMAC_O_RXINTWDT) = TIVA_MAC_RX_WATCHDOG;
+
   /* Enabling required interrupt sources.*/
   HWREG(EMAC0_BASE + EMAC_O_DMARIS) &= 0xFFFF;
   HWREG(EMAC0_BASE + EMAC_O_DMAIM) = (1 << 16) | (1 << 6) | (1 << 0);
@@ -431,6 +854,10 @@ void mac_lld_start(MACDriver *macp)
   /* DMA final configuration and start.*/
   HWREG(EMAC0_BASE + EMAC_O_DMAOPMODE) = (1 << 26) | (1 << 25) | (1 << 21) |
                         (1 << 13) | (1 << 1);
+
+#if TIVA_MAC_USE_SCATTER_GATHER
+  (void)tivaMacRefillReceive(macp);
+#endif
 }
 
 /**
@@ -454,6 +881,27 @@ void mac_lld_stop(MACDriver *macp)
     HWREG(EMAC0_BASE + EMAC_O_DMAIM) = 0;
     HWREG(EMAC0_BASE + EMAC_O_DMARIS) &= 0xFFFF;
 
+#if TIVA_MAC_USE_SCATTER_GATHER
+    {
+      unsigned i;
+
+      /* Buffers still attached to the rings are returned to their owners,
+         the pending frames are not going to be sent.*/
+      for (i = 0; i < TIVA_MAC_RECEIVE_DESCRIPTORS; i++) {
+        if ((rd[i].rdes2 != 0) && (macp->config->rx_free != NULL))
+          macp->config->rx_free(macp, (void *)rd[i].rdes2);
+        rd[i].rdes2 = 0;
+      }
+      for (i = 0; i < TIVA_MAC_TRANSMIT_DESCRIPTORS; i++) {
+        if ((td[i].locked == TXD_QUEUED) && (td[i].cookie != NULL) &&
+            (macp->config->tx_done != NULL))
+          macp->config->tx_done(macp, td[i].cookie);
+        td[i].locked = TXD_FREE;
+        td[i].cookie = NULL;
+      }
+    }
+#endif
+
     /* MAC clocks stopped.*/
     HWREG(SYSCTL_RCGCEMAC) = 0;
 
@@ -482,10 +930,31 @@ msg_t mac_lld_get_transmit_descriptor(MACDriver *macp,
                                       MACTransmitDescriptor *tdp)
 {
   tiva_eth_tx_descriptor_t *tdes;
+#if TIVA_MAC_USE_SCATTER_GATHER
+  unsigned i;
+#endif
 
   if (!macp->link_up)
     return MSG_TIMEOUT;
 
+#if TIVA_MAC_USE_SCATTER_GATHER
+  (void)tivaMacReclaimTransmit(macp);
+
+  osalSysLock();
+
+  /* Get Current TX descriptor and a bounce buffer.*/
+  tdes = macp->txptr;
+  if ((tdes->locked != TXD_FREE) || (macp->txbounce == 0)) {
+    osalSysUnlock();
+    return MSG_TIMEOUT;
+  }
+  for (i = 0; (macp->txbounce & (1U << i)) == 0; i++)
+    ;
+  macp->txbounce &= ~(1U << i);
+  tdes->tdes2  = (uint32_t)tb[i];
+  tdes->cookie = NULL;
+  tdes->locked = TXD_RESERVED;
+#else
   osalSysLock();
 
   /* Get Current TX descriptor.*/
@@ -500,6 +969,7 @@ msg_t mac_lld_get_transmit_descriptor(MACDriver *macp,
 
   /* Marks the current descriptor as locked.*/
   tdes->locked = 1;
+#endif
 
   /* Next TX descriptor to use.*/
   macp->txptr = (tiva_eth_tx_descriptor_t *)tdes->tdes3;
@@ -510,6 +980,7 @@ msg_t mac_lld_get_transmit_descriptor(MACDriver *macp,
   tdp->offset   = 0;
   tdp->size     = TIVA_MAC_BUFFERS_SIZE;
   tdp->physdesc = tdes;
+  tdp->csum     = (tiva_mac_csum_t)TIVA_MAC_IP_CHECKSUM_OFFLOAD;
 
   return MSG_OK;
 }
@@ -517,6 +988,8 @@ msg_t mac_lld_get_transmit_descriptor(MACDriver *macp,
 /**
  * @brief   Releases a transmit descriptor and starts the transmission of the
  *          enqueued data as a single frame.
+ * @note    No lock is needed, the descriptor is handed over by the single
+ *          store setting its OWN bit.
  *
  * @param[in] tdp       the pointer to the @p MACTransmitDescriptor structure
  *
@@ -527,22 +1000,19 @@ void mac_lld_release_transmit_descriptor(MACTransmitDescriptor *tdp)
   osalDbgAssert(!(tdp->physdesc->tdes0 & TIVA_TDES0_OWN),
               "attempt to release descriptor already owned by DMA");
 
-  osalSysLock();
-
   /* Unlocks the descriptor and returns it to the DMA engine.*/
   tdp->physdesc->tdes1 = tdp->offset;
-  tdp->physdesc->tdes0 = TIVA_TDES0_CIC(TIVA_MAC_IP_CHECKSUM_OFFLOAD) |
+  tdp->physdesc->tdes0 = TIVA_TDES0_CIC((uint32_t)tdp->csum) |
                          TIVA_TDES0_IC | TIVA_TDES0_LS | TIVA_TDES0_FS |
                          TIVA_TDES0_TCH | TIVA_TDES0_OWN;
+#if TIVA_MAC_USE_SCATTER_GATHER
+  tdp->physdesc->locked = TXD_QUEUED;
+#else
   tdp->physdesc->locked = 0;
+#endif
 
   /* If the DMA engine is stalled then a restart request is issued.*/
-  if ((HWREG(EMAC0_BASE + EMAC_O_DMARIS) & (0x7 << 20)) == (6 << 20)) {
-    HWREG(EMAC0_BASE + EMAC_O_DMARIS)   = (1 << 2);
-    HWREG(EMAC0_BASE + EMAC_O_TXPOLLD) = 1; /* Any value is OK.*/
-  }
-
-  osalSysUnlock();
+  mac_lld_tx_resume();
 }
 
 /**
@@ -560,9 +1030,40 @@ msg_t mac_lld_get_receive_descriptor(MACDriver *macp,
                                      MACReceiveDescriptor *rdp)
 {
   tiva_eth_rx_descriptor_t *rdes;
+#if TIVA_MAC_USE_SCATTER_GATHER
+  size_t n;
+#endif
 
   osalSysLock();
 
+#if RX_ACCOUNTING
+  mac_lld_rx_begin(macp);
+#endif
+
+#if TIVA_MAC_USE_SCATTER_GATHER
+  /* Invalid frames are discarded, the descriptors of the returned frame
+     are held, untouched, until released.*/
+  rdes = sg_rx_find(macp, TIVA_MAC_RECEIVE_DESCRIPTORS, &n);
+  if (rdes == NULL) {
+#if RX_ACCOUNTING
+    mac_lld_rx_end(macp, false);
+#endif
+    osalSysUnlock();
+    return MSG_TIMEOUT;
+  }
+  rdp->offset   = 0;
+  rdp->size     = ((rdes->rdes0 & TIVA_RDES0_FL_MASK) >> 16) - 4;
+  rdp->physdesc = macp->rxptr;
+  rdp->csum     = mac_lld_rx_csum(rdes->rdes0);
+  macp->rxptr   = NEXT_RD(rdes);
+  macp->rxheld += n;
+
+#if RX_ACCOUNTING
+  mac_lld_rx_end(macp, true);
+#endif
+  osalSysUnlock();
+  return MSG_OK;
+#else
   /* Get Current RX descriptor.*/
   rdes = macp->rxptr;
 
@@ -570,17 +1071,18 @@ msg_t mac_lld_get_receive_descriptor(MACDriver *macp,
      frames are discarded.*/
   while (!(rdes->rdes0 & TIVA_RDES0_OWN)) {
     if (!(rdes->rdes0 & (TIVA_RDES0_AFM | TIVA_RDES0_ES))
-#if TIVA_MAC_IP_CHECKSUM_OFFLOAD
-        && (rdes->rdes0 & TIVA_RDES0_FT)
-        && !(rdes->rdes0 & (TIVA_RDES0_IPHCE | TIVA_RDES0_PCE))
-#endif
-        && (rdes->rdes0 & TIVA_RDES0_FS) && (rdes->rdes0 & TIVA_RDES0_LS)) {
+        && (rdes->rdes0 & TIVA_RDES0_FS) && (rdes->rdes0 & TIVA_RDES0_LS)
+        && !mac_lld_rx_csum_error(macp, rdes->rdes0)) {
       /* Found a valid one.*/
       rdp->offset   = 0;
       rdp->size     = ((rdes->rdes0 & TIVA_RDES0_FL_MASK) >> 16) - 4;
       rdp->physdesc = rdes;
+      rdp->csum     = mac_lld_rx_csum(rdes->rdes0);
       macp->rxptr   = (tiva_eth_rx_descriptor_t *)rdes->rdes3;
 
+#if RX_ACCOUNTING
+      mac_lld_rx_end(macp, true);
+#endif
       osalSysUnlock();
       return MSG_OK;
     }
@@ -592,14 +1094,23 @@ msg_t mac_lld_get_receive_descriptor(MACDriver *macp,
   /* Next descriptor to check.*/
   macp->rxptr = rdes;
 
+#if RX_ACCOUNTING
+  mac_lld_rx_end(macp, false);
+#endif
   osalSysUnlock();
   return MSG_TIMEOUT;
+#endif
 }
 
 /**
  * @brief   Releases a receive descriptor.
  * @details The descriptor and its buffer are made available for more incoming
  *          frames.
+ * @note    No lock is needed unless in scatter-gather mode, the descriptor
+ *          is handed over by the single store setting its OWN bit.
+ * @note    In scatter-gather mode the descriptors must be released in the
+ *          order they were obtained. The buffers are re-armed in place,
+ *          or moved to the empty descriptors preceding them.
  *
  * @param[in] rdp       the pointer to the @p MACReceiveDescriptor structure
  *
@@ -607,21 +1118,40 @@ msg_t mac_lld_get_receive_descriptor(MACDriver *macp,
  */
 void mac_lld_release_receive_descriptor(MACReceiveDescriptor *rdp)
 {
+#if TIVA_MAC_USE_SCATTER_GATHER
+  tiva_eth_rx_descriptor_t *rdes = rdp->physdesc;
+  bool last;
+#endif
+
   osalDbgAssert(!(rdp->physdesc->rdes0 & TIVA_RDES0_OWN),
               "attempt to release descriptor already owned by DMA");
 
+#if TIVA_MAC_USE_SCATTER_GATHER
   osalSysLock();
 
+  osalDbgAssert((ETHD1.rxheld > 0) && (rdes->rdes0 & TIVA_RDES0_FS),
+                "receive descriptor not held");
+
+  /* Give the buffers back to the Ethernet DMA, in ring order, together
+     with the descriptors purged behind the frame.*/
+  last = false;
+  while ((ETHD1.rxheld > 0) && (!last || !(rdes->rdes0 & TIVA_RDES0_FS))) {
+    if (!last)
+      last = (rdes->rdes0 & TIVA_RDES0_LS) != 0;
+    ETHD1.rxheld--;
+    ETHD1.rxempty++;
+    sg_rx_recycle(&ETHD1, rdes->rdes2);
+    rdes = NEXT_RD(rdes);
+  }
+
+  osalSysUnlock();
+#else
   /* Give buffer back to the Ethernet DMA.*/
   rdp->physdesc->rdes0 = TIVA_RDES0_OWN;
+#endif
 
   /* If the DMA engine is stalled then a restart request is issued.*/
-  if ((HWREG(EMAC0_BASE + EMAC_O_STATUS) & (0xf << 17)) == (4 << 17)) {
-    HWREG(EMAC0_BASE + EMAC_O_DMARIS)   = (1 << 7);
-    HWREG(EMAC0_BASE + EMAC_O_TXPOLLD) = 1; /* Any value is OK.*/
-  }
-
-  osalSysUnlock();
+  mac_lld_rx_resume();
 }
 
 /**
@@ -742,16 +1272,33 @@ size_t mac_lld_read_receive_descriptor(MACReceiveDescriptor *rdp,
                                        uint8_t *buf,
                                        size_t size)
 {
+#if TIVA_MAC_USE_SCATTER_GATHER
+  tiva_eth_rx_descriptor_t *rdes;
+  size_t done, pos, n;
+#endif
+
   osalDbgAssert(!(rdp->physdesc->rdes0 & TIVA_RDES0_OWN),
               "attempt to read descriptor already owned by DMA");
 
   if (size > rdp->size - rdp->offset)
     size = rdp->size - rdp->offset;
 
+#if TIVA_MAC_USE_SCATTER_GATHER
+  /* The frame can span several descriptors.*/
+  for (done = 0; done < size; done += n) {
+    rdes = sg_rx_locate(rdp, &pos);
+    n = ETHD1.config->rx_buffer_size - pos;
+    if (n > size - done)
+      n = size - done;
+    memcpy(buf + done, (uint8_t *)(rdes->rdes2) + pos, n);
+    rdp->offset += n;
+  }
+#else
   if (size > 0) {
     memcpy(buf, (uint8_t *)(rdp->physdesc->rdes2) + rdp->offset, size);
     rdp->offset += size;
   }
+#endif
   return size;
 }
 
@@ -807,17 +1354,421 @@ uint8_t *mac_lld_get_next_transmit_buffer(MACTransmitDescriptor *tdp,
 const uint8_t *mac_lld_get_next_receive_buffer(MACReceiveDescriptor *rdp,
                                                size_t *sizep)
 {
+#if TIVA_MAC_USE_SCATTER_GATHER
+  tiva_eth_rx_descriptor_t *rdes;
+  size_t pos;
+
+  /* One buffer per descriptor of the frame.*/
+  if (rdp->offset < rdp->size) {
+    rdes   = sg_rx_locate(rdp, &pos);
+    *sizep = ETHD1.config->rx_buffer_size - pos;
+    if (*sizep > rdp->size - rdp->offset)
+      *sizep = rdp->size - rdp->offset;
+    rdp->offset += *sizep;
+    return (uint8_t *)rdes->rdes2 + pos;
+  }
+#else
   if (rdp->size > 0) {
     *sizep      = rdp->size;
     rdp->offset = rdp->size;
     rdp->size   = 0;
     return (uint8_t *)rdp->physdesc->rdes2;
   }
+#endif
   *sizep = 0;
   return NULL;
 }
 #endif /* MAC_USE_ZERO_COPY */
 
+#if TIVA_MAC_USE_SCATTER_GATHER || defined(__DOXYGEN__)
+/**
+ * @brief   Queues a frame made of several buffers.
+ * @details The buffers are not copied, they must stay valid until the
+ *          @p tx_done callback of the configuration is invoked with
+ *          @p cookie by @p tivaMacReclaimTransmit().
+ * @note    No lock is held while the descriptors are written, the frame is
+ *          handed over by the store setting the OWN bit of its first
+ *          descriptor.
+ *
+ * @param[in] macp      pointer to the @p MACDriver object
+ * @param[in] segs      array of @p n frame segments, not empty
+ * @param[in] n         number of segments
+ * @param[in] csum      checksum insertion mode
+ * @param[in] cookie    completion cookie, can be @p NULL
+ * @return              The operation status.
+ * @retval MSG_OK       the frame has been queued.
+ * @retval MSG_TIMEOUT  not enough free descriptors or link down.
+ *
+ * @api
+ */
+msg_t tivaMacTransmitFrame(MACDriver *macp, const tiva_mac_segment_t *segs,
+                           size_t n, tiva_mac_csum_t csum, void *cookie)
+{
+  tiva_eth_tx_descriptor_t *first, *tdes;
+  uint32_t tdes0, fs0 = 0;
+  size_t i;
+
+  osalDbgCheck((segs != NULL) && (n > 0) &&
+               (n <= TIVA_MAC_TRANSMIT_DESCRIPTORS));
+
+  if (!macp->link_up)
+    return MSG_TIMEOUT;
+
+  /* Reserves the descriptors, all of them or none.*/
+  osalSysLock();
+  first = macp->txptr;
+  for (i = 0, tdes = first; i < n; i++, tdes = NEXT_TD(tdes)) {
+    if (tdes->locked != TXD_FREE) {
+      osalSysUnlock();
+      return MSG_TIMEOUT;
+    }
+  }
+  for (i = 0, tdes = first; i < n; i++, tdes = NEXT_TD(tdes))
+    tdes->locked = TXD_RESERVED;
+  macp->txptr = tdes;
+  osalSysUnlock();
+
+  /* One descriptor per segment, the first descriptor is given to the DMA
+     last so that a partial frame is never seen.*/
+  for (i = 0, tdes = first; i < n; i++, tdes = NEXT_TD(tdes)) {
+    osalDbgAssert((segs[i].size > 0) && (segs[i].size <= TIVA_TDES1_TBS1_MASK),
+                  "invalid segment size");
+
+    tdes0 = TIVA_TDES0_TCH;
+    if (i == 0)
+      tdes0 |= TIVA_TDES0_CIC((uint32_t)csum) | TIVA_TDES0_FS;
+    if (i == n - 1)
+      tdes0 |= TIVA_TDES0_IC | TIVA_TDES0_LS;
+    tdes->cookie = (i == n - 1) ? cookie : NULL;
+    tdes->tdes2  = (uint32_t)segs[i].buf;
+    tdes->tdes1  = TIVA_TDES1_TBS1(segs[i].size);
+    if (i == 0) {
+      fs0 = tdes0;
+    }
+    else {
+      tdes->tdes0  = tdes0 | TIVA_TDES0_OWN;
+      tdes->locked = TXD_QUEUED;
+    }
+  }
+  first->tdes0  = fs0 | TIVA_TDES0_OWN;
+  first->locked = TXD_QUEUED;
+
+  mac_lld_tx_resume();
+
+  return MSG_OK;
+}
+
+/**
+ * @brief   Reclaims the descriptors of the transmitted frames.
+ * @details The @p tx_done callback of the configuration is invoked, outside
+ *          of any critical zone, for each completed frame queued by
+ *          @p tivaMacTransmitFrame().
+ *
+ * @param[in] macp      pointer to the @p MACDriver object
+ * @return              The number of completed frames.
+ *
+ * @api
+ */
+size_t tivaMacReclaimTransmit(MACDriver *macp)
+{
+  tiva_eth_tx_descriptor_t *tdes;
+  uint32_t tdes0;
+  void *cookie;
+  size_t n = 0;
+  int i;
+
+  while (true) {
+    osalSysLock();
+    tdes = macp->txtail;
+    tdes0 = tdes->tdes0;
+    if ((tdes->locked != TXD_QUEUED) || (tdes0 & TIVA_TDES0_OWN)) {
+      osalSysUnlock();
+      break;
+    }
+    cookie = tdes->cookie;
+    i = sg_tx_bounce(tdes);
+    if (i >= 0)
+      macp->txbounce |= 1U << i;
+    tdes->cookie = NULL;
+    tdes->locked = TXD_FREE;
+    macp->txtail = NEXT_TD(tdes);
+    osalSysUnlock();
+
+    if (tdes0 & TIVA_TDES0_LS) {
+      n++;
+      if ((cookie != NULL) && (macp->config->tx_done != NULL))
+        macp->config->tx_done(macp, cookie);
+    }
+  }
+  return n;
+}
+
+/**
+ * @brief   Takes a received frame.
+ * @details The frame buffers are handed over to the caller without copy,
+ *          their descriptors are refilled from the pool of the configuration.
+ *          The last segment can be empty when the frame CRC spans it.
+ * @note    Receive side functions must be called by a single thread.
+ * @note    Not to be called while frames obtained through
+ *          @p mac_lld_get_receive_descriptor() are held.
+ *
+ * @param[in] macp      pointer to the @p MACDriver object
+ * @param[out] segs     array of frame segments
+ * @param[in,out] np    size of the @p segs array, on exit the number of
+ *                      segments of the frame, frames with more segments are
+ *                      discarded
+ * @param[out] csump    checksum status of the frame, can be @p NULL
+ * @return              The operation status.
+ * @retval MSG_OK       a frame has been received.
+ * @retval MSG_TIMEOUT  no frame available.
+ *
+ * @api
+ */
+msg_t tivaMacReceiveFrame(MACDriver *macp, tiva_mac_segment_t *segs,
+                          size_t *np, tiva_mac_rx_csum_t *csump)
+{
+  tiva_eth_rx_descriptor_t *rdes, *last;
+  size_t bufsize = macp->config->rx_buffer_size;
+  size_t i, n, fl;
+
+  osalDbgCheck((segs != NULL) && (np != NULL) && (*np > 0));
+  osalDbgAssert(macp->rxheld == 0, "receive descriptors held");
+
+#if RX_ACCOUNTING
+  osalSysLock();
+  mac_lld_rx_begin(macp);
+  osalSysUnlock();
+#endif
+
+  /* Buffers freed since the pool ran out are put to use.*/
+  (void)tivaMacRefillReceive(macp);
+
+  last = sg_rx_find(macp, *np, &n);
+  if (last == NULL) {
+#if RX_ACCOUNTING
+    osalSysLock();
+    mac_lld_rx_end(macp, false);
+    osalSysUnlock();
+#endif
+    return MSG_TIMEOUT;
+  }
+
+  /* Frame length without the CRC.*/
+  fl = (last->rdes0 & TIVA_RDES0_FL_MASK) >> 16;
+  fl = (fl > 4) ? fl - 4 : 0;
+
+  rdes = macp->rxptr;
+  for (i = 0; i < n; i++) {
+    segs[i].buf  = (void *)rdes->rdes2;
+    segs[i].size = (fl < bufsize) ? fl : bufsize;
+    fl -= segs[i].size;
+    rdes->rdes2 = 0;
+    rdes = NEXT_RD(rdes);
+  }
+  macp->rxptr = rdes;
+  macp->rxempty += n;
+  *np = n;
+  if (csump != NULL)
+    *csump = mac_lld_rx_csum(last->rdes0);
+
+#if RX_ACCOUNTING
+  osalSysLock();
+  mac_lld_rx_end(macp, true);
+  osalSysUnlock();
+#endif
+
+  (void)tivaMacRefillReceive(macp);
+
+  return MSG_OK;
+}
+
+/**
+ * @brief   Refills the empty receive descriptors from the pool.
+ * @note    Already done by @p tivaMacReceiveFrame(), to be called when the
+ *          pool had run out and buffers are returned to it.
+ * @note    Receive side functions must be called by a single thread.
+ *
+ * @param[in] macp      pointer to the @p MACDriver object
+ * @return              The number of descriptors refilled.
+ *
+ * @api
+ */
+size_t tivaMacRefillReceive(MACDriver *macp)
+{
+  void *buf;
+  size_t n = 0;
+
+  while (macp->rxempty > 0) {
+    buf = macp->config->rx_alloc(macp);
+    if (buf == NULL)
+      break;
+    osalDbgAssert(((uint32_t)buf & 3) == 0, "unaligned buffer");
+    sg_rx_recycle(macp, (uint32_t)buf);
+    n++;
+  }
+
+  /* The DMA suspends on an empty descriptor.*/
+  if (n > 0)
+    mac_lld_rx_resume();
+  return n;
+}
+
+#endif /* TIVA_MAC_USE_SCATTER_GATHER */
+
+#if TIVA_MAC_USE_RX_STATISTICS || defined(__DOXYGEN__)
+/**
+ * @brief   Collects the hardware drop counters.
+ * @note    The hardware counters are cleared on read.
+ *
+ * @param[in] macp      pointer to the @p MACDriver object
+ *
+ * @notapi
+ */
+static void mac_lld_rx_collect(MACDriver *macp)
+{
+  uint32_t mfboc;
+
+  if (macp->state != MAC_ACTIVE)
+    return;
+
+  mfboc = HWREG(EMAC0_BASE + EMAC_O_MFBOC);
+  macp->rxstats.missed    += (mfboc & EMAC_MFBOC_MISFRMCNT_M) >>
+                             EMAC_MFBOC_MISFRMCNT_S;
+  if (mfboc & EMAC_MFBOC_MISCNTOVF)
+    macp->rxstats.missed  += 0x10000;
+  macp->rxstats.overflows += (mfboc & EMAC_MFBOC_OVFFRMCNT_M) >>
+                             EMAC_MFBOC_OVFFRMCNT_S;
+  if (mfboc & EMAC_MFBOC_OVFCNTOVF)
+    macp->rxstats.overflows += 0x800;
+}
+
+/**
+ * @brief   Returns the receive statistics.
+ *
+ * @param[in] macp      pointer to the @p MACDriver object
+ * @param[out] statsp   pointer to the statistics copy
+ *
+ * @api
+ */
+void tivaMacGetRxStatistics(MACDriver *macp, tiva_mac_rx_stats_t *statsp)
+{
+  osalDbgCheck((macp != NULL) && (statsp != NULL));
+
+  osalSysLock();
+  mac_lld_rx_collect(macp);
+  *statsp = macp->rxstats;
+  osalSysUnlock();
+}
+
+/**
+ * @brief   Clears the receive statistics.
+ *
+ * @param[in] macp      pointer to the @p MACDriver object
+ *
+ * @api
+ */
+void tivaMacResetRxStatistics(MACDriver *macp)
+{
+  osalDbgCheck(macp != NULL);
+
+  osalSysLock();
+  mac_lld_rx_collect(macp);
+  macp->rxstats.interrupts  = 0;
+  macp->rxstats.frames      = 0;
+  macp->rxstats.max_batch   = 0;
+  macp->rxstats.missed      = 0;
+  macp->rxstats.overflows   = 0;
+  macp->rxstats.csum_errors = 0;
+  osalSysUnlock();
+}
+#endif /* TIVA_MAC_USE_RX_STATISTICS */
+
+#if TIVA_MAC_USE_MULTICAST_HASH || defined(__DOXYGEN__)
+/**
+ * @brief   Computes the hash table bit of an address.
+ * @details The index is made of the upper 6 bits of the bit reversed
+ *          Ethernet CRC of the address, bit 5 selects the high table word.
+ *
+ * @param[in] addr      pointer to a six bytes MAC address
+ * @return              The hash table bit, from 0 to 63.
+ *
+ * @api
+ */
+unsigned tivaMacHashIndex(const uint8_t *addr)
+{
+  uint32_t crc = 0xFFFFFFFF;
+  unsigned i, j, idx = 0;
+
+  osalDbgCheck(addr != NULL);
+
+  for (i = 0; i < 6; i++) {
+    crc ^= addr[i];
+    for (j = 0; j < 8; j++)
+      crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+  }
+  crc = ~crc;
+
+  for (i = 0; i < 6; i++)
+    idx = (idx << 1) | ((crc >> i) & 1);
+  return idx;
+}
+
+/**
+ * @brief   Receives the frames sent to a multicast address.
+ * @details Addresses sharing a hash table bit are counted, the table can be
+ *          changed while the driver is active.
+ *
+ * @param[in] macp      pointer to the @p MACDriver object
+ * @param[in] addr      pointer to a six bytes multicast address
+ *
+ * @api
+ */
+void tivaMacAddMulticastAddress(MACDriver *macp, const uint8_t *addr)
+{
+  unsigned idx;
+
+  osalDbgCheck((macp != NULL) && (addr != NULL));
+
+  idx = tivaMacHashIndex(addr);
+
+  osalSysLock();
+  osalDbgAssert(macp->hashrefs[idx] < 255, "too many addresses");
+  if (macp->hashrefs[idx]++ == 0) {
+    if (macp->state == MAC_ACTIVE)
+      mac_lld_set_hash(macp);
+  }
+  osalSysUnlock();
+}
+
+/**
+ * @brief   Stops receiving the frames sent to a multicast address.
+ * @note    Frames are still received while another added address shares
+ *          the same hash table bit.
+ *
+ * @param[in] macp      pointer to the @p MACDriver object
+ * @param[in] addr      pointer to a six bytes multicast address, previously
+ *                      added
+ *
+ * @api
+ */
+void tivaMacRemoveMulticastAddress(MACDriver *macp, const uint8_t *addr)
+{
+  unsigned idx;
+
+  osalDbgCheck((macp != NULL) && (addr != NULL));
+
+  idx = tivaMacHashIndex(addr);
+
+  osalSysLock();
+  osalDbgAssert(macp->hashrefs[idx] > 0, "address not added");
+  if (--macp->hashrefs[idx] == 0) {
+    if (macp->state == MAC_ACTIVE)
+      mac_lld_set_hash(macp);
+  }
+  osalSysUnlock();
+}
+#endif /* TIVA_MAC_USE_MULTICAST_HASH */
+
 #endif /* HAL_USE_MAC */
 
 /** @} */
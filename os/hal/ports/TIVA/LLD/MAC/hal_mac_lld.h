@@ -62,6 +62,10 @@
 #define TIVA_RDES0_DE               0x00000004
 #define TIVA_RDES0_CE               0x00000002
 #define TIVA_RDES0_ESA              0x00000001
+
+/* Checksum status, receive checksum offload enabled.*/
+#define TIVA_RDES0_IPHCE            0x00000080
+#define TIVA_RDES0_PCE              0x00000001
 /** @} */
 
 /**
@@ -200,6 +204,38 @@
 #define TIVA_MAC_BUFFERS_SIZE               1522
 #endif
 
+/**
+ * @brief   Scatter-gather zero-copy mode.
+ * @details Frames are transmitted from lists of caller buffers and received
+ *          into buffers taken from an application pool, see
+ *          @p tivaMacTransmitFrame() and @p tivaMacReceiveFrame(). The
+ *          standard MAC API keeps working on the same rings, receive buffers
+ *          are recycled in place and transmitted frames are copied into
+ *          @p TIVA_MAC_TRANSMIT_BUFFERS bounce buffers.
+ */
+#if !defined(TIVA_MAC_USE_SCATTER_GATHER) || defined(__DOXYGEN__)
+#define TIVA_MAC_USE_SCATTER_GATHER         FALSE
+#endif
+
+/**
+ * @brief   Number of transmit descriptors.
+ * @note    Must be equal to @p TIVA_MAC_TRANSMIT_BUFFERS unless
+ *          @p TIVA_MAC_USE_SCATTER_GATHER is enabled.
+ */
+#if !defined(TIVA_MAC_TRANSMIT_DESCRIPTORS) || defined(__DOXYGEN__)
+#define TIVA_MAC_TRANSMIT_DESCRIPTORS       TIVA_MAC_TRANSMIT_BUFFERS
+#endif
+
+/**
+ * @brief   Number of receive descriptors.
+ * @note    Must be equal to @p TIVA_MAC_RECEIVE_BUFFERS unless
+ *          @p TIVA_MAC_USE_SCATTER_GATHER is enabled, the receive buffers
+ *          then come from the pool in the configuration.
+ */
+#if !defined(TIVA_MAC_RECEIVE_DESCRIPTORS) || defined(__DOXYGEN__)
+#define TIVA_MAC_RECEIVE_DESCRIPTORS        TIVA_MAC_RECEIVE_BUFFERS
+#endif
+
 /**
  * @brief   PHY detection timeout.
  * @details Timeout, in milliseconds, for PHY address detection, if a PHY
@@ -229,7 +265,10 @@
 
 /**
  * @brief   IP checksum offload.
- * @details The following modes are available:
+ * @details Default transmit mode, it can be changed for each frame. Any
+ *          non-zero value also enables the verification of the received
+ *          frames, frames with a wrong checksum are discarded.
+ *          The following modes are available:
  *          - 0 Function disabled.
  *          - 1 Only IP header checksum calculation and insertion are enabled.
  *          - 2 IP header checksum and payload checksum calculation and
@@ -243,6 +282,51 @@
 #if !defined(TIVA_MAC_IP_CHECKSUM_OFFLOAD) || defined(__DOXYGEN__)
 #define TIVA_MAC_IP_CHECKSUM_OFFLOAD        0
 #endif
+
+/**
+ * @brief   Multicast hash filter.
+ * @details Multicast frames are only received for the addresses added with
+ *          @p tivaMacAddMulticastAddress(), up to hash collisions.
+ */
+#if !defined(TIVA_MAC_USE_MULTICAST_HASH) || defined(__DOXYGEN__)
+#define TIVA_MAC_USE_MULTICAST_HASH         FALSE
+#endif
+
+/**
+ * @brief   Receive interrupt coalescing.
+ * @details Delay, in units of 256 system clocks, between the reception of a
+ *          frame and the receive interrupt, the frames received meanwhile
+ *          share the interrupt. Zero raises an interrupt for each frame.
+ * @note    The delay must stay below the time the DMA takes to fill the
+ *          receive ring at the peak frame rate, minimum size frames at
+ *          100Mbit/s arrive every 6.72us, about three 256 clocks units at
+ *          120MHz per receive buffer.
+ * @note    With the polled receive budget the interrupt is already masked
+ *          during bursts, the delay is added to the wake up of the thread
+ *          at the start of each burst and costs frames when bursts outrun
+ *          the thread. The default is zero for this reason.
+ */
+#if !defined(TIVA_MAC_RX_WATCHDOG) || defined(__DOXYGEN__)
+#define TIVA_MAC_RX_WATCHDOG                0
+#endif
+
+/**
+ * @brief   Polled receive budget.
+ * @details After a receive interrupt the interrupt is masked and the frames
+ *          are polled by the receiving thread, the interrupt is enabled
+ *          again when the ring is empty or after this number of frames.
+ *          Zero disables the polled mode.
+ */
+#if !defined(TIVA_MAC_RX_BUDGET) || defined(__DOXYGEN__)
+#define TIVA_MAC_RX_BUDGET                  0
+#endif
+
+/**
+ * @brief   Receive statistics.
+ */
+#if !defined(TIVA_MAC_USE_RX_STATISTICS) || defined(__DOXYGEN__)
+#define TIVA_MAC_USE_RX_STATISTICS          FALSE
+#endif
 /** @} */
 
 #ifndef EMAC_PHY_CONFIG
@@ -266,10 +350,66 @@
 #error "Invalid IRQ priority assigned to MAC"
 #endif
 
+#if !TIVA_MAC_USE_SCATTER_GATHER &&                                         \
+    ((TIVA_MAC_TRANSMIT_DESCRIPTORS != TIVA_MAC_TRANSMIT_BUFFERS) ||        \
+     (TIVA_MAC_RECEIVE_DESCRIPTORS != TIVA_MAC_RECEIVE_BUFFERS))
+#error "descriptors and buffers differ, TIVA_MAC_USE_SCATTER_GATHER required"
+#endif
+
+#if (TIVA_MAC_IP_CHECKSUM_OFFLOAD < 0) || (TIVA_MAC_IP_CHECKSUM_OFFLOAD > 3)
+#error "invalid TIVA_MAC_IP_CHECKSUM_OFFLOAD value"
+#endif
+
+#if (TIVA_MAC_RX_WATCHDOG < 0) || (TIVA_MAC_RX_WATCHDOG > 255)
+#error "TIVA_MAC_RX_WATCHDOG must be within 0..255"
+#endif
+
+#if TIVA_MAC_RX_BUDGET < 0
+#error "invalid TIVA_MAC_RX_BUDGET value"
+#endif
+
+#if (TIVA_MAC_TRANSMIT_DESCRIPTORS < 2) || (TIVA_MAC_RECEIVE_DESCRIPTORS < 2)
+#error "at least two descriptors per ring are required"
+#endif
+
+#if TIVA_MAC_USE_SCATTER_GATHER && ((TIVA_MAC_TRANSMIT_BUFFERS < 1) ||      \
+                                    (TIVA_MAC_TRANSMIT_BUFFERS > 32))
+#error "TIVA_MAC_TRANSMIT_BUFFERS must be within 1..32"
+#endif
+
 /*===========================================================================*/
 /* Driver data structures and types.                                         */
 /*===========================================================================*/
 
+/**
+ * @brief   Transmit checksum insertion modes.
+ */
+typedef enum
+{
+  TIVA_MAC_CSUM_NONE = 0,               /**< No insertion.                  */
+  TIVA_MAC_CSUM_IP = 1,                 /**< IP header only.                */
+  TIVA_MAC_CSUM_IP_PAYLOAD = 2,         /**< IP header and TCP/UDP/ICMP
+                                             payload, the pseudo-header
+                                             checksum is provided by
+                                             software.                      */
+  TIVA_MAC_CSUM_FULL = 3                /**< IP header and payload,
+                                             pseudo-header included.        */
+} tiva_mac_csum_t;
+
+/**
+ * @brief   Receive checksum status.
+ */
+typedef enum
+{
+  TIVA_MAC_RX_CSUM_NONE = 0,            /**< Not verified.                  */
+  TIVA_MAC_RX_CSUM_IP = 1,              /**< IP header verified, payload not
+                                             supported.                     */
+  TIVA_MAC_RX_CSUM_OK = 2,              /**< IP header and payload
+                                             verified.                      */
+  TIVA_MAC_RX_CSUM_ERROR = 3            /**< Wrong checksum, such frames are
+                                             discarded by the driver.       */
+} tiva_mac_rx_csum_t;
+
 /**
  * @brief   Type of an Tiva Ethernet receive descriptor.
  */
@@ -291,8 +431,81 @@ typedef struct
   volatile uint32_t     tdes2;
   volatile uint32_t     tdes3;
   volatile uint32_t     locked;
+#if TIVA_MAC_USE_SCATTER_GATHER || defined(__DOXYGEN__)
+  void                  *cookie;
+#endif
 } tiva_eth_tx_descriptor_t;
 
+#if TIVA_MAC_USE_SCATTER_GATHER || defined(__DOXYGEN__)
+/**
+ * @brief   Type of a frame segment.
+ */
+typedef struct
+{
+  /**
+   * @brief Segment data.
+   */
+  void                  *buf;
+  /**
+   * @brief Segment size in bytes.
+   */
+  size_t                size;
+} tiva_mac_segment_t;
+
+/**
+ * @brief   Receive pool allocation callback.
+ * @details Returns a word aligned buffer of @p rx_buffer_size bytes or
+ *          @p NULL if the pool is empty.
+ */
+typedef void *(*tiva_mac_rx_alloc_t)(MACDriver *macp);
+
+/**
+ * @brief   Receive pool release callback.
+ */
+typedef void (*tiva_mac_rx_free_t)(MACDriver *macp, void *buf);
+
+/**
+ * @brief   Transmission completion callback.
+ * @details The segments of the frame are no longer used by the DMA.
+ */
+typedef void (*tiva_mac_tx_done_t)(MACDriver *macp, void *cookie);
+#endif /* TIVA_MAC_USE_SCATTER_GATHER */
+
+#if TIVA_MAC_USE_RX_STATISTICS || defined(__DOXYGEN__)
+/**
+ * @brief   Type of the receive statistics.
+ * @note    The average number of frames per interrupt is
+ *          <tt>frames / interrupts</tt>.
+ */
+typedef struct
+{
+  /**
+   * @brief Receive interrupts.
+   */
+  uint32_t              interrupts;
+  /**
+   * @brief Frames returned to the application.
+   */
+  uint32_t              frames;
+  /**
+   * @brief Largest number of frames returned for a single interrupt.
+   */
+  uint32_t              max_batch;
+  /**
+   * @brief Frames dropped because the receive ring was full.
+   */
+  uint32_t              missed;
+  /**
+   * @brief Frames dropped because of a receive FIFO overflow.
+   */
+  uint32_t              overflows;
+  /**
+   * @brief Frames dropped because of a wrong checksum.
+   */
+  uint32_t              csum_errors;
+} tiva_mac_rx_stats_t;
+#endif
+
 /**
  * @brief   Driver configuration structure.
  */
@@ -303,6 +516,25 @@ typedef struct
    */
   uint8_t               *mac_address;
   /* End of the mandatory fields.*/
+#if TIVA_MAC_USE_SCATTER_GATHER || defined(__DOXYGEN__)
+  /**
+   * @brief Receive buffers allocation callback.
+   */
+  tiva_mac_rx_alloc_t   rx_alloc;
+  /**
+   * @brief Receive buffers release callback, can be @p NULL.
+   * @note  Only called by @p macStop() for the buffers still in the ring.
+   */
+  tiva_mac_rx_free_t    rx_free;
+  /**
+   * @brief Size of the receive buffers, multiple of 4.
+   */
+  size_t                rx_buffer_size;
+  /**
+   * @brief Transmission completion callback, can be @p NULL.
+   */
+  tiva_mac_tx_done_t    tx_done;
+#endif
 } MACConfig;
 
 /**
@@ -349,6 +581,56 @@ struct MACDriver
    * @brief Transmit next frame pointer.
    */
   tiva_eth_tx_descriptor_t *txptr;
+#if TIVA_MAC_USE_SCATTER_GATHER || defined(__DOXYGEN__)
+  /**
+   * @brief Oldest transmit descriptor not yet reclaimed.
+   */
+  tiva_eth_tx_descriptor_t *txtail;
+  /**
+   * @brief Free bounce buffers mask.
+   */
+  uint32_t              txbounce;
+  /**
+   * @brief Next receive descriptor to be refilled.
+   */
+  tiva_eth_rx_descriptor_t *rxfill;
+  /**
+   * @brief Number of receive descriptors without a buffer.
+   */
+  uint32_t              rxempty;
+  /**
+   * @brief Number of receive descriptors held by the caller.
+   * @details They follow the empty ones in the ring and are re-armed in
+   *          place when released.
+   */
+  uint32_t              rxheld;
+#endif
+#if (TIVA_MAC_RX_BUDGET > 0) || defined(__DOXYGEN__)
+  /**
+   * @brief Receive interrupt masked, frames polled by the thread.
+   */
+  bool                  rxpolling;
+  /**
+   * @brief Frames left before the receive interrupt is enabled again.
+   */
+  uint32_t              rxbudget;
+#endif
+#if TIVA_MAC_USE_RX_STATISTICS || defined(__DOXYGEN__)
+  /**
+   * @brief Receive statistics.
+   */
+  tiva_mac_rx_stats_t   rxstats;
+  /**
+   * @brief Frames returned since the last receive interrupt.
+   */
+  uint32_t              rxbatch;
+#endif
+#if TIVA_MAC_USE_MULTICAST_HASH || defined(__DOXYGEN__)
+  /**
+   * @brief Multicast addresses in each hash table bit.
+   */
+  uint8_t               hashrefs[64];
+#endif
 };
 
 /**
@@ -369,6 +651,10 @@ typedef struct
    * @brief Pointer to the physical descriptor.
    */
   tiva_eth_tx_descriptor_t *physdesc;
+  /**
+   * @brief Checksum insertion mode.
+   */
+  tiva_mac_csum_t       csum;
 } MACTransmitDescriptor;
 
 /**
@@ -389,12 +675,39 @@ typedef struct
    * @brief Pointer to the physical descriptor.
    */
   tiva_eth_rx_descriptor_t *physdesc;
+  /**
+   * @brief Checksum status.
+   */
+  tiva_mac_rx_csum_t    csum;
 } MACReceiveDescriptor;
 
 /*===========================================================================*/
 /* Driver macros.                                                            */
 /*===========================================================================*/
 
+/**
+ * @brief   Sets the checksum insertion mode of a frame.
+ * @details The default mode is @p TIVA_MAC_IP_CHECKSUM_OFFLOAD.
+ *
+ * @param[in] tdp       pointer to a @p MACTransmitDescriptor structure
+ * @param[in] mode      a @p tiva_mac_csum_t mode
+ *
+ * @api
+ */
+#define tivaMacSetTransmitChecksum(tdp, mode) ((tdp)->csum = (mode))
+
+/**
+ * @brief   Returns the checksum status of a received frame.
+ * @details Software verification can be skipped for the parts reported as
+ *          verified.
+ *
+ * @param[in] rdp       pointer to a @p MACReceiveDescriptor structure
+ * @return              The @p tiva_mac_rx_csum_t status.
+ *
+ * @api
+ */
+#define tivaMacGetReceiveChecksum(rdp) ((rdp)->csum)
+
 /*===========================================================================*/
 /* External declarations.                                                    */
 /*===========================================================================*/
@@ -427,6 +740,23 @@ extern "C" {
   const uint8_t *mac_lld_get_next_receive_buffer(MACReceiveDescriptor *rdp,
                                                  size_t *sizep);
 #endif /* MAC_USE_ZERO_COPY */
+#if TIVA_MAC_USE_SCATTER_GATHER || defined(__DOXYGEN__)
+  msg_t tivaMacTransmitFrame(MACDriver *macp, const tiva_mac_segment_t *segs,
+                             size_t n, tiva_mac_csum_t csum, void *cookie);
+  size_t tivaMacReclaimTransmit(MACDriver *macp);
+  msg_t tivaMacReceiveFrame(MACDriver *macp, tiva_mac_segment_t *segs,
+                            size_t *np, tiva_mac_rx_csum_t *csump);
+  size_t tivaMacRefillReceive(MACDriver *macp);
+#endif /* TIVA_MAC_USE_SCATTER_GATHER */
+#if TIVA_MAC_USE_RX_STATISTICS || defined(__DOXYGEN__)
+  void tivaMacGetRxStatistics(MACDriver *macp, tiva_mac_rx_stats_t *statsp);
+  void tivaMacResetRxStatistics(MACDriver *macp);
+#endif
+#if TIVA_MAC_USE_MULTICAST_HASH || defined(__DOXYGEN__)
+  unsigned tivaMacHashIndex(const uint8_t *addr);
+  void tivaMacAddMulticastAddress(MACDriver *macp, const uint8_t *addr);
+  void tivaMacRemoveMulticastAddress(MACDriver *macp, const uint8_t *addr);
+#endif
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,251 @@
+/*
+    ChibiOS - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/**
+ * @file    common/USB-EPBUF/usb_epbuf.c
+ * @brief   USB device endpoint buffers helpers code.
+ *
+ * @addtogroup COMMON_USB_EPBUF
+ * @{
+ */
+
+#include "hal.h"
+
+#if (HAL_USE_USB == TRUE) || defined(__DOXYGEN__)
+
+#include "usb_epbuf.h"
+
+/*===========================================================================*/
+/* Driver local definitions.                                                 */
+/*===========================================================================*/
+
+#define IS_WORD_ALIGNED(p) ((((size_t)(p)) & 3U) == 0U)
+
+/*===========================================================================*/
+/* Driver exported variables.                                                */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver local variables and types.                                         */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver local functions.                                                   */
+/*===========================================================================*/
+
+/**
+ * @brief   Packs up to four bytes into a little endian word.
+ */
+static uint32_t usb_epbuf_pack(const uint8_t *src, size_t n) {
+  uint32_t w = 0U;
+
+  switch (n) {
+  default:
+    w |= (uint32_t)src[3] << 24;
+    /* Falls through.*/
+  case 3:
+    w |= (uint32_t)src[2] << 16;
+    /* Falls through.*/
+  case 2:
+    w |= (uint32_t)src[1] << 8;
+    /* Falls through.*/
+  case 1:
+    w |= (uint32_t)src[0];
+    /* Falls through.*/
+  case 0:
+    break;
+  }
+  return w;
+}
+
+/*===========================================================================*/
+/* Driver exported functions.                                                */
+/*===========================================================================*/
+
+/**
+ * @brief   Initializes a packet memory allocator.
+ *
+ * @param[out] pp       pointer to the @p usb_epbuf_pool_t object
+ * @param[in] base      first allocatable offset, reserved areas like
+ *                      descriptor tables are placed below it
+ * @param[in] limit     end of the packet memory
+ * @param[in] align     allocation granularity, a power of two
+ *
+ * @init
+ */
+void usbEpbufPoolInit(usb_epbuf_pool_t *pp, size_t base,
+                      size_t limit, size_t align) {
+
+  osalDbgCheck((pp != NULL) && (base <= limit) &&
+               (align != 0U) && ((align & (align - 1U)) == 0U));
+
+  pp->base  = base;
+  pp->limit = limit;
+  pp->align = align;
+  usbEpbufPoolReset(pp);
+}
+
+/**
+ * @brief   Frees the whole packet memory.
+ *
+ * @param[in] pp        pointer to the @p usb_epbuf_pool_t object
+ *
+ * @xclass
+ */
+void usbEpbufPoolReset(usb_epbuf_pool_t *pp) {
+
+  pp->next = pp->base;
+  pp->mark = pp->base;
+}
+
+/**
+ * @brief   Allocates a packet buffer.
+ * @note    Allocating the two slots of a ping-pong endpoint is just two
+ *          consecutive calls.
+ *
+ * @param[in] pp        pointer to the @p usb_epbuf_pool_t object
+ * @param[in] size      size of the buffer
+ * @return              The buffer offset.
+ * @retval USB_EPBUF_INVALID if the packet memory is exhausted, nothing is
+ *                      allocated.
+ *
+ * @xclass
+ */
+size_t usbEpbufPoolAlloc(usb_epbuf_pool_t *pp, size_t size) {
+  size_t offset = pp->next;
+
+  if ((offset > pp->limit) || (size > pp->limit - offset)) {
+    return USB_EPBUF_INVALID;
+  }
+  pp->next = (offset + size + pp->align - 1U) & ~(pp->align - 1U);
+
+  return offset;
+}
+
+/**
+ * @brief   Copies a packet between memory buffers.
+ * @details Uses word transfers when both buffers are word aligned, this is
+ *          the common case for packet buffers and for the application
+ *          buffers handed by the high level drivers.
+ *
+ * @param[out] dst      destination buffer
+ * @param[in] src       source buffer
+ * @param[in] n         number of bytes
+ *
+ * @xclass
+ */
+void usbEpbufCopy(uint8_t *dst, const uint8_t *src, size_t n) {
+
+  if (IS_WORD_ALIGNED(dst) && IS_WORD_ALIGNED(src)) {
+    uint32_t *d = (uint32_t *)(void *)dst;
+    const uint32_t *s = (const uint32_t *)(const void *)src;
+
+    while (n >= 4U) {
+      *d++ = *s++;
+      n -= 4U;
+    }
+    dst = (uint8_t *)d;
+    src = (const uint8_t *)s;
+  }
+
+  while (n > 0U) {
+    *dst++ = *src++;
+    n--;
+  }
+}
+
+/**
+ * @brief   Writes a packet into a word-only packet memory.
+ * @details The last word is padded with zeros.
+ *
+ * @param[out] dst      packet memory address, word aligned
+ * @param[in] src       source buffer
+ * @param[in] n         number of bytes
+ *
+ * @xclass
+ */
+void usbEpbufWriteWords(volatile uint32_t *dst,
+                        const uint8_t *src, size_t n) {
+
+  if (IS_WORD_ALIGNED(src)) {
+    const uint32_t *s = (const uint32_t *)(const void *)src;
+
+    while (n >= 4U) {
+      *dst++ = *s++;
+      n -= 4U;
+    }
+    src = (const uint8_t *)s;
+  }
+  else {
+    while (n >= 4U) {
+      *dst++ = usb_epbuf_pack(src, 4U);
+      src += 4;
+      n -= 4U;
+    }
+  }
+
+  if (n > 0U) {
+    *dst = usb_epbuf_pack(src, n);
+  }
+}
+
+/**
+ * @brief   Reads a packet from a word-only packet memory.
+ *
+ * @param[out] dst      destination buffer
+ * @param[in] src       packet memory address, word aligned
+ * @param[in] n         number of bytes
+ *
+ * @xclass
+ */
+void usbEpbufReadWords(uint8_t *dst,
+                       const volatile uint32_t *src, size_t n) {
+
+  if (IS_WORD_ALIGNED(dst)) {
+    uint32_t *d = (uint32_t *)(void *)dst;
+
+    while (n >= 4U) {
+      *d++ = *src++;
+      n -= 4U;
+    }
+    dst = (uint8_t *)d;
+  }
+  else {
+    while (n >= 4U) {
+      uint32_t w = *src++;
+
+      dst[0] = (uint8_t)w;
+      dst[1] = (uint8_t)(w >> 8);
+      dst[2] = (uint8_t)(w >> 16);
+      dst[3] = (uint8_t)(w >> 24);
+      dst += 4;
+      n -= 4U;
+    }
+  }
+
+  if (n > 0U) {
+    uint32_t w = *src;
+
+    do {
+      *dst++ = (uint8_t)w;
+      w >>= 8;
+    } while (--n > 0U);
+  }
+}
+
+#endif /* HAL_USE_USB == TRUE */
+
+/** @} */
@@ -0,0 +1,261 @@
+/*
+    ChibiOS - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/**
+ * @file    common/USB-EPBUF/usb_epbuf.h
+ * @brief   USB device endpoint buffers helpers.
+ * @details Shared helpers for USB device LLDs that manage a packet memory
+ *          (PMA, EPSRAM or BDT buffers):
+ *          - an offset based packet memory allocator with a rewind mark,
+ *          - a two slots ping-pong state machine for double buffered
+ *            endpoints,
+ *          - copy routines optimized for word-wide packet memories.
+ *          .
+ *
+ * @addtogroup COMMON_USB_EPBUF
+ * @{
+ */
+
+#ifndef USB_EPBUF_H
+#define USB_EPBUF_H
+
+/*===========================================================================*/
+/* Driver constants.                                                         */
+/*===========================================================================*/
+
+/**
+ * @brief   Number of slots of a ping-pong endpoint.
+ */
+#define USB_EPBUF_SLOTS                     2U
+
+/**
+ * @brief   Offset returned when the packet memory is exhausted.
+ */
+#define USB_EPBUF_INVALID                   ((size_t)-1)
+
+/*===========================================================================*/
+/* Driver pre-compile time settings.                                         */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Derived constants and error checks.                                       */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver data structures and types.                                         */
+/*===========================================================================*/
+
+/**
+ * @brief   Packet memory allocator.
+ * @details Allocations are offsets from the start of the packet memory,
+ *          the memory is given back all at once on bus reset or down to
+ *          the mark when the configuration changes.
+ */
+typedef struct {
+  /**
+   * @brief   First allocatable offset.
+   */
+  size_t                    base;
+  /**
+   * @brief   End of the packet memory.
+   */
+  size_t                    limit;
+  /**
+   * @brief   Allocation granularity, a power of two.
+   */
+  size_t                    align;
+  /**
+   * @brief   Next free offset.
+   */
+  size_t                    next;
+  /**
+   * @brief   Offset restored by @p usbEpbufPoolRewind().
+   */
+  size_t                    mark;
+} usb_epbuf_pool_t;
+
+/**
+ * @brief   Ping-pong endpoint state.
+ * @details Slots are armed in alternate order, the same order used by the
+ *          hardware to consume them.
+ */
+typedef struct {
+  /**
+   * @brief   Mask of the slots owned by the hardware.
+   */
+  uint8_t                   armed;
+  /**
+   * @brief   Next slot to be armed.
+   */
+  uint8_t                   fill;
+  /**
+   * @brief   Next slot expected to complete.
+   */
+  uint8_t                   drain;
+} usb_pingpong_t;
+
+/*===========================================================================*/
+/* Driver macros.                                                            */
+/*===========================================================================*/
+
+/**
+ * @brief   Returns the packet memory still available.
+ * @note    The last allocation can be rounded past an unaligned limit.
+ *
+ * @param[in] pp        pointer to the @p usb_epbuf_pool_t object
+ * @return              Free bytes.
+ *
+ * @xclass
+ */
+#define usbEpbufPoolGetFreeX(pp)                                            \
+  (((pp)->next < (pp)->limit) ? ((pp)->limit - (pp)->next) : 0U)
+
+/**
+ * @brief   Marks the current allocation level.
+ * @details Typically invoked after the endpoint zero buffers have been
+ *          allocated.
+ *
+ * @param[in] pp        pointer to the @p usb_epbuf_pool_t object
+ *
+ * @xclass
+ */
+#define usbEpbufPoolSetMarkX(pp) ((pp)->mark = (pp)->next)
+
+/**
+ * @brief   Frees all the allocations done after the mark.
+ *
+ * @param[in] pp        pointer to the @p usb_epbuf_pool_t object
+ *
+ * @xclass
+ */
+#define usbEpbufPoolRewindX(pp) ((pp)->next = (pp)->mark)
+
+/**
+ * @brief   Number of slots owned by the hardware.
+ *
+ * @param[in] ppp       pointer to the @p usb_pingpong_t object
+ * @return              The number of armed slots.
+ *
+ * @xclass
+ */
+#define usbPingPongArmedX(ppp)                                              \
+  ((unsigned)(((ppp)->armed & 1U) + (((ppp)->armed >> 1) & 1U)))
+
+/**
+ * @brief   No slot owned by the hardware.
+ *
+ * @param[in] ppp       pointer to the @p usb_pingpong_t object
+ *
+ * @xclass
+ */
+#define usbPingPongIsEmptyX(ppp) ((ppp)->armed == 0U)
+
+/**
+ * @brief   Both slots owned by the hardware.
+ *
+ * @param[in] ppp       pointer to the @p usb_pingpong_t object
+ *
+ * @xclass
+ */
+#define usbPingPongIsFullX(ppp) ((ppp)->armed == 3U)
+
+/*===========================================================================*/
+/* External declarations.                                                    */
+/*===========================================================================*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+  void usbEpbufPoolInit(usb_epbuf_pool_t *pp, size_t base,
+                        size_t limit, size_t align);
+  void usbEpbufPoolReset(usb_epbuf_pool_t *pp);
+  size_t usbEpbufPoolAlloc(usb_epbuf_pool_t *pp, size_t size);
+  void usbEpbufCopy(uint8_t *dst, const uint8_t *src, size_t n);
+  void usbEpbufWriteWords(volatile uint32_t *dst,
+                          const uint8_t *src, size_t n);
+  void usbEpbufReadWords(uint8_t *dst,
+                         const volatile uint32_t *src, size_t n);
+#ifdef __cplusplus
+}
+#endif
+
+/*===========================================================================*/
+/* Module inline functions.                                                  */
+/*===========================================================================*/
+
+/**
+ * @brief   Resets a ping-pong state.
+ *
+ * @param[out] ppp      pointer to the @p usb_pingpong_t object
+ * @param[in] first     slot the hardware consumes first
+ *
+ * @xclass
+ */
+static inline void usbPingPongResetX(usb_pingpong_t *ppp, unsigned first) {
+
+  ppp->armed = 0U;
+  ppp->fill  = (uint8_t)first;
+  ppp->drain = (uint8_t)first;
+}
+
+/**
+ * @brief   Takes the next slot to be filled and handed to the hardware.
+ * @pre     At least one slot must be free.
+ *
+ * @param[in,out] ppp   pointer to the @p usb_pingpong_t object
+ * @return              The slot index.
+ *
+ * @xclass
+ */
+static inline unsigned usbPingPongArmX(usb_pingpong_t *ppp) {
+  unsigned slot = ppp->fill;
+
+  ppp->armed |= (uint8_t)(1U << slot);
+  ppp->fill   = (uint8_t)(slot ^ 1U);
+  return slot;
+}
+
+/**
+ * @brief   Gives back a slot released by the hardware.
+ *
+ * @param[in,out] ppp   pointer to the @p usb_pingpong_t object
+ * @param[in] slot      the slot reported by the hardware
+ *
+ * @xclass
+ */
+static inline void usbPingPongCompleteX(usb_pingpong_t *ppp, unsigned slot) {
+
+  ppp->armed &= (uint8_t)~(1U << slot);
+  ppp->drain  = (uint8_t)(slot ^ 1U);
+}
+
+/**
+ * @brief   Drops the slots not yet consumed.
+ * @details The next slot armed is the one the hardware expects.
+ *
+ * @param[in,out] ppp   pointer to the @p usb_pingpong_t object
+ *
+ * @xclass
+ */
+static inline void usbPingPongFlushX(usb_pingpong_t *ppp) {
+
+  ppp->armed = 0U;
+  ppp->fill  = ppp->drain;
+}
+
+#endif /* USB_EPBUF_H */
+
+/** @} */
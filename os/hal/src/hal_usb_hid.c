@@ -201,6 +201,63 @@ static void obnotify(io_buffers_queue_t *bqp) {
   }
 }
 
+#if (USB_HID_USE_COALESCING == TRUE) || defined(__DOXYGEN__)
+/**
+ * @brief   Starts the transmission of the latest-value report.
+ * @note    The IN endpoint must be idle.
+ *
+ * @param[in] uhdp      pointer to a @p USBHIDDriver object
+ *
+ * @iclass
+ */
+static void hid_start_latestI(USBHIDDriver *uhdp) {
+
+  /* The application can overwrite the slot while the endpoint reads from
+     the copy.*/
+  memcpy(uhdp->latest_tx, uhdp->latest, uhdp->latest_n);
+  uhdp->latest_pending = false;
+  uhdp->latest_busy    = true;
+  usbStartTransmitI(uhdp->config->usbp, uhdp->config->int_in,
+                    uhdp->latest_tx, uhdp->latest_n);
+}
+#endif
+
+#if (USB_HID_USE_BATCHING == TRUE) || defined(__DOXYGEN__)
+/**
+ * @brief   Starts the transmission of the batched reports.
+ * @note    The IN endpoint must be idle.
+ *
+ * @param[in] uhdp      pointer to a @p USBHIDDriver object
+ *
+ * @iclass
+ */
+static void hid_start_batchI(USBHIDDriver *uhdp) {
+
+  /* The application can batch new reports while the endpoint reads from
+     the copy.*/
+  memcpy(uhdp->batch_tx, uhdp->batch, uhdp->batch_n);
+  uhdp->batch_busy = true;
+  usbStartTransmitI(uhdp->config->usbp, uhdp->config->int_in,
+                    uhdp->batch_tx, uhdp->batch_n);
+  uhdp->batch_n = 0U;
+  osalThreadDequeueAllI(&uhdp->batch_waiting, MSG_OK);
+}
+
+/**
+ * @brief   Discards the batched reports.
+ *
+ * @param[in] uhdp      pointer to a @p USBHIDDriver object
+ *
+ * @iclass
+ */
+static void hid_reset_batchI(USBHIDDriver *uhdp) {
+
+  uhdp->batch_n    = 0U;
+  uhdp->batch_busy = false;
+  osalThreadDequeueAllI(&uhdp->batch_waiting, MSG_RESET);
+}
+#endif
+
 /*===========================================================================*/
 /* Driver exported functions.                                                */
 /*===========================================================================*/
@@ -235,6 +292,17 @@ void hidObjectInit(USBHIDDriver *uhdp) {
   obqObjectInit(&uhdp->obqueue, true, uhdp->ob,
                 USB_HID_BUFFERS_SIZE, USB_HID_BUFFERS_NUMBER,
                 obnotify, uhdp);
+  memset(&uhdp->stats, 0, sizeof (hidstats_t));
+#if USB_HID_USE_COALESCING == TRUE
+  uhdp->latest_n       = 0U;
+  uhdp->latest_pending = false;
+  uhdp->latest_busy    = false;
+#endif
+#if USB_HID_USE_BATCHING == TRUE
+  uhdp->batch_n    = 0U;
+  uhdp->batch_busy = false;
+  osalThreadQueueObjectInit(&uhdp->batch_waiting);
+#endif
 }
 
 /**
@@ -304,6 +372,13 @@ void hidDisconnectI(USBHIDDriver *uhdp) {
   chnAddFlagsI(uhdp, CHN_DISCONNECTED);
   ibqResetI(&uhdp->ibqueue);
   obqResetI(&uhdp->obqueue);
+#if USB_HID_USE_COALESCING == TRUE
+  uhdp->latest_pending = false;
+  uhdp->latest_busy    = false;
+#endif
+#if USB_HID_USE_BATCHING == TRUE
+  hid_reset_batchI(uhdp);
+#endif
 }
 
 /**
@@ -318,6 +393,13 @@ void hidConfigureHookI(USBHIDDriver *uhdp) {
 
   ibqResetI(&uhdp->ibqueue);
   obqResetI(&uhdp->obqueue);
+#if USB_HID_USE_COALESCING == TRUE
+  uhdp->latest_pending = false;
+  uhdp->latest_busy    = false;
+#endif
+#if USB_HID_USE_BATCHING == TRUE
+  hid_reset_batchI(uhdp);
+#endif
   chnAddFlagsI(uhdp, CHN_CONNECTED);
 
   /* Starts the first OUT transaction immediately.*/
@@ -413,6 +495,24 @@ void hidDataTransmitted(USBDriver *usbp, usbep_t ep) {
   /* Signaling that space is available in the output queue.*/
   chnAddFlagsI(uhdp, CHN_OUTPUT_EMPTY);
 
+  if (usbp->epc[ep]->in_state->txsize > 0U) {
+    uhdp->stats.sent++;
+  }
+
+#if USB_HID_USE_COALESCING == TRUE
+  /* The latest-value slot does not own a queue buffer.*/
+  if (uhdp->latest_busy) {
+    uhdp->latest_busy = false;
+  }
+  else
+#endif
+#if USB_HID_USE_BATCHING == TRUE
+  /* Neither does the batch.*/
+  if (uhdp->batch_busy) {
+    uhdp->batch_busy = false;
+  }
+  else
+#endif
   /* Freeing the buffer just transmitted, if it was not a zero size packet.*/
   if (usbp->epc[ep]->in_state->txsize > 0U) {
     obqReleaseEmptyBufferI(&uhdp->obqueue);
@@ -426,6 +526,19 @@ void hidDataTransmitted(USBDriver *usbp, usbep_t ep) {
        so it is safe to transmit without a check.*/
     usbStartTransmitI(usbp, ep, buf, n);
   }
+#if USB_HID_USE_COALESCING == TRUE
+  else if (uhdp->latest_pending) {
+    /* Queued reports have priority, the latest value goes out when the
+       queue is empty.*/
+    hid_start_latestI(uhdp);
+  }
+#endif
+#if USB_HID_USE_BATCHING == TRUE
+  else if (uhdp->batch_n > 0U) {
+    /* Reports batched while the endpoint was busy go out together.*/
+    hid_start_batchI(uhdp);
+  }
+#endif
   else if ((usbp->epc[ep]->in_state->txsize > 0U) &&
            ((usbp->epc[ep]->in_state->txsize &
             ((size_t)usbp->epc[ep]->in_maxsize - 1U)) == 0U)) {
@@ -503,6 +616,12 @@ size_t hidWriteReport(USBHIDDriver *uhdp, uint8_t *bp, size_t n) {
   if (val > 0)
     uhdp->vmt->flush(uhdp);
 
+  if (val < n) {
+    osalSysLock();
+    uhdp->stats.dropped++;
+    osalSysUnlock();
+  }
+
   return val;
 }
 
@@ -535,6 +654,12 @@ size_t hidWriteReportt(USBHIDDriver *uhdp, uint8_t *bp, size_t n, systime_t time
   if (val > 0)
     uhdp->vmt->flush(uhdp);
 
+  if (val < n) {
+    osalSysLock();
+    uhdp->stats.dropped++;
+    osalSysUnlock();
+  }
+
   return val;
 }
 
@@ -584,6 +709,148 @@ size_t hidReadReportt(USBHIDDriver *uhdp, uint8_t *bp, size_t n, systime_t timeo
   return uhdp->vmt->readt(uhdp, bp, n, timeout);
 }
 
+/**
+ * @brief   Clears the interface statistics.
+ *
+ * @param[in] uhdp      pointer to the @p USBHIDDriver object
+ *
+ * @api
+ */
+void hidResetStats(USBHIDDriver *uhdp) {
+
+  osalDbgCheck(uhdp != NULL);
+
+  osalSysLock();
+  memset(&uhdp->stats, 0, sizeof (hidstats_t));
+  osalSysUnlock();
+}
+
+#if (USB_HID_USE_COALESCING == TRUE) || defined(__DOXYGEN__)
+/**
+ * @brief   Write latest-value HID report
+ * @details The report is transmitted immediately if the IN endpoint is
+ *          idle, otherwise it is kept in a single slot and sent after the
+ *          reports already queued. A report still waiting in the slot is
+ *          replaced, so a slow host always reads the most recent value
+ *          instead of a backlog.
+ * @note    The function never blocks.
+ *
+ * @param[in] uhdp      pointer to the @p USBHIDDriver object
+ * @param[in] bp        pointer to the report data buffer
+ * @param[in] n         the report size, up to @p USB_HID_REPORT_MAX_SIZE
+ * @return              The number of bytes accepted.
+ * @retval 0            if the interface is not active.
+ *
+ * @api
+ */
+size_t hidWriteReportLatest(USBHIDDriver *uhdp, const uint8_t *bp, size_t n) {
+  USBDriver *usbp;
+
+  osalDbgCheck((uhdp != NULL) && (bp != NULL) &&
+               (n > 0U) && (n <= USB_HID_REPORT_MAX_SIZE));
+
+  usbp = uhdp->config->usbp;
+
+  osalSysLock();
+  if ((usbGetDriverStateI(usbp) != USB_ACTIVE) ||
+      (uhdp->state != HID_READY)) {
+    osalSysUnlock();
+    return 0;
+  }
+
+  if (uhdp->latest_pending) {
+    uhdp->stats.coalesced++;
+  }
+  memcpy(uhdp->latest, bp, n);
+  uhdp->latest_n       = n;
+  uhdp->latest_pending = true;
+
+  if (!usbGetTransmitStatusI(usbp, uhdp->config->int_in)) {
+    hid_start_latestI(uhdp);
+  }
+  osalSysUnlock();
+
+  return n;
+}
+#endif
+
+#if (USB_HID_USE_BATCHING == TRUE) || defined(__DOXYGEN__)
+/**
+ * @brief   Write batched HID report
+ * @details The report is appended to the batch being filled, a report
+ *          never spans two transfers and a transfer never exceeds the IN
+ *          endpoint maximum packet size. If the endpoint is idle the batch
+ *          is sent immediately, otherwise the reports written meanwhile
+ *          are sent together when the endpoint is released. A report that
+ *          does not fit waits for the current batch to be sent.
+ * @note    Meant for vendor-defined usages where the host splits the
+ *          transfer into fixed size logical reports.
+ *
+ * @param[in] uhdp      pointer to the @p USBHIDDriver object
+ * @param[in] bp        pointer to the report data buffer
+ * @param[in] n         the report size, up to the endpoint packet size
+ * @param[in] timeout   the number of ticks before the operation timeouts,
+ *                      the following special values are allowed:
+ *                      - @a TIME_IMMEDIATE immediate timeout.
+ *                      - @a TIME_INFINITE no timeout.
+ *                      .
+ * @return              The number of bytes accepted.
+ * @retval 0            if a timeout occurred.
+ *
+ * @api
+ */
+size_t hidWriteReportBatch(USBHIDDriver *uhdp, const uint8_t *bp, size_t n,
+                           systime_t timeout) {
+  USBDriver *usbp;
+  size_t bsize;
+
+  osalDbgCheck((uhdp != NULL) && (bp != NULL) && (n > 0U));
+
+  usbp  = uhdp->config->usbp;
+  bsize = (size_t)usbp->epc[uhdp->config->int_in]->in_maxsize;
+  if (bsize > USB_HID_BUFFERS_SIZE) {
+    bsize = USB_HID_BUFFERS_SIZE;
+  }
+
+  osalDbgCheck(n <= bsize);
+
+  osalSysLock();
+  while (true) {
+    if ((usbGetDriverStateI(usbp) != USB_ACTIVE) ||
+        (uhdp->state != HID_READY)) {
+      uhdp->stats.dropped++;
+      osalSysUnlock();
+      return 0;
+    }
+
+    if (uhdp->batch_n + n <= bsize) {
+      break;
+    }
+
+    /* The batch is full, waiting for the endpoint to take it.*/
+    if (osalThreadEnqueueTimeoutS(&uhdp->batch_waiting, timeout) != MSG_OK) {
+      uhdp->stats.dropped++;
+      osalSysUnlock();
+      return 0;
+    }
+  }
+
+  memcpy(&uhdp->batch[uhdp->batch_n], bp, n);
+  uhdp->batch_n += n;
+  uhdp->stats.batched++;
+
+  /* Idle endpoint, nothing to wait for.*/
+  if (!usbGetTransmitStatusI(usbp, uhdp->config->int_in)) {
+    hid_start_batchI(uhdp);
+  }
+
+  osalOsRescheduleS();
+  osalSysUnlock();
+
+  return n;
+}
+#endif
+
 #endif /* HAL_USE_USB_HID == TRUE */
 
 /** @} */
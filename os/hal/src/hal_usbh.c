@@ -35,7 +35,6 @@ struct usbh_debug_helper usbh_debug;
 #endif
 
 static void _classdriver_process_device(usbh_device_t *dev);
-static bool _classdriver_load(usbh_device_t *dev, uint8_t *descbuff, uint16_t rem);
 
 #if HAL_USBH_USE_ADDITIONAL_CLASS_DRIVERS
 #include "usbh_additional_class_drivers.h"
@@ -63,7 +62,7 @@ static inline void _check_ep(usbh_ep_t *ep) {
 static inline void _check_urb(usbh_urb_t *urb) {
 	osalDbgCheck(urb != 0);
 	_check_ep(urb->ep);
-	osalDbgCheck((urb->buff != NULL) || (urb->requestedLength == 0));
+	osalDbgCheck((urb->buff != NULL) || (urb->segments != NULL) || (urb->requestedLength == 0));
 	//TODO: add more checks.
 }
 
@@ -189,6 +188,9 @@ void usbhURBObjectInit(usbh_urb_t *urb, usbh_ep_t *ep, usbh_completion_cb callba
 	urb->buff = buff;
 	urb->requestedLength = len;
 	urb->actualLength = 0;
+	urb->segments = NULL;
+	urb->segments_count = 0;
+	urb->next = NULL;
 	urb->status = USBH_URBSTATUS_INITIALIZED;
 	urb->waitingThread = 0;
 	urb->abortingThread = 0;
@@ -197,12 +199,33 @@ void usbhURBObjectInit(usbh_urb_t *urb, usbh_ep_t *ep, usbh_completion_cb callba
 	usbh_lld_urb_object_init(urb);
 }
 
+void usbhURBObjectInitSG(usbh_urb_t *urb, usbh_ep_t *ep, usbh_completion_cb callback,
+		void *user, const usbh_urb_segment_t *segments, uint8_t count) {
+	uint32_t len = 0;
+	uint8_t i;
+
+	osalDbgCheck((segments != NULL) && (count > 0));
+	osalDbgAssert(ep->type != USBH_EPTYPE_CTRL, "scatter-gather not supported in CTRL endpoints");
+
+	for (i = 0; i < count; i++) {
+		osalDbgAssert((i == count - 1) || ((segments[i].len % ep->wMaxPacketSize) == 0),
+				"segment length must be a multiple of wMaxPacketSize");
+		osalDbgCheck((segments[i].buff != NULL) || (segments[i].len == 0));
+		len += segments[i].len;
+	}
+
+	usbhURBObjectInit(urb, ep, callback, user, NULL, len);
+	urb->segments = segments;
+	urb->segments_count = count;
+}
+
 void usbhURBObjectResetI(usbh_urb_t *urb) {
 	osalDbgAssert(!usbhURBIsBusy(urb), "invalid status");
 
 	osalDbgCheck((urb->waitingThread == 0) && (urb->abortingThread == 0));
 
 	urb->actualLength = 0;
+	urb->next = NULL;
 	urb->status = USBH_URBSTATUS_INITIALIZED;
 
 	/* reset the ll part: */
@@ -281,6 +304,62 @@ msg_t usbhURBWaitTimeoutS(usbh_urb_t *urb, systime_t timeout) {
 	return osalThreadSuspendTimeoutS(&urb->waitingThread, timeout);
 }
 
+/* usbhURBChainSubmitI may require a reschedule if called from a S-locked state */
+void usbhURBChainSubmitI(usbh_urb_t *urbs, uint8_t n) {
+	usbh_urbstatus_t status;
+	uint8_t i;
+
+	osalDbgCheckClassI();
+	osalDbgCheck((urbs != NULL) && (n > 0));
+
+	for (i = 0; i < n; i++) {
+		osalDbgCheck(urbs[i].ep == urbs[0].ep);
+		urbs[i].next = (i < n - 1) ? &urbs[i + 1] : NULL;
+	}
+
+	/* queue all of them at once, so that the LLD can process them back-to-back */
+	for (i = 0; i < n; i++) {
+		usbhURBSubmitI(&urbs[i]);
+		if (urbs[i].status != USBH_URBSTATUS_PENDING)
+			break;
+	}
+	if (i == n)
+		return;
+
+	/* the chain stops at the first URB that could not be submitted: the
+	 * queued ones are aborted, the remaining ones complete with its error */
+	status = urbs[i].status;
+	if (i > 0)
+		_usbh_urb_abortI(&urbs[0], status);
+	for (i = i + 1; i < n; i++) {
+		_usbh_urb_completeI(&urbs[i], status);
+	}
+}
+
+msg_t usbhURBChainSubmitAndWaitS(usbh_urb_t *urbs, uint8_t n, systime_t timeout) {
+	msg_t ret;
+	uint8_t i;
+
+	osalDbgCheckClassS();
+
+	usbhURBChainSubmitI(urbs, n);
+	osalOsRescheduleS();
+
+	/* the last URB completes when the chain is done, or has failed */
+	ret = usbhURBWaitTimeoutS(&urbs[n - 1], timeout);
+	if (ret != MSG_OK) {
+		/* aborting the first busy URB aborts the rest of the chain; an
+		 * abort may complete later, so make sure none is left busy */
+		for (i = 0; i < n; i++) {
+			if (usbhURBIsBusy(&urbs[i]))
+				_usbh_urb_abort_and_waitS(&urbs[i],
+						(ret == MSG_TIMEOUT) ? USBH_URBSTATUS_TIMEOUT : USBH_URBSTATUS_CANCELLED);
+		}
+	}
+
+	return ret;
+}
+
 msg_t usbhURBSubmitAndWaitS(usbh_urb_t *urb, systime_t timeout) {
 	msg_t ret;
 
@@ -304,13 +383,41 @@ static inline msg_t _wakeup_message(usbh_urbstatus_t status) {
 
 /* _usbh_urb_completeI may require a reschedule if called from a S-locked state */
 void _usbh_urb_completeI(usbh_urb_t *urb, usbh_urbstatus_t status) {
+	usbh_urb_t *const next = urb->next;
+
 	osalDbgCheckClassI();
 	_check_urb(urb);
 	urb->status = status;
+	urb->next = NULL;
 	osalThreadResumeI(&urb->waitingThread, _wakeup_message(status));
 	osalThreadResumeI(&urb->abortingThread, MSG_RESET);
 	if (urb->callback)
 		urb->callback(urb);
+	if ((status != USBH_URBSTATUS_OK) && (next != NULL) && usbhURBIsBusy(next))
+		_usbh_urb_abortI(next, status);
+}
+
+/* Returns the buffer position for the next transfer of the URB and, in len,
+ * the bytes that remain in the current scatter-gather segment. */
+uint8_t *_usbh_urb_buffer(usbh_urb_t *urb, uint32_t *len) {
+	uint32_t offset = urb->actualLength;
+	uint8_t i;
+
+	osalDbgCheck(urb->requestedLength >= urb->actualLength);
+
+	if (urb->segments == NULL) {
+		*len = urb->requestedLength - offset;
+		return (uint8_t *)urb->buff + offset;
+	}
+
+	for (i = 0; i < urb->segments_count - 1; i++) {
+		if (offset < urb->segments[i].len)
+			break;
+		offset -= urb->segments[i].len;
+	}
+
+	*len = urb->segments[i].len - offset;
+	return (uint8_t *)urb->segments[i].buff + offset;
 }
 
 /*===========================================================================*/
@@ -339,6 +446,27 @@ usbh_urbstatus_t usbhSynchronousTransfer(usbh_ep_t *ep,
 	return urb.status;
 }
 
+usbh_urbstatus_t usbhSynchronousTransferSG(usbh_ep_t *ep,
+		const usbh_urb_segment_t *segments,
+		uint8_t count,
+		uint32_t *actual_len,
+		systime_t timeout) {
+
+	osalDbgCheck(ep != NULL);
+
+	usbh_urb_t urb;
+	usbhURBObjectInitSG(&urb, ep, 0, 0, segments, count);
+
+	osalSysLock();
+	usbhURBSubmitAndWaitS(&urb, timeout);
+	osalSysUnlock();
+
+	if (actual_len != NULL)
+		*actual_len = urb.actualLength;
+
+	return urb.status;
+}
+
 usbh_urbstatus_t usbhControlRequestExtended(usbh_device_t *dev,
 		const usbh_control_request_t *req,
 		uint8_t *buff,
@@ -489,6 +617,242 @@ bool usbhStdReqGetInterface(usbh_device_t *dev,
 }
 
 
+/*===========================================================================*/
+/* Configuration descriptor cache.                                           */
+/*===========================================================================*/
+
+#if HAL_USBH_USE_CFGDESC_CACHE
+typedef struct {
+	uint8_t *desc;			/* full configuration descriptor; NULL: free entry */
+	uint32_t serial;		/* hash of the serial number string descriptor */
+	uint32_t last_used;
+	uint16_t idVendor;
+	uint16_t idProduct;
+	uint16_t bcdDevice;
+	uint16_t langID0;
+	usbh_devspeed_t speed;	/* descriptors differ with the bus speed */
+} usbh_cfgdesc_cache_entry_t;
+
+static struct {
+	usbh_cfgdesc_cache_entry_t entries[HAL_USBH_CFGDESC_CACHE_ENTRIES];
+	memory_heap_t heap;
+	mutex_t mtx;
+	uint32_t tick;
+} usbh_cfgdesc_cache;
+
+static CH_HEAP_AREA(usbh_cfgdesc_cache_area, HAL_USBH_CFGDESC_CACHE_SIZE);
+
+static void _cfgdesc_cache_init(void) {
+	memset(usbh_cfgdesc_cache.entries, 0, sizeof(usbh_cfgdesc_cache.entries));
+	chHeapObjectInit(&usbh_cfgdesc_cache.heap, usbh_cfgdesc_cache_area,
+			sizeof(usbh_cfgdesc_cache_area));
+	osalMutexObjectInit(&usbh_cfgdesc_cache.mtx);
+	usbh_cfgdesc_cache.tick = 0;
+}
+
+static void _cfgdesc_cache_free(usbh_cfgdesc_cache_entry_t *entry) {
+	if (entry->desc) {
+		chHeapFree(entry->desc);
+		entry->desc = NULL;
+	}
+}
+
+/* FNV-1a hash of the whole serial number string descriptor; 0: failed */
+static uint32_t _cfgdesc_cache_serial(usbh_device_t *dev, uint16_t langID) {
+	USBH_DEFINE_BUFFER(uint8_t strdesc[255]);
+	uint32_t hash = 2166136261U;
+	uint8_t i;
+
+	/* a short answer must hash the same every time */
+	memset(strdesc, 0, sizeof(strdesc));
+	if (usbhStdReqGetStringDescriptor(dev, dev->devDesc.iSerialNumber, langID,
+			sizeof(strdesc), strdesc) != HAL_SUCCESS)
+		return 0;
+
+	for (i = 0; i < strdesc[0]; i++) {
+		hash = (hash ^ strdesc[i]) * 16777619U;
+	}
+	return hash ? hash : 1;
+}
+
+static usbh_cfgdesc_cache_entry_t *_cfgdesc_cache_find(usbh_device_t *dev,
+		bool check_serial, uint32_t serial) {
+	usbh_cfgdesc_cache_entry_t *entry;
+	uint8_t i;
+
+	for (i = 0; i < HAL_USBH_CFGDESC_CACHE_ENTRIES; i++) {
+		entry = &usbh_cfgdesc_cache.entries[i];
+		if (entry->desc
+				&& (entry->idVendor == dev->devDesc.idVendor)
+				&& (entry->idProduct == dev->devDesc.idProduct)
+				&& (entry->bcdDevice == dev->devDesc.bcdDevice)
+				&& (entry->speed == dev->speed)
+				&& (!check_serial || (entry->serial == serial)))
+			return entry;
+	}
+	return NULL;
+}
+
+/* Look up the device in the cache; on a hit, load the default language ID
+ * and configuration descriptor #0 into the device, without requesting them */
+static bool _cfgdesc_cache_lookup(usbh_device_t *dev) {
+	usbh_cfgdesc_cache_entry_t *entry;
+	uint16_t langID0 = 0;
+	uint32_t serial = 0;
+	uint8_t *desc = NULL;
+	uint16_t len;
+
+	/* without a serial number identical devices can't be told apart */
+	if (dev->devDesc.iSerialNumber == 0)
+		goto miss;
+
+	osalMutexLock(&usbh_cfgdesc_cache.mtx);
+	entry = _cfgdesc_cache_find(dev, FALSE, 0);
+	if (entry)
+		langID0 = entry->langID0;
+	osalMutexUnlock(&usbh_cfgdesc_cache.mtx);
+
+	if (entry == NULL)
+		goto miss;
+
+	serial = _cfgdesc_cache_serial(dev, langID0);
+	if (serial == 0)
+		goto miss;
+
+	osalMutexLock(&usbh_cfgdesc_cache.mtx);
+	entry = _cfgdesc_cache_find(dev, TRUE, serial);
+	if (entry) {
+		len = ((usbh_config_descriptor_t *)entry->desc)->wTotalLength;
+		desc = (uint8_t *)chHeapAlloc(0, len);
+		if (desc) {
+			memcpy(desc, entry->desc, len);
+			entry->last_used = ++usbh_cfgdesc_cache.tick;
+		}
+	}
+	osalMutexUnlock(&usbh_cfgdesc_cache.mtx);
+
+	if (desc == NULL)
+		goto miss;
+
+	dev->langID0 = langID0;
+	memcpy(&dev->basicConfigDesc, desc, sizeof(dev->basicConfigDesc));
+	dev->fullConfigurationDescriptor = desc;
+	dev->cfgDescCached = 1;
+	udevinfof("Configuration descriptor cache hit (%d bytes)", len);
+	return TRUE;
+
+miss:
+	udevinfo("Configuration descriptor cache miss");
+	return FALSE;
+}
+
+/* Store configuration descriptor #0 of a newly enumerated device */
+static void _cfgdesc_cache_insert(usbh_device_t *dev) {
+	const uint16_t len = dev->basicConfigDesc.wTotalLength;
+	usbh_cfgdesc_cache_entry_t *entry, *victim;
+	uint32_t serial;
+	uint8_t *desc;
+	uint8_t i;
+
+	if (dev->devDesc.iSerialNumber == 0)
+		return;
+
+	serial = _cfgdesc_cache_serial(dev, dev->langID0);
+	if (serial == 0)
+		return;
+
+	osalMutexLock(&usbh_cfgdesc_cache.mtx);
+
+	/* replace a stale copy */
+	entry = _cfgdesc_cache_find(dev, TRUE, serial);
+	if (entry)
+		_cfgdesc_cache_free(entry);
+
+	for (;;) {
+		desc = (uint8_t *)chHeapAlloc(&usbh_cfgdesc_cache.heap, len);
+
+		/* find a free entry, or the least recently used one */
+		victim = entry = NULL;
+		for (i = 0; i < HAL_USBH_CFGDESC_CACHE_ENTRIES; i++) {
+			usbh_cfgdesc_cache_entry_t *const e = &usbh_cfgdesc_cache.entries[i];
+			if (e->desc == NULL) {
+				entry = e;
+			} else if ((victim == NULL) || (e->last_used < victim->last_used)) {
+				victim = e;
+			}
+		}
+
+		if (desc && entry)
+			break;
+
+		if (desc)
+			chHeapFree(desc);
+
+		if (victim == NULL) {
+			/* the descriptor doesn't fit in the cache */
+			udevwarnf("Configuration descriptor too big for the cache (%d bytes)", len);
+			osalMutexUnlock(&usbh_cfgdesc_cache.mtx);
+			return;
+		}
+		_cfgdesc_cache_free(victim);
+	}
+
+	memcpy(desc, dev->fullConfigurationDescriptor, len);
+	entry->desc = desc;
+	entry->serial = serial;
+	entry->last_used = ++usbh_cfgdesc_cache.tick;
+	entry->idVendor = dev->devDesc.idVendor;
+	entry->idProduct = dev->devDesc.idProduct;
+	entry->bcdDevice = dev->devDesc.bcdDevice;
+	entry->langID0 = dev->langID0;
+	entry->speed = dev->speed;
+
+	osalMutexUnlock(&usbh_cfgdesc_cache.mtx);
+}
+
+void usbhCfgDescCacheFlush(void) {
+	uint8_t i;
+
+	osalMutexLock(&usbh_cfgdesc_cache.mtx);
+	for (i = 0; i < HAL_USBH_CFGDESC_CACHE_ENTRIES; i++) {
+		_cfgdesc_cache_free(&usbh_cfgdesc_cache.entries[i]);
+	}
+	osalMutexUnlock(&usbh_cfgdesc_cache.mtx);
+}
+#endif
+
+/*===========================================================================*/
+/* Enumeration timing.                                                       */
+/*===========================================================================*/
+
+#if HAL_USBH_USE_ENUMERATION_TIMING
+static void _enum_timing_mark(usbh_device_t *dev, enum usbh_enumphase phase, systime_t *t) {
+	const systime_t now = osalOsGetSystemTimeX();
+	dev->enumTime[phase] = now - *t;
+	*t = now;
+}
+
+static void _enum_timing_print(usbh_port_t *port) {
+	const systime_t *const t = port->device.enumTime;
+	(void)t;
+	uportinfof("Port %d: enumeration time (ticks): debounce=%u, reset=%u, address=%u, "
+			"langID=%u, configure=%u, drivers=%u, total=%u", port->number,
+			t[USBH_ENUMPHASE_DEBOUNCE], t[USBH_ENUMPHASE_RESET],
+			t[USBH_ENUMPHASE_ADDRESS], t[USBH_ENUMPHASE_LANGID],
+			t[USBH_ENUMPHASE_CONFIGURE], t[USBH_ENUMPHASE_DRIVERS],
+			osalOsGetSystemTimeX() - port->attachTime);
+}
+#define _ENUM_TIMING_START(t)				systime_t t = osalOsGetSystemTimeX()
+#define _ENUM_TIMING_SET(dev, phase, ticks)	(dev)->enumTime[phase] = (ticks)
+#define _ENUM_TIMING_MARK(dev, phase, t)	_enum_timing_mark(dev, phase, &t)
+#define _ENUM_TIMING_PRINT(port)			_enum_timing_print(port)
+#else
+#define _ENUM_TIMING_START(t)				do {} while(0)
+#define _ENUM_TIMING_SET(dev, phase, ticks)	do {} while(0)
+#define _ENUM_TIMING_MARK(dev, phase, t)	do {} while(0)
+#define _ENUM_TIMING_PRINT(port)			do {} while(0)
+#endif
+
 /*===========================================================================*/
 /* Device-related functions.                                                 */
 /*===========================================================================*/
@@ -520,6 +884,9 @@ static void _device_initialize(usbh_device_t *dev, usbh_devspeed_t speed) {
 	dev->status = USBH_DEVSTATUS_DEFAULT;
 	dev->langID0 = 0;
 	dev->keepFullCfgDesc = 0;
+#if HAL_USBH_USE_CFGDESC_CACHE
+	dev->cfgDescCached = 0;
+#endif
 	_ep0_object_init(dev, 64);
 }
 
@@ -547,6 +914,14 @@ static void _device_read_full_cfgdesc(usbh_device_t *dev, uint8_t bConfiguration
 
 	uint8_t i;
 
+#if HAL_USBH_USE_CFGDESC_CACHE
+	if (dev->cfgDescCached && (bConfiguration == 0)
+			&& (dev->fullConfigurationDescriptor != NULL)) {
+		/* already loaded from the cache */
+		return;
+	}
+#endif
+
 	if (dev->fullConfigurationDescriptor != NULL) {
 		chHeapFree(dev->fullConfigurationDescriptor);
 	}
@@ -561,6 +936,10 @@ static void _device_read_full_cfgdesc(usbh_device_t *dev, uint8_t bConfiguration
 		if (usbhStdReqGetConfigurationDescriptor(dev, bConfiguration,
 				dev->basicConfigDesc.wTotalLength,
 				dev->fullConfigurationDescriptor) == HAL_SUCCESS) {
+#if HAL_USBH_USE_CFGDESC_CACHE
+			if (bConfiguration == 0)
+				_cfgdesc_cache_insert(dev);
+#endif
 			return;
 		}
 		osalThreadSleepMilliseconds(200);
@@ -593,10 +972,18 @@ static bool _device_set_configuration(usbh_device_t *dev, uint8_t configuration)
 static bool _device_configure(usbh_device_t *dev, uint8_t bConfiguration) {
 	uint8_t i;
 
-	udevinfof("Reading basic configuration descriptor %d", bConfiguration);
-	for (i = 0; i < 3; i++) {
-		if (!_device_read_basic_cfgdesc(dev, bConfiguration))
-			break;
+#if HAL_USBH_USE_CFGDESC_CACHE
+	if (dev->cfgDescCached && (bConfiguration == 0)) {
+		/* basic configuration descriptor already loaded from the cache */
+		i = 0;
+	} else
+#endif
+	{
+		udevinfof("Reading basic configuration descriptor %d", bConfiguration);
+		for (i = 0; i < 3; i++) {
+			if (!_device_read_basic_cfgdesc(dev, bConfiguration))
+				break;
+		}
 	}
 
 	if (i == 3) {
@@ -840,6 +1227,30 @@ static void _port_update_status(usbh_port_t *port) {
 	port->c_status |= stat >> 16;
 }
 
+/* Each port de-bounces on its own timer, so the ports of a hub de-bounce
+ * concurrently. The timer only marks the port: the reset and enumeration
+ * run from usbhMainLoop, one port at a time, because the device answers at
+ * the default address until it is addressed. */
+static void _port_debounce_vt(void *p) {
+	usbh_port_t *const port = (usbh_port_t *)p;
+
+	osalSysLockFromISR();
+	port->debounced = TRUE;
+	osalSysUnlockFromISR();
+}
+
+static void _port_attached(usbh_port_t *port) {
+	port->device.status = USBH_DEVSTATUS_ATTACHED;
+	port->attachTime = osalOsGetSystemTimeX();
+	uportinfof("Port %d: attached, wait debounce...", port->number);
+
+	osalSysLock();
+	port->debounced = FALSE;
+	chVTSetI(&port->debounce_vt, OSAL_MS2I(HAL_USBH_PORT_DEBOUNCE_TIME),
+			_port_debounce_vt, port);
+	osalSysUnlock();
+}
+
 static void _port_process_status_change(usbh_port_t *port) {
 
 	_port_update_status(port);
@@ -855,7 +1266,7 @@ static void _port_process_status_change(usbh_port_t *port) {
 
 	if (port->device.status == USBH_DEVSTATUS_DISCONNECTED) {
 		if (port->status & USBH_PORTSTATUS_CONNECTION) {
-			_port_connected(port);
+			_port_attached(port);
 		}
 	}
 
@@ -885,20 +1296,24 @@ static void _port_process_status_change(usbh_port_t *port) {
 
 }
 
+static void _port_process_debounce(usbh_port_t *port) {
+	if ((port->device.status != USBH_DEVSTATUS_ATTACHED) || !port->debounced)
+		return;
+
+	port->debounced = FALSE;
+	_port_connected(port);
+}
+
 static void _port_connected(usbh_port_t *port) {
-	/* connected */
+	/* de-bounced */
 
 	systime_t start;
 	uint8_t i;
 	uint8_t retries;
 	usbh_devspeed_t speed;
 	USBH_DEFINE_BUFFER(usbh_string_descriptor_t strdesc);
-
-	port->device.status = USBH_DEVSTATUS_ATTACHED;
-	uportinfof("Port %d: attached, wait debounce...", port->number);
-
-	/* wait for attach de-bounce */
-	osalThreadSleepMilliseconds(HAL_USBH_PORT_DEBOUNCE_TIME);
+	_ENUM_TIMING_START(t);
+	_ENUM_TIMING_SET(&port->device, USBH_ENUMPHASE_DEBOUNCE, t - port->attachTime);
 
 	/* check disconnection */
 	_port_update_status(port);
@@ -975,6 +1390,7 @@ reset_success:
 		speed = USBH_DEVSPEED_FULL;
 	}
 	_device_initialize(&port->device, speed);
+	_ENUM_TIMING_MARK(&port->device, USBH_ENUMPHASE_RESET, t);
 	usbhEPOpen(&port->device.ctrl);
 
 	/* device with default address (0), try enumeration */
@@ -992,25 +1408,39 @@ reset_success:
 		goto reset;
 	}
 
-	/* load the default language ID */
-	uportinfof("Port %d: Loading langID0...", port->number);
-	if (!usbhStdReqGetStringDescriptor(&port->device, 0, 0,
-			USBH_DT_STRING_SIZE, (uint8_t *)&strdesc)
-		&& (strdesc.bLength >= 4)
-		&& !usbhStdReqGetStringDescriptor(&port->device, 0, 0,
-			4, (uint8_t *)&strdesc)) {
+	_ENUM_TIMING_MARK(&port->device, USBH_ENUMPHASE_ADDRESS, t);
 
-		port->device.langID0 = strdesc.wData[0];
-		uportinfof("Port %d: langID0=%04x", port->number, port->device.langID0);
+#if HAL_USBH_USE_CFGDESC_CACHE
+	/* a cache hit provides langID0 and the configuration descriptor */
+	if (_cfgdesc_cache_lookup(&port->device)) {
+		uportinfof("Port %d: langID0=%04x (cached)", port->number, port->device.langID0);
+	} else
+#endif
+	{
+		/* load the default language ID */
+		uportinfof("Port %d: Loading langID0...", port->number);
+		if (!usbhStdReqGetStringDescriptor(&port->device, 0, 0,
+				USBH_DT_STRING_SIZE, (uint8_t *)&strdesc)
+			&& (strdesc.bLength >= 4)
+			&& !usbhStdReqGetStringDescriptor(&port->device, 0, 0,
+				4, (uint8_t *)&strdesc)) {
+
+			port->device.langID0 = strdesc.wData[0];
+			uportinfof("Port %d: langID0=%04x", port->number, port->device.langID0);
+		}
 	}
+	_ENUM_TIMING_MARK(&port->device, USBH_ENUMPHASE_LANGID, t);
 
 	/* check if the device has only one configuration */
 	if (port->device.devDesc.bNumConfigurations == 1) {
 		uportinfof("Port %d: device has only one configuration", port->number);
 		_device_configure(&port->device, 0);
 	}
+	_ENUM_TIMING_MARK(&port->device, USBH_ENUMPHASE_CONFIGURE, t);
 
 	_classdriver_process_device(&port->device);
+	_ENUM_TIMING_MARK(&port->device, USBH_ENUMPHASE_DRIVERS, t);
+	_ENUM_TIMING_PRINT(port);
 	return;
 
 abort:
@@ -1022,6 +1452,17 @@ void _usbh_port_disconnected(usbh_port_t *port) {
 	if (port->device.status == USBH_DEVSTATUS_DISCONNECTED)
 		return;
 
+	if (port->device.status == USBH_DEVSTATUS_ATTACHED) {
+		/* still de-bouncing; nothing has been allocated yet */
+		uportwarnf("Port %d: connection state changed; abort debounce", port->number);
+		osalSysLock();
+		chVTResetI(&port->debounce_vt);
+		port->debounced = FALSE;
+		osalSysUnlock();
+		port->device.status = USBH_DEVSTATUS_DISCONNECTED;
+		return;
+	}
+
 	uportinfof("Port %d: disconnected", port->number);
 
 	/* unload drivers */
@@ -1108,16 +1549,16 @@ static uint32_t _hub_get_status_change_bitmap(USBHDriver *host, USBHHubDriver *h
 #if HAL_USBH_USE_HUB
 static void _hub_process(USBHDriver *host, USBHHubDriver *hub) {
 	uint32_t bitmap = _hub_get_status_change_bitmap(host, hub);
-	if (!bitmap)
-		return;
+	usbh_port_t *const ports = (hub == NULL) ? &host->rootport : hub->ports;
+	usbh_port_t *port;
 
 	if (bitmap & 1) {
 		_hub_process_status_change(host, hub);
 		bitmap &= ~1;
 	}
 
-	usbh_port_t *port = (hub == NULL) ? &host->rootport : hub->ports;
 	uint8_t i;
+	port = ports;
 	for (i = 1; i < 32; i++) {
 		if (!bitmap || !port)
 			break;
@@ -1128,6 +1569,10 @@ static void _hub_process(USBHDriver *host, USBHHubDriver *hub) {
 		port = port->next;
 	}
 
+	/* reset and address the de-bounced ports, one at a time */
+	for (port = ports; port; port = port->next) {
+		_port_process_debounce(port);
+	}
 }
 #else
 static void _hub_process(USBHDriver *host) {
@@ -1140,10 +1585,10 @@ static void _hub_process(USBHDriver *host) {
 	}
 #endif
 
-	if (!bitmap)
-		return;
+	if (bitmap)
+		_port_process_status_change(&host->rootport);
 
-	_port_process_status_change(&host->rootport);
+	_port_process_debounce(&host->rootport);
 }
 #endif
 
@@ -1182,48 +1627,55 @@ bool _usbh_match_vid_pid(usbh_device_t *dev, int32_t vid, int32_t pid) {
 	return HAL_FAILED;
 }
 
-bool _usbh_match_descriptor(const uint8_t *descriptor, uint16_t rem,
-		int16_t type, int16_t _class, int16_t subclass, int16_t protocol) {
-
-	int16_t dclass, dsubclass, dprotocol;
-
-	if ((rem < descriptor[0]) || (rem < 2))
-		return HAL_FAILED;
-
-	uint8_t dtype = descriptor[1];
+static bool _descriptor_get_class(const uint8_t *descriptor, uint16_t rem,
+		uint8_t *dclass, uint8_t *dsubclass, uint8_t *dprotocol) {
 
-	if ((type >= 0) && (type != dtype))
+	if ((rem < 2) || (rem < descriptor[0]))
 		return HAL_FAILED;
 
-	switch (dtype) {
+	switch (descriptor[1]) {
 	case USBH_DT_DEVICE: {
 		if (rem < USBH_DT_DEVICE_SIZE)
 			return HAL_FAILED;
 		const usbh_device_descriptor_t *const desc = (const usbh_device_descriptor_t *)descriptor;
-		dclass = desc->bDeviceClass;
-		dsubclass = desc->bDeviceSubClass;
-		dprotocol = desc->bDeviceProtocol;
+		*dclass = desc->bDeviceClass;
+		*dsubclass = desc->bDeviceSubClass;
+		*dprotocol = desc->bDeviceProtocol;
 	}	break;
 	case USBH_DT_INTERFACE: {
 		if (rem < USBH_DT_INTERFACE_SIZE)
 			return HAL_FAILED;
 		const usbh_interface_descriptor_t *const desc = (const usbh_interface_descriptor_t *)descriptor;
-		dclass = desc->bInterfaceClass;
-		dsubclass = desc->bInterfaceSubClass;
-		dprotocol = desc->bInterfaceProtocol;
+		*dclass = desc->bInterfaceClass;
+		*dsubclass = desc->bInterfaceSubClass;
+		*dprotocol = desc->bInterfaceProtocol;
 	}	break;
 	case USBH_DT_INTERFACE_ASSOCIATION: {
 		if (rem < USBH_DT_INTERFACE_ASSOCIATION_SIZE)
 			return HAL_FAILED;
 		const usbh_ia_descriptor_t *const desc = (const usbh_ia_descriptor_t *)descriptor;
-		dclass = desc->bFunctionClass;
-		dsubclass = desc->bFunctionSubClass;
-		dprotocol = desc->bFunctionProtocol;
+		*dclass = desc->bFunctionClass;
+		*dsubclass = desc->bFunctionSubClass;
+		*dprotocol = desc->bFunctionProtocol;
 	}	break;
 	default:
 		return HAL_FAILED;
 	}
 
+	return HAL_SUCCESS;
+}
+
+bool _usbh_match_descriptor(const uint8_t *descriptor, uint16_t rem,
+		int16_t type, int16_t _class, int16_t subclass, int16_t protocol) {
+
+	uint8_t dclass, dsubclass, dprotocol;
+
+	if (_descriptor_get_class(descriptor, rem, &dclass, &dsubclass, &dprotocol) != HAL_SUCCESS)
+		return HAL_FAILED;
+
+	if ((type >= 0) && (type != descriptor[1]))
+		return HAL_FAILED;
+
 	if (((_class < 0) || (_class == dclass))
 		&& ((subclass < 0) || (subclass == dsubclass))
 		&& ((protocol < 0) || (protocol == dprotocol)))
@@ -1252,30 +1704,195 @@ static const usbh_classdriverinfo_t *usbh_classdrivers_lookup[] = {
 #if HAL_USBH_USE_HID
 	&usbhhidClassDriverInfo,
 #endif
-#if HAL_USBH_USE_UVC
-	&usbhuvcClassDriverInfo,
-#endif
 #if HAL_USBH_USE_AOA
 	&usbhaoaClassDriverInfo,	/* Leave always last */
 #endif
 };
 
-static bool _classdriver_load(usbh_device_t *dev, uint8_t *descbuff, uint16_t rem) {
+static usbh_classdriver_node_t usbh_classdrivers_builtin[sizeof_array(usbh_classdrivers_lookup)];
+
+/* Class driver index: one entry per match table entry, sorted by key. The key
+ * is the descriptor type plus the most selective field the entry requires:
+ * the vendor ID, else the class; entries requiring neither (and drivers
+ * without a table) get a wildcard key. An offered descriptor can only hit
+ * three key ranges, found by binary search. */
+#define _INDEX_KEY_ANY		0
+#define _INDEX_KEY_CLASS	1
+#define _INDEX_KEY_VENDOR	2
+#define _index_key(dtype, kind, value)	\
+	(((uint32_t)(dtype) << 24) | ((uint32_t)(kind) << 16) | (uint32_t)(value))
+
+/* built-in drivers in table order, after every registered driver */
+#define _ORDER_BUILTIN		0xff00U
+
+typedef struct {
+	uint32_t key;
+	const usbh_classdriver_node_t *node;
+	const usbh_classdriver_id_t *id;
+} usbh_classdriver_index_t;
+
+static usbh_classdriver_index_t usbh_classdriver_index[HAL_USBH_CLASSDRIVER_INDEX_SIZE];
+static uint16_t usbh_classdriver_index_count;
+/* the last registered driver is offered the descriptor first */
+static uint16_t usbh_classdriver_next_order = _ORDER_BUILTIN;
+
+static uint32_t _classdriver_id_key(const usbh_classdriver_id_t *id) {
+	if (id->match & USBH_MATCH_VENDOR)
+		return _index_key(id->bDescriptorType, _INDEX_KEY_VENDOR, id->idVendor);
+	if (id->match & USBH_MATCH_CLASS)
+		return _index_key(id->bDescriptorType, _INDEX_KEY_CLASS, id->bClass);
+	return _index_key(id->bDescriptorType, _INDEX_KEY_ANY, 0);
+}
+
+/* first entry with a key not lower than key */
+static uint16_t _classdriver_index_find(uint32_t key) {
+	uint16_t lo = 0;
+	uint16_t hi = usbh_classdriver_index_count;
+
+	while (lo < hi) {
+		const uint16_t mid = (uint16_t)((lo + hi) / 2);
+		if (usbh_classdriver_index[mid].key < key) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+static void _classdriver_index_add(const usbh_classdriver_node_t *node,
+		const usbh_classdriver_id_t *id, uint32_t key) {
+	const uint16_t pos = _classdriver_index_find(key + 1);
+
+	if (usbh_classdriver_index_count >= HAL_USBH_CLASSDRIVER_INDEX_SIZE) {
+		osalDbgAssert(FALSE, "class driver index full");
+		return;
+	}
+
+	memmove(&usbh_classdriver_index[pos + 1], &usbh_classdriver_index[pos],
+			(usbh_classdriver_index_count - pos) * sizeof(usbh_classdriver_index[0]));
+	usbh_classdriver_index[pos].key = key;
+	usbh_classdriver_index[pos].node = node;
+	usbh_classdriver_index[pos].id = id;
+	usbh_classdriver_index_count++;
+}
+
+static void _classdriver_link(usbh_classdriver_node_t *node,
+		const usbh_classdriverinfo_t *info, uint16_t order) {
 	uint8_t i;
-	usbh_baseclassdriver_t *drv = NULL;
-	for (i = 0; i < sizeof_array(usbh_classdrivers_lookup); i++) {
-		const usbh_classdriverinfo_t *const info = usbh_classdrivers_lookup[i];
 
-		udevinfof("Try load driver %s", info->name);
-		drv = info->vmt->load(dev, descbuff, rem);
+	node->info = info;
+	node->order = order;
+	if (info->ids == NULL) {
+		_classdriver_index_add(node, NULL, _index_key(USBH_DT_DEVICE, _INDEX_KEY_ANY, 0));
+		_classdriver_index_add(node, NULL, _index_key(USBH_DT_INTERFACE, _INDEX_KEY_ANY, 0));
+		_classdriver_index_add(node, NULL, _index_key(USBH_DT_INTERFACE_ASSOCIATION, _INDEX_KEY_ANY, 0));
+	} else {
+		for (i = 0; i < info->ids_count; i++) {
+			_classdriver_index_add(node, &info->ids[i], _classdriver_id_key(&info->ids[i]));
+		}
+	}
 
-		if (drv != NULL)
-			goto success;
+	if (info->vmt->init) {
+		info->vmt->init();
 	}
+}
 
-	return HAL_FAILED;
+/* Registered drivers take precedence over the built-in ones. Must be called
+ * from the same thread that runs usbhMainLoop (or before usbhStart). */
+void usbhClassDriverRegister(usbh_classdriver_node_t *node,
+		const usbh_classdriverinfo_t *info) {
+	osalDbgCheck((node != NULL) && (info != NULL) && (info->vmt != NULL));
+	osalDbgCheck((info->ids == NULL) || (info->ids_count > 0));
+	osalDbgAssert(usbh_classdriver_next_order > 0, "too many registrations");
+	_classdriver_link(node, info, --usbh_classdriver_next_order);
+}
+
+/* The caller must make sure no device is bound to this driver. */
+void usbhClassDriverUnregister(usbh_classdriver_node_t *node) {
+	uint16_t i, j;
+
+	osalDbgCheck(node != NULL);
+	for (i = j = 0; i < usbh_classdriver_index_count; i++) {
+		if (usbh_classdriver_index[i].node != node) {
+			usbh_classdriver_index[j++] = usbh_classdriver_index[i];
+		}
+	}
+	usbh_classdriver_index_count = j;
+	node->info = NULL;
+}
+
+static bool _classdriver_id_match(const usbh_classdriver_id_t *id,
+		const usbh_device_t *dev, const usbh_classdriver_match_t *match) {
+
+	if (id == NULL)
+		return TRUE;
+	if (id->bDescriptorType != match->bDescriptorType)
+		return FALSE;
+	if ((id->match & USBH_MATCH_VENDOR) && (id->idVendor != dev->devDesc.idVendor))
+		return FALSE;
+	if ((id->match & USBH_MATCH_PRODUCT) && (id->idProduct != dev->devDesc.idProduct))
+		return FALSE;
+	if ((id->match & USBH_MATCH_CLASS) && (id->bClass != match->bClass))
+		return FALSE;
+	if ((id->match & USBH_MATCH_SUBCLASS) && (id->bSubClass != match->bSubClass))
+		return FALSE;
+	if ((id->match & USBH_MATCH_PROTOCOL) && (id->bProtocol != match->bProtocol))
+		return FALSE;
+	return TRUE;
+}
+
+bool _usbh_classdriver_load(usbh_device_t *dev, const uint8_t *descriptor, uint16_t rem) {
+	usbh_classdriver_match_t match;
+	usbh_baseclassdriver_t *drv;
+	uint16_t first[3], end[3];
+	int32_t tried = -1;
+	uint8_t k;
+
+	/* extract the matching keys once */
+	if (_descriptor_get_class(descriptor, rem,
+			&match.bClass, &match.bSubClass, &match.bProtocol) != HAL_SUCCESS)
+		return HAL_FAILED;
+	match.bDescriptorType = descriptor[1];
+
+	const uint32_t keys[3] = {
+		_index_key(match.bDescriptorType, _INDEX_KEY_VENDOR, dev->devDesc.idVendor),
+		_index_key(match.bDescriptorType, _INDEX_KEY_CLASS, match.bClass),
+		_index_key(match.bDescriptorType, _INDEX_KEY_ANY, 0),
+	};
+	for (k = 0; k < 3; k++) {
+		first[k] = _classdriver_index_find(keys[k]);
+		end[k] = _classdriver_index_find(keys[k] + 1);
+	}
+
+	/* offer the descriptor to the matching drivers in order of precedence */
+	for (;;) {
+		const usbh_classdriver_index_t *best = NULL;
+		uint16_t i;
+
+		for (k = 0; k < 3; k++) {
+			for (i = first[k]; i < end[k]; i++) {
+				const usbh_classdriver_index_t *const e = &usbh_classdriver_index[i];
+				if ((e->node->order <= tried)
+						|| ((best != NULL) && (e->node->order >= best->node->order))
+						|| !_classdriver_id_match(e->id, dev, &match))
+					continue;
+				best = e;
+			}
+		}
+
+		if (best == NULL)
+			return HAL_FAILED;
+
+		tried = best->node->order;
+		match.id = best->id;
+		udevinfof("Try load driver %s", best->node->info->name);
+		drv = best->node->info->vmt->load(dev, descriptor, rem, &match);
+
+		if (drv != NULL)
+			break;
+	}
 
-success:
 	/* Link this driver to the device */
 	if (!drv->dev) {
 		drv->next = dev->drivers;
@@ -1334,7 +1951,7 @@ static void _classdriver_process_device(usbh_device_t *dev) {
 		for (if_iter_init(&iif, &icfg); iif.valid; if_iter_next(&iif)) {
 			if (iif.iad && (iif.iad != last_iad)) {
 				last_iad = iif.iad;
-				if (_classdriver_load(dev,
+				if (_usbh_classdriver_load(dev,
 						(uint8_t *)iif.iad,
 						(uint8_t *)iif.curr - (uint8_t *)iif.iad + iif.rem) != HAL_SUCCESS) {
 					udevwarnf("No drivers found for IF collection #%d:%d",
@@ -1346,7 +1963,7 @@ static void _classdriver_process_device(usbh_device_t *dev) {
 
 	} else
 #endif
-	if (_classdriver_load(dev, (uint8_t *)devdesc, USBH_DT_DEVICE_SIZE) != HAL_SUCCESS) {
+	if (_usbh_classdriver_load(dev, (uint8_t *)devdesc, USBH_DT_DEVICE_SIZE) != HAL_SUCCESS) {
 		udevinfo("No drivers found for device.");
 
 		if (devdesc->bDeviceClass == 0) {
@@ -1368,7 +1985,7 @@ static void _classdriver_process_device(usbh_device_t *dev) {
 				const usbh_interface_descriptor_t *const ifdesc = if_get(&iif);
 				if (ifdesc->bInterfaceNumber != last_if) {
 					last_if = ifdesc->bInterfaceNumber;
-					if (_classdriver_load(dev, (uint8_t *)ifdesc, iif.rem) != HAL_SUCCESS) {
+					if (_usbh_classdriver_load(dev, (uint8_t *)ifdesc, iif.rem) != HAL_SUCCESS) {
 						udevwarnf("No drivers found for IF #%d", ifdesc->bInterfaceNumber);
 					}
 				}
@@ -1386,10 +2003,12 @@ exit:
 
 void usbhInit(void) {
 	uint8_t i;
+#if HAL_USBH_USE_CFGDESC_CACHE
+	_cfgdesc_cache_init();
+#endif
 	for (i = 0; i < sizeof_array(usbh_classdrivers_lookup); i++) {
-		if (usbh_classdrivers_lookup[i]->vmt->init) {
-			usbh_classdrivers_lookup[i]->vmt->init();
-		}
+		_classdriver_link(&usbh_classdrivers_builtin[i],
+				usbh_classdrivers_lookup[i], _ORDER_BUILTIN + i);
 	}
 	usbh_lld_init();
 }
@@ -95,7 +95,8 @@ static void _stop_channelS(USBHAOAChannel *aoacp);
 /*===========================================================================*/
 USBHAOADriver USBHAOAD[HAL_USBHAOA_MAX_INSTANCES];
 
-static usbh_baseclassdriver_t *_aoa_load(usbh_device_t *dev, const uint8_t *descriptor, uint16_t rem);
+static usbh_baseclassdriver_t *_aoa_load(usbh_device_t *dev, const uint8_t *descriptor, uint16_t rem,
+		const usbh_classdriver_match_t *match);
 static void _aoa_unload(usbh_baseclassdriver_t *drv);
 static void _aoa_init(void);
 
@@ -105,15 +106,26 @@ static const usbh_classdriver_vmt_t class_driver_vmt = {
 	_aoa_unload
 };
 
+static const usbh_classdriver_id_t class_driver_ids[] = {
+	/* composite devices, as Android devices enumerate: try to switch them to
+	 * accessory mode */
+	{ USBH_MATCH_CLASS, USBH_DT_DEVICE, 0, 0, 0x00, 0, 0 },
+	USBH_CLASSDRIVER_ID_CLASS(USBH_DT_DEVICE, 0xef, 0x02, 0x01),
+	/* Android device already in accessory mode: the Accessory IF */
+	{ USBH_MATCH_VENDOR | USBH_MATCH_CLASS | USBH_MATCH_SUBCLASS | USBH_MATCH_PROTOCOL,
+		USBH_DT_INTERFACE, AOA_GOOGLE_VID, 0, 0xff, 0xff, 0x00 },
+};
+
 const usbh_classdriverinfo_t usbhaoaClassDriverInfo = {
-	"AOA", &class_driver_vmt
+	"AOA", &class_driver_vmt, class_driver_ids, sizeof_array(class_driver_ids)
 };
 
 #if defined(HAL_USBHAOA_FILTER_CALLBACK)
 extern usbhaoa_filter_callback_t HAL_USBHAOA_FILTER_CALLBACK;
 #endif
 
-static usbh_baseclassdriver_t *_aoa_load(usbh_device_t *dev, const uint8_t *descriptor, uint16_t rem) {
+static usbh_baseclassdriver_t *_aoa_load(usbh_device_t *dev, const uint8_t *descriptor, uint16_t rem,
+		const usbh_classdriver_match_t *match) {
 	int i;
 	USBHAOADriver *aoap;
 
@@ -134,7 +146,7 @@ static usbh_baseclassdriver_t *_aoa_load(usbh_device_t *dev, const uint8_t *desc
 			}
 		};
 
-		if (descriptor[1] != USBH_DT_DEVICE) {
+		if (match->bDescriptorType != USBH_DT_DEVICE) {
 			udevinfo("AOA: Won't try to detect Android device at interface level");
 			return NULL;
 		}
@@ -182,6 +194,10 @@ static usbh_baseclassdriver_t *_aoa_load(usbh_device_t *dev, const uint8_t *desc
 		return NULL;
 	}
 
+	/* Android device in accessory mode: wait for the Accessory IF */
+	if (match->bDescriptorType != USBH_DT_INTERFACE)
+		return NULL;
+
 	/* AOAv2:
 		0x2D00	accessory				Provides two bulk endpoints for communicating with an Android application.
 		0x2D01	accessory + adb			For debugging purposes during accessory development. Available only if the user has enabled USB Debugging in the Android device settings.
@@ -205,8 +221,7 @@ static usbh_baseclassdriver_t *_aoa_load(usbh_device_t *dev, const uint8_t *desc
 	}
 
 	const usbh_interface_descriptor_t * const ifdesc = (const usbh_interface_descriptor_t *)descriptor;
-	if ((_usbh_match_descriptor(descriptor, rem, USBH_DT_INTERFACE, 0xFF, 0xFF, 0x00) != HAL_SUCCESS)
-			|| (ifdesc->bNumEndpoints < 2)) {
+	if (ifdesc->bNumEndpoints < 2) {
 		udeverr("AOA: This IF is not the Accessory IF");
 		return NULL;
 	}
@@ -283,6 +298,15 @@ static void _aoa_unload(usbh_baseclassdriver_t *drv) {
 /*      Accessory data channel          */
 /* ------------------------------------ */
 
+/* The stream functions and the packet API use different URBs: each one
+ * is rejected on a channel started by the other */
+#if HAL_USBHAOA_USE_PACKET_API
+#define _stream_ready(aoacp)	(((aoacp)->state == USBHAOA_CHANNEL_STATE_READY) && !(aoacp)->packet_mode)
+#define _packet_ready(aoacp)	(((aoacp)->state == USBHAOA_CHANNEL_STATE_READY) && (aoacp)->packet_mode)
+#else
+#define _stream_ready(aoacp)	((aoacp)->state == USBHAOA_CHANNEL_STATE_READY)
+#endif
+
 static void _submitOutI(USBHAOAChannel *aoacp, uint32_t len) {
 	uclassdrvdbgf("AOA: Submit OUT %d", len);
 	aoacp->oq_urb.requestedLength = len;
@@ -319,7 +343,7 @@ static size_t _write_timeout(USBHAOAChannel *aoacp, const uint8_t *bp,
 	size_t w = 0;
 	osalSysLock();
 	while (true) {
-		if (aoacp->state != USBHAOA_CHANNEL_STATE_READY) {
+		if (!_stream_ready(aoacp)) {
 			osalSysUnlock();
 			return w;
 		}
@@ -348,7 +372,7 @@ static size_t _write_timeout(USBHAOAChannel *aoacp, const uint8_t *bp,
 static msg_t _put_timeout(USBHAOAChannel *aoacp, uint8_t b, systime_t timeout) {
 
 	osalSysLock();
-	if (aoacp->state != USBHAOA_CHANNEL_STATE_READY) {
+	if (!_stream_ready(aoacp)) {
 		osalSysUnlock();
 		return Q_RESET;
 	}
@@ -420,7 +444,7 @@ static size_t _read_timeout(USBHAOAChannel *aoacp, uint8_t *bp,
 
 	osalSysLock();
 	while (true) {
-		if (aoacp->state != USBHAOA_CHANNEL_STATE_READY) {
+		if (!_stream_ready(aoacp)) {
 			osalSysUnlock();
 			return r;
 		}
@@ -451,7 +475,7 @@ static msg_t _get_timeout(USBHAOAChannel *aoacp, systime_t timeout) {
 	uint8_t b;
 
 	osalSysLock();
-	if (aoacp->state != USBHAOA_CHANNEL_STATE_READY) {
+	if (!_stream_ready(aoacp)) {
 		osalSysUnlock();
 		return Q_RESET;
 	}
@@ -519,7 +543,7 @@ static void _stop_channelS(USBHAOAChannel *aoacp) {
 static void _vt(void *p) {
 	USBHAOAChannel *const aoacp = (USBHAOAChannel *)p;
 	osalSysLockFromISR();
-	if (aoacp->state == USBHAOA_CHANNEL_STATE_READY) {
+	if (_stream_ready(aoacp)) {
 		uint32_t len = aoacp->oq_ptr - aoacp->oq_buff;
 		if (len && !usbhURBIsBusy(&aoacp->oq_urb)) {
 			_submitOutI(aoacp, len);
@@ -543,9 +567,16 @@ void usbhaoaChannelStart(USBHAOADriver *aoap) {
 	osalDbgCheck((aoacp->state == USBHAOA_CHANNEL_STATE_ACTIVE)
 			|| (aoacp->state == USBHAOA_CHANNEL_STATE_READY));
 
-	if (aoacp->state == USBHAOA_CHANNEL_STATE_READY)
+	if (aoacp->state == USBHAOA_CHANNEL_STATE_READY) {
+#if HAL_USBHAOA_USE_PACKET_API
+		osalDbgAssert(!aoacp->packet_mode, "started in packet mode");
+#endif
 		return;
+	}
 
+#if HAL_USBHAOA_USE_PACKET_API
+	aoacp->packet_mode = false;
+#endif
 	usbhURBObjectInit(&aoacp->oq_urb, &aoacp->epout, _out_cb, aoacp, aoacp->oq_buff, 0);
 	chThdQueueObjectInit(&aoacp->oq_waiting);
 	aoacp->oq_counter = 64;
@@ -575,6 +606,237 @@ void usbhaoaChannelStop(USBHAOADriver *aoap) {
 	osalSysUnlock();
 }
 
+#if HAL_USBHAOA_USE_PACKET_API
+/* ------------------------------------ */
+/*      Accessory packet API            */
+/* ------------------------------------ */
+
+/* The URBs of each direction are queued on the same endpoint, so they
+ * complete in the order they were submitted. */
+
+static void _pkt_out_cb(usbh_urb_t *urb) {
+	USBHAOAChannel *const aoacp = (USBHAOAChannel *)urb->userData;
+	switch (urb->status) {
+	case USBH_URBSTATUS_OK:
+		aoacp->stats.out_bytes += urb->actualLength;
+		break;
+	case USBH_URBSTATUS_DISCONNECTED:
+		uurbwarn("AOA: URB OUT disconnected");
+		chThdDequeueAllI(&aoacp->oq_waiting, Q_RESET);
+		return;
+	default:
+		uurberrf("AOA: URB OUT status unexpected = %d", urb->status);
+		aoacp->stats.out_errors++;
+		break;
+	}
+	aoacp->op_free++;
+	chThdDequeueNextI(&aoacp->oq_waiting, Q_OK);
+	if (aoacp->op_free == HAL_USBHAOA_OUT_PACKETS)
+		chnAddFlagsI(aoacp, CHN_OUTPUT_EMPTY | CHN_TRANSMISSION_END);
+}
+
+static void _pkt_in_cb(usbh_urb_t *urb) {
+	USBHAOAChannel *const aoacp = (USBHAOAChannel *)urb->userData;
+	switch (urb->status) {
+	case USBH_URBSTATUS_OK:
+		if (urb->actualLength) {
+			aoacp->stats.in_packets++;
+			aoacp->stats.in_bytes += urb->actualLength;
+			chnAddFlagsI(aoacp, CHN_INPUT_AVAILABLE);
+		}
+		break;
+	case USBH_URBSTATUS_DISCONNECTED:
+		uurbwarn("AOA: URB IN disconnected");
+		chThdDequeueAllI(&aoacp->iq_waiting, Q_RESET);
+		chnAddFlagsI(aoacp, CHN_DISCONNECTED);
+		aoacp->state = USBHAOA_CHANNEL_STATE_ACTIVE;
+		container_of(aoacp, USBHAOADriver, channel)->state = USBHAOA_STATE_ACTIVE;
+		return;
+	default:
+		/* resubmitting won't clear a STALL or a bus error: the IN packets
+		 * stop at this one, the ones received before are still delivered */
+		uurberrf("AOA: URB IN status unexpected = %d", urb->status);
+		aoacp->stats.in_errors++;
+		if (aoacp->ip_status == USBH_URBSTATUS_OK)
+			aoacp->ip_status = urb->status;
+		break;
+	}
+
+	/* packets are kept in order: empty ones are skipped on receive */
+	if (++aoacp->ip_ready == HAL_USBHAOA_IN_PACKETS)
+		aoacp->stats.in_full++;
+	chThdDequeueNextI(&aoacp->iq_waiting, Q_OK);
+}
+
+static void _pkt_in_releaseI(USBHAOAChannel *aoacp) {
+	usbhaoa_packet_t *const pkt = &aoacp->in_packets[aoacp->ip_next];
+	usbhURBObjectResetI(&pkt->urb);
+	usbhURBSubmitI(&pkt->urb);
+	if (++aoacp->ip_next == HAL_USBHAOA_IN_PACKETS)
+		aoacp->ip_next = 0;
+	aoacp->ip_ready--;
+}
+
+uint8_t *usbhaoaPacketAcquire(USBHAOADriver *aoap, systime_t timeout) {
+	osalDbgCheck(aoap);
+	USBHAOAChannel *const aoacp = &aoap->channel;
+	uint8_t *buff;
+
+	osalSysLock();
+	while (true) {
+		if (!_packet_ready(aoacp)) {
+			osalSysUnlock();
+			return NULL;
+		}
+		if (aoacp->op_free)
+			break;
+
+		/* all the packets are in flight: the phone isn't draining fast enough */
+		const systime_t start = osalOsGetSystemTimeX();
+		aoacp->stats.out_waits++;
+		msg_t msg = chThdEnqueueTimeoutS(&aoacp->oq_waiting, timeout);
+		aoacp->stats.out_wait_time += osalOsGetSystemTimeX() - start;
+		if (msg != Q_OK) {
+			osalSysUnlock();
+			return NULL;
+		}
+	}
+	buff = aoacp->out_packets[aoacp->op_next].buff;
+	osalSysUnlock();
+
+	return buff;
+}
+
+bool usbhaoaPacketSubmit(USBHAOADriver *aoap, size_t len) {
+	osalDbgCheck(aoap && (len <= HAL_USBHAOA_PACKET_SIZE));
+	USBHAOAChannel *const aoacp = &aoap->channel;
+
+	osalSysLock();
+	if (!_packet_ready(aoacp)) {
+		osalSysUnlock();
+		return HAL_FAILED;
+	}
+	osalDbgAssert(aoacp->op_free, "no packet acquired");
+
+	usbhaoa_packet_t *const pkt = &aoacp->out_packets[aoacp->op_next];
+	uclassdrvdbgf("AOA: Submit OUT packet %d, len=%d", aoacp->op_next, len);
+	pkt->urb.requestedLength = len;
+	usbhURBObjectResetI(&pkt->urb);
+	usbhURBSubmitI(&pkt->urb);
+	if (++aoacp->op_next == HAL_USBHAOA_OUT_PACKETS)
+		aoacp->op_next = 0;
+	aoacp->op_free--;
+	aoacp->stats.out_packets++;
+	osalOsRescheduleS();
+	osalSysUnlock();
+
+	return HAL_SUCCESS;
+}
+
+const uint8_t *usbhaoaPacketReceive(USBHAOADriver *aoap, size_t *len, systime_t timeout) {
+	osalDbgCheck(aoap && len);
+	USBHAOAChannel *const aoacp = &aoap->channel;
+
+	osalSysLock();
+	while (true) {
+		if (!_packet_ready(aoacp)) {
+			osalSysUnlock();
+			return NULL;
+		}
+		if (aoacp->ip_ready) {
+			usbhaoa_packet_t *const pkt = &aoacp->in_packets[aoacp->ip_next];
+			if (pkt->urb.status != USBH_URBSTATUS_OK) {
+				/* the IN packets stopped here, see usbhaoaPacketGetInStatus */
+				osalSysUnlock();
+				return NULL;
+			}
+			if (pkt->urb.actualLength)
+				break;
+			_pkt_in_releaseI(aoacp);
+			continue;
+		}
+		if (chThdEnqueueTimeoutS(&aoacp->iq_waiting, timeout) != Q_OK) {
+			osalSysUnlock();
+			return NULL;
+		}
+	}
+	usbhaoa_packet_t *const pkt = &aoacp->in_packets[aoacp->ip_next];
+	*len = pkt->urb.actualLength;
+	osalSysUnlock();
+
+	return pkt->buff;
+}
+
+void usbhaoaPacketRelease(USBHAOADriver *aoap) {
+	osalDbgCheck(aoap);
+	USBHAOAChannel *const aoacp = &aoap->channel;
+
+	osalSysLock();
+	if (_packet_ready(aoacp) && aoacp->ip_ready
+			&& (aoacp->in_packets[aoacp->ip_next].urb.status == USBH_URBSTATUS_OK)) {
+		_pkt_in_releaseI(aoacp);
+		osalOsRescheduleS();
+	}
+	osalSysUnlock();
+}
+
+void usbhaoaPacketStart(USBHAOADriver *aoap) {
+	uint8_t i;
+
+	osalDbgCheck(aoap);
+
+	USBHAOAChannel *const aoacp = (USBHAOAChannel *)&aoap->channel;
+
+	osalDbgCheck(aoap->state == USBHAOA_STATE_READY);
+
+	osalDbgCheck((aoacp->state == USBHAOA_CHANNEL_STATE_ACTIVE)
+			|| (aoacp->state == USBHAOA_CHANNEL_STATE_READY));
+
+	if (aoacp->state == USBHAOA_CHANNEL_STATE_READY) {
+		osalDbgAssert(aoacp->packet_mode, "started in stream mode");
+		return;
+	}
+
+	osalDbgAssert((HAL_USBHAOA_PACKET_SIZE % aoacp->epin.wMaxPacketSize) == 0,
+			"HAL_USBHAOA_PACKET_SIZE not a multiple of wMaxPacketSize");
+
+	memset(&aoacp->stats, 0, sizeof(aoacp->stats));
+
+	for (i = 0; i < HAL_USBHAOA_OUT_PACKETS; i++) {
+		usbhURBObjectInit(&aoacp->out_packets[i].urb, &aoacp->epout, _pkt_out_cb, aoacp,
+				aoacp->out_packets[i].buff, 0);
+	}
+	chThdQueueObjectInit(&aoacp->oq_waiting);
+	aoacp->op_next = 0;
+	aoacp->op_free = HAL_USBHAOA_OUT_PACKETS;
+	usbhEPOpen(&aoacp->epout);
+
+	for (i = 0; i < HAL_USBHAOA_IN_PACKETS; i++) {
+		usbhURBObjectInit(&aoacp->in_packets[i].urb, &aoacp->epin, _pkt_in_cb, aoacp,
+				aoacp->in_packets[i].buff, HAL_USBHAOA_PACKET_SIZE);
+	}
+	chThdQueueObjectInit(&aoacp->iq_waiting);
+	aoacp->ip_next = 0;
+	aoacp->ip_ready = 0;
+	aoacp->ip_status = USBH_URBSTATUS_OK;
+	usbhEPOpen(&aoacp->epin);
+
+	/* not used by the packet API, but reset by _stop_channelS */
+	chVTObjectInit(&aoacp->vt);
+
+	osalSysLock();
+	for (i = 0; i < HAL_USBHAOA_IN_PACKETS; i++) {
+		usbhURBSubmitI(&aoacp->in_packets[i].urb);
+	}
+	aoacp->packet_mode = true;
+	aoacp->state = USBHAOA_CHANNEL_STATE_READY;
+	osalOsRescheduleS();
+	osalSysUnlock();
+
+	osalEventBroadcastFlags(&aoacp->event, CHN_CONNECTED | CHN_OUTPUT_EMPTY);
+}
+#endif
+
 /* ------------------------------------ */
 /*      General AOA functions           */
 /* ------------------------------------ */
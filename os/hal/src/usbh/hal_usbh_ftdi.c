@@ -43,7 +43,8 @@ static void _ftdip_object_init(USBHFTDIPortDriver *ftdipp);
 USBHFTDIDriver USBHFTDID[HAL_USBHFTDI_MAX_INSTANCES];
 
 static void _ftdi_init(void);
-static usbh_baseclassdriver_t *_ftdi_load(usbh_device_t *dev, const uint8_t *descriptor, uint16_t rem);
+static usbh_baseclassdriver_t *_ftdi_load(usbh_device_t *dev, const uint8_t *descriptor, uint16_t rem,
+		const usbh_classdriver_match_t *match);
 static void _ftdi_unload(usbh_baseclassdriver_t *drv);
 
 static const usbh_classdriver_vmt_t class_driver_vmt = {
@@ -52,8 +53,22 @@ static const usbh_classdriver_vmt_t class_driver_vmt = {
 	_ftdi_unload
 };
 
+#define _FTDI_ID(pid)											\
+	{ USBH_MATCH_VENDOR | USBH_MATCH_PRODUCT | USBH_MATCH_CLASS	\
+		| USBH_MATCH_SUBCLASS | USBH_MATCH_PROTOCOL,			\
+		USBH_DT_INTERFACE, 0x0403, (pid), 0xff, 0xff, 0xff }
+
+static const usbh_classdriver_id_t class_driver_ids[] = {
+	_FTDI_ID(0x6001),
+	_FTDI_ID(0x6010),
+	_FTDI_ID(0x6011),
+	_FTDI_ID(0x6014),
+	_FTDI_ID(0x6015),
+	_FTDI_ID(0xE2E6),
+};
+
 const usbh_classdriverinfo_t usbhftdiClassDriverInfo = {
-	"FTDI", &class_driver_vmt
+	"FTDI", &class_driver_vmt, class_driver_ids, sizeof_array(class_driver_ids)
 };
 
 static USBHFTDIPortDriver *_find_port(void) {
@@ -65,29 +80,13 @@ static USBHFTDIPortDriver *_find_port(void) {
 	return NULL;
 }
 
-static usbh_baseclassdriver_t *_ftdi_load(usbh_device_t *dev, const uint8_t *descriptor, uint16_t rem) {
+static usbh_baseclassdriver_t *_ftdi_load(usbh_device_t *dev, const uint8_t *descriptor, uint16_t rem,
+		const usbh_classdriver_match_t *match) {
 	int i;
 	USBHFTDIDriver *ftdip;
 
-	if (_usbh_match_vid_pid(dev, 0x0403, -1) != HAL_SUCCESS)
-		return NULL;
-
-	switch (dev->devDesc.idProduct) {
-	case 0x6001:
-	case 0x6010:
-	case 0x6011:
-	case 0x6014:
-	case 0x6015:
-	case 0xE2E6:
-		break;
-	default:
-		udeverr("FTDI: Unrecognized PID");
-		return NULL;
-	}
-
-	if (_usbh_match_descriptor(descriptor, rem, USBH_DT_INTERFACE,
-			0xff, 0xff, 0xff) != HAL_SUCCESS)
-		return NULL;
+	(void)rem;
+	(void)match;
 
 	if (((const usbh_interface_descriptor_t *)descriptor)->bInterfaceNumber != 0) {
 		udevwarn("FTDI: Will allocate driver along with IF #0");
@@ -174,6 +173,13 @@ alloc_ok:
 			continue;
 		}
 
+		/* the IN URBs must hold whole packets */
+		if (prt->epin.wMaxPacketSize > HAL_USBHFTDI_BUFFER_SIZE) {
+			udevwarnf("\tBULK IN wMaxPacketSize=%d, increase HAL_USBHFTDI_BUFFER_SIZE; "
+					"can't alloc port for this interface", prt->epin.wMaxPacketSize);
+			continue;
+		}
+
 		/* link the new block driver to the list */
 		prt->next = ftdip->ports;
 		ftdip->ports = prt;
@@ -227,12 +233,13 @@ USBHFTDIPortDriver FTDIPD[HAL_USBHFTDI_MAX_PORTS];
 #define FTDI_COMMAND_SETDATA    4
 #define FTDI_SETDATA_BREAK      (0x1 << 14)
 
+#define FTDI_COMMAND_SETLATENCYTIMER      9 /* Set the latency timer */
+
 #if 0
 #define FTDI_COMMAND_MODEMCTRL  	1
 #define FTDI_COMMAND_GETMODEMSTATUS       5 /* Retrieve current value of modem status register */
 #define FTDI_COMMAND_SETEVENTCHAR         6 /* Set the event character */
 #define FTDI_COMMAND_SETERRORCHAR         7 /* Set the error character */
-#define FTDI_COMMAND_SETLATENCYTIMER      9 /* Set the latency timer */
 #define FTDI_COMMAND_GETLATENCYTIMER      10 /* Get the latency timer */
 #endif
 
@@ -296,9 +303,15 @@ static usbh_urbstatus_t _ftdi_port_control(USBHFTDIPortDriver *ftdipp,
 		USBH_REQTYPE_TYPE_VENDOR | USBH_REQTYPE_DIR_OUT | USBH_REQTYPE_RECIP_DEVICE, //2 FTDI_COMMAND_SETFLOW
 		USBH_REQTYPE_TYPE_VENDOR | USBH_REQTYPE_DIR_OUT | USBH_REQTYPE_RECIP_DEVICE, //3 FTDI_COMMAND_SETBAUD
 		USBH_REQTYPE_TYPE_VENDOR | USBH_REQTYPE_DIR_OUT | USBH_REQTYPE_RECIP_DEVICE, //4 FTDI_COMMAND_SETDATA
+		0, //5
+		0, //6
+		0, //7
+		0, //8
+		USBH_REQTYPE_TYPE_VENDOR | USBH_REQTYPE_DIR_OUT | USBH_REQTYPE_RECIP_DEVICE, //9 FTDI_COMMAND_SETLATENCYTIMER
 	};
 
 	osalDbgCheck(bRequest < sizeof_array(bmRequestType));
+	osalDbgCheck(bmRequestType[bRequest] != 0);
 	osalDbgCheck(bRequest != 1);
 
 	USBH_DEFINE_BUFFER(const usbh_control_request_t req) = {
@@ -376,19 +389,27 @@ static usbh_urbstatus_t _set_baudrate(USBHFTDIPortDriver *ftdipp, uint32_t baudr
 }
 
 
+/*
+ * OUT direction: the writer fills the head URB buffer with memcpy and submits
+ * it when full; the virtual timer flushes a partially filled buffer. The URBs
+ * are submitted in ring order, so they complete in ring order too.
+ */
 static void _submitOutI(USBHFTDIPortDriver *ftdipp, uint32_t len) {
+	usbh_urb_t *const urb = &ftdipp->oq_urb[ftdipp->oq_head];
 	uclassdrvdbgf("FTDI: Submit OUT %d", len);
-	ftdipp->oq_urb.requestedLength = len;
-	usbhURBObjectResetI(&ftdipp->oq_urb);
-	usbhURBSubmitI(&ftdipp->oq_urb);
+	urb->requestedLength = len;
+	usbhURBObjectResetI(urb);
+	usbhURBSubmitI(urb);
+	if (++ftdipp->oq_head == HAL_USBHFTDI_OUT_URBS)
+		ftdipp->oq_head = 0;
+	ftdipp->oq_ptr = ftdipp->oq_buff[ftdipp->oq_head];
+	ftdipp->oq_counter = HAL_USBHFTDI_BUFFER_SIZE;
 }
 
 static void _out_cb(usbh_urb_t *urb) {
 	USBHFTDIPortDriver *const ftdipp = (USBHFTDIPortDriver *)urb->userData;
 	switch (urb->status) {
 	case USBH_URBSTATUS_OK:
-		ftdipp->oq_ptr = ftdipp->oq_buff;
-		ftdipp->oq_counter = 64;
 		chThdDequeueNextI(&ftdipp->oq_waiting, Q_OK);
 		return;
 	case USBH_URBSTATUS_DISCONNECTED:
@@ -399,8 +420,20 @@ static void _out_cb(usbh_urb_t *urb) {
 		uurberrf("FTDI: URB OUT status unexpected = %d", urb->status);
 		break;
 	}
-	usbhURBObjectResetI(&ftdipp->oq_urb);
-	usbhURBSubmitI(&ftdipp->oq_urb);
+	usbhURBObjectResetI(urb);
+	usbhURBSubmitI(urb);
+}
+
+static msg_t _oq_waitS(USBHFTDIPortDriver *ftdipp, systime_t timeout) {
+	for (;;) {
+		if (ftdipp->state != USBHFTDIP_STATE_READY)
+			return Q_RESET;
+		if (!usbhURBIsBusy(&ftdipp->oq_urb[ftdipp->oq_head]))
+			return Q_OK;
+		msg_t msg = chThdEnqueueTimeoutS(&ftdipp->oq_waiting, timeout);
+		if (msg < Q_OK)
+			return msg;
+	}
 }
 
 static size_t _write_timeout(USBHFTDIPortDriver *ftdipp, const uint8_t *bp,
@@ -409,52 +442,45 @@ static size_t _write_timeout(USBHFTDIPortDriver *ftdipp, const uint8_t *bp,
 
 	size_t w = 0;
 	osalSysLock();
-	while (true) {
-		if (ftdipp->state != USBHFTDIP_STATE_READY) {
-			osalSysUnlock();
-			return w;
-		}
-		while (usbhURBIsBusy(&ftdipp->oq_urb)) {
-			if (chThdEnqueueTimeoutS(&ftdipp->oq_waiting, timeout) != Q_OK) {
-				osalSysUnlock();
-				return w;
-			}
-		}
+	while (n) {
+		if (_oq_waitS(ftdipp, timeout) != Q_OK)
+			break;
 
-		*ftdipp->oq_ptr++ = *bp++;
-		if (--ftdipp->oq_counter == 0) {
-			_submitOutI(ftdipp, 64);
+		/* the head buffer is ours until submitted; copy without the lock */
+		uint8_t *const dst = ftdipp->oq_ptr;
+		const size_t chunk = (n < ftdipp->oq_counter) ? n : ftdipp->oq_counter;
+		ftdipp->oq_writing = TRUE;
+		osalSysUnlock();
+		memcpy(dst, bp, chunk);
+		osalSysLock();
+		ftdipp->oq_writing = FALSE;
+
+		ftdipp->oq_ptr += chunk;
+		ftdipp->oq_counter -= chunk;
+		bp += chunk;
+		w += chunk;
+		n -= chunk;
+		if (ftdipp->oq_counter == 0) {
+			_submitOutI(ftdipp, HAL_USBHFTDI_BUFFER_SIZE);
 			osalOsRescheduleS();
 		}
-		osalSysUnlock(); /* Gives a preemption chance in a controlled point.*/
-
-		w++;
-		if (--n == 0U)
-			return w;
-
-		osalSysLock();
 	}
+	osalSysUnlock();
+	return w;
 }
 
 static msg_t _put_timeout(USBHFTDIPortDriver *ftdipp, uint8_t b, systime_t timeout) {
 
 	osalSysLock();
-	if (ftdipp->state != USBHFTDIP_STATE_READY) {
+	msg_t msg = _oq_waitS(ftdipp, timeout);
+	if (msg != Q_OK) {
 		osalSysUnlock();
-		return Q_RESET;
-	}
-
-	while (usbhURBIsBusy(&ftdipp->oq_urb)) {
-		msg_t msg = chThdEnqueueTimeoutS(&ftdipp->oq_waiting, timeout);
-		if (msg < Q_OK) {
-			osalSysUnlock();
-			return msg;
-		}
+		return msg;
 	}
 
 	*ftdipp->oq_ptr++ = b;
 	if (--ftdipp->oq_counter == 0) {
-		_submitOutI(ftdipp, 64);
+		_submitOutI(ftdipp, HAL_USBHFTDI_BUFFER_SIZE);
 		osalOsRescheduleS();
 	}
 	osalSysUnlock();
@@ -469,10 +495,67 @@ static msg_t _put(USBHFTDIPortDriver *ftdipp, uint8_t b) {
 	return _put_timeout(ftdipp, b, TIME_INFINITE);
 }
 
-static void _submitInI(USBHFTDIPortDriver *ftdipp) {
+/*
+ * IN direction: all the IN URBs are kept queued on the endpoint. They are only
+ * resubmitted from the head of the ring (once read, or if they carried no
+ * payload), which keeps the received data in order.
+ */
+static void _submitInI(USBHFTDIPortDriver *ftdipp, usbh_urb_t *urb) {
 	uclassdrvdbg("FTDI: Submit IN");
-	usbhURBObjectResetI(&ftdipp->iq_urb);
-	usbhURBSubmitI(&ftdipp->iq_urb);
+	usbhURBObjectResetI(urb);
+	usbhURBSubmitI(urb);
+}
+
+/* Strips the two status bytes that start every packet of a completed IN URB
+ * and leaves the payload contiguous at iq_ptr. Only the packets after the
+ * first one need to be moved. */
+static uint32_t _in_strip(USBHFTDIPortDriver *ftdipp, usbh_urb_t *urb) {
+	const uint32_t mps = ftdipp->epin.wMaxPacketSize;
+	uint8_t *src = (uint8_t *)urb->buff;
+	uint8_t *dst = src + 2;
+	uint32_t rem = urb->actualLength;
+
+	ftdipp->iq_ptr = dst;
+	while (rem >= 2) {
+		const uint32_t pkt = (rem < mps) ? rem : mps;
+		ftdipp->modem_status = src[0];
+		ftdipp->line_status = src[1];
+		if (dst != src + 2)
+			memmove(dst, src + 2, pkt - 2);
+		dst += pkt - 2;
+		src += pkt;
+		rem -= pkt;
+	}
+	if (rem) {
+		uurbwarnf("FTDI: URB IN truncated packet, %d bytes", rem);
+	}
+	return dst - ftdipp->iq_ptr;
+}
+
+/* Exposes the payload of the head URB, recycling completed URBs without
+ * payload on the way. Returns false if the head URB is still in flight. */
+static bool _in_load_headI(USBHFTDIPortDriver *ftdipp) {
+	uint8_t i;
+
+	for (i = 0; i < HAL_USBHFTDI_IN_URBS; i++) {
+		usbh_urb_t *const urb = &ftdipp->iq_urb[ftdipp->iq_head];
+		if (usbhURBIsBusy(urb) || (urb->status == USBH_URBSTATUS_DISCONNECTED))
+			return FALSE;
+
+		if (urb->status == USBH_URBSTATUS_OK) {
+			ftdipp->iq_counter = _in_strip(ftdipp, urb);
+			if (ftdipp->iq_counter) {
+				uurbdbgf("FTDI: URB IN data len=%d, status=%02x %02x",
+						ftdipp->iq_counter, ftdipp->modem_status, ftdipp->line_status);
+				return TRUE;
+			}
+		}
+
+		_submitInI(ftdipp, urb);
+		if (++ftdipp->iq_head == HAL_USBHFTDI_IN_URBS)
+			ftdipp->iq_head = 0;
+	}
+	return FALSE;
 }
 
 static void _in_cb(usbh_urb_t *urb) {
@@ -481,20 +564,6 @@ static void _in_cb(usbh_urb_t *urb) {
 	case USBH_URBSTATUS_OK:
 		if (urb->actualLength < 2) {
 			uurbwarnf("FTDI: URB IN actualLength = %d, < 2", urb->actualLength);
-		} else if (urb->actualLength > 2) {
-			uurbdbgf("FTDI: URB IN data len=%d, status=%02x %02x",
-					urb->actualLength - 2,
-					((uint8_t *)urb->buff)[0],
-					((uint8_t *)urb->buff)[1]);
-			ftdipp->iq_ptr = ftdipp->iq_buff + 2;
-			ftdipp->iq_counter = urb->actualLength - 2;
-			chThdDequeueNextI(&ftdipp->iq_waiting, Q_OK);
-			return;
-		} else {
-			uurbdbgf("FTDI: URB IN no data, status=%02x %02x",
-					((uint8_t *)urb->buff)[0],
-					((uint8_t *)urb->buff)[1]);
-		//	return;
 		}
 		break;
 	case USBH_URBSTATUS_DISCONNECTED:
@@ -505,7 +574,30 @@ static void _in_cb(usbh_urb_t *urb) {
 		uurberrf("FTDI: URB IN status unexpected = %d", urb->status);
 		break;
 	}
-	_submitInI(ftdipp);
+
+	/* URBs behind the head are picked up when the reader gets to them */
+	if ((urb == &ftdipp->iq_urb[ftdipp->iq_head]) && _in_load_headI(ftdipp))
+		chThdDequeueNextI(&ftdipp->iq_waiting, Q_OK);
+}
+
+static msg_t _iq_waitS(USBHFTDIPortDriver *ftdipp, systime_t timeout) {
+	while (ftdipp->iq_counter == 0) {
+		if (ftdipp->state != USBHFTDIP_STATE_READY)
+			return Q_RESET;
+		if (_in_load_headI(ftdipp))
+			break;
+		msg_t msg = chThdEnqueueTimeoutS(&ftdipp->iq_waiting, timeout);
+		if (msg < Q_OK)
+			return msg;
+	}
+	return Q_OK;
+}
+
+static void _in_consumedS(USBHFTDIPortDriver *ftdipp) {
+	_submitInI(ftdipp, &ftdipp->iq_urb[ftdipp->iq_head]);
+	if (++ftdipp->iq_head == HAL_USBHFTDI_IN_URBS)
+		ftdipp->iq_head = 0;
+	osalOsRescheduleS();
 }
 
 static size_t _read_timeout(USBHFTDIPortDriver *ftdipp, uint8_t *bp,
@@ -515,56 +607,42 @@ static size_t _read_timeout(USBHFTDIPortDriver *ftdipp, uint8_t *bp,
 	chDbgCheck(n > 0U);
 
 	osalSysLock();
-	while (true) {
-		if (ftdipp->state != USBHFTDIP_STATE_READY) {
-			osalSysUnlock();
-			return r;
-		}
-		while (ftdipp->iq_counter == 0) {
-			if (!usbhURBIsBusy(&ftdipp->iq_urb))
-				_submitInI(ftdipp);
-			if (chThdEnqueueTimeoutS(&ftdipp->iq_waiting, timeout) != Q_OK) {
-				osalSysUnlock();
-				return r;
-			}
-		}
-		*bp++ = *ftdipp->iq_ptr++;
-		if (--ftdipp->iq_counter == 0) {
-			_submitInI(ftdipp);
-			osalOsRescheduleS();
-		}
-		osalSysUnlock();
-
-		r++;
-		if (--n == 0U)
-			return r;
+	while (n) {
+		if ((ftdipp->state != USBHFTDIP_STATE_READY)
+				|| (_iq_waitS(ftdipp, timeout) != Q_OK))
+			break;
 
+		/* the head URB is not queued while it has data; copy without the lock */
+		const uint8_t *const src = ftdipp->iq_ptr;
+		const size_t chunk = (n < ftdipp->iq_counter) ? n : ftdipp->iq_counter;
+		osalSysUnlock();
+		memcpy(bp, src, chunk);
 		osalSysLock();
+
+		ftdipp->iq_ptr += chunk;
+		ftdipp->iq_counter -= chunk;
+		bp += chunk;
+		r += chunk;
+		n -= chunk;
+		if (ftdipp->iq_counter == 0)
+			_in_consumedS(ftdipp);
 	}
+	osalSysUnlock();
+	return r;
 }
 
 static msg_t _get_timeout(USBHFTDIPortDriver *ftdipp, systime_t timeout) {
 	uint8_t b;
 
 	osalSysLock();
-	if (ftdipp->state != USBHFTDIP_STATE_READY) {
+	msg_t msg = _iq_waitS(ftdipp, timeout);
+	if (msg != Q_OK) {
 		osalSysUnlock();
-		return Q_RESET;
-	}
-	while (ftdipp->iq_counter == 0) {
-		if (!usbhURBIsBusy(&ftdipp->iq_urb))
-			_submitInI(ftdipp);
-		msg_t msg = chThdEnqueueTimeoutS(&ftdipp->iq_waiting, timeout);
-		if (msg < Q_OK) {
-			osalSysUnlock();
-			return msg;
-		}
+		return msg;
 	}
 	b = *ftdipp->iq_ptr++;
-	if (--ftdipp->iq_counter == 0) {
-		_submitInI(ftdipp);
-		osalOsRescheduleS();
-	}
+	if (--ftdipp->iq_counter == 0)
+		_in_consumedS(ftdipp);
 	osalSysUnlock();
 
 	return (msg_t)b;
@@ -588,14 +666,12 @@ static msg_t _ctl(USBHFTDIPortDriver *ftdipp, unsigned int operation, void *arg)
 static void _vt(void *p) {
 	USBHFTDIPortDriver *const ftdipp = (USBHFTDIPortDriver *)p;
 	osalSysLockFromISR();
-	uint32_t len = ftdipp->oq_ptr - ftdipp->oq_buff;
-	if (len && !usbhURBIsBusy(&ftdipp->oq_urb)) {
+	uint32_t len = HAL_USBHFTDI_BUFFER_SIZE - ftdipp->oq_counter;
+	if (len && !ftdipp->oq_writing
+			&& !usbhURBIsBusy(&ftdipp->oq_urb[ftdipp->oq_head])) {
 		_submitOutI(ftdipp, len);
 	}
-	if ((ftdipp->iq_counter == 0) && !usbhURBIsBusy(&ftdipp->iq_urb)) {
-		_submitInI(ftdipp);
-	}
-	chVTSetI(&ftdipp->vt, OSAL_MS2I(16), _vt, ftdipp);
+	chVTSetI(&ftdipp->vt, ftdipp->latency, _vt, ftdipp);
 	osalSysUnlockFromISR();
 }
 
@@ -642,8 +718,10 @@ void usbhftdipStart(USBHFTDIPortDriver *ftdipp, const USBHFTDIPortConfig *config
 		HAL_USBHFTDI_DEFAULT_FRAMING,
 		HAL_USBHFTDI_DEFAULT_HANDSHAKE,
 		HAL_USBHFTDI_DEFAULT_XON,
-		HAL_USBHFTDI_DEFAULT_XOFF
+		HAL_USBHFTDI_DEFAULT_XOFF,
+		HAL_USBHFTDI_DEFAULT_LATENCY
 	};
+	uint8_t i;
 
 	osalDbgCheck((ftdipp->state == USBHFTDIP_STATE_ACTIVE)
 			|| (ftdipp->state == USBHFTDIP_STATE_READY));
@@ -663,21 +741,41 @@ void usbhftdipStart(USBHFTDIPortDriver *ftdipp, const USBHFTDIPortConfig *config
 		wValue = (config->xoff_character << 8) | config->xon_character;
 	_ftdi_port_control(ftdipp, FTDI_COMMAND_SETFLOW, wValue, config->handshake, 0, NULL);
 
-	usbhURBObjectInit(&ftdipp->oq_urb, &ftdipp->epout, _out_cb, ftdipp, ftdipp->oq_buff, 0);
+	/* whole packets, ports with bigger packets are refused at load time */
+	const uint32_t in_len = HAL_USBHFTDI_BUFFER_SIZE
+			- (HAL_USBHFTDI_BUFFER_SIZE % ftdipp->epin.wMaxPacketSize);
+
+	const uint8_t latency = config->latency ? config->latency : HAL_USBHFTDI_DEFAULT_LATENCY;
+	_ftdi_port_control(ftdipp, FTDI_COMMAND_SETLATENCYTIMER, latency, 0, 0, NULL);
+	ftdipp->latency = OSAL_MS2I(latency);
+
+	for (i = 0; i < HAL_USBHFTDI_OUT_URBS; i++) {
+		usbhURBObjectInit(&ftdipp->oq_urb[i], &ftdipp->epout, _out_cb, ftdipp, ftdipp->oq_buff[i], 0);
+	}
 	chThdQueueObjectInit(&ftdipp->oq_waiting);
-	ftdipp->oq_counter = 64;
-	ftdipp->oq_ptr = ftdipp->oq_buff;
+	ftdipp->oq_head = 0;
+	ftdipp->oq_writing = FALSE;
+	ftdipp->oq_counter = HAL_USBHFTDI_BUFFER_SIZE;
+	ftdipp->oq_ptr = ftdipp->oq_buff[0];
 	usbhEPOpen(&ftdipp->epout);
 
-	usbhURBObjectInit(&ftdipp->iq_urb, &ftdipp->epin, _in_cb, ftdipp, ftdipp->iq_buff, 64);
+	for (i = 0; i < HAL_USBHFTDI_IN_URBS; i++) {
+		usbhURBObjectInit(&ftdipp->iq_urb[i], &ftdipp->epin, _in_cb, ftdipp, ftdipp->iq_buff[i], in_len);
+	}
 	chThdQueueObjectInit(&ftdipp->iq_waiting);
+	ftdipp->iq_head = 0;
 	ftdipp->iq_counter = 0;
-	ftdipp->iq_ptr = ftdipp->iq_buff;
+	ftdipp->iq_ptr = ftdipp->iq_buff[0];
 	usbhEPOpen(&ftdipp->epin);
-	usbhURBSubmit(&ftdipp->iq_urb);
+	osalSysLock();
+	for (i = 0; i < HAL_USBHFTDI_IN_URBS; i++) {
+		usbhURBSubmitI(&ftdipp->iq_urb[i]);
+	}
+	osalOsRescheduleS();
+	osalSysUnlock();
 
 	chVTObjectInit(&ftdipp->vt);
-	chVTSet(&ftdipp->vt, OSAL_MS2I(16), _vt, ftdipp);
+	chVTSet(&ftdipp->vt, ftdipp->latency, _vt, ftdipp);
 
 	ftdipp->state = USBHFTDIP_STATE_READY;
 	osalMutexUnlock(&ftdipp->ftdip->mtx);
@@ -48,9 +48,13 @@
 USBHHIDDriver USBHHIDD[HAL_USBHHID_MAX_INSTANCES];
 
 static void _hid_init(void);
-static usbh_baseclassdriver_t *_hid_load(usbh_device_t *dev, const uint8_t *descriptor, uint16_t rem);
+static usbh_baseclassdriver_t *_hid_load(usbh_device_t *dev, const uint8_t *descriptor, uint16_t rem,
+		const usbh_classdriver_match_t *match);
 static void _hid_unload(usbh_baseclassdriver_t *drv);
 static void _stop_locked(USBHHIDDriver *hidp);
+#if HAL_USBHHID_USE_REPORT_PARSER
+static void _load_report_descriptor(USBHHIDDriver *hidp, const uint8_t *descriptor, uint16_t rem);
+#endif
 
 static const usbh_classdriver_vmt_t class_driver_vmt = {
 	_hid_init,
@@ -58,17 +62,20 @@ static const usbh_classdriver_vmt_t class_driver_vmt = {
 	_hid_unload
 };
 
+static const usbh_classdriver_id_t class_driver_ids[] = {
+	{ USBH_MATCH_CLASS, USBH_DT_INTERFACE, 0, 0, 0x03, 0, 0 },
+};
+
 const usbh_classdriverinfo_t usbhhidClassDriverInfo = {
-	"HID", &class_driver_vmt
+	"HID", &class_driver_vmt, class_driver_ids, sizeof_array(class_driver_ids)
 };
 
-static usbh_baseclassdriver_t *_hid_load(usbh_device_t *dev, const uint8_t *descriptor, uint16_t rem) {
+static usbh_baseclassdriver_t *_hid_load(usbh_device_t *dev, const uint8_t *descriptor, uint16_t rem,
+		const usbh_classdriver_match_t *match) {
 	int i;
 	USBHHIDDriver *hidp;
 
-	if (_usbh_match_descriptor(descriptor, rem, USBH_DT_INTERFACE,
-			0x03, -1, -1) != HAL_SUCCESS)
-		return NULL;
+	(void)match;
 
 	const usbh_interface_descriptor_t * const ifdesc = (const usbh_interface_descriptor_t *)descriptor;
 
@@ -147,6 +154,13 @@ alloc_ok:
 		goto deinit;
 	}
 
+#if HAL_USBHHID_USE_REPORT_PARSER
+	hidp->dev = dev;
+	_load_report_descriptor(hidp, descriptor, rem);
+	/* the core links the driver to the device only if dev is NULL */
+	hidp->dev = NULL;
+#endif
+
 	hidp->state = USBHHID_STATE_ACTIVE;
 
 	return (usbh_baseclassdriver_t *)hidp;
@@ -164,13 +178,116 @@ static void _hid_unload(usbh_baseclassdriver_t *drv) {
 	chSemSignal(&hidp->sem);
 }
 
+#if HAL_USBHHID_USE_REPORT_QUEUE
+static void _rq_putI(USBHHIDDriver *hidp, const uint8_t *report, uint16_t len) {
+	if (hidp->rq_count == HAL_USBHHID_REPORT_QUEUE_SIZE) {
+		hidp->rq_overruns++;
+		return;
+	}
+
+	uint8_t tail = hidp->rq_head + hidp->rq_count;
+	if (tail >= HAL_USBHHID_REPORT_QUEUE_SIZE)
+		tail -= HAL_USBHHID_REPORT_QUEUE_SIZE;
+	memcpy(hidp->rq_buff[tail], report, len);
+	hidp->rq_len[tail] = len;
+	hidp->rq_count++;
+	chThdDequeueNextI(&hidp->rq_waiting, MSG_OK);
+}
+
+uint16_t usbhhidReadReport(USBHHIDDriver *hidp, void *buff, uint16_t size, systime_t timeout) {
+	osalDbgCheck(hidp && buff);
+
+	osalSysLock();
+	while (hidp->rq_count == 0) {
+		if ((hidp->state != USBHHID_STATE_READY)
+				|| (chThdEnqueueTimeoutS(&hidp->rq_waiting, timeout) != MSG_OK)) {
+			osalSysUnlock();
+			return 0;
+		}
+	}
+	/* the head slot isn't written by the callback until released */
+	const uint8_t head = hidp->rq_head;
+	osalSysUnlock();
+
+	uint16_t len = hidp->rq_len[head];
+	if (len > size)
+		len = size;
+	memcpy(buff, hidp->rq_buff[head], len);
+
+	osalSysLock();
+	if (++hidp->rq_head == HAL_USBHHID_REPORT_QUEUE_SIZE)
+		hidp->rq_head = 0;
+	hidp->rq_count--;
+	osalSysUnlock();
+	return len;
+}
+
+#if HAL_USBHHID_USE_INTERRUPT_OUT
+static void _oq_submitI(USBHHIDDriver *hidp) {
+	/* held while usbhhidSetReport sends an output report */
+	if ((hidp->oq_count == 0) || hidp->oq_sync || usbhURBIsBusy(&hidp->out_urb))
+		return;
+	hidp->out_urb.buff = hidp->oq_buff[hidp->oq_head];
+	hidp->out_urb.requestedLength = hidp->oq_len[hidp->oq_head];
+	usbhURBObjectResetI(&hidp->out_urb);
+	usbhURBSubmitI(&hidp->out_urb);
+}
+
+static void _out_cb(usbh_urb_t *urb) {
+	USBHHIDDriver *const hidp = (USBHHIDDriver *)urb->userData;
+	switch (urb->status) {
+	case USBH_URBSTATUS_OK:
+		break;
+	case USBH_URBSTATUS_DISCONNECTED:
+		uurbwarn("HID: URB OUT disconnected");
+		return;
+	default:
+		uurberrf("HID: URB OUT status unexpected = %d", urb->status);
+		hidp->oq_errors++;
+		break;
+	}
+	if (++hidp->oq_head == HAL_USBHHID_OUT_QUEUE_SIZE)
+		hidp->oq_head = 0;
+	if (--hidp->oq_count == 0)
+		chThdDequeueAllI(&hidp->oq_waiting, MSG_OK);
+	_oq_submitI(hidp);
+}
+
+bool usbhhidQueueOutputReport(USBHHIDDriver *hidp, const void *data, uint16_t len) {
+	osalDbgCheck(hidp && data && (len <= HAL_USBHHID_MAX_REPORT_SIZE));
+
+	osalSysLock();
+	if ((hidp->state != USBHHID_STATE_READY)
+			|| (hidp->epout.status == USBH_EPSTATUS_UNINITIALIZED)
+			|| (hidp->oq_count == HAL_USBHHID_OUT_QUEUE_SIZE)) {
+		osalSysUnlock();
+		return HAL_FAILED;
+	}
+	uint8_t tail = hidp->oq_head + hidp->oq_count;
+	if (tail >= HAL_USBHHID_OUT_QUEUE_SIZE)
+		tail -= HAL_USBHHID_OUT_QUEUE_SIZE;
+	memcpy(hidp->oq_buff[tail], data, len);
+	hidp->oq_len[tail] = len;
+	hidp->oq_count++;
+	_oq_submitI(hidp);
+	osalOsRescheduleS();
+	osalSysUnlock();
+	return HAL_SUCCESS;
+}
+#endif
+#endif
+
 static void _in_cb(usbh_urb_t *urb) {
 	USBHHIDDriver *const hidp = (USBHHIDDriver *)urb->userData;
 	switch (urb->status) {
 	case USBH_URBSTATUS_OK:
+#if HAL_USBHHID_USE_REPORT_QUEUE
+		_rq_putI(hidp, (const uint8_t *)urb->buff, urb->actualLength);
+#else
 		if (hidp->config->cb_report) {
 			hidp->config->cb_report(hidp, urb->actualLength);
 		}
+#endif
 		break;
 	case USBH_URBSTATUS_DISCONNECTED:
 		uurbwarn("HID: URB IN disconnected");
@@ -183,18 +300,22 @@ static void _in_cb(usbh_urb_t *urb) {
 		uurberrf("HID: URB IN status unexpected = %d", urb->status);
 		break;
 	}
-	usbhURBObjectResetI(&hidp->in_urb);
-	usbhURBSubmitI(&hidp->in_urb);
+	usbhURBObjectResetI(urb);
+	usbhURBSubmitI(urb);
 }
 
-void usbhhidStart(USBHHIDDriver *hidp, const USBHHIDConfig *cfg) {
+bool usbhhidStart(USBHHIDDriver *hidp, const USBHHIDConfig *cfg) {
 	osalDbgCheck(hidp && cfg);
+#if HAL_USBHHID_USE_REPORT_QUEUE
+	osalDbgCheck(cfg->protocol <= USBHHID_PROTOCOL_REPORT);
+#else
 	osalDbgCheck(cfg->report_buffer && (cfg->protocol <= USBHHID_PROTOCOL_REPORT));
+#endif
 
 	chSemWait(&hidp->sem);
 	if (hidp->state == USBHHID_STATE_READY) {
 		chSemSignal(&hidp->sem);
-		return;
+		return HAL_SUCCESS;
 	}
 	osalDbgCheck(hidp->state == USBHHID_STATE_ACTIVE);
 
@@ -202,25 +323,61 @@ void usbhhidStart(USBHHIDDriver *hidp, const USBHHIDConfig *cfg) {
 
 	/* init the URBs */
 	uint32_t report_len = hidp->epin.wMaxPacketSize;
+#if HAL_USBHHID_USE_REPORT_QUEUE
+	if (report_len > HAL_USBHHID_MAX_REPORT_SIZE) {
+		uclassdrvwarnf("HID: wMaxPacketSize=%d > HAL_USBHHID_MAX_REPORT_SIZE", report_len);
+		report_len = HAL_USBHHID_MAX_REPORT_SIZE;
+	}
+	usbhURBObjectInit(&hidp->in_urb, &hidp->epin, _in_cb, hidp,
+			hidp->in_buff[0], report_len);
+	usbhURBObjectInit(&hidp->in_urb2, &hidp->epin, _in_cb, hidp,
+			hidp->in_buff[1], report_len);
+	hidp->rq_head = 0;
+	hidp->rq_count = 0;
+	hidp->rq_overruns = 0;
+#if HAL_USBHHID_USE_INTERRUPT_OUT
+	usbhURBObjectInit(&hidp->out_urb, &hidp->epout, _out_cb, hidp, NULL, 0);
+	hidp->oq_head = 0;
+	hidp->oq_count = 0;
+	hidp->oq_errors = 0;
+	hidp->oq_sync = 0;
+#endif
+#else
 	if (report_len > cfg->report_len)
 		report_len = cfg->report_len;
 	usbhURBObjectInit(&hidp->in_urb, &hidp->epin, _in_cb, hidp,
 			cfg->report_buffer, report_len);
+#endif
 
 	/* open the int IN/OUT endpoints */
-	usbhEPOpen(&hidp->epin);
+	if (usbhEPOpen(&hidp->epin) != HAL_SUCCESS) {
+		uclassdrverr("HID: no periodic bandwidth for the IN endpoint");
+		chSemSignal(&hidp->sem);
+		return HAL_FAILED;
+	}
 #if HAL_USBHHID_USE_INTERRUPT_OUT
-	if (hidp->epout.status == USBH_EPSTATUS_CLOSED) {
-		usbhEPOpen(&hidp->epout);
+	if ((hidp->epout.status == USBH_EPSTATUS_CLOSED)
+			&& (usbhEPOpen(&hidp->epout) != HAL_SUCCESS)) {
+		uclassdrverr("HID: no periodic bandwidth for the OUT endpoint");
+		usbhEPClose(&hidp->epin);
+		chSemSignal(&hidp->sem);
+		return HAL_FAILED;
 	}
 #endif
 
 	usbhhidSetProtocol(hidp, cfg->protocol);
 
-	usbhURBSubmit(&hidp->in_urb);
-
+	osalSysLock();
+	usbhURBSubmitI(&hidp->in_urb);
+#if HAL_USBHHID_USE_REPORT_QUEUE
+	/* the second URB is armed while the first one is being processed */
+	usbhURBSubmitI(&hidp->in_urb2);
+#endif
 	hidp->state = USBHHID_STATE_READY;
+	osalOsRescheduleS();
+	osalSysUnlock();
 	chSemSignal(&hidp->sem);
+	return HAL_SUCCESS;
 }
 
 static void _stop_locked(USBHHIDDriver *hidp) {
@@ -235,7 +392,16 @@ static void _stop_locked(USBHHIDDriver *hidp) {
 		usbhEPClose(&hidp->epout);
 	}
 #endif
+	osalSysLock();
 	hidp->state = USBHHID_STATE_ACTIVE;
+#if HAL_USBHHID_USE_REPORT_QUEUE
+	chThdDequeueAllI(&hidp->rq_waiting, MSG_RESET);
+#if HAL_USBHHID_USE_INTERRUPT_OUT
+	chThdDequeueAllI(&hidp->oq_waiting, MSG_RESET);
+#endif
+	osalOsRescheduleS();
+#endif
+	osalSysUnlock();
 }
 
 void usbhhidStop(USBHHIDDriver *hidp) {
@@ -259,9 +425,38 @@ usbh_urbstatus_t usbhhidSetReport(USBHHIDDriver *hidp,
 		const void *data, uint16_t len) {
 	osalDbgCheck(hidp);
 	osalDbgAssert((uint8_t)report_type <= USBHHID_REPORTTYPE_FEATURE, "wrong report type");
+#if HAL_USBHHID_USE_REPORT_QUEUE && HAL_USBHHID_USE_INTERRUPT_OUT
+	usbh_urbstatus_t ret;
+	const bool out = (report_type == USBHHID_REPORTTYPE_OUTPUT);
+
+	if (out) {
+		/* keep the output reports in order: send the queued ones first and
+		 * hold the ones queued while the control transfer is running */
+		osalSysLock();
+		while ((hidp->state == USBHHID_STATE_READY) && hidp->oq_count) {
+			if (chThdEnqueueTimeoutS(&hidp->oq_waiting, TIME_INFINITE) != MSG_OK)
+				break;
+		}
+		hidp->oq_sync++;
+		osalSysUnlock();
+	}
+	ret = usbhControlRequest(hidp->dev,
+			USBH_REQTYPE_CLASSOUT(USBH_REQTYPE_RECIP_INTERFACE), USBH_HID_REQ_SET_REPORT,
+			((uint8_t)report_type << 8) | report_id, hidp->ifnum, len, (void *)data);
+	if (out) {
+		osalSysLock();
+		hidp->oq_sync--;
+		if (hidp->state == USBHHID_STATE_READY)
+			_oq_submitI(hidp);
+		osalOsRescheduleS();
+		osalSysUnlock();
+	}
+	return ret;
+#else
 	return usbhControlRequest(hidp->dev,
 			USBH_REQTYPE_CLASSOUT(USBH_REQTYPE_RECIP_INTERFACE), USBH_HID_REQ_SET_REPORT,
 			((uint8_t)report_type << 8) | report_id, hidp->ifnum, len, (void *)data);
+#endif
 }
 
 usbh_urbstatus_t usbhhidGetIdle(USBHHIDDriver *hidp, uint8_t report_id, uint8_t *duration) {
@@ -293,12 +488,459 @@ usbh_urbstatus_t usbhhidSetProtocol(USBHHIDDriver *hidp, uint8_t protocol) {
 			protocol, hidp->ifnum, 0, NULL);
 }
 
+#if HAL_USBHHID_USE_REPORT_PARSER
+/*===========================================================================*/
+/* Report descriptor parser.                                                 */
+/*===========================================================================*/
+
+#define USBH_HID_DT_HID					0x21
+#define USBH_HID_DT_REPORT				0x22
+
+#define _ITEM_TYPE_MAIN					0
+#define _ITEM_TYPE_GLOBAL				1
+#define _ITEM_TYPE_LOCAL				2
+#define _ITEM_LONG						0xfe
+
+#define _MAIN_INPUT						0x8
+#define _MAIN_OUTPUT					0x9
+#define _MAIN_COLLECTION				0xa
+#define _MAIN_FEATURE					0xb
+#define _MAIN_END_COLLECTION			0xc
+
+#define _GLOBAL_USAGE_PAGE				0x0
+#define _GLOBAL_LOGICAL_MIN				0x1
+#define _GLOBAL_LOGICAL_MAX				0x2
+#define _GLOBAL_REPORT_SIZE				0x7
+#define _GLOBAL_REPORT_ID				0x8
+#define _GLOBAL_REPORT_COUNT			0x9
+#define _GLOBAL_PUSH					0xa
+#define _GLOBAL_POP						0xb
+
+#define _LOCAL_USAGE					0x0
+#define _LOCAL_USAGE_MIN				0x1
+#define _LOCAL_USAGE_MAX				0x2
+
+#define _PARSER_MAX_USAGES				16
+#define _PARSER_MAX_REPORTS				16
+#define _PARSER_STACK_DEPTH				2
+
+/* protects the report descriptor buffer */
+static mutex_t report_desc_mtx;
+
+typedef struct {
+	uint16_t usage_page;
+	int32_t logical_min;
+	int32_t logical_max;
+	uint8_t report_size;
+	uint8_t report_id;
+	uint16_t report_count;
+} _globals_t;
+
+typedef struct {
+	_globals_t g;
+	_globals_t stack[_PARSER_STACK_DEPTH];
+	uint8_t sp;
+
+	/* usages are kept as page << 16 | usage; page 0 means "current page" */
+	uint32_t usages[_PARSER_MAX_USAGES];
+	uint8_t usages_count;
+	uint32_t usage_min;
+	uint32_t usage_max;
+	bool has_min;
+	bool has_max;
+
+	/* current bit position of each report */
+	struct {
+		uint8_t id;
+		uint8_t type;
+		uint16_t bits;
+	} reports[_PARSER_MAX_REPORTS];
+	uint8_t reports_count;
+} _parser_t;
+
+static uint16_t *_report_bits(_parser_t *p, uint8_t type) {
+	uint8_t i;
+	for (i = 0; i < p->reports_count; i++) {
+		if ((p->reports[i].id == p->g.report_id) && (p->reports[i].type == type))
+			return &p->reports[i].bits;
+	}
+	if (p->reports_count == _PARSER_MAX_REPORTS)
+		return NULL;
+	p->reports[i].id = p->g.report_id;
+	p->reports[i].type = type;
+	p->reports[i].bits = 0;
+	p->reports_count++;
+	return &p->reports[i].bits;
+}
+
+static uint32_t _usage(const _parser_t *p, uint16_t i) {
+	uint32_t usage;
+	if (p->has_min && p->has_max) {
+		usage = p->usage_min + i;
+		if (usage > p->usage_max)
+			usage = p->usage_max;
+	} else if (p->usages_count) {
+		usage = p->usages[(i < p->usages_count) ? i : p->usages_count - 1];
+	} else {
+		usage = p->has_min ? p->usage_min : 0;
+	}
+	if ((usage >> 16) == 0)
+		usage |= (uint32_t)p->g.usage_page << 16;
+	return usage;
+}
+
+static bool _add_field(USBHHIDDriver *hidp, const _parser_t *p, uint8_t type,
+		uint8_t flags, uint32_t usage, uint32_t usage_max, uint32_t bit_offset,
+		uint16_t count) {
+	if (hidp->fields_count == HAL_USBHHID_MAX_FIELDS) {
+		uclassdrvwarn("HID: field table full, increase HAL_USBHHID_MAX_FIELDS");
+		return HAL_FAILED;
+	}
+	if (p->g.report_id)
+		bit_offset += 8;
+	if ((bit_offset > 0xffff) || (count > 0xff))
+		return HAL_FAILED;
+	if (((usage_max >> 16) != (usage >> 16)) || ((uint16_t)usage_max < (uint16_t)usage))
+		usage_max = usage;
+
+	usbhhid_field_t *const f = &hidp->fields[hidp->fields_count++];
+	f->usage_page = (uint16_t)(usage >> 16);
+	f->usage = (uint16_t)usage;
+	f->usage_max = (uint16_t)usage_max;
+	f->bit_offset = (uint16_t)bit_offset;
+	f->bit_size = p->g.report_size;
+	f->count = (uint8_t)count;
+	f->report_id = p->g.report_id;
+	f->type = type;
+	f->flags = flags;
+	f->logical_min = p->g.logical_min;
+	f->logical_max = p->g.logical_max;
+	return HAL_SUCCESS;
+}
+
+static bool _main_item(USBHHIDDriver *hidp, _parser_t *p, uint8_t type, uint8_t flags) {
+	uint16_t *const bits = _report_bits(p, type);
+	uint16_t i, first;
+	uint32_t usage = 0, last;
+
+	if (bits == NULL) {
+		uclassdrvwarn("HID: too many reports");
+		return HAL_FAILED;
+	}
+
+	if (!(flags & USBHHID_FIELD_CONSTANT)
+			&& (p->g.report_size > 0) && (p->g.report_size <= 32)) {
+		if (flags & USBHHID_FIELD_VARIABLE) {
+			/* runs of consecutive usages, the last one may repeat */
+			first = 0;
+			last = _usage(p, 0);
+			for (i = 1; i <= p->g.report_count; i++) {
+				if (i < p->g.report_count) {
+					usage = _usage(p, i);
+					if ((i - first < 0xff) && ((usage == last)
+							|| ((usage == last + 1) && ((uint16_t)usage != 0)
+								&& (last - _usage(p, first) == (uint32_t)(i - 1 - first))))) {
+						last = usage;
+						continue;
+					}
+				}
+				if (_add_field(hidp, p, type, flags, _usage(p, first), last,
+						*bits + first * p->g.report_size, i - first) != HAL_SUCCESS)
+					return HAL_FAILED;
+				first = i;
+				if (i < p->g.report_count)
+					last = usage;
+			}
+		} else {
+			/* array: the values are indexes into the usages */
+			if (_add_field(hidp, p, type, flags, _usage(p, 0), _usage(p, 0xffff),
+					*bits, p->g.report_count) != HAL_SUCCESS)
+				return HAL_FAILED;
+		}
+	}
+
+	*bits += p->g.report_size * p->g.report_count;
+	return HAL_SUCCESS;
+}
+
+bool usbhhidParseReportDescriptor(USBHHIDDriver *hidp, const uint8_t *desc, uint16_t len) {
+	_parser_t p;
+	osalDbgCheck(hidp && desc);
+
+	memset(&p, 0, sizeof(p));
+	hidp->fields_count = 0;
+
+	while (len) {
+		const uint8_t prefix = *desc++;
+		len--;
+
+		if (prefix == _ITEM_LONG) {
+			if ((len < 2) || (len < desc[0] + 2))
+				goto malformed;
+			len -= desc[0] + 2;
+			desc += desc[0] + 2;
+			continue;
+		}
+
+		const uint8_t size = ((prefix & 3) == 3) ? 4 : (prefix & 3);
+		const uint8_t type = (prefix >> 2) & 3;
+		const uint8_t tag = prefix >> 4;
+		uint32_t data = 0;
+		int32_t sdata = 0;
+
+		if (len < size)
+			goto malformed;
+		switch (size) {
+		case 1: data = desc[0]; sdata = (int8_t)desc[0]; break;
+		case 2: data = desc[0] | (desc[1] << 8); sdata = (int16_t)data; break;
+		case 4: data = desc[0] | (desc[1] << 8) | (desc[2] << 16) | ((uint32_t)desc[3] << 24);
+				sdata = (int32_t)data; break;
+		default: break;
+		}
+		desc += size;
+		len -= size;
+
+		switch (type) {
+		case _ITEM_TYPE_MAIN:
+			switch (tag) {
+			case _MAIN_INPUT:
+				if (_main_item(hidp, &p, USBHHID_REPORTTYPE_INPUT, (uint8_t)data) != HAL_SUCCESS)
+					goto failed;
+				break;
+			case _MAIN_OUTPUT:
+				if (_main_item(hidp, &p, USBHHID_REPORTTYPE_OUTPUT, (uint8_t)data) != HAL_SUCCESS)
+					goto failed;
+				break;
+			case _MAIN_FEATURE:
+				if (_main_item(hidp, &p, USBHHID_REPORTTYPE_FEATURE, (uint8_t)data) != HAL_SUCCESS)
+					goto failed;
+				break;
+			default:
+				break;
+			}
+			/* local items only apply to the next main item */
+			p.usages_count = 0;
+			p.has_min = p.has_max = FALSE;
+			break;
+
+		case _ITEM_TYPE_GLOBAL:
+			switch (tag) {
+			case _GLOBAL_USAGE_PAGE:
+				p.g.usage_page = (uint16_t)data;
+				break;
+			case _GLOBAL_LOGICAL_MIN:
+				p.g.logical_min = sdata;
+				break;
+			case _GLOBAL_LOGICAL_MAX:
+				/* many devices declare e.g. 0..255 in one byte */
+				p.g.logical_max = ((p.g.logical_min >= 0) && (sdata < 0)) ? (int32_t)data : sdata;
+				break;
+			case _GLOBAL_REPORT_SIZE:
+				p.g.report_size = (uint8_t)data;
+				break;
+			case _GLOBAL_REPORT_ID:
+				p.g.report_id = (uint8_t)data;
+				break;
+			case _GLOBAL_REPORT_COUNT:
+				p.g.report_count = (uint16_t)data;
+				break;
+			case _GLOBAL_PUSH:
+				if (p.sp == _PARSER_STACK_DEPTH)
+					goto malformed;
+				p.stack[p.sp++] = p.g;
+				break;
+			case _GLOBAL_POP:
+				if (p.sp == 0)
+					goto malformed;
+				p.g = p.stack[--p.sp];
+				break;
+			default:
+				break;
+			}
+			break;
+
+		case _ITEM_TYPE_LOCAL:
+			switch (tag) {
+			case _LOCAL_USAGE:
+				if (p.usages_count < _PARSER_MAX_USAGES)
+					p.usages[p.usages_count++] = data;
+				break;
+			case _LOCAL_USAGE_MIN:
+				p.usage_min = data;
+				p.has_min = TRUE;
+				break;
+			case _LOCAL_USAGE_MAX:
+				p.usage_max = data;
+				p.has_max = TRUE;
+				break;
+			default:
+				break;
+			}
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	uclassdrvinfof("HID: report descriptor parsed, %d fields", hidp->fields_count);
+	return HAL_SUCCESS;
+
+malformed:
+	uclassdrvwarn("HID: malformed report descriptor");
+failed:
+	hidp->fields_count = 0;
+	return HAL_FAILED;
+}
+
+static void _load_report_descriptor(USBHHIDDriver *hidp, const uint8_t *descriptor, uint16_t rem) {
+	static USBH_DEFINE_BUFFER(uint8_t buff[HAL_USBHHID_REPORT_DESC_MAX_SIZE]);
+	generic_iterator_t ics;
+	generic_iterator_t iif;
+
+	hidp->report_desc_len = 0;
+	hidp->fields_count = 0;
+
+	/* find the report descriptor length in the HID descriptor */
+	iif.curr = descriptor;
+	iif.rem = rem;
+	for (cs_iter_init(&ics, &iif); ics.valid; cs_iter_next(&ics)) {
+		if ((ics.curr[1] != USBH_HID_DT_HID) || (ics.curr[0] < 9))
+			continue;
+		uint8_t i;
+		for (i = 0; (i < ics.curr[5]) && (6 + 3 * i + 2 < ics.curr[0]); i++) {
+			const uint8_t *const d = &ics.curr[6 + 3 * i];
+			if (d[0] == USBH_HID_DT_REPORT) {
+				hidp->report_desc_len = d[1] | (d[2] << 8);
+				break;
+			}
+		}
+		break;
+	}
+
+	if (hidp->report_desc_len == 0) {
+		uclassdrvwarn("HID: no report descriptor");
+		return;
+	}
+	if (hidp->report_desc_len > HAL_USBHHID_REPORT_DESC_MAX_SIZE) {
+		uclassdrvwarnf("HID: report descriptor too large (%d bytes)", hidp->report_desc_len);
+		return;
+	}
+
+	osalMutexLock(&report_desc_mtx);
+	if (usbhControlRequest(hidp->dev,
+			USBH_REQTYPE_STANDARDIN(USBH_REQTYPE_RECIP_INTERFACE), USBH_REQ_GET_DESCRIPTOR,
+			USBH_HID_DT_REPORT << 8, hidp->ifnum, hidp->report_desc_len, buff) == USBH_URBSTATUS_OK) {
+		usbhhidParseReportDescriptor(hidp, buff, hidp->report_desc_len);
+	} else {
+		uclassdrvwarn("HID: couldn't read the report descriptor");
+	}
+	osalMutexUnlock(&report_desc_mtx);
+}
+
+/*===========================================================================*/
+/* Field extraction.                                                         */
+/*===========================================================================*/
+
+static uint32_t _get_bits(const uint8_t *buff, uint32_t bit, uint8_t size) {
+	const uint8_t *const p = &buff[bit >> 3];
+	const uint8_t shift = bit & 7;
+	const uint8_t bytes = (shift + size + 7) >> 3;
+	uint64_t v = 0;
+	uint8_t i;
+
+	for (i = 0; i < bytes; i++)
+		v |= (uint64_t)p[i] << (i * 8);
+	v >>= shift;
+	if (size < 32)
+		v &= (1UL << size) - 1;
+	return (uint32_t)v;
+}
+
+/* Returns the field holding the usage and, for variables, the index of its
+ * value; arrays match any of their usages, with index 0 */
+const usbhhid_field_t *usbhhidFindField(USBHHIDDriver *hidp, usbhhid_reporttype_t type,
+		uint16_t usage_page, uint16_t usage, uint8_t *index) {
+	uint16_t i;
+	osalDbgCheck(hidp);
+
+	for (i = 0; i < hidp->fields_count; i++) {
+		const usbhhid_field_t *const f = &hidp->fields[i];
+		if ((f->type == type) && (f->usage_page == usage_page)
+				&& (usage >= f->usage) && (usage <= f->usage_max)) {
+			if (index)
+				*index = (f->flags & USBHHID_FIELD_VARIABLE) ? (uint8_t)(usage - f->usage) : 0;
+			return f;
+		}
+	}
+	return NULL;
+}
+
+bool usbhhidGetField(const usbhhid_field_t *field, const uint8_t *report, uint16_t len,
+		uint8_t index, int32_t *value) {
+	osalDbgCheck(field && report && value);
+
+	if (index >= field->count)
+		return HAL_FAILED;
+	if (field->report_id && ((len == 0) || (report[0] != field->report_id)))
+		return HAL_FAILED;
+
+	const uint32_t bit = field->bit_offset + (uint32_t)index * field->bit_size;
+	if (bit + field->bit_size > (uint32_t)len * 8)
+		return HAL_FAILED;
+
+	uint32_t raw = _get_bits(report, bit, field->bit_size);
+	if ((field->logical_min < 0) && (field->bit_size < 32)
+			&& (raw & (1UL << (field->bit_size - 1))))
+		raw |= ~0UL << field->bit_size;
+	*value = (int32_t)raw;
+	return HAL_SUCCESS;
+}
+
+/* Extracts the values of the fields of a report, in field table order, into
+ * values[]; *count is the number of values stored, of whole fields only.
+ * Fails if the report has no fields, if a field doesn't fit in len (a
+ * truncated report) or its values don't fit in max. */
+bool usbhhidGetFields(USBHHIDDriver *hidp, usbhhid_reporttype_t type,
+		const uint8_t *report, uint16_t len, int32_t *values, uint16_t max,
+		uint16_t *count) {
+	uint16_t i, n = 0;
+	uint8_t j;
+	bool found = FALSE;
+	osalDbgCheck(hidp && report && values && count);
+
+	*count = 0;
+	for (i = 0; i < hidp->fields_count; i++) {
+		const usbhhid_field_t *const f = &hidp->fields[i];
+		if ((f->type != type)
+				|| (f->report_id && ((len == 0) || (report[0] != f->report_id))))
+			continue;
+		found = TRUE;
+		if (f->count > max - n)
+			return HAL_FAILED;
+		for (j = 0; j < f->count; j++) {
+			if (usbhhidGetField(f, report, len, j, &values[n + j]) != HAL_SUCCESS)
+				return HAL_FAILED;
+		}
+		n += f->count;
+		*count = n;
+	}
+	return found ? HAL_SUCCESS : HAL_FAILED;
+}
+#endif
+
 static void _hid_object_init(USBHHIDDriver *hidp) {
 	osalDbgCheck(hidp != NULL);
 	memset(hidp, 0, sizeof(*hidp));
 	hidp->info = &usbhhidClassDriverInfo;
 	hidp->state = USBHHID_STATE_STOP;
 	chSemObjectInit(&hidp->sem, 1);
+#if HAL_USBHHID_USE_REPORT_QUEUE
+	chThdQueueObjectInit(&hidp->rq_waiting);
+#if HAL_USBHHID_USE_INTERRUPT_OUT
+	chThdQueueObjectInit(&hidp->oq_waiting);
+#endif
+#endif
 }
 
 static void _hid_init(void) {
@@ -306,6 +948,9 @@ static void _hid_init(void) {
 	for (i = 0; i < HAL_USBHHID_MAX_INSTANCES; i++) {
 		_hid_object_init(&USBHHIDD[i]);
 	}
+#if HAL_USBHHID_USE_REPORT_PARSER
+	osalMutexObjectInit(&report_desc_mtx);
+#endif
 }
 
 #endif
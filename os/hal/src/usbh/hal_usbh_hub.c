@@ -38,7 +38,8 @@ USBHHubDriver USBHHUBD[HAL_USBHHUB_MAX_INSTANCES];
 static usbh_port_t USBHPorts[HAL_USBHHUB_MAX_PORTS];
 
 static void _hub_init(void);
-static usbh_baseclassdriver_t *_hub_load(usbh_device_t *dev, const uint8_t *descriptor, uint16_t rem);
+static usbh_baseclassdriver_t *_hub_load(usbh_device_t *dev, const uint8_t *descriptor, uint16_t rem,
+		const usbh_classdriver_match_t *match);
 static void _hub_unload(usbh_baseclassdriver_t *drv);
 static const usbh_classdriver_vmt_t usbhhubClassDriverVMT = {
 	_hub_init,
@@ -46,8 +47,12 @@ static const usbh_classdriver_vmt_t usbhhubClassDriverVMT = {
 	_hub_unload
 };
 
+static const usbh_classdriver_id_t class_driver_ids[] = {
+	USBH_CLASSDRIVER_ID_CLASS(USBH_DT_DEVICE, 0x09, 0x00, 0x00),
+};
+
 const usbh_classdriverinfo_t usbhhubClassDriverInfo = {
-	"HUB", &usbhhubClassDriverVMT
+	"HUB", &usbhhubClassDriverVMT, class_driver_ids, sizeof_array(class_driver_ids)
 };
 
 
@@ -57,6 +62,7 @@ void _usbhub_port_object_init(usbh_port_t *port, USBHDriver *usbh,
 	port->number = number;
 	port->device.host = usbh;
 	port->hub = hub;
+	chVTObjectInit(&port->debounce_vt);
 }
 
 usbh_urbstatus_t usbhhubControlRequest(USBHDriver *host, USBHHubDriver *hub,
@@ -115,14 +121,16 @@ static void _urb_complete(usbh_urb_t *urb) {
 }
 
 static usbh_baseclassdriver_t *_hub_load(usbh_device_t *dev,
-		const uint8_t *descriptor, uint16_t rem) {
+		const uint8_t *descriptor, uint16_t rem,
+		const usbh_classdriver_match_t *match) {
 	int i;
 
 	USBHHubDriver *hubdp;
 
-	if (_usbh_match_descriptor(descriptor, rem, USBH_DT_DEVICE,
-			0x09, 0x00, 0x00) != HAL_SUCCESS)
-		return NULL;
+	/* the hub class is on the device descriptor, the match table checked it */
+	(void)descriptor;
+	(void)rem;
+	(void)match;
 
 	generic_iterator_t iep, icfg;
 	if_iterator_t iif;
@@ -187,6 +195,15 @@ alloc_ok:
 			hubdesc->bPwrOn2PwrGood,
 			hubdesc->bHubContrCurrent);
 
+	/* initialize the status change endpoint */
+	usbhEPObjectInit(&hubdp->epint, dev, epdesc);
+	usbhEPSetName(&hubdp->epint, "HUB[INT ]");
+	if (usbhEPOpen(&hubdp->epint) != HAL_SUCCESS) {
+		udevwarn("No periodic bandwidth for the status change endpoint");
+		hubdp->dev = NULL;
+		return NULL;
+	}
+
 	/* Alloc ports */
 	uint8_t ports = hubdesc->bNbrPorts;
 	for (i = 0; (ports > 0) && (i < HAL_USBHHUB_MAX_PORTS); i++) {
@@ -217,11 +234,7 @@ alloc_ok:
 	if (hubdesc->bPwrOn2PwrGood)
 		osalThreadSleepMilliseconds(2 * hubdesc->bPwrOn2PwrGood);
 
-	/* initialize the status change endpoint and trigger the first transfer */
-	usbhEPObjectInit(&hubdp->epint, dev, epdesc);
-	usbhEPSetName(&hubdp->epint, "HUB[INT ]");
-	usbhEPOpen(&hubdp->epint);
-
+	/* trigger the first transfer */
 	usbhURBObjectInit(&hubdp->urb, &hubdp->epint,
 			_urb_complete, hubdp, hubdp->scbuff,
 			(hubdesc->bNbrPorts + 8) / 8);
@@ -273,6 +286,7 @@ void _usbhub_port_object_init(usbh_port_t *port, USBHDriver *usbh, uint8_t numbe
 	memset(port, 0, sizeof(*port));
 	port->number = number;
 	port->device.host = usbh;
+	chVTObjectInit(&port->debounce_vt);
 }
 #endif
 
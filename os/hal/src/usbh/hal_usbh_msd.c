@@ -56,7 +56,8 @@ struct USBHMassStorageDriver {
 static USBHMassStorageDriver USBHMSD[HAL_USBHMSD_MAX_INSTANCES];
 
 static void _msd_init(void);
-static usbh_baseclassdriver_t *_msd_load(usbh_device_t *dev, const uint8_t *descriptor, uint16_t rem);
+static usbh_baseclassdriver_t *_msd_load(usbh_device_t *dev, const uint8_t *descriptor, uint16_t rem,
+		const usbh_classdriver_match_t *match);
 static void _msd_unload(usbh_baseclassdriver_t *drv);
 
 static const usbh_classdriver_vmt_t class_driver_vmt = {
@@ -65,22 +66,25 @@ static const usbh_classdriver_vmt_t class_driver_vmt = {
 	_msd_unload
 };
 
+static const usbh_classdriver_id_t class_driver_ids[] = {
+	USBH_CLASSDRIVER_ID_CLASS(USBH_DT_INTERFACE, 0x08, 0x06, 0x50),
+};
+
 const usbh_classdriverinfo_t usbhmsdClassDriverInfo = {
-	"MSD", &class_driver_vmt
+	"MSD", &class_driver_vmt, class_driver_ids, sizeof_array(class_driver_ids)
 };
 
 #define MSD_REQ_RESET							0xFF
 #define MSD_GET_MAX_LUN							0xFE
 
-static usbh_baseclassdriver_t *_msd_load(usbh_device_t *dev, const uint8_t *descriptor, uint16_t rem) {
+static usbh_baseclassdriver_t *_msd_load(usbh_device_t *dev, const uint8_t *descriptor, uint16_t rem,
+		const usbh_classdriver_match_t *match) {
 	int i;
 	USBHMassStorageDriver *msdp;
 	uint8_t luns;
 	usbh_urbstatus_t stat;
 
-	if (_usbh_match_descriptor(descriptor, rem, USBH_DT_INTERFACE,
-			0x08, 0x06, 0x50) != HAL_SUCCESS)
-		return NULL;
+	(void)match;
 
 	const usbh_interface_descriptor_t * const ifdesc = (const usbh_interface_descriptor_t *)descriptor;
 
@@ -271,7 +275,8 @@ static msd_bot_result_t _msd_bot_transaction(msd_transaction_t *tran, USBHMassSt
 	USBHMassStorageDriver *const msdp = lunp->msdp;
 
 	uint32_t data_actual_len, actual_len;
-	usbh_urbstatus_t status;
+	usbh_urbstatus_t status, csw_status = USBH_URBSTATUS_UNINITIALIZED;
+	bool csw_done;
 	USBH_DEFINE_BUFFER(msd_csw_t csw);
 
 	tran->cbw->bCBWLUN = (uint8_t)(lunp - &msdp->luns[0]);
@@ -298,13 +303,43 @@ static msd_bot_result_t _msd_bot_transaction(msd_transaction_t *tran, USBHMassSt
 
 	/* data phase */
 	data_actual_len = 0;
+	csw_done = FALSE;
 	if (tran->cbw->dCBWDataTransferLength) {
 		usbh_ep_t *const ep = tran->cbw->bmCBWFlags & MSD_CBWFLAGS_D2H ? &msdp->epin : &msdp->epout;
-		status = usbhBulkTransfer(
-				ep,
-				data,
-				tran->cbw->dCBWDataTransferLength,
-				&data_actual_len, OSAL_MS2I(20000));
+
+		if (ep == &msdp->epin) {
+			/* IN data and status phases are chained, so that the CSW is
+			 * read right after the data without resubmitting; each phase
+			 * keeps its own timeout */
+			usbh_urb_t urbs[2];
+			usbhURBObjectInit(&urbs[0], ep, 0, 0, data, tran->cbw->dCBWDataTransferLength);
+			usbhURBObjectInit(&urbs[1], ep, 0, 0, &csw, sizeof(csw));
+			osalSysLock();
+			usbhURBChainSubmitI(urbs, 2);
+			osalOsRescheduleS();
+			if (usbhURBWaitTimeoutS(&urbs[0], OSAL_MS2I(20000)) == MSG_TIMEOUT) {
+				/* aborts the CSW read too */
+				_usbh_urb_abort_and_waitS(&urbs[0], USBH_URBSTATUS_TIMEOUT);
+			} else if (usbhURBWaitTimeoutS(&urbs[1], OSAL_MS2I(1000)) == MSG_TIMEOUT) {
+				_usbh_urb_abort_and_waitS(&urbs[1], USBH_URBSTATUS_TIMEOUT);
+			}
+			if (usbhURBIsBusy(&urbs[1]))
+				_usbh_urb_abort_and_waitS(&urbs[1], USBH_URBSTATUS_CANCELLED);
+			osalSysUnlock();
+			status = urbs[0].status;
+			data_actual_len = urbs[0].actualLength;
+			if (status == USBH_URBSTATUS_OK) {
+				csw_done = TRUE;
+				actual_len = urbs[1].actualLength;
+				csw_status = urbs[1].status;
+			}
+		} else {
+			status = usbhBulkTransfer(
+					ep,
+					data,
+					tran->cbw->dCBWDataTransferLength,
+					&data_actual_len, OSAL_MS2I(20000));
+		}
 
 		if (status == USBH_URBSTATUS_CANCELLED) {
 			uclassdrverr("\tMSD: Data phase: USBH_URBSTATUS_CANCELLED");
@@ -325,8 +360,12 @@ static msd_bot_result_t _msd_bot_transaction(msd_transaction_t *tran, USBHMassSt
 
 
 	/* status phase */
-	status = usbhBulkTransfer(&msdp->epin, &csw,
-				sizeof(csw), &actual_len, OSAL_MS2I(1000));
+	if (csw_done) {
+		status = csw_status;
+	} else {
+		status = usbhBulkTransfer(&msdp->epin, &csw,
+					sizeof(csw), &actual_len, OSAL_MS2I(1000));
+	}
 
 	if (status == USBH_URBSTATUS_STALL) {
 		uclassdrvwarn("\tMSD: Status phase: USBH_URBSTATUS_STALL, clear halt and retry");
@@ -42,7 +42,8 @@ USBHUVCDriver USBHUVCD[HAL_USBHUVC_MAX_INSTANCES];
 
 static void _uvc_init(void);
 static usbh_baseclassdriver_t *_uvc_load(usbh_device_t *dev,
-		const uint8_t *descriptor, uint16_t rem);
+		const uint8_t *descriptor, uint16_t rem,
+		const usbh_classdriver_match_t *match);
 static void _uvc_unload(usbh_baseclassdriver_t *drv);
 
 static const usbh_classdriver_vmt_t class_driver_vmt = {
@@ -50,8 +51,12 @@ static const usbh_classdriver_vmt_t class_driver_vmt = {
 	_uvc_load,
 	_uvc_unload
 };
+static const usbh_classdriver_id_t class_driver_ids[] = {
+	USBH_CLASSDRIVER_ID_CLASS(USBH_DT_INTERFACE_ASSOCIATION, 0x0e, 0x03, 0x00),
+};
+
 const usbh_classdriverinfo_t usbhuvcClassDriverInfo = {
-	"UVC", &class_driver_vmt
+	"UVC", &class_driver_vmt, class_driver_ids, sizeof_array(class_driver_ids)
 };
 
 static bool _request(USBHUVCDriver *uvcdp,
@@ -95,26 +100,46 @@ bool usbhuvcVSRequest(USBHUVCDriver *uvcdp,
 	return _request(uvcdp, bRequest, 0, control, wLength, data, if_get(&uvcdp->ivs)->bInterfaceNumber);
 }
 
-static bool _set_vs_alternate(USBHUVCDriver *uvcdp, uint16_t min_ep_size) {
-
-	if (min_ep_size == 0) {
-		uclassdrvinfo("Selecting Alternate setting 0");
-		return usbhStdReqSetInterface(uvcdp->dev, if_get(&uvcdp->ivs)->bInterfaceNumber, 0);
-	}
+static bool _set_vs_alternate(USBHUVCDriver *uvcdp, uint32_t min_payload) {
+	const uint8_t ifnum = if_get(&uvcdp->ivs)->bInterfaceNumber;
 
 	if_iterator_t iif = uvcdp->ivs;
 	generic_iterator_t iep;
 	const usbh_endpoint_descriptor_t *ep = NULL;
 	uint8_t alt = 0;
 	uint16_t sz = 0xffff;
+	bool bulk = FALSE;
 
-	uclassdrvinfof("Searching alternate setting with min_ep_size=%d", min_ep_size);
+	if (min_payload == 0) {
+		uclassdrvinfo("Selecting Alternate setting 0");
+		if (usbhStdReqSetInterface(uvcdp->dev, ifnum, 0) != HAL_SUCCESS)
+			return HAL_FAILED;
+
+		/* a bulk VS endpoint, if any, streams on this setting */
+		uvcdp->vs_bulk = FALSE;
+		if (if_get(&iif)->bAlternateSetting != 0)
+			return HAL_SUCCESS;
+		for (ep_iter_init(&iep, &iif); iep.valid; ep_iter_next(&iep)) {
+			const usbh_endpoint_descriptor_t *const epdesc = ep_get(&iep);
+			if (((epdesc->bEndpointAddress & 0x80) == USBH_EPDIR_IN)
+					&& ((epdesc->bmAttributes & 0x03) == USBH_EPTYPE_BULK)) {
+				usbhEPObjectInit(&uvcdp->ep_vs, uvcdp->dev, epdesc);
+				usbhEPSetName(&uvcdp->ep_vs, "UVC[BULK]");
+				uvcdp->vs_bulk = TRUE;
+				break;
+			}
+		}
+		return HAL_SUCCESS;
+	}
+
+	uclassdrvinfof("Searching alternate setting with min_payload=%d", min_payload);
 
 	for (; iif.valid; if_iter_next(&iif)) {
 		const usbh_interface_descriptor_t *const ifdesc = if_get(&iif);
 
 		if ((ifdesc->bInterfaceClass != UVC_CC_VIDEO)
-				|| (ifdesc->bInterfaceSubClass != UVC_SC_VIDEOSTREAMING))
+				|| (ifdesc->bInterfaceSubClass != UVC_SC_VIDEOSTREAMING)
+				|| (ifdesc->bInterfaceNumber != ifnum))
 			continue;
 
 		uclassdrvinfof("\tScanning alternate setting=%d", ifdesc->bAlternateSetting);
@@ -124,33 +149,51 @@ static bool _set_vs_alternate(USBHUVCDriver *uvcdp, uint16_t min_ep_size) {
 
 		for (ep_iter_init(&iep, &iif); iep.valid; ep_iter_next(&iep)) {
 			const usbh_endpoint_descriptor_t *const epdesc = ep_get(&iep);
-			if (((epdesc->bmAttributes & 0x03) == USBH_EPTYPE_ISO)
-					&& ((epdesc->bEndpointAddress & 0x80) ==  USBH_EPDIR_IN)) {
+			if ((epdesc->bEndpointAddress & 0x80) != USBH_EPDIR_IN)
+				continue;
+
+			if ((epdesc->bmAttributes & 0x03) == USBH_EPTYPE_BULK) {
+				/* bulk streaming is done on the alternate setting 0 */
+				uclassdrvinfof("\t  Bulk endpoint wMaxPacketSize = %d", epdesc->wMaxPacketSize);
+				ep = epdesc;
+				alt = ifdesc->bAlternateSetting;
+				bulk = TRUE;
+				goto found;
+			}
 
-				uclassdrvinfof("\t  Endpoint wMaxPacketSize = %d", epdesc->wMaxPacketSize);
+			if ((epdesc->bmAttributes & 0x03) != USBH_EPTYPE_ISO)
+				continue;
 
-				if (epdesc->wMaxPacketSize >= min_ep_size) {
-					if (epdesc->wMaxPacketSize < sz) {
-						uclassdrvinfo("\t    Found new optimal alternate setting");
-						sz = epdesc->wMaxPacketSize;
-						alt = ifdesc->bAlternateSetting;
-						ep = epdesc;
-					}
-				}
+			uclassdrvinfof("\t  Endpoint wMaxPacketSize = %d", epdesc->wMaxPacketSize);
+
+			if (epdesc->wMaxPacketSize & 0x1800) {
+				uclassdrvinfo("\t    High-bandwidth endpoint, not supported");
+				continue;
 			}
-		}
-	}
 
-	if (ep && alt) {
-		uclassdrvinfof("\tSelecting Alternate setting %d", alt);
-		if (usbhStdReqSetInterface(uvcdp->dev, if_get(&uvcdp->ivs)->bInterfaceNumber, alt) == HAL_SUCCESS) {
-			usbhEPObjectInit(&uvcdp->ep_iso, uvcdp->dev, ep);
-			usbhEPSetName(&uvcdp->ep_iso, "UVC[ISO ]");
-			return HAL_SUCCESS;
+			if ((ifdesc->bAlternateSetting != 0)
+					&& (epdesc->wMaxPacketSize >= min_payload)
+					&& (epdesc->wMaxPacketSize < sz)) {
+				uclassdrvinfo("\t    Found new optimal alternate setting");
+				sz = epdesc->wMaxPacketSize;
+				alt = ifdesc->bAlternateSetting;
+				ep = epdesc;
+			}
 		}
 	}
 
-	return HAL_FAILED;
+	if (ep == NULL)
+		return HAL_FAILED;
+
+found:
+	uclassdrvinfof("\tSelecting Alternate setting %d (%s)", alt, bulk ? "bulk" : "isochronous");
+	if (usbhStdReqSetInterface(uvcdp->dev, ifnum, alt) != HAL_SUCCESS)
+		return HAL_FAILED;
+
+	usbhEPObjectInit(&uvcdp->ep_vs, uvcdp->dev, ep);
+	usbhEPSetName(&uvcdp->ep_vs, bulk ? "UVC[BULK]" : "UVC[ISO ]");
+	uvcdp->vs_bulk = bulk;
+	return HAL_SUCCESS;
 }
 
 #if	USBH_DEBUG_ENABLE && USBHUVC_DEBUG_ENABLE_INFO
@@ -230,25 +273,144 @@ static void _cb_int(usbh_urb_t *urb) {
 	usbhURBSubmitI(urb);
 }
 
-static void _cb_iso(usbh_urb_t *urb) {
+#if HAL_USBHUVC_USE_FRAME_ASSEMBLER
+static void _frame_completeI(USBHUVCDriver *uvcdp) {
+	usbhuvc_frame_t *const f = uvcdp->fr_back;
+
+	if (!uvcdp->fr_started)
+		return;
+	uvcdp->fr_started = FALSE;
+
+	if (uvcdp->fr_error) {
+		uvcdp->fr_stats.corrupt++;
+		return;
+	}
+	if (f->length == 0)
+		return;
+
+	f->sequence = uvcdp->fr_sequence++;
+	uvcdp->fr_stats.completed++;
+
+	/* swap the back and orphan buffers */
+	uvcdp->fr_back = uvcdp->fr_orphan;
+	uvcdp->fr_orphan = f;
+	if (chSemGetCounterI(&uvcdp->fr_ready) == 0)
+		chSemSignalI(&uvcdp->fr_ready);
+	else
+		uvcdp->fr_stats.dropped++;
+}
+
+static void _frame_packetI(USBHUVCDriver *uvcdp, const uint8_t *buff, uint32_t len) {
+	const uint8_t hlen = buff[0];
+	const uint8_t bfh = buff[1];
+	const uint8_t fid = bfh & UVC_HDR_FID;
+
+	if (fid != uvcdp->fr_fid) {
+		/* FID toggled: the previous frame ended, even if EOF was lost */
+		_frame_completeI(uvcdp);
+		if (uvcdp->fr_fid != 0xff)
+			uvcdp->fr_sync = TRUE;
+		uvcdp->fr_fid = fid;
+	}
+
+	/* discard the frame that was in progress when the stream started */
+	if (!uvcdp->fr_sync) {
+		if (bfh & UVC_HDR_EOF)
+			uvcdp->fr_sync = TRUE;
+		return;
+	}
+
+	len -= hlen;
+	usbhuvc_frame_t *const f = uvcdp->fr_back;
+	if (!uvcdp->fr_started) {
+		/* header-only packets between frames don't start a new one */
+		if (len == 0)
+			return;
+		uvcdp->fr_started = TRUE;
+		uvcdp->fr_error = FALSE;
+		f->length = 0;
+		f->flags = 0;
+		f->timestamp = osalOsGetSystemTimeX();
+	}
+
+	if ((bfh & UVC_HDR_PT) && (hlen >= 6)) {
+		f->pts = buff[2] | (buff[3] << 8) | (buff[4] << 16) | ((uint32_t)buff[5] << 24);
+		f->flags |= USBHUVC_FRAME_FLAG_PTS;
+	}
+	if (bfh & UVC_HDR_STILL)
+		f->flags |= USBHUVC_FRAME_FLAG_STILL;
+	if (bfh & UVC_HDR_ERR)
+		uvcdp->fr_error = TRUE;
+
+	if (len) {
+		if (f->length + len > f->size) {
+			uclassdrvwarnf("UVC: frame overflow, size=%d", f->size);
+			uvcdp->fr_error = TRUE;
+		} else {
+			memcpy(f->buf + f->length, buff + hlen, len);
+			f->length += len;
+		}
+	}
+
+	if (bfh & UVC_HDR_EOF)
+		_frame_completeI(uvcdp);
+}
+
+void usbhuvcSetFrameBuffers(USBHUVCDriver *uvcdp, usbhuvc_frame_t *frames) {
+	osalDbgCheck(uvcdp);
+
+	osalSysLock();
+	osalDbgAssert(uvcdp->state != USBHUVC_STATE_STREAMING, "invalid state");
+	if (frames) {
+		osalDbgCheck(frames[0].buf && frames[1].buf && frames[2].buf);
+		uvcdp->fr_front = &frames[0];
+		uvcdp->fr_back = &frames[1];
+		uvcdp->fr_orphan = &frames[2];
+	} else {
+		uvcdp->fr_front = uvcdp->fr_back = uvcdp->fr_orphan = NULL;
+	}
+	osalSysUnlock();
+}
+
+usbhuvc_frame_t *usbhuvcFrameAcquire(USBHUVCDriver *uvcdp, systime_t timeout) {
+	usbhuvc_frame_t *f = NULL;
+
+	osalSysLock();
+	if (chSemWaitTimeoutS(&uvcdp->fr_ready, timeout) == MSG_OK) {
+		/* swap the front and orphan buffers */
+		f = uvcdp->fr_orphan;
+		uvcdp->fr_orphan = uvcdp->fr_front;
+		uvcdp->fr_front = f;
+	}
+	osalSysUnlock();
+	return f;
+}
+#endif
+
+static void _cb_vs(usbh_urb_t *urb) {
 	USBHUVCDriver *uvcdp = (USBHUVCDriver *)urb->userData;
 
 	if ((urb->status == USBH_URBSTATUS_DISCONNECTED)
 			|| (urb->status == USBH_URBSTATUS_CANCELLED)) {
-		uurbwarn("UVC: ISO IN status = DISCONNECTED/CANCELLED, aborting");
+		uurbwarn("UVC: VS IN status = DISCONNECTED/CANCELLED, aborting");
 		return;
 	}
 
 	if (urb->status != USBH_URBSTATUS_OK) {
-		uurberrf("UVC: ISO IN error, unexpected status = %d", urb->status);
+		uurberrf("UVC: VS IN error, unexpected status = %d", urb->status);
+#if HAL_USBHUVC_USE_FRAME_ASSEMBLER
+		/* a payload was lost */
+		if (uvcdp->fr_back)
+			uvcdp->fr_error = TRUE;
+#endif
 	} else if (urb->actualLength >= 2) {
 		const uint8_t *const buff = (const uint8_t *)urb->buff;
 		if (buff[0] < 2) {
-			uurberrf("UVC: ISO IN, bHeaderLength=%d", buff[0]);
+			uurberrf("UVC: VS IN, bHeaderLength=%d", buff[0]);
 		} else if (buff[0] > urb->actualLength) {
-			uurberrf("UVC: ISO IN, bHeaderLength=%d > actualLength=%d", buff[0], urb->actualLength);
+			uurberrf("UVC: VS IN, bHeaderLength=%d > actualLength=%d", buff[0], urb->actualLength);
 		} else {
-			uurbdbgf("UVC: ISO IN len=%d, hdr=%d, FID=%d, EOF=%d, ERR=%d, EOH=%d",
+			uurbdbgf("UVC: VS IN len=%d, hdr=%d, FID=%d, EOF=%d, ERR=%d, EOH=%d",
 						urb->actualLength,
 						buff[0],
 						buff[1] & UVC_HDR_FID,
@@ -256,11 +418,18 @@ static void _cb_iso(usbh_urb_t *urb) {
 						buff[1] & UVC_HDR_ERR,
 						buff[1] & UVC_HDR_EOH);
 
+			uvcdp->vs_bytes += urb->actualLength - buff[0];
+
+#if HAL_USBHUVC_USE_FRAME_ASSEMBLER
+			if (uvcdp->fr_back) {
+				_frame_packetI(uvcdp, buff, urb->actualLength);
+			} else
+#endif
 			if ((urb->actualLength > buff[0])
 					|| (buff[1] & (UVC_HDR_EOF | UVC_HDR_ERR))) {
 				_post(uvcdp, urb, &uvcdp->mp_data, USBHUVC_MESSAGETYPE_DATA);
 			} else {
-				uurbdbgf("UVC: ISO IN skip: len=%d, hdr=%d, FID=%d, EOF=%d, ERR=%d, EOH=%d",
+				uurbdbgf("UVC: VS IN skip: len=%d, hdr=%d, FID=%d, EOF=%d, ERR=%d, EOH=%d",
 						urb->actualLength,
 						buff[0],
 						buff[1] & UVC_HDR_FID,
@@ -270,7 +439,7 @@ static void _cb_iso(usbh_urb_t *urb) {
 			}
 		}
 	} else if (urb->actualLength > 0) {
-		uurberrf("UVC: ISO IN, actualLength=%d", urb->actualLength);
+		uurberrf("UVC: VS IN, actualLength=%d", urb->actualLength);
 	}
 
 	usbhURBObjectResetI(urb);
@@ -299,15 +468,59 @@ bool usbhuvcStreamStart(USBHUVCDriver *uvcdp, uint16_t min_ep_sz) {
 	const uint8_t *elem;
 	uint32_t datapackets;
 	uint32_t data_sz;
+	uint32_t xfer_sz;
+	uint8_t urbs;
+	uint8_t i;
 
 	//set the alternate setting
-	if (_set_vs_alternate(uvcdp, min_ep_sz) != HAL_SUCCESS)
+	if (min_ep_sz == USBHUVC_MIN_EP_SZ_COMMITTED) {
+		//use the payload size negotiated through probe/commit
+		if (uvcdp->pc.dwMaxPayloadTransferSize == 0) {
+			uclassdrverr("dwMaxPayloadTransferSize not negotiated");
+			goto exit;
+		}
+		if (_set_vs_alternate(uvcdp, uvcdp->pc.dwMaxPayloadTransferSize) != HAL_SUCCESS)
+			goto exit;
+	} else if (_set_vs_alternate(uvcdp, min_ep_sz) != HAL_SUCCESS) {
+		goto exit;
+	} else if ((min_ep_sz == 0) && !uvcdp->vs_bulk) {
+		uclassdrverr("No bulk VS endpoint on alternate setting 0");
 		goto exit;
+	}
+
+	if (uvcdp->vs_bulk) {
+		//each bulk transfer carries a whole payload, with its header
+		const uint32_t mps = uvcdp->ep_vs.wMaxPacketSize;
+		const uint32_t payload = uvcdp->pc.dwMaxPayloadTransferSize;
+		xfer_sz = (payload / mps) * mps;
+		if (xfer_sz < payload)
+			xfer_sz += mps;
+		if ((xfer_sz == 0) || (xfer_sz < payload)
+				|| (xfer_sz > 0xffffffffU - sizeof(usbhuvc_message_data_t) - 3)) {
+			uclassdrverrf("Unsupported dwMaxPayloadTransferSize=%u", uvcdp->pc.dwMaxPayloadTransferSize);
+			goto failed;
+		}
+		urbs = HAL_USBHUVC_BULK_URBS;
+	} else {
+		xfer_sz = uvcdp->ep_vs.wMaxPacketSize;
+		urbs = 1;
+	}
 
 	//reserve working RAM
-	data_sz = (uvcdp->ep_iso.wMaxPacketSize + sizeof(usbhuvc_message_data_t) + 3) & ~3;
+	data_sz = (xfer_sz + sizeof(usbhuvc_message_data_t) + 3) & ~3;
 	datapackets = HAL_USBHUVC_WORK_RAM_SIZE / data_sz;
-	if (datapackets == 0) {
+#if HAL_USBHUVC_USE_FRAME_ASSEMBLER
+	if (uvcdp->fr_back) {
+		//the payloads go to the frame buffers, only the URB buffers are needed
+		datapackets = urbs;
+		chSemObjectInit(&uvcdp->fr_ready, 0);
+		uvcdp->fr_fid = 0xff;
+		uvcdp->fr_sync = FALSE;
+		uvcdp->fr_started = FALSE;
+		uvcdp->fr_error = FALSE;
+	}
+#endif
+	if (datapackets < urbs) {
 		uclassdrverr("Not enough work RAM");
 		goto failed;
 	}
@@ -334,24 +547,33 @@ bool usbhuvcStreamStart(USBHUVCDriver *uvcdp, uint16_t min_ep_sz) {
 	}
 
 	//open the endpoint
-	usbhEPOpen(&uvcdp->ep_iso);
+	if (usbhEPOpen(&uvcdp->ep_vs) != HAL_SUCCESS) {
+		uclassdrverr("Not enough periodic bandwidth for this alternate setting");
+		goto failed;
+	}
 
-	//allocate 1 buffer and submit the first transfer
-	{
-		usbhuvc_message_data_t *const msg = (usbhuvc_message_data_t *)chPoolAlloc(&uvcdp->mp_data);
+	//allocate the URB buffers and submit the transfers
+	osalSysLock();
+	uvcdp->vs_bytes = 0;
+	uvcdp->vs_bw_start = osalOsGetSystemTimeX();
+	for (i = 0; i < urbs; i++) {
+		usbhuvc_message_data_t *const msg = (usbhuvc_message_data_t *)chPoolAllocI(&uvcdp->mp_data);
 		osalDbgCheck(msg);
-		usbhURBObjectInit(&uvcdp->urb_iso, &uvcdp->ep_iso, _cb_iso, uvcdp, msg->data, uvcdp->ep_iso.wMaxPacketSize);
+		usbhURBObjectInit(&uvcdp->urb_vs[i], &uvcdp->ep_vs, _cb_vs, uvcdp, msg->data, xfer_sz);
+		usbhURBSubmitI(&uvcdp->urb_vs[i]);
 	}
-
-	usbhURBSubmit(&uvcdp->urb_iso);
+	osalOsRescheduleS();
+	osalSysUnlock();
 
 	ret = HAL_SUCCESS;
 	goto exit;
 
 failed:
 	_set_vs_alternate(uvcdp, 0);
-	if (uvcdp->mp_data_buffer)
+	if (uvcdp->mp_data_buffer) {
 		chHeapFree(uvcdp->mp_data_buffer);
+		uvcdp->mp_data_buffer = 0;
+	}
 
 exit:
 	osalSysLock();
@@ -363,6 +585,22 @@ exit:
 	return ret;
 }
 
+uint32_t usbhuvcGetBandwidth(USBHUVCDriver *uvcdp) {
+	osalDbgCheck(uvcdp);
+
+	osalSysLock();
+	const systime_t now = osalOsGetSystemTimeX();
+	const systime_t elapsed = now - uvcdp->vs_bw_start;
+	const uint32_t bytes = uvcdp->vs_bytes;
+	uvcdp->vs_bytes = 0;
+	uvcdp->vs_bw_start = now;
+	osalSysUnlock();
+
+	if (elapsed == 0)
+		return 0;
+	return (uint32_t)(((uint64_t)bytes * OSAL_ST_FREQUENCY) / elapsed);
+}
+
 bool usbhuvcStreamStop(USBHUVCDriver *uvcdp) {
 	osalSysLock();
 	osalDbgCheck(uvcdp && (uvcdp->state != USBHUVC_STATE_UNINITIALIZED) &&
@@ -373,8 +611,13 @@ bool usbhuvcStreamStop(USBHUVCDriver *uvcdp) {
 	}
 	uvcdp->state = USBHUVC_STATE_BUSY;
 
-	//close the ISO endpoint
-	usbhEPCloseS(&uvcdp->ep_iso);
+	//close the VS endpoint
+	usbhEPCloseS(&uvcdp->ep_vs);
+
+#if HAL_USBHUVC_USE_FRAME_ASSEMBLER
+	if (uvcdp->fr_back)
+		chSemResetI(&uvcdp->fr_ready, 0);
+#endif
 
 	//purge the mailbox
 	chMBResetI(&uvcdp->mb);		//TODO: the status messages are lost!!
@@ -492,14 +735,13 @@ uint32_t usbhuvcEstimateRequiredEPSize(USBHUVCDriver *uvcdp, const uint8_t *form
 	return (sz * mul) / div + 12;
 }
 
-static usbh_baseclassdriver_t *_uvc_load(usbh_device_t *dev, const uint8_t *descriptor, uint16_t rem) {
+static usbh_baseclassdriver_t *_uvc_load(usbh_device_t *dev, const uint8_t *descriptor, uint16_t rem,
+		const usbh_classdriver_match_t *match) {
 
 	USBHUVCDriver *uvcdp;
 	uint8_t i;
 
-	if (_usbh_match_descriptor(descriptor, rem, USBH_DT_INTERFACE_ASSOCIATION,
-			0x0e, 0x03, 0x00) != HAL_SUCCESS)
-		return NULL;
+	(void)match;
 
 	/* alloc driver */
 	for (i = 0; i < HAL_USBHUVC_MAX_INSTANCES; i++) {
@@ -640,6 +882,12 @@ alloc_ok:
 				/* found VS isochronous endpoint */
 				udevinfof("  VS Isochronous endpoint; %02x, bInterval=%d, bmAttributes=%02x",
 						epdesc->bEndpointAddress, epdesc->bInterval, epdesc->bmAttributes);
+			} else if ((ifdesc->bInterfaceSubClass == UVC_SC_VIDEOSTREAMING)
+					&& ((epdesc->bmAttributes & 0x03) == USBH_EPTYPE_BULK)
+					&& ((epdesc->bEndpointAddress & 0x80) ==  USBH_EPDIR_IN)) {
+				/* found VS bulk endpoint */
+				udevinfof("  VS Bulk endpoint; %02x, wMaxPacketSize=%d",
+						epdesc->bEndpointAddress, epdesc->wMaxPacketSize);
 			} else {
 				/* unknown EP */
 				udevwarnf("  <unknown endpoint>, bEndpointAddress=%02x, bmAttributes=%02x",
@@ -666,7 +914,10 @@ alloc_ok:
 	for(i = 0; i < HAL_USBHUVC_STATUS_PACKETS_COUNT; i++)
 		chPoolFree(&uvcdp->mp_status, &uvcdp->mp_status_buffer[i]);
 
-	usbhEPOpen(&uvcdp->ep_int);
+	if (usbhEPOpen(&uvcdp->ep_int) != HAL_SUCCESS) {
+		udevwarn("No periodic bandwidth for the interrupt endpoint");
+		return NULL;
+	}
 
 	usbhuvc_message_status_t *const msg = (usbhuvc_message_status_t *)chPoolAlloc(&uvcdp->mp_status);
 	osalDbgCheck(msg);
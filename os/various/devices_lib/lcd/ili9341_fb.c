@@ -0,0 +1,387 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/**
+ * @file    ili9341_fb.c
+ * @brief   ILI9341 framebuffer front end.
+ * @note    The dirty rectangles tracker does not access the hardware.
+ */
+
+#include "ch.h"
+#include "hal.h"
+#include "ili9341_fb.h"
+
+/**
+ * @addtogroup ili9341
+ * @{
+ */
+
+/*===========================================================================*/
+/* Driver local definitions.                                                 */
+/*===========================================================================*/
+
+#if (TRUE != SPI_USE_WAIT)
+#error "The ILI9341 framebuffer requires SPI_USE_WAIT"
+#endif
+
+/*===========================================================================*/
+/* Driver exported variables.                                                */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver local variables and types.                                         */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver local functions.                                                   */
+/*===========================================================================*/
+
+/**
+ * @brief   Area of a rectangle, in pixels.
+ */
+static uint32_t ili9341_rect_area(const ili9341_rect_t *rp) {
+
+  return ((uint32_t)rp->x2 - rp->x1 + 1U) * ((uint32_t)rp->y2 - rp->y1 + 1U);
+}
+
+/**
+ * @brief   Bounding box of two rectangles.
+ */
+static ili9341_rect_t ili9341_rect_union(const ili9341_rect_t *ap,
+                                         const ili9341_rect_t *bp) {
+  ili9341_rect_t r;
+
+  r.x1 = (ap->x1 < bp->x1) ? ap->x1 : bp->x1;
+  r.y1 = (ap->y1 < bp->y1) ? ap->y1 : bp->y1;
+  r.x2 = (ap->x2 > bp->x2) ? ap->x2 : bp->x2;
+  r.y2 = (ap->y2 > bp->y2) ? ap->y2 : bp->y2;
+  return r;
+}
+
+/**
+ * @brief   Pixels sent in excess when two rectangles are merged.
+ * @details Negative when the merge saves transfers, overlapping areas are
+ *          sent once instead of twice.
+ */
+static int32_t ili9341_rect_growth(const ili9341_rect_t *ap,
+                                   const ili9341_rect_t *bp) {
+  ili9341_rect_t u = ili9341_rect_union(ap, bp);
+
+  return (int32_t)ili9341_rect_area(&u) -
+         (int32_t)ili9341_rect_area(ap) - (int32_t)ili9341_rect_area(bp);
+}
+
+/**
+ * @brief   Removes a rectangle, the order is not kept.
+ */
+static void ili9341_dirty_remove(ili9341_dirty_t *dp, size_t i) {
+
+  dp->rects[i] = dp->rects[--dp->count];
+}
+
+/**
+ * @brief   Encodes the address window commands of a rectangle.
+ */
+static void ili9341_fb_encode_window(uint8_t *wp, const ili9341_rect_t *rp) {
+
+  wp[0]  = ILI9341_SET_COL_ADDR;
+  wp[1]  = (uint8_t)(rp->x1 >> 8);
+  wp[2]  = (uint8_t)rp->x1;
+  wp[3]  = (uint8_t)(rp->x2 >> 8);
+  wp[4]  = (uint8_t)rp->x2;
+  wp[5]  = ILI9341_SET_PAGE_ADDR;
+  wp[6]  = (uint8_t)(rp->y1 >> 8);
+  wp[7]  = (uint8_t)rp->y1;
+  wp[8]  = (uint8_t)(rp->y2 >> 8);
+  wp[9]  = (uint8_t)rp->y2;
+  wp[10] = ILI9341_SET_MEM;
+}
+
+/**
+ * @brief   Sends the address window commands.
+ * @details Polled transfers, a DMA set up would cost more than the bytes.
+ */
+static void ili9341_fb_send_window(ILI9341Driver *driverp, const uint8_t *wp) {
+  const ILI9341Config *cfgp = driverp->config;
+  unsigned i;
+
+  for (i = 0U; i < ILI9341_FB_WINDOW_SIZE; i++) {
+    if ((i == 0U) || (i == 5U) || (i == 10U)) {
+      palClearPad(cfgp->dcx_port, cfgp->dcx_pad);   /* !Cmd */
+    }
+    else {
+      palSetPad(cfgp->dcx_port, cfgp->dcx_pad);     /* Data */
+    }
+    (void)spiPolledExchange(cfgp->spi, wp[i]);
+  }
+  palSetPad(cfgp->dcx_port, cfgp->dcx_pad);         /* Data */
+}
+
+/*===========================================================================*/
+/* Driver exported functions.                                                */
+/*===========================================================================*/
+
+/**
+ * @brief   Initializes a dirty rectangles tracker.
+ *
+ * @param[out] dp       pointer to the @p ili9341_dirty_t object
+ * @param[in] width     screen width
+ * @param[in] height    screen height
+ *
+ * @init
+ */
+void ili9341DirtyInit(ili9341_dirty_t *dp, uint16_t width, uint16_t height) {
+
+  osalDbgCheck((dp != NULL) && (width > 0U) && (height > 0U));
+
+  dp->width = width;
+  dp->height = height;
+  dp->count = 0U;
+}
+
+/**
+ * @brief   Forgets all the dirty rectangles.
+ *
+ * @param[in] dp        pointer to the @p ili9341_dirty_t object
+ *
+ * @api
+ */
+void ili9341DirtyClear(ili9341_dirty_t *dp) {
+
+  osalDbgCheck(dp != NULL);
+
+  dp->count = 0U;
+}
+
+/**
+ * @brief   Marks an area as dirty.
+ * @details The area is clipped to the screen, then merged with every
+ *          rectangle it does not pay to send separately, see
+ *          @p ILI9341_FB_MERGE_COST. When the list is full the area is
+ *          merged with the rectangle it grows the least.
+ *
+ * @param[in] dp        pointer to the @p ili9341_dirty_t object
+ * @param[in] x         left column
+ * @param[in] y         top row
+ * @param[in] width     area width
+ * @param[in] height    area height
+ *
+ * @api
+ */
+void ili9341DirtyAdd(ili9341_dirty_t *dp, uint16_t x, uint16_t y,
+                     uint16_t width, uint16_t height) {
+  ili9341_rect_t r;
+  uint32_t x2, y2;
+  size_t i;
+
+  osalDbgCheck(dp != NULL);
+
+  if ((width == 0U) || (height == 0U) ||
+      (x >= dp->width) || (y >= dp->height)) {
+    return;
+  }
+  x2 = (uint32_t)x + width - 1U;
+  y2 = (uint32_t)y + height - 1U;
+  r.x1 = x;
+  r.y1 = y;
+  r.x2 = (x2 < dp->width) ? (uint16_t)x2 : (uint16_t)(dp->width - 1U);
+  r.y2 = (y2 < dp->height) ? (uint16_t)y2 : (uint16_t)(dp->height - 1U);
+
+  while (true) {
+    /* Merging pass, restarted after each merge because the grown
+       rectangle can now be worth merging with the previous ones.*/
+    i = 0U;
+    while (i < dp->count) {
+      if (ili9341_rect_growth(&r, &dp->rects[i]) <= ILI9341_FB_MERGE_COST) {
+        r = ili9341_rect_union(&r, &dp->rects[i]);
+        ili9341_dirty_remove(dp, i);
+        i = 0U;
+      }
+      else {
+        i++;
+      }
+    }
+
+    if (dp->count < ILI9341_FB_MAX_RECTS) {
+      dp->rects[dp->count++] = r;
+      return;
+    }
+
+    /* List full, merging with the cheapest one and trying again.*/
+    {
+      size_t best = 0U;
+      int32_t growth = ili9341_rect_growth(&r, &dp->rects[0]);
+
+      for (i = 1U; i < dp->count; i++) {
+        int32_t g = ili9341_rect_growth(&r, &dp->rects[i]);
+        if (g < growth) {
+          growth = g;
+          best = i;
+        }
+      }
+      r = ili9341_rect_union(&r, &dp->rects[best]);
+      ili9341_dirty_remove(dp, best);
+    }
+  }
+}
+
+/**
+ * @brief   Initializes a framebuffer.
+ *
+ * @param[out] fbp      pointer to the @p ili9341_fb_t object
+ * @param[in] driverp   pointer to the @p ILI9341Driver object
+ * @param[in] bufferp   pixels buffer, <tt>width * height * 2</tt> bytes,
+ *                      accessible by DMA
+ * @param[in] width     screen width
+ * @param[in] height    screen height
+ *
+ * @init
+ */
+void ili9341FbObjectInit(ili9341_fb_t *fbp, ILI9341Driver *driverp,
+                         uint8_t *bufferp, uint16_t width, uint16_t height) {
+
+  osalDbgCheck((fbp != NULL) && (driverp != NULL) && (bufferp != NULL));
+
+  fbp->driverp = driverp;
+  fbp->bufferp = bufferp;
+  ili9341DirtyInit(&fbp->dirty, width, height);
+}
+
+/**
+ * @brief   Marks a framebuffer area as modified.
+ *
+ * @param[in] fbp       pointer to the @p ili9341_fb_t object
+ * @param[in] x         left column
+ * @param[in] y         top row
+ * @param[in] width     area width
+ * @param[in] height    area height
+ *
+ * @api
+ */
+void ili9341FbInvalidate(ili9341_fb_t *fbp, uint16_t x, uint16_t y,
+                         uint16_t width, uint16_t height) {
+
+  osalDbgCheck(fbp != NULL);
+
+  ili9341DirtyAdd(&fbp->dirty, x, y, width, height);
+}
+
+/**
+ * @brief   Fills a framebuffer area.
+ * @details The area is marked as modified.
+ *
+ * @param[in] fbp       pointer to the @p ili9341_fb_t object
+ * @param[in] x         left column
+ * @param[in] y         top row
+ * @param[in] width     area width
+ * @param[in] height    area height
+ * @param[in] color     RGB-565 color
+ *
+ * @api
+ */
+void ili9341FbFillRect(ili9341_fb_t *fbp, uint16_t x, uint16_t y,
+                       uint16_t width, uint16_t height, uint16_t color) {
+  uint16_t c = ILI9341_FB_COLOR(color);
+  uint32_t r, n;
+
+  osalDbgCheck(fbp != NULL);
+
+  if ((x >= fbp->dirty.width) || (y >= fbp->dirty.height)) {
+    return;
+  }
+  if ((uint32_t)x + width > fbp->dirty.width) {
+    width = (uint16_t)(fbp->dirty.width - x);
+  }
+  if ((uint32_t)y + height > fbp->dirty.height) {
+    height = (uint16_t)(fbp->dirty.height - y);
+  }
+
+  for (r = 0U; r < height; r++) {
+    uint16_t *p = ili9341FbPixelAddress(fbp, x, y + r);
+
+    for (n = 0U; n < width; n++) {
+      *p++ = c;
+    }
+  }
+  ili9341FbInvalidate(fbp, x, y, width, height);
+}
+
+/**
+ * @brief   Sends the modified areas to the panel.
+ * @details Each dirty rectangle is sent as an address window followed by
+ *          bursts of pixels, one per row or, for full width rectangles,
+ *          as large as @p ILI9341_FB_MAX_BURST. The bursts are synchronous
+ *          @p spiSend() transfers, DMA driven where the SPI driver is.
+ * @note    The window of the next rectangle is not encoded while the pixels
+ *          are sent, the overlap would save less than 1% of a flush, see
+ *          demos/various/HOST-ILI9341-FB.
+ * @pre    The bus is owned by the caller, the SPI driver is configured
+ *          with 8-bit frames.
+ *
+ * @param[in] fbp       pointer to the @p ili9341_fb_t object
+ *
+ * @api
+ */
+void ili9341FbFlush(ili9341_fb_t *fbp) {
+  uint8_t window[ILI9341_FB_WINDOW_SIZE];
+  ili9341_dirty_t *dp;
+  SPIDriver *spip;
+  size_t pitch, i;
+
+  osalDbgCheck(fbp != NULL);
+
+  dp = &fbp->dirty;
+  if (dp->count == 0U) {
+    return;
+  }
+  spip = fbp->driverp->config->spi;
+  pitch = (size_t)dp->width * 2U;
+
+  ili9341Select(fbp->driverp);
+  for (i = 0U; i < dp->count; i++) {
+    const ili9341_rect_t *rp = &dp->rects[i];
+    const uint8_t *p = (const uint8_t *)ili9341FbPixelAddress(fbp, rp->x1,
+                                                              rp->y1);
+    size_t rowlen = ((size_t)rp->x2 - rp->x1 + 1U) * 2U;
+    size_t remaining = ((size_t)rp->y2 - rp->y1 + 1U) * pitch;
+
+    ili9341_fb_encode_window(window, rp);
+    ili9341_fb_send_window(fbp->driverp, window);
+
+    while (remaining > 0U) {
+      size_t n;
+
+      if (rowlen == pitch) {
+        /* Full width, the rectangle is contiguous in memory.*/
+        n = (remaining < ILI9341_FB_MAX_BURST) ? remaining
+                                               : ILI9341_FB_MAX_BURST;
+        spiSend(spip, n, p);
+        p += n;
+        remaining -= n;
+      }
+      else {
+        spiSend(spip, rowlen, p);
+        p += pitch;
+        remaining -= pitch;
+      }
+    }
+  }
+  ili9341Unselect(fbp->driverp);
+
+  ili9341DirtyClear(dp);
+}
+
+/** @} */
@@ -0,0 +1,178 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/**
+ * @file    ili9341_fb.h
+ * @brief   ILI9341 framebuffer front end.
+ * @details Keeps a RGB-565 framebuffer in RAM and tracks the areas modified
+ *          since the last flush, only those are sent to the panel.
+ *
+ * @addtogroup ili9341
+ * @{
+ */
+
+#ifndef _ILI9341_FB_H_
+#define _ILI9341_FB_H_
+
+#include "ili9341.h"
+
+/*===========================================================================*/
+/* Driver constants.                                                         */
+/*===========================================================================*/
+
+/**
+ * @brief   Size of the address window command block.
+ * @details CASET and its 4 parameters, PASET and its 4 parameters, RAMWR.
+ */
+#define ILI9341_FB_WINDOW_SIZE              11U
+
+/*===========================================================================*/
+/* Driver pre-compile time settings.                                         */
+/*===========================================================================*/
+
+/**
+ * @name    ILI9341 framebuffer configuration options
+ * @{
+ */
+
+/**
+ * @brief   Maximum number of dirty rectangles.
+ * @details When the list is full the new area is merged with the rectangle
+ *          it grows the least.
+ */
+#if !defined(ILI9341_FB_MAX_RECTS) || defined(__DOXYGEN__)
+#define ILI9341_FB_MAX_RECTS                8
+#endif
+
+/**
+ * @brief   Cost of an address window, in pixels.
+ * @details Two rectangles are merged when their bounding box is not larger
+ *          than their areas plus this cost. It accounts for the window
+ *          commands and the bursts set up.
+ */
+#if !defined(ILI9341_FB_MERGE_COST) || defined(__DOXYGEN__)
+#define ILI9341_FB_MERGE_COST               256
+#endif
+
+/**
+ * @brief   Maximum size of a pixels burst, in bytes.
+ */
+#if !defined(ILI9341_FB_MAX_BURST) || defined(__DOXYGEN__)
+#define ILI9341_FB_MAX_BURST                65534
+#endif
+
+/** @} */
+
+/*===========================================================================*/
+/* Derived constants and error checks.                                       */
+/*===========================================================================*/
+
+#if ILI9341_FB_MAX_RECTS < 1
+#error "ILI9341_FB_MAX_RECTS must be at least 1"
+#endif
+
+#if (ILI9341_FB_MAX_BURST < 2) || ((ILI9341_FB_MAX_BURST & 1) != 0)
+#error "ILI9341_FB_MAX_BURST must be even"
+#endif
+
+/*===========================================================================*/
+/* Driver data structures and types.                                         */
+/*===========================================================================*/
+
+/**
+ * @brief   Rectangle, inclusive coordinates.
+ */
+typedef struct {
+  uint16_t              x1;         /**< Left column.*/
+  uint16_t              y1;         /**< Top row.*/
+  uint16_t              x2;         /**< Right column.*/
+  uint16_t              y2;         /**< Bottom row.*/
+} ili9341_rect_t;
+
+/**
+ * @brief   Dirty rectangles tracker.
+ */
+typedef struct {
+  ili9341_rect_t        rects[ILI9341_FB_MAX_RECTS]; /**< Dirty areas.*/
+  size_t                count;      /**< Number of dirty areas.*/
+  uint16_t              width;      /**< Screen width.*/
+  uint16_t              height;     /**< Screen height.*/
+} ili9341_dirty_t;
+
+/**
+ * @brief   ILI9341 framebuffer.
+ */
+typedef struct {
+  ILI9341Driver         *driverp;   /**< Panel driver.*/
+  uint8_t               *bufferp;   /**< Pixels, RGB-565, panel byte order.*/
+  ili9341_dirty_t       dirty;      /**< Areas to be flushed.*/
+} ili9341_fb_t;
+
+/*===========================================================================*/
+/* Driver macros.                                                            */
+/*===========================================================================*/
+
+/**
+ * @brief   Number of dirty rectangles.
+ *
+ * @param[in] dp        pointer to the @p ili9341_dirty_t object
+ */
+#define ili9341DirtyGetCountX(dp) ((dp)->count)
+
+/**
+ * @brief   Converts a RGB-565 color to the panel byte order.
+ *
+ * @param[in] c         RGB-565 color
+ */
+#define ILI9341_FB_COLOR(c)                                                 \
+  ((uint16_t)((((uint16_t)(c) & 0xFFU) << 8) | ((uint16_t)(c) >> 8)))
+
+/**
+ * @brief   Address of a framebuffer pixel.
+ *
+ * @param[in] fbp       pointer to the @p ili9341_fb_t object
+ * @param[in] x         column
+ * @param[in] y         row
+ */
+#define ili9341FbPixelAddress(fbp, x, y)                                    \
+  ((uint16_t *)(void *)((fbp)->bufferp) +                                   \
+   ((size_t)(y) * (fbp)->dirty.width) + (x))
+
+/*===========================================================================*/
+/* External declarations.                                                    */
+/*===========================================================================*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+  void ili9341DirtyInit(ili9341_dirty_t *dp, uint16_t width, uint16_t height);
+  void ili9341DirtyClear(ili9341_dirty_t *dp);
+  void ili9341DirtyAdd(ili9341_dirty_t *dp, uint16_t x, uint16_t y,
+                       uint16_t width, uint16_t height);
+  void ili9341FbObjectInit(ili9341_fb_t *fbp, ILI9341Driver *driverp,
+                           uint8_t *bufferp, uint16_t width, uint16_t height);
+  void ili9341FbInvalidate(ili9341_fb_t *fbp, uint16_t x, uint16_t y,
+                           uint16_t width, uint16_t height);
+  void ili9341FbFillRect(ili9341_fb_t *fbp, uint16_t x, uint16_t y,
+                         uint16_t width, uint16_t height, uint16_t color);
+  void ili9341FbFlush(ili9341_fb_t *fbp);
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _ILI9341_FB_H_ */
+
+/** @} */
@@ -159,6 +159,13 @@ static nrf52_payload_rx_fifo_t    rx_fifo;
 static uint8_t                    tx_payload_buffer[NRF52_MAX_PAYLOAD_LENGTH + 2];
 static uint8_t                    rx_payload_buffer[NRF52_MAX_PAYLOAD_LENGTH + 2];
 
+#if NRF52_RADIO_USE_BURST
+// Chained payloads, one is prepared while the other one is on air.
+static uint8_t                    tx_burst_buffer[2][NRF52_MAX_PAYLOAD_LENGTH + 2];
+static uint8_t *                  p_tx_packet;
+static uint8_t *                  p_tx_chained_packet;
+#endif
+
 static uint8_t                    pids[NRF52_PIPE_COUNT];
 static pipe_info_t                rx_pipe_info[NRF52_PIPE_COUNT];
 
@@ -180,6 +187,17 @@ static uint32_t addr_conv(uint8_t const* p_addr) {
     return __REV(bytewise_bit_swap(p_addr)); //lint -esym(628, __rev) -esym(526, __rev) */
 }
 
+// Wakes up the events thread, from the radio interrupt in burst mode.
+static void signal_events(void) {
+#if NRF52_RADIO_USE_BURST
+    chSysLockFromISR();
+    chBSemSignalI(&events_sem);
+    chSysUnlockFromISR();
+#else
+    chBSemSignal(&events_sem);
+#endif
+}
+
 static thread_t *rfEvtThread_p;
 static THD_WORKING_AREA(waRFEvtThread, 128);
 static THD_FUNCTION(rfEvtThread, arg) {
@@ -190,8 +208,10 @@ static THD_FUNCTION(rfEvtThread, arg) {
     while (!chThdShouldTerminateX()) {
     	chBSemWait(&events_sem);
 
+    	chSysLock();
     	nrf52_int_flags_t interrupts = RFD1.flags;
         RFD1.flags = 0;
+        chSysUnlock();
 
         if (interrupts & NRF52_INT_TX_SUCCESS_MSK) {
             chEvtBroadcastFlags(&RFD1.eventsrc, (eventflags_t) NRF52_EVENT_TX_SUCCESS);
@@ -206,6 +226,30 @@ static THD_FUNCTION(rfEvtThread, arg) {
     chThdExit((msg_t) 0);
 }
 
+// Radio state machine, advanced on each DISABLED event.
+static void on_radio_disabled(RFDriver *rfp) {
+    switch (rfp->state) {
+      case NRF52_STATE_PTX_TX:
+    	  on_radio_disabled_tx_noack(rfp);
+    	  break;
+      case NRF52_STATE_PTX_TX_ACK:
+    	  on_radio_disabled_tx(rfp);
+    	  break;
+      case NRF52_STATE_PTX_RX_ACK:
+    	  on_radio_disabled_tx_wait_for_ack(rfp);
+    	  break;
+      case NRF52_STATE_PRX:
+    	  on_radio_disabled_rx(rfp);
+    	  break;
+      case NRF52_STATE_PRX_SEND_ACK:
+    	  on_radio_disabled_rx_ack(rfp);
+    	  break;
+      default:
+    	  break;
+    }
+}
+
+#if !NRF52_RADIO_USE_BURST
 static thread_t *rfIntThread_p;
 static THD_WORKING_AREA(waRFIntThread, 128);
 static THD_FUNCTION(rfIntThread, arg) {
@@ -215,28 +259,11 @@ static THD_FUNCTION(rfIntThread, arg) {
 
     while (!chThdShouldTerminateX()) {
     	chBSemWait(&disable_sem);
-    	switch (RFD1.state) {
-    	  case NRF52_STATE_PTX_TX:
-    		  on_radio_disabled_tx_noack(&RFD1);
-    		  break;
-    	  case NRF52_STATE_PTX_TX_ACK:
-    		  on_radio_disabled_tx(&RFD1);
-    		  break;
-    	  case NRF52_STATE_PTX_RX_ACK:
-    		  on_radio_disabled_tx_wait_for_ack(&RFD1);
-    		  break;
-    	  case NRF52_STATE_PRX:
-    		  on_radio_disabled_rx(&RFD1);
-    		  break;
-    	  case NRF52_STATE_PRX_SEND_ACK:
-    		  on_radio_disabled_rx_ack(&RFD1);
-    		  break;
-    	  default:
-    		  break;
-    	}
+    	on_radio_disabled(&RFD1);
     }
 	chThdExit((msg_t) 0);
 }
+#endif
 
 static void serve_radio_interrupt(RFDriver *rfp) {
     if ((NRF_RADIO->INTENSET & RADIO_INTENSET_READY_Msk) && NRF_RADIO->EVENTS_READY) {
@@ -246,9 +273,15 @@ static void serve_radio_interrupt(RFDriver *rfp) {
     if ((NRF_RADIO->INTENSET & RADIO_INTENSET_DISABLED_Msk) && NRF_RADIO->EVENTS_DISABLED) {
         NRF_RADIO->EVENTS_DISABLED = 0;
         (void) NRF_RADIO->EVENTS_DISABLED;
+#if NRF52_RADIO_USE_BURST
+        // No thread between packets, the next transmission is started from here.
+        on_radio_disabled(rfp);
+#else
+        (void)rfp;
         chSysLockFromISR();
        	chBSemSignalI(&disable_sem);
        	chSysUnlockFromISR();
+#endif
     }
 }
 
@@ -407,19 +440,32 @@ static void init_fifo(void) {
     }
 }
 
-static void tx_fifo_remove_last(void) {
+// Must be called with the RADIO IRQ masked or from the RADIO IRQ handler.
+static void tx_fifo_remove_lastI(void) {
     if (tx_fifo.count > 0) {
-        nvicDisableVector(RADIO_IRQn);
-
         tx_fifo.count--;
         if (++tx_fifo.exit_point >= NRF52_TX_FIFO_SIZE) {
             tx_fifo.exit_point = 0;
         }
-
-        nvicEnableVector(RADIO_IRQn, NRF52_RADIO_IRQ_PRIORITY);
     }
 }
 
+#if !NRF52_RADIO_USE_BURST
+static void tx_fifo_remove_last(void) {
+    nvicDisableVector(RADIO_IRQn);
+    tx_fifo_remove_lastI();
+    nvicEnableVector(RADIO_IRQn, NRF52_RADIO_IRQ_PRIORITY);
+}
+#endif
+
+// The state machine runs in the RADIO IRQ handler in burst mode and in
+// rfIntThread otherwise, re-enabling the vector from the ISR is not allowed.
+#if NRF52_RADIO_USE_BURST
+#define tx_fifo_remove_sent()   tx_fifo_remove_lastI()
+#else
+#define tx_fifo_remove_sent()   tx_fifo_remove_last()
+#endif
+
 /** @brief  Function to push the content of the rx_buffer to the RX FIFO.
  *
  *  The module will point the register NRF_RADIO->PACKETPTR to a buffer for receiving packets.
@@ -433,6 +479,10 @@ static void tx_fifo_remove_last(void) {
  *  @retval false  Operation failed.
  */
 static bool rx_fifo_push_rfbuf(RFDriver *rfp, uint8_t pipe, uint8_t pid) {
+#if NRF52_RADIO_USE_STATISTICS
+    nrf52_pipe_stats_t * p_stats = &rfp->stats[pipe & 7];
+#endif
+
     if (rx_fifo.count < NRF52_RX_FIFO_SIZE) {
         if (rfp->config.protocol == NRF52_PROTOCOL_ESB_DPL) {
             if (rx_payload_buffer[0] > NRF52_MAX_PAYLOAD_LENGTH) {
@@ -455,6 +505,10 @@ static bool rx_fifo_push_rfbuf(RFDriver *rfp, uint8_t pipe, uint8_t pid) {
         rx_fifo.p_payload[rx_fifo.entry_point]->pipe = pipe;
         rx_fifo.p_payload[rx_fifo.entry_point]->rssi = NRF_RADIO->RSSISAMPLE;
         rx_fifo.p_payload[rx_fifo.entry_point]->pid = pid;
+#if NRF52_RADIO_USE_STATISTICS
+        p_stats->rx_packets++;
+        p_stats->rx_bytes += rx_fifo.p_payload[rx_fifo.entry_point]->length;
+#endif
         if (++rx_fifo.entry_point >= NRF52_RX_FIFO_SIZE) {
             rx_fifo.entry_point = 0;
         }
@@ -463,9 +517,90 @@ static bool rx_fifo_push_rfbuf(RFDriver *rfp, uint8_t pipe, uint8_t pid) {
         return true;
     }
 
+#if NRF52_RADIO_USE_STATISTICS
+    p_stats->rx_overflows++;
+#endif
     return false;
 }
 
+// Copies the oldest payload of the RX FIFO out, the RADIO interrupt must be masked.
+static void rx_fifo_pop(nrf52_payload_t * p_payload) {
+    p_payload->length = rx_fifo.p_payload[rx_fifo.exit_point]->length;
+    p_payload->pipe   = rx_fifo.p_payload[rx_fifo.exit_point]->pipe;
+    p_payload->rssi   = rx_fifo.p_payload[rx_fifo.exit_point]->rssi;
+    p_payload->pid    = rx_fifo.p_payload[rx_fifo.exit_point]->pid;
+    memcpy(p_payload->data, rx_fifo.p_payload[rx_fifo.exit_point]->data, p_payload->length);
+
+    if (++rx_fifo.exit_point >= NRF52_RX_FIFO_SIZE) {
+        rx_fifo.exit_point = 0;
+    }
+
+    rx_fifo.count--;
+}
+
+#if NRF52_RADIO_USE_STATISTICS
+// Accounts the payload being removed from the TX FIFO.
+static void stats_tx_done(RFDriver *rfp, nrf52_payload_t const * p_payload, bool acked) {
+    nrf52_pipe_stats_t * p_stats = &rfp->stats[p_payload->pipe & 7];
+    uint32_t latency;
+
+    p_stats->tx_packets++;
+    p_stats->tx_bytes += p_payload->length;
+
+    if (acked) {
+        latency = RTC2US(NRF5_HFCLK_FREQUENCY, chSysGetRealtimeCounterX() - rfp->tx_start);
+        p_stats->acks++;
+        p_stats->ack_latency_sum += latency;
+        if (latency > p_stats->ack_latency_max) {
+            p_stats->ack_latency_max = latency;
+        }
+    }
+}
+#endif
+
+#if NRF52_RADIO_USE_BURST
+/** @brief  Chains the payload following the current one.
+ *
+ *  Consecutive payloads without ack on the same pipe are sent back to back: the
+ *  DISABLED->TXEN shortcut starts the next transmission as soon as the current
+ *  one ends, the interrupt only has to move PACKETPTR during the ramp-up.
+ *  The shortcut is removed when nothing can be chained.
+ */
+static void tx_burst_chain(RFDriver *rfp) {
+    nrf52_payload_t * p_next;
+    uint32_t next;
+
+    rfp->tx_chained = false;
+
+    if (rfp->state != NRF52_STATE_PTX_TX) {
+        return;
+    }
+
+    next = tx_fifo.exit_point + 1;
+    if (next >= NRF52_TX_FIFO_SIZE) {
+        next = 0;
+    }
+    p_next = tx_fifo.p_payload[next];
+
+    if (tx_fifo.count >= 2 &&
+        p_next->noack && rfp->config.selective_auto_ack &&
+        p_next->pipe == p_current_payload->pipe)
+    {
+        p_tx_chained_packet = (p_tx_packet == tx_burst_buffer[0]) ?
+                              tx_burst_buffer[1] : tx_burst_buffer[0];
+        p_tx_chained_packet[0] = p_next->length;
+        p_tx_chained_packet[1] = (p_next->pid << 1) | 0x01;
+        memcpy(&p_tx_chained_packet[2], p_next->data, p_next->length);
+
+        rfp->tx_chained = true;
+        NRF_RADIO->SHORTS = RADIO_SHORTS_COMMON | RADIO_SHORTS_DISABLED_TXEN_Msk;
+    }
+    else {
+        NRF_RADIO->SHORTS = RADIO_SHORTS_COMMON;
+    }
+}
+#endif
+
 static void timer_init(RFDriver *rfp) {
     // Configure the system timer with a 1 MHz base frequency
     rfp->timer->PRESCALER = 4;
@@ -528,6 +663,14 @@ static void start_tx_transaction(RFDriver *rfp) {
     NRF_RADIO->FREQUENCY    = rfp->config.address.rf_channel;
     NRF_RADIO->PACKETPTR    = (uint32_t)tx_payload_buffer;
 
+#if NRF52_RADIO_USE_BURST
+    p_tx_packet = tx_payload_buffer;
+    tx_burst_chain(rfp);
+#endif
+#if NRF52_RADIO_USE_STATISTICS
+    rfp->tx_start = chSysGetRealtimeCounterX();
+#endif
+
     NRF_RADIO->EVENTS_READY = 0;
     NRF_RADIO->EVENTS_DISABLED = 0;
     (void)NRF_RADIO->EVENTS_READY;
@@ -541,9 +684,38 @@ static void start_tx_transaction(RFDriver *rfp) {
 
 static void on_radio_disabled_tx_noack(RFDriver *rfp) {
     rfp->flags |= NRF52_INT_TX_SUCCESS_MSK;
-    tx_fifo_remove_last();
+#if NRF52_RADIO_USE_STATISTICS
+    if (tx_fifo.count > 0) {
+        stats_tx_done(rfp, p_current_payload, false);
+    }
+#endif
+    tx_fifo_remove_sent();
+
+	signal_events();
+
+#if NRF52_RADIO_USE_BURST
+    if (rfp->tx_chained) {
+        if (tx_fifo.count == 0) {
+            // FIFO flushed meanwhile, the chained transmission is aborted
+            NRF_RADIO->SHORTS = RADIO_SHORTS_COMMON;
+            NRF_RADIO->TASKS_DISABLE = 1;
+            rfp->tx_chained = false;
+            rfp->state = NRF52_STATE_IDLE;
+            return;
+        }
 
-	chBSemSignal(&events_sem);
+        // The radio is already ramping up through the DISABLED->TXEN shortcut,
+        // the packet pointer is only read by the START task
+        NRF_RADIO->PACKETPTR = (uint32_t)p_tx_chained_packet;
+        p_tx_packet = p_tx_chained_packet;
+        p_current_payload = tx_fifo.p_payload[tx_fifo.exit_point];
+#if NRF52_RADIO_USE_STATISTICS
+        rfp->tx_start = chSysGetRealtimeCounterX();
+#endif
+        tx_burst_chain(rfp);
+        return;
+    }
+#endif
 
 	if (tx_fifo.count == 0) {
         rfp->state = NRF52_STATE_IDLE;
@@ -600,7 +772,12 @@ static void on_radio_disabled_tx_wait_for_ack(RFDriver *rfp) {
         rfp->flags |= NRF52_INT_TX_SUCCESS_MSK;
         rfp->tx_attempt++;// = rfp->config.retransmit.count - rfp->tx_remaining + 1;
 
-        tx_fifo_remove_last();
+#if NRF52_RADIO_USE_STATISTICS
+        if (tx_fifo.count > 0) {
+            stats_tx_done(rfp, p_current_payload, true);
+        }
+#endif
+        tx_fifo_remove_sent();
 
         if (rfp->config.protocol != NRF52_PROTOCOL_ESB && rx_payload_buffer[0] > 0) {
             if (rx_fifo_push_rfbuf(rfp, (uint8_t)NRF_RADIO->TXADDRESS, 0)) {
@@ -608,7 +785,7 @@ static void on_radio_disabled_tx_wait_for_ack(RFDriver *rfp) {
             }
         }
 
-    	chBSemSignal(&events_sem);
+    	signal_events();
 
         if ((tx_fifo.count == 0) || (rfp->config.tx_mode == NRF52_TXMODE_MANUAL)) {
             rfp->state = NRF52_STATE_IDLE;
@@ -624,14 +801,20 @@ static void on_radio_disabled_tx_wait_for_ack(RFDriver *rfp) {
             // All retransmits are expended, and the TX operation is suspended
             rfp->tx_attempt = rfp->config.retransmit.count + 1;
             rfp->flags |= NRF52_INT_TX_FAILED_MSK;
+#if NRF52_RADIO_USE_STATISTICS
+            rfp->stats[p_current_payload->pipe & 7].tx_failed++;
+#endif
 
-            chBSemSignal(&events_sem);
+            signal_events();
 
             rfp->state = NRF52_STATE_IDLE;
         }
         else {
             // There are still have more retransmits left, TX mode should be
             // entered again as soon as the system timer reaches CC[1].
+#if NRF52_RADIO_USE_STATISTICS
+            rfp->stats[p_current_payload->pipe & 7].retransmits++;
+#endif
             NRF_RADIO->SHORTS = RADIO_SHORTS_COMMON | RADIO_SHORTS_DISABLED_RXEN_Msk;
             set_rf_payload_format(rfp, p_current_payload->length);
             NRF_RADIO->PACKETPTR = (uint32_t)tx_payload_buffer;
@@ -676,6 +859,9 @@ static void on_radio_disabled_rx(RFDriver *rfp) {
     }
 
     if(rx_fifo.count >= NRF52_RX_FIFO_SIZE) {
+#if NRF52_RADIO_USE_STATISTICS
+        rfp->stats[NRF_RADIO->RXMATCH & 7].rx_overflows++;
+#endif
         clear_events_restart_rx(rfp);
         return;
     }
@@ -705,6 +891,9 @@ static void on_radio_disabled_rx(RFDriver *rfp) {
                         // Pipe stays in ACK with payload until TX fifo is empty
                         // Do not report TX success on first ack payload or retransmit
                         if (p_pipe_info->m_ack_payload != 0 && !retransmit_payload) {
+#if NRF52_RADIO_USE_STATISTICS
+                            stats_tx_done(rfp, tx_fifo.p_payload[tx_fifo.exit_point], false);
+#endif
                             if(++tx_fifo.exit_point >= NRF52_TX_FIFO_SIZE) {
                                 tx_fifo.exit_point = 0;
                             }
@@ -758,7 +947,7 @@ static void on_radio_disabled_rx(RFDriver *rfp) {
         // successful.
         if (rx_fifo_push_rfbuf(rfp, NRF_RADIO->RXMATCH, p_pipe_info->m_pid)) {
             rfp->flags |= NRF52_INT_RX_DR_MSK;
-            chBSemSignal(&events_sem);
+            signal_events();
         }
     }
 }
@@ -785,6 +974,9 @@ nrf52_error_t radio_disable(void) {
 	NRF_RADIO->TASKS_DISABLE = 1;
 
 	RFD1.state = NRF52_STATE_IDLE;
+#if NRF52_RADIO_USE_BURST
+	RFD1.tx_chained = false;
+#endif
 
     // Clear PPI
     NRF_PPI->CHENCLR = (1 << NRF52_RADIO_PPI_TIMER_START) |
@@ -797,10 +989,12 @@ nrf52_error_t radio_disable(void) {
     memset(rx_pipe_info, 0, sizeof(rx_pipe_info));
     memset(pids, 0, sizeof(pids));
 
+#if !NRF52_RADIO_USE_BURST
     // Terminate interrupts handle thread
     chThdTerminate(rfIntThread_p);
     chBSemSignal(&disable_sem);
     chThdWait(rfIntThread_p);
+#endif
 
     // Terminate events handle thread
     chThdTerminate(rfEvtThread_p);
@@ -831,6 +1025,12 @@ nrf52_error_t radio_init(nrf52_config_t const *config) {
     RFD1.radio = NRF_RADIO;
 	RFD1.config = *config;
     RFD1.flags    = 0;
+#if NRF52_RADIO_USE_BURST
+    RFD1.tx_chained = false;
+#endif
+#if NRF52_RADIO_USE_STATISTICS
+    memset(RFD1.stats, 0, sizeof(RFD1.stats));
+#endif
 
     init_fifo();
 
@@ -864,9 +1064,11 @@ nrf52_error_t radio_init(nrf52_config_t const *config) {
 
     chEvtObjectInit(&RFD1.eventsrc);
 
+#if !NRF52_RADIO_USE_BURST
     // interrupt handle thread
     rfIntThread_p = chThdCreateStatic(waRFIntThread, sizeof(waRFIntThread),
     		NRF52_RADIO_INTTHD_PRIORITY, rfIntThread, NULL);
+#endif
 
     // events handle thread
     rfEvtThread_p = chThdCreateStatic(waRFEvtThread, sizeof(waRFEvtThread),
@@ -931,21 +1133,34 @@ nrf52_error_t radio_read_rx_payload(nrf52_payload_t * p_payload) {
 
     nvicDisableVector(RADIO_IRQn);
 
-    p_payload->length = rx_fifo.p_payload[rx_fifo.exit_point]->length;
-    p_payload->pipe   = rx_fifo.p_payload[rx_fifo.exit_point]->pipe;
-    p_payload->rssi   = rx_fifo.p_payload[rx_fifo.exit_point]->rssi;
-    p_payload->pid    = rx_fifo.p_payload[rx_fifo.exit_point]->pid;
-    memcpy(p_payload->data, rx_fifo.p_payload[rx_fifo.exit_point]->data, p_payload->length);
+    rx_fifo_pop(p_payload);
 
-    if (++rx_fifo.exit_point >= NRF52_RX_FIFO_SIZE) {
-        rx_fifo.exit_point = 0;
-    }
+    nvicEnableVector(RADIO_IRQn, NRF52_RADIO_IRQ_PRIORITY);
 
-    rx_fifo.count--;
+    return NRF52_SUCCESS;
+}
+
+// Drains up to max payloads at once, to be used after a NRF52_EVENT_RX_RECEIVED
+// event as several payloads may have been received since the last one.
+nrf52_error_t radio_read_rx_payloads(nrf52_payload_t * p_payloads, uint8_t max, uint8_t * p_count) {
+    uint8_t n = 0;
+
+    if (RFD1.state == NRF52_STATE_UNINIT)
+    	return NRF52_INVALID_STATE;
+    if (p_payloads == NULL || p_count == NULL)
+    	return NRF52_ERROR_NULL;
+
+    nvicDisableVector(RADIO_IRQn);
+
+    while (n < max && rx_fifo.count > 0) {
+        rx_fifo_pop(&p_payloads[n++]);
+    }
 
     nvicEnableVector(RADIO_IRQn, NRF52_RADIO_IRQ_PRIORITY);
 
-    return NRF52_SUCCESS;
+    *p_count = n;
+
+    return (n == 0) ? NRF52_ERROR_INVALID_LENGTH : NRF52_SUCCESS;
 }
 
 nrf52_error_t radio_start_tx(void) {
@@ -1112,3 +1327,26 @@ nrf52_error_t radio_set_prefix(uint8_t pipe, uint8_t prefix) {
 
     return NRF52_SUCCESS;
 }
+
+#if NRF52_RADIO_USE_STATISTICS
+nrf52_error_t radio_get_pipe_stats(uint8_t pipe, nrf52_pipe_stats_t * p_stats) {
+    if (pipe > 7)
+    	return NRF52_ERROR_INVALID_PARAM;
+    if (p_stats == NULL)
+        return NRF52_ERROR_NULL;
+
+    nvicDisableVector(RADIO_IRQn);
+    *p_stats = RFD1.stats[pipe];
+    nvicEnableVector(RADIO_IRQn, NRF52_RADIO_IRQ_PRIORITY);
+
+    return NRF52_SUCCESS;
+}
+
+nrf52_error_t radio_reset_stats(void) {
+    nvicDisableVector(RADIO_IRQn);
+    memset(RFD1.stats, 0, sizeof(RFD1.stats));
+    nvicEnableVector(RADIO_IRQn, NRF52_RADIO_IRQ_PRIORITY);
+
+    return NRF52_SUCCESS;
+}
+#endif
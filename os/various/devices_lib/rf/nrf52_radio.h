@@ -26,8 +26,19 @@
 
 #define NRF52_CRC_RESET_VALUE             	0xFFFF              /**< CRC reset value*/
 
+#ifndef NRF52_TX_FIFO_SIZE
 #define NRF52_TX_FIFO_SIZE                  8                   /**< The size of the transmission first in first out buffer. */
+#endif
+#ifndef NRF52_RX_FIFO_SIZE
 #define NRF52_RX_FIFO_SIZE                  8                   /**< The size of the reception first in first out buffer. */
+#endif
+
+#ifndef NRF52_RADIO_USE_BURST
+#define NRF52_RADIO_USE_BURST               FALSE               /**< Radio events served in the interrupt, payloads without ack are chained. */
+#endif
+#ifndef NRF52_RADIO_USE_STATISTICS
+#define NRF52_RADIO_USE_STATISTICS          FALSE               /**< Per-pipe traffic counters. */
+#endif
 
 #define NRF52_RADIO_USE_TIMER0            	FALSE               /**< TIMER0 will be used by the module. */
 #define NRF52_RADIO_USE_TIMER1            	TRUE                /**< TIMER1 will be used by the module. */
@@ -179,6 +190,20 @@ typedef struct {
     uint16_t              count;                  /**< The number of retransmissions attempts before transmission fail. */
 } nrf52_retransmit_t;
 
+/**@brief Per-pipe traffic counters. */
+typedef struct {
+    uint32_t              tx_packets;             /**< Payloads sent, and acknowledged when an ack was requested. */
+    uint32_t              tx_bytes;               /**< Payload bytes sent. */
+    uint32_t              tx_failed;              /**< Payloads not acknowledged after the last retransmit. */
+    uint32_t              retransmits;            /**< Retransmit attempts. */
+    uint32_t              acks;                   /**< Acknowledged payloads. */
+    uint32_t              ack_latency_sum;        /**< Sum of the delays between the first attempt and the ack, in microseconds. */
+    uint32_t              ack_latency_max;        /**< Longest delay between the first attempt and the ack, in microseconds. */
+    uint32_t              rx_packets;             /**< Payloads received, retransmitted copies excluded. */
+    uint32_t              rx_bytes;               /**< Payload bytes received. */
+    uint32_t              rx_overflows;           /**< Payloads refused because the RX FIFO was full. */
+} nrf52_pipe_stats_t;
+
 /**@brief Main nrf_esb configuration struct. */
 typedef struct {
     nrf52_protocol_t      protocol;               /**< Enhanced ShockBurst protocol. */
@@ -230,6 +255,22 @@ typedef struct {
    * @brief TX retransmits remaining.
    */
   uint16_t                tx_remaining;
+#if NRF52_RADIO_USE_BURST
+  /**
+   * @brief Next payload already chained to the current one.
+   */
+  bool                    tx_chained;
+#endif
+#if NRF52_RADIO_USE_STATISTICS
+  /**
+   * @brief Start of the current transaction, realtime counter.
+   */
+  rtcnt_t                 tx_start;
+  /**
+   * @brief Per-pipe traffic counters.
+   */
+  nrf52_pipe_stats_t      stats[8];
+#endif
   /**
    * @brief Radio events source.
    */
@@ -242,6 +283,7 @@ nrf52_error_t radio_init(nrf52_config_t const *config);
 nrf52_error_t radio_disable(void);
 nrf52_error_t radio_write_payload(nrf52_payload_t const * p_payload);
 nrf52_error_t radio_read_rx_payload(nrf52_payload_t * p_payload);
+nrf52_error_t radio_read_rx_payloads(nrf52_payload_t * p_payloads, uint8_t max, uint8_t * p_count);
 nrf52_error_t radio_start_tx(void);
 nrf52_error_t radio_start_rx(void);
 nrf52_error_t radio_stop_rx(void);
@@ -252,5 +294,9 @@ nrf52_error_t radio_set_base_address_0(uint8_t const * p_addr);
 nrf52_error_t radio_set_base_address_1(uint8_t const * p_addr);
 nrf52_error_t radio_set_prefixes(uint8_t const * p_prefixes, uint8_t num_pipes);
 nrf52_error_t radio_set_prefix(uint8_t pipe, uint8_t prefix);
+#if NRF52_RADIO_USE_STATISTICS
+nrf52_error_t radio_get_pipe_stats(uint8_t pipe, nrf52_pipe_stats_t * p_stats);
+nrf52_error_t radio_reset_stats(void);
+#endif
 
 #endif /* NRF52_RADIO_H_ */
@@ -0,0 +1,319 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/**
+ * @file    nbuf.c
+ * @brief   N-buffer latest value mailbox source.
+ * @note    One producer and one consumer, each side can run in thread or
+ *          interrupt context but must not be re-entered.
+ *
+ * @addtogroup NBuf
+ * @{
+ */
+
+#include "osal.h"
+#include "nbuf.h"
+
+/*===========================================================================*/
+/* Module local definitions.                                                 */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Module exported variables.                                                */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Module local variables and types.                                         */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Module local functions.                                                   */
+/*===========================================================================*/
+
+#if (NBUF_USE_ATOMICS == TRUE) || defined(__DOXYGEN__)
+
+/**
+ * @brief   Atomic exchange.
+ */
+static inline uint32_t nbuf_xchg(uint32_t *p, uint32_t v) {
+
+  return __atomic_exchange_n(p, v, __ATOMIC_ACQ_REL);
+}
+
+/**
+ * @brief   Atomic compare and swap.
+ */
+static inline bool nbuf_cas(uint32_t *p, uint32_t *expp, uint32_t v) {
+
+  return __atomic_compare_exchange_n(p, expp, v, false,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief   Atomic bits set.
+ */
+static inline void nbuf_or(uint32_t *p, uint32_t v) {
+
+  (void)__atomic_fetch_or(p, v, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief   Atomic load.
+ */
+static inline uint32_t nbuf_load(uint32_t *p) {
+
+  return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+#else /* NBUF_USE_ATOMICS == FALSE */
+
+static uint32_t nbuf_xchg(uint32_t *p, uint32_t v) {
+  syssts_t sts;
+  uint32_t old;
+
+  sts = osalSysGetStatusAndLockX();
+  old = *p;
+  *p = v;
+  osalSysRestoreStatusX(sts);
+  return old;
+}
+
+static bool nbuf_cas(uint32_t *p, uint32_t *expp, uint32_t v) {
+  syssts_t sts;
+  bool done;
+
+  sts = osalSysGetStatusAndLockX();
+  done = *p == *expp;
+  if (done) {
+    *p = v;
+  }
+  else {
+    *expp = *p;
+  }
+  osalSysRestoreStatusX(sts);
+  return done;
+}
+
+static void nbuf_or(uint32_t *p, uint32_t v) {
+  syssts_t sts;
+
+  sts = osalSysGetStatusAndLockX();
+  *p |= v;
+  osalSysRestoreStatusX(sts);
+}
+
+static uint32_t nbuf_load(uint32_t *p) {
+
+  return *(volatile uint32_t *)p;
+}
+
+#endif /* NBUF_USE_ATOMICS == FALSE */
+
+/**
+ * @brief   Takes a buffer out of the free mask.
+ *
+ * @return              The buffer index, @p NBUF_NONE if none is free.
+ */
+static uint32_t nbuf_take_free(nbuf_t *nbp) {
+  uint32_t mask = nbuf_load(&nbp->free);
+  uint32_t idx;
+
+  do {
+    if (mask == 0U) {
+      return NBUF_NONE;
+    }
+    idx = 0U;
+    while ((mask & (1U << idx)) == 0U) {
+      idx++;
+    }
+  } while (!nbuf_cas(&nbp->free, &mask, mask & ~(1U << idx)));
+
+  return idx;
+}
+
+/*===========================================================================*/
+/* Module exported functions.                                                */
+/*===========================================================================*/
+
+/**
+ * @brief   Initializes a N-buffer mailbox.
+ * @details Buffer 0 is given to the producer, the others are free.
+ *
+ * @param[out] nbp      pointer to the @p nbuf_t object
+ * @param[in] buffers   array of @p n buffer addresses
+ * @param[in] meta      array of @p n metadata slots
+ * @param[in] n         number of buffers, from 3 to @p NBUF_MAX_BUFFERS
+ *
+ * @init
+ */
+void nbufObjectInit(nbuf_t *nbp, void * const *buffers, nbuf_meta_t *meta,
+                    uint32_t n) {
+  uint32_t i;
+
+  osalDbgCheck((nbp != NULL) && (buffers != NULL) && (meta != NULL) &&
+               (n >= 3U) && (n <= NBUF_MAX_BUFFERS));
+
+  nbp->buffers = buffers;
+  nbp->meta    = meta;
+  nbp->n       = n;
+  nbp->latest  = NBUF_NONE;
+  nbp->free    = (uint32_t)(0xFFFFFFFFU >> (32U - n)) & ~1U;
+  nbp->back    = 0U;
+  nbp->pseq    = 0U;
+  nbp->cseq    = 0U;
+  nbp->pcseq   = 0U;
+  for (i = 0U; i < n; i++) {
+    meta[i].seq       = 0U;
+    meta[i].timestamp = 0U;
+    meta[i].size      = 0U;
+  }
+}
+
+/**
+ * @brief   Gives a free buffer to the consumer.
+ * @details Used to start with a buffer on the consumer side, like the one
+ *          being displayed, it returns to the rotation when released.
+ *
+ * @param[in] nbp       pointer to the @p nbuf_t object
+ * @param[in] idx       index of a free buffer
+ *
+ * @init
+ */
+void nbufReserve(nbuf_t *nbp, uint32_t idx) {
+
+  osalDbgCheck((nbp != NULL) && (idx < nbp->n));
+  osalDbgAssert((nbp->free & (1U << idx)) != 0U, "not free");
+
+  nbp->free &= ~(1U << idx);
+}
+
+/**
+ * @brief   Publishes the producer buffer.
+ * @details The metadata of the buffer is stamped and the buffer replaces
+ *          the one waiting in the mailbox, which is recycled if the consumer
+ *          did not fetch it.
+ * @note    Producer side only.
+ *
+ * @param[in] nbp       pointer to the @p nbuf_t object
+ * @param[in] timestamp producer timestamp
+ * @param[in] size      valid data size
+ * @return              The index of the new producer buffer.
+ *
+ * @xclass
+ */
+uint32_t nbufPublish(nbuf_t *nbp, uint32_t timestamp, size_t size) {
+  nbuf_meta_t *mp = &nbp->meta[nbp->back];
+  uint32_t old;
+
+  mp->seq       = ++nbp->pseq;
+  mp->timestamp = timestamp;
+  mp->size      = size;
+
+  old = nbuf_xchg(&nbp->latest, nbp->back);
+  if (old != NBUF_NONE) {
+    nbuf_or(&nbp->free, 1U << old);
+  }
+
+  nbp->back = nbuf_take_free(nbp);
+  osalDbgAssert(nbp->back != NBUF_NONE, "consumer holds too many buffers");
+
+  return nbp->back;
+}
+
+/**
+ * @brief   Checks if a published buffer is waiting.
+ *
+ * @param[in] nbp       pointer to the @p nbuf_t object
+ * @return              @p true if @p nbufFetch() would return a buffer.
+ *
+ * @xclass
+ */
+bool nbufIsReady(nbuf_t *nbp) {
+
+  return nbuf_load(&nbp->latest) != NBUF_NONE;
+}
+
+/**
+ * @brief   Fetches the last published buffer.
+ * @details The consumer owns the buffer until @p nbufRelease().
+ * @note    Consumer side only.
+ *
+ * @param[in] nbp       pointer to the @p nbuf_t object
+ * @param[out] missedp  number of buffers published since the previous
+ *                      fetch and never fetched, can be @p NULL
+ * @return              The buffer index, @p NBUF_NONE if nothing new was
+ *                      published.
+ *
+ * @xclass
+ */
+uint32_t nbufFetch(nbuf_t *nbp, uint32_t *missedp) {
+  uint32_t idx, seq;
+
+  idx = nbuf_xchg(&nbp->latest, NBUF_NONE);
+  if (idx == NBUF_NONE) {
+    return NBUF_NONE;
+  }
+
+  seq = nbp->meta[idx].seq;
+  if (missedp != NULL) {
+    *missedp = seq - nbp->cseq - 1U;
+  }
+  nbp->pcseq = nbp->cseq;
+  nbp->cseq  = seq;
+
+  return idx;
+}
+
+/**
+ * @brief   Gives back the last fetched buffer unused.
+ * @details The buffer waits in the mailbox again unless the producer
+ *          published a newer one in the meantime, then it is recycled and
+ *          counted as missed by the next fetch.
+ * @note    Consumer side only.
+ *
+ * @param[in] nbp       pointer to the @p nbuf_t object
+ * @param[in] idx       index returned by the last @p nbufFetch()
+ *
+ * @xclass
+ */
+void nbufPutBack(nbuf_t *nbp, uint32_t idx) {
+  uint32_t none = NBUF_NONE;
+
+  osalDbgCheck(idx < nbp->n);
+
+  nbp->cseq = nbp->pcseq;
+  if (!nbuf_cas(&nbp->latest, &none, idx)) {
+    nbuf_or(&nbp->free, 1U << idx);
+  }
+}
+
+/**
+ * @brief   Returns a buffer to the rotation.
+ * @note    Consumer side only.
+ *
+ * @param[in] nbp       pointer to the @p nbuf_t object
+ * @param[in] idx       index of a buffer held by the consumer
+ *
+ * @xclass
+ */
+void nbufRelease(nbuf_t *nbp, uint32_t idx) {
+
+  osalDbgCheck(idx < nbp->n);
+
+  nbuf_or(&nbp->free, 1U << idx);
+}
+
+/** @} */
@@ -0,0 +1,168 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/**
+ * @file    nbuf.h
+ * @brief   N-buffer latest value mailbox header.
+ * @details A single producer publishes filled buffers, a single consumer
+ *          fetches the most recent one. The producer never blocks, frames
+ *          not fetched in time are recycled and the consumer can tell how
+ *          many it missed from the sequence numbers. Buffer ownership moves
+ *          through atomic index swaps, no critical zone is needed.
+ *
+ * @addtogroup NBuf
+ * @{
+ */
+
+#ifndef NBUF_H_
+#define NBUF_H_
+
+/*===========================================================================*/
+/* Module constants.                                                         */
+/*===========================================================================*/
+
+/**
+ * @brief   Maximum number of buffers.
+ */
+#define NBUF_MAX_BUFFERS                    32U
+
+/**
+ * @brief   No buffer index.
+ */
+#define NBUF_NONE                           0xFFFFFFFFU
+
+/*===========================================================================*/
+/* Module pre-compile time settings.                                         */
+/*===========================================================================*/
+
+/**
+ * @name    N-buffer configuration options
+ * @{
+ */
+
+/**
+ * @brief   Uses atomic instructions for the index swaps.
+ * @details Exclusive load/store on ARM, the compiler atomics elsewhere. When
+ *          disabled the swaps are short critical zones, the default on
+ *          cores without exclusive access instructions.
+ */
+#if !defined(NBUF_USE_ATOMICS) || defined(__DOXYGEN__)
+#if defined(__GNUC__) && (!defined(__arm__) || defined(__ARM_FEATURE_LDREX))
+#define NBUF_USE_ATOMICS                    TRUE
+#else
+#define NBUF_USE_ATOMICS                    FALSE
+#endif
+#endif
+
+/** @} */
+
+/*===========================================================================*/
+/* Derived constants and error checks.                                       */
+/*===========================================================================*/
+
+#if (NBUF_USE_ATOMICS == TRUE) && !defined(__GNUC__)
+#error "NBUF_USE_ATOMICS requires a GCC compatible compiler"
+#endif
+
+/*===========================================================================*/
+/* Module data structures and types.                                         */
+/*===========================================================================*/
+
+/**
+ * @brief   Buffer metadata.
+ */
+typedef struct {
+  uint32_t              seq;        /**< Publication number, from 1.*/
+  uint32_t              timestamp;  /**< Producer timestamp.*/
+  size_t                size;       /**< Valid data size.*/
+} nbuf_meta_t;
+
+/**
+ * @brief   N-buffer mailbox object.
+ * @note    The producer owns one buffer, the last published one waits in
+ *          the mailbox, the consumer can hold up to <tt>n - 2</tt> buffers.
+ */
+typedef struct {
+  void * const          *buffers;   /**< Buffers array.*/
+  nbuf_meta_t           *meta;      /**< Metadata array.*/
+  uint32_t              n;          /**< Number of buffers.*/
+  uint32_t              latest;     /**< Last published, or @p NBUF_NONE.*/
+  uint32_t              free;       /**< Unowned buffers mask.*/
+  uint32_t              back;       /**< Producer buffer.*/
+  uint32_t              pseq;       /**< Last published number.*/
+  uint32_t              cseq;       /**< Last fetched number.*/
+  uint32_t              pcseq;      /**< Fetched number before the last.*/
+} nbuf_t;
+
+/*===========================================================================*/
+/* Module macros.                                                            */
+/*===========================================================================*/
+
+/**
+ * @brief   Gets a buffer address.
+ *
+ * @param[in] nbp       pointer to the @p nbuf_t object
+ * @param[in] idx       buffer index
+ * @return              The buffer address.
+ *
+ * @xclass
+ */
+#define nbufGetBuffer(nbp, idx) ((nbp)->buffers[idx])
+
+/**
+ * @brief   Gets a buffer metadata.
+ *
+ * @param[in] nbp       pointer to the @p nbuf_t object
+ * @param[in] idx       buffer index
+ * @return              Pointer to the @p nbuf_meta_t of the buffer.
+ *
+ * @xclass
+ */
+#define nbufGetMeta(nbp, idx) (&(nbp)->meta[idx])
+
+/**
+ * @brief   Gets the producer buffer index.
+ * @note    Producer side only.
+ *
+ * @param[in] nbp       pointer to the @p nbuf_t object
+ * @return              The buffer being filled.
+ *
+ * @xclass
+ */
+#define nbufGetBack(nbp) ((nbp)->back)
+
+/*===========================================================================*/
+/* External declarations.                                                    */
+/*===========================================================================*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+  void nbufObjectInit(nbuf_t *nbp, void * const *buffers, nbuf_meta_t *meta,
+                      uint32_t n);
+  void nbufReserve(nbuf_t *nbp, uint32_t idx);
+  uint32_t nbufPublish(nbuf_t *nbp, uint32_t timestamp, size_t size);
+  bool nbufIsReady(nbuf_t *nbp);
+  uint32_t nbufFetch(nbuf_t *nbp, uint32_t *missedp);
+  void nbufPutBack(nbuf_t *nbp, uint32_t idx);
+  void nbufRelease(nbuf_t *nbp, uint32_t idx);
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* NBUF_H_ */
+
+/** @} */
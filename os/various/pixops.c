@@ -0,0 +1,546 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/**
+ * @file    pixops.c
+ * @brief   Software pixel operations code.
+ * @details Pixels are stored little endian. Expansion to ARGB-8888
+ *          replicates the most significant bits, reduction truncates.
+ *          Blending follows the DMA2D formulas with truncating divisions:
+ *          @code
+ *            mult = afg * abg / 255
+ *            aout = afg + abg - mult
+ *            cout = (cfg * afg + cbg * abg - cbg * mult) / aout
+ *          @endcode
+ *          The fast paths handle the common cases (opaque foreground,
+ *          opaque background) with SWAR arithmetic on two channels per
+ *          word and give the same results.
+ *
+ * @addtogroup pixops
+ * @{
+ */
+
+#include "string.h" /* for memcpy() */
+
+#include "hal.h"
+#include "pixops.h"
+
+#if PIXOPS_USE_SIMD
+#include <arm_acle.h>
+#endif
+
+/*===========================================================================*/
+/* Module local definitions.                                                 */
+/*===========================================================================*/
+
+/**
+ * @brief   Mask of the even bytes of a word, two 16-bit lanes.
+ */
+#define PIXOPS_LANES_MASK       0x00FF00FFU
+
+/*===========================================================================*/
+/* Module exported variables.                                                */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Module local types.                                                       */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Module local variables.                                                   */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Module local functions.                                                   */
+/*===========================================================================*/
+
+/**
+ * @brief   Address of a layer line.
+ */
+static uint8_t *pixops_line(const pixops_layer_t *lp, size_t width,
+                            size_t y) {
+
+  return (uint8_t *)lp->bufferp +
+         y * (width + lp->wrap_offset) * pixopsBytesPerPixel(lp->fmt);
+}
+
+/**
+ * @brief   Reads a raw pixel.
+ */
+static inline uint32_t pixops_load(const uint8_t *p, size_t bpp) {
+
+  switch (bpp) {
+  case 4:
+    return ((uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+            ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24));
+  case 3:
+    return ((uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16));
+  case 2:
+    return ((uint32_t)p[0] | ((uint32_t)p[1] << 8));
+  default:
+    return (uint32_t)p[0];
+  }
+}
+
+/**
+ * @brief   Writes a raw pixel.
+ */
+static inline void pixops_store(uint8_t *p, size_t bpp, uint32_t raw) {
+
+  while (bpp-- > 0U) {
+    *p++ = (uint8_t)raw;
+    raw >>= 8;
+  }
+}
+
+/**
+ * @brief   Applies the alpha mode of an input layer.
+ */
+static inline pixops_color_t pixops_alpha(const pixops_layer_t *lp,
+                                          pixops_color_t c) {
+
+  switch (lp->amode) {
+  case PIXOPS_ALPHA_REPLACE:
+    return (c & 0x00FFFFFFU) | ((pixops_color_t)lp->alpha << 24);
+  case PIXOPS_ALPHA_MODULATE:
+    return (c & 0x00FFFFFFU) |
+           ((((c >> 24) * lp->alpha) / 255U) << 24);
+  default:
+    return c;
+  }
+}
+
+/**
+ * @brief   Reads an input pixel as ARGB-8888.
+ */
+static inline pixops_color_t pixops_fetch(const pixops_layer_t *lp,
+                                          const uint8_t *p, size_t bpp) {
+
+  return pixops_alpha(lp, pixopsToARGB8888(pixops_load(p, bpp),
+                                           lp->fmt, lp->clutp));
+}
+
+/**
+ * @brief   Blends two pixels, generic formula.
+ */
+static pixops_color_t pixops_blend_generic(pixops_color_t fg,
+                                           pixops_color_t bg) {
+  uint32_t afg = fg >> 24;
+  uint32_t abg = bg >> 24;
+  uint32_t mult = (afg * abg) / 255U;
+  uint32_t aout = afg + abg - mult;
+  pixops_color_t out;
+  unsigned shift;
+
+  if (aout == 0U) {
+    return 0U;
+  }
+
+  out = aout << 24;
+  for (shift = 0U; shift < 24U; shift += 8U) {
+    uint32_t cfg = (fg >> shift) & 0xFFU;
+    uint32_t cbg = (bg >> shift) & 0xFFU;
+
+    out |= (((cfg * afg) + (cbg * abg) - (cbg * mult)) / aout) << shift;
+  }
+  return out;
+}
+
+#if PIXOPS_USE_FAST_PATHS || defined(__DOXYGEN__)
+
+#if PIXOPS_USE_SIMD
+/* UXTB16 splits and UXTAB16 rounds both lanes in one instruction.*/
+#define pixops_lanes_lo(c)      __uxtb16(c)
+#define pixops_lanes_hi(c)      __uxtb16(__ror((c), 8U))
+#define pixops_div255(x)                                                    \
+  ((__uxtab16((x) + 0x00010001U, __ror((x), 8U)) >> 8) & PIXOPS_LANES_MASK)
+#else
+#define pixops_lanes_lo(c)      ((c) & PIXOPS_LANES_MASK)
+#define pixops_lanes_hi(c)      (((c) >> 8) & PIXOPS_LANES_MASK)
+/* Exact x / 255 on both lanes, x <= 255 * 255.*/
+#define pixops_div255(x)                                                    \
+  ((((x) + 0x00010001U + (((x) >> 8) & PIXOPS_LANES_MASK)) >> 8) &         \
+   PIXOPS_LANES_MASK)
+#endif
+
+/**
+ * @brief   Blends a pixel over an opaque one.
+ * @details With an opaque background the generic formula reduces to
+ *          <tt>(cfg * afg + cbg * (255 - afg)) / 255</tt>, computed on two
+ *          channels per word.
+ */
+static inline pixops_color_t pixops_blend_opaque(pixops_color_t fg,
+                                                 pixops_color_t bg) {
+  uint32_t a = fg >> 24;
+  uint32_t ia = 255U - a;
+  uint32_t rb = (pixops_lanes_lo(fg) * a) + (pixops_lanes_lo(bg) * ia);
+  uint32_t ag = (pixops_lanes_hi(fg) * a) + (pixops_lanes_hi(bg) * ia);
+
+  return 0xFF000000U | pixops_div255(rb) |
+         ((pixops_div255(ag) << 8) & 0x0000FF00U);
+}
+
+/**
+ * @brief   Fills a line of 16 or 32 bits pixels, a word at a time.
+ */
+static void pixops_fill_words(uint8_t *p, size_t bpp, size_t n,
+                              uint32_t raw) {
+  uint32_t *wp;
+
+  if (bpp == 2U) {
+    if ((((uintptr_t)p & 2U) != 0U) && (n > 0U)) {
+      *(uint16_t *)(void *)p = (uint16_t)raw;
+      p += 2;
+      n--;
+    }
+    raw |= raw << 16;
+    n *= 2U;
+  }
+  else {
+    n *= 4U;
+  }
+
+  wp = (uint32_t *)(void *)p;
+  while (n >= 4U) {
+    *wp++ = raw;
+    n -= 4U;
+  }
+  if (n > 0U) {
+    *(uint16_t *)(void *)wp = (uint16_t)raw;
+  }
+}
+
+/**
+ * @brief   Merges lines when no layer has gaps between them.
+ */
+static void pixops_merge_lines(const pixops_layer_t *outp,
+                               const pixops_layer_t *fgp,
+                               const pixops_layer_t *bgp,
+                               size_t *widthp, size_t *heightp) {
+
+  if ((outp->wrap_offset == 0U) &&
+      ((fgp == NULL) || (fgp->wrap_offset == 0U)) &&
+      ((bgp == NULL) || (bgp->wrap_offset == 0U))) {
+    *widthp *= *heightp;
+    *heightp = 1U;
+  }
+}
+
+#endif /* PIXOPS_USE_FAST_PATHS */
+
+/*===========================================================================*/
+/* Module exported functions.                                                */
+/*===========================================================================*/
+
+/**
+ * @brief   Bytes per pixel of a format.
+ *
+ * @param[in] fmt       pixel format
+ *
+ * @return              Bytes per pixel.
+ */
+size_t pixopsBytesPerPixel(pixops_fmt_t fmt) {
+
+  switch (fmt) {
+  case PIXOPS_FMT_ARGB8888:
+    return 4U;
+  case PIXOPS_FMT_RGB888:
+    return 3U;
+  case PIXOPS_FMT_RGB565:
+  case PIXOPS_FMT_ARGB4444:
+    return 2U;
+  case PIXOPS_FMT_L8:
+    return 1U;
+  default:
+    osalDbgAssert(false, "invalid format");
+    return 0U;
+  }
+}
+
+/**
+ * @brief   Converts a raw pixel to ARGB-8888.
+ *
+ * @param[in] raw       raw pixel value
+ * @param[in] fmt       pixel format
+ * @param[in] clutp     palette, L-8 format only
+ *
+ * @return              The ARGB-8888 color.
+ */
+pixops_color_t pixopsToARGB8888(uint32_t raw, pixops_fmt_t fmt,
+                                const pixops_color_t *clutp) {
+  uint32_t r, g, b, a;
+
+  switch (fmt) {
+  case PIXOPS_FMT_ARGB8888:
+    return raw;
+  case PIXOPS_FMT_RGB888:
+    return raw | 0xFF000000U;
+  case PIXOPS_FMT_RGB565:
+    r = (raw >> 11) & 0x1FU;
+    g = (raw >> 5) & 0x3FU;
+    b = raw & 0x1FU;
+    return 0xFF000000U | (((r << 3) | (r >> 2)) << 16) |
+           (((g << 2) | (g >> 4)) << 8) | ((b << 3) | (b >> 2));
+  case PIXOPS_FMT_ARGB4444:
+    a = (raw >> 12) & 0x0FU;
+    r = (raw >> 8) & 0x0FU;
+    g = (raw >> 4) & 0x0FU;
+    b = raw & 0x0FU;
+    return ((a * 17U) << 24) | ((r * 17U) << 16) | ((g * 17U) << 8) |
+           (b * 17U);
+  case PIXOPS_FMT_L8:
+    osalDbgCheck(clutp != NULL);
+    return clutp[raw & 0xFFU];
+  default:
+    osalDbgAssert(false, "invalid format");
+    return 0U;
+  }
+}
+
+/**
+ * @brief   Converts an ARGB-8888 color to a raw pixel.
+ *
+ * @param[in] c         ARGB-8888 color
+ * @param[in] fmt       output pixel format
+ *
+ * @return              The raw pixel value.
+ */
+uint32_t pixopsFromARGB8888(pixops_color_t c, pixops_fmt_t fmt) {
+
+  switch (fmt) {
+  case PIXOPS_FMT_ARGB8888:
+    return c;
+  case PIXOPS_FMT_RGB888:
+    return c & 0x00FFFFFFU;
+  case PIXOPS_FMT_RGB565:
+    return ((c >> 8) & 0xF800U) | ((c >> 5) & 0x07E0U) | ((c >> 3) & 0x001FU);
+  case PIXOPS_FMT_ARGB4444:
+    return ((c >> 16) & 0xF000U) | ((c >> 12) & 0x0F00U) |
+           ((c >> 8) & 0x00F0U) | ((c >> 4) & 0x000FU);
+  default:
+    osalDbgAssert(false, "invalid output format");
+    return 0U;
+  }
+}
+
+/**
+ * @brief   Fills an area with a color.
+ *
+ * @param[in] outp      output layer
+ * @param[in] width     area width, in pixels
+ * @param[in] height    area height, in pixels
+ * @param[in] color     ARGB-8888 color, converted to the output format
+ */
+void pixopsFill(const pixops_layer_t *outp,
+                uint16_t width, uint16_t height, pixops_color_t color) {
+  size_t bpp, w = width, h = height, x, y;
+  uint32_t raw;
+
+  osalDbgCheck((outp != NULL) && (outp->bufferp != NULL));
+
+  bpp = pixopsBytesPerPixel(outp->fmt);
+  raw = pixopsFromARGB8888(color, outp->fmt);
+
+#if PIXOPS_USE_FAST_PATHS
+  pixops_merge_lines(outp, NULL, NULL, &w, &h);
+#endif
+
+  for (y = 0U; y < h; y++) {
+    uint8_t *op = pixops_line(outp, w, y);
+
+#if PIXOPS_USE_FAST_PATHS
+    if ((bpp != 3U) && (((uintptr_t)op & (bpp - 1U)) == 0U)) {
+      pixops_fill_words(op, bpp, w, raw);
+      continue;
+    }
+#endif
+    for (x = 0U; x < w; x++) {
+      pixops_store(op, bpp, raw);
+      op += bpp;
+    }
+  }
+}
+
+/**
+ * @brief   Copies an area, no conversion.
+ * @pre     Both layers have the same pixel format.
+ *
+ * @param[in] outp      output layer
+ * @param[in] fgp       source layer
+ * @param[in] width     area width, in pixels
+ * @param[in] height    area height, in pixels
+ */
+void pixopsCopy(const pixops_layer_t *outp, const pixops_layer_t *fgp,
+                uint16_t width, uint16_t height) {
+  size_t bpp, w = width, h = height, y;
+
+  osalDbgCheck((outp != NULL) && (outp->bufferp != NULL) &&
+               (fgp != NULL) && (fgp->bufferp != NULL));
+  osalDbgAssert(outp->fmt == fgp->fmt, "formats mismatch");
+
+  bpp = pixopsBytesPerPixel(outp->fmt);
+
+#if PIXOPS_USE_FAST_PATHS
+  pixops_merge_lines(outp, fgp, NULL, &w, &h);
+#endif
+
+  for (y = 0U; y < h; y++) {
+    uint8_t *op = pixops_line(outp, w, y);
+    const uint8_t *fp = pixops_line(fgp, w, y);
+
+#if PIXOPS_USE_FAST_PATHS
+    memcpy(op, fp, w * bpp);
+#else
+    size_t n;
+
+    for (n = 0U; n < w * bpp; n++) {
+      op[n] = fp[n];
+    }
+#endif
+  }
+}
+
+/**
+ * @brief   Copies an area, converting the pixel format.
+ * @details The source layer alpha mode is applied.
+ *
+ * @param[in] outp      output layer
+ * @param[in] fgp       source layer
+ * @param[in] width     area width, in pixels
+ * @param[in] height    area height, in pixels
+ */
+void pixopsConvert(const pixops_layer_t *outp, const pixops_layer_t *fgp,
+                   uint16_t width, uint16_t height) {
+  size_t obpp, fbpp, w = width, h = height, x, y;
+
+  osalDbgCheck((outp != NULL) && (outp->bufferp != NULL) &&
+               (fgp != NULL) && (fgp->bufferp != NULL));
+
+  obpp = pixopsBytesPerPixel(outp->fmt);
+  fbpp = pixopsBytesPerPixel(fgp->fmt);
+
+#if PIXOPS_USE_FAST_PATHS
+  pixops_merge_lines(outp, fgp, NULL, &w, &h);
+#endif
+
+  for (y = 0U; y < h; y++) {
+    uint8_t *op = pixops_line(outp, w, y);
+    const uint8_t *fp = pixops_line(fgp, w, y);
+
+    x = 0U;
+#if PIXOPS_USE_FAST_PATHS
+    if ((fgp->fmt == PIXOPS_FMT_ARGB8888) &&
+        (outp->fmt == PIXOPS_FMT_RGB565) &&
+        ((((uintptr_t)fp | (uintptr_t)op) & 3U) == 0U)) {
+      /* Two pixels per store, alpha is dropped by the output format.*/
+      const uint32_t *sp = (const uint32_t *)(const void *)fp;
+      uint32_t *dp = (uint32_t *)(void *)op;
+
+      for (; x + 1U < w; x += 2U) {
+        *dp++ = pixopsFromARGB8888(sp[0], PIXOPS_FMT_RGB565) |
+                (pixopsFromARGB8888(sp[1], PIXOPS_FMT_RGB565) << 16);
+        sp += 2;
+      }
+      fp = (const uint8_t *)sp;
+      op = (uint8_t *)dp;
+    }
+    else if ((fgp->fmt == PIXOPS_FMT_RGB565) &&
+             (outp->fmt == PIXOPS_FMT_ARGB8888) &&
+             ((((uintptr_t)fp & 1U) | ((uintptr_t)op & 3U)) == 0U)) {
+      /* The expanded color is opaque, the alpha mode gives a constant.*/
+      const uint16_t *sp = (const uint16_t *)(const void *)fp;
+      uint32_t *dp = (uint32_t *)(void *)op;
+      pixops_color_t a = (fgp->amode == PIXOPS_ALPHA_KEEP) ?
+                         0xFF000000U : ((pixops_color_t)fgp->alpha << 24);
+
+      for (; x < w; x++) {
+        *dp++ = (pixopsToARGB8888(*sp++, PIXOPS_FMT_RGB565, NULL) &
+                 0x00FFFFFFU) | a;
+      }
+      fp = (const uint8_t *)sp;
+      op = (uint8_t *)dp;
+    }
+#endif
+    for (; x < w; x++) {
+      pixops_store(op, obpp, pixopsFromARGB8888(pixops_fetch(fgp, fp, fbpp),
+                                                outp->fmt));
+      op += obpp;
+      fp += fbpp;
+    }
+  }
+}
+
+/**
+ * @brief   Blends two areas.
+ * @details The layers alpha modes are applied, then the foreground is
+ *          blended over the background. The output layer can be the
+ *          background layer.
+ *
+ * @param[in] outp      output layer
+ * @param[in] fgp       foreground layer
+ * @param[in] bgp       background layer
+ * @param[in] width     area width, in pixels
+ * @param[in] height    area height, in pixels
+ */
+void pixopsBlend(const pixops_layer_t *outp, const pixops_layer_t *fgp,
+                 const pixops_layer_t *bgp,
+                 uint16_t width, uint16_t height) {
+  size_t obpp, fbpp, bbpp, w = width, h = height, x, y;
+
+  osalDbgCheck((outp != NULL) && (outp->bufferp != NULL) &&
+               (fgp != NULL) && (fgp->bufferp != NULL) &&
+               (bgp != NULL) && (bgp->bufferp != NULL));
+
+  obpp = pixopsBytesPerPixel(outp->fmt);
+  fbpp = pixopsBytesPerPixel(fgp->fmt);
+  bbpp = pixopsBytesPerPixel(bgp->fmt);
+
+#if PIXOPS_USE_FAST_PATHS
+  pixops_merge_lines(outp, fgp, bgp, &w, &h);
+#endif
+
+  for (y = 0U; y < h; y++) {
+    uint8_t *op = pixops_line(outp, w, y);
+    const uint8_t *fp = pixops_line(fgp, w, y);
+    const uint8_t *bp = pixops_line(bgp, w, y);
+
+    for (x = 0U; x < w; x++) {
+      pixops_color_t fg = pixops_fetch(fgp, fp, fbpp);
+      pixops_color_t c;
+
+#if PIXOPS_USE_FAST_PATHS
+      if ((fg >> 24) == 255U) {
+        /* Opaque foreground, the background is not even read.*/
+        c = fg;
+      }
+      else {
+        pixops_color_t bg = pixops_fetch(bgp, bp, bbpp);
+
+        c = ((bg >> 24) == 255U) ? pixops_blend_opaque(fg, bg)
+                                 : pixops_blend_generic(fg, bg);
+      }
+#else
+      c = pixops_blend_generic(fg, pixops_fetch(bgp, bp, bbpp));
+#endif
+      pixops_store(op, obpp, pixopsFromARGB8888(c, outp->fmt));
+      op += obpp;
+      fp += fbpp;
+      bp += bbpp;
+    }
+  }
+}
+
+/** @} */
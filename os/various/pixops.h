@@ -0,0 +1,150 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/**
+ * @file    pixops.h
+ * @brief   Software pixel operations.
+ * @details Portable fill, copy, convert and blend operations with the same
+ *          semantics as the DMA2D jobs, for devices without Chrom-ART.
+ *          Pixel format identifiers match the DMA2D ones.
+ *
+ * @addtogroup pixops
+ * @{
+ */
+
+#ifndef PIXOPS_H_
+#define PIXOPS_H_
+
+/*===========================================================================*/
+/* Module constants.                                                         */
+/*===========================================================================*/
+
+/**
+ * @name    Pixel formats
+ * @{
+ */
+#define PIXOPS_FMT_ARGB8888     (0)           /**< ARGB-8888 format.*/
+#define PIXOPS_FMT_RGB888       (1)           /**< RGB-888 format.*/
+#define PIXOPS_FMT_RGB565       (2)           /**< RGB-565 format.*/
+#define PIXOPS_FMT_ARGB4444     (4)           /**< ARGB-4444 format.*/
+#define PIXOPS_FMT_L8           (5)           /**< L-8 format, input only.*/
+/** @} */
+
+/**
+ * @name    Alpha modes
+ * @{
+ */
+#define PIXOPS_ALPHA_KEEP       (0)           /**< Original alpha channel.*/
+#define PIXOPS_ALPHA_REPLACE    (1)           /**< Replace with constant.*/
+#define PIXOPS_ALPHA_MODULATE   (2)           /**< Modulate with constant.*/
+/** @} */
+
+/*===========================================================================*/
+/* Module pre-compile time settings.                                         */
+/*===========================================================================*/
+
+/**
+ * @brief   Enables the word-at-a-time fast paths.
+ * @details When disabled every operation goes through the per-pixel
+ *          generic code, which is the reference the fast paths are
+ *          bit-exact with.
+ */
+#if !defined(PIXOPS_USE_FAST_PATHS) || defined(__DOXYGEN__)
+#define PIXOPS_USE_FAST_PATHS               TRUE
+#endif
+
+/**
+ * @brief   Enables the ARMv7E-M SIMD instructions in the fast paths.
+ * @note    The default is @p TRUE on cores implementing them.
+ */
+#if !defined(PIXOPS_USE_SIMD) || defined(__DOXYGEN__)
+#if defined(__ARM_FEATURE_SIMD32)
+#define PIXOPS_USE_SIMD                     TRUE
+#else
+#define PIXOPS_USE_SIMD                     FALSE
+#endif
+#endif
+
+/*===========================================================================*/
+/* Derived constants and error checks.                                       */
+/*===========================================================================*/
+
+#if PIXOPS_USE_SIMD && !defined(__ARM_FEATURE_SIMD32)
+#error "PIXOPS_USE_SIMD requires a core with the SIMD instructions"
+#endif
+
+/*===========================================================================*/
+/* Module data structures and types.                                         */
+/*===========================================================================*/
+
+/**
+ * @brief   Color, ARGB-8888.
+ */
+typedef uint32_t pixops_color_t;
+
+/**
+ * @brief   Pixel format.
+ */
+typedef uint32_t pixops_fmt_t;
+
+/**
+ * @brief   Alpha mode.
+ */
+typedef uint32_t pixops_amode_t;
+
+/**
+ * @brief   Layer specifications.
+ */
+typedef struct {
+  void                  *bufferp;     /**< Buffer address.*/
+  size_t                wrap_offset;  /**< Offset between lines, in pixels.*/
+  pixops_fmt_t          fmt;          /**< Pixel format.*/
+  const pixops_color_t  *clutp;       /**< L-8 palette, ARGB-8888.*/
+  pixops_amode_t        amode;        /**< Alpha mode of input layers.*/
+  uint8_t               alpha;        /**< Constant alpha of input layers.*/
+} pixops_layer_t;
+
+/*===========================================================================*/
+/* Module macros.                                                            */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* External declarations.                                                    */
+/*===========================================================================*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+  size_t pixopsBytesPerPixel(pixops_fmt_t fmt);
+  pixops_color_t pixopsToARGB8888(uint32_t raw, pixops_fmt_t fmt,
+                                  const pixops_color_t *clutp);
+  uint32_t pixopsFromARGB8888(pixops_color_t c, pixops_fmt_t fmt);
+  void pixopsFill(const pixops_layer_t *outp,
+                  uint16_t width, uint16_t height, pixops_color_t color);
+  void pixopsCopy(const pixops_layer_t *outp, const pixops_layer_t *fgp,
+                  uint16_t width, uint16_t height);
+  void pixopsConvert(const pixops_layer_t *outp, const pixops_layer_t *fgp,
+                     uint16_t width, uint16_t height);
+  void pixopsBlend(const pixops_layer_t *outp, const pixops_layer_t *fgp,
+                   const pixops_layer_t *bgp,
+                   uint16_t width, uint16_t height);
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PIXOPS_H_ */
+
+/** @} */
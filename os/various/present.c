@@ -0,0 +1,292 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/**
+ * @file    present.c
+ * @brief   Vsync synchronized frame presentation source.
+ * @note    The vertical blanking is an input of the module, simulators and
+ *          tests can drive it from any periodic source.
+ *
+ * @addtogroup Present
+ * @{
+ */
+
+#include "osal.h"
+#include "present.h"
+
+/*===========================================================================*/
+/* Module local definitions.                                                 */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Module exported variables.                                                */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Module local variables and types.                                         */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Module local functions.                                                   */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Module exported functions.                                                */
+/*===========================================================================*/
+
+/**
+ * @brief   Initializes a presentation object.
+ *
+ * @param[out] pp       pointer to the @p present_t object
+ * @param[in] flip      flip hook
+ * @param[in] arg       flip hook argument
+ * @param[in] front     initial front buffer, being displayed
+ * @param[in] back      initial back buffer
+ * @param[in] orphan    spare buffer
+ *
+ * @init
+ */
+void presentObjectInit(present_t *pp, present_flip_t flip, void *arg,
+                       void *front, void *back, void *orphan) {
+
+  osalDbgCheck((pp != NULL) && (flip != NULL));
+
+  pp->buffers[0] = back;
+  pp->buffers[1] = front;
+  pp->buffers[2] = orphan;
+  nbufObjectInit(&pp->nbuf, pp->buffers, pp->meta, 3U);
+  nbufReserve(&pp->nbuf, 1U);
+  pp->front = 1U;
+  pp->flip = flip;
+  pp->arg = arg;
+  pp->interval = 1U;
+  pp->elapsed = 0U;
+  pp->stats.vblanks = 0U;
+  pp->stats.presented = 0U;
+  pp->stats.skipped = 0U;
+  pp->stats.late = 0U;
+}
+
+/**
+ * @brief   Sets the swap interval.
+ * @details A new frame is flipped at most every @p interval vertical
+ *          blankings, 2 paces a 60Hz display at 30 frames per second.
+ *
+ * @param[in] pp        pointer to the @p present_t object
+ * @param[in] interval  vertical blankings per frame, at least 1
+ *
+ * @api
+ */
+void presentSetInterval(present_t *pp, uint32_t interval) {
+
+  osalDbgCheck((pp != NULL) && (interval > 0U));
+
+  osalSysLock();
+  pp->interval = interval;
+  osalSysUnlock();
+}
+
+/**
+ * @brief   Gets the buffer to be rendered.
+ *
+ * @param[in] pp        pointer to the @p present_t object
+ * @return              The back buffer.
+ *
+ * @api
+ */
+void *presentGetBack(present_t *pp) {
+  void *back;
+
+  osalSysLock();
+  back = presentGetBackI(pp);
+  osalSysUnlock();
+  return back;
+}
+
+/**
+ * @brief   Submits the back buffer.
+ * @details The rendered frame is flipped at the next due vertical blanking.
+ *          If the previous submitted frame has not been flipped yet it is
+ *          dropped and its buffer becomes the new back buffer.
+ *
+ * @param[in] pp        pointer to the @p present_t object
+ * @return              The new back buffer.
+ *
+ * @iclass
+ */
+void *presentSwapI(present_t *pp) {
+
+  osalDbgCheckClassI();
+
+  (void)nbufPublish(&pp->nbuf, pp->stats.vblanks, 0U);
+
+  return presentGetBackI(pp);
+}
+
+/**
+ * @brief   Submits the back buffer.
+ * @details The rendered frame is flipped at the next due vertical blanking.
+ *          If the previous submitted frame has not been flipped yet it is
+ *          dropped and its buffer becomes the new back buffer.
+ * @note    Never blocks.
+ *
+ * @param[in] pp        pointer to the @p present_t object
+ * @return              The new back buffer.
+ *
+ * @api
+ */
+void *presentSwap(present_t *pp) {
+  void *back;
+
+  osalSysLock();
+  back = presentSwapI(pp);
+  osalSysUnlock();
+  return back;
+}
+
+/**
+ * @brief   Vertical blanking handler.
+ * @details Flips the last submitted frame, if any and if the swap interval
+ *          elapsed. The previous front buffer is handed back to the renderer
+ *          as soon as the flip hook returns, the hook must make the new
+ *          address effective within the blanking.
+ * @note    A flip after more blankings than the swap interval is counted
+ *          as late, the first flip after an idle period too.
+ *
+ * @param[in] pp        pointer to the @p present_t object
+ *
+ * @iclass
+ */
+void presentVblankI(present_t *pp) {
+  uint32_t front, missed;
+
+  osalDbgCheckClassI();
+
+  pp->stats.vblanks++;
+  if (pp->elapsed < UINT32_MAX) {
+    pp->elapsed++;
+  }
+
+  if (pp->elapsed < pp->interval) {
+    return;
+  }
+
+  front = nbufFetch(&pp->nbuf, &missed);
+  if (front == NBUF_NONE) {
+    return;
+  }
+  if (!pp->flip(pp->arg, nbufGetBuffer(&pp->nbuf, front))) {
+    /* Display busy, the frame waits for the next blanking.*/
+    nbufPutBack(&pp->nbuf, front);
+    return;
+  }
+  nbufRelease(&pp->nbuf, pp->front);
+  pp->front = front;
+
+  pp->stats.skipped += missed;
+
+  if ((pp->elapsed > pp->interval) && (pp->stats.presented > 0U)) {
+    pp->stats.late++;
+  }
+  pp->stats.presented++;
+  pp->elapsed = 0U;
+}
+
+/**
+ * @brief   Gets the frame pacing statistics.
+ *
+ * @param[in] pp        pointer to the @p present_t object
+ * @param[out] statsp   pointer to the statistics copy
+ *
+ * @api
+ */
+void presentGetStats(present_t *pp, present_stats_t *statsp) {
+
+  osalDbgCheck((pp != NULL) && (statsp != NULL));
+
+  osalSysLock();
+  *statsp = pp->stats;
+  osalSysUnlock();
+}
+
+/**
+ * @brief   Clears the frame pacing statistics.
+ *
+ * @param[in] pp        pointer to the @p present_t object
+ *
+ * @api
+ */
+void presentResetStats(present_t *pp) {
+
+  osalDbgCheck(pp != NULL);
+
+  osalSysLock();
+  pp->stats.vblanks = 0U;
+  pp->stats.presented = 0U;
+  pp->stats.skipped = 0U;
+  pp->stats.late = 0U;
+  osalSysUnlock();
+}
+
+#if (PRESENT_USE_LTDC == TRUE) || defined(__DOXYGEN__)
+
+/**
+ * @brief   Enables the LTDC vertical blanking interrupt.
+ * @details The line interrupt is placed on the first blanking line, the
+ *          configured @p line_isr must call @p presentVblankI().
+ *
+ * @param[in] ltdcp     pointer to the @p LTDCDriver object
+ *
+ * @iclass
+ */
+void presentLtdcStartI(LTDCDriver *ltdcp) {
+
+  osalDbgCheckClassI();
+  osalDbgCheck(ltdcp != NULL);
+  osalDbgAssert(ltdcp->config->line_isr != NULL, "no line ISR");
+
+  ltdcSetLineInterruptPosI(ltdcp, (uint16_t)(ltdcp->active_window.vstop + 1U));
+  ltdcEnableLineInterruptI(ltdcp);
+}
+
+/**
+ * @brief   LTDC flip hook.
+ * @details Loads the background layer address and reloads the shadow
+ *          registers immediately, being in the blanking there is no
+ *          tearing.
+ *
+ * @param[in] arg       pointer to the @p LTDCDriver object
+ * @param[in] frontp    new front buffer
+ * @return              @p false if a reload is already in progress.
+ *
+ * @iclass
+ */
+bool presentLtdcFlipI(void *arg, void *frontp) {
+  LTDCDriver *ltdcp = (LTDCDriver *)arg;
+
+  osalDbgCheckClassI();
+
+  if (ltdcGetStateI(ltdcp) != LTDC_READY) {
+    return false;
+  }
+  ltdcBgSetFrameAddressI(ltdcp, frontp);
+  ltdcStartReloadI(ltdcp, true);
+  return true;
+}
+
+#endif /* PRESENT_USE_LTDC == TRUE */
+
+/** @} */
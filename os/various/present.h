@@ -0,0 +1,160 @@
+/*
+    ChibiOS-Contrib - Copyright (C) 2024 ChibiOS-Contrib
+
+    Licensed under the Apache License, Version 2.0 (the "License");
+    you may not use this file except in compliance with the License.
+    You may obtain a copy of the License at
+
+        http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS,
+    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+    See the License for the specific language governing permissions and
+    limitations under the License.
+*/
+
+/**
+ * @file    present.h
+ * @brief   Vsync synchronized frame presentation header.
+ * @details The renderer submits its back buffer and immediately gets a new
+ *          one, the front buffer is flipped at the vertical blanking by a
+ *          display specific hook. Built on a three buffers @p nbuf_t
+ *          mailbox.
+ *
+ * @addtogroup Present
+ * @{
+ */
+
+#ifndef PRESENT_H_
+#define PRESENT_H_
+
+#include "nbuf.h"
+
+/*===========================================================================*/
+/* Module constants.                                                         */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Module pre-compile time settings.                                         */
+/*===========================================================================*/
+
+/**
+ * @name    Presentation configuration options
+ * @{
+ */
+
+/**
+ * @brief   Enables the LTDC flip hook.
+ */
+#if !defined(PRESENT_USE_LTDC) || defined(__DOXYGEN__)
+#define PRESENT_USE_LTDC                    FALSE
+#endif
+
+/** @} */
+
+/*===========================================================================*/
+/* Derived constants and error checks.                                       */
+/*===========================================================================*/
+
+#if (PRESENT_USE_LTDC == TRUE) || defined(__DOXYGEN__)
+#include "hal_stm32_ltdc.h"
+
+#if (STM32_LTDC_USE_LTDC != TRUE)
+#error "PRESENT_USE_LTDC requires STM32_LTDC_USE_LTDC"
+#endif
+#endif
+
+/*===========================================================================*/
+/* Module data structures and types.                                         */
+/*===========================================================================*/
+
+/**
+ * @brief   Flip hook.
+ * @details Called at the vertical blanking to show a new front buffer.
+ *
+ * @param[in] arg       hook argument
+ * @param[in] frontp    new front buffer
+ * @return              @p false if the display could not flip at this
+ *                      vertical blanking, the flip is tried again at the
+ *                      next one.
+ */
+typedef bool (*present_flip_t)(void *arg, void *frontp);
+
+/**
+ * @brief   Frame pacing statistics.
+ */
+typedef struct {
+  uint32_t              vblanks;    /**< Vertical blankings.*/
+  uint32_t              presented;  /**< Frames flipped on screen.*/
+  uint32_t              skipped;    /**< Frames replaced before the flip.*/
+  uint32_t              late;       /**< Flips later than the interval.*/
+} present_stats_t;
+
+/**
+ * @brief   Presentation object.
+ */
+typedef struct {
+  nbuf_t                nbuf;       /**< Buffers rotation.*/
+  void                  *buffers[3]; /**< Back, front, spare buffers.*/
+  nbuf_meta_t           meta[3];    /**< Buffers metadata.*/
+  uint32_t              front;      /**< Displayed buffer index.*/
+  present_flip_t        flip;       /**< Flip hook.*/
+  void                  *arg;       /**< Flip hook argument.*/
+  uint32_t              interval;   /**< Vertical blankings per frame.*/
+  uint32_t              elapsed;    /**< Blankings since the last flip.*/
+  present_stats_t       stats;      /**< Frame pacing statistics.*/
+} present_t;
+
+/*===========================================================================*/
+/* Module macros.                                                            */
+/*===========================================================================*/
+
+/**
+ * @brief   Gets the buffer being displayed.
+ *
+ * @param[in] pp        pointer to the @p present_t object
+ * @return              The front buffer.
+ *
+ * @iclass
+ */
+#define presentGetFrontI(pp) nbufGetBuffer(&(pp)->nbuf, (pp)->front)
+
+/**
+ * @brief   Gets the buffer being rendered.
+ *
+ * @param[in] pp        pointer to the @p present_t object
+ * @return              The back buffer.
+ *
+ * @iclass
+ */
+#define presentGetBackI(pp)                                                 \
+  nbufGetBuffer(&(pp)->nbuf, nbufGetBack(&(pp)->nbuf))
+
+/*===========================================================================*/
+/* External declarations.                                                    */
+/*===========================================================================*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+  void presentObjectInit(present_t *pp, present_flip_t flip, void *arg,
+                         void *front, void *back, void *orphan);
+  void presentSetInterval(present_t *pp, uint32_t interval);
+  void *presentGetBack(present_t *pp);
+  void *presentSwapI(present_t *pp);
+  void *presentSwap(present_t *pp);
+  void presentVblankI(present_t *pp);
+  void presentGetStats(present_t *pp, present_stats_t *statsp);
+  void presentResetStats(present_t *pp);
+#if (PRESENT_USE_LTDC == TRUE) || defined(__DOXYGEN__)
+  void presentLtdcStartI(LTDCDriver *ltdcp);
+  bool presentLtdcFlipI(void *arg, void *frontp);
+#endif
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PRESENT_H_ */
+
+/** @} */
@@ -774,7 +774,7 @@ failed:
         uint32_t total = 0;
         uint32_t frame = 0;
         systime_t last = 0;
-        usbhuvcStreamStart(uvcdp, 310);
+        usbhuvcStreamStart(uvcdp, USBHUVC_MIN_EP_SZ_COMMITTED);
 
         uint8_t state = 0;
         static FIL fp;
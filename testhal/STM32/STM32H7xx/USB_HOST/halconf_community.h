@@ -192,6 +192,10 @@
 #define HAL_USBH_PORT_RESET_TIMEOUT                   500
 #define HAL_USBH_DEVICE_ADDRESS_STABILIZATION         20
 #define HAL_USBH_CONTROL_REQUEST_DEFAULT_TIMEOUT	  OSAL_MS2I(1000)
+#define HAL_USBH_USE_CFGDESC_CACHE                    TRUE
+#define HAL_USBH_CFGDESC_CACHE_ENTRIES                4
+#define HAL_USBH_CFGDESC_CACHE_SIZE                   2048
+#define HAL_USBH_USE_ENUMERATION_TIMING               TRUE
 
 /* MSD */
 #define HAL_USBH_USE_MSD                              TRUE
@@ -210,6 +214,10 @@
 #define HAL_USBHFTDI_DEFAULT_HANDSHAKE                USBHFTDI_HANDSHAKE_NONE
 #define HAL_USBHFTDI_DEFAULT_XON                      0x11
 #define HAL_USBHFTDI_DEFAULT_XOFF                     0x13
+#define HAL_USBHFTDI_DEFAULT_LATENCY                  16
+#define HAL_USBHFTDI_IN_URBS                          2
+#define HAL_USBHFTDI_OUT_URBS                         2
+#define HAL_USBHFTDI_BUFFER_SIZE                      64
 
 /* AOA */
 #define HAL_USBH_USE_AOA                              TRUE
@@ -225,6 +233,10 @@
 #define HAL_USBHAOA_DEFAULT_URI                       NULL
 #define HAL_USBHAOA_DEFAULT_SERIAL                    NULL
 #define HAL_USBHAOA_DEFAULT_AUDIO_MODE                USBHAOA_AUDIO_MODE_DISABLED
+#define HAL_USBHAOA_USE_PACKET_API                    FALSE
+#define HAL_USBHAOA_PACKET_SIZE                       512
+#define HAL_USBHAOA_OUT_PACKETS                       4
+#define HAL_USBHAOA_IN_PACKETS                        4
 
 /* UVC */
 #define HAL_USBH_USE_UVC                              TRUE
@@ -233,11 +245,20 @@
 #define HAL_USBHUVC_MAX_MAILBOX_SZ                    70
 #define HAL_USBHUVC_WORK_RAM_SIZE                     20000
 #define HAL_USBHUVC_STATUS_PACKETS_COUNT              10
+#define HAL_USBHUVC_USE_FRAME_ASSEMBLER               FALSE
+#define HAL_USBHUVC_BULK_URBS                         2
 
 /* HID */
 #define HAL_USBH_USE_HID                              TRUE
 #define HAL_USBHHID_MAX_INSTANCES                     2
 #define HAL_USBHHID_USE_INTERRUPT_OUT                 FALSE
+#define HAL_USBHHID_USE_REPORT_PARSER                 TRUE
+#define HAL_USBHHID_MAX_FIELDS                        32
+#define HAL_USBHHID_REPORT_DESC_MAX_SIZE              512
+#define HAL_USBHHID_USE_REPORT_QUEUE                  FALSE
+#define HAL_USBHHID_REPORT_QUEUE_SIZE                 8
+#define HAL_USBHHID_OUT_QUEUE_SIZE                    4
+#define HAL_USBHHID_MAX_REPORT_SIZE                   64
 
 /* HUB */
 #define HAL_USBH_USE_HUB                              TRUE